@@ -0,0 +1,114 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Apache/PoolArena.hpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#ifndef _ELEMENTS_EL_APACHE_POOLARENA_HPP_
+#define _ELEMENTS_EL_APACHE_POOLARENA_HPP_
+
+#include <new>
+
+#include <apr_pools.h>
+
+#include <El/Exception.hpp>
+#include <El/Arena.hpp>
+
+namespace El
+{
+  namespace Apache
+  {
+    //
+    // Arena taking its blocks from APR pool, so memory is returned to
+    // Apache together with the pool; falls back to heap if pool is null
+    //
+    class PoolArena : public El::Arena
+    {
+    public:
+      PoolArena(apr_pool_t* pool, size_t block_size = 8192) throw();
+      virtual ~PoolArena() throw();
+
+      apr_pool_t* pool() const throw();
+
+    protected:
+      virtual void* allocate_block(size_t size) throw(El::Exception);
+      virtual void free_block(void* block, size_t size) throw();
+
+    private:
+      apr_pool_t* pool_;
+    };
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Inlines
+///////////////////////////////////////////////////////////////////////////////
+
+namespace El
+{
+  namespace Apache
+  {
+    //
+    // PoolArena class
+    //
+    inline
+    PoolArena::PoolArena(apr_pool_t* pool, size_t block_size) throw()
+        : El::Arena(block_size),
+          pool_(pool)
+    {
+    }
+
+    inline
+    PoolArena::~PoolArena() throw()
+    {
+      release();
+    }
+
+    inline
+    apr_pool_t*
+    PoolArena::pool() const throw()
+    {
+      return pool_;
+    }
+
+    inline
+    void*
+    PoolArena::allocate_block(size_t size) throw(El::Exception)
+    {
+      if(pool_ == 0)
+      {
+        return El::Arena::allocate_block(size);
+      }
+
+      // APR aligns to 8 bytes only
+      void* block = apr_palloc(pool_, size + ALIGNMENT - 1);
+
+      if(block == 0)
+      {
+        throw std::bad_alloc();
+      }
+
+      return (void*)(((uintptr_t)block + ALIGNMENT - 1) &
+                     ~(uintptr_t)(ALIGNMENT - 1));
+    }
+
+    inline
+    void
+    PoolArena::free_block(void* block, size_t size) throw()
+    {
+      if(pool_ == 0)
+      {
+        El::Arena::free_block(block, size);
+      }
+    }
+  }
+}
+
+#endif // _ELEMENTS_EL_APACHE_POOLARENA_HPP_
@@ -123,6 +123,28 @@ namespace El
       return headers_;
     }
 
+    const El::Net::HTTP::FieldTable&
+    Request::In::header_table() throw(El::Exception)
+    {
+      if((flags_ & RIS_HEADER_TABLE_READ) == 0)
+      {
+        const apr_array_header_t* ha =
+          apr_table_elts(request_->ap_request->headers_in);
+        
+        unsigned long count = ha->nelts;
+
+        for (apr_table_entry_t* he = (apr_table_entry_t *)ha->elts;
+             count--; he++)
+        {
+          header_table_.add(he->key, he->val);
+        }
+        
+        flags_ |= RIS_HEADER_TABLE_READ;
+      }
+      
+      return header_table_;
+    }
+
     const El::Net::HTTP::CookieList&
     Request::In::cookies() throw(El::Exception)
     {
@@ -377,6 +399,50 @@ namespace El
         i->second->on_write(buffer, size);
       }
     }
+    
+    void
+    Request::Out::write_shared(SharedBuffer* buffer,
+                               const char* data,
+                               size_t size)
+      throw(El::Exception)
+    {
+      for(CallbackPtrMap::iterator i(callbacks_.begin()),
+            e(callbacks_.end()); i != e; ++i)
+      {
+        i->second->on_write_shared(buffer, data, size);
+      }
+    }
+
+    void
+    Request::Out::write(SharedBuffer* buffer, const char* data, size_t size)
+      throw(El::Exception)
+    {
+      std::ostream& ostr = stream();
+
+      if(pstream_ == &stream_)
+      {
+        stream_.write_shared(buffer, data, size);
+      }
+      else
+      {
+        ostr.write(data, size);
+      }
+    }
+      
+    void
+    Request::Out::brigade(bool val) throw(Exception, El::Exception)
+    {
+      if(pstream_)
+      {
+        std::ostringstream ostr;
+        ostr << "El::Apache::Request::Out::brigade: late call; "
+          "already writing body";
+        
+        throw Exception(ostr.str());
+      }
+      
+      stream_.brigade(val);
+    }
       
     void
     Request::Out::deflate(int level) throw(Exception, El::Exception)
@@ -563,6 +629,36 @@ namespace El
 
           throw Exception(ostr.str());
         }
+
+        const OutStreamBuf::OutputStat& stat = out_.output_stat();
+
+        apr_table_setn(ap_request->notes,
+                       "ElBytesCopied",
+                       apr_psprintf(ap_request->pool,
+                                    "%llu",
+                                    stat.copied));
+        
+        apr_table_setn(ap_request->notes,
+                       "ElBytesReferenced",
+                       apr_psprintf(ap_request->pool,
+                                    "%llu",
+                                    stat.referenced));
+
+        const El::Arena::Stat& arena_stat = arena_.stat();
+
+        apr_table_setn(ap_request->notes,
+                       "ElArenaAllocations",
+                       apr_psprintf(ap_request->pool,
+                                    "%llu",
+                                    (unsigned long long)
+                                    arena_stat.allocations));
+
+        apr_table_setn(ap_request->notes,
+                       "ElArenaBytes",
+                       apr_psprintf(ap_request->pool,
+                                    "%llu",
+                                    (unsigned long long)
+                                    arena_stat.block_bytes));
         
         for(CallbackMap::iterator i(callbacks_.begin()), e(callbacks_.end());
             i != e; ++i)
@@ -595,5 +691,19 @@ namespace El
       return false;
     }
 
+    void
+    Request::brigade(bool val) throw(Exception, El::Exception)
+    {
+      if(state_ > RPS_HEADERS_WRITING)
+      {
+        std::ostringstream ostr;
+        ostr << "El::Apache::Request::brigade: late call; state " << state_;
+        throw Exception(ostr.str());
+      }
+
+      // Do not use out() here as it change request state
+      // discarding the body
+      out_.brigade(val);
+    }
   }
 }
@@ -30,11 +30,13 @@
 
 #include <El/Net/URL.hpp>
 #include <El/Net/HTTP/Params.hpp>
+#include <El/Net/HTTP/FieldTable.hpp>
 #include <El/Net/HTTP/Cookies.hpp>
 #include <El/Net/HTTP/Headers.hpp>
 
 #include <El/Apache/Exception.hpp>
 #include <El/Apache/Stream.hpp>
+#include <El/Apache/PoolArena.hpp>
 
 namespace El
 {
@@ -57,6 +59,15 @@ namespace El
         virtual void on_write(const char* buffer, size_t size)
           throw(El::Exception) = 0;
 
+        //
+        // Data resides in immutable buffer, so can be kept by reference.
+        // By default falls back to on_write.
+        //
+        virtual void on_write_shared(SharedBuffer* buffer,
+                                     const char* data,
+                                     size_t size)
+          throw(El::Exception);
+
         virtual void pre_ap_rwrite() throw() = 0;
         virtual void post_ap_rwrite() throw() = 0;
         
@@ -65,8 +76,21 @@ namespace El
 
       typedef El::RefCount::SmartPtr<Callback> Callback_var;
       
-      typedef __gnu_cxx::hash_map<uint32_t, Callback_var> CallbackMap;
-      typedef __gnu_cxx::hash_map<uint32_t, Callback*> CallbackPtrMap;
+      typedef __gnu_cxx::hash_map<
+        uint32_t,
+        Callback_var,
+        __gnu_cxx::hash<uint32_t>,
+        std::equal_to<uint32_t>,
+        El::ArenaAllocator<Callback_var> >
+      CallbackMap;
+
+      typedef __gnu_cxx::hash_map<
+        uint32_t,
+        Callback*,
+        __gnu_cxx::hash<uint32_t>,
+        std::equal_to<uint32_t>,
+        El::ArenaAllocator<Callback*> >
+      CallbackPtrMap;
 
       struct In
       {          
@@ -74,6 +98,11 @@ namespace El
           throw(El::Exception);
         
         const El::Net::HTTP::HeaderList& headers() throw(El::Exception);
+
+        // Same headers indexed by name; cheaper for lookups
+        const El::Net::HTTP::FieldTable& header_table()
+          throw(El::Exception);
+
         const El::Net::HTTP::CookieList& cookies() throw(El::Exception);
 
         const El::Net::HTTP::AcceptLanguageList& accept_languages()
@@ -100,7 +129,8 @@ namespace El
           RIS_HEADERS_READ = 0x2,
           RIS_COOKIES_READ = 0x4,
           RIS_ACCEPT_LANG = 0x8,
-          RIS_ACCEPT_ENCODING = 0x10
+          RIS_ACCEPT_ENCODING = 0x10,
+          RIS_HEADER_TABLE_READ = 0x20
         };
           
         unsigned long flags_;
@@ -108,6 +138,7 @@ namespace El
           
         El::Net::HTTP::ParamList parameters_;
         El::Net::HTTP::HeaderList headers_;
+        El::Net::HTTP::FieldTable header_table_;
         El::Net::HTTP::CookieList cookies_;
         El::Net::HTTP::AcceptLanguageList accept_languages_;
         El::Net::HTTP::AcceptEncodingList accept_encodings_;
@@ -152,9 +183,20 @@ namespace El
                                    bool redirect = false)
           throw(El::Exception);
 
+        //
+        // Writes data referencing buffer if stream is in brigade mode and
+        // is not deflated; copies otherwise
+        //
+        void write(SharedBuffer* buffer, const char* data, size_t size)
+          throw(El::Exception);
+        
         void deflate(int level) throw(Exception, El::Exception);
+        void brigade(bool val) throw(Exception, El::Exception);
+        
         void finalize() throw(El::Exception);
         void discard() throw(El::Exception);
+
+        const OutStreamBuf::OutputStat& output_stat() const throw();
         
       private:
         
@@ -163,6 +205,11 @@ namespace El
         virtual void write(const char* buffer, size_t size)
           throw(El::Exception);
 
+        virtual void write_shared(SharedBuffer* buffer,
+                                  const char* data,
+                                  size_t size)
+          throw(El::Exception);
+
         virtual void pre_ap_rwrite() throw();
         virtual void post_ap_rwrite() throw();        
 
@@ -191,6 +238,14 @@ namespace El
 
       bool deflate(int level) throw(Exception, El::Exception);
 
+      //
+      // Switches response output to APR bucket brigade which references
+      // response buffers instead of copying them with ap_rwrite.
+      // Bytes copied and referenced are reported in ElBytesCopied and
+      // ElBytesReferenced request notes.
+      //
+      void brigade(bool val) throw(Exception, El::Exception);
+
       void callback(Callback* value, unsigned long id) throw();
       Callback* callback(unsigned long id) throw();
 
@@ -258,6 +313,16 @@ namespace El
       //
       Out& out() throw(El::Exception);
 
+      //
+      // Monotonic arena taking memory from request pool. Parameter, header,
+      // cookie lists and callback maps are allocated there, so request
+      // processing does not contend in global heap; allocations and bytes
+      // taken from pool are reported in ElArenaAllocations and
+      // ElArenaBytes request notes. Containers allocated in arena should
+      // not outlive the request.
+      //
+      El::Arena& arena() throw();
+
     private:
       friend class In;
       friend class Out;
@@ -275,6 +340,9 @@ namespace El
       };
           
       unsigned long flags_;
+
+      // Should precede members allocating in it
+      PoolArena arena_;
       
       In in_;
       Out out_;
@@ -303,6 +371,20 @@ namespace El
 {
   namespace Apache
   {
+    //
+    // Request::Callback struct
+    //
+
+    inline
+    void
+    Request::Callback::on_write_shared(SharedBuffer* buffer,
+                                       const char* data,
+                                       size_t size)
+      throw(El::Exception)
+    {
+      on_write(data, size);
+    }
+    
     //
     // Request::Out class
     //
@@ -311,6 +393,10 @@ namespace El
     Request::Out::Out(Request* req) throw()
         :  request_(req),
            stream_(req->ap_request, this),
+           callbacks_(5,
+                      CallbackPtrMap::hasher(),
+                      CallbackPtrMap::key_equal(),
+                      CallbackPtrMap::allocator_type(&req->arena_)),
            deflate_(false),
            deflate_level_(0),
            pstream_(0)
@@ -322,6 +408,13 @@ namespace El
     {
     }
 
+    inline
+    const OutStreamBuf::OutputStat&
+    Request::Out::output_stat() const throw()
+    {
+      return stream_.output_stat();
+    }
+
     inline
     bool
     Request::Out::stream_created() const throw()
@@ -482,6 +575,9 @@ namespace El
     Request::In::In(Request* req) throw()
         :  flags_(0),
            request_(req),
+           parameters_(&req->arena_),
+           headers_(&req->arena_),
+           cookies_(&req->arena_),
            stream_(req->ap_request)
     {
     }
@@ -501,12 +597,17 @@ namespace El
     Request::Request(request_rec* ap_req) throw()
         : ap_request(ap_req),
           flags_(0),
+          arena_(ap_req->pool),
           in_(this),
           out_(this),
           time_(ap_req->request_time/1000000, ap_req->request_time%1000000),
           port_(0),
           state_(RPS_INPUT_HEADERS_PARSED),
-          request_body_present_(false)
+          request_body_present_(false),
+          callbacks_(5,
+                     CallbackMap::hasher(),
+                     CallbackMap::key_equal(),
+                     CallbackMap::allocator_type(&arena_))
     {
     }
 
@@ -553,6 +654,13 @@ namespace El
       out_.callback(value, id);
     }
 
+    inline
+    El::Arena&
+    Request::arena() throw()
+    {
+      return arena_;
+    }
+
     inline
     Request::Callback*
     Request::callback(unsigned long id) throw()
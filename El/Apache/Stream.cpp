@@ -17,11 +17,91 @@
 
 #include <httpd/httpd.h>
 #include <httpd/http_protocol.h>
+#include <httpd/util_filter.h>
+#include <httpd/http_request.h>
+
+#include <apr_buckets.h>
 
 #include <El/Exception.hpp>
 
 #include "Stream.hpp"
 
+namespace
+{
+  //
+  // Bucket referencing El::Apache::SharedBuffer data
+  //
+  struct SharedBucket
+  {
+    apr_bucket_refcount refcount;
+    El::Apache::SharedBuffer* buffer;
+    const char* base;
+  };
+
+  void
+  shared_bucket_destroy(void* data)
+  {
+    SharedBucket* h = (SharedBucket*)data;
+
+    if(apr_bucket_shared_destroy(h))
+    {
+      h->buffer->remove_ref();
+      apr_bucket_free(h);
+    }
+  }
+
+  apr_status_t
+  shared_bucket_read(apr_bucket* b,
+                     const char** str,
+                     apr_size_t* len,
+                     apr_read_type_e block)
+  {
+    SharedBucket* h = (SharedBucket*)b->data;
+
+    *str = h->base + b->start;
+    *len = b->length;
+    
+    return APR_SUCCESS;
+  }
+  
+  const apr_bucket_type_t SHARED_BUCKET_TYPE =
+  {
+    "EL_SHARED",
+    5,
+    apr_bucket_type_t::APR_BUCKET_DATA,
+    shared_bucket_destroy,
+    shared_bucket_read,
+    apr_bucket_setaside_noop,
+    apr_bucket_shared_split,
+    apr_bucket_shared_copy
+  };
+
+  apr_bucket*
+  shared_bucket_create(El::Apache::SharedBuffer* buffer,
+                       const char* data,
+                       apr_size_t size,
+                       apr_bucket_alloc_t* list)
+    throw(El::Exception)
+  {
+    apr_bucket* b = (apr_bucket*)apr_bucket_alloc(sizeof(*b), list);
+
+    APR_BUCKET_INIT(b);
+    b->free = apr_bucket_free;
+    b->list = list;
+
+    SharedBucket* h =
+      (SharedBucket*)apr_bucket_alloc(sizeof(SharedBucket), list);
+
+    h->buffer = El::RefCount::add_ref(buffer);
+    h->base = data;
+
+    b = apr_bucket_shared_make(b, h, 0, size);
+    b->type = &SHARED_BUCKET_TYPE;
+
+    return b;
+  }
+}
+
 namespace El
 {
   namespace Apache
@@ -172,14 +252,18 @@ namespace El
 
     OutStreamBuf::OutStreamBuf(request_rec* r,
                                Callback* callback,
-                               unsigned long send_buffer_size)
+                               unsigned long send_buffer_size,
+                               bool brigade)
         throw(InvalidArg, Exception, El::Exception)
           : request_(r),
             callback_(callback),
             send_buffer_size_(send_buffer_size),
             send_buffer_(new char[send_buffer_size]),
             send_bytes_(0),
-            last_error_(0)
+            last_error_(0),
+            brigade_(0),
+            brigade_bytes_(0),
+            unsent_(0)
     {
       if(r == 0)
       {
@@ -194,13 +278,227 @@ namespace El
           "El::Apache::InStreamBuf::InStreamBuf: send_buffer_size "
           "argument is 0");
       }
+
+      if(brigade)
+      {
+        this->brigade(true);
+      }
     }
 
     OutStreamBuf::~OutStreamBuf() throw()
     {
+      if(brigade_)
+      {
+        apr_brigade_cleanup(brigade_);
+      }
+      
       delete [] send_buffer_;
     }
 
+    void
+    OutStreamBuf::brigade(bool val) throw(Exception, El::Exception)
+    {
+      if(val == (brigade_ != 0))
+      {
+        return;
+      }
+      
+      if(pptr() != 0)
+      {
+        throw Exception("El::Apache::OutStreamBuf::brigade: "
+                        "writing already started");
+      }
+
+      if(val)
+      {
+        brigade_ = apr_brigade_create(request_->pool,
+                                      request_->connection->bucket_alloc);
+      }
+      else
+      {
+        apr_brigade_destroy(brigade_);
+        brigade_ = 0;
+      }
+    }
+
+    void
+    OutStreamBuf::write_started() throw()
+    {
+      if(callback_)
+      {
+        callback_->start_writing();
+      }
+    }
+
+    void
+    OutStreamBuf::allocate_shared_buffer() throw(El::Exception)
+    {
+      send_shared_ = new SharedBuffer(send_buffer_size_);
+      unsent_ = send_shared_->data();
+      setp(unsent_, unsent_ + send_shared_->size());
+    }
+    
+    void
+    OutStreamBuf::append_shared(SharedBuffer* buffer,
+                                const char* data,
+                                size_t size)
+      throw(El::Exception)
+    {
+      APR_BRIGADE_INSERT_TAIL(
+        brigade_,
+        shared_bucket_create(buffer,
+                             data,
+                             size,
+                             request_->connection->bucket_alloc));
+      
+      brigade_bytes_ += size;
+      
+      if(callback_)
+      {
+        callback_->write_shared(buffer, data, size);
+      }      
+    }
+
+    bool
+    OutStreamBuf::emit_buffered() throw(El::Exception)
+    {
+      if(pptr() > unsent_)
+      {
+        size_t size = pptr() - unsent_;
+        append_shared(send_shared_.in(), unsent_, size);
+        
+        output_stat_.copied += size;
+        unsent_ = pptr();
+      }
+
+      return true;
+    }
+    
+    bool
+    OutStreamBuf::pass_brigade() throw(El::Exception)
+    {
+      if(APR_BRIGADE_EMPTY(brigade_))
+      {
+        return true;
+      }
+      
+      if(callback_)
+      {
+        callback_->pre_ap_rwrite();
+      }
+
+      apr_status_t status =
+        ap_pass_brigade(request_->output_filters, brigade_);
+
+      if(callback_)
+      {
+        callback_->post_ap_rwrite();
+      }
+      
+      apr_brigade_cleanup(brigade_);
+
+      if(status != APR_SUCCESS)
+      {
+        last_error_ = status;
+          
+        std::ostringstream ostr;            
+        ostr << "El::Apache::OutStreamBuf::pass_brigade: "
+          "ap_pass_brigade failed after " << send_bytes_
+             << " bytes written; status " << status;
+          
+        last_error_desc_ = ostr.str();
+        return false;
+      }
+
+      send_bytes_ += brigade_bytes_;
+      brigade_bytes_ = 0;
+
+      return true;
+    }
+    
+    bool
+    OutStreamBuf::write_shared(SharedBuffer* buffer,
+                               const char* data,
+                               size_t size)
+      throw(El::Exception)
+    {
+      if(!last_error_desc_.empty())
+      {
+        return false;
+      }
+
+      if(brigade_ == 0)
+      {
+        return (size_t)sputn(data, size) == size;
+      }
+      
+      if(pptr() == 0)
+      {
+        write_started();
+        allocate_shared_buffer();
+      }
+
+      emit_buffered();
+      append_shared(buffer, data, size);
+      output_stat_.referenced += size;
+
+      return brigade_bytes_ < send_buffer_size_ || pass_brigade();
+    }
+
+    bool
+    OutStreamBuf::write_reference(const char* text, size_t size)
+      throw(El::Exception)
+    {
+      if(!last_error_desc_.empty())
+      {
+        return false;
+      }
+
+      if(brigade_ == 0)
+      {
+        return (size_t)sputn(text, size) == size;
+      }
+
+      if(pptr() == 0)
+      {
+        write_started();
+        allocate_shared_buffer();
+      }
+
+      emit_buffered();
+      
+      APR_BRIGADE_INSERT_TAIL(
+        brigade_,
+        apr_bucket_transient_create(text,
+                                    size,
+                                    request_->connection->bucket_alloc));
+
+      brigade_bytes_ += size;
+      output_stat_.referenced += size;
+      
+      if(callback_)
+      {
+        callback_->write(text, size);
+      }
+
+      return brigade_bytes_ < send_buffer_size_ || pass_brigade();
+    }
+      
+    bool
+    OutStreamBuf::flush_references() throw(El::Exception)
+    {
+      if(!last_error_desc_.empty())
+      {
+        return false;
+      }
+      
+      //
+      // Transient buckets must be passed (or set aside by filters)
+      // before referenced text goes away
+      //
+      return brigade_ == 0 || (emit_buffered() && pass_brigade());
+    }
+    
     OutStreamBuf::int_type
     OutStreamBuf::overflow(int_type c)
     {
@@ -212,12 +510,36 @@ namespace El
       std::cerr << "PPTR: " << std::hex << (unsigned long)pptr()
                 << std::dec << ", CHR: " << (char)c << std::endl;
 */
-      if(pptr() == 0)
+      if(brigade_)
       {
-        if(callback_)
+        //
+        // Filled buffer goes to output filters by reference and new one
+        // allocated, so no bytes moved
+        //
+        if(pptr() == 0)
+        {
+          write_started();
+        }
+        else if(!emit_buffered() || !pass_brigade())
         {
-          callback_->start_writing();
+          return traits_type::eof();
         }
+
+        if(traits_type::eq_int_type(c, traits_type::eof()))
+        {
+          return traits_type::not_eof(c);
+        }
+        
+        allocate_shared_buffer();
+        *pptr() = c;
+        pbump(1);
+        
+        return c;
+      }
+      
+      if(pptr() == 0)
+      {
+        write_started();
         
         send_buffer_[0] = c;
         setp(send_buffer_ + 1, send_buffer_ + send_buffer_size_);
@@ -261,6 +583,7 @@ namespace El
       }
 
       send_bytes_ += written_bytes;
+      output_stat_.copied += written_bytes;
   
       unsigned long left_bytes = send_buffer_size_ - written_bytes;
 
@@ -285,6 +608,12 @@ namespace El
       std::cerr << "PPTR: " << std::hex << (unsigned long)pptr()
                 << std::dec << std::endl;
 */
+      if(brigade_)
+      {
+        // Rest of the current buffer is still used for subsequent output
+        return emit_buffered() && pass_brigade() ? 0 : -1;
+      }
+      
       unsigned long bytes_to_write = pptr() - send_buffer_;
 
       for(char* ptr = send_buffer_; bytes_to_write > 0; )
@@ -311,6 +640,7 @@ namespace El
 
         ptr += written_bytes;
         send_bytes_ += written_bytes;
+        output_stat_.copied += written_bytes;
         bytes_to_write -= written_bytes;
       }
 
@@ -323,11 +653,14 @@ namespace El
     //
     OutStream::OutStream(request_rec* r,
                          OutStreamBuf::Callback* callback,
-                         unsigned long send_buffer_size)
+                         unsigned long send_buffer_size,
+                         bool brigade)
       throw(InvalidArg, Exception, El::Exception)
         : std::basic_ostream<char, std::char_traits<char> >(0)
     {
-      streambuf_.reset(new OutStreamBuf(r, callback, send_buffer_size));
+      streambuf_.reset(
+        new OutStreamBuf(r, callback, send_buffer_size, brigade));
+
       init(streambuf_.get());
     }    
   }
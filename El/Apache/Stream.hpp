@@ -19,8 +19,13 @@
 #include <memory>
 
 #include <httpd/httpd.h>
+#include <apr_buckets.h>
 
 #include <El/Exception.hpp>
+#include <El/RefCount/All.hpp>
+#include <El/SyncPolicy.hpp>
+#include <El/String/Template.hpp>
+
 #include <El/Apache/Exception.hpp>
 
 namespace El
@@ -91,8 +96,44 @@ namespace El
       InStreamBufPtr streambuf_;
     };
 
+    //
+    // Immutable after filled memory block which can be passed to Apache
+    // output filters and kept by caches by reference.
+    //
+    class SharedBuffer :
+      public virtual El::RefCount::DefaultImpl<El::Sync::ThreadPolicy>
+    {
+    public:
+      SharedBuffer(size_t size) throw(El::Exception);
+      virtual ~SharedBuffer() throw();
+
+      char* data() const throw() { return data_; }
+      size_t size() const throw() { return size_; }
+
+    protected:
+      // For descendants providing memory other way; data_ to be reset
+      // to 0 unless malloc-ed
+      SharedBuffer() throw() : data_(0), size_(0) {}
+      
+    protected:
+      char* data_;
+      size_t size_;
+
+    private:
+      SharedBuffer(const SharedBuffer&);
+      void operator=(const SharedBuffer&);
+    };
+
+    typedef El::RefCount::SmartPtr<SharedBuffer> SharedBuffer_var;
+
+    //
+    // In brigade mode response bytes are appended to the APR bucket
+    // brigade referencing buffers they reside in instead of being copied
+    // with ap_rwrite.
+    //
     class OutStreamBuf
-      : public std::basic_streambuf<char, std::char_traits<char> >
+      : public std::basic_streambuf<char, std::char_traits<char> >,
+        public El::String::Template::ReferenceOutput
     {
     public:
 
@@ -103,16 +144,35 @@ namespace El
         virtual void write(const char* buffer, size_t size)
           throw(El::Exception) = 0;
 
+        // Data is located in the buffer which will not be ever changed,
+        // so can be kept by reference
+        virtual void write_shared(SharedBuffer* buffer,
+                                  const char* data,
+                                  size_t size)
+          throw(El::Exception);
+
         virtual void pre_ap_rwrite() throw() = 0;
         virtual void post_ap_rwrite() throw() = 0;
           
         virtual ~Callback() throw() {}
       };
+
+      struct OutputStat
+      {
+        // Bytes copied into the stream buffer
+        unsigned long long copied;
+
+        // Bytes passed to output filters by reference
+        unsigned long long referenced;
+
+        OutputStat() throw() : copied(0), referenced(0) {}
+      };
       
     public:
       OutStreamBuf(request_rec* r,
                    Callback* callback = 0,
-                   unsigned long send_buffer_size = 4096)
+                   unsigned long send_buffer_size = 4096,
+                   bool brigade = false)
         throw(InvalidArg, Exception, El::Exception);
           
       virtual ~OutStreamBuf() throw();
@@ -123,6 +183,29 @@ namespace El
       int last_error() const throw();
       const std::string& last_error_desc() const throw(El::Exception);
 
+      // Can be switched only before writing started
+      void brigade(bool val) throw(Exception, El::Exception);
+      bool brigade() const throw() { return brigade_ != 0; }
+
+      bool write_shared(SharedBuffer* buffer, const char* data, size_t size)
+        throw(El::Exception);
+
+      virtual bool write_reference(const char* text, size_t size)
+        throw(El::Exception);
+      
+      virtual bool flush_references() throw(El::Exception);
+
+      const OutputStat& output_stat() const throw() { return output_stat_; }
+
+    protected:
+      void allocate_shared_buffer() throw(El::Exception);
+      bool emit_buffered() throw(El::Exception);
+      bool pass_brigade() throw(El::Exception);
+      void write_started() throw();
+      
+      void append_shared(SharedBuffer* buffer, const char* data, size_t size)
+        throw(El::Exception);
+      
     protected:
       request_rec* request_;
       Callback* callback_;
@@ -134,6 +217,12 @@ namespace El
 
       int last_error_;
       std::string last_error_desc_;
+
+      apr_bucket_brigade* brigade_;
+      size_t brigade_bytes_;
+      SharedBuffer_var send_shared_;
+      char* unsent_;
+      OutputStat output_stat_;
     };
 
     class OutStream :
@@ -142,7 +231,8 @@ namespace El
     public:
       OutStream(request_rec* r,
                 OutStreamBuf::Callback* callback = 0,
-                unsigned long send_buffer_size = 4096)
+                unsigned long send_buffer_size = 4096,
+                bool brigade = false)
         throw(InvalidArg, Exception, El::Exception);
 
       virtual ~OutStream() throw();
@@ -150,6 +240,13 @@ namespace El
       int last_error() const throw();
       const std::string& last_error_desc() const throw(El::Exception);
 
+      void brigade(bool val) throw(Exception, El::Exception);
+
+      bool write_shared(SharedBuffer* buffer, const char* data, size_t size)
+        throw(El::Exception);
+
+      const OutStreamBuf::OutputStat& output_stat() const throw();
+
     protected:
       typedef std::auto_ptr<OutStreamBuf> OutStreamBufPtr;
 
@@ -215,6 +312,41 @@ namespace El
       streambuf_->discard();
     }
     
+    //
+    // SharedBuffer class
+    //
+
+    inline
+    SharedBuffer::SharedBuffer(size_t size) throw(El::Exception)
+        : data_((char*)malloc(size)),
+          size_(size)
+    {
+      if(data_ == 0)
+      {
+        throw std::bad_alloc();
+      }
+    }
+
+    inline
+    SharedBuffer::~SharedBuffer() throw()
+    {
+      free(data_);
+    }
+
+    //
+    // OutStreamBuf::Callback struct
+    //
+
+    inline
+    void
+    OutStreamBuf::Callback::write_shared(SharedBuffer* buffer,
+                                         const char* data,
+                                         size_t size)
+      throw(El::Exception)
+    {
+      write(data, size);
+    }
+    
     //
     // OutStreamBuf class
     //
@@ -256,6 +388,41 @@ namespace El
       return streambuf_->last_error_desc();
     }
       
+    inline
+    void
+    OutStream::brigade(bool val) throw(Exception, El::Exception)
+    {
+      streambuf_->brigade(val);
+    }
+      
+    inline
+    bool
+    OutStream::write_shared(SharedBuffer* buffer,
+                            const char* data,
+                            size_t size)
+      throw(El::Exception)
+    {
+      if(!good())
+      {
+        return false;
+      }
+
+      if(!streambuf_->write_shared(buffer, data, size))
+      {
+        setstate(std::ios_base::badbit);
+        return false;
+      }
+
+      return true;
+    }
+      
+    inline
+    const OutStreamBuf::OutputStat&
+    OutStream::output_stat() const throw()
+    {
+      return streambuf_->output_stat();
+    }
+      
   }
 }
 
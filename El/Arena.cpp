@@ -0,0 +1,87 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Arena.cpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#include <new>
+
+#include "Arena.hpp"
+
+namespace El
+{
+  //
+  // Arena class
+  //
+  void*
+  Arena::allocate_slow(size_t size, size_t alignment) throw(El::Exception)
+  {
+    // Big requests get blocks of their own, so current block remains
+    // in use
+    bool dedicated = size + alignment > block_size_ / 4;
+    size_t block_size = dedicated ? sizeof(Block) + alignment + size :
+      block_size_;
+
+    Block* block = static_cast<Block*>(allocate_block(block_size));
+    block->size = block_size;
+
+    ++stat_.blocks;
+    stat_.block_bytes += block_size;
+
+    char* begin = reinterpret_cast<char*>(block + 1);
+
+    char* ptr = (char*)(((uintptr_t)begin + alignment - 1) &
+                        ~(uintptr_t)(alignment - 1));
+
+    if(dedicated && blocks_)
+    {
+      block->next = blocks_->next;
+      blocks_->next = block;
+      return ptr;
+    }
+
+    block->next = blocks_;
+    blocks_ = block;
+
+    if(!dedicated)
+    {
+      ptr_ = ptr + size;
+      end_ = reinterpret_cast<char*>(block) + block_size;
+    }
+
+    return ptr;
+  }
+
+  void
+  Arena::release() throw()
+  {
+    while(blocks_)
+    {
+      Block* next = blocks_->next;
+      free_block(blocks_, blocks_->size);
+      blocks_ = next;
+    }
+
+    ptr_ = 0;
+    end_ = 0;
+  }
+
+  void*
+  Arena::allocate_block(size_t size) throw(El::Exception)
+  {
+    return ::operator new(size);
+  }
+
+  void
+  Arena::free_block(void* block, size_t size) throw()
+  {
+    ::operator delete(block);
+  }
+}
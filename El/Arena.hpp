@@ -0,0 +1,323 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Arena.hpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#ifndef _ELEMENTS_EL_ARENA_HPP_
+#define _ELEMENTS_EL_ARENA_HPP_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <new>
+#include <limits>
+
+#include <El/Exception.hpp>
+
+namespace El
+{
+  //
+  // Monotonic allocator. Memory is cut sequentially from blocks taken from
+  // upstream and is only released all at once, when arena is released or
+  // destroyed; deallocation of individual objects is a no-op. Suits
+  // objects living no longer than some unit of work does, like
+  // HTTP request, which otherwise would make lots of small allocations
+  // contending in global heap. Not thread safe.
+  //
+  // By default blocks are allocated with operator new. Derived classes can
+  // take them from elsewhere overriding allocate_block and free_block;
+  // such classes should call release in their destructors as virtual
+  // functions are not dispatched to them from Arena destructor. Blocks
+  // should be aligned to ALIGNMENT; when upstream gives less aligned
+  // memory allocate_block should over-allocate and align it.
+  //
+  class Arena
+  {
+  public:
+    EL_EXCEPTION(Exception, El::ExceptionBase);
+
+    struct Stat
+    {
+      // Number of allocate calls and bytes requested with them
+      uint64_t allocations;
+      uint64_t bytes;
+
+      // Number of blocks taken from upstream and their total size
+      uint64_t blocks;
+      uint64_t block_bytes;
+
+      Stat() throw();
+    };
+
+    static const size_t ALIGNMENT = 2 * sizeof(void*);
+
+  public:
+    Arena(size_t block_size = 4096) throw();
+    virtual ~Arena() throw();
+
+    void* allocate(size_t size, size_t alignment = ALIGNMENT)
+      throw(El::Exception);
+
+    // Returns all blocks to upstream; objects allocated become invalid
+    void release() throw();
+
+    const Stat& stat() const throw();
+
+  protected:
+    virtual void* allocate_block(size_t size) throw(El::Exception);
+    virtual void free_block(void* block, size_t size) throw();
+
+  private:
+    struct Block
+    {
+      Block* next;
+      size_t size;
+    };
+
+    void* allocate_slow(size_t size, size_t alignment) throw(El::Exception);
+
+  private:
+    size_t block_size_;
+    Block* blocks_;
+    char* ptr_;
+    char* end_;
+    Stat stat_;
+
+  private:
+    Arena(const Arena&);
+    void operator=(const Arena&);
+  };
+
+  //
+  // STL allocator taking memory from arena; with no arena falls back to
+  // global heap, so default constructed containers behave as usual.
+  // Containers with arena allocator should not outlive the arena.
+  //
+  template<typename TYPE>
+  class ArenaAllocator
+  {
+  public:
+    typedef TYPE value_type;
+    typedef TYPE* pointer;
+    typedef const TYPE* const_pointer;
+    typedef TYPE& reference;
+    typedef const TYPE& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template<typename OTHER>
+    struct rebind
+    {
+      typedef ArenaAllocator<OTHER> other;
+    };
+
+  public:
+    ArenaAllocator(Arena* arena = 0) throw();
+
+    template<typename OTHER>
+    ArenaAllocator(const ArenaAllocator<OTHER>& src) throw();
+
+    pointer allocate(size_type count, const void* hint = 0)
+      throw(El::Exception);
+
+    void deallocate(pointer ptr, size_type count) throw();
+
+    void construct(pointer ptr, const TYPE& val) throw(El::Exception);
+    void destroy(pointer ptr) throw();
+
+    pointer address(reference val) const throw();
+    const_pointer address(const_reference val) const throw();
+
+    size_type max_size() const throw();
+
+    Arena* arena() const throw();
+
+  private:
+    Arena* arena_;
+  };
+
+  template<typename TYPE, typename OTHER>
+  bool operator==(const ArenaAllocator<TYPE>& a,
+                  const ArenaAllocator<OTHER>& b) throw();
+
+  template<typename TYPE, typename OTHER>
+  bool operator!=(const ArenaAllocator<TYPE>& a,
+                  const ArenaAllocator<OTHER>& b) throw();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Inlines
+///////////////////////////////////////////////////////////////////////////////
+
+namespace El
+{
+  //
+  // Arena::Stat struct
+  //
+  inline
+  Arena::Stat::Stat() throw()
+      : allocations(0),
+        bytes(0),
+        blocks(0),
+        block_bytes(0)
+  {
+  }
+
+  //
+  // Arena class
+  //
+  inline
+  Arena::Arena(size_t block_size) throw()
+      : block_size_(block_size < 256 ? 256 : block_size),
+        blocks_(0),
+        ptr_(0),
+        end_(0)
+  {
+  }
+
+  inline
+  Arena::~Arena() throw()
+  {
+    release();
+  }
+
+  inline
+  const Arena::Stat&
+  Arena::stat() const throw()
+  {
+    return stat_;
+  }
+
+  inline
+  void*
+  Arena::allocate(size_t size, size_t alignment) throw(El::Exception)
+  {
+    ++stat_.allocations;
+    stat_.bytes += size;
+
+    char* ptr = (char*)(((uintptr_t)ptr_ + alignment - 1) &
+                        ~(uintptr_t)(alignment - 1));
+
+    // Rounding up can move ptr past the end of block which is not
+    // aligned as much as requested
+    if(ptr_ && ptr <= end_ && size <= (size_t)(end_ - ptr))
+    {
+      ptr_ = ptr + size;
+      return ptr;
+    }
+
+    return allocate_slow(size, alignment);
+  }
+
+  //
+  // ArenaAllocator class
+  //
+  template<typename TYPE>
+  ArenaAllocator<TYPE>::ArenaAllocator(Arena* arena) throw()
+      : arena_(arena)
+  {
+  }
+
+  template<typename TYPE>
+  template<typename OTHER>
+  ArenaAllocator<TYPE>::ArenaAllocator(const ArenaAllocator<OTHER>& src)
+    throw()
+      : arena_(src.arena())
+  {
+  }
+
+  template<typename TYPE>
+  typename ArenaAllocator<TYPE>::pointer
+  ArenaAllocator<TYPE>::allocate(size_type count, const void* hint)
+    throw(El::Exception)
+  {
+    if(count > max_size())
+    {
+      throw std::bad_alloc();
+    }
+
+    size_t size = count * sizeof(TYPE);
+
+    return static_cast<pointer>(
+      arena_ ? arena_->allocate(size) : ::operator new(size));
+  }
+
+  template<typename TYPE>
+  void
+  ArenaAllocator<TYPE>::deallocate(pointer ptr, size_type count) throw()
+  {
+    if(arena_ == 0)
+    {
+      ::operator delete(ptr);
+    }
+  }
+
+  template<typename TYPE>
+  void
+  ArenaAllocator<TYPE>::construct(pointer ptr, const TYPE& val)
+    throw(El::Exception)
+  {
+    new(ptr) TYPE(val);
+  }
+
+  template<typename TYPE>
+  void
+  ArenaAllocator<TYPE>::destroy(pointer ptr) throw()
+  {
+    ptr->~TYPE();
+  }
+
+  template<typename TYPE>
+  typename ArenaAllocator<TYPE>::pointer
+  ArenaAllocator<TYPE>::address(reference val) const throw()
+  {
+    return &val;
+  }
+
+  template<typename TYPE>
+  typename ArenaAllocator<TYPE>::const_pointer
+  ArenaAllocator<TYPE>::address(const_reference val) const throw()
+  {
+    return &val;
+  }
+
+  template<typename TYPE>
+  typename ArenaAllocator<TYPE>::size_type
+  ArenaAllocator<TYPE>::max_size() const throw()
+  {
+    return std::numeric_limits<size_type>::max() / sizeof(TYPE);
+  }
+
+  template<typename TYPE>
+  Arena*
+  ArenaAllocator<TYPE>::arena() const throw()
+  {
+    return arena_;
+  }
+
+  template<typename TYPE, typename OTHER>
+  bool
+  operator==(const ArenaAllocator<TYPE>& a,
+             const ArenaAllocator<OTHER>& b) throw()
+  {
+    return a.arena() == b.arena();
+  }
+
+  template<typename TYPE, typename OTHER>
+  bool
+  operator!=(const ArenaAllocator<TYPE>& a,
+             const ArenaAllocator<OTHER>& b) throw()
+  {
+    return a.arena() != b.arena();
+  }
+}
+
+#endif // _ELEMENTS_EL_ARENA_HPP_
@@ -16,9 +16,21 @@
 #include <El/Exception.hpp>
 #include <El/RefCount/All.hpp>
 #include <El/CRC.hpp>
+#include <El/Metrics.hpp>
 
 #include "ObjectCache.hpp"
 
+namespace
+{
+  El::Metrics::Counter cache_hits(
+    "el_cache_hits_total",
+    "Objects returned by file caches without loading");
+
+  El::Metrics::Histogram cache_load_time(
+    "el_cache_load_seconds",
+    "Time file cache objects are loaded");
+}
+
 namespace El
 {
   namespace Cache
@@ -63,6 +75,8 @@ namespace El
       WriteGuard_ guard(lock_i());
       container_guard.release();
 
+      El::Metrics::Timing timing(cache_load_time);
+
       state_ = OS_LOADING;
       loading_error_.clear();
       reviewed_ = ACE_OS::gettimeofday();
@@ -158,6 +172,12 @@ namespace El
       object_ = El::RefCount::add_ref(object);
       return  El::RefCount::add_ref(object_.in());
     }
+
+    void
+    ObjectHolder::hit() throw(El::Exception)
+    {
+      cache_hits.increment();
+    }
     
   }
 }
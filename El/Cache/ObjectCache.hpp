@@ -21,14 +21,13 @@
 #include <string>
 #include <sstream>
 
-#include <ext/hash_map>
-
 #include <ace/OS.h>
 #include <ace/Synch.h>
 #include <ace/Guard_T.h>
 
 #include <El/Exception.hpp>
 #include <El/Hash/Hash.hpp>
+#include <El/Hash/FlatMap.hpp>
 #include <El/RefCount/All.hpp>
 #include <El/SyncPolicy.hpp>
 
@@ -108,6 +107,9 @@ namespace El
                    ContainerGuard& container_guard)
         throw(NotFound, Exception, El::Exception);
 
+      // Counts object returned by a cache without being loaded
+      static void hit() throw(El::Exception);
+
     protected:
 
       enum ObjectState
@@ -159,9 +161,9 @@ namespace El
 
       mutable Mutex lock_;
 
-      typedef __gnu_cxx::hash_map<std::string,
-                                  ObjectHolder_var,
-                                  El::Hash::String>
+      typedef El::Hash::FlatMap<std::string,
+                                ObjectHolder_var,
+                                El::Hash::String>
       ObjectMap;
 
       ObjectMap objects_;
@@ -445,6 +447,7 @@ namespace El
             guard.release();
 
             Object_var object = holder->object();
+            ObjectHolder::hit();
             return downcast(object.in());
           }
 
@@ -458,6 +461,7 @@ namespace El
 
             if(!object->is_modified())
             {
+              ObjectHolder::hit();
               return downcast(object.in());
             }
           }
@@ -481,6 +485,7 @@ namespace El
 
           if(!object->is_modified())
           {
+            ObjectHolder::hit();
             return downcast(object.in());
           }
         }
@@ -30,7 +30,10 @@ namespace El
       GZip::GZip(OutStreamCallback* callback,
                  int level,
                  size_t in_buffer_size,
-                 size_t out_buffer_size)
+                 size_t out_buffer_size,
+                 size_t threads,
+                 size_t block_size,
+                 El::Service::ThreadPool* pool)
         throw(InvalidArg, Exception, El::Exception)
           : callback_(callback),
             stream_(callback,
@@ -38,7 +41,10 @@ namespace El
                     in_buffer_size,
                     out_buffer_size,
                     true,
-                    true),
+                    true,
+                    threads,
+                    block_size,
+                    pool),
             finalized_(false)
       {
 //        char S = 0;
@@ -236,6 +242,11 @@ namespace El
             throw Exception(
               "El::Compress::ZLib::GUnzip::read_till: failed to read  1 byte");
           }
+
+          if(buff == chr)
+          {
+            break;
+          }
         }
       }
       
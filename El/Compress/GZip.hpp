@@ -39,7 +39,10 @@ namespace El
         GZip(OutStreamCallback* callback,
              int level = Z_DEFAULT_COMPRESSION,
              size_t in_buffer_size = 4096,
-             size_t out_buffer_size = 4096)
+             size_t out_buffer_size = 4096,
+             size_t threads = 1,
+             size_t block_size = OutStreamBuf::DEFAULT_BLOCK_SIZE,
+             El::Service::ThreadPool* pool = 0)
           throw(InvalidArg, Exception, El::Exception);
 
         OutStream& stream() throw() { return stream_; }
@@ -15,9 +15,15 @@
 
 #include <iostream>
 #include <sstream>
+#include <vector>
+#include <deque>
 
 #include <ace/OS.h>
 #include <ace/High_Res_Timer.h>
+#include <ace/Synch.h>
+#include <ace/Guard_T.h>
+
+#include <El/Service/ThreadPool.hpp>
 
 #include "ZLib.hpp"
 
@@ -27,6 +33,320 @@ namespace El
   {
     namespace ZLib
     {
+      //
+      // OutStreamBuf::Block class
+      //
+      class OutStreamBuf::Block : public El::Service::ThreadPool::TaskBase
+      {
+      public:
+        Block(Parallel* owner_val,
+              int level_val,
+              int flush_val,
+              bool calc_crc_val,
+              bool calc_adler_val)
+          throw(El::Exception);
+
+        virtual ~Block() throw() {}
+
+        virtual void execute() throw(El::Exception);
+
+      public:
+        Parallel* owner;
+        int level;
+        int flush;
+        bool calc_crc;
+        bool calc_adler;
+
+        std::vector<char> input;
+        size_t input_size;
+        std::string dictionary;
+
+        std::vector<char> output;
+        size_t output_size;
+
+        uLong crc;
+        uLong adler;
+        ACE_Time_Value compression_time;
+        std::string error;
+        bool done;
+      };
+
+      //
+      // OutStreamBuf::Parallel class
+      //
+      class OutStreamBuf::Parallel : public El::Service::Callback
+      {
+      public:
+        Parallel(size_t threads,
+                 size_t block_size,
+                 El::Service::ThreadPool* pool_val)
+          throw(Exception, El::Exception);
+
+        virtual ~Parallel() throw();
+
+        virtual bool notify(El::Service::Event* event) throw(El::Exception);
+
+        void completed(Block* block) throw();
+        void wait(Block* block) throw();
+
+        std::vector<char>& next_buffer() throw(El::Exception);
+
+      public:
+        typedef std::deque<Block_var> BlockQueue;
+
+        typedef ACE_Thread_Mutex Mutex;
+        typedef ACE_Guard<Mutex> Guard;
+        typedef ACE_Condition<Mutex> Condition;
+
+        size_t block_size;
+        size_t max_pending;
+
+        El::Service::ThreadPool_var pool;
+        bool own_pool;
+
+        Mutex lock;
+        Condition block_done;
+        std::string pool_error;
+
+        BlockQueue blocks;
+
+        std::vector<char> buffer;
+        std::vector<char> spare;
+        std::string window;
+
+        bool header_written;
+        uLong adler;
+      };
+
+      OutStreamBuf::Block::Block(Parallel* owner_val,
+                                 int level_val,
+                                 int flush_val,
+                                 bool calc_crc_val,
+                                 bool calc_adler_val)
+        throw(El::Exception)
+          : El::Service::ThreadPool::TaskBase(true),
+            owner(owner_val),
+            level(level_val),
+            flush(flush_val),
+            calc_crc(calc_crc_val),
+            calc_adler(calc_adler_val),
+            input_size(0),
+            output_size(0),
+            crc(0),
+            adler(0),
+            done(false)
+      {
+      }
+
+      void
+      OutStreamBuf::Block::execute() throw(El::Exception)
+      {
+        ACE_High_Res_Timer timer;
+        timer.start();
+        
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+
+        stream.zalloc = Z_NULL;
+        stream.zfree = Z_NULL;
+        stream.opaque = Z_NULL;
+
+        int ret = deflateInit2(&stream,
+                               level,
+                               Z_DEFLATED,
+                               -15,
+                               9,
+                               Z_DEFAULT_STRATEGY);
+
+        if(ret == Z_OK && !dictionary.empty())
+        {
+          ret = deflateSetDictionary(&stream,
+                                     (const Bytef*)dictionary.c_str(),
+                                     dictionary.size());
+        }
+
+        if(ret == Z_OK)
+        {
+          try
+          {
+            output.resize(deflateBound(&stream, input_size) + 16);
+
+            stream.next_in = (unsigned char*)(input_size ? &input[0] : 0);
+            stream.avail_in = input_size;
+          
+            while(true)
+            {
+              stream.next_out = (unsigned char*)&output[output_size];
+              stream.avail_out = output.size() - output_size;
+
+              ret = ::deflate(&stream, flush);
+
+              output_size = output.size() - stream.avail_out;
+
+              if(ret == Z_STREAM_END ||
+                 (flush != Z_FINISH && ret == Z_OK && stream.avail_out))
+              {
+                ret = Z_OK;
+                break;
+              }
+
+              if(ret != Z_OK && ret != Z_BUF_ERROR)
+              {
+                break;
+              }
+
+              output.resize(output.size() * 2);
+            }
+          }
+          catch(const std::bad_alloc&)
+          {
+            // Reported with the block as the pool may be not the own one
+            ret = Z_MEM_ERROR;
+          }
+        }
+
+        deflateEnd(&stream);
+
+        if(ret == Z_OK)
+        {
+          if(calc_crc)
+          {
+            crc = crc32(crc32(0L, Z_NULL, 0),
+                        (const Bytef*)(input_size ? &input[0] : 0),
+                        input_size);
+          }
+
+          if(calc_adler)
+          {
+            adler = adler32(adler32(0L, Z_NULL, 0),
+                            (const Bytef*)(input_size ? &input[0] : 0),
+                            input_size);
+          }
+        }
+        else
+        {
+          std::ostringstream ostr;
+          ostr << "El::Compress::ZLib::OutStreamBuf::Block::execute: "
+            "deflate failed with code " << ret;
+
+          error = ostr.str();
+        }
+
+        timer.stop();
+        timer.elapsed_time(compression_time);
+        
+        owner->completed(this);
+      }
+
+      OutStreamBuf::Parallel::Parallel(size_t threads,
+                                       size_t block_size_val,
+                                       El::Service::ThreadPool* pool_val)
+        throw(Exception, El::Exception)
+          : block_size(block_size_val),
+            max_pending(threads * 2),
+            pool(El::RefCount::add_ref(pool_val)),
+            own_pool(pool_val == 0),
+            block_done(lock),
+            buffer(block_size_val),
+            header_written(false),
+            adler(adler32(0L, Z_NULL, 0))
+      {
+        if(own_pool)
+        {
+          pool = new El::Service::ThreadPool(this, "ZLibDeflater", threads);
+          pool->start();
+        }
+      }
+
+      OutStreamBuf::Parallel::~Parallel() throw()
+      {
+        if(own_pool)
+        {
+          try
+          {
+            pool->stop();
+            pool->wait();
+          }
+          catch(...)
+          {
+          }
+        }
+        else
+        {
+          //
+          // Blocks still queued to shared pool refer to this object and
+          // are executed anyway, so waited for regardless of pool_error
+          //
+          Guard guard(lock);
+          
+          for(BlockQueue::iterator i(blocks.begin()), e(blocks.end());
+              i != e; ++i)
+          {
+            while(!(*i)->done)
+            {
+              block_done.wait();
+            }
+          }
+        }
+
+        blocks.clear();
+        pool = 0;
+      }
+
+      bool
+      OutStreamBuf::Parallel::notify(El::Service::Event* event)
+        throw(El::Exception)
+      {
+        El::Service::Error* error =
+          dynamic_cast<El::Service::Error*>(event);
+
+        if(error)
+        {
+          Guard guard(lock);
+
+          if(pool_error.empty())
+          {
+            pool_error = error->description;
+          }
+
+          block_done.broadcast();
+        }
+
+        return true;
+      }
+
+      void
+      OutStreamBuf::Parallel::completed(Block* block) throw()
+      {
+        Guard guard(lock);
+        block->done = true;
+        block_done.broadcast();
+      }
+
+      void
+      OutStreamBuf::Parallel::wait(Block* block) throw()
+      {
+        Guard guard(lock);
+
+        while(!block->done && pool_error.empty())
+        {
+          block_done.wait();
+        }
+      }
+
+      std::vector<char>&
+      OutStreamBuf::Parallel::next_buffer() throw(El::Exception)
+      {
+        buffer.swap(spare);
+
+        if(buffer.size() < block_size)
+        {
+          buffer.resize(block_size);
+        }
+
+        return buffer;
+      }
+      
       //
       // OutStreamBuf class
       //
@@ -35,7 +355,10 @@ namespace El
                                  size_t in_buffer_size,
                                  size_t out_buffer_size,
                                  bool raw_deflate,
-                                 bool calc_crc)
+                                 bool calc_crc,
+                                 size_t threads,
+                                 size_t block_size,
+                                 El::Service::ThreadPool* pool)
         throw(InvalidArg, Exception, El::Exception)
           : callback_(callback),
             in_buffer_size_(in_buffer_size),
@@ -49,7 +372,12 @@ namespace El
             calc_crc_(calc_crc),
             last_error_(0),
             deflate_initialized_(false),
-            finalized_(false)
+            finalized_(false),
+            level_(level),
+            raw_deflate_(raw_deflate),
+            threads_(threads ? threads : 1),
+            block_size_(block_size),
+            parallel_(0)
       {
         if(in_buffer_size < 15 || out_buffer_size < 15)
         {
@@ -66,6 +394,39 @@ namespace El
                            "callback is 0");
         }
         
+        if(calc_crc_)
+        {
+          in_crc_ = crc32(0L, Z_NULL, 0);
+        }
+
+        if(threads_ > 1)
+        {
+          if(block_size < DICTIONARY_SIZE)
+          {
+            std::ostringstream ostr;
+            ostr << "El::Compress::ZLib::OutStreamBuf::OutStreamBuf: "
+              "block size should not be less than " << DICTIONARY_SIZE;
+            
+            throw InvalidArg(ostr.str());
+          }
+
+          if(level < Z_DEFAULT_COMPRESSION || level > Z_BEST_COMPRESSION)
+          {
+            std::ostringstream ostr;
+            ostr << "El::Compress::ZLib::OutStreamBuf::OutStreamBuf: "
+              "invalid compression level " << level;
+            
+            throw InvalidArg(ostr.str());
+          }
+
+          parallel_ = new Parallel(threads_, block_size_, pool);
+          
+          char* buff = &parallel_->buffer[0];
+          setp(buff, buff + block_size_);
+          
+          return;
+        }
+        
         memset(&z_stream_, 0, sizeof(z_stream_));
 
         z_stream_.zalloc = Z_NULL;
@@ -98,11 +459,32 @@ namespace El
         }
 
         deflate_initialized_ = true;
+      }
 
-        if(calc_crc_)
+      OutStreamBuf::~OutStreamBuf() throw()
+      {
+//        std::cerr << "OutStreamBuf::~OutStreamBuf()\n";
+
+        if(deflate_initialized_ || parallel_)
         {
-          in_crc_ = crc32(0L, Z_NULL, 0);
+          try
+          {
+            finalize();
+          }
+          catch(...)
+          {
+            // can do nothing here
+          }
         }
+
+        if(deflate_initialized_)
+        {
+          deflateEnd(&z_stream_);
+        }
+
+        delete parallel_;
+        delete [] in_buffer_;
+        delete [] out_buffer_;        
       }
 
       int
@@ -148,6 +530,11 @@ namespace El
           
           return traits_type::eof();          
         }
+
+        if(parallel_)
+        {
+          return parallel_overflow(c);
+        }
         
         if(pptr() == 0)
         {
@@ -255,6 +642,11 @@ namespace El
           
           return -1;
         }
+
+        if(parallel_)
+        {
+          return parallel_sync();
+        }
         
         push_write_pending();
 
@@ -308,6 +700,11 @@ namespace El
       int
       OutStreamBuf::flush_zlib(bool finish) throw(El::Exception)
       {
+        if(parallel_)
+        {
+          return parallel_flush(finish);
+        }
+        
         z_stream_.next_in = (unsigned char*)in_buffer_;
         z_stream_.avail_in = 0;
 
@@ -397,6 +794,252 @@ namespace El
         return 0;
       }
       
+      OutStreamBuf::int_type
+      OutStreamBuf::parallel_overflow(int_type c) throw(El::Exception)
+      {
+        if(!submit_block(false))
+        {
+          return traits_type::eof();
+        }
+
+        if(traits_type::eq_int_type(c, traits_type::eof()))
+        {
+          return traits_type::not_eof(c);
+        }
+
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+
+        return c;
+      }
+
+      int
+      OutStreamBuf::parallel_sync() throw(El::Exception)
+      {
+        return submit_block(false) && write_blocks(true) ? 0 : -1;
+      }
+
+      int
+      OutStreamBuf::parallel_flush(bool finish) throw(El::Exception)
+      {
+        if(!finish)
+        {
+          return parallel_sync();
+        }
+        
+        if(!last_error_desc_.empty() || !submit_block(true) ||
+           !write_blocks(true))
+        {
+          return -1;
+        }
+
+        if(!raw_deflate_)
+        {
+          unsigned char trailer[4];
+          uLong adler = parallel_->adler;
+          
+          trailer[0] = (adler >> 24) & 0xFF;
+          trailer[1] = (adler >> 16) & 0xFF;
+          trailer[2] = (adler >> 8) & 0xFF;
+          trailer[3] = adler & 0xFF;
+
+          if(!write_out((const char*)trailer, sizeof(trailer)))
+          {
+            return -1;
+          }
+        }
+
+        return 0;
+      }
+
+      bool
+      OutStreamBuf::submit_block(bool finish) throw(El::Exception)
+      {
+        size_t size = pptr() - pbase();
+
+        if(size == 0 && !finish)
+        {
+          return true;
+        }
+
+        Parallel& parallel = *parallel_;
+        
+        Block_var block = new Block(parallel_,
+                                    level_,
+                                    finish ? Z_FINISH : Z_SYNC_FLUSH,
+                                    calc_crc_,
+                                    !raw_deflate_);
+
+        block->input.swap(parallel.buffer);
+        block->input_size = size;
+        block->dictionary = parallel.window;
+
+        //
+        // Sliding window of last DICTIONARY_SIZE bytes priming the next
+        // block so it can refer back into data deflated by this one.
+        //
+        if(size >= DICTIONARY_SIZE)
+        {
+          parallel.window.assign(&block->input[size - DICTIONARY_SIZE],
+                                 DICTIONARY_SIZE);
+        }
+        else if(size)
+        {
+          parallel.window.append(&block->input[0], size);
+
+          if(parallel.window.size() > DICTIONARY_SIZE)
+          {
+            parallel.window.erase(
+              0,
+              parallel.window.size() - DICTIONARY_SIZE);
+          }
+        }
+
+        char* buff = &parallel.next_buffer()[0];
+        setp(buff, buff + block_size_);
+
+        parallel.blocks.push_back(block);
+        parallel.pool->execute(block.in());
+
+        return write_blocks(false);
+      }
+
+      bool
+      OutStreamBuf::write_blocks(bool wait_all) throw(El::Exception)
+      {
+        Parallel& parallel = *parallel_;
+        
+        while(!parallel.blocks.empty())
+        {
+          Block_var block = parallel.blocks.front();
+
+          bool wait = wait_all ||
+            parallel.blocks.size() >= parallel.max_pending;
+
+          if(wait)
+          {
+            parallel.wait(block.in());
+          }
+
+          {
+            Parallel::Guard guard(parallel.lock);
+
+            if(!parallel.pool_error.empty())
+            {
+              last_error_desc_ = parallel.pool_error;
+              return false;
+            }
+
+            if(!block->done)
+            {
+              break;
+            }
+          }
+
+          parallel.blocks.pop_front();
+
+          if(!write_block(block.in()))
+          {
+            return false;
+          }
+        }
+
+        return true;
+      }
+
+      bool
+      OutStreamBuf::write_block(Block* block) throw(El::Exception)
+      {
+        if(!block->error.empty())
+        {
+          last_error_desc_ = block->error;
+          last_error_ = Z_STREAM_ERROR;
+          return false;
+        }
+
+        Parallel& parallel = *parallel_;
+        
+        if(!raw_deflate_ && !parallel.header_written)
+        {
+          //
+          // zlib header as deflateInit would produce it for the level
+          //
+          unsigned int level_flags = level_ == Z_DEFAULT_COMPRESSION ? 2 :
+            (level_ < 2 ? 0 : (level_ < 6 ? 1 : (level_ == 6 ? 2 : 3)));
+          
+          unsigned int header = (0x78 << 8) | (level_flags << 6);
+          header += 31 - (header % 31);
+
+          unsigned char buff[2];
+          buff[0] = header >> 8;
+          buff[1] = header & 0xFF;
+
+          if(!write_out((const char*)buff, sizeof(buff)))
+          {
+            return false;
+          }
+
+          parallel.header_written = true;
+        }
+
+        if(!write_out(block->output_size ? &block->output[0] : 0,
+                      block->output_size))
+        {
+          return false;
+        }
+
+        if(calc_crc_)
+        {
+          in_crc_ = crc32_combine(in_crc_, block->crc, block->input_size);
+        }
+
+        if(!raw_deflate_)
+        {
+          parallel.adler =
+            adler32_combine(parallel.adler, block->adler, block->input_size);
+        }
+
+        in_bytes_ += block->input_size;
+        compression_time_ += block->compression_time;
+
+        //
+        // Recycling input buffer for further blocks
+        //
+        if(block->input.size() == block_size_)
+        {
+          parallel.spare.swap(block->input);
+        }
+
+        return true;
+      }
+
+      bool
+      OutStreamBuf::write_out(const char* buff, size_t len)
+        throw(El::Exception)
+      {
+        while(len)
+        {
+          size_t written_bytes = callback_->write(buff, len);
+
+          if(!written_bytes)
+          {
+            std::ostringstream ostr;
+            ostr << "El::Compress::ZLib::OutStreamBuf::write_out: "
+              "can't push out deflated data; bytes in " << in_bytes_
+                 << ", out " << out_bytes_;
+            
+            last_error_desc_ = ostr.str();
+            return false;
+          }
+
+          buff += written_bytes;
+          len -= written_bytes;
+          out_bytes_ += written_bytes;
+        }
+
+        return true;
+      }
+      
       //
       // InStreamBuf class
       //
@@ -608,7 +1251,10 @@ namespace El
                            size_t in_buffer_size,
                            size_t out_buffer_size,
                            bool raw_deflate,
-                           bool calc_crc)
+                           bool calc_crc,
+                           size_t threads,
+                           size_t block_size,
+                           El::Service::ThreadPool* pool)
         throw(InvalidArg, Exception, El::Exception)
           : std::basic_ostream<char, std::char_traits<char> >(0)
       {
@@ -617,7 +1263,10 @@ namespace El
                                           in_buffer_size,
                                           out_buffer_size,
                                           raw_deflate,
-                                          calc_crc));
+                                          calc_crc,
+                                          threads,
+                                          block_size,
+                                          pool));
         init(streambuf_.get());
       }
 
@@ -24,9 +24,15 @@
 #include <ace/OS.h>
 
 #include <El/Exception.hpp>
+#include <El/RefCount/All.hpp>
 
 namespace El
 {
+  namespace Service
+  {
+    class ThreadPool;
+  }
+  
   namespace Compress
   {
     namespace ZLib
@@ -53,12 +59,29 @@ namespace El
         : public std::basic_streambuf<char, std::char_traits<char> >
       {        
       public:
+        static const size_t DEFAULT_BLOCK_SIZE = 128 * 1024;
+        static const size_t DICTIONARY_SIZE = 32 * 1024;
+        
+      public:
+        //
+        // If threads > 1 input is cut into block_size blocks which are
+        // deflated concurrently, each primed with the last 32K of input
+        // preceding it, and concatenated into a single stream
+        // (pigz-style); in_buffer_size and out_buffer_size are not used
+        // then. sync() waits for all blocks in progress to be written.
+        // Blocks are deflated by the pool provided, which should run until
+        // the stream is destroyed, so streams can share one; if pool is 0
+        // the stream starts its own one of threads threads.
+        //
         OutStreamBuf(OutStreamCallback* callback,
                      int level = Z_DEFAULT_COMPRESSION,
                      size_t in_buffer_size = 1024,
                      size_t out_buffer_size = 1024,
                      bool raw_deflate = false, // zlib deflate if false
-                     bool calc_crc = false)
+                     bool calc_crc = false,
+                     size_t threads = 1,
+                     size_t block_size = DEFAULT_BLOCK_SIZE,
+                     El::Service::ThreadPool* pool = 0)
           throw(InvalidArg, Exception, El::Exception);
           
         virtual ~OutStreamBuf() throw();
@@ -70,6 +93,9 @@ namespace El
         unsigned long long out_bytes() const throw();
         size_t in_crc() const throw();
 
+        size_t threads() const throw();
+        size_t block_size() const throw();
+
         const ACE_Time_Value& compression_time() const throw();
         
         int last_error() throw();
@@ -83,6 +109,20 @@ namespace El
         bool push_write_pending() throw(El::Exception);
         int deflate(int flush) throw();
 
+        class Block;
+        typedef El::RefCount::SmartPtr<Block> Block_var;
+
+        class Parallel;
+
+        int_type parallel_overflow(int_type c) throw(El::Exception);
+        int parallel_sync() throw(El::Exception);
+        int parallel_flush(bool finish) throw(El::Exception);
+
+        bool submit_block(bool finish) throw(El::Exception);
+        bool write_blocks(bool wait_all) throw(El::Exception);
+        bool write_block(Block* block) throw(El::Exception);
+        bool write_out(const char* buff, size_t len) throw(El::Exception);
+
       protected:
         z_stream z_stream_;
         
@@ -107,6 +147,12 @@ namespace El
 
         bool deflate_initialized_;
         bool finalized_;
+
+        int level_;
+        bool raw_deflate_;
+        size_t threads_;
+        size_t block_size_;
+        Parallel* parallel_;
       };
 
       class InStreamBuf
@@ -178,7 +224,10 @@ namespace El
                   size_t in_buffer_size = 1024,
                   size_t out_buffer_size = 1024,
                   bool raw_deflate = false,
-                  bool calc_crc = false)
+                  bool calc_crc = false,
+                  size_t threads = 1,
+                  size_t block_size = OutStreamBuf::DEFAULT_BLOCK_SIZE,
+                  El::Service::ThreadPool* pool = 0)
           throw(InvalidArg, Exception, El::Exception);
 
         virtual ~OutStream() throw();
@@ -275,29 +324,6 @@ namespace El
       //
       // OutStreamBuf class
       //
-      inline
-      OutStreamBuf::~OutStreamBuf() throw()
-      {
-//        std::cerr << "OutStreamBuf::~OutStreamBuf()\n";
-
-        if(deflate_initialized_)
-        {
-          try
-          {
-            finalize();
-          }
-          catch(...)
-          {
-            // can do nothing here
-          }
-          
-          deflateEnd(&z_stream_);
-        }
-
-        delete [] in_buffer_;
-        delete [] out_buffer_;        
-      }
-  
       inline
       unsigned long long
       OutStreamBuf::in_bytes() const throw()
@@ -366,7 +392,7 @@ namespace El
       void
       OutStreamBuf::finalize() throw(El::Exception)
       {
-        if(deflate_initialized_ && !finalized_)
+        if((deflate_initialized_ || parallel_) && !finalized_)
         {
           try
           {
@@ -398,6 +424,20 @@ namespace El
         return in_crc_;
       }
 
+      inline
+      size_t
+      OutStreamBuf::threads() const throw()
+      {
+        return threads_;
+      }
+
+      inline
+      size_t
+      OutStreamBuf::block_size() const throw()
+      {
+        return block_size_;
+      }
+
       //
       // InStreamBuf class
       //
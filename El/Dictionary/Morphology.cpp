@@ -21,9 +21,16 @@
 #include <ext/hash_set>
 #include <google/sparse_hash_set>
 
+#include <ace/OS.h>
+#include <ace/Synch.h>
+#include <ace/Guard_T.h>
+
 #include <El/String/Manip.hpp>
 #include <El/String/ListParser.hpp>
 #include <El/CRC.hpp>
+#include <El/Moment.hpp>
+#include <El/Compress/GZip.hpp>
+#include <El/Service/ThreadPool.hpp>
 
 #include <El/Dictionary/LangDetection.hpp>
 
@@ -135,240 +142,1284 @@ namespace El
       };
       
       //
-      // WordInfoMap class
+      // Dictionary file contents; first line is a header, records follow
+      // one per line
       //
+      struct DictionaryText
+      {
+        std::string file_name;
+        std::vector<char> data;
+        size_t records_offset;
+
+        std::string lang_s;
+        El::Lang lang;
+        unsigned long records;
+        unsigned long params[2];
+        unsigned long id_base;
+        unsigned long id_upper_boundry;
+
+        DictionaryText() throw(El::Exception);
+
+        //
+        // Reads file and parses header of lang, records and param_count
+        // params; if file is missing, reads its .gz version.
+        // context prefixes error descriptions.
+        //
+        void read(const char* file,
+                  size_t param_count,
+                  const char* context)
+          throw(InvalidArg, Exception, El::Exception);
+
+        // Splits records into count ranges of whole lines
+        template<typename RANGE>
+        void split(size_t count, std::vector<RANGE>& ranges) const
+          throw(El::Exception);
+
+        void release() throw();
+
+      private:
+        void read(std::istream& istr) throw(El::Exception);
+      };
+
+      DictionaryText::DictionaryText() throw(El::Exception)
+          : records_offset(0),
+            records(0),
+            id_base(0),
+            id_upper_boundry(0)
+      {
+        params[0] = 0;
+        params[1] = 0;
+      }
+
       void
-      WordNormalFormsMap::load(const char* dict_file,
-                               const char* stop_words_file,
-                               std::ostream* warnings_stream)
+      DictionaryText::read(const char* file,
+                           size_t param_count,
+                           const char* context)
         throw(InvalidArg, Exception, El::Exception)
       {
-        clear();
-        buff_.reset(0);
-        norm_form_ids_.clear();
-        
-        lang_ = El::Lang::EC_NUL;
-        hash_ = 0;
-        
-        std::fstream file(dict_file, std::ios::in);
+        file_name = file;
+        data.clear();
 
-        if(!file.is_open())
+        std::fstream istr(file, std::ios::in);
+
+        if(istr.is_open())
         {
-          std::ostringstream ostr;
-          ostr << "El::Dictionary::Morphology::WordNormalFormsMap::load: "
-            "failed to open file " << dict_file;
+          read(istr);
+        }
+        else
+        {
+          std::string gz_file = file_name + ".gz";
+          std::fstream gz_istr(gz_file.c_str(),
+                               std::ios::in | std::ios::binary);
+
+          if(!gz_istr.is_open())
+          {
+            std::ostringstream ostr;
+            ostr << context << ": failed to open file " << file;
+            throw InvalidArg(ostr.str());
+          }
+
+          std::string error;
+
+          try
+          {
+            El::Compress::ZLib::InputStreamReader reader(gz_istr);
+            El::Compress::ZLib::GUnzip gunzip(&reader, 65536, 262144);
+
+            read(gunzip.stream());
+
+            if(gunzip.stream().last_error())
+            {
+              error = gunzip.stream().last_error_desc();
+            }
+          }
+          catch(const El::Compress::ZLib::InvalidArg& e)
+          {
+            error = e.what();
+          }
+          catch(const El::Compress::ZLib::Exception& e)
+          {
+            error = e.what();
+          }
+
+          if(!error.empty())
+          {
+            std::ostringstream ostr;
+            ostr << context << ": failed to decompress file " << gz_file
+                 << ". Reason: " << error;
 
-          throw InvalidArg(ostr.str());          
+            throw InvalidArg(ostr.str());
+          }
         }
 
-        uint32_t records = 0;
-        uint32_t buff_size = 0;
-        uint32_t norm_forms_count = 0;
-        std::string lang_s;
+        const char* begin = data.empty() ? 0 : &data[0];
 
-        file >> lang_s >> records >> buff_size >> norm_forms_count;
+        const char* eol =
+          (const char*)memchr(begin, '\n', data.size());
 
-        El::CRC(hash_, (const unsigned char*)lang_s.c_str(), lang_s.length());
-        El::CRC(hash_, (const unsigned char*)&records, sizeof(records));
-        El::CRC(hash_, (const unsigned char*)&buff_size, sizeof(buff_size));
-        
-        El::CRC(hash_,
-                (const unsigned char*)&norm_forms_count,
-                sizeof(norm_forms_count));
+        std::istringstream header(
+          std::string(begin, eol ? eol : begin + data.size()));
+
+        header >> lang_s >> records;
+
+        for(size_t i = 0; i < param_count; ++i)
+        {
+          header >> params[i];
+        }
+
+        // Header not terminated with new line is as broken as
+        // incomplete one
+        bool header_failed = header.fail() || eol == 0;
+        records_offset = eol ? eol - begin + 1 : data.size();
 
         try
         {
-          lang_ = El::Lang(lang_s.c_str());
+          lang = El::Lang(lang_s.c_str());
         }
         catch(const El::Lang::InvalidArg& e)
         {
           std::ostringstream ostr;
-          ostr << "El::Dictionary::Morphology::WordNormalFormsMap::load: "
-            "can't process language " << lang_s << ". Reason: " << e;
+          ostr << context << ": can't process language " << lang_s
+               << ". Reason: " << e;
+
+          throw InvalidArg(ostr.str());
+        }
+
+        unsigned long i = 0;
+        unsigned long count = sizeof(ID_BASES) / sizeof(ID_BASES[0]) - 1;
+
+        for(; i < count && lang.el_code() != ID_BASES[i].lang; i++);
+
+        if(i == count)
+        {
+          std::ostringstream ostr;
+          ostr << context << ": unexpected language " << lang;
+          throw InvalidArg(ostr.str());
+        }
+
+        id_base = ID_BASES[i].id_base;
+        id_upper_boundry = ID_BASES[i + 1].id_base;
+
+        if(header_failed)
+        {
+          std::ostringstream ostr;
+          ostr << context << ": failed to read file " << file;
+          throw InvalidArg(ostr.str());
+        }
+      }
+
+      void
+      DictionaryText::read(std::istream& istr) throw(El::Exception)
+      {
+        const size_t CHUNK_SIZE = 1024 * 1024;
+        size_t size = 0;
+
+        do
+        {
+          data.resize(size + CHUNK_SIZE);
+          istr.read(&data[size], CHUNK_SIZE);
+          size += istr.gcount();
+        }
+        while(istr.gcount() == (std::streamsize)CHUNK_SIZE);
+
+        data.resize(size);
+      }
+
+      template<typename RANGE>
+      void
+      DictionaryText::split(size_t count, std::vector<RANGE>& ranges) const
+        throw(El::Exception)
+      {
+        const char* begin = data.empty() ? 0 : &data[0] + records_offset;
+        const char* end = data.empty() ? 0 : &data[0] + data.size();
+
+        ranges.resize(count);
+        size_t step = (end - begin) / count;
+
+        for(size_t i = 0; i < count; ++i)
+        {
+          RANGE& range = ranges[i];
+          range.begin = begin;
+
+          if(i + 1 < count)
+          {
+            const char* pos = std::max(begin, begin + step - 1);
+            const char* eol = (const char*)memchr(pos, '\n', end - pos);
+
+            begin = eol ? eol + 1 : end;
+          }
+          else
+          {
+            begin = end;
+          }
+
+          range.end = begin;
+        }
+      }
+
+      void
+      DictionaryText::release() throw()
+      {
+        std::vector<char> empty;
+        data.swap(empty);
+      }
+
+      //
+      // Equivalent of El::String::Manip::numeric for plain short numbers
+      // which is the case for all dictionary ids
+      //
+      inline
+      bool
+      parse_id(const char* str, unsigned long& val) throw(El::Exception)
+      {
+        unsigned long res = 0;
+        const char* ptr = str;
+
+        for(; *ptr >= '0' && *ptr <= '9' && ptr - str < 9; ++ptr)
+        {
+          res = res * 10 + (*ptr - '0');
+        }
+
+        if(*ptr == '\0' && ptr != str)
+        {
+          val = res;
+          return true;
+        }
+
+        return El::String::Manip::numeric(str, val);
+      }
+
+      //
+      // Records of .nrm file range; parsed independently of others
+      //
+      struct NormalFormsRange
+      {
+        struct Record
+        {
+          size_t word_offset;
+          uint32_t word_length;
+          uint32_t id_count;
+        };
+
+        typedef std::vector<Record> RecordArray;
+
+        const char* begin;
+        const char* end;
+
+        RecordArray records;
+        WordIdArray ids;
+
+        // Description of error parsing record records.size() if not empty
+        std::string error;
+
+        NormalFormsRange() throw() : begin(0), end(0) {}
+
+        void parse(const DictionaryText& text) throw(El::Exception);
+      };
+
+      typedef std::vector<NormalFormsRange> NormalFormsRangeArray;
+
+      void
+      NormalFormsRange::parse(const DictionaryText& text)
+        throw(El::Exception)
+      {
+        const char* data = &text.data[0];
+        std::string line;
+
+        for(const char* pos = begin; pos != end; )
+        {
+          const char* eol = (const char*)memchr(pos, '\n', end - pos);
+          const char* line_end = eol ? eol : end;
+
+          line.assign(pos, line_end);
+
+          std::string::size_type tab = line.find('\t');
+
+          if(tab == std::string::npos)
+          {
+            std::ostringstream ostr;
+            ostr << "El::Dictionary::Morphology::WordNormalFormsMap::load: "
+              "word id not found in line '" << line << "'; file "
+                 << text.file_name;
+
+            error = ostr.str();
+            return;
+          }
+
+          Record record;
+          record.word_offset = pos - data;
+          record.word_length = tab;
+          record.id_count = 0;
+
+          char* item = &line[tab + 1];
+
+          for(item += strspn(item, " \t"); *item != '\0';
+              item += strspn(item, " \t"))
+          {
+            size_t len = strcspn(item, " \t");
+            char separator = item[len];
+            item[len] = '\0';
+
+            unsigned long word_id = 0;
+
+            if(!parse_id(item, word_id))
+            {
+              item[len] = separator;
+
+              std::ostringstream ostr;
+              ostr << "El::Dictionary::Morphology::WordNormalFormsMap::load:"
+                " invalid word id in line '" << line << "'; file "
+                   << text.file_name;
+
+              error = ostr.str();
+              return;
+            }
+
+            item[len] = separator;
+            item += len;
+
+            WordId id = text.id_base + word_id;
+
+            if(id >= text.id_upper_boundry)
+            {
+              std::ostringstream ostr;
+              ostr << "El::Dictionary::Morphology::WordNormalFormsMap::load:"
+                " invalid id value in line '" << line << "'; file "
+                   << text.file_name;
+
+              error = ostr.str();
+              return;
+            }
+
+            ids.push_back(id);
+            record.id_count++;
+          }
+
+          if(record.id_count == 0)
+          {
+            std::ostringstream ostr;
+            ostr << "El::Dictionary::Morphology::WordNormalFormsMap::load: "
+              "no word normal forms specified in line '" << line
+                 << "'; file " << text.file_name;
+
+            error = ostr.str();
+            return;
+          }
+
+          records.push_back(record);
+          pos = eol ? eol + 1 : end;
+        }
+      }
+
+      //
+      // Records of .mrf file range; parsed independently of others
+      // once normal forms map is built
+      //
+      struct LemmaRange
+      {
+        struct Record
+        {
+          WordId id;
+          El::String::StringConstPtr text;
+          uint32_t form_count;
+          bool lemma;
+
+          Record() throw() : id(0), form_count(0), lemma(false) {}
+        };
+
+        typedef std::vector<Record> RecordArray;
+
+        const char* begin;
+        const char* end;
+
+        RecordArray records;
+        Lemma::WordArray forms;
+
+        // Description of error parsing record records.size() if not empty
+        std::string error;
+
+        LemmaRange() throw() : begin(0), end(0) {}
+
+        void parse(const DictionaryText& text,
+                   const WordNormalFormsMap& norm_form_map)
+          throw(El::Exception);
+      };
+
+      typedef std::vector<LemmaRange> LemmaRangeArray;
+
+      void
+      LemmaRange::parse(const DictionaryText& text,
+                        const WordNormalFormsMap& norm_form_map)
+        throw(El::Exception)
+      {
+        std::string line;
+
+        for(const char* pos = begin; pos != end; )
+        {
+          const char* eol = (const char*)memchr(pos, '\n', end - pos);
+          const char* line_end = eol ? eol : end;
+
+          line.assign(pos, line_end);
+
+          Record record;
+          char* item = &line[0];
+
+          for(item += strspn(item, " \t"); *item != '\0';
+              item += strspn(item, " \t"))
+          {
+            size_t len = strcspn(item, " \t");
+            char* next = item[len] ? item + len + 1 : item + len;
+            item[len] = '\0';
+
+            char* wid = strrchr(item, ':');
+
+            if(wid == 0)
+            {
+              std::ostringstream ostr;
+              ostr << "El::Dictionary::Morphology::LemmaMap::load:"
+                " invalid word form description '" << item << "' in line '"
+                   << std::string(pos, line_end) << "'; file "
+                   << text.file_name;
+
+              error = ostr.str();
+              return;
+            }
+
+            unsigned long word_id = 0;
+            unsigned long id = 0;
+
+            if(!parse_id(wid + 1, word_id) ||
+               (id = (text.id_base + word_id)) >= text.id_upper_boundry)
+            {
+              std::ostringstream ostr;
+              ostr << "El::Dictionary::Morphology::LemmaMap::load:"
+                " invalid id in line '" << std::string(pos, line_end)
+                   << "'; file " << text.file_name;
+
+              error = ostr.str();
+              return;
+            }
+
+            *wid = '\0';
+
+            WordNormalFormsMap::const_iterator it = norm_form_map.find(item);
+
+            if(it == norm_form_map.end())
+            {
+              std::ostringstream ostr;
+              ostr << "El::Dictionary::Morphology::LemmaMap::load:"
+                "can't find norm forms for word '" << item
+                   << "'; line '" << std::string(pos, line_end)
+                   << "'; file " << text.file_name;
+
+              error = ostr.str();
+              return;
+            }
+
+            if(record.lemma)
+            {
+              Lemma::Word word;
+              word.id = id;
+              word.text = it->first;
+
+              forms.push_back(word);
+              record.form_count++;
+            }
+            else
+            {
+              record.lemma = true;
+              record.id = id;
+              record.text = it->first;
+            }
+
+            item = next;
+          }
+
+          records.push_back(record);
+          pos = eol ? eol + 1 : end;
+        }
+      }
+
+      //
+      // DictionaryLoader class
+      //
+      class DictionaryLoader : public El::Service::Callback
+      {
+      public:
+        struct Language
+        {
+          std::string normal_forms_file;
+          std::string stop_words_file;
+          std::string lemmas_file;
+
+          // Maps to load; any can be 0
+          WordNormalFormsMap* normal_forms;
+          LemmaMap* lemmas;
+
+          // Words lemmas refer to; normal_forms if 0
+          const WordNormalFormsMap* lemma_words;
+
+          std::ostream* warnings;
+
+          DictionaryText normal_forms_text;
+          DictionaryText lemmas_text;
+          NormalFormsRangeArray normal_forms_ranges;
+          LemmaRangeArray lemma_ranges;
+
+          Language() throw(El::Exception);
+        };
+
+        typedef std::vector<Language> LanguageArray;
+
+      public:
+        DictionaryLoader(size_t threads) throw(Exception, El::Exception);
+        virtual ~DictionaryLoader() throw();
+
+        virtual bool notify(El::Service::Event* event) throw(El::Exception);
+
+        void load(LanguageArray& languages, LoadTimes* times = 0)
+          throw(InvalidArg, Exception, El::Exception);
+
+      private:
+
+        enum Phase
+        {
+          PH_READ,
+          PH_PARSE_NORMAL_FORMS,
+          PH_BUILD_NORMAL_FORMS,
+          PH_PARSE_LEMMAS,
+          PH_BUILD_LEMMAS
+        };
+
+        struct Job
+        {
+          Phase phase;
+          Language* language;
+          size_t index;
+
+          // Result of job execution
+          std::string error;
+          bool invalid_arg;
+
+          Job(Phase phase_val, Language* language_val, size_t index_val)
+            throw(El::Exception);
+        };
+
+        typedef std::vector<Job> JobArray;
+
+        class Task : public El::Service::ThreadPool::TaskBase
+        {
+        public:
+          Task(DictionaryLoader* owner, Job* job) throw(El::Exception);
+          virtual ~Task() throw() {}
+
+          virtual void execute() throw(El::Exception);
+
+        private:
+          DictionaryLoader* owner_;
+          Job* job_;
+        };
+
+        typedef ACE_Thread_Mutex Mutex;
+        typedef ACE_Guard<Mutex> Guard;
+        typedef ACE_Condition<Mutex> Condition;
+
+        // Executes jobs and throws error of the first failed one
+        void run(JobArray& jobs) throw(InvalidArg, Exception, El::Exception);
+
+        void completed() throw();
+
+        size_t range_count(const DictionaryText& text) const throw();
+
+        static void execute(Job& job)
+          throw(InvalidArg, Exception, El::Exception);
+
+        static void build_normal_forms(Language& language)
+          throw(InvalidArg, Exception, El::Exception);
+
+        static void build_lemmas(Language& language)
+          throw(InvalidArg, Exception, El::Exception);
+
+      private:
+        size_t threads_;
+        El::Service::ThreadPool_var pool_;
+
+        Mutex lock_;
+        Condition job_done_;
+        size_t pending_jobs_;
+        std::string pool_error_;
+      };
+
+      DictionaryLoader::Language::Language() throw(El::Exception)
+          : normal_forms(0),
+            lemmas(0),
+            lemma_words(0),
+            warnings(0)
+      {
+      }
+
+      DictionaryLoader::Job::Job(Phase phase_val,
+                                 Language* language_val,
+                                 size_t index_val)
+        throw(El::Exception)
+          : phase(phase_val),
+            language(language_val),
+            index(index_val),
+            invalid_arg(false)
+      {
+      }
+
+      DictionaryLoader::Task::Task(DictionaryLoader* owner, Job* job)
+        throw(El::Exception)
+          : El::Service::ThreadPool::TaskBase(true),
+            owner_(owner),
+            job_(job)
+      {
+      }
+
+      void
+      DictionaryLoader::Task::execute() throw(El::Exception)
+      {
+        try
+        {
+          DictionaryLoader::execute(*job_);
+        }
+        catch(const InvalidArg& e)
+        {
+          job_->error = e.what();
+          job_->invalid_arg = true;
+        }
+        catch(const El::Exception& e)
+        {
+          job_->error = e.what();
+        }
+        catch(...)
+        {
+          job_->error = "El::Dictionary::Morphology::DictionaryLoader::Task::"
+            "execute: unknown exception caught";
+        }
+
+        // Job array must not be released by run until all tasks report
+        owner_->completed();
+      }
+
+      DictionaryLoader::DictionaryLoader(size_t threads)
+        throw(Exception, El::Exception)
+          : threads_(std::max(threads, (size_t)1)),
+            job_done_(lock_),
+            pending_jobs_(0)
+      {
+        if(threads_ > 1)
+        {
+          pool_ = new El::Service::ThreadPool(this,
+                                              "DictionaryLoader",
+                                              threads_);
+          pool_->start();
+        }
+      }
+
+      DictionaryLoader::~DictionaryLoader() throw()
+      {
+        if(pool_.in() == 0)
+        {
+          return;
+        }
+
+        try
+        {
+          pool_->stop();
+          pool_->wait();
+        }
+        catch(...)
+        {
+        }
+      }
+
+      bool
+      DictionaryLoader::notify(El::Service::Event* event)
+        throw(El::Exception)
+      {
+        El::Service::Error* error =
+          dynamic_cast<El::Service::Error*>(event);
+
+        if(error)
+        {
+          Guard guard(lock_);
+
+          if(pool_error_.empty())
+          {
+            pool_error_ = error->description;
+          }
+
+          job_done_.broadcast();
+        }
+
+        return true;
+      }
+
+      void
+      DictionaryLoader::completed() throw()
+      {
+        Guard guard(lock_);
+
+        --pending_jobs_;
+        job_done_.broadcast();
+      }
+
+      size_t
+      DictionaryLoader::range_count(const DictionaryText& text) const
+        throw()
+      {
+        return std::min(threads_, text.data.size() / (1024 * 1024) + 1);
+      }
+
+      void
+      DictionaryLoader::load(LanguageArray& languages, LoadTimes* times)
+        throw(InvalidArg, Exception, El::Exception)
+      {
+        for(LanguageArray::iterator i(languages.begin());
+            i != languages.end(); ++i)
+        {
+          if(i->normal_forms)
+          {
+            WordNormalFormsMap& words = *i->normal_forms;
+
+            words.clear();
+            words.buff_.reset(0);
+            words.norm_form_ids_.clear();
+            words.lang_ = El::Lang::EC_NUL;
+            words.hash_ = 0;
+          }
+
+          if(i->lemmas)
+          {
+            i->lemmas->clear();
+            i->lemmas->word_forms_.clear();
+          }
+        }
+
+        ACE_Time_Value* phase_times[] =
+        {
+          times ? &times->read : 0,
+          times ? &times->parse_normal_forms : 0,
+          times ? &times->build_normal_forms : 0,
+          times ? &times->parse_lemmas : 0,
+          times ? &times->build_lemmas : 0
+        };
+
+        for(int phase = PH_READ; phase <= PH_BUILD_LEMMAS; ++phase)
+        {
+          ACE_Time_Value start = ACE_OS::gettimeofday();
+          JobArray jobs;
+
+          for(LanguageArray::iterator i(languages.begin());
+              i != languages.end(); ++i)
+          {
+            Language& language = *i;
+
+            switch(phase)
+            {
+            case PH_READ:
+              {
+                if(language.normal_forms)
+                {
+                  jobs.push_back(Job(PH_READ, &language, 0));
+                }
+
+                if(language.lemmas)
+                {
+                  jobs.push_back(Job(PH_READ, &language, 1));
+                }
+
+                break;
+              }
+            case PH_PARSE_NORMAL_FORMS:
+              {
+                if(language.normal_forms == 0)
+                {
+                  break;
+                }
+
+                language.normal_forms_text.split(
+                  range_count(language.normal_forms_text),
+                  language.normal_forms_ranges);
+
+                for(size_t r = 0; r < language.normal_forms_ranges.size();
+                    ++r)
+                {
+                  jobs.push_back(Job(PH_PARSE_NORMAL_FORMS, &language, r));
+                }
+
+                break;
+              }
+            case PH_PARSE_LEMMAS:
+              {
+                if(language.lemmas == 0)
+                {
+                  break;
+                }
+
+                language.lemmas_text.split(range_count(language.lemmas_text),
+                                           language.lemma_ranges);
+
+                for(size_t r = 0; r < language.lemma_ranges.size(); ++r)
+                {
+                  jobs.push_back(Job(PH_PARSE_LEMMAS, &language, r));
+                }
+
+                break;
+              }
+            case PH_BUILD_NORMAL_FORMS:
+              {
+                if(language.normal_forms)
+                {
+                  jobs.push_back(Job(PH_BUILD_NORMAL_FORMS, &language, 0));
+                }
+
+                break;
+              }
+            case PH_BUILD_LEMMAS:
+              {
+                if(language.lemmas)
+                {
+                  jobs.push_back(Job(PH_BUILD_LEMMAS, &language, 0));
+                }
+
+                break;
+              }
+            }
+          }
+
+          run(jobs);
+
+          if(phase_times[phase])
+          {
+            *phase_times[phase] = ACE_OS::gettimeofday() - start;
+          }
+        }
+      }
+
+      void
+      DictionaryLoader::run(JobArray& jobs)
+        throw(InvalidArg, Exception, El::Exception)
+      {
+        if(pool_.in() == 0)
+        {
+          for(JobArray::iterator i(jobs.begin()); i != jobs.end(); ++i)
+          {
+            execute(*i);
+          }
+
+          return;
+        }
+
+        {
+          Guard guard(lock_);
+          pending_jobs_ = jobs.size();
+        }
+
+        std::string enqueue_error;
+        JobArray::iterator i(jobs.begin());
+
+        for(; i != jobs.end(); ++i)
+        {
+          try
+          {
+            El::Service::ThreadPool::Task_var task = new Task(this, &*i);
+
+            if(!pool_->execute(task.in()))
+            {
+              enqueue_error = "thread pool stopped";
+              break;
+            }
+          }
+          catch(const El::Exception& e)
+          {
+            enqueue_error = e.what();
+            break;
+          }
+        }
+
+        {
+          Guard guard(lock_);
+
+          // Jobs not queued will never complete
+          pending_jobs_ -= jobs.end() - i;
+
+          // Tasks refer jobs, so can't leave while any is queued or running
+          while(pending_jobs_)
+          {
+            job_done_.wait();
+          }
+
+          if(!enqueue_error.empty())
+          {
+            std::ostringstream ostr;
+            ostr << "El::Dictionary::Morphology::DictionaryLoader::run: "
+              "failed to queue job. Description:\n" << enqueue_error;
+
+            throw Exception(ostr.str());
+          }
+
+          if(!pool_error_.empty())
+          {
+            std::ostringstream ostr;
+            ostr << "El::Dictionary::Morphology::DictionaryLoader::run: "
+              "thread pool failure. Description:\n" << pool_error_;
+
+            throw Exception(ostr.str());
+          }
+        }
+
+        // Report error as sequential loading would do
+        for(JobArray::const_iterator i(jobs.begin()); i != jobs.end(); ++i)
+        {
+          if(!i->error.empty())
+          {
+            if(i->invalid_arg)
+            {
+              throw InvalidArg(i->error);
+            }
+
+            throw Exception(i->error);
+          }
+        }
+      }
+
+      void
+      DictionaryLoader::execute(Job& job)
+        throw(InvalidArg, Exception, El::Exception)
+      {
+        Language& language = *job.language;
+
+        switch(job.phase)
+        {
+        case PH_READ:
+          {
+            if(job.index == 0)
+            {
+              language.normal_forms_text.read(
+                language.normal_forms_file.c_str(),
+                2,
+                "El::Dictionary::Morphology::WordNormalFormsMap::load");
+            }
+            else
+            {
+              language.lemmas_text.read(
+                language.lemmas_file.c_str(),
+                1,
+                "El::Dictionary::Morphology::LemmaMap::load");
+            }
+
+            break;
+          }
+        case PH_PARSE_NORMAL_FORMS:
+          {
+            language.normal_forms_ranges[job.index].parse(
+              language.normal_forms_text);
+
+            break;
+          }
+        case PH_BUILD_NORMAL_FORMS:
+          {
+            build_normal_forms(language);
+            break;
+          }
+        case PH_PARSE_LEMMAS:
+          {
+            language.lemma_ranges[job.index].parse(
+              language.lemmas_text,
+              language.lemma_words ? *language.lemma_words :
+              *language.normal_forms);
+
+            break;
+          }
+        case PH_BUILD_LEMMAS:
+          {
+            build_lemmas(language);
+            break;
+          }
+        }
+      }
+
+      void
+      DictionaryLoader::build_normal_forms(Language& language)
+        throw(InvalidArg, Exception, El::Exception)
+      {
+        WordNormalFormsMap& words = *language.normal_forms;
+        DictionaryText& text = language.normal_forms_text;
+        const char* dict_file = text.file_name.c_str();
+
+        uint32_t records = text.records;
+        uint32_t buff_size = text.params[0];
+        uint32_t norm_forms_count = text.params[1];
+
+        uint32_t& hash = words.hash_;
+
+        El::CRC(hash,
+                (const unsigned char*)text.lang_s.c_str(),
+                text.lang_s.length());
+
+        El::CRC(hash, (const unsigned char*)&records, sizeof(records));
+        El::CRC(hash, (const unsigned char*)&buff_size, sizeof(buff_size));
+
+        El::CRC(hash,
+                (const unsigned char*)&norm_forms_count,
+                sizeof(norm_forms_count));
+
+        words.lang_ = text.lang;
+        words.norm_form_ids_.resize(norm_forms_count);
+        words.reserve(records);
+
+        unsigned long position = 0;
+        El::ArrayPtr<char> buff(new char[buff_size]);
+        unsigned long norm_form_offset = 0;
+
+        try
+        {
+          unsigned long i = 0;
+
+          for(NormalFormsRangeArray::const_iterator
+                rit(language.normal_forms_ranges.begin());
+              rit != language.normal_forms_ranges.end() && i < records;
+              ++rit)
+          {
+            const NormalFormsRange& range = *rit;
+            const WordId* ids = range.ids.empty() ? 0 : &range.ids[0];
+
+            for(NormalFormsRange::RecordArray::const_iterator
+                  it(range.records.begin());
+                it != range.records.end() && i < records; ++it, ++i)
+            {
+              const NormalFormsRange::Record& record = *it;
+              const char* word = &text.data[record.word_offset];
+              unsigned long length = record.word_length;
+
+              if(length + position >= buff_size)
+              {
+                std::ostringstream ostr;
+                ostr << "El::Dictionary::Morphology::WordNormalFormsMap::load:"
+                  " buffer size " << buff_size << " is insufficient to read "
+                  "record " << i << " from " << records << "; file "
+                     << dict_file;
+
+                throw InvalidArg(ostr.str());
+              }
+
+              char* pword = buff.get() + position;
+
+              memcpy(pword, word, length);
+              position += length;
+              buff[position++] = '\0';
+
+              if(words.find(pword) != words.end())
+              {
+                std::ostringstream ostr;
+                ostr << "El::Dictionary::Morphology::WordNormalFormsMap::load:"
+                  " duplicated word '" << pword << "' in file " << dict_file
+                     << " line num: " << i + 1;
+
+                throw InvalidArg(ostr.str());
+              }
 
-          throw InvalidArg(ostr.str());          
-        }
+              El::CRC(hash, (const unsigned char*)pword, length);
 
-        unsigned long i = 0;
-        unsigned long count = sizeof(ID_BASES) / sizeof(ID_BASES[0]) - 1;
-        
-        for(; i < count && lang_.el_code() != ID_BASES[i].lang; i++);
+              if(norm_form_offset + record.id_count >
+                 words.norm_form_ids_.size())
+              {
+                std::ostringstream ostr;
+                ostr << "El::Dictionary::Morphology::WordNormalFormsMap::load:"
+                  " norm form count " << words.norm_form_ids_.size()
+                     << " is smaller than actual number; file "
+                     << dict_file;
 
-        if(i == count)
-        {
-          std::ostringstream ostr;
-          ostr << "El::Dictionary::Morphology::WordNormalFormsMap::load: "
-            "unexpected language " << lang_;
+                throw InvalidArg(ostr.str());
+              }
 
-          throw InvalidArg(ostr.str());
-        }
+              El::CRC(hash,
+                      (const unsigned char*)ids,
+                      sizeof(*ids) * record.id_count);
 
-        unsigned long id_base = ID_BASES[i].id_base;        
-        unsigned long id_upper_boundry = ID_BASES[i + 1].id_base;        
+              WordNormalForms& wi = words[pword];
 
-        std::string line;
-        std::getline(file, line);
+              wi.normal_form_offset = norm_form_offset;
+              wi.normal_form_count = record.id_count;
 
-        if(file.fail())
-        {
-          std::ostringstream ostr;
-          ostr << "El::Dictionary::Morphology::WordNormalFormsMap::load: "
-            "failed to read file " << dict_file;
+              std::copy(ids,
+                        ids + record.id_count,
+                        words.norm_form_ids_.begin() + norm_form_offset);
 
-          throw InvalidArg(ostr.str());          
-        }
+              norm_form_offset += record.id_count;
+              ids += record.id_count;
+            }
 
-        norm_form_ids_.resize(norm_forms_count);
+            if(!range.error.empty() && i < records)
+            {
+              throw InvalidArg(range.error);
+            }
+          }
 
-        unsigned long position = 0;
-        El::ArrayPtr<char> buff(new char[buff_size]);
-        unsigned long norm_form_offset = 0;
-        
-        try
-        {
-          for(unsigned long i = 0; i < records; i++)
+          if(i < records)
           {
-            if(!std::getline(file, line))
-            {
-              std::ostringstream ostr;
-              ostr << "El::Dictionary::Morphology::WordNormalFormsMap::load: "
-                "failed to read file " << dict_file << " after " << i
-                   << " records";
+            std::ostringstream ostr;
+            ostr << "El::Dictionary::Morphology::WordNormalFormsMap::load: "
+              "failed to read file " << dict_file << " after " << i
+                 << " records";
 
-              throw InvalidArg(ostr.str());            
-            }
+            throw InvalidArg(ostr.str());
+          }
+        }
+        catch(...)
+        {
+          words.clear();
+          words.lang_ = El::Lang::EC_NUL;
 
-            std::string::size_type pos = line.find('\t');
+          throw;
+        }
 
-            if(pos == std::string::npos)
-            {
-              std::ostringstream ostr;
-              ostr << "El::Dictionary::Morphology::WordNormalFormsMap::load: "
-                "word id not found in line '" << line << "'; file "
-                   << dict_file;
-              
-              throw InvalidArg(ostr.str());    
-            }
+        words.buff_.reset(buff.release());
 
-            std::string word = line.substr(0, pos);
+        text.release();
+        NormalFormsRangeArray().swap(language.normal_forms_ranges);
 
-            if(find(word.c_str()) != end())
-            {
-              std::ostringstream ostr;
-              ostr << "El::Dictionary::Morphology::WordNormalFormsMap::load: "
-                "duplicated word '" << word << "' in file " << dict_file
-                   << " line num: " << i + 1;
+        words.load_stop_words(language.stop_words_file.c_str(),
+                              language.warnings);
+      }
 
-              throw InvalidArg(ostr.str());            
-            }
-            
-            unsigned long length = word.length();
-            if(length + position >= buff_size)
-            {
-              std::ostringstream ostr;
-              ostr << "El::Dictionary::Morphology::WordNormalFormsMap::load: "
-                "buffer size " << buff_size << " is insufficient to read "
-                "record " << i << " from " << records << "; file "
-                   << dict_file;
+      void
+      DictionaryLoader::build_lemmas(Language& language)
+        throw(InvalidArg, Exception, El::Exception)
+      {
+        LemmaMap& lemmas = *language.lemmas;
+        DictionaryText& text = language.lemmas_text;
+        const char* dict_file = text.file_name.c_str();
 
-              throw InvalidArg(ostr.str());
-            }
+        unsigned long records = text.records;
+        Lemma::WordArray& word_forms = lemmas.word_forms_;
 
-            El::CRC(hash_, (const unsigned char*)word.c_str(), length);
+        lemmas.lang_ = text.lang;
+        word_forms.resize(text.params[0]);
+        lemmas.reserve(records);
 
-            char* pword = buff.get() + position;
-            
-            strcpy(pword, word.c_str());
-            position += length;
-            buff[position++] = '\0';
+        unsigned long word_form_offset = 0;
+
+        try
+        {
+          unsigned long i = 0;
 
-            El::String::ListParser parser(line.c_str() + pos + 1, " \t");
+          for(LemmaRangeArray::const_iterator
+                rit(language.lemma_ranges.begin());
+              rit != language.lemma_ranges.end() && i < records; ++rit)
+          {
+            const LemmaRange& range = *rit;
 
-            unsigned long word_nf_offset = norm_form_offset;
-              
-            const char* item = 0;
-            while((item = parser.next_item()) != 0)
+            Lemma::WordArray::const_iterator form_it =
+              range.forms.begin();
+
+            for(LemmaRange::RecordArray::const_iterator
+                  it(range.records.begin());
+                it != range.records.end() && i < records; ++it, ++i)
             {
-              if(norm_form_offset == norm_form_ids_.size())
-              {
-                std::ostringstream ostr;
-                ostr << "El::Dictionary::Morphology::WordNormalFormsMap::load:"
-                  " norm form count " << norm_form_ids_.size()
-                     << " is smaller than actual number; file "
-                     << dict_file;
+              const LemmaRange::Record& record = *it;
 
-                throw InvalidArg(ostr.str());
-              }
-              
-              unsigned long word_id = 0;
-              if(!El::String::Manip::numeric(item, word_id))
+              if(!record.lemma)
               {
-                std::ostringstream ostr;
-                ostr << "El::Dictionary::Morphology::WordNormalFormsMap::load:"
-                  " invalid word id in line '" << line << "'; file "
-                     << dict_file;
-              
-                throw InvalidArg(ostr.str());
+                continue;
               }
 
-              WordId id = id_base + word_id;
-              
-              if(id >= id_upper_boundry)
+              if(word_form_offset + record.form_count > word_forms.size())
               {
                 std::ostringstream ostr;
-                ostr << "El::Dictionary::Morphology::WordNormalFormsMap::load:"
-                  " invalid id value in line '" << line << "'; file "
+                ostr << "El::Dictionary::Morphology::LemmaMap::load:"
+                  " word form count " << word_forms.size()
+                     << " is smaller than actual number; file "
                      << dict_file;
-              
+
                 throw InvalidArg(ostr.str());
               }
-                
-              El::CRC(hash_, (const unsigned char*)&id, sizeof(id));
-              norm_form_ids_[norm_form_offset++] = id;
+
+              Lemma& lemma = lemmas[record.id];
+
+              lemma.text = record.text;
+              lemma.word_form_offset = word_form_offset;
+              lemma.word_form_count += record.form_count;
+
+              std::copy(form_it,
+                        form_it + record.form_count,
+                        word_forms.begin() + word_form_offset);
+
+              word_form_offset += record.form_count;
+              form_it += record.form_count;
             }
 
-            unsigned long word_nf_count = norm_form_offset - word_nf_offset;
-              
-            if(word_nf_count == 0)
+            if(!range.error.empty() && i < records)
             {
-              std::ostringstream ostr;
-              ostr << "El::Dictionary::Morphology::WordNormalFormsMap::load: "
-                "no word normal forms specified in line '" << line
-                   << "'; file " << dict_file;
-              
-              throw InvalidArg(ostr.str());
+              throw InvalidArg(range.error);
             }
+          }
 
-            WordNormalForms& wi = (*this)[pword];
-            
-            wi.normal_form_offset = word_nf_offset;
-            wi.normal_form_count = word_nf_count;
+          if(i < records)
+          {
+            std::ostringstream ostr;
+            ostr << "El::Dictionary::Morphology::LemmaMap::load: "
+              "failed to read file " << dict_file << " after " << i
+                 << " records";
+
+            throw InvalidArg(ostr.str());
           }
         }
         catch(...)
         {
-          clear();
-          lang_ = El::Lang::EC_NUL;
-          
+          lemmas.clear();
+          word_forms.clear();
+
           throw;
         }
-        
-        buff_.reset(buff.release());
 
+        text.release();
+        LemmaRangeArray().swap(language.lemma_ranges);
+      }
+
+      //
+      // WordInfoMap class
+      //
+      void
+      WordNormalFormsMap::load(const char* dict_file,
+                               const char* stop_words_file,
+                               std::ostream* warnings_stream)
+        throw(InvalidArg, Exception, El::Exception)
+      {
+        DictionaryLoader::LanguageArray languages(1);
+        DictionaryLoader::Language& language = languages[0];
+
+        language.normal_forms_file = dict_file;
+        language.stop_words_file = stop_words_file ? stop_words_file : "";
+        language.normal_forms = this;
+        language.warnings = warnings_stream;
+
+        DictionaryLoader loader(1);
+        loader.load(languages);
+      }
+
+      void
+      WordNormalFormsMap::load_stop_words(const char* stop_words_file,
+                                          std::ostream* warnings_stream)
+        throw(InvalidArg, Exception, El::Exception)
+      {
         if(stop_words_file == 0 || *stop_words_file == '\0')
         {
           return;
         }
 
-        file.close();
-        
-        file.open(stop_words_file, std::ios::in);
+        std::fstream file(stop_words_file, std::ios::in);
 
         if(!file.is_open())
         {
           return;
         }
 
+        std::string line;
+
         while(std::getline(file, line))
         {
           std::string trimmed;
@@ -449,171 +1500,15 @@ namespace El
                      const WordNormalFormsMap& norm_form_map)
         throw(InvalidArg, Exception, El::Exception)
       {
-        clear();
-        word_forms_.clear();
-        
-        std::fstream file(dict_file, std::ios::in);
-
-        if(!file.is_open())
-        {
-          std::ostringstream ostr;
-          ostr << "El::Dictionary::Morphology::LemmaMap::load: "
-            "failed to open file " << dict_file;
-
-          throw InvalidArg(ostr.str());          
-        }
-
-        std::string lang_s;
-        unsigned long records = 0;
-        unsigned long word_forms_count = 0;
-
-        file >> lang_s >> records >> word_forms_count;
-
-        try
-        {
-          lang_ = El::Lang(lang_s.c_str());
-        }
-        catch(const El::Lang::InvalidArg& e)
-        {
-          std::ostringstream ostr;
-          ostr << "El::Dictionary::Morphology::LemmaMap::load: "
-            "can't process language " << lang_s << ". Reason: " << e;
-
-          throw InvalidArg(ostr.str());          
-        }
-
-        unsigned long i = 0;
-        unsigned long count = sizeof(ID_BASES) / sizeof(ID_BASES[0]) - 1;
-        
-        for(; i < count && lang_.el_code() != ID_BASES[i].lang; i++);
-
-        if(i == count)
-        {
-          std::ostringstream ostr;
-          ostr << "El::Dictionary::Morphology::LemmaMap::load: "
-            "unexpected language " << lang_;
-
-          throw InvalidArg(ostr.str());
-        }
-
-        unsigned long id_base = ID_BASES[i].id_base;        
-        unsigned long id_upper_boundry = ID_BASES[i + 1].id_base;        
-
-        std::string line;
-        std::getline(file, line);
-
-        if(file.fail())
-        {
-          std::ostringstream ostr;
-          ostr << "El::Dictionary::Morphology::LemmaMap::load: "
-            "failed to read file " << dict_file;
-
-          throw InvalidArg(ostr.str());          
-        }
-
-        word_forms_.resize(word_forms_count);
-
-        unsigned long word_form_offset = 0;
-        
-        try
-        {
-          for(unsigned long i = 0; i < records; i++)
-          {
-            if(!std::getline(file, line))
-            {
-              std::ostringstream ostr;
-              ostr << "El::Dictionary::Morphology::LemmaMap::load: "
-                "failed to read file " << dict_file << " after " << i
-                   << " records";
-
-              throw InvalidArg(ostr.str());
-            }
-
-            El::String::ListParser parser(line.c_str(), " \t");
-            
-            const char* item = 0;
-            Lemma* lemma = 0;
-            
-            while((item = parser.next_item()) != 0)
-            {
-              const char* wid = strrchr(item, ':');
-
-              if(wid == 0)
-              {
-                std::ostringstream ostr;
-                ostr << "El::Dictionary::Morphology::LemmaMap::load:"
-                  " invalid word form description '" << item << "' in line '"
-                     << line << "'; file " << dict_file;
-              
-                throw InvalidArg(ostr.str());
-              }
-
-              unsigned long word_id = 0;
-              unsigned long id = 0;
-              
-              if(!El::String::Manip::numeric(wid + 1, word_id) ||
-                 (id = (id_base + word_id)) >= id_upper_boundry)
-              {
-                std::ostringstream ostr;
-                ostr << "El::Dictionary::Morphology::LemmaMap::load:"
-                  " invalid id in line '" << line << "'; file "
-                     << dict_file;
-              
-                throw InvalidArg(ostr.str());
-              }
-
-              std::string w(item, wid - item);
-              WordNormalFormsMap::const_iterator it = norm_form_map.find(w);
-              
-              if(it == norm_form_map.end())
-              {
-                std::ostringstream ostr;
-                ostr << "El::Dictionary::Morphology::LemmaMap::load:"
-                  "can't find norm forms for word '" << w 
-                     << "'; line '" << line << "'; file "
-                     << dict_file;
-                
-                throw InvalidArg(ostr.str());
-              }
+        DictionaryLoader::LanguageArray languages(1);
+        DictionaryLoader::Language& language = languages[0];
 
-              El::String::StringConstPtr word(it->first);
+        language.lemmas_file = dict_file;
+        language.lemmas = this;
+        language.lemma_words = &norm_form_map;
 
-              if(lemma)
-              {
-                if(word_form_offset == word_forms_.size())
-                {
-                  std::ostringstream ostr;
-                  ostr << "El::Dictionary::Morphology::LemmaMap::load:"
-                    " word form count " << word_forms_.size()
-                       << " is smaller than actual number; file "
-                       << dict_file;
-                  
-                  throw InvalidArg(ostr.str());
-                }
-
-                Lemma::Word& lemma_word = word_forms_[word_form_offset++];
-                
-                lemma_word.id = id;
-                lemma_word.text = word;
-                  
-                lemma->word_form_count++;
-              }
-              else
-              {
-                lemma = &(*this)[id];
-                lemma->text = word;
-                lemma->word_form_offset = word_form_offset;
-              }
-            }
-          }
-        }
-        catch(...)
-        {
-          clear();
-          word_forms_.clear();
-          
-          throw;
-        }
+        DictionaryLoader loader(1);
+        loader.load(languages);
       }
 
       long
@@ -864,6 +1759,23 @@ namespace El
         return true;
       }
       
+      //
+      // LoadTimes struct
+      //
+      void
+      LoadTimes::dump(std::ostream& ostr) const throw(El::Exception)
+      {
+        ostr << "read: " << El::Moment::time(read)
+             << "\nparse normal forms: "
+             << El::Moment::time(parse_normal_forms)
+             << "\nbuild normal forms: "
+             << El::Moment::time(build_normal_forms)
+             << "\nparse lemmas: " << El::Moment::time(parse_lemmas)
+             << "\nbuild lemmas: " << El::Moment::time(build_lemmas)
+             << "\nmerge: " << El::Moment::time(merge)
+             << "\ntotal: " << El::Moment::time(total) << std::endl;
+      }
+
       //
       // WordInfoManager class
       //
@@ -872,28 +1784,79 @@ namespace El
                             std::ostream* warnings_stream)
         throw(InvalidArg, Exception, El::Exception)
       {
-        std::string df = dict_file;
-        
-        WordNormalFormsMap_var words = new WordNormalFormsMap();
-        
-        words->load(std::string(df + ".nrm").c_str(),
-                    std::string(df + ".stp").c_str(),
-                    warnings_stream);
+        load(DictFileArray(1, dict_file), warnings_stream, 1);
+      }
 
-        uint32_t hash = words->hash();
-        El::CRC(hash_, (const unsigned char*)&hash, sizeof(hash));
-        
-        LemmaMap_var lemmas = new LemmaMap();
-        lemmas->load(std::string(df + ".mrf").c_str(), *words);
+      void
+      WordInfoManager::load(const DictFileArray& dict_files,
+                            std::ostream* warnings_stream,
+                            size_t threads,
+                            LoadTimes* times)
+        throw(InvalidArg, Exception, El::Exception)
+      {
+        ACE_Time_Value start = ACE_OS::gettimeofday();
 
-        El::Lang lang = words->lang();
-        
-        word_normal_forms_[lang] = words;
-        
-        popularity_word_normal_forms_[LangDetection::popularity_index(lang)] =
-          words.retn();
-          
-        lemmas_[lang] = lemmas.retn();
+        size_t count = dict_files.size();
+
+        std::vector<WordNormalFormsMap_var> words(count);
+        std::vector<LemmaMap_var> lemmas(count);
+
+        // Languages are loaded concurrently, so warnings are kept aside
+        // to be output in dict_files order
+        El::ArrayPtr<std::ostringstream> warnings(
+          warnings_stream && count ? new std::ostringstream[count] : 0);
+
+        DictionaryLoader::LanguageArray languages(count);
+
+        for(size_t i = 0; i < count; ++i)
+        {
+          const std::string& df = dict_files[i];
+          DictionaryLoader::Language& language = languages[i];
+
+          words[i] = new WordNormalFormsMap();
+          lemmas[i] = new LemmaMap();
+
+          language.normal_forms_file = df + ".nrm";
+          language.stop_words_file = df + ".stp";
+          language.lemmas_file = df + ".mrf";
+          language.normal_forms = words[i].in();
+          language.lemmas = lemmas[i].in();
+          language.warnings = warnings.get() ? &warnings[i] : 0;
+        }
+
+        {
+          DictionaryLoader loader(threads);
+          loader.load(languages, times);
+        }
+
+        ACE_Time_Value merge_start = ACE_OS::gettimeofday();
+
+        for(size_t i = 0; i < count; ++i)
+        {
+          if(warnings_stream)
+          {
+            *warnings_stream << warnings[i].str();
+          }
+
+          uint32_t hash = words[i]->hash();
+          El::CRC(hash_, (const unsigned char*)&hash, sizeof(hash));
+
+          El::Lang lang = words[i]->lang();
+
+          word_normal_forms_[lang] = words[i];
+          popularity_word_normal_forms_[
+            LangDetection::popularity_index(lang)] = words[i];
+
+          lemmas_[lang] = lemmas[i];
+        }
+
+        if(times)
+        {
+          ACE_Time_Value now = ACE_OS::gettimeofday();
+
+          times->merge = now - merge_start;
+          times->total = now - start;
+        }
       }
 
       const char*
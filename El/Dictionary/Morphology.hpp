@@ -16,14 +16,12 @@
 
 #include <stdint.h>
 
+#include <string>
 #include <iostream>
 #include <vector>
 #include <map>
 #include <memory>
 
-#include <ext/hash_map>
-#include <ext/hash_set>
-
 #include <ace/OS.h>
 
 #include <El/Exception.hpp>
@@ -33,6 +31,7 @@
 #include <El/ArrayPtr.hpp>
 #include <El/RefCount/All.hpp>
 #include <El/Hash/Hash.hpp>
+#include <El/Hash/FlatMap.hpp>
 #include <El/CRC.hpp>
 #include <El/BinaryStream.hpp>
 
@@ -80,6 +79,8 @@ namespace El
       typedef std::vector<WordId> WordIdArray;
     
       typedef std::vector<El::String::StringConstPtr> WordArray;
+
+      class DictionaryLoader;
       
       struct WordNormalForms
       {
@@ -92,9 +93,9 @@ namespace El
       typedef std::vector<WordNormalForms> WordNormalFormsArray;
     
       class WordNormalFormsMap :
-        public __gnu_cxx::hash_map<El::String::StringConstPtr,
-                                   WordNormalForms,
-                                   El::Hash::StringConstPtr>,
+        public El::Hash::FlatMap<El::String::StringConstPtr,
+                                 WordNormalForms,
+                                 El::Hash::StringConstPtr>,
         virtual public RefCount::DefaultImpl<>
       {        
       public:
@@ -113,12 +114,17 @@ namespace El
           throw(El::Exception);
 
       private:
-        
+        friend class DictionaryLoader;
+
+        void load_stop_words(const char* stop_words_file,
+                             std::ostream* warnings_stream)
+          throw(InvalidArg, Exception, El::Exception);
+
         typedef El::ArrayPtr<char> BuffPtr;
 
-        typedef __gnu_cxx::hash_map<WordId,
-                                    El::String::StringConstPtr,
-                                    El::Hash::Numeric<WordId> >
+        typedef El::Hash::FlatMap<WordId,
+                                  El::String::StringConstPtr,
+                                  El::Hash::Numeric<WordId> >
         StopWordsMap;
         
         BuffPtr buff_;
@@ -196,7 +202,7 @@ namespace El
       typedef std::vector<LemmaInfoArray> LemmaInfoArrayArray;
 
       class LemmaMap :
-        public __gnu_cxx::hash_map<WordId, Lemma, El::Hash::Numeric<WordId> >,
+        public El::Hash::FlatMap<WordId, Lemma, El::Hash::Numeric<WordId> >,
         virtual public RefCount::DefaultImpl<>
       {        
       public:
@@ -225,6 +231,8 @@ namespace El
                                  long word2_len) throw();
 
       private:
+        friend class DictionaryLoader;
+
         El::Lang lang_;
         Lemma::WordArray word_forms_;
 
@@ -235,10 +243,36 @@ namespace El
 
       typedef RefCount::SmartPtr<LemmaMap> LemmaMap_var;
       
+      //
+      // Wall time of dictionary loading phases
+      //
+      struct LoadTimes
+      {
+        // Reading (and decompressing) files
+        ACE_Time_Value read;
+
+        // Parsing lines and building normal form maps, stop words included
+        ACE_Time_Value parse_normal_forms;
+        ACE_Time_Value build_normal_forms;
+
+        // Parsing lines and building lemma maps
+        ACE_Time_Value parse_lemmas;
+        ACE_Time_Value build_lemmas;
+
+        // Adding languages to WordInfoManager
+        ACE_Time_Value merge;
+
+        ACE_Time_Value total;
+
+        void dump(std::ostream& ostr) const throw(El::Exception);
+      };
+
       class WordInfoManager
       {
       public:
 
+        typedef std::vector<std::string> DictFileArray;
+
         WordInfoManager(size_t default_lang_validation_level, // 10
                         size_t guessing_default_lang_validation_level, //30
                         size_t lang_validation_level)
@@ -247,6 +281,20 @@ namespace El
         void load(const char* dict_file, std::ostream* warnings_stream)
           throw(InvalidArg, Exception, El::Exception);
 
+        //
+        // Loads dictionaries of several languages; dict_files are paths
+        // without extension. Languages are processed independently by
+        // threads of a pool, lines of big files are parsed by several
+        // threads each. If file is missing, its .gz version is read.
+        // Languages are added to manager in dict_files order after all
+        // loaded, so on failure manager remains unchanged.
+        //
+        void load(const DictFileArray& dict_files,
+                  std::ostream* warnings_stream,
+                  size_t threads,
+                  LoadTimes* times = 0)
+          throw(InvalidArg, Exception, El::Exception);
+
         void normal_form_ids(const WordArray& words,
                              WordInfoArray& word_infos,
                              El::Lang* lang,
@@ -270,7 +318,7 @@ namespace El
         
       private:
         
-        typedef __gnu_cxx::hash_map<El::Lang, unsigned long, El::Hash::Lang>
+        typedef El::Hash::FlatMap<El::Lang, unsigned long, El::Hash::Lang>
         LangRates;
 
         typedef std::auto_ptr<LangRates> LangRatesPtr;
@@ -289,16 +337,16 @@ namespace El
         
       private:
         
-        typedef __gnu_cxx::hash_map<El::Lang,
-                                    WordNormalFormsMap_var,
-                                    El::Hash::Lang> LangWordNormalFormsMap;
+        typedef El::Hash::FlatMap<El::Lang,
+                                  WordNormalFormsMap_var,
+                                  El::Hash::Lang> LangWordNormalFormsMap;
 
         typedef std::map<unsigned long, WordNormalFormsMap_var>
         PopularityWordNormalFormsMap;
 
-        typedef __gnu_cxx::hash_map<El::Lang,
-                                    LemmaMap_var,
-                                    El::Hash::Lang> LangLemmaMap;
+        typedef El::Hash::FlatMap<El::Lang,
+                                  LemmaMap_var,
+                                  El::Hash::Lang> LangLemmaMap;
         
         LangWordNormalFormsMap word_normal_forms_;
         PopularityWordNormalFormsMap popularity_word_normal_forms_;
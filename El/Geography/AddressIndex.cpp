@@ -0,0 +1,504 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Geography/AddressIndex.cpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#include <string.h>
+#include <arpa/inet.h>
+
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+
+#include <GeoIP.h>
+#include <GeoIPCity.h>
+
+#include "AddressIndex.hpp"
+
+namespace
+{
+  const uint64_t IPV4_MAX = 0xFFFFFFFFULL;
+  const size_t V4_SLOTS = 65536;
+
+  inline
+  uint32_t
+  successor(uint32_t val) throw()
+  {
+    return val + 1;
+  }
+
+  inline
+  El::Geography::AddressIndex::IPv6
+  successor(const El::Geography::AddressIndex::IPv6& val) throw()
+  {
+    return El::Geography::AddressIndex::IPv6(val.lo == UINT64_MAX ?
+                                              val.hi + 1 : val.hi,
+                                              val.lo + 1);
+  }
+
+  El::Country
+  code_country(const char* code) throw(El::Exception)
+  {
+    if(code)
+    {
+      try
+      {
+        return El::Country(code);
+      }
+      catch(const El::Country::Exception&)
+      {
+      }
+    }
+
+    return El::Country::null;
+  }
+  
+  void
+  split_csv(const std::string& line, std::vector<std::string>& fields)
+    throw(El::Exception)
+  {
+    fields.clear();
+
+    std::string::size_type pos = 0;
+
+    while(true)
+    {
+      std::string::size_type end = line.find(',', pos);
+
+      std::string field =
+        line.substr(pos, end == std::string::npos ? end : end - pos);
+
+      std::string::size_type b = field.find_first_not_of(" \t\"\r");
+      std::string::size_type e = field.find_last_not_of(" \t\"\r");
+
+      fields.push_back(b == std::string::npos ? std::string() :
+                       field.substr(b, e - b + 1));
+
+      if(end == std::string::npos)
+      {
+        break;
+      }
+
+      pos = end + 1;
+    }
+  }
+}
+
+namespace El
+{
+  namespace Geography
+  {
+    //
+    // AddressIndex class
+    //
+    AddressIndex::AddressIndex(GeoIP* geoip, GeoIP* geoip_v6)
+      throw(Exception, El::Exception)
+    {
+      if(geoip == 0)
+      {
+        throw Exception(
+          "El::Geography::AddressIndex::AddressIndex: geoip is 0");
+      }
+
+      load_geoip(geoip, geoip_v6);
+    }
+
+    AddressIndex::AddressIndex(const char* csv_path)
+      throw(Exception, El::Exception)
+    {
+      load_csv(csv_path);
+    }
+
+    void
+    AddressIndex::load_geoip(GeoIP* geoip, GeoIP* geoip_v6)
+      throw(Exception, El::Exception)
+    {
+      RangeV4Array v4;
+      RangeV6Array v6;
+
+      load_geoip_v4(geoip, v4);
+
+      if(geoip_v6)
+      {
+        load_geoip_v6(geoip_v6, v6);
+      }
+
+      build(v4, v6);
+    }
+
+    void
+    AddressIndex::load_geoip_v4(GeoIP* geoip, RangeV4Array& v4)
+      throw(Exception, El::Exception)
+    {
+      int edition = GeoIP_database_edition(geoip);
+
+      bool city = edition == GEOIP_CITY_EDITION_REV0 ||
+        edition == GEOIP_CITY_EDITION_REV1;
+
+      if(!city && edition != GEOIP_COUNTRY_EDITION)
+      {
+        std::ostringstream ostr;
+        ostr << "El::Geography::AddressIndex::load_geoip_v4: unsupported "
+          "database edition " << edition;
+
+        throw Exception(ostr.str());
+      }
+
+      //
+      // Walking the address space network by network; each lookup
+      // reports the prefix length of the network the address belongs to.
+      //
+      for(uint64_t ip = 0; ip <= IPV4_MAX; )
+      {
+        El::Country country;
+
+        if(city)
+        {
+          GeoIPRecord* rec = GeoIP_record_by_ipnum(geoip, ip);
+
+          if(rec)
+          {
+            country = code_country(rec->country_code3);
+            GeoIPRecord_delete(rec);
+          }
+        }
+        else
+        {
+          int id = GeoIP_id_by_ipnum(geoip, ip);
+          country = code_country(id > 0 ? GeoIP_code3_by_id(id) : 0);
+        }
+
+        int netmask = GeoIP_last_netmask(geoip);
+
+        if(netmask < 1 || netmask > 32)
+        {
+          netmask = 32;
+        }
+
+        uint64_t last = ip | (IPV4_MAX >> netmask);
+
+        if(country != El::Country::null)
+        {
+          v4.push_back(RangeV4(ip, last, country));
+        }
+
+        ip = last + 1;
+      }
+    }
+
+    void
+    AddressIndex::load_geoip_v6(GeoIP* geoip, RangeV6Array& v6)
+      throw(Exception, El::Exception)
+    {
+      int edition = GeoIP_database_edition(geoip);
+
+      bool city = edition == GEOIP_CITY_EDITION_REV0_V6 ||
+        edition == GEOIP_CITY_EDITION_REV1_V6;
+
+      if(!city && edition != GEOIP_COUNTRY_EDITION_V6)
+      {
+        std::ostringstream ostr;
+        ostr << "El::Geography::AddressIndex::load_geoip_v6: unsupported "
+          "database edition " << edition;
+
+        throw Exception(ostr.str());
+      }
+
+      IPv6 ip;
+      
+      while(true)
+      {
+        geoipv6_t addr;
+        
+        for(size_t i = 0; i < 8; ++i)
+        {
+          addr.s6_addr[i] = ip.hi >> (56 - i * 8);
+          addr.s6_addr[i + 8] = ip.lo >> (56 - i * 8);
+        }
+        
+        El::Country country;
+
+        if(city)
+        {
+          GeoIPRecord* rec = GeoIP_record_by_ipnum_v6(geoip, addr);
+
+          if(rec)
+          {
+            country = code_country(rec->country_code3);
+            GeoIPRecord_delete(rec);
+          }
+        }
+        else
+        {
+          int id = GeoIP_id_by_ipnum_v6(geoip, addr);
+          country = code_country(id > 0 ? GeoIP_code3_by_id(id) : 0);
+        }
+
+        int netmask = GeoIP_last_netmask(geoip);
+
+        if(netmask < 1 || netmask > 128)
+        {
+          netmask = 128;
+        }
+
+        IPv6 last(ip.hi | (netmask < 64 ? UINT64_MAX >> netmask : 0),
+                  ip.lo | (netmask <= 64 ? UINT64_MAX :
+                           (netmask < 128 ? UINT64_MAX >> (netmask - 64) :
+                            0)));
+
+        if(country != El::Country::null)
+        {
+          v6.push_back(RangeV6(ip, last, country));
+        }
+
+        if(last == IPv6(UINT64_MAX, UINT64_MAX))
+        {
+          break;
+        }
+        
+        ip = successor(last);
+      }
+    }
+
+    void
+    AddressIndex::load_csv(const char* csv_path)
+      throw(Exception, El::Exception)
+    {
+      std::fstream file(csv_path, std::ios::in);
+
+      if(!file.is_open())
+      {
+        std::ostringstream ostr;
+        ostr << "El::Geography::AddressIndex::load_csv: failed to open "
+          "file " << csv_path;
+
+        throw Exception(ostr.str());
+      }
+
+      RangeV4Array v4;
+      RangeV6Array v6;
+
+      std::string line;
+      std::vector<std::string> fields;
+
+      for(size_t line_num = 1; std::getline(file, line); ++line_num)
+      {
+        split_csv(line, fields);
+
+        if(fields.size() < 5)
+        {
+          continue;
+        }
+
+        uint32_t first_v4 = 0;
+        uint32_t last_v4 = 0;
+        IPv6 first_v6;
+        IPv6 last_v6;
+
+        AddressType type = parse(fields[0].c_str(), first_v4, first_v6);
+
+        if(type == AT_NONE)
+        {
+          // Header or comment line
+          continue;
+        }
+
+        if(parse(fields[1].c_str(), last_v4, last_v6) != type)
+        {
+          std::ostringstream ostr;
+          ostr << "El::Geography::AddressIndex::load_csv: invalid range "
+            "end '" << fields[1] << "' at line " << line_num << " of "
+               << csv_path;
+
+          throw Exception(ostr.str());
+        }
+
+        El::Country country;
+
+        try
+        {
+          country = El::Country(fields[4].c_str());
+        }
+        catch(const El::Country::Exception&)
+        {
+          // Anonymous proxies, satellite providers and alike
+          continue;
+        }
+
+        if(type == AT_IPV4)
+        {
+          if(first_v4 <= last_v4)
+          {
+            v4.push_back(RangeV4(first_v4, last_v4, country));
+          }
+        }
+        else if(first_v6 <= last_v6)
+        {
+          v6.push_back(RangeV6(first_v6, last_v6, country));
+        }
+      }
+
+      build(v4, v6);
+    }
+
+    template<typename ADDR>
+    void
+    AddressIndex::merge(std::vector< Range<ADDR> >& ranges)
+      throw(El::Exception)
+    {
+      std::sort(ranges.begin(), ranges.end());
+
+      size_t count = 0;
+
+      for(size_t i = 0; i < ranges.size(); ++i)
+      {
+        Range<ADDR> range = ranges[i];
+
+        if(count)
+        {
+          Range<ADDR>& prev = ranges[count - 1];
+
+          if(range.first <= prev.last)
+          {
+            // Overlapping ranges; first one wins
+
+            if(range.last <= prev.last)
+            {
+              continue;
+            }
+
+            range.first = successor(prev.last);
+          }
+
+          if(range.country == prev.country &&
+             successor(prev.last) == range.first)
+          {
+            prev.last = range.last;
+            continue;
+          }
+        }
+
+        ranges[count++] = range;
+      }
+
+      ranges.resize(count, Range<ADDR>(ADDR(), ADDR(), El::Country::null));
+    }
+
+    void
+    AddressIndex::build(RangeV4Array& v4, RangeV6Array& v6)
+      throw(Exception, El::Exception)
+    {
+      merge(v4);
+      merge(v6);
+
+      v4_first_.reserve(v4.size());
+      v4_last_.reserve(v4.size());
+      v4_country_.reserve(v4.size());
+
+      for(RangeV4Array::const_iterator it = v4.begin(); it != v4.end(); ++it)
+      {
+        v4_first_.push_back(it->first);
+        v4_last_.push_back(it->last);
+        v4_country_.push_back(it->country);
+      }
+
+      v4_slots_.resize(V4_SLOTS + 1);
+
+      size_t index = 0;
+
+      for(size_t slot = 0; slot <= V4_SLOTS; ++slot)
+      {
+        uint64_t bound = (uint64_t)slot << 16;
+
+        for(; index < v4_first_.size() && v4_first_[index] < bound; ++index);
+        v4_slots_[slot] = index;
+      }
+
+      v6_first_.reserve(v6.size());
+      v6_last_.reserve(v6.size());
+      v6_country_.reserve(v6.size());
+
+      for(RangeV6Array::const_iterator it = v6.begin(); it != v6.end(); ++it)
+      {
+        v6_first_.push_back(it->first);
+        v6_last_.push_back(it->last);
+        v6_country_.push_back(it->country);
+      }
+    }
+
+    AddressIndex::AddressType
+    AddressIndex::parse(const char* address, uint32_t& ipv4, IPv6& ipv6)
+      throw()
+    {
+      if(address == 0 || *address == '\0')
+      {
+        return AT_NONE;
+      }
+
+      struct in_addr addr4;
+
+      if(inet_pton(AF_INET, address, &addr4) == 1)
+      {
+        ipv4 = ntohl(addr4.s_addr);
+        return AT_IPV4;
+      }
+
+      if(strchr(address, ':') == 0)
+      {
+        return AT_NONE;
+      }
+
+      struct in6_addr addr6;
+
+      if(inet_pton(AF_INET6, address, &addr6) != 1)
+      {
+        return AT_NONE;
+      }
+
+      uint64_t hi = 0;
+      uint64_t lo = 0;
+
+      for(size_t i = 0; i < 8; ++i)
+      {
+        hi = (hi << 8) | addr6.s6_addr[i];
+        lo = (lo << 8) | addr6.s6_addr[i + 8];
+      }
+
+      if(hi == 0 && (lo >> 32) == 0xFFFF)
+      {
+        // IPv4-mapped address
+        ipv4 = lo & 0xFFFFFFFF;
+        return AT_IPV4;
+      }
+
+      ipv6 = IPv6(hi, lo);
+      return AT_IPV6;
+    }
+
+    El::Country
+    AddressIndex::country(const char* address) const throw()
+    {
+      uint32_t ipv4 = 0;
+      IPv6 ipv6;
+
+      switch(parse(address, ipv4, ipv6))
+      {
+      case AT_IPV4: return country(ipv4);
+      case AT_IPV6: return country(ipv6);
+      default: break;
+      }
+
+      return El::Country::null;
+    }
+  }
+}
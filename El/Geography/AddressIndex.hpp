@@ -0,0 +1,278 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Geography/AddressIndex.hpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#ifndef _ELEMENTS_EL_GEOGRAPHY_ADDRESSINDEX_HPP_
+#define _ELEMENTS_EL_GEOGRAPHY_ADDRESSINDEX_HPP_
+
+#include <stdint.h>
+
+#include <vector>
+#include <algorithm>
+
+#include <GeoIP.h>
+
+#include <El/Exception.hpp>
+#include <El/Country.hpp>
+#include <El/RefCount/All.hpp>
+#include <El/SyncPolicy.hpp>
+
+namespace El
+{
+  namespace Geography
+  {
+    //
+    // Immutable IP address range to country index. Once constructed
+    // can be queried concurrently without any locking.
+    //
+    class AddressIndex :
+      public virtual El::RefCount::DefaultImpl<El::Sync::ThreadPolicy>
+    {
+    public:
+      EL_EXCEPTION(Exception, El::ExceptionBase);
+
+      struct IPv6
+      {
+        uint64_t hi;
+        uint64_t lo;
+
+        IPv6(uint64_t h = 0, uint64_t l = 0) throw();
+
+        bool operator<(const IPv6& val) const throw();
+        bool operator<=(const IPv6& val) const throw();
+        bool operator==(const IPv6& val) const throw();
+      };
+
+      enum AddressType
+      {
+        AT_NONE,
+        AT_IPV4,
+        AT_IPV6
+      };
+
+    public:
+
+      // Enumerates IPv4 ranges of opened GeoIP country or city database
+      // and IPv6 ranges of IPv6 edition of one if geoip_v6 is not 0
+      AddressIndex(GeoIP* geoip, GeoIP* geoip_v6 = 0)
+        throw(Exception, El::Exception);
+
+      // Loads ranges from GeoIP CSV export of the format
+      // "first ip","last ip",...,"2 letter country code",...
+      // both IPv4 and IPv6 addresses are accepted
+      AddressIndex(const char* csv_path) throw(Exception, El::Exception);
+
+      virtual ~AddressIndex() throw() {}
+
+      El::Country country(uint32_t ip) const throw();
+      El::Country country(const IPv6& ip) const throw();
+
+      // Returns El::Country::null if address not found or address is not a
+      // numeric IPv4 or IPv6 one; no name resolution is ever made
+      El::Country country(const char* address) const throw();
+
+      size_t ipv4_ranges() const throw();
+      size_t ipv6_ranges() const throw();
+
+      static AddressType parse(const char* address,
+                               uint32_t& ipv4,
+                               IPv6& ipv6)
+        throw();
+
+    private:
+
+      template<typename ADDR>
+      struct Range
+      {
+        ADDR first;
+        ADDR last;
+        El::Country country;
+
+        Range(const ADDR& f, const ADDR& l, const El::Country& c) throw();
+        bool operator<(const Range& val) const throw();
+      };
+
+      typedef Range<uint32_t> RangeV4;
+      typedef Range<IPv6> RangeV6;
+
+      typedef std::vector<RangeV4> RangeV4Array;
+      typedef std::vector<RangeV6> RangeV6Array;
+
+      void load_geoip(GeoIP* geoip, GeoIP* geoip_v6)
+        throw(Exception, El::Exception);
+      
+      static void load_geoip_v4(GeoIP* geoip, RangeV4Array& v4)
+        throw(Exception, El::Exception);
+      
+      static void load_geoip_v6(GeoIP* geoip, RangeV6Array& v6)
+        throw(Exception, El::Exception);
+
+      void load_csv(const char* csv_path) throw(Exception, El::Exception);
+
+      void build(RangeV4Array& v4, RangeV6Array& v6)
+        throw(Exception, El::Exception);
+
+      template<typename ADDR>
+      static void merge(std::vector< Range<ADDR> >& ranges)
+        throw(El::Exception);
+
+    private:
+      typedef std::vector<uint32_t> UInt32Array;
+      typedef std::vector<IPv6> IPv6Array;
+      typedef std::vector<El::Country> CountryArray;
+
+      //
+      // Range bounds and countries are kept in separate arrays so binary
+      // search touches only densely packed range starts.
+      //
+      UInt32Array v4_first_;
+      UInt32Array v4_last_;
+      CountryArray v4_country_;
+
+      //
+      // v4_slots_[i] is the index of the first range starting at or after
+      // i << 16; narrows the search to ranges of a single /16 network.
+      //
+      UInt32Array v4_slots_;
+
+      IPv6Array v6_first_;
+      IPv6Array v6_last_;
+      CountryArray v6_country_;
+    };
+
+    typedef El::RefCount::SmartPtr<AddressIndex> AddressIndex_var;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Inlines
+///////////////////////////////////////////////////////////////////////////////
+
+namespace El
+{
+  namespace Geography
+  {
+    //
+    // AddressIndex::IPv6 struct
+    //
+    inline
+    AddressIndex::IPv6::IPv6(uint64_t h, uint64_t l) throw()
+        : hi(h),
+          lo(l)
+    {
+    }
+
+    inline
+    bool
+    AddressIndex::IPv6::operator<(const IPv6& val) const throw()
+    {
+      return hi < val.hi || (hi == val.hi && lo < val.lo);
+    }
+
+    inline
+    bool
+    AddressIndex::IPv6::operator<=(const IPv6& val) const throw()
+    {
+      return !(val < *this);
+    }
+
+    inline
+    bool
+    AddressIndex::IPv6::operator==(const IPv6& val) const throw()
+    {
+      return hi == val.hi && lo == val.lo;
+    }
+
+    //
+    // AddressIndex::Range struct
+    //
+    template<typename ADDR>
+    AddressIndex::Range<ADDR>::Range(const ADDR& f,
+                                     const ADDR& l,
+                                     const El::Country& c) throw()
+        : first(f),
+          last(l),
+          country(c)
+    {
+    }
+
+    template<typename ADDR>
+    bool
+    AddressIndex::Range<ADDR>::operator<(const Range& val) const throw()
+    {
+      return first < val.first;
+    }
+
+    //
+    // AddressIndex class
+    //
+    inline
+    El::Country
+    AddressIndex::country(uint32_t ip) const throw()
+    {
+      if(v4_first_.empty())
+      {
+        return El::Country::null;
+      }
+
+      size_t slot = ip >> 16;
+
+      const uint32_t* begin = &v4_first_[0];
+
+      const uint32_t* it = std::upper_bound(begin + v4_slots_[slot],
+                                            begin + v4_slots_[slot + 1],
+                                            ip);
+
+      if(it == begin)
+      {
+        return El::Country::null;
+      }
+
+      size_t index = it - begin - 1;
+
+      return ip <= v4_last_[index] ? v4_country_[index] : El::Country::null;
+    }
+
+    inline
+    El::Country
+    AddressIndex::country(const IPv6& ip) const throw()
+    {
+      IPv6Array::const_iterator it =
+        std::upper_bound(v6_first_.begin(), v6_first_.end(), ip);
+
+      if(it == v6_first_.begin())
+      {
+        return El::Country::null;
+      }
+
+      size_t index = it - v6_first_.begin() - 1;
+
+      return ip <= v6_last_[index] ? v6_country_[index] : El::Country::null;
+    }
+
+    inline
+    size_t
+    AddressIndex::ipv4_ranges() const throw()
+    {
+      return v4_first_.size();
+    }
+
+    inline
+    size_t
+    AddressIndex::ipv6_ranges() const throw()
+    {
+      return v6_first_.size();
+    }
+  }
+}
+
+#endif // _ELEMENTS_EL_GEOGRAPHY_ADDRESSINDEX_HPP_
@@ -11,6 +11,10 @@
  * $id:$
  */
 
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
 #include <sstream>
 
 #include <ace/OS.h>
@@ -25,9 +29,18 @@ namespace El
 {
   namespace Geography
   {
-    AddressInfo::AddressInfo(GeoIPDBTypes type, unsigned long flags)
+    AddressInfo::AddressInfo(GeoIPDBTypes type,
+                             unsigned long flags,
+                             time_t check_period)
       throw(Exception, El::Exception)
-        : geoip_(GeoIP_open_type(type, flags))
+        : flags_(flags),
+          check_period_(check_period),
+          geoip_(GeoIP_open_type(type, flags)),
+          mtime_(0),
+          mtime_v6_(0),
+          next_check_(0),
+          thread_started_(false),
+          reloading_(false)
     {
       if(geoip_ == 0)
       {
@@ -37,49 +50,313 @@ namespace El
 
         throw Exception(ostr.str());
       }
+
+      if(GeoIPDBFileName && GeoIPDBFileName[type])
+      {
+        filepath_ = GeoIPDBFileName[type];
+
+        GeoIPDBTypes type_v6 = type == GEOIP_COUNTRY_EDITION ?
+          GEOIP_COUNTRY_EDITION_V6 : (type == GEOIP_CITY_EDITION_REV0 ?
+                                      GEOIP_CITY_EDITION_REV0_V6 :
+                                      GEOIP_CITY_EDITION_REV1_V6);
+
+        if(GeoIP_db_avail(type_v6) && GeoIPDBFileName[type_v6])
+        {
+          filepath_v6_ = GeoIPDBFileName[type_v6];
+        }
+      }
+
+      open();
     }
     
-    AddressInfo::AddressInfo(const char* filepath, unsigned long flags)
+    AddressInfo::AddressInfo(const char* filepath,
+                             unsigned long flags,
+                             time_t check_period,
+                             const char* filepath_v6)
       throw(Exception, El::Exception)
-        : geoip_(GeoIP_open(filepath, flags))
+        : filepath_(filepath ? filepath : ""),
+          filepath_v6_(filepath_v6 ? filepath_v6 : ""),
+          flags_(flags),
+          check_period_(check_period),
+          geoip_(0),
+          mtime_(0),
+          mtime_v6_(0),
+          next_check_(0),
+          thread_started_(false),
+          reloading_(false)
     {
-      if(geoip_ == 0)
+      if(!csv())
+      {
+        geoip_ = GeoIP_open(filepath_.c_str(), flags);
+
+        if(geoip_ == 0)
+        {
+          std::ostringstream ostr;
+          ostr << "El::Geography::AddressInfo::AddressInfo: GeoIP_open "
+            "failed for flags " << flags << ", file " << filepath_;
+
+          throw Exception(ostr.str());
+        }
+      }
+
+      open();
+    }
+
+    void
+    AddressInfo::open() throw(Exception, El::Exception)
+    {
+      try
+      {
+        if(filepath_.empty())
+        {
+          AddressIndex_var index = new AddressIndex(geoip_);
+
+          Guard guard(update_lock_);
+          publish_index(index.in());
+        }
+        else
+        {
+          reload(true);
+        }
+      }
+      catch(...)
+      {
+        if(geoip_)
+        {
+          GeoIP_delete(geoip_);
+          geoip_ = 0;
+        }
+        
+        throw;
+      }
+
+      next_check_ = ACE_OS::time() + check_period_;
+    }
+
+    bool
+    AddressInfo::csv() const throw()
+    {
+      return filepath_.size() > 4 &&
+        strcasecmp(filepath_.c_str() + filepath_.size() - 4, ".csv") == 0;
+    }
+
+    time_t
+    AddressInfo::file_mtime(const std::string& filepath) throw()
+    {
+      struct stat64 file_stat;
+      
+      return ::stat64(filepath.c_str(), &file_stat) == -1 ? 0 :
+        file_stat.st_mtime;
+    }
+
+    GeoIP*
+    AddressInfo::open_cached(const std::string& filepath)
+      throw(Exception, El::Exception)
+    {
+      //
+      // Memory cached handle makes enumeration of database networks
+      // much faster.
+      //
+      GeoIP* geoip = GeoIP_open(filepath.c_str(), GEOIP_MEMORY_CACHE);
+        
+      if(geoip == 0)
       {
         std::ostringstream ostr;
-        ostr << "El::Geography::AddressInfo::AddressInfo: GeoIP_open failed "
-          "for flags " << flags << ", file " << filepath;
+        ostr << "El::Geography::AddressInfo::open_cached: GeoIP_open "
+          "failed for file " << filepath;
 
         throw Exception(ostr.str());
       }
-    }
 
-/*    
-    // CityEdition edition
-    El::Country
-    AddressInfo::country(const char* host) throw(Exception, El::Exception)
+      return geoip;
+    }
+    
+    bool
+    AddressInfo::reload(bool force) throw(Exception, El::Exception)
     {
-      Guard guard(lock_);
+      Guard guard(update_lock_);
+
+      time_t mtime = file_mtime(filepath_);
+      time_t mtime_v6 = filepath_v6_.empty() ? 0 : file_mtime(filepath_v6_);
+
+      if(!force && mtime == mtime_ && mtime_v6 == mtime_v6_)
+      {
+        return false;
+      }
+
+      AddressIndex_var index;
+
+      if(csv())
+      {
+        index = new AddressIndex(filepath_.c_str());
+      }
+      else
+      {
+        // Lookups by host name go on with the old handle
+        GeoIP* geoip = open_cached(filepath_);
+        GeoIP* geoip_v6 = 0;
+
+        try
+        {
+          if(!filepath_v6_.empty())
+          {
+            geoip_v6 = open_cached(filepath_v6_);
+          }
+          
+          index = new AddressIndex(geoip, geoip_v6);
+        }
+        catch(...)
+        {
+          GeoIP_delete(geoip);
+
+          if(geoip_v6)
+          {
+            GeoIP_delete(geoip_v6);
+          }
+          
+          throw;
+        }
+        
+        GeoIP_delete(geoip);
+
+        if(geoip_v6)
+        {
+          GeoIP_delete(geoip_v6);
+        }
+
+        if(mtime_)
+        {
+          geoip = GeoIP_open(filepath_.c_str(), flags_);
+
+          if(geoip)
+          {
+            {
+              Guard guard(lock_);
+              std::swap(geoip, geoip_);
+            }
+
+            GeoIP_delete(geoip);
+          }
+        }
+      }
+
+      mtime_ = mtime;
+      mtime_v6_ = mtime_v6;
       
-      const char* ccode = GeoIP_country_code3_by_name(geoip_, host);
+      publish_index(index.in());
+
+      return true;
+    }
+
+    void
+    AddressInfo::publish_index(AddressIndex* index) throw(El::Exception)
+    {
+      // Previous index is released when readers looking into it are gone
+      index_.publish(new AddressIndex_var(El::RefCount::add_ref(index)));
+    }
+
+    void
+    AddressInfo::check_update() throw()
+    {
+      time_t now = ACE_OS::time();
+
+      if(now < next_check_)
+      {
+        return;
+      }
+
+      if(thread_lock_.tryacquire() != 0)
+      {
+        // Other thread is checking
+        return;
+      }
+
+      if(now >= next_check_)
+      {
+        next_check_ = now + check_period_;
+
+        // Previous reload is still in progress otherwise
+        if(!__atomic_load_n(&reloading_, __ATOMIC_ACQUIRE))
+        {
+          if(thread_started_)
+          {
+            pthread_join(thread_, 0);
+            thread_started_ = false;
+          }
+
+          reloading_ = true;
+
+          if(pthread_create(&thread_, 0, reload_thread, this) == 0)
+          {
+            thread_started_ = true;
+          }
+          else
+          {
+            // Will try on next check
+            reloading_ = false;
+          }
+        }
+      }
+
+      thread_lock_.release();
+    }
+
+    void*
+    AddressInfo::reload_thread(void* arg) throw()
+    {
+      AddressInfo* info = static_cast<AddressInfo*>(arg);
 
       try
       {
-        return ccode ? El::Country(ccode) : El::Country::null;
+        info->reload(false);
       }
-      catch(const El::Country::Exception&)
+      catch(...)
       {
-        return El::Country::null;
+        // Keep working with the old index
       }
+
+      __atomic_store_n(&info->reloading_, false, __ATOMIC_RELEASE);
+      return 0;
     }
-*/
 
-    // CityEdition: 
     El::Country
     AddressInfo::country(const char* host) throw(Exception, El::Exception)
+    {
+      if(check_period_)
+      {
+        check_update();
+      }
+
+      uint32_t ipv4 = 0;
+      AddressIndex::IPv6 ipv6;
+
+      AddressIndex::AddressType type =
+        AddressIndex::parse(host, ipv4, ipv6);
+
+      if(type != AddressIndex::AT_NONE)
+      {
+        IndexSnapshot::Reader index(index_);
+        
+        return type == AddressIndex::AT_IPV4 ?
+          index->in()->country(ipv4) : index->in()->country(ipv6);
+      }
+
+      return geoip_country(host);
+    }
+
+    // CityEdition: 
+    El::Country
+    AddressInfo::geoip_country(const char* host)
+      throw(Exception, El::Exception)
     {
       El::Country country;
       
       Guard guard(lock_);
+
+      if(geoip_ == 0)
+      {
+        return country;
+      }
       
       GeoIPRecord* rec = GeoIP_record_by_name(geoip_, host);
 
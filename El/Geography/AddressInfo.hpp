@@ -14,6 +14,11 @@
 #ifndef _ELEMENTS_EL_GEOGRAPHY_ADDRESS_INFO_HPP_
 #define _ELEMENTS_EL_GEOGRAPHY_ADDRESS_INFO_HPP_
 
+#include <time.h>
+#include <pthread.h>
+
+#include <string>
+
 #include <ace/OS.h>
 #include <ace/Synch.h>
 #include <ace/Guard_T.h>
@@ -22,38 +27,109 @@
 
 #include <El/Exception.hpp>
 #include <El/Country.hpp>
+#include <El/Snapshot.hpp>
+
+#include <El/Geography/AddressIndex.hpp>
 
 namespace El
 {
   namespace Geography
   {
+    //
+    // Numeric addresses are looked up in AddressIndex built from the
+    // database without taking any lock. The index is rebuilt and published
+    // as El::Sync::Snapshot when database file modification is detected
+    // (checked not more often than once per check_period seconds, 0
+    // disables the check). The check is made by a background thread, so
+    // lookups go on with the old index while a new one is being built.
+    // Host names are passed to the GeoIP library which is serialized.
+    //
+    // IPv6 ranges are loaded from IPv6 edition of the database if
+    // available. A file path ending with ".csv" is loaded as a GeoIP CSV
+    // export containing both IPv4 and IPv6 ranges; host names are not
+    // resolved in this case.
+    //
     class AddressInfo
     {
     public:    
       EL_EXCEPTION(Exception, El::ExceptionBase);
+
+      static const time_t DEFAULT_CHECK_PERIOD = 60;
       
     public:
       // CityEdition: GEOIP_CITY_EDITION_REV1
       // CountryEdition: GEOIP_COUNTRY_EDITION
       AddressInfo(GeoIPDBTypes type = GEOIP_CITY_EDITION_REV1,
-                  unsigned long flags = GEOIP_STANDARD)
+                  unsigned long flags = GEOIP_STANDARD,
+                  time_t check_period = DEFAULT_CHECK_PERIOD)
         throw(Exception, El::Exception);
       
       AddressInfo(const char* filepath,
-                  unsigned long flags = GEOIP_STANDARD)
+                  unsigned long flags = GEOIP_STANDARD,
+                  time_t check_period = DEFAULT_CHECK_PERIOD,
+                  const char* filepath_v6 = 0)
         throw(Exception, El::Exception);
 
       ~AddressInfo() throw();
 
       El::Country country(const char* host) throw(Exception, El::Exception);
 
+      // Bypasses the index; for verification purposes
+      El::Country geoip_country(const char* host)
+        throw(Exception, El::Exception);
+
+      // Rebuilds the index if database file changed since last load;
+      // returns true if index was replaced
+      bool reload(bool force = false) throw(Exception, El::Exception);
+
+      AddressIndex* index() const throw(El::Exception);
+      
+    private:
+      void open() throw(Exception, El::Exception);
+      void publish_index(AddressIndex* index) throw(El::Exception);
+      void check_update() throw();
+
+      static void* reload_thread(void* arg) throw();
+
+      bool csv() const throw();
+      
+      static time_t file_mtime(const std::string& filepath) throw();
+      
+      static GeoIP* open_cached(const std::string& filepath)
+        throw(Exception, El::Exception);
+
     private:
       typedef ACE_Thread_Mutex Mutex;
       typedef ACE_Guard<Mutex> Guard;
-      
-      Mutex lock_;
 
+      typedef El::Sync::Snapshot<AddressIndex_var> IndexSnapshot;
+
+      std::string filepath_;
+      std::string filepath_v6_;
+      unsigned long flags_;
+      time_t check_period_;
+
+      Mutex lock_;
       GeoIP* geoip_;
+
+      //
+      // Readers access index_ with no lock; update_lock_ serializes
+      // reloads only.
+      //
+      Mutex update_lock_;
+      IndexSnapshot index_;
+
+      time_t mtime_;
+      time_t mtime_v6_;
+      volatile time_t next_check_;
+
+      // Serializes starting of reload thread
+      Mutex thread_lock_;
+      pthread_t thread_;
+      bool thread_started_;
+
+      // Set while reload thread runs
+      bool reloading_;
     };
   }
 }
@@ -66,14 +142,30 @@ namespace El
 {
   namespace Geography
   {
+    //
+    // AddressInfo class
+    //
     inline
     AddressInfo::~AddressInfo() throw()
     {
+      if(thread_started_)
+      {
+        pthread_join(thread_, 0);
+      }
+
       if(geoip_)
       {
         GeoIP_delete(geoip_);
       }
     }
+
+    inline
+    AddressIndex*
+    AddressInfo::index() const throw(El::Exception)
+    {
+      IndexSnapshot::Reader index(index_);
+      return index.get() ? El::RefCount::add_ref(index->in()) : 0;
+    }
   }
 }
 
@@ -350,8 +350,7 @@ namespace El
     size_t
     Guid::operator()(const El::Guid& guid) const throw(El::Exception)
     {
-      return __gnu_cxx::__stl_hash_string(
-        guid.string(El::Guid::GF_DENSE).c_str());
+      return hash64((const unsigned char*)guid, sizeof(guid));
     }
   }
 }
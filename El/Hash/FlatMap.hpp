@@ -0,0 +1,117 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Hash/FlatMap.hpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#ifndef _ELEMENTS_EL_HASH_FLATMAP_HPP_
+#define _ELEMENTS_EL_HASH_FLATMAP_HPP_
+
+#include <utility>
+
+#include <El/Hash/Hash.hpp>
+#include <El/Hash/FlatTable.hpp>
+
+namespace El
+{
+  namespace Hash
+  {
+    //
+    // Drop-in replacement for __gnu_cxx::hash_map where element address
+    // stability is not required. Lookup accepts any type HASH and EQUAL
+    // can handle, so std::string keyed map can be searched by const char*.
+    //
+    template<typename KEY,
+             typename VALUE,
+             typename HASH = __gnu_cxx::hash<KEY>,
+             typename EQUAL = El::Hash::Equal>
+    class FlatMap :
+      public FlatTable<std::pair<const KEY, VALUE>,
+                       KEY,
+                       Flat::SelectFirst< std::pair<const KEY, VALUE> >,
+                       HASH,
+                       EQUAL>
+    {
+    public:
+      typedef FlatTable<std::pair<const KEY, VALUE>,
+                        KEY,
+                        Flat::SelectFirst< std::pair<const KEY, VALUE> >,
+                        HASH,
+                        EQUAL>
+      Table;
+
+      typedef VALUE mapped_type;
+      typedef VALUE data_type;
+      typedef typename Table::value_type value_type;
+      typedef typename Table::iterator iterator;
+      typedef typename Table::const_iterator const_iterator;
+
+    public:
+      FlatMap(size_t elements = 0,
+              const HASH& hash = HASH(),
+              const EQUAL& equal = EQUAL())
+        throw(El::Exception);
+
+      template<typename IT>
+      FlatMap(IT first, IT last) throw(El::Exception);
+
+      VALUE& operator[](const KEY& key) throw(El::Exception);
+    };
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Inlines
+///////////////////////////////////////////////////////////////////////////////
+
+namespace El
+{
+  namespace Hash
+  {
+    //
+    // FlatMap class
+    //
+    template<typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline
+    FlatMap<KEY, VALUE, HASH, EQUAL>::FlatMap(size_t elements,
+                                              const HASH& hash,
+                                              const EQUAL& equal)
+      throw(El::Exception)
+        : Table(elements, hash, equal)
+    {
+    }
+
+    template<typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    template<typename IT>
+    FlatMap<KEY, VALUE, HASH, EQUAL>::FlatMap(IT first, IT last)
+      throw(El::Exception)
+    {
+      this->insert(first, last);
+    }
+
+    template<typename KEY, typename VALUE, typename HASH, typename EQUAL>
+    inline
+    VALUE&
+    FlatMap<KEY, VALUE, HASH, EQUAL>::operator[](const KEY& key)
+      throw(El::Exception)
+    {
+      iterator it = this->find(key);
+
+      if(it == this->end())
+      {
+        it = this->insert(value_type(key, VALUE())).first;
+      }
+
+      return it->second;
+    }
+  }
+}
+
+#endif // _ELEMENTS_EL_HASH_FLATMAP_HPP_
@@ -0,0 +1,114 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Hash/FlatSet.hpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#ifndef _ELEMENTS_EL_HASH_FLATSET_HPP_
+#define _ELEMENTS_EL_HASH_FLATSET_HPP_
+
+#include <El/Hash/Hash.hpp>
+#include <El/Hash/FlatTable.hpp>
+
+namespace El
+{
+  namespace Hash
+  {
+    //
+    // Drop-in replacement for __gnu_cxx::hash_set; see FlatMap
+    //
+    template<typename KEY,
+             typename HASH = __gnu_cxx::hash<KEY>,
+             typename EQUAL = El::Hash::Equal>
+    class FlatSet :
+      public FlatTable<KEY, KEY, Flat::Identity<KEY>, HASH, EQUAL>
+    {
+    public:
+      typedef FlatTable<KEY, KEY, Flat::Identity<KEY>, HASH, EQUAL> Table;
+
+      // Elements are never modifiable in place
+      typedef typename Table::const_iterator iterator;
+      typedef typename Table::const_iterator const_iterator;
+
+    public:
+      FlatSet(size_t elements = 0,
+              const HASH& hash = HASH(),
+              const EQUAL& equal = EQUAL())
+        throw(El::Exception);
+
+      template<typename IT>
+      FlatSet(IT first, IT last) throw(El::Exception);
+
+      const_iterator begin() const throw();
+      const_iterator end() const throw();
+
+      template<typename K>
+      const_iterator find(const K& key) const throw(El::Exception);
+    };
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Inlines
+///////////////////////////////////////////////////////////////////////////////
+
+namespace El
+{
+  namespace Hash
+  {
+    //
+    // FlatSet class
+    //
+    template<typename KEY, typename HASH, typename EQUAL>
+    inline
+    FlatSet<KEY, HASH, EQUAL>::FlatSet(size_t elements,
+                                       const HASH& hash,
+                                       const EQUAL& equal)
+      throw(El::Exception)
+        : Table(elements, hash, equal)
+    {
+    }
+
+    template<typename KEY, typename HASH, typename EQUAL>
+    template<typename IT>
+    FlatSet<KEY, HASH, EQUAL>::FlatSet(IT first, IT last)
+      throw(El::Exception)
+    {
+      this->insert(first, last);
+    }
+
+    template<typename KEY, typename HASH, typename EQUAL>
+    inline
+    typename FlatSet<KEY, HASH, EQUAL>::const_iterator
+    FlatSet<KEY, HASH, EQUAL>::begin() const throw()
+    {
+      return Table::begin();
+    }
+
+    template<typename KEY, typename HASH, typename EQUAL>
+    inline
+    typename FlatSet<KEY, HASH, EQUAL>::const_iterator
+    FlatSet<KEY, HASH, EQUAL>::end() const throw()
+    {
+      return Table::end();
+    }
+
+    template<typename KEY, typename HASH, typename EQUAL>
+    template<typename K>
+    inline
+    typename FlatSet<KEY, HASH, EQUAL>::const_iterator
+    FlatSet<KEY, HASH, EQUAL>::find(const K& key) const throw(El::Exception)
+    {
+      return Table::find(key);
+    }
+  }
+}
+
+#endif // _ELEMENTS_EL_HASH_FLATSET_HPP_
@@ -0,0 +1,1107 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Hash/FlatTable.hpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#ifndef _ELEMENTS_EL_HASH_FLATTABLE_HPP_
+#define _ELEMENTS_EL_HASH_FLATTABLE_HPP_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <new>
+#include <utility>
+#include <iterator>
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+#include <El/Exception.hpp>
+
+namespace El
+{
+  namespace Hash
+  {
+    //
+    // Key comparison allowing lookup by a type other than the key type
+    // (i.e. std::string key found by const char*) without constructing a
+    // temporary key.
+    //
+    struct Equal
+    {
+      template<typename A, typename B>
+      bool operator()(const A& a, const B& b) const;
+    };
+
+    namespace Flat
+    {
+      //
+      // Control byte per slot: EMPTY, DELETED or 7 low bits of element
+      // hash for a full slot.
+      //
+      typedef signed char Ctrl;
+
+      const Ctrl CTRL_EMPTY = -128;
+      const Ctrl CTRL_DELETED = -2;
+
+      const size_t GROUP_SIZE = 16;
+
+      //
+      // 16 control bytes matched at once; SSE2 when available
+      //
+      class Group
+      {
+      public:
+        Group(const Ctrl* pos) throw();
+
+        uint32_t match(Ctrl h2) const throw();
+        uint32_t match_empty() const throw();
+        uint32_t match_empty_or_deleted() const throw();
+
+      private:
+#ifdef __SSE2__
+        __m128i ctrl_;
+#else
+        const Ctrl* ctrl_;
+#endif
+      };
+
+      unsigned long trailing_zeros(uint32_t mask) throw();
+      unsigned long leading_zeros(uint32_t mask) throw();
+
+      template<typename VALUE>
+      struct Identity
+      {
+        const VALUE& operator()(const VALUE& val) const throw();
+      };
+
+      template<typename PAIR>
+      struct SelectFirst
+      {
+        const typename PAIR::first_type& operator()(const PAIR& val) const
+          throw();
+      };
+    }
+
+    //
+    // Open addressing hash table keeping elements in a single array
+    // (Swiss table layout). Element addresses are not stable: insertion
+    // may relocate all elements. Erasure does not invalidate iterators
+    // other than the erased one.
+    //
+    template<typename VALUE,
+             typename KEY,
+             typename KEY_OF,
+             typename HASH,
+             typename EQUAL>
+    class FlatTable
+    {
+    public:
+      typedef KEY key_type;
+      typedef VALUE value_type;
+      typedef HASH hasher;
+      typedef EQUAL key_equal;
+      typedef size_t size_type;
+      typedef ptrdiff_t difference_type;
+
+      template<typename REF, typename PTR>
+      class Iterator
+      {
+      public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef VALUE value_type;
+        typedef ptrdiff_t difference_type;
+        typedef PTR pointer;
+        typedef REF reference;
+
+        Iterator() throw();
+
+        Iterator(const Flat::Ctrl* ctrl,
+                 VALUE* slot,
+                 const Flat::Ctrl* end)
+          throw();
+
+        template<typename R, typename P>
+        Iterator(const Iterator<R, P>& src) throw();
+
+        REF operator*() const throw();
+        PTR operator->() const throw();
+
+        Iterator& operator++() throw();
+        Iterator operator++(int) throw();
+
+        template<typename R, typename P>
+        bool operator==(const Iterator<R, P>& val) const throw();
+
+        template<typename R, typename P>
+        bool operator!=(const Iterator<R, P>& val) const throw();
+
+      private:
+        void skip_free() throw();
+
+      private:
+        template<typename, typename> friend class Iterator;
+        friend class FlatTable;
+
+        const Flat::Ctrl* ctrl_;
+        VALUE* slot_;
+        const Flat::Ctrl* end_;
+      };
+
+      typedef Iterator<VALUE&, VALUE*> iterator;
+      typedef Iterator<const VALUE&, const VALUE*> const_iterator;
+
+    public:
+      FlatTable(size_t elements = 0,
+                const HASH& hash = HASH(),
+                const EQUAL& equal = EQUAL())
+        throw(El::Exception);
+
+      FlatTable(const FlatTable& src) throw(El::Exception);
+
+      ~FlatTable() throw();
+
+      FlatTable& operator=(const FlatTable& src) throw(El::Exception);
+
+      iterator begin() throw();
+      iterator end() throw();
+      const_iterator begin() const throw();
+      const_iterator end() const throw();
+
+      size_t size() const throw();
+      bool empty() const throw();
+
+      // Number of slots
+      size_t bucket_count() const throw();
+
+      // Bytes allocated for slots and control bytes
+      size_t memory_size() const throw();
+
+      void clear() throw();
+
+      // Makes room for at least elements without further rehashing
+      void reserve(size_t elements) throw(El::Exception);
+      void resize(size_t elements) throw(El::Exception);
+
+      void swap(FlatTable& val) throw();
+
+      std::pair<iterator, bool> insert(const VALUE& value)
+        throw(El::Exception);
+
+      template<typename IT>
+      void insert(IT first, IT last) throw(El::Exception);
+
+      template<typename K>
+      iterator find(const K& key) throw(El::Exception);
+
+      template<typename K>
+      const_iterator find(const K& key) const throw(El::Exception);
+
+      template<typename K>
+      size_t count(const K& key) const throw(El::Exception);
+
+      template<typename K>
+      size_t erase(const K& key) throw(El::Exception);
+
+      void erase(iterator it) throw();
+      void erase(const_iterator it) throw();
+
+    protected:
+      template<typename K>
+      size_t find_index(const K& key) const throw(El::Exception);
+
+      // Returns index of the slot the element with such hash should be
+      // constructed in; marks the slot full
+      size_t prepare_insert(size_t hash) throw(El::Exception);
+
+      void erase_index(size_t index) throw();
+
+      void set_ctrl(size_t index, Flat::Ctrl ctrl) throw();
+      void rehash(size_t capacity) throw(El::Exception);
+
+      iterator iterator_at(size_t index) throw();
+      const_iterator iterator_at(size_t index) const throw();
+
+      static size_t mix(size_t hash) throw();
+      static size_t capacity_for(size_t elements) throw();
+
+      static Flat::Ctrl* empty_ctrl() throw();
+
+    protected:
+      Flat::Ctrl* ctrl_;
+      VALUE* slots_;
+      size_t capacity_;
+      size_t size_;
+      size_t growth_left_;
+
+      HASH hash_func_;
+      EQUAL equal_func_;
+      KEY_OF key_of_;
+    };
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Inlines
+///////////////////////////////////////////////////////////////////////////////
+
+namespace El
+{
+  namespace Hash
+  {
+    //
+    // Equal struct
+    //
+    template<typename A, typename B>
+    inline
+    bool
+    Equal::operator()(const A& a, const B& b) const
+    {
+      return a == b;
+    }
+
+    namespace Flat
+    {
+      //
+      // Group class
+      //
+#ifdef __SSE2__
+      inline
+      Group::Group(const Ctrl* pos) throw()
+          : ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos)))
+      {
+      }
+
+      inline
+      uint32_t
+      Group::match(Ctrl h2) const throw()
+      {
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl_));
+      }
+
+      inline
+      uint32_t
+      Group::match_empty() const throw()
+      {
+        return _mm_movemask_epi8(
+          _mm_cmpeq_epi8(_mm_set1_epi8(CTRL_EMPTY), ctrl_));
+      }
+
+      inline
+      uint32_t
+      Group::match_empty_or_deleted() const throw()
+      {
+        // Both EMPTY and DELETED are less than -1, full slots are not
+        return _mm_movemask_epi8(
+          _mm_cmpgt_epi8(_mm_set1_epi8(-1), ctrl_));
+      }
+#else
+      inline
+      Group::Group(const Ctrl* pos) throw()
+          : ctrl_(pos)
+      {
+      }
+
+      inline
+      uint32_t
+      Group::match(Ctrl h2) const throw()
+      {
+        uint32_t mask = 0;
+
+        for(size_t i = 0; i < GROUP_SIZE; ++i)
+        {
+          mask |= (uint32_t)(ctrl_[i] == h2) << i;
+        }
+
+        return mask;
+      }
+
+      inline
+      uint32_t
+      Group::match_empty() const throw()
+      {
+        return match(CTRL_EMPTY);
+      }
+
+      inline
+      uint32_t
+      Group::match_empty_or_deleted() const throw()
+      {
+        uint32_t mask = 0;
+
+        for(size_t i = 0; i < GROUP_SIZE; ++i)
+        {
+          mask |= (uint32_t)(ctrl_[i] < -1) << i;
+        }
+
+        return mask;
+      }
+#endif
+
+      inline
+      unsigned long
+      trailing_zeros(uint32_t mask) throw()
+      {
+        return mask ? __builtin_ctz(mask) : GROUP_SIZE;
+      }
+
+      inline
+      unsigned long
+      leading_zeros(uint32_t mask) throw()
+      {
+        // For GROUP_SIZE bit mask
+        return mask ? __builtin_clz(mask) - (32 - GROUP_SIZE) : GROUP_SIZE;
+      }
+
+      //
+      // Identity struct
+      //
+      template<typename VALUE>
+      inline
+      const VALUE&
+      Identity<VALUE>::operator()(const VALUE& val) const throw()
+      {
+        return val;
+      }
+
+      //
+      // SelectFirst struct
+      //
+      template<typename PAIR>
+      inline
+      const typename PAIR::first_type&
+      SelectFirst<PAIR>::operator()(const PAIR& val) const throw()
+      {
+        return val.first;
+      }
+    }
+
+    //
+    // FlatTable::Iterator class
+    //
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    template<typename REF, typename PTR>
+    inline
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::Iterator<REF, PTR>::
+    Iterator() throw()
+        : ctrl_(0),
+          slot_(0),
+          end_(0)
+    {
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    template<typename REF, typename PTR>
+    inline
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::Iterator<REF, PTR>::
+    Iterator(const Flat::Ctrl* ctrl, VALUE* slot, const Flat::Ctrl* end)
+      throw()
+        : ctrl_(ctrl),
+          slot_(slot),
+          end_(end)
+    {
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    template<typename REF, typename PTR>
+    template<typename R, typename P>
+    inline
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::Iterator<REF, PTR>::
+    Iterator(const Iterator<R, P>& src) throw()
+        : ctrl_(src.ctrl_),
+          slot_(src.slot_),
+          end_(src.end_)
+    {
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    template<typename REF, typename PTR>
+    inline
+    REF
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::Iterator<REF, PTR>::
+    operator*() const throw()
+    {
+      return *slot_;
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    template<typename REF, typename PTR>
+    inline
+    PTR
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::Iterator<REF, PTR>::
+    operator->() const throw()
+    {
+      return slot_;
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    template<typename REF, typename PTR>
+    inline
+    void
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::Iterator<REF, PTR>::
+    skip_free() throw()
+    {
+      for(; ctrl_ != end_ && *ctrl_ < 0; ++ctrl_, ++slot_);
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    template<typename REF, typename PTR>
+    inline
+    typename FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::
+    template Iterator<REF, PTR>&
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::Iterator<REF, PTR>::
+    operator++() throw()
+    {
+      ++ctrl_;
+      ++slot_;
+      skip_free();
+      return *this;
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    template<typename REF, typename PTR>
+    inline
+    typename FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::
+    template Iterator<REF, PTR>
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::Iterator<REF, PTR>::
+    operator++(int) throw()
+    {
+      Iterator it(*this);
+      ++(*this);
+      return it;
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    template<typename REF, typename PTR>
+    template<typename R, typename P>
+    inline
+    bool
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::Iterator<REF, PTR>::
+    operator==(const Iterator<R, P>& val) const throw()
+    {
+      return ctrl_ == val.ctrl_;
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    template<typename REF, typename PTR>
+    template<typename R, typename P>
+    inline
+    bool
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::Iterator<REF, PTR>::
+    operator!=(const Iterator<R, P>& val) const throw()
+    {
+      return ctrl_ != val.ctrl_;
+    }
+
+    //
+    // FlatTable class
+    //
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    Flat::Ctrl*
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::empty_ctrl() throw()
+    {
+      //
+      // Shared by all empty tables so lookups need no special casing
+      //
+      static Flat::Ctrl ctrl[Flat::GROUP_SIZE] =
+      {
+        Flat::CTRL_EMPTY, Flat::CTRL_EMPTY, Flat::CTRL_EMPTY,
+        Flat::CTRL_EMPTY, Flat::CTRL_EMPTY, Flat::CTRL_EMPTY,
+        Flat::CTRL_EMPTY, Flat::CTRL_EMPTY, Flat::CTRL_EMPTY,
+        Flat::CTRL_EMPTY, Flat::CTRL_EMPTY, Flat::CTRL_EMPTY,
+        Flat::CTRL_EMPTY, Flat::CTRL_EMPTY, Flat::CTRL_EMPTY,
+        Flat::CTRL_EMPTY
+      };
+
+      return ctrl;
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::FlatTable(size_t elements,
+                                                          const HASH& hash,
+                                                          const EQUAL& equal)
+      throw(El::Exception)
+        : ctrl_(empty_ctrl()),
+          slots_(0),
+          capacity_(0),
+          size_(0),
+          growth_left_(0),
+          hash_func_(hash),
+          equal_func_(equal)
+    {
+      if(elements)
+      {
+        rehash(capacity_for(elements));
+      }
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::FlatTable(
+      const FlatTable& src) throw(El::Exception)
+        : ctrl_(empty_ctrl()),
+          slots_(0),
+          capacity_(0),
+          size_(0),
+          growth_left_(0),
+          hash_func_(src.hash_func_),
+          equal_func_(src.equal_func_)
+    {
+      reserve(src.size_);
+      insert(src.begin(), src.end());
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::~FlatTable() throw()
+    {
+      clear();
+
+      if(capacity_)
+      {
+        delete [] ctrl_;
+        ::operator delete(slots_);
+      }
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>&
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::operator=(
+      const FlatTable& src) throw(El::Exception)
+    {
+      if(this != &src)
+      {
+        FlatTable copy(src);
+        swap(copy);
+      }
+
+      return *this;
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    inline
+    size_t
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::mix(size_t hash) throw()
+    {
+      //
+      // Hash functions used across the library (identity for numbers,
+      // multiplicative for strings) leave high bits poorly distributed
+      // while both probe position and control byte rely on them.
+      //
+      uint64_t h = (uint64_t)hash * 0x9E3779B97F4A7C15ULL;
+      return (size_t)(h ^ (h >> 32));
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    inline
+    size_t
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::capacity_for(
+      size_t elements) throw()
+    {
+      // Maximum load factor is 7/8
+      size_t capacity = Flat::GROUP_SIZE;
+      for(; capacity - capacity / 8 < elements; capacity *= 2);
+      return capacity;
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    inline
+    typename FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::iterator
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::iterator_at(size_t index)
+      throw()
+    {
+      return iterator(ctrl_ + index, slots_ + index, ctrl_ + capacity_);
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    inline
+    typename FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::const_iterator
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::iterator_at(size_t index)
+      const throw()
+    {
+      return const_iterator(ctrl_ + index, slots_ + index, ctrl_ + capacity_);
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    inline
+    typename FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::iterator
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::begin() throw()
+    {
+      iterator it = iterator_at(0);
+      it.skip_free();
+      return it;
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    inline
+    typename FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::iterator
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::end() throw()
+    {
+      return iterator_at(capacity_);
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    inline
+    typename FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::const_iterator
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::begin() const throw()
+    {
+      const_iterator it = iterator_at(0);
+      it.skip_free();
+      return it;
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    inline
+    typename FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::const_iterator
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::end() const throw()
+    {
+      return iterator_at(capacity_);
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    inline
+    size_t
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::size() const throw()
+    {
+      return size_;
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    inline
+    bool
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::empty() const throw()
+    {
+      return size_ == 0;
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    inline
+    size_t
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::bucket_count() const throw()
+    {
+      return capacity_;
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    inline
+    size_t
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::memory_size() const throw()
+    {
+      return capacity_ ?
+        capacity_ * (sizeof(VALUE) + 1) + Flat::GROUP_SIZE : 0;
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    void
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::clear() throw()
+    {
+      if(capacity_ == 0)
+      {
+        return;
+      }
+
+      if(size_)
+      {
+        for(size_t i = 0; i < capacity_; ++i)
+        {
+          if(ctrl_[i] >= 0)
+          {
+            slots_[i].~VALUE();
+          }
+        }
+      }
+
+      memset(ctrl_, Flat::CTRL_EMPTY, capacity_ + Flat::GROUP_SIZE);
+
+      size_ = 0;
+      growth_left_ = capacity_ - capacity_ / 8;
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    void
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::reserve(size_t elements)
+      throw(El::Exception)
+    {
+      size_t capacity = capacity_for(elements);
+
+      if(capacity > capacity_)
+      {
+        rehash(capacity);
+      }
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    inline
+    void
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::resize(size_t elements)
+      throw(El::Exception)
+    {
+      reserve(elements);
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    void
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::swap(FlatTable& val) throw()
+    {
+      std::swap(ctrl_, val.ctrl_);
+      std::swap(slots_, val.slots_);
+      std::swap(capacity_, val.capacity_);
+      std::swap(size_, val.size_);
+      std::swap(growth_left_, val.growth_left_);
+      std::swap(hash_func_, val.hash_func_);
+      std::swap(equal_func_, val.equal_func_);
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    inline
+    void
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::set_ctrl(size_t index,
+                                                         Flat::Ctrl ctrl)
+      throw()
+    {
+      ctrl_[index] = ctrl;
+
+      //
+      // First GROUP_SIZE control bytes are mirrored past the end so a
+      // group can be loaded from any position without wrapping around
+      //
+      if(index < Flat::GROUP_SIZE)
+      {
+        ctrl_[capacity_ + index] = ctrl;
+      }
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    void
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::rehash(size_t capacity)
+      throw(El::Exception)
+    {
+      Flat::Ctrl* old_ctrl = ctrl_;
+      VALUE* old_slots = slots_;
+      size_t old_capacity = capacity_;
+
+      Flat::Ctrl* ctrl = new Flat::Ctrl[capacity + Flat::GROUP_SIZE];
+      VALUE* slots = 0;
+
+      try
+      {
+        slots = static_cast<VALUE*>(::operator new(capacity * sizeof(VALUE)));
+      }
+      catch(...)
+      {
+        delete [] ctrl;
+        throw;
+      }
+
+      memset(ctrl, Flat::CTRL_EMPTY, capacity + Flat::GROUP_SIZE);
+
+      ctrl_ = ctrl;
+      slots_ = slots;
+      capacity_ = capacity;
+      size_ = 0;
+      growth_left_ = capacity - capacity / 8;
+
+      for(size_t i = 0; i < old_capacity; ++i)
+      {
+        if(old_ctrl[i] >= 0)
+        {
+          VALUE& value = old_slots[i];
+          size_t index = prepare_insert(hash_func_(key_of_(value)));
+
+          new(slots_ + index) VALUE(value);
+          value.~VALUE();
+        }
+      }
+
+      if(old_capacity)
+      {
+        delete [] old_ctrl;
+        ::operator delete(old_slots);
+      }
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    size_t
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::prepare_insert(size_t hash)
+      throw(El::Exception)
+    {
+      if(growth_left_ == 0)
+      {
+        //
+        // Either full or overwhelmed with tombstones; in the later case
+        // just rebuilding the table of the same size
+        //
+        if(capacity_ == 0)
+        {
+          rehash(Flat::GROUP_SIZE);
+        }
+        else
+        {
+          rehash(size_ * 32 <= capacity_ * 25 ? capacity_ : capacity_ * 2);
+        }
+      }
+
+      size_t h = mix(hash);
+      size_t mask = capacity_ - 1;
+      size_t pos = (h >> 7) & mask;
+
+      for(size_t step = Flat::GROUP_SIZE; ; step += Flat::GROUP_SIZE)
+      {
+        uint32_t free = Flat::Group(ctrl_ + pos).match_empty_or_deleted();
+
+        if(free)
+        {
+          size_t index = (pos + Flat::trailing_zeros(free)) & mask;
+
+          if(ctrl_[index] == Flat::CTRL_EMPTY)
+          {
+            --growth_left_;
+          }
+
+          set_ctrl(index, (Flat::Ctrl)(h & 0x7F));
+          ++size_;
+
+          return index;
+        }
+
+        pos = (pos + step) & mask;
+      }
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    template<typename K>
+    inline
+    size_t
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::find_index(const K& key)
+      const throw(El::Exception)
+    {
+      if(size_ == 0)
+      {
+        return capacity_;
+      }
+
+      size_t h = mix(hash_func_(key));
+      Flat::Ctrl h2 = (Flat::Ctrl)(h & 0x7F);
+      size_t mask = capacity_ - 1;
+      size_t pos = (h >> 7) & mask;
+
+      for(size_t step = Flat::GROUP_SIZE; ; step += Flat::GROUP_SIZE)
+      {
+        Flat::Group group(ctrl_ + pos);
+
+        for(uint32_t match = group.match(h2); match; match &= match - 1)
+        {
+          size_t index = (pos + Flat::trailing_zeros(match)) & mask;
+
+          if(equal_func_(key_of_(slots_[index]), key))
+          {
+            return index;
+          }
+        }
+
+        if(group.match_empty())
+        {
+          return capacity_;
+        }
+
+        pos = (pos + step) & mask;
+      }
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    std::pair<typename FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::iterator,
+              bool>
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::insert(const VALUE& value)
+      throw(El::Exception)
+    {
+      const KEY& key = key_of_(value);
+      size_t index = find_index(key);
+
+      if(index != capacity_)
+      {
+        return std::make_pair(iterator_at(index), false);
+      }
+
+      index = prepare_insert(hash_func_(key));
+
+      try
+      {
+        new(slots_ + index) VALUE(value);
+      }
+      catch(...)
+      {
+        set_ctrl(index, Flat::CTRL_DELETED);
+        --size_;
+        throw;
+      }
+
+      return std::make_pair(iterator_at(index), true);
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    template<typename IT>
+    void
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::insert(IT first, IT last)
+      throw(El::Exception)
+    {
+      for(; first != last; ++first)
+      {
+        insert(*first);
+      }
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    template<typename K>
+    inline
+    typename FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::iterator
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::find(const K& key)
+      throw(El::Exception)
+    {
+      return iterator_at(find_index(key));
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    template<typename K>
+    inline
+    typename FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::const_iterator
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::find(const K& key) const
+      throw(El::Exception)
+    {
+      return iterator_at(find_index(key));
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    template<typename K>
+    inline
+    size_t
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::count(const K& key) const
+      throw(El::Exception)
+    {
+      return find_index(key) != capacity_ ? 1 : 0;
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    template<typename K>
+    size_t
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::erase(const K& key)
+      throw(El::Exception)
+    {
+      size_t index = find_index(key);
+
+      if(index == capacity_)
+      {
+        return 0;
+      }
+
+      erase_index(index);
+      return 1;
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    inline
+    void
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::erase(iterator it) throw()
+    {
+      erase_index(it.ctrl_ - ctrl_);
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    inline
+    void
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::erase(const_iterator it)
+      throw()
+    {
+      erase_index(it.ctrl_ - ctrl_);
+    }
+
+    template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+             typename EQUAL>
+    void
+    FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>::erase_index(size_t index)
+      throw()
+    {
+      slots_[index].~VALUE();
+      --size_;
+
+      //
+      // If there is an empty slot within each group window covering the
+      // erased one then no probe ever passed through it, so it can become
+      // empty again rather than a tombstone.
+      //
+      size_t mask = capacity_ - 1;
+
+      uint32_t empty_before =
+        Flat::Group(ctrl_ + ((index - Flat::GROUP_SIZE) & mask)).
+        match_empty();
+
+      uint32_t empty_after = Flat::Group(ctrl_ + index).match_empty();
+
+      bool was_never_full = empty_before && empty_after &&
+        Flat::leading_zeros(empty_before) +
+        Flat::trailing_zeros(empty_after) < Flat::GROUP_SIZE;
+
+      if(was_never_full)
+      {
+        set_ctrl(index, Flat::CTRL_EMPTY);
+        ++growth_left_;
+      }
+      else
+      {
+        set_ctrl(index, Flat::CTRL_DELETED);
+      }
+    }
+  }
+}
+
+#endif // _ELEMENTS_EL_HASH_FLATTABLE_HPP_
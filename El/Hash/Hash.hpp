@@ -15,6 +15,7 @@
 #define _ELEMENTS_EL_HASH_HPP_
 
 #include <stdint.h>
+#include <string.h>
 
 #include <string>
 
@@ -38,6 +39,7 @@
 #endif
 
 #include <El/Exception.hpp>
+#include <El/Hash/Hash64.hpp>
 
 namespace El
 {
@@ -47,6 +49,19 @@ namespace El
     {
       size_t operator()(const std::string& str) const throw(El::Exception);
       size_t operator()(const std::wstring& str) const throw(El::Exception);
+
+      // Same value as for std::string; allows lookup without temporaries
+      size_t operator()(const char* str) const throw();
+    };
+
+    //
+    // For containers keyed by request provided strings
+    //
+    struct SeededString
+    {
+      size_t operator()(const std::string& str) const throw(El::Exception);
+      size_t operator()(const std::wstring& str) const throw(El::Exception);
+      size_t operator()(const char* str) const throw();
     };
 
     template<typename TYPE>
@@ -55,6 +70,12 @@ namespace El
       size_t operator()(const TYPE& val) const throw();
     };    
 
+    template<typename TYPE>
+    struct SeededNumeric
+    {
+      size_t operator()(const TYPE& val) const throw();
+    };
+
     template<std::size_t S>
     struct Fnv_hash : public std::tr1::FNV_HASH_TYPENAME<S>
     {
@@ -72,33 +93,76 @@ namespace El
 {
   namespace Hash
   {
+    //
+    // String struct
+    //
     inline
     size_t
     String::operator()(const std::string& str) const throw(El::Exception)
     {
-      return __gnu_cxx::__stl_hash_string(str.c_str());
+      return hash64(str.data(), str.length());
+    }
+
+    inline
+    size_t
+    String::operator()(const char* str) const throw()
+    {
+      return hash64(str, strlen(str));
     }
     
     inline
     size_t
     String::operator()(const std::wstring& str) const throw(El::Exception)
     {
-      const wchar_t* __s = str.c_str();
-      size_t __h = 0;
-      
-      for ( ; *__s; ++__s)
-      {
-        __h = 5*__h + *__s;
-      }
-  
-      return size_t(__h);
+      return hash64(str.data(), str.length() * sizeof(wchar_t));
+    }
+
+    //
+    // SeededString struct
+    //
+    inline
+    size_t
+    SeededString::operator()(const std::string& str) const
+      throw(El::Exception)
+    {
+      return hash64(str.data(), str.length(), seed());
+    }
+
+    inline
+    size_t
+    SeededString::operator()(const char* str) const throw()
+    {
+      return hash64(str, strlen(str), seed());
     }
     
+    inline
+    size_t
+    SeededString::operator()(const std::wstring& str) const
+      throw(El::Exception)
+    {
+      return hash64(str.data(), str.length() * sizeof(wchar_t), seed());
+    }
+
+    //
+    // Numeric struct
+    //
     template<typename TYPE>
+    inline
     size_t
     Numeric<TYPE>::operator()(const TYPE& val) const throw()
     {
-      return ((size_t)val) & SIZE_MAX;
+      return mix64((uint64_t)val);
+    }
+
+    //
+    // SeededNumeric struct
+    //
+    template<typename TYPE>
+    inline
+    size_t
+    SeededNumeric<TYPE>::operator()(const TYPE& val) const throw()
+    {
+      return mix64((uint64_t)val, seed());
     }
   }
 }
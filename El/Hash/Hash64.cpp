@@ -0,0 +1,62 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Hash/Hash64.cpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "Hash64.hpp"
+
+namespace
+{
+  uint64_t
+  random_seed() throw()
+  {
+    uint64_t seed = 0;
+
+    int fd = open("/dev/urandom", O_RDONLY);
+
+    if(fd >= 0)
+    {
+      if(read(fd, &seed, sizeof(seed)) != sizeof(seed))
+      {
+        seed = 0;
+      }
+
+      close(fd);
+    }
+
+    //
+    // Still something unpredictable enough if urandom not available
+    //
+    timeval tv;
+    gettimeofday(&tv, 0);
+
+    return seed ^ El::Hash::mix64(((uint64_t)tv.tv_sec << 20) ^ tv.tv_usec ^
+                                  ((uint64_t)getpid() << 40) ^
+                                  (uintptr_t)&seed);
+  }
+}
+
+namespace El
+{
+  namespace Hash
+  {
+    uint64_t
+    seed() throw()
+    {
+      static const uint64_t value = random_seed();
+      return value;
+    }
+  }
+}
@@ -0,0 +1,228 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Hash/Hash64.hpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#ifndef _ELEMENTS_EL_HASH_HASH64_HPP_
+#define _ELEMENTS_EL_HASH_HASH64_HPP_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace El
+{
+  namespace Hash
+  {
+    //
+    // 64-bit hash of size bytes (wyhash construction). Consumes 8 bytes
+    // per read, 48 bytes per iteration in 3 independent lanes for long
+    // inputs. No NUL termination required.
+    //
+    uint64_t hash64(const void* data, size_t size, uint64_t seed = 0)
+      throw();
+
+    //
+    // Bijective integer finalizer; every input bit affects every output
+    // bit, so sequential or aligned keys spread over all buckets
+    //
+    uint64_t mix64(uint64_t val) throw();
+    uint64_t mix64(uint64_t val, uint64_t seed) throw();
+
+    //
+    // Random value chosen once per process. Used to seed hashes of keys
+    // coming from requests (URLs, cookies, headers), so colliding keys
+    // can't be precomputed by a client.
+    //
+    uint64_t seed() throw();
+
+    namespace Wy
+    {
+      const uint64_t SECRET[4] =
+      {
+        0xA0761D6478BD642FULL,
+        0xE7037ED1A0B428DBULL,
+        0x8EBC6AF09C88C6E3ULL,
+        0x589965CC75374CC3ULL
+      };
+
+      void mum(uint64_t& a, uint64_t& b) throw();
+      uint64_t mix(uint64_t a, uint64_t b) throw();
+
+      uint64_t read8(const unsigned char* p) throw();
+      uint64_t read4(const unsigned char* p) throw();
+      uint64_t read3(const unsigned char* p, size_t size) throw();
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Inlines
+///////////////////////////////////////////////////////////////////////////////
+
+namespace El
+{
+  namespace Hash
+  {
+    namespace Wy
+    {
+      inline
+      void
+      mum(uint64_t& a, uint64_t& b) throw()
+      {
+#ifdef __SIZEOF_INT128__
+        __uint128_t r = (__uint128_t)a * b;
+        a = (uint64_t)r;
+        b = (uint64_t)(r >> 64);
+#else
+        uint64_t ha = a >> 32, hb = b >> 32;
+        uint64_t la = (uint32_t)a, lb = (uint32_t)b;
+        uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+        uint64_t t = rl + (rm0 << 32);
+        uint64_t c = t < rl;
+        uint64_t lo = t + (rm1 << 32);
+        c += lo < t;
+        a = lo;
+        b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+      }
+
+      inline
+      uint64_t
+      mix(uint64_t a, uint64_t b) throw()
+      {
+        mum(a, b);
+        return a ^ b;
+      }
+
+      //
+      // Unaligned little endian reads; memcpy compiles into a single load
+      //
+      inline
+      uint64_t
+      read8(const unsigned char* p) throw()
+      {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        return v;
+      }
+
+      inline
+      uint64_t
+      read4(const unsigned char* p) throw()
+      {
+        uint32_t v;
+        memcpy(&v, p, 4);
+        return v;
+      }
+
+      inline
+      uint64_t
+      read3(const unsigned char* p, size_t size) throw()
+      {
+        return ((uint64_t)p[0] << 16) | ((uint64_t)p[size >> 1] << 8) |
+          p[size - 1];
+      }
+    }
+
+    inline
+    uint64_t
+    hash64(const void* data, size_t size, uint64_t seed) throw()
+    {
+      const unsigned char* p = static_cast<const unsigned char*>(data);
+
+      seed ^= Wy::mix(seed ^ Wy::SECRET[0], Wy::SECRET[1]);
+
+      uint64_t a = 0;
+      uint64_t b = 0;
+
+      if(size <= 16)
+      {
+        if(size >= 4)
+        {
+          size_t offset = (size >> 3) << 2;
+
+          a = (Wy::read4(p) << 32) | Wy::read4(p + offset);
+
+          b = (Wy::read4(p + size - 4) << 32) |
+            Wy::read4(p + size - 4 - offset);
+        }
+        else if(size)
+        {
+          a = Wy::read3(p, size);
+        }
+      }
+      else
+      {
+        size_t left = size;
+
+        if(left > 48)
+        {
+          uint64_t seed1 = seed;
+          uint64_t seed2 = seed;
+
+          do
+          {
+            seed = Wy::mix(Wy::read8(p) ^ Wy::SECRET[1],
+                           Wy::read8(p + 8) ^ seed);
+
+            seed1 = Wy::mix(Wy::read8(p + 16) ^ Wy::SECRET[2],
+                            Wy::read8(p + 24) ^ seed1);
+
+            seed2 = Wy::mix(Wy::read8(p + 32) ^ Wy::SECRET[3],
+                            Wy::read8(p + 40) ^ seed2);
+
+            p += 48;
+            left -= 48;
+          }
+          while(left > 48);
+
+          seed ^= seed1 ^ seed2;
+        }
+
+        for(; left > 16; left -= 16, p += 16)
+        {
+          seed = Wy::mix(Wy::read8(p) ^ Wy::SECRET[1],
+                         Wy::read8(p + 8) ^ seed);
+        }
+
+        a = Wy::read8(p + left - 16);
+        b = Wy::read8(p + left - 8);
+      }
+
+      a ^= Wy::SECRET[1];
+      b ^= seed;
+
+      Wy::mum(a, b);
+
+      return Wy::mix(a ^ Wy::SECRET[0] ^ size, b ^ Wy::SECRET[1]);
+    }
+
+    inline
+    uint64_t
+    mix64(uint64_t val) throw()
+    {
+      // SplitMix64 finalizer
+      val = (val ^ (val >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      val = (val ^ (val >> 27)) * 0x94D049BB133111EBULL;
+      return val ^ (val >> 31);
+    }
+
+    inline
+    uint64_t
+    mix64(uint64_t val, uint64_t seed) throw()
+    {
+      return Wy::mix(val ^ seed ^ Wy::SECRET[0], Wy::SECRET[1]);
+    }
+  }
+}
+
+#endif // _ELEMENTS_EL_HASH_HASH64_HPP_
@@ -11,6 +11,8 @@
  * $id:$
  */
 
+#include <string.h>
+
 #include <sstream>
 
 #include <El/Exception.hpp>
@@ -21,6 +23,202 @@ namespace El
 {
   namespace LibXML
   {
+    //
+    // ParserContext class
+    //
+    ACE_TSS<ParserContext::ThreadStorage> ParserContext::thread_storage_;
+
+    ParserContext::ThreadStorage::ThreadStorage() throw()
+        : dom(0),
+          push(0),
+          push_busy(false)
+    {
+    }
+
+    ParserContext::ThreadStorage::~ThreadStorage() throw()
+    {
+      free();
+    }
+
+    void
+    ParserContext::ThreadStorage::free() throw()
+    {
+      if(dom)
+      {
+        htmlFreeParserCtxt(dom);
+        dom = 0;
+      }
+
+      if(push)
+      {
+        htmlFreeParserCtxt(push);
+        push = 0;
+      }
+    }
+
+    void
+    ParserContext::ThreadStorage::init() throw(Exception, El::Exception)
+    {
+      if(dom && xmlDictSize(dom->dict) < MAX_DICT_SIZE)
+      {
+        return;
+      }
+
+      free();
+
+      dom = htmlNewParserCtxt();
+
+      if(dom == 0)
+      {
+        throw Exception("El::LibXML::ParserContext::ThreadStorage::init: "
+                        "htmlNewParserCtxt failed");
+      }
+
+      push = htmlCreatePushParserCtxt(0, 0, 0, 0, 0,
+                                      XML_CHAR_ENCODING_NONE);
+
+      if(push == 0)
+      {
+        free();
+
+        throw Exception("El::LibXML::ParserContext::ThreadStorage::init: "
+                        "htmlCreatePushParserCtxt failed");
+      }
+
+      xmlDictFree(push->dict);
+      push->dict = dom->dict;
+      xmlDictReference(push->dict);
+    }
+
+    htmlParserCtxtPtr
+    ParserContext::dom() throw(Exception, El::Exception)
+    {
+      ThreadStorage* storage = thread_storage_;
+
+      // Busy push context means both are initialized and can't be
+      // recreated now
+      if(!storage->push_busy)
+      {
+        storage->init();
+      }
+
+      return storage->dom;
+    }
+
+    htmlParserCtxtPtr
+    ParserContext::push(htmlSAXHandlerPtr sax,
+                        void* user_data,
+                        const char* url,
+                        const char* encoding,
+                        int options)
+      throw(Exception, El::Exception)
+    {
+      ThreadStorage* storage = thread_storage_;
+
+      if(storage->push_busy)
+      {
+        return 0;
+      }
+
+      storage->init();
+      reset_push(storage->push, sax, user_data, url, encoding, options);
+      storage->push_busy = true;
+
+      return storage->push;
+    }
+
+    void
+    ParserContext::release(htmlParserCtxtPtr ctxt) throw()
+    {
+      ThreadStorage* storage = thread_storage_;
+
+      if(storage->push == ctxt)
+      {
+        storage->push_busy = false;
+      }
+    }
+
+    htmlParserCtxtPtr
+    ParserContext::create_push(htmlSAXHandlerPtr sax,
+                               void* user_data,
+                               const char* url,
+                               const char* encoding,
+                               int options)
+      throw(Exception, El::Exception)
+    {
+      htmlParserCtxtPtr ctxt =
+        htmlCreatePushParserCtxt(0, 0, 0, 0, 0, XML_CHAR_ENCODING_NONE);
+
+      if(ctxt == 0)
+      {
+        throw Exception("El::LibXML::ParserContext::create_push: "
+                        "htmlCreatePushParserCtxt failed");
+      }
+
+      try
+      {
+        reset_push(ctxt, sax, user_data, url, encoding, options);
+      }
+      catch(...)
+      {
+        htmlFreeParserCtxt(ctxt);
+        throw;
+      }
+
+      return ctxt;
+    }
+
+    void
+    ParserContext::reset_push(htmlParserCtxtPtr ctxt,
+                              htmlSAXHandlerPtr sax,
+                              void* user_data,
+                              const char* url,
+                              const char* encoding,
+                              int options)
+      throw(Exception, El::Exception)
+    {
+      if(xmlCtxtResetPush(ctxt,
+                          0,
+                          0,
+                          url,
+                          encoding && *encoding ? encoding : 0))
+      {
+        std::ostringstream ostr;
+        ostr << "El::LibXML::ParserContext::reset_push: "
+          "xmlCtxtResetPush failed";
+
+        if(encoding && *encoding != '\0')
+        {
+          ostr << " for encoding '" << encoding << "'";
+        }
+
+        throw Exception(ostr.str());
+      }
+
+      //
+      // Reset makes context an XML one expecting UTF-8 input; fresh HTML
+      // push context leaves charset undefined so encoding is looked up
+      // in meta tags on first non-ASCII character
+      //
+      ctxt->html = 1;
+
+      if(encoding == 0 || *encoding == '\0')
+      {
+        ctxt->charset = XML_CHAR_ENCODING_NONE;
+      }
+
+      if(sax)
+      {
+        memcpy(ctxt->sax, sax, sizeof(*sax));
+      }
+
+      ctxt->userData = user_data ? user_data : ctxt;
+      htmlCtxtUseOptions(ctxt, options);
+    }
+
+    //
+    // HTMLParser class
+    //
     htmlDocPtr
     HTMLParser::parse(const char* text,
                       unsigned long text_len,
@@ -53,11 +251,12 @@ namespace El
         
       Use::set_error_handler(error_handler);
       
-      doc_ = htmlReadMemory(text,
-                            text_len,
-                            url,
-                            encoding && *encoding ? encoding : 0,
-                            options);
+      doc_ = htmlCtxtReadMemory(ParserContext::dom(),
+                                text,
+                                text_len,
+                                url,
+                                encoding && *encoding ? encoding : 0,
+                                options | XML_PARSE_NODICT);
         
       Use::set_error_handler(0);
       
@@ -66,7 +265,7 @@ namespace El
         std::ostringstream ostr;
         
         ostr << "El::LibXML::HTMLParser::parse: "
-          "htmlReadMemory failed";
+          "htmlCtxtReadMemory failed";
 
         if(url && *url != '\0')
         {
@@ -120,9 +319,10 @@ namespace El
         
       Use::set_error_handler(error_handler);
       
-      doc_ = htmlReadFile(file_path,
-                          encoding && *encoding ? encoding : 0,
-                          options);
+      doc_ = htmlCtxtReadFile(ParserContext::dom(),
+                              file_path,
+                              encoding && *encoding ? encoding : 0,
+                              options | XML_PARSE_NODICT);
       
       Use::set_error_handler(0);
       
@@ -131,7 +331,7 @@ namespace El
         std::ostringstream ostr;
         
         ostr << "El::LibXML::HTMLParser::parse_file: "
-          "htmlReadFile failed for '" << file_path << "', encoding '"
+          "htmlCtxtReadFile failed for '" << file_path << "', encoding '"
              << (encoding ? encoding : "<null>") << "'";
 
         ErrorRecorderHandler* handler =
@@ -22,12 +22,83 @@
 #include <libxml/HTMLtree.h>
 #include <libxml/HTMLparser.h>
 
+#include <ace/TSS_T.h>
+
 #include <El/LibXML/Use.hpp>
 
 namespace El
 {
   namespace LibXML
   {
+    //
+    // libxml2 parser contexts reused by parsers running in the same
+    // thread instead of being created for each document. Both contexts of
+    // a thread share the dictionary, so element and attribute names are
+    // interned once per thread rather than once per document. Documents
+    // read with dom() context should be parsed with XML_PARSE_NODICT
+    // as otherwise they reference the thread dictionary and can't be
+    // freed or modified by other threads.
+    //
+    class ParserContext
+    {
+    public:
+      // Context for htmlCtxtRead* functions
+      static htmlParserCtxtPtr dom() throw(Exception, El::Exception);
+
+      //
+      // Push parser context reset for a new document. Returns 0 if the
+      // thread context is in use by other push parser; release should be
+      // called when document parsing is complete.
+      //
+      static htmlParserCtxtPtr push(htmlSAXHandlerPtr sax,
+                                    void* user_data,
+                                    const char* url,
+                                    const char* encoding,
+                                    int options)
+        throw(Exception, El::Exception);
+
+      static void release(htmlParserCtxtPtr ctxt) throw();
+
+      //
+      // Creates standalone push parser context; to be freed with
+      // htmlFreeParserCtxt
+      //
+      static htmlParserCtxtPtr create_push(htmlSAXHandlerPtr sax,
+                                           void* user_data,
+                                           const char* url,
+                                           const char* encoding,
+                                           int options)
+        throw(Exception, El::Exception);
+
+    private:
+      static void reset_push(htmlParserCtxtPtr ctxt,
+                             htmlSAXHandlerPtr sax,
+                             void* user_data,
+                             const char* url,
+                             const char* encoding,
+                             int options)
+        throw(Exception, El::Exception);
+
+      struct ThreadStorage
+      {
+        htmlParserCtxtPtr dom;
+        htmlParserCtxtPtr push;
+        bool push_busy;
+
+        ThreadStorage() throw();
+        ~ThreadStorage() throw();
+
+        // Recreates contexts if dictionary grown too big
+        void init() throw(Exception, El::Exception);
+        void free() throw();
+      };
+
+      // Dictionary is never shrunk so is recreated after reaching the size
+      static const size_t MAX_DICT_SIZE = 50000;
+
+      static ACE_TSS<ThreadStorage> thread_storage_;
+    };
+
     class HTMLParser
     {
     public :
@@ -36,6 +107,10 @@ namespace El
         
       htmlDocPtr document(bool retain = true) throw();
 
+      //
+      // Documents are built without the thread dictionary of parser
+      // context, so can be passed to and freed by other threads
+      //
       htmlDocPtr parse(const char* text,
                        unsigned long text_len,
                        const char* url = 0,
@@ -0,0 +1,386 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/LibXML/HTMLStreamParser.cpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#include <string.h>
+
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+
+#include <El/Exception.hpp>
+#include <El/ArrayPtr.hpp>
+
+#include <El/LibXML/HTMLParser.hpp>
+
+#include "HTMLStreamParser.hpp"
+
+namespace El
+{
+  namespace LibXML
+  {
+    htmlSAXHandler
+    HTMLStreamParser::sax_handler_(HTMLStreamParser::create_sax_handler());
+
+    htmlSAXHandler
+    HTMLStreamParser::create_sax_handler() throw()
+    {
+      //
+      // No startDocument handler, so no document is created; CDATA
+      // blocks and ignorable whitespaces are skipped as Traverser does
+      //
+      htmlSAXHandler handler;
+      memset(&handler, 0, sizeof(handler));
+
+      handler.startElement = start_element;
+      handler.endElement = end_element;
+      handler.characters = characters;
+
+      // Otherwise script and style contents are passed to characters
+      handler.cdataBlock = cdata_block;
+
+      return handler;
+    }
+
+    void
+    HTMLStreamParser::begin(const char* url,
+                            const char* encoding,
+                            ErrorHandler* error_handler,
+                            int options)
+      throw(Exception, El::Exception)
+    {
+      close();
+
+      url_ = url ? url : "";
+      error_.clear();
+      head_.clear();
+      head_parsed_ = encoding && *encoding != '\0';
+
+      if(error_handler == 0)
+      {
+        def_handler_.reset(new ErrorRecorderHandler());
+        error_handler = def_handler_.get();
+      }
+
+      error_handler_ = error_handler;
+
+      ctxt_ = ParserContext::push(&sax_handler_,
+                                  this,
+                                  url,
+                                  encoding,
+                                  options);
+
+      pooled_ = ctxt_ != 0;
+
+      if(ctxt_ == 0)
+      {
+        // Thread context is used by other parser
+        ctxt_ = ParserContext::create_push(&sax_handler_,
+                                           this,
+                                           url,
+                                           encoding,
+                                           options);
+      }
+    }
+
+    void
+    HTMLStreamParser::write(const char* data, size_t size)
+      throw(Exception, El::Exception)
+    {
+      if(ctxt_ == 0)
+      {
+        throw Exception("El::LibXML::HTMLStreamParser::write: "
+                        "document not started");
+      }
+
+      if(size == 0)
+      {
+        return;
+      }
+
+      if(head_parsed_)
+      {
+        parse_chunk(data, size, false);
+        return;
+      }
+
+      // Look for body start in appended data and few bytes before
+      size_t from = head_.length() > 4 ? head_.length() - 4 : 0;
+      head_.append(data, size);
+
+      if(head_.length() >= HEAD_PRESCAN_SIZE ||
+         strcasestr(head_.c_str() + from, "<body") != 0)
+      {
+        flush_head();
+      }
+    }
+
+    void
+    HTMLStreamParser::flush_head() throw(Exception, El::Exception)
+    {
+      head_parsed_ = true;
+
+      if(!head_.empty())
+      {
+        std::string head;
+        head.swap(head_);
+
+        parse_chunk(head.c_str(), head.length(), false);
+      }
+    }
+
+    void
+    HTMLStreamParser::end() throw(Exception, El::Exception)
+    {
+      if(ctxt_ == 0)
+      {
+        throw Exception("El::LibXML::HTMLStreamParser::end: "
+                        "document not started");
+      }
+
+      flush_head();
+      parse_chunk(0, 0, true);
+      close();
+    }
+
+    void
+    HTMLStreamParser::parse(const char* text,
+                            size_t text_len,
+                            const char* url,
+                            const char* encoding,
+                            ErrorHandler* error_handler,
+                            int options,
+                            size_t chunk_size)
+      throw(Exception, El::Exception)
+    {
+      begin(url, encoding, error_handler, options);
+
+      try
+      {
+        if(chunk_size == 0)
+        {
+          chunk_size = text_len;
+        }
+
+        for(size_t offset = 0; offset < text_len; offset += chunk_size)
+        {
+          write(text + offset, std::min(chunk_size, text_len - offset));
+        }
+
+        end();
+      }
+      catch(...)
+      {
+        close();
+        throw;
+      }
+    }
+
+    void
+    HTMLStreamParser::parse(std::istream& istr,
+                            const char* url,
+                            const char* encoding,
+                            ErrorHandler* error_handler,
+                            int options,
+                            size_t chunk_size)
+      throw(Exception, El::Exception)
+    {
+      if(chunk_size == 0)
+      {
+        chunk_size = 16384;
+      }
+
+      El::ArrayPtr<char> buff(new char[chunk_size]);
+
+      begin(url, encoding, error_handler, options);
+
+      try
+      {
+        while(!istr.fail())
+        {
+          istr.read(buff.get(), chunk_size);
+          write(buff.get(), istr.gcount());
+        }
+
+        if(istr.bad())
+        {
+          std::ostringstream ostr;
+          ostr << "El::LibXML::HTMLStreamParser::parse: stream read failed";
+
+          if(!url_.empty())
+          {
+            ostr << " for url '" << url_ << "'";
+          }
+
+          throw Exception(ostr.str());
+        }
+
+        end();
+      }
+      catch(...)
+      {
+        close();
+        throw;
+      }
+    }
+
+    void
+    HTMLStreamParser::parse_file(const char* file_path,
+                                 const char* encoding,
+                                 ErrorHandler* error_handler,
+                                 int options)
+      throw(Exception, El::Exception)
+    {
+      std::fstream file(file_path, std::ios::in);
+
+      if(!file.is_open())
+      {
+        std::ostringstream ostr;
+        ostr << "El::LibXML::HTMLStreamParser::parse_file: can't open '"
+             << file_path << "' for read access";
+
+        throw Exception(ostr.str());
+      }
+
+      parse(file, file_path, encoding, error_handler, options);
+    }
+
+    void
+    HTMLStreamParser::parse_chunk(const char* data,
+                                  size_t size,
+                                  bool terminate)
+      throw(Exception, El::Exception)
+    {
+      Use::set_error_handler(error_handler_);
+      htmlParseChunk(ctxt_, data, size, terminate ? 1 : 0);
+      Use::set_error_handler(0);
+
+      if(!error_.empty())
+      {
+        std::ostringstream ostr;
+        ostr << "El::LibXML::HTMLStreamParser::parse_chunk: builder failed";
+
+        if(!url_.empty())
+        {
+          ostr << " for url '" << url_ << "'";
+        }
+
+        ostr << ". Description:\n" << error_;
+
+        close();
+        throw Exception(ostr.str());
+      }
+    }
+
+    void
+    HTMLStreamParser::close() throw()
+    {
+      if(ctxt_)
+      {
+        if(pooled_)
+        {
+          ParserContext::release(ctxt_);
+        }
+        else
+        {
+          htmlFreeParserCtxt(ctxt_);
+        }
+
+        ctxt_ = 0;
+      }
+
+      error_handler_ = 0;
+      def_handler_.reset(0);
+    }
+
+    void
+    HTMLStreamParser::builder_failed(const char* error) throw()
+    {
+      try
+      {
+        error_ = error;
+      }
+      catch(...)
+      {
+      }
+
+      if(error_.empty())
+      {
+        error_ = "unknown";
+      }
+
+      xmlStopParser(ctxt_);
+    }
+
+    void XMLCALL
+    HTMLStreamParser::start_element(void* ctx,
+                                    const xmlChar* name,
+                                    const xmlChar** attrs)
+    {
+      HTMLStreamParser* parser = static_cast<HTMLStreamParser*>(ctx);
+
+      if(parser->error_.empty())
+      {
+        try
+        {
+          parser->builder_.start_element((const char*)name,
+                                         (const char**)attrs);
+        }
+        catch(const El::Exception& e)
+        {
+          parser->builder_failed(e.what());
+        }
+      }
+    }
+
+    void XMLCALL
+    HTMLStreamParser::end_element(void* ctx, const xmlChar* name)
+    {
+      HTMLStreamParser* parser = static_cast<HTMLStreamParser*>(ctx);
+
+      if(parser->error_.empty())
+      {
+        try
+        {
+          parser->builder_.end_element((const char*)name);
+        }
+        catch(const El::Exception& e)
+        {
+          parser->builder_failed(e.what());
+        }
+      }
+    }
+
+    void XMLCALL
+    HTMLStreamParser::characters(void* ctx, const xmlChar* text, int len)
+    {
+      HTMLStreamParser* parser = static_cast<HTMLStreamParser*>(ctx);
+
+      if(parser->error_.empty())
+      {
+        try
+        {
+          parser->builder_.text((const char*)text, len);
+        }
+        catch(const El::Exception& e)
+        {
+          parser->builder_failed(e.what());
+        }
+      }
+    }
+
+    void XMLCALL
+    HTMLStreamParser::cdata_block(void* ctx, const xmlChar* text, int len)
+    {
+    }
+  }
+}
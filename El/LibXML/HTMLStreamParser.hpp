@@ -0,0 +1,163 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/LibXML/HTMLStreamParser.hpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#ifndef _ELEMENTS_EL_LIBXML_HTMLSTREAMPARSER_HPP_
+#define _ELEMENTS_EL_LIBXML_HTMLSTREAMPARSER_HPP_
+
+#include <string>
+#include <istream>
+#include <memory>
+
+#include <libxml/parser.h>
+#include <libxml/HTMLparser.h>
+
+#include <El/Exception.hpp>
+
+#include <El/LibXML/Use.hpp>
+#include <El/LibXML/Traverser.hpp>
+
+namespace El
+{
+  namespace LibXML
+  {
+    //
+    // SAX mode HTML parser passing document content to StreamBuilder as
+    // bytes are written to it, so text can be extracted while document
+    // is still being downloaded and no tree is allocated. Uses thread's
+    // pooled push parser context, so a document should be parsed from
+    // begin to end in a single thread.
+    //
+    // If encoding is not specified document head is accumulated until
+    // body start (or HEAD_PRESCAN_SIZE bytes) and only then passed to
+    // the parser, so encoding declared in meta tags is found as it is
+    // when whole document is parsed at once.
+    //
+    class HTMLStreamParser
+    {
+    public:
+      HTMLStreamParser(StreamBuilder& builder) throw();
+      ~HTMLStreamParser() throw();
+
+      void begin(const char* url = 0,
+                 const char* encoding = 0,
+                 ErrorHandler* error_handler = 0,
+                 int options = 0)
+        throw(Exception, El::Exception);
+
+      void write(const char* data, size_t size)
+        throw(Exception, El::Exception);
+
+      void end() throw(Exception, El::Exception);
+
+      //
+      // Parse whole document at once; text is fed to the parser in
+      // chunks of chunk_size bytes
+      //
+      void parse(const char* text,
+                 size_t text_len,
+                 const char* url = 0,
+                 const char* encoding = 0,
+                 ErrorHandler* error_handler = 0,
+                 int options = 0,
+                 size_t chunk_size = 16384)
+        throw(Exception, El::Exception);
+
+      void parse(std::istream& istr,
+                 const char* url = 0,
+                 const char* encoding = 0,
+                 ErrorHandler* error_handler = 0,
+                 int options = 0,
+                 size_t chunk_size = 16384)
+        throw(Exception, El::Exception);
+
+      void parse_file(const char* file_path,
+                      const char* encoding = 0,
+                      ErrorHandler* error_handler = 0,
+                      int options = 0)
+        throw(Exception, El::Exception);
+
+    private:
+      static const size_t HEAD_PRESCAN_SIZE = 32768;
+
+      void flush_head() throw(Exception, El::Exception);
+
+      void parse_chunk(const char* data, size_t size, bool terminate)
+        throw(Exception, El::Exception);
+
+      void close() throw();
+
+      static void XMLCALL start_element(void* ctx,
+                                        const xmlChar* name,
+                                        const xmlChar** attrs);
+
+      static void XMLCALL end_element(void* ctx, const xmlChar* name);
+
+      static void XMLCALL characters(void* ctx,
+                                     const xmlChar* text,
+                                     int len);
+
+      static void XMLCALL cdata_block(void* ctx,
+                                      const xmlChar* text,
+                                      int len);
+
+      void builder_failed(const char* error) throw();
+
+      static htmlSAXHandler create_sax_handler() throw();
+
+      static htmlSAXHandler sax_handler_;
+
+    private:
+      StreamBuilder& builder_;
+      htmlParserCtxtPtr ctxt_;
+      bool pooled_;
+      ErrorHandler* error_handler_;
+      std::auto_ptr<ErrorRecorderHandler> def_handler_;
+      std::string url_;
+      std::string error_;
+      std::string head_;
+      bool head_parsed_;
+
+    private:
+      HTMLStreamParser(const HTMLStreamParser&);
+      void operator=(const HTMLStreamParser&);
+    };
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Inlines
+///////////////////////////////////////////////////////////////////////////////
+
+namespace El
+{
+  namespace LibXML
+  {
+    inline
+    HTMLStreamParser::HTMLStreamParser(StreamBuilder& builder) throw()
+        : builder_(builder),
+          ctxt_(0),
+          pooled_(false),
+          error_handler_(0),
+          head_parsed_(false)
+    {
+    }
+
+    inline
+    HTMLStreamParser::~HTMLStreamParser() throw()
+    {
+      close();
+    }
+  }
+}
+
+#endif // _ELEMENTS_EL_LIBXML_HTMLSTREAMPARSER_HPP_
@@ -269,5 +269,56 @@ namespace El
 
       return false;
     }
+
+    //
+    // StreamTextBuilder class
+    //
+    StreamTextBuilder::StreamTextBuilder(std::ostream& output,
+                                         TextBuilder::OutputType output_type)
+      throw(Exception, El::Exception)
+        : output_(output),
+          output_type_(output_type)
+    {
+      if(output_type_ == TextBuilder::OT_XML)
+      {
+        throw Exception("El::LibXML::StreamTextBuilder::StreamTextBuilder: "
+                        "OT_XML output type is not supported");
+      }
+    }
+
+    void
+    StreamTextBuilder::start_element(const char* name, const char** attrs)
+      throw(El::Exception)
+    {
+      if(output_type_ == TextBuilder::OT_RENDERED_HTML)
+      {
+        if(TextBuilder::block_element(name))
+        {
+          output_ << std::endl;
+        }
+
+        if(strcasecmp(name, "LI") == 0)
+        {
+          El::String::Manip::wchar_to_utf8(L"\x2022 ", output_);
+        }
+      }
+    }
+
+    void
+    StreamTextBuilder::end_element(const char* name) throw(El::Exception)
+    {
+      if(output_type_ == TextBuilder::OT_RENDERED_HTML &&
+         TextBuilder::block_element(name))
+      {
+        output_ << std::endl;
+      }
+    }
+
+    void
+    StreamTextBuilder::text(const char* text, size_t len)
+      throw(El::Exception)
+    {
+      output_.write(text, len);
+    }
   }
 }
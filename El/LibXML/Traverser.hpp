@@ -19,6 +19,8 @@
 
 #include <libxml/tree.h>
 
+#include <El/Exception.hpp>
+
 namespace El
 {
   namespace LibXML
@@ -75,6 +77,53 @@ namespace El
       static const char* block_elements_[];
     };
 
+    //
+    // Receives document content as parser goes through it, so no tree
+    // is built. HTML element names come lowercased, attrs is a
+    // 0-terminated name, value, name, value ... array or 0.
+    //
+    class StreamBuilder
+    {
+    public:
+      virtual ~StreamBuilder() throw() {}
+
+      virtual void start_element(const char* name, const char** attrs)
+        throw(El::Exception) = 0;
+
+      virtual void end_element(const char* name) throw(El::Exception) = 0;
+
+      // Text node content can be passed in several portions
+      virtual void text(const char* text, size_t len)
+        throw(El::Exception) = 0;
+    };
+
+    //
+    // Streaming counterpart of TextBuilder. OT_XML is not supported as
+    // empty element can't be told until its end.
+    //
+    class StreamTextBuilder : public StreamBuilder
+    {
+    public:
+      EL_EXCEPTION(Exception, El::ExceptionBase);
+
+    public:
+      StreamTextBuilder(std::ostream& output,
+                        TextBuilder::OutputType output_type)
+        throw(Exception, El::Exception);
+
+      virtual ~StreamTextBuilder() throw() {}
+
+      virtual void start_element(const char* name, const char** attrs)
+        throw(El::Exception);
+
+      virtual void end_element(const char* name) throw(El::Exception);
+      virtual void text(const char* text, size_t len) throw(El::Exception);
+
+    private:
+      std::ostream& output_;
+      TextBuilder::OutputType output_type_;
+    };
+
     class Traverser
     {
     public :
@@ -11,6 +11,7 @@
  * $id:$
  */
 
+#include <memory>
 #include <sstream>
 #include <string>
 #include <iostream>
@@ -30,18 +31,21 @@ namespace El
     void
     Localizer::init(const char* localization_dir)
       throw(InvalidArg, Exception, El::Exception)
-    {      
-      WriteGuard guard(lock_);
+    {
+      std::auto_ptr<LocObjectMap> loc_objects_ptr(new LocObjectMap());
+      LocObjectMap& loc_objects = *loc_objects_ptr;
       
-      loc_objects_[El::Lang::EC_ENG] =
+      loc_objects[El::Lang::EC_ENG] =
         new Eng(countries_file(El::Lang::EC_ENG, localization_dir).c_str(),
                 languages_file(El::Lang::EC_ENG, localization_dir).c_str(),
                 words_file(El::Lang::EC_ENG, localization_dir).c_str());
 
-      loc_objects_[El::Lang::EC_RUS] =
+      loc_objects[El::Lang::EC_RUS] =
         new Rus(countries_file(El::Lang::EC_RUS, localization_dir).c_str(),
                 languages_file(El::Lang::EC_RUS, localization_dir).c_str(),
                 words_file(El::Lang::EC_RUS, localization_dir).c_str());
+
+      snapshot_.publish(loc_objects_ptr.release());
     }
     
   }
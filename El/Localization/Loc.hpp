@@ -16,8 +16,6 @@
 
 #include <iostream>
 
-#include <ext/hash_map>
-
 #include <ace/OS.h>
 #include <ace/Synch.h>
 #include <ace/Guard_T.h>
@@ -26,17 +24,24 @@
 #include <El/Lang.hpp>
 #include <El/Country.hpp>
 #include <El/Hash/Hash.hpp>
+#include <El/Hash/FlatMap.hpp>
+#include <El/Snapshot.hpp>
 #include <El/Localization/LocObject.hpp>
 
 namespace El
 {
   namespace Loc
   {
+    //
+    // Lookups take no locks: localization objects are published as an
+    // immutable El::Sync::Snapshot which init replaces as a whole.
+    //
     class Localizer
     {
     public:
       Localizer() throw(El::Exception);
 
+      // Lookups in progress complete on previous snapshot
       void init(const char* localization_dir)
         throw(InvalidArg, Exception, El::Exception);
       
@@ -76,20 +81,27 @@ namespace El
       
     private:
 
-      typedef ACE_RW_Thread_Mutex    Mutex;
-      typedef ACE_Read_Guard<Mutex>  ReadGuard;
-      typedef ACE_Write_Guard<Mutex> WriteGuard;
-      
-      mutable Mutex lock_;
+      typedef El::Hash::FlatMap<Lang::ElCode,
+                                LocObject_var,
+                                Hash::Numeric<El::Lang::ElCode> >
+      LocObjectMap;
 
-      static El::Loc::Localizer instance_;
+      typedef El::Sync::Snapshot<LocObjectMap> Snapshot;
 
-      typedef __gnu_cxx::hash_map<Lang::ElCode,
-                                  LocObject_var,
-                                  Hash::Numeric<El::Lang::ElCode> >
-      LocObjectMap;
+      //
+      // Returned object is valid while loc_objects reader exists; it is
+      // not referenced as reference counter of the shared object is not
+      // thread-safe.
+      //
+      static LocObject* loc_object(const Snapshot::Reader& loc_objects,
+                                   const Lang& lang)
+        throw();
 
-      LocObjectMap loc_objects_;
+    private:
+
+      Snapshot snapshot_;
+
+      static El::Loc::Localizer instance_;
     };
 
   }
@@ -108,6 +120,21 @@ namespace El
     {
     }
 
+    inline
+    LocObject*
+    Localizer::loc_object(const Snapshot::Reader& loc_objects,
+                          const Lang& lang)
+      throw()
+    {
+      if(loc_objects.get() == 0)
+      {
+        return 0;
+      }
+
+      LocObjectMap::const_iterator it = loc_objects->find(lang.el_code());
+      return it == loc_objects->end() ? 0 : it->second.in();
+    }
+
     inline
     std::ostream&
     Localizer::plural(const char* word,
@@ -116,11 +143,10 @@ namespace El
                       std::ostream& ostr) const
       throw(UnsupportedLanguage, UnsupportedWord, El::Exception)
     {
-      ReadGuard guard(lock_);
-      
-      LocObjectMap::const_iterator it = loc_objects_.find(lang.el_code());
+      Snapshot::Reader loc_objects(snapshot_);
+      LocObject* loc_object = this->loc_object(loc_objects, lang);
       
-      if(it == loc_objects_.end())
+      if(loc_object == 0)
       {
         std::ostringstream ostr;
         ostr << "El::Loc::Localizer::plural: language " << lang.l3_code()
@@ -129,7 +155,7 @@ namespace El
         throw UnsupportedLanguage(ostr.str());
       }
 
-      it->second->plural(word, count, ostr);
+      loc_object->plural(word, count, ostr);
       return ostr;
     }
 
@@ -140,11 +166,10 @@ namespace El
                        std::ostream& ostr) const
       throw(UnsupportedLanguage, UnsupportedCountry, El::Exception)
     {
-      ReadGuard guard(lock_);
+      Snapshot::Reader loc_objects(snapshot_);
+      LocObject* loc_object = this->loc_object(loc_objects, lang);
       
-      LocObjectMap::const_iterator it = loc_objects_.find(lang.el_code());
-      
-      if(it == loc_objects_.end())
+      if(loc_object == 0)
       {
         std::ostringstream ostr;
         ostr << "El::Loc::Localizer::country: language " << lang.l3_code()
@@ -153,7 +178,7 @@ namespace El
         throw UnsupportedCountry(ostr.str());
       }
 
-      it->second->country(country, ostr);
+      loc_object->country(country, ostr);
       return ostr;
     }
 
@@ -164,11 +189,10 @@ namespace El
                         std::ostream& ostr) const
       throw(UnsupportedLanguage, El::Exception)
     {
-      ReadGuard guard(lock_);
-      
-      LocObjectMap::const_iterator it = loc_objects_.find(lang.el_code());
+      Snapshot::Reader loc_objects(snapshot_);
+      LocObject* loc_object = this->loc_object(loc_objects, lang);
       
-      if(it == loc_objects_.end())
+      if(loc_object == 0)
       {
         std::ostringstream ostr;
         ostr << "El::Loc::Localizer::language: language " << lang.l3_code()
@@ -177,7 +201,7 @@ namespace El
         throw UnsupportedLanguage(ostr.str());
       }
 
-      it->second->language(language, ostr);
+      loc_object->language(language, ostr);
       return ostr;
     }
     
@@ -185,8 +209,8 @@ namespace El
     bool
     Localizer::supported(const Lang& lang) throw()
     {
-      ReadGuard guard(lock_);
-      return loc_objects_.find(lang.el_code()) != loc_objects_.end();
+      Snapshot::Reader loc_objects(snapshot_);
+      return loc_object(loc_objects, lang) != 0;
     }
 
     inline
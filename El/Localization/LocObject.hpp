@@ -19,8 +19,6 @@
 #include <fstream>
 #include <string>
 
-#include <ext/hash_map>
-
 #include <ace/OS.h>
 
 #include <El/Exception.hpp>
@@ -30,6 +28,7 @@
 #include <El/Country.hpp>
 #include <El/Lang.hpp>
 #include <El/Hash/Hash.hpp>
+#include <El/Hash/FlatMap.hpp>
 
 namespace El
 {
@@ -95,14 +94,14 @@ namespace El
 
     protected:
 
-      typedef __gnu_cxx::hash_map<El::Country::ElCode,
-                                  El::String::LightString,
-                                  El::Hash::Numeric<El::Country::ElCode> >
+      typedef El::Hash::FlatMap<El::Country::ElCode,
+                                El::String::LightString,
+                                El::Hash::Numeric<El::Country::ElCode> >
       CountryMap;
       
-      typedef __gnu_cxx::hash_map<El::Lang::ElCode,
-                                  El::String::LightString,
-                                  El::Hash::Numeric<El::Lang::ElCode> >
+      typedef El::Hash::FlatMap<El::Lang::ElCode,
+                                El::String::LightString,
+                                El::Hash::Numeric<El::Lang::ElCode> >
       LanguageMap;
       
       struct Word
@@ -110,9 +109,10 @@ namespace El
         El::String::LightString variants[WORD_VARIANTS];
       };
       
-      typedef __gnu_cxx::hash_map<El::String::LightString,
-                                  Word,
-                                  El::Hash::LightString>
+      // Looked up by const char* with no temporary LightString
+      typedef El::Hash::FlatMap<El::String::LightString,
+                                Word,
+                                El::Hash::LightString>
       WordMap;
 
       CountryMap countries_;
@@ -149,7 +149,10 @@ namespace El
       
       if(field_presence_mask_ & FP_TIME)
       {
-        ostr << time.rfc0822(false, true) << " ";
+        char buff[El::Moment::FORMAT_BUFF_SIZE];
+        time.format_rfc0822(buff, false, true);
+
+        ostr << buff << " ";
       }
 
       if(field_presence_mask_ & FP_SEVERITY)
@@ -17,14 +17,13 @@
 #include <string>
 #include <iostream>
 
-#include <ext/hash_set>
-
 #include <ace/OS.h>
 #include <ace/Synch.h>
 #include <ace/Guard_T.h>
 
 #include <El/Exception.hpp>
 #include <El/Hash/Hash.hpp>
+#include <El/Hash/FlatSet.hpp>
 #include <El/Moment.hpp>
 #include <El/RefCount/All.hpp>
 
@@ -116,7 +115,7 @@ namespace El
 
       mutable Mutex lock_;
 
-      typedef __gnu_cxx::hash_set<std::string, El::Hash::String> AspectTable;
+      typedef El::Hash::FlatSet<std::string, El::Hash::String> AspectTable;
 
       unsigned long level_;
       std::string aspects_;
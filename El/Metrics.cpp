@@ -0,0 +1,374 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Metrics.cpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#include <string.h>
+
+#include <string>
+#include <memory>
+#include <sstream>
+#include <algorithm>
+
+#include <El/Exception.hpp>
+
+#include "Metrics.hpp"
+
+namespace El
+{
+  namespace Metrics
+  {
+    //
+    // Histogram::Snapshot class
+    //
+    uint64_t
+    Histogram::Snapshot::percentile(double q) const throw()
+    {
+      uint64_t total_count = count();
+
+      if(total_count == 0)
+      {
+        return 0;
+      }
+
+      uint64_t rank = (uint64_t)(q * total_count + 0.5);
+
+      if(rank == 0)
+      {
+        rank = 1;
+      }
+
+      uint64_t accumulated = 0;
+
+      for(size_t i = 0; i < BUCKETS; ++i)
+      {
+        accumulated += counts[i];
+
+        if(accumulated >= rank)
+        {
+          return bucket_highest(i);
+        }
+      }
+
+      return bucket_highest(BUCKETS - 1);
+    }
+
+    //
+    // Registry class
+    //
+    Registry&
+    Registry::instance() throw(El::Exception)
+    {
+      // Never destroyed as metrics can be updated by threads and static
+      // objects destructed after ones of this module
+      static Registry* registry = new Registry();
+      return *registry;
+    }
+
+    Registry::Registry() throw(El::Exception)
+        : metric_count_(0)
+    {
+      memset(metrics_, 0, sizeof(metrics_));
+    }
+
+    Registry::~Registry() throw()
+    {
+      for(unsigned long i = 0; i < metric_count_; ++i)
+      {
+        delete metrics_[i];
+      }
+    }
+
+    unsigned long
+    Registry::define(const char* name,
+                     const char* help,
+                     MetricType type,
+                     double scale)
+      throw(InvalidArg, Exception, El::Exception)
+    {
+      if(name == 0 || *name == '\0')
+      {
+        throw InvalidArg("El::Metrics::Registry::define: name undefined");
+      }
+
+      for(const char* ptr = name; *ptr != '\0'; ++ptr)
+      {
+        char chr = *ptr;
+
+        if(!((chr >= 'a' && chr <= 'z') || (chr >= 'A' && chr <= 'Z') ||
+             chr == '_' || chr == ':' ||
+             (chr >= '0' && chr <= '9' && ptr != name)))
+        {
+          std::ostringstream ostr;
+          ostr << "El::Metrics::Registry::define: invalid metric name '"
+               << name << "'";
+
+          throw InvalidArg(ostr.str());
+        }
+      }
+
+      Guard guard(lock_);
+
+      for(unsigned long i = 0; i < metric_count_; ++i)
+      {
+        const Metric& metric = *metrics_[i];
+
+        if(metric.name == name)
+        {
+          if(metric.type != type || metric.scale != scale)
+          {
+            std::ostringstream ostr;
+            ostr << "El::Metrics::Registry::define: metric '" << name
+                 << "' is already defined with different type or scale";
+
+            throw InvalidArg(ostr.str());
+          }
+
+          return i;
+        }
+      }
+
+      if(metric_count_ == MAX_METRICS)
+      {
+        std::ostringstream ostr;
+        ostr << "El::Metrics::Registry::define: can't define '" << name
+             << "' as number of metrics reached maximum " << MAX_METRICS;
+
+        throw Exception(ostr.str());
+      }
+
+      std::auto_ptr<Metric> metric(new Metric());
+      metric->name = name;
+      metric->help = help ? help : "";
+      metric->type = type;
+      metric->scale = scale;
+      metric->gauge = 0;
+
+      metric->cell_count = type == MT_HISTOGRAM ? Histogram::BUCKETS + 1 :
+        (type == MT_COUNTER ? 1 : 0);
+
+      metric->retired.resize(metric->cell_count, 0);
+
+      metrics_[metric_count_] = metric.release();
+      return metric_count_++;
+    }
+
+    uint64_t*
+    Registry::create_cells(ThreadBlock* block, unsigned long id)
+      throw(El::Exception)
+    {
+      size_t count = 0;
+
+      {
+        Guard guard(lock_);
+        count = metrics_[id]->cell_count;
+      }
+
+      uint64_t* cells = new uint64_t[count];
+      memset(cells, 0, count * sizeof(cells[0]));
+
+      __atomic_store_n(&block->cells[id], cells, __ATOMIC_RELEASE);
+      return cells;
+    }
+
+    void
+    Registry::collect(unsigned long id, uint64_t* result) const
+      throw(El::Exception)
+    {
+      Guard guard(lock_);
+
+      const Metric& metric = *metrics_[id];
+      size_t count = metric.cell_count;
+
+      std::copy(metric.retired.begin(), metric.retired.end(), result);
+
+      for(ThreadBlockArray::const_iterator it(blocks_.begin()),
+            ie(blocks_.end()); it != ie; ++it)
+      {
+        const uint64_t* cells =
+          __atomic_load_n(&(*it)->cells[id], __ATOMIC_ACQUIRE);
+
+        if(cells)
+        {
+          for(size_t i = 0; i < count; ++i)
+          {
+            result[i] += __atomic_load_n(cells + i, __ATOMIC_RELAXED);
+          }
+        }
+      }
+    }
+
+    void
+    Registry::scrape(std::ostream& ostr) const throw(El::Exception)
+    {
+      unsigned long metric_count = 0;
+
+      {
+        Guard guard(lock_);
+        metric_count = metric_count_;
+      }
+
+      std::vector<uint64_t> cells(Histogram::BUCKETS + 1);
+
+      std::streamsize precision = ostr.precision(9);
+
+      for(unsigned long i = 0; i < metric_count; ++i)
+      {
+        const Metric& metric = *metrics_[i];
+
+        ostr << "# HELP " << metric.name << " " << metric.help
+             << "\n# TYPE " << metric.name << " ";
+
+        switch(metric.type)
+        {
+        case MT_COUNTER:
+          {
+            collect(i, &cells[0]);
+
+            ostr << "counter\n" << metric.name << " " << cells[0] << "\n";
+            break;
+          }
+        case MT_GAUGE:
+          {
+            ostr << "gauge\n" << metric.name << " "
+                 << __atomic_load_n(&metric.gauge, __ATOMIC_RELAXED)
+                 << "\n";
+            break;
+          }
+        case MT_HISTOGRAM:
+          {
+            collect(i, &cells[0]);
+
+            ostr << "histogram\n";
+            write_histogram(ostr, metric, &cells[0]);
+            break;
+          }
+        }
+      }
+
+      ostr.precision(precision);
+    }
+
+    void
+    Registry::write_histogram(std::ostream& ostr,
+                              const Metric& metric,
+                              const uint64_t* cells)
+      throw(El::Exception)
+    {
+      const char* name = metric.name.c_str();
+
+      size_t first = Histogram::BUCKETS;
+      size_t last = 0;
+      uint64_t count = 0;
+
+      for(size_t i = 0; i < Histogram::BUCKETS; ++i)
+      {
+        if(cells[i])
+        {
+          first = std::min(first, i);
+          last = i;
+          count += cells[i];
+        }
+      }
+
+      if(count)
+      {
+        //
+        // Boundaries are highest values of buckets starting with powers
+        // of 2, from the one above the lowest value recorded up to the
+        // one above the highest. Whole buckets up to boundary are counted,
+        // so all values counted are less or equal to it as le requires.
+        //
+        uint64_t accumulated = 0;
+        size_t bucket = 0;
+
+        for(unsigned long power = 0; power < 64; ++power)
+        {
+          size_t end = Histogram::bucket((uint64_t)1 << power) + 1;
+
+          for(; bucket < end; ++bucket)
+          {
+            accumulated += cells[bucket];
+          }
+
+          if(end <= first)
+          {
+            continue;
+          }
+
+          ostr << name << "_bucket{le=\""
+               << Histogram::bucket_highest(end - 1) * metric.scale
+               << "\"} " << accumulated << "\n";
+
+          if(end > last)
+          {
+            break;
+          }
+        }
+      }
+
+      ostr << name << "_bucket{le=\"+Inf\"} " << count << "\n"
+           << name << "_sum " << cells[Histogram::BUCKETS] * metric.scale
+           << "\n" << name << "_count " << count << "\n";
+    }
+
+    //
+    // Registry::ThreadBlock struct
+    //
+    Registry::ThreadBlock::ThreadBlock() throw(El::Exception)
+    {
+      memset(cells, 0, sizeof(cells));
+
+      Registry& registry = Registry::instance();
+
+      Guard guard(registry.lock_);
+      registry.blocks_.push_back(this);
+    }
+
+    Registry::ThreadBlock::~ThreadBlock() throw()
+    {
+      Registry& registry = Registry::instance();
+
+      {
+        Guard guard(registry.lock_);
+
+        ThreadBlockArray::iterator it =
+          std::find(registry.blocks_.begin(), registry.blocks_.end(), this);
+
+        if(it != registry.blocks_.end())
+        {
+          registry.blocks_.erase(it);
+        }
+
+        // Counts of exited thread are kept to stay cumulative
+        for(unsigned long i = 0; i < MAX_METRICS; ++i)
+        {
+          const uint64_t* thread_cells = cells[i];
+
+          if(thread_cells)
+          {
+            std::vector<uint64_t>& retired = registry.metrics_[i]->retired;
+
+            for(size_t j = 0; j < retired.size(); ++j)
+            {
+              retired[j] += thread_cells[j];
+            }
+          }
+        }
+      }
+
+      for(unsigned long i = 0; i < MAX_METRICS; ++i)
+      {
+        delete [] cells[i];
+      }
+    }
+  }
+}
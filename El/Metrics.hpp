@@ -0,0 +1,508 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Metrics.hpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#ifndef _ELEMENTS_EL_METRICS_HPP_
+#define _ELEMENTS_EL_METRICS_HPP_
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include <ace/OS.h>
+#include <ace/Synch.h>
+#include <ace/Guard_T.h>
+#include <ace/TSS_T.h>
+
+#include <El/Exception.hpp>
+
+namespace El
+{
+  namespace Metrics
+  {
+    EL_EXCEPTION(Exception, El::ExceptionBase);
+    EL_EXCEPTION(InvalidArg, Exception);
+
+    //
+    // Monotonic clock reading in nanoseconds
+    //
+    uint64_t now() throw();
+
+    class Registry;
+
+    //
+    // Histogram, counter and gauge objects are handles of metrics kept by
+    // the registry for process lifetime. Handles created with the same
+    // name refer to the same metric, so it can be updated from different
+    // modules.
+    //
+    // Histograms and counters are updated without locking and atomic
+    // read-modify-write operations: each thread updates own cells which
+    // are summed up on read.
+    //
+
+    //
+    // Log-linear histogram of unsigned integer values: each power of 2
+    // range is split into SUB_BUCKETS equal buckets, so relative error of
+    // value estimation is under 1/SUB_BUCKETS for any value.
+    //
+    class Histogram
+    {
+    public:
+      enum
+      {
+        SUB_BUCKET_BITS = 3,
+        SUB_BUCKETS = 1 << SUB_BUCKET_BITS,
+        BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS
+      };
+
+      //
+      // scale is a multiplier converting recorded values into ones
+      // exposed by scrape; default one is for values being nanoseconds
+      // exposed as seconds.
+      //
+      Histogram(const char* name, const char* help, double scale = 1e-9)
+        throw(InvalidArg, Exception, El::Exception);
+
+      void record(uint64_t value) throw(El::Exception);
+
+      class Snapshot
+      {
+      public:
+        Snapshot() throw();
+
+        uint64_t count() const throw();
+        uint64_t sum() const throw();
+
+        // Highest value of the bucket holding q-quantile, 0 <= q <= 1
+        uint64_t percentile(double q) const throw();
+
+        uint64_t counts[BUCKETS];
+        uint64_t total;
+      };
+
+      void snapshot(Snapshot& result) const throw(El::Exception);
+
+      static size_t bucket(uint64_t value) throw();
+      static uint64_t bucket_lowest(size_t index) throw();
+      static uint64_t bucket_highest(size_t index) throw();
+
+    private:
+      Histogram(const Histogram&);
+      void operator=(const Histogram&);
+
+    private:
+      Registry& registry_;
+      unsigned long id_;
+    };
+
+    class Counter
+    {
+    public:
+      Counter(const char* name, const char* help)
+        throw(InvalidArg, Exception, El::Exception);
+
+      void increment(uint64_t value = 1) throw(El::Exception);
+      uint64_t value() const throw(El::Exception);
+
+    private:
+      Counter(const Counter&);
+      void operator=(const Counter&);
+
+    private:
+      Registry& registry_;
+      unsigned long id_;
+    };
+
+    //
+    // Gauge is updated rarely comparing to histograms and counters and
+    // value should be known exactly at any moment, so is kept in a single
+    // atomically updated cell.
+    //
+    class Gauge
+    {
+    public:
+      Gauge(const char* name, const char* help)
+        throw(InvalidArg, Exception, El::Exception);
+
+      void set(int64_t value) throw();
+      void add(int64_t value) throw();
+      int64_t value() const throw();
+
+    private:
+      Gauge(const Gauge&);
+      void operator=(const Gauge&);
+
+    private:
+      int64_t* value_;
+    };
+
+    //
+    // Records time elapsed from construction till stop() call or
+    // destruction into the histogram
+    //
+    class Timing
+    {
+    public:
+      Timing(Histogram& histogram) throw();
+      ~Timing() throw();
+
+      void stop() throw();
+      void cancel() throw();
+
+    private:
+      Histogram& histogram_;
+      uint64_t started_;
+    };
+
+    class Registry
+    {
+    public:
+      enum MetricType
+      {
+        MT_COUNTER,
+        MT_GAUGE,
+        MT_HISTOGRAM
+      };
+
+      enum { MAX_METRICS = 256 };
+
+      static Registry& instance() throw(El::Exception);
+
+      //
+      // Writes all metrics of the process in Prometheus text exposition
+      // format (0.0.4). Histogram buckets are reported on boundaries which
+      // are highest values of buckets starting with powers of 2, within
+      // range of values recorded.
+      //
+      void scrape(std::ostream& ostr) const throw(El::Exception);
+
+      unsigned long define(const char* name,
+                           const char* help,
+                           MetricType type,
+                           double scale = 1)
+        throw(InvalidArg, Exception, El::Exception);
+
+      // Cells of the calling thread for the metric
+      uint64_t* cells(unsigned long id) throw(El::Exception);
+
+      // Sums cells of all threads for the metric
+      void collect(unsigned long id, uint64_t* result) const
+        throw(El::Exception);
+
+      int64_t* gauge(unsigned long id) throw();
+
+    private:
+      Registry() throw(El::Exception);
+      ~Registry() throw();
+
+      struct Metric
+      {
+        std::string name;
+        std::string help;
+        MetricType type;
+        double scale;
+        size_t cell_count;
+        int64_t gauge;
+
+        // Cells of exited threads
+        std::vector<uint64_t> retired;
+      };
+
+      struct ThreadBlock
+      {
+        ThreadBlock() throw(El::Exception);
+        ~ThreadBlock() throw();
+
+        uint64_t* cells[MAX_METRICS];
+      };
+
+      uint64_t* create_cells(ThreadBlock* block, unsigned long id)
+        throw(El::Exception);
+
+      static void write_histogram(std::ostream& ostr,
+                                  const Metric& metric,
+                                  const uint64_t* cells)
+        throw(El::Exception);
+
+    private:
+      typedef ACE_Thread_Mutex Mutex;
+      typedef ACE_Guard<Mutex> Guard;
+
+      mutable Mutex lock_;
+
+      Metric* metrics_[MAX_METRICS];
+      unsigned long metric_count_;
+
+      typedef std::vector<ThreadBlock*> ThreadBlockArray;
+      ThreadBlockArray blocks_;
+
+      ACE_TSS<ThreadBlock> thread_block_;
+    };
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Inlines
+///////////////////////////////////////////////////////////////////////////////
+
+namespace El
+{
+  namespace Metrics
+  {
+    inline
+    uint64_t
+    now() throw()
+    {
+      timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+    //
+    // Histogram class
+    //
+    inline
+    Histogram::Histogram(const char* name, const char* help, double scale)
+      throw(InvalidArg, Exception, El::Exception)
+        : registry_(Registry::instance()),
+          id_(registry_.define(name, help, Registry::MT_HISTOGRAM, scale))
+    {
+    }
+
+    inline
+    size_t
+    Histogram::bucket(uint64_t value) throw()
+    {
+      if(value < SUB_BUCKETS * 2)
+      {
+        return value;
+      }
+
+      unsigned long shift = 63 - __builtin_clzll(value) - SUB_BUCKET_BITS;
+
+      return (shift + 1) * SUB_BUCKETS +
+        ((value >> shift) - SUB_BUCKETS);
+    }
+
+    inline
+    uint64_t
+    Histogram::bucket_lowest(size_t index) throw()
+    {
+      if(index < SUB_BUCKETS * 2)
+      {
+        return index;
+      }
+
+      unsigned long shift = index / SUB_BUCKETS - 1;
+      return (uint64_t)(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+    }
+
+    inline
+    uint64_t
+    Histogram::bucket_highest(size_t index) throw()
+    {
+      if(index < SUB_BUCKETS * 2)
+      {
+        return index;
+      }
+
+      // Written so not to overflow for the last bucket
+      return bucket_lowest(index) +
+        (((uint64_t)1 << (index / SUB_BUCKETS - 1)) - 1);
+    }
+
+    inline
+    void
+    Histogram::record(uint64_t value) throw(El::Exception)
+    {
+      uint64_t* cells = registry_.cells(id_);
+
+      // Only current thread writes the cells; atomic stores are for
+      // readers never to see torn values
+      uint64_t& count = cells[bucket(value)];
+      __atomic_store_n(&count, count + 1, __ATOMIC_RELAXED);
+
+      uint64_t& total = cells[BUCKETS];
+      __atomic_store_n(&total, total + value, __ATOMIC_RELAXED);
+    }
+
+    inline
+    void
+    Histogram::snapshot(Snapshot& result) const throw(El::Exception)
+    {
+      uint64_t cells[BUCKETS + 1];
+      registry_.collect(id_, cells);
+
+      memcpy(result.counts, cells, sizeof(result.counts));
+      result.total = cells[BUCKETS];
+    }
+
+    //
+    // Histogram::Snapshot class
+    //
+    inline
+    Histogram::Snapshot::Snapshot() throw()
+        : total(0)
+    {
+      memset(counts, 0, sizeof(counts));
+    }
+
+    inline
+    uint64_t
+    Histogram::Snapshot::count() const throw()
+    {
+      uint64_t result = 0;
+
+      for(size_t i = 0; i < BUCKETS; ++i)
+      {
+        result += counts[i];
+      }
+
+      return result;
+    }
+
+    inline
+    uint64_t
+    Histogram::Snapshot::sum() const throw()
+    {
+      return total;
+    }
+
+    //
+    // Counter class
+    //
+    inline
+    Counter::Counter(const char* name, const char* help)
+      throw(InvalidArg, Exception, El::Exception)
+        : registry_(Registry::instance()),
+          id_(registry_.define(name, help, Registry::MT_COUNTER))
+    {
+    }
+
+    inline
+    void
+    Counter::increment(uint64_t value) throw(El::Exception)
+    {
+      uint64_t& cell = *registry_.cells(id_);
+      __atomic_store_n(&cell, cell + value, __ATOMIC_RELAXED);
+    }
+
+    inline
+    uint64_t
+    Counter::value() const throw(El::Exception)
+    {
+      uint64_t result = 0;
+      registry_.collect(id_, &result);
+      return result;
+    }
+
+    //
+    // Gauge class
+    //
+    inline
+    Gauge::Gauge(const char* name, const char* help)
+      throw(InvalidArg, Exception, El::Exception)
+    {
+      Registry& registry = Registry::instance();
+      value_ = registry.gauge(registry.define(name, help, Registry::MT_GAUGE));
+    }
+
+    inline
+    void
+    Gauge::set(int64_t value) throw()
+    {
+      __atomic_store_n(value_, value, __ATOMIC_RELAXED);
+    }
+
+    inline
+    void
+    Gauge::add(int64_t value) throw()
+    {
+      __atomic_add_fetch(value_, value, __ATOMIC_RELAXED);
+    }
+
+    inline
+    int64_t
+    Gauge::value() const throw()
+    {
+      return __atomic_load_n(value_, __ATOMIC_RELAXED);
+    }
+
+    //
+    // Timing class
+    //
+    inline
+    Timing::Timing(Histogram& histogram) throw()
+        : histogram_(histogram),
+          started_(now())
+    {
+    }
+
+    inline
+    Timing::~Timing() throw()
+    {
+      stop();
+    }
+
+    inline
+    void
+    Timing::stop() throw()
+    {
+      if(started_)
+      {
+        uint64_t started = started_;
+        started_ = 0;
+
+        try
+        {
+          histogram_.record(now() - started);
+        }
+        catch(...)
+        {
+        }
+      }
+    }
+
+    inline
+    void
+    Timing::cancel() throw()
+    {
+      started_ = 0;
+    }
+
+    //
+    // Registry class
+    //
+    inline
+    uint64_t*
+    Registry::cells(unsigned long id) throw(El::Exception)
+    {
+      ThreadBlock* block = thread_block_;
+      uint64_t* cells = block->cells[id];
+      return cells ? cells : create_cells(block, id);
+    }
+
+    inline
+    int64_t*
+    Registry::gauge(unsigned long id) throw()
+    {
+      return &metrics_[id]->gauge;
+    }
+  }
+}
+
+#endif // _ELEMENTS_EL_METRICS_HPP_
@@ -11,9 +11,14 @@
  * $id:$
  */
 
-#include <iomanip>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
 #include <sstream>
 
+#include <ace/TSS_T.h>
+
 #include <El/String/Manip.hpp>
 
 #include "Moment.hpp"
@@ -23,7 +28,335 @@ namespace
   static char WHITESPACES[] = " \t\n\r";
   static char WHITESPACES_ZzPM[] = " \t\n\rZz+-";
   static char WHITESPACES_T[] = " \t\n\rT";
-  
+
+  const char* const MONTHS[] =
+  {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+  };
+
+  const char* const WEEK_DAYS[] =
+  {
+    "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"
+  };
+
+  //
+  // Name lookup tables: slot is calculated by multiplicative hash of name
+  // key, and holds name index or the table size for empty slot
+  //
+  const uint32_t MONTH_HASH_MULTIPLIER = 26597;
+  const unsigned long MONTH_HASH_BITS = 4;
+
+  const uint8_t MONTH_SLOTS[] =
+  {
+    6, 10, 12, 9, 4, 11, 2, 3, 12, 8, 12, 12, 0, 5, 1, 7
+  };
+
+  const uint32_t WEEK_DAY_HASH_MULTIPLIER = 4895;
+  const unsigned long WEEK_DAY_HASH_BITS = 3;
+
+  const uint8_t WEEK_DAY_SLOTS[] =
+  {
+    7, 1, 0, 3, 2, 6, 4, 5
+  };
+
+  //
+  // Case insensitive key of 3 letter name. Setting 0x20 bit turns upper
+  // case latin letters into lower case ones and never turns other
+  // characters into latin letters.
+  //
+  inline
+  uint32_t
+  name_key(const char* name) throw()
+  {
+    return (uint32_t)((unsigned char)name[0] | 0x20) |
+      (uint32_t)((unsigned char)name[1] | 0x20) << 8 |
+      (uint32_t)((unsigned char)name[2] | 0x20) << 16;
+  }
+
+  //
+  // Returns index of the name or -1 if not found; same as sequence of
+  // strcasecmp calls would find
+  //
+  inline
+  int
+  find_name(const char* name,
+            size_t len,
+            const char* const* names,
+            size_t count,
+            const uint8_t* slots,
+            uint32_t multiplier,
+            unsigned long bits)
+    throw()
+  {
+    if(len != 3)
+    {
+      return -1;
+    }
+
+    uint32_t key = name_key(name);
+    size_t index = slots[(uint32_t)(key * multiplier) >> (32 - bits)];
+
+    return index < count && name_key(names[index]) == key ? index : -1;
+  }
+
+  inline
+  int
+  find_month(const char* name, size_t len) throw()
+  {
+    return find_name(name, len, MONTHS, 12, MONTH_SLOTS,
+                     MONTH_HASH_MULTIPLIER, MONTH_HASH_BITS);
+  }
+
+  inline
+  int
+  find_week_day(const char* name, size_t len) throw()
+  {
+    return find_name(name, len, WEEK_DAYS, 7, WEEK_DAY_SLOTS,
+                     WEEK_DAY_HASH_MULTIPLIER, WEEK_DAY_HASH_BITS);
+  }
+
+  inline
+  bool
+  token_equal(const char* token, size_t len, const char* str) throw()
+  {
+    return strncmp(token, str, len) == 0 && str[len] == '\0';
+  }
+
+  //
+  // Same as strtol(std::string(str, len).c_str(), &end, 10); parsed is
+  // set to number of characters parsed
+  //
+  long
+  to_long(const char* str, size_t len, size_t* parsed = 0)
+    throw(El::Exception)
+  {
+    char buff[64];
+
+    if(len >= sizeof(buff))
+    {
+      std::string val(str, len);
+      char* end = 0;
+      long result = strtol(val.c_str(), &end, 10);
+
+      if(parsed)
+      {
+        *parsed = end - val.c_str();
+      }
+
+      return result;
+    }
+
+    memcpy(buff, str, len);
+    buff[len] = '\0';
+
+    char* end = 0;
+    long result = strtol(buff, &end, 10);
+
+    if(parsed)
+    {
+      *parsed = end - buff;
+    }
+
+    return result;
+  }
+
+  //
+  // Writes value as std::ostream does with fill character and width
+  // specified
+  //
+  template<typename TYPE>
+  char*
+  write_int(char* ptr, TYPE value, size_t width = 0, char fill = '0')
+    throw()
+  {
+    char buff[24];
+    char* end = buff + sizeof(buff);
+    char* begin = end;
+
+    bool negative = value < 0;
+
+    unsigned long long val = negative ?
+      0ULL - (unsigned long long)value : (unsigned long long)value;
+
+    do
+    {
+      *--begin = '0' + val % 10;
+      val /= 10;
+    }
+    while(val);
+
+    if(negative)
+    {
+      *--begin = '-';
+    }
+
+    for(size_t len = end - begin; len < width; ++len)
+    {
+      *ptr++ = fill;
+    }
+
+    memcpy(ptr, begin, end - begin);
+    return ptr + (end - begin);
+  }
+
+  inline
+  char*
+  write_str(char* ptr, const char* str) throw()
+  {
+    size_t len = strlen(str);
+    memcpy(ptr, str, len);
+    return ptr + len;
+  }
+
+  //
+  // Proleptic Gregorian calendar arithmetic replacing timegm and
+  // gmtime_r. Dates are counted in days from 1970-01-01.
+  //
+  const int64_t SECONDS_PER_DAY = 86400;
+
+  // Range of days which year fits into tm::tm_year, so representable by
+  // gmtime_r
+  const int64_t MIN_DAYS = -784352321872LL;
+  const int64_t MAX_DAYS = 784352270736LL;
+
+  inline
+  int64_t
+  floor_div(int64_t value, int64_t divisor) throw()
+  {
+    int64_t result = value / divisor;
+    return value % divisor < 0 ? result - 1 : result;
+  }
+
+  // Month is 1-12, day is 1-31
+  inline
+  int64_t
+  days_from_civil(int64_t year, unsigned long month, unsigned long day)
+    throw()
+  {
+    year -= month <= 2;
+
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    unsigned long year_of_era = year - era * 400;
+
+    unsigned long day_of_year =
+      (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+
+    unsigned long day_of_era = year_of_era * 365 + year_of_era / 4 -
+      year_of_era / 100 + day_of_year;
+
+    return era * 146097 + day_of_era - 719468;
+  }
+
+  inline
+  void
+  civil_from_days(int64_t days,
+                  int64_t& year,
+                  unsigned long& month,
+                  unsigned long& day)
+    throw()
+  {
+    days += 719468;
+
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    unsigned long day_of_era = days - era * 146097;
+
+    unsigned long year_of_era = (day_of_era - day_of_era / 1460 +
+      day_of_era / 36524 - day_of_era / 146096) / 365;
+
+    unsigned long day_of_year = day_of_era -
+      (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+
+    unsigned long mp = (5 * day_of_year + 2) / 153;
+
+    day = day_of_year - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = year_of_era + era * 400 + (month <= 2);
+  }
+
+  const char*
+  gmt_zone() throw()
+  {
+    // Same zone name pointer as gmtime_r sets
+    static const char* zone = 0;
+
+    if(zone == 0)
+    {
+      tm tmp;
+      time_t sec = 0;
+      gmtime_r(&sec, &tmp);
+      zone = tmp.tm_zone;
+    }
+
+    return zone;
+  }
+
+  // Returns false if year can't be represented by tm
+  bool
+  gm_time(int64_t sec, tm& result) throw()
+  {
+    int64_t days = floor_div(sec, SECONDS_PER_DAY);
+
+    if(days < MIN_DAYS || days > MAX_DAYS)
+    {
+      return false;
+    }
+
+    unsigned long day_sec = sec - days * SECONDS_PER_DAY;
+
+    int64_t year = 0;
+    unsigned long month = 0;
+    unsigned long day = 0;
+
+    civil_from_days(days, year, month, day);
+
+    result.tm_year = year - 1900;
+    result.tm_mon = month - 1;
+    result.tm_mday = day;
+    result.tm_hour = day_sec / 3600;
+    result.tm_min = day_sec / 60 % 60;
+    result.tm_sec = day_sec % 60;
+    result.tm_wday = days - floor_div(days + 4, 7) * 7 + 4;
+    result.tm_yday = days - days_from_civil(year, 1, 1);
+    result.tm_isdst = 0;
+    result.tm_gmtoff = 0;
+    result.tm_zone = gmt_zone();
+
+    return true;
+  }
+
+  //
+  // Same as timegm but doesn't normalize the structure. Returns false
+  // if timegm would fail.
+  //
+  bool
+  gm_seconds(const tm& time, int64_t& sec) throw()
+  {
+    int64_t year = (int64_t)time.tm_year + 1900 + floor_div(time.tm_mon, 12);
+    unsigned long month = time.tm_mon - floor_div(time.tm_mon, 12) * 12 + 1;
+
+    int64_t days = days_from_civil(year, month, 1) + time.tm_mday - 1;
+
+    sec = days * SECONDS_PER_DAY + (int64_t)time.tm_hour * 3600 +
+      (int64_t)time.tm_min * 60 + time.tm_sec;
+
+    days = floor_div(sec, SECONDS_PER_DAY);
+    return days >= MIN_DAYS && days <= MAX_DAYS;
+  }
+
+  //
+  // Per-thread cache of the last second El::Moment::http_date formatted
+  //
+  struct HttpDateCache
+  {
+    time_t sec;
+    size_t length;
+    char text[El::Moment::FORMAT_BUFF_SIZE];
+
+    HttpDateCache() throw() : sec(0), length(0) { text[0] = '\0'; }
+  };
+
+  ACE_TSS<HttpDateCache> http_date_cache;
 }
 
 namespace El
@@ -43,7 +376,7 @@ namespace El
 
     if (tz == TZ_GMT)
     {
-      if(ACE_OS::gmtime_r(&sec, this) == 0)
+      if(!gm_time(sec, *this))
       {
         std::ostringstream ostr;
         ostr << "El::Moment::Moment: "
@@ -99,9 +432,24 @@ namespace El
 
     if(p)
     {
-      std::string s(str, p - str);
+      size_t len = p - str;
+      char buff[64];
+
+      std::string long_str;
+      const char* sec_str = buff;
+
+      if(len < sizeof(buff))
+      {
+        memcpy(buff, str, len);
+        buff[len] = '\0';
+      }
+      else
+      {
+        long_str.assign(str, len);
+        sec_str = long_str.c_str();
+      }
 
-      if(!El::String::Manip::numeric(s.c_str(), sec) ||
+      if(!El::String::Manip::numeric(sec_str, sec) ||
          !El::String::Manip::numeric(p + 1, usec))
       {
         std::ostringstream ostr;
@@ -149,13 +497,10 @@ namespace El
       //
       // Reading year
       //
-      std::string val;
-      val.assign(ptr, 4);
-
-      char* end = 0;
-      year = strtol(val.c_str(), &end, 10);
+      size_t parsed = 0;
+      year = to_long(ptr, 4, &parsed);
 
-      valid_time = (*end == '\0' && year > 1900) || year == 0;
+      valid_time = (parsed == 4 && year > 1900) || year == 0;
 
       ptr += 4;
       pos -= 4;
@@ -182,15 +527,12 @@ namespace El
     {
       if(pos >= 2)
       {
-        std::string val;
-        val.assign(ptr, 2);
-        
-        char* end = 0;
-        month = strtol(val.c_str(), &end, 10);
+        size_t parsed = 0;
+        month = to_long(ptr, 2, &parsed);
         
         month_read = true;
         
-        valid_time = *end == '\0' &&
+        valid_time = parsed == 2 &&
           ((month >= 1 && month <= 12) || (!year && !month));
       }
       
@@ -215,15 +557,12 @@ namespace El
     {
       if(pos == 2)
       {
-        std::string val;
-        val.assign(ptr, pos);
-
-        char* end = 0;
-        day = strtol(val.c_str(), &end, 10);
+        size_t parsed = 0;
+        day = to_long(ptr, pos, &parsed);
         
         day_read = true;
         
-        valid_time = *end == '\0' && ((day >= 1 && day <= 31) ||
+        valid_time = parsed == pos && ((day >= 1 && day <= 31) ||
                                       (!year && !month && !day));
       }
       else
@@ -288,19 +627,13 @@ namespace El
     {
       if(ptr[2] == ':')
       {
-        std::string hval;
-        hval.assign(ptr, 2);
-
-        char* hend = 0;
-        hour = strtol(hval.c_str(), &hend, 10);
+        size_t hparsed = 0;
+        hour = to_long(ptr, 2, &hparsed);
 
-        std::string mval;
-        mval.assign(ptr + 3, 2);
+        size_t mparsed = 0;
+        minute = to_long(ptr + 3, 2, &mparsed);
 
-        char* mend = 0;
-        minute = strtol(mval.c_str(), &mend, 10);
-
-        valid_time = *hend == '\0' && *mend == '\0' && hour >= 0 &&
+        valid_time = hparsed == 2 && mparsed == 2 && hour >= 0 &&
           hour < 24 && minute >= 0 && minute < 60;
       }
       else
@@ -319,15 +652,12 @@ namespace El
 
         if(pos == 2 || (pos > 2 && ptr[2] == '.'))
         {
-          std::string val;
-          val.assign(ptr, 2);
-
-          char* end = 0;
-          sec = strtol(val.c_str(), &end, 10);
+          size_t parsed = 0;
+          sec = to_long(ptr, 2, &parsed);
 
 //          sec_read = true;
 
-          valid_time = valid_time && *end == '\0' && sec >= 0 && sec < 60;
+          valid_time = valid_time && parsed == 2 && sec >= 0 && sec < 60;
         }
         else
         {
@@ -397,19 +727,13 @@ namespace El
     }
     else if(pos == 6)
     {
-      std::string hval;
-      hval.assign(ptr + 1, 2);
+      size_t hparsed = 0;
+      hour = to_long(ptr + 1, 2, &hparsed);
 
-      char* hend = 0;
-      hour = strtol(hval.c_str(), &hend, 10);
+      size_t mparsed = 0;
+      minute = to_long(ptr + 4, 2, &mparsed);
 
-      std::string mval;
-      mval.assign(ptr + 4, 2);
-
-      char* mend = 0;
-      minute = strtol(mval.c_str(), &mend, 10);
-
-      valid_time = *hend == '\0' && *mend == '\0' &&
+      valid_time = hparsed == 2 && mparsed == 2 &&
         (*ptr == '+' || *ptr == '-') &&
         hour >= 0 && hour < 24 && minute >= 0 && minute < 60;
 
@@ -450,30 +774,25 @@ namespace El
     }
 
     pos = strcspn(ptr, WHITESPACES);
-    std::string val;
-    val.assign(ptr, pos);
-
-    int day = atol(val.c_str());
+    int day = to_long(ptr, pos);
 
     if(day > 0 && day <= 31)
     {
       ptr += pos + 1;
       ptr += strspn(ptr, WHITESPACES);
       pos = strcspn(ptr, WHITESPACES);
-      val.assign(ptr, pos);
         
       try
       {
-        int month = El::Moment::month(val.c_str());
+        int month = find_month(ptr, pos);
 
         ptr += pos + 1;
         ptr += strspn(ptr, WHITESPACES);
         pos = strcspn(ptr, WHITESPACES);
-        val.assign(ptr, pos);
           
-        int year = atol(val.c_str());
+        int year = to_long(ptr, pos);
 
-        if(year >= 1900)
+        if(month >= 0 && year >= 1900)
         {
           ptr += pos + 1;
           ptr += strspn(ptr, WHITESPACES);
@@ -481,16 +800,13 @@ namespace El
 
           if(pos >= 5 && ptr[2] == ':')
           {
-            val.assign(ptr, 2);
-            int hour = atol(val.c_str());
-
-            val.assign(ptr + 3, 2);
-            int min = atol(val.c_str());
+            int hour = to_long(ptr, 2);
+            int min = to_long(ptr + 3, 2);
             int sec = 0;
               
             if(pos == 8)
             {
-              sec = atol(ptr + 6);
+              sec = strtol(ptr + 6, 0, 10);
             }
 
             if(hour >= 0 && hour <= 24 && min >= 0 && min <= 60 &&
@@ -510,42 +826,41 @@ namespace El
               ptr += strspn(ptr, WHITESPACES);
               pos = strcspn(ptr, WHITESPACES);
 
-              val.assign(ptr, pos);
-
               int shift = 0;
                 
               valid_time = true;
                 
-              if(val == "UT" || val == "GMT")
+              if(token_equal(ptr, pos, "UT") || token_equal(ptr, pos, "GMT"))
               {
                 // do nothing
               }
-              else if(val == "EST" || val == "CDT")
+              else if(token_equal(ptr, pos, "EST") ||
+                      token_equal(ptr, pos, "CDT"))
               {
                 shift = -5 * 60;
               }
-              else if(val == "EDT")
+              else if(token_equal(ptr, pos, "EDT"))
               {
                 shift = -4 * 60;
               }
-              else if(val == "CST" || val == "MDT")
+              else if(token_equal(ptr, pos, "CST") ||
+                      token_equal(ptr, pos, "MDT"))
               {
                 shift = -6 * 60;
               }
-              else if(val == "MST" || val == "PDT")
+              else if(token_equal(ptr, pos, "MST") ||
+                      token_equal(ptr, pos, "PDT"))
               {
                 shift = -7 * 60;
               }
-              else if(val == "PST")
+              else if(token_equal(ptr, pos, "PST"))
               {
                 shift = -8 * 60;
               }
               else if(pos == 5)
               {
-                val.assign(ptr + 1, 2);
-                  
                 shift = (*ptr == '-' ? -1 : 1) *
-                  (60 * atol(val.c_str()) + atol(ptr + 3));
+                  (60 * to_long(ptr + 1, 2) + strtol(ptr + 3, 0, 10));
               }
               else if(pos == 1)
               {
@@ -618,61 +933,17 @@ namespace El
       throw InvalidArg("El::Moment::month: nil month specified");
     }
 
-    if(!strcasecmp(mon, "Jan"))
-    {
-      return 0;
-    }
-    else if(!strcasecmp(mon, "Feb"))
-    {
-      return 1;
-    }
-    else if(!strcasecmp(mon, "Mar"))
-    {
-      return 2;
-    }
-    else if(!strcasecmp(mon, "Apr"))
-    {
-      return 3;
-    }
-    else if(!strcasecmp(mon, "May"))
-    {
-      return 4;
-    }
-    else if(!strcasecmp(mon, "Jun"))
-    {
-      return 5;
-    }
-    else if(!strcasecmp(mon, "Jul"))
-    {
-      return 6;
-    }
-    else if(!strcasecmp(mon, "Aug"))
-    {
-      return 7;
-    }
-    else if(!strcasecmp(mon, "Sep"))
-    {
-      return 8;
-    }
-    else if(!strcasecmp(mon, "Oct"))
-    {
-      return 9;
-    }
-    else if(!strcasecmp(mon, "Nov"))
-    {
-      return 10;
-    }
-    else if(!strcasecmp(mon, "Dec"))
-    {
-      return 11;
-    }
-    else
+    int index = find_month(mon, strlen(mon));
+
+    if(index < 0)
     {
       std::ostringstream ostr;
       ostr << "El::Moment::month: invalid month specified '" << mon << "'";
 
       throw InvalidArg(ostr.str());
-    }    
+    }
+
+    return index;
   }
 
   inline
@@ -688,23 +959,7 @@ namespace El
       throw InvalidArg(ostr.str());
     }
 
-    static const char* months[] = 
-      {
-        "Jan",
-        "Feb",
-        "Mar",
-        "Apr",
-        "May",
-        "Jun",
-        "Jul",
-        "Aug",
-        "Sep",
-        "Oct",
-        "Nov",
-        "Dec"
-      };
-
-    return months[month];
+    return MONTHS[month];
   }
 
   inline
@@ -716,41 +971,17 @@ namespace El
       throw InvalidArg("El::Moment::week_day: day is null");
     }
 
-    if(!strcasecmp(day, "Sun"))
-    {
-      return 0;
-    }
-    else if(!strcasecmp(day, "Mon"))
-    {
-      return 1;
-    }
-    else if(!strcasecmp(day, "Tue"))
-    {
-      return 2;
-    }
-    else if(!strcasecmp(day, "Wed"))
-    {
-      return 3;
-    }
-    else if(!strcasecmp(day, "Thu"))
-    {
-      return 4;
-    }
-    else if(!strcasecmp(day, "Fri"))
-    {
-      return 5;
-    }
-    else if(!strcasecmp(day, "Sat"))
-    {
-      return 6;
-    }
-    else
+    int index = find_week_day(day, strlen(day));
+
+    if(index < 0)
     {
       std::ostringstream ostr;
       ostr << "El::Moment::week_day: invalid day specified '" << day << "'";
 
       throw InvalidArg(ostr.str());
-    }    
+    }
+
+    return index;
   }
 
   const char*
@@ -764,18 +995,7 @@ namespace El
       throw InvalidArg(ostr.str());
     }
 
-    static const char* days[] = 
-      {
-        "Sun",
-        "Mon",
-        "Tue",
-        "Wed",
-        "Thu",
-        "Fri",
-        "Sat"
-      };
-
-    return days[day];
+    return WEEK_DAYS[day];
   }
   
   Moment::operator ACE_Time_Value() const throw ()
@@ -797,8 +1017,11 @@ namespace El
       sec = ::mktime(&tmp);
       break;
     case TZ_GMT:
-      sec = ::timegm(&tmp);
-      break;
+      {
+        int64_t res = 0;
+        sec = gm_seconds(tmp, res) ? res : -1;
+        break;
+      }
     }
 
     if(!is_time)
@@ -819,7 +1042,8 @@ namespace El
       time_t res;
       if (tm_tz == TZ_GMT)
       {
-        res = timegm(this);
+        int64_t sec = 0;
+        res = gm_seconds(*this, sec) && gm_time(sec, *this) ? sec : -1;
       }
       else
       {
@@ -834,64 +1058,43 @@ namespace El
     
   }
   
-  std::string
-  Moment::iso8601(bool timezone, bool time) const
+  char*
+  Moment::format_iso8601(char* buff, bool timezone, bool time) const
     throw(Exception, El::Exception)
   {
-    std::ostringstream ostr;
+    char* ptr = buff;
 
     if(tm_year)
     {
-      ostr << tm_year + 1900 << "-";
-
-      ostr.width(2);
-      ostr.fill('0');
-      ostr << tm_mon + 1 << "-";
-    
-      ostr.width(2);
-      ostr.fill('0');
-      ostr << tm_mday;
+      ptr = write_int(ptr, tm_year + 1900);
+      *ptr++ = '-';
+      ptr = write_int(ptr, tm_mon + 1, 2);
+      *ptr++ = '-';
+      ptr = write_int(ptr, tm_mday, 2);
     }
     else
     {
-      ostr << "0000-00-00";
+      ptr = write_str(ptr, "0000-00-00");
     }
 
     if(time)
     {
-      ostr << " ";
-      
-      ostr.width(2);
-      ostr.fill('0');
-      ostr << tm_hour << ":";
-    
-      ostr.width(2);
-      ostr.fill('0');
-      ostr << tm_min << ":";
-
-      ostr.width(2);
-      ostr.fill('0');
-      ostr << tm_sec;
+      *ptr++ = ' ';
+      ptr = write_int(ptr, tm_hour, 2);
+      *ptr++ = ':';
+      ptr = write_int(ptr, tm_min, 2);
+      *ptr++ = ':';
+      ptr = write_int(ptr, tm_sec, 2);
 
       if(tm_usec)
       {
-        std::ostringstream usec_ostr;
-      
-        usec_ostr.width(6);
-        usec_ostr.fill('0');      
-        usec_ostr << tm_usec;
-
-        std::string usec = usec_ostr.str();
-        int i = usec.length() - 1;
-      
-        for(; i > 0 && usec[i] == '0'; i--);
+        *ptr++ = '.';
 
-        if(i >= 0)
-        {
-          usec.resize(i + 1);
-        }
+        char* usec = ptr;
+        ptr = write_int(ptr, tm_usec, 6);
 
-        ostr << "." << usec;
+        // Trailing zeros are trimmed leaving at least one character
+        for(; ptr - usec > 1 && ptr[-1] == '0'; --ptr);
       }
     }
     
@@ -899,7 +1102,7 @@ namespace El
     {  
       if(tm_tz == TZ_GMT)
       {
-        ostr << " Z";
+        ptr = write_str(ptr, " Z");
       }
       else
       {
@@ -911,120 +1114,137 @@ namespace El
           throw Exception("El::Moment::iso8601: localtime_r failed");
         }
       
-        ostr << " " << (tmp.tm_gmtoff < 0 ? "-" : "+");
-
-        ostr.width(2);
-        ostr.fill('0');
-        ostr << tmp.tm_gmtoff / 3600 << ":";
-      
-        ostr.width(2);
-        ostr.fill('0');
-        ostr << tmp.tm_gmtoff / 60 % 60;
+        *ptr++ = ' ';
+        *ptr++ = tmp.tm_gmtoff < 0 ? '-' : '+';
+        ptr = write_int(ptr, tmp.tm_gmtoff / 3600, 2);
+        *ptr++ = ':';
+        ptr = write_int(ptr, tmp.tm_gmtoff / 60 % 60, 2);
       }
     }
-    
-    return ostr.str();
+
+    *ptr = '\0';
+    return ptr;
   }
 
-  std::string
-  Moment::http_cookie_expiration() const throw(Exception, El::Exception)
+  char*
+  Moment::format_http_cookie_expiration(char* buff) const
+    throw(Exception, El::Exception)
   {
     if(tm_tz == TZ_LOCAL)
     {
-      return Moment(ACE_Time_Value(*this), TZ_GMT).http_cookie_expiration();
+      return Moment(ACE_Time_Value(*this), TZ_GMT).
+        format_http_cookie_expiration(buff);
     }
-      
-    std::ostringstream ostr;
-    ostr << week_day(tm_wday) << ", " << tm_mday << "-" << month(tm_mon)
-         << "-" << 1900 + tm_year << " " << std::setw(2) << std::setfill('0')
-         << tm_hour << ":" << std::setw(2) << tm_min << ":" << std::setw(2)
-         << tm_sec << " GMT";
 
-    return ostr.str();
+    char* ptr = write_str(buff, week_day(tm_wday));
+    *ptr++ = ',';
+    *ptr++ = ' ';
+    ptr = write_int(ptr, tm_mday);
+    *ptr++ = '-';
+    ptr = write_str(ptr, month(tm_mon));
+    *ptr++ = '-';
+    ptr = write_int(ptr, 1900 + tm_year);
+    *ptr++ = ' ';
+    ptr = write_int(ptr, tm_hour, 2);
+    *ptr++ = ':';
+    ptr = write_int(ptr, tm_min, 2);
+    *ptr++ = ':';
+    ptr = write_int(ptr, tm_sec, 2);
+    ptr = write_str(ptr, " GMT");
+
+    *ptr = '\0';
+    return ptr;
   }
-  
-  std::string
-  Moment::dense_format(unsigned long flags) const
+
+  char*
+  Moment::format_dense(char* buff, unsigned long flags) const
     throw(Exception, El::Exception)
   {
-    std::ostringstream ostr;
+    char* ptr = buff;
+
+    // Zero fill is used only when date is written, spaces otherwise
+    char fill = ' ';
 
     if(flags & DF_DATE)
     {
-      ostr << tm_year + 1900 << std::setw(2) << std::setfill('0')
-           << tm_mon + 1 << std::setw(2) << tm_mday;
+      fill = '0';
+
+      ptr = write_int(ptr, tm_year + 1900);
+      ptr = write_int(ptr, tm_mon + 1, 2, fill);
+      ptr = write_int(ptr, tm_mday, 2, fill);
       
       if(flags & DF_TIME)
       {
-        ostr << ".";
+        *ptr++ = '.';
       }
     }
     
     if(flags & DF_TIME)
     {
-      ostr << std::setw(2) << tm_hour << std::setw(2) << tm_min
-           << std::setw(2) << tm_sec;
+      ptr = write_int(ptr, tm_hour, 2, fill);
+      ptr = write_int(ptr, tm_min, 2, fill);
+      ptr = write_int(ptr, tm_sec, 2, fill);
       
       if(flags & DF_USEC)
       {
-        ostr << std::setw(6) << tm_usec;
+        ptr = write_int(ptr, tm_usec, 6, fill);
       }
     }
 
-    return ostr.str();
+    *ptr = '\0';
+    return ptr;
   }
 
-  std::string
-  Moment::epoch(bool usec) const throw(Exception, El::Exception)
+  char*
+  Moment::format_epoch(char* buff, bool usec) const
+    throw(Exception, El::Exception)
   {
     ACE_Time_Value tm(*this);
-    
-    std::ostringstream ostr;
-    ostr << tm.sec();
+
+    char* ptr = write_int(buff, tm.sec());
 
     if(usec)
     {
-      ostr << ".";
-      ostr.width(6);
-      ostr.fill('0');
-      ostr << tm.usec();
+      *ptr++ = '.';
+      ptr = write_int(ptr, tm.usec(), 6);
     }
 
-    return ostr.str();
+    *ptr = '\0';
+    return ptr;
   }
-  
-  std::string
-  Moment::rfc0822(bool timezone, bool usec) const
+
+  char*
+  Moment::format_rfc0822(char* buff, bool timezone, bool usec) const
     throw(Exception, El::Exception)
   {
-    std::ostringstream ostr;
-    ostr << week_day(tm_wday) << ", " << tm_mday << " " << month(tm_mon)
-         << " " << 1900 + tm_year << " ";
-    
-    ostr.width(2);
-    ostr.fill('0');
-    ostr << tm_hour << ":";
-    
-    ostr.width(2);
-    ostr.fill('0');
-    ostr << tm_min << ":";
-
-    ostr.width(2);
-    ostr.fill('0');
-    ostr << tm_sec;
+    char* ptr = write_str(buff, week_day(tm_wday));
+    *ptr++ = ',';
+    *ptr++ = ' ';
+    ptr = write_int(ptr, tm_mday);
+    *ptr++ = ' ';
+    ptr = write_str(ptr, month(tm_mon));
+    *ptr++ = ' ';
+    ptr = write_int(ptr, 1900 + tm_year);
+    *ptr++ = ' ';
+    ptr = write_int(ptr, tm_hour, 2);
+    *ptr++ = ':';
+    ptr = write_int(ptr, tm_min, 2);
+    *ptr++ = ':';
+    ptr = write_int(ptr, tm_sec, 2);
 
     if(usec)
     {
-      ostr << "." << std::setw(6) << std::setfill('0') << tm_usec;
+      *ptr++ = '.';
+      ptr = write_int(ptr, tm_usec, 6);
     }
 
     if(timezone)
     {
-      ostr << " ";
+      *ptr++ = ' ';
 
       if(tm_tz == TZ_GMT)
       {
-        ostr << "GMT";
+        ptr = write_str(ptr, "GMT");
       }
       else
       {
@@ -1036,50 +1256,60 @@ namespace El
           throw Exception("El::Moment::iso8601: localtime_r failed");
         }
       
-        ostr << (tmp.tm_gmtoff < 0 ? "-" : "+");
-
-        ostr.width(2);
-        ostr.fill('0');
-        ostr << abs(tmp.tm_gmtoff) / 3600;
-      
-        ostr.width(2);
-        ostr.fill('0');
-        ostr << abs(tmp.tm_gmtoff) / 60 % 60;
+        *ptr++ = tmp.tm_gmtoff < 0 ? '-' : '+';
+        ptr = write_int(ptr, abs(tmp.tm_gmtoff) / 3600, 2);
+        ptr = write_int(ptr, abs(tmp.tm_gmtoff) / 60 % 60, 2);
       }
     }
-    
-    return ostr.str();
+
+    *ptr = '\0';
+    return ptr;
   }
-  
-  std::string
-  Moment::time(const ACE_Time_Value& val, bool days) throw(El::Exception)
+
+  char*
+  Moment::format_time(char* buff, const ACE_Time_Value& val, bool days)
+    throw(El::Exception)
   {
-    std::ostringstream ostr;
+    char* ptr = buff;
     uint64_t sec = val.sec();
 
     if(days)
     {
       uint64_t d = sec / 86400;
       sec -= d * 86400;
-      ostr << d << "-";
+      ptr = write_int(ptr, d);
+      *ptr++ = '-';
+    }
+
+    ptr = write_int(ptr, sec / 3600, 2);
+    *ptr++ = ':';
+    ptr = write_int(ptr, (sec % 3600) / 60, 2);
+    *ptr++ = ':';
+    ptr = write_int(ptr, sec % 60, 2);
+    *ptr++ = '.';
+    ptr = write_int(ptr, val.usec(), 6);
+
+    *ptr = '\0';
+    return ptr;
+  }
+
+  char*
+  Moment::http_date(char* buff, time_t sec) throw(Exception, El::Exception)
+  {
+    HttpDateCache* cache = http_date_cache;
+
+    if(cache->length && cache->sec == sec)
+    {
+      memcpy(buff, cache->text, cache->length + 1);
+      return buff + cache->length;
     }
-    
-    ostr.width(2);
-    ostr.fill('0');
-    ostr << sec / 3600 << ":";
-    
-    ostr.width(2);
-    ostr.fill('0');
-    ostr << (sec % 3600) / 60 << ":";
 
-    ostr.width(2);
-    ostr.fill('0');
-    ostr << sec % 60 << ".";
+    char* end = Moment(ACE_Time_Value(sec)).format_rfc0822(buff);
 
-    ostr.width(6);
-    ostr.fill('0');      
-    ostr << val.usec();
+    cache->length = end - buff;
+    memcpy(cache->text, buff, cache->length + 1);
+    cache->sec = sec;
 
-    return ostr.str();
+    return end;
   }
 }
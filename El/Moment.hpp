@@ -16,6 +16,8 @@
 
 #include <time.h>
 
+#include <string>
+
 #include <El/Exception.hpp>
 #include <El/BinaryStream.hpp>
 
@@ -157,6 +159,46 @@ namespace El
     static std::string time(const ACE_Time_Value& val, bool days = false)
       throw(El::Exception);
 
+    //
+    // Allocation-free counterparts of the functions above. Each writes
+    // zero-terminated text into the buffer of at least FORMAT_BUFF_SIZE
+    // characters and returns pointer to the terminating zero.
+    //
+    enum { FORMAT_BUFF_SIZE = 160 };
+
+    char* format_iso8601(char* buff,
+                         bool timezone = true,
+                         bool time = true) const
+      throw(Exception, El::Exception);
+
+    char* format_rfc0822(char* buff,
+                         bool timezone = true,
+                         bool usec = false) const
+      throw(Exception, El::Exception);
+
+    char* format_epoch(char* buff, bool usec = false) const
+      throw(Exception, El::Exception);
+
+    char* format_dense(char* buff, unsigned long flags = DF_ALL) const
+      throw(Exception, El::Exception);
+
+    char* format_http_cookie_expiration(char* buff) const
+      throw(Exception, El::Exception);
+
+    static char* format_time(char* buff,
+                             const ACE_Time_Value& val,
+                             bool days = false)
+      throw(El::Exception);
+
+    //
+    // Writes HTTP Date header value for the second, same as
+    // Moment(ACE_Time_Value(sec)).rfc0822() produces. Text of the last
+    // second formatted is cached per thread, so a server stamping
+    // responses formats it once a second.
+    //
+    static char* http_date(char* buff, time_t sec)
+      throw(Exception, El::Exception);
+
     static ACE_Time_Value divide(const ACE_Time_Value& p1, unsigned long p2)
       throw();
 
@@ -311,6 +353,57 @@ namespace El
     return Moment(ACE_Time_Value(*this) - val);
   }
 
+  inline
+  std::string
+  Moment::iso8601(bool timezone, bool time) const
+    throw(Exception, El::Exception)
+  {
+    char buff[FORMAT_BUFF_SIZE];
+    return std::string(buff, format_iso8601(buff, timezone, time));
+  }
+
+  inline
+  std::string
+  Moment::rfc0822(bool timezone, bool usec) const
+    throw(Exception, El::Exception)
+  {
+    char buff[FORMAT_BUFF_SIZE];
+    return std::string(buff, format_rfc0822(buff, timezone, usec));
+  }
+
+  inline
+  std::string
+  Moment::epoch(bool usec) const throw(Exception, El::Exception)
+  {
+    char buff[FORMAT_BUFF_SIZE];
+    return std::string(buff, format_epoch(buff, usec));
+  }
+
+  inline
+  std::string
+  Moment::dense_format(unsigned long flags) const
+    throw(Exception, El::Exception)
+  {
+    char buff[FORMAT_BUFF_SIZE];
+    return std::string(buff, format_dense(buff, flags));
+  }
+
+  inline
+  std::string
+  Moment::http_cookie_expiration() const throw(Exception, El::Exception)
+  {
+    char buff[FORMAT_BUFF_SIZE];
+    return std::string(buff, format_http_cookie_expiration(buff));
+  }
+
+  inline
+  std::string
+  Moment::time(const ACE_Time_Value& val, bool days) throw(El::Exception)
+  {
+    char buff[FORMAT_BUFF_SIZE];
+    return std::string(buff, format_time(buff, val, days));
+  }
+
   inline
   ACE_Time_Value
   Moment::divide(const ACE_Time_Value& p1, unsigned long p2) throw()
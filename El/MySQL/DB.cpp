@@ -5,9 +5,13 @@
  *             Commercial; contact karen.arutyunov@gmail.com
  */
 
-#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <sstream>
+#include <algorithm>
+
 #include <ace/OS.h>
 
 #include <El/Exception.hpp>
@@ -24,6 +28,7 @@ namespace El
     bool DB::MySQLLibInit::initialized_(false);
     ACE_TSS<DB::MySQLThreadInit> DB::thread_init_;
     DB::MySQLLibInit DB::lib_init_;
+    ACE_Thread_Mutex ConnectionPoolFactory::slots_lock_;
     
     //
     // DB::MySQLThreadInit class
@@ -130,9 +135,10 @@ namespace El
     //
     Connection::Connection(DB* db,
                            const char* initialization,
-                           const char* charset)
+                           const char* charset,
+                           bool hold_db)
       throw(Exception, El::Exception)
-        : db_(RefCount::add_ref<DB>(db)),
+        : db_(hold_db ? RefCount::add_ref<DB>(db) : 0),
           mysql_(0)
           
     {
@@ -208,17 +214,17 @@ namespace El
         }
 
         if (!mysql_real_connect(mysql_,
-                                db_->host(),
-                                db_->user(),
-                                db_->passwd(),
-                                db_->db(),
-                                db_->port(),
-                                db_->unix_socket(),
-                                db_->client_flag()))
+                                db->host(),
+                                db->user(),
+                                db->passwd(),
+                                db->db(),
+                                db->port(),
+                                db->unix_socket(),
+                                db->client_flag()))
         {
           std::ostringstream ostr;
           ostr << "El::MySQL::Connection::Connection: mysql_real_connect failed."
-            " DB info:\n" << *db_.in() << "\nError: code "  << std::dec
+            " DB info:\n" << *db << "\nError: code "  << std::dec
                << mysql_errno(mysql_) << ", description:\n"
                << mysql_error(mysql_);
       
@@ -444,34 +450,517 @@ namespace El
       return row_ != 0;
     }
 
+    //
+    // El::MySQL::RowView class
+    //
+
+    bool
+    RowView::fetch_row() throw(Exception, El::Exception)
+    {
+      DB::init_thread();
+
+      row_ = mysql_fetch_row(res_);
+
+      if(row_ == 0)
+      {
+        lengths_ = 0;
+
+        MYSQL* mysql = result_->connection()->mysql();
+
+        if(mysql_errno(mysql))
+        {
+          std::ostringstream ostr;
+          ostr << "RowView::fetch_row: mysql_fetch_row failed."
+          " DB info:\n" << *result_->db() << "\nError: code "  << std::dec
+               << mysql_errno(mysql) << ", description:\n"
+               << mysql_error(mysql);
+
+          throw Exception(ostr.str());
+        }
+
+        return false;
+      }
+
+      lengths_ = mysql_fetch_lengths(res_);
+      return true;
+    }
+
+    void
+    RowView::data_seek(unsigned long long offset)
+      throw(Exception, El::Exception)
+    {
+      DB::init_thread();
+
+      mysql_data_seek(res_, offset);
+    }
+
+    double
+    RowView::floating(size_t index, const char* name) const
+      throw(IsNull, Exception, El::Exception)
+    {
+      size_t length = 0;
+      const char* ptr = text(index, name, length);
+
+      // Column text is zero-terminated in the row buffer
+      char* end = 0;
+      double value = strtod(ptr, &end);
+
+      if(length == 0 || end != ptr + length)
+      {
+        throw_conversion_error(index, name);
+      }
+
+      return value;
+    }
+
+    uint64_t
+    RowView::bit(size_t index, const char* name) const
+      throw(IsNull, Exception, El::Exception)
+    {
+      size_t length = 0;
+      const unsigned char* ptr =
+        (const unsigned char*)text(index, name, length);
+
+      if(length > sizeof(uint64_t))
+      {
+        throw_conversion_error(index, name);
+      }
+
+      uint64_t value = 0;
+
+      for(const unsigned char* end = ptr + length; ptr != end; ++ptr)
+      {
+        value = (value << 8) | *ptr;
+      }
+
+      return value;
+    }
+
+    El::Moment
+    RowView::moment(size_t index, const char* name) const
+      throw(IsNull, Exception, El::Exception)
+    {
+      size_t length = 0;
+      const char* ptr = text(index, name, length);
+
+      El::Moment value;
+      value.set_iso8601(ptr);
+
+      return value;
+    }
+
+    void
+    RowView::throw_conversion_error(size_t index, const char* name) const
+      throw(Exception, El::Exception)
+    {
+      std::ostringstream ostr;
+      ostr << "El::MySQL::RowView: failed to convert '" << name
+           << "' field data '";
+
+      ostr.write(row_[index], lengths_[index]);
+      ostr << "'";
+
+      throw Exception(ostr.str());
+    }
+
+    //
+    // El::MySQL::InsertBuilder class
+    //
+
+    InsertBuilder::InsertBuilder(Connection* connection,
+                                 const char* prefix,
+                                 size_t capacity)
+      throw(Exception, El::Exception)
+        : connection_(RefCount::add_ref(connection)),
+          buffer_(0),
+          capacity_(0),
+          size_(0),
+          prefix_size_(0),
+          rows_(0),
+          row_start_(0),
+          row_started_(false),
+          first_value_(false)
+    {
+      if(connection == 0)
+      {
+        throw Exception(
+          "El::MySQL::InsertBuilder::InsertBuilder: connection is 0");
+      }
+
+      prefix_size_ = strlen(prefix);
+      capacity_ = std::max(capacity, prefix_size_ + 1);
+
+      buffer_ = new char[capacity_];
+      memcpy(buffer_, prefix, prefix_size_);
+
+      reset();
+    }
+
+    InsertBuilder::~InsertBuilder() throw()
+    {
+      delete [] buffer_;
+    }
+
+    unsigned long
+    InsertBuilder::execute() throw(Exception, El::Exception)
+    {
+      if(row_started_)
+      {
+        throw Exception("El::MySQL::InsertBuilder::execute: row not ended");
+      }
+
+      if(rows_ == 0)
+      {
+        return 0;
+      }
+
+      Result_var result = connection_->query(buffer_, size_);
+      unsigned long affected_rows = connection_->affected_rows();
+
+      reset();
+      return affected_rows;
+    }
+
+    void
+    InsertBuilder::begin_row() throw(Exception, El::Exception)
+    {
+      if(row_started_)
+      {
+        throw Exception(
+          "El::MySQL::InsertBuilder::begin_row: previous row not ended");
+      }
+
+      row_start_ = size_;
+
+      char* ptr = reserve(2);
+
+      if(rows_)
+      {
+        *ptr++ = ',';
+      }
+
+      *ptr++ = '(';
+
+      size_ = ptr - buffer_;
+      row_started_ = true;
+      first_value_ = true;
+    }
+
+    void
+    InsertBuilder::end_row() throw(Exception, El::Exception)
+    {
+      if(!row_started_ || first_value_)
+      {
+        throw Exception(
+          "El::MySQL::InsertBuilder::end_row: no row values added");
+      }
+
+      char* ptr = reserve(1);
+      *ptr++ = ')';
+      *ptr = '\0';
+
+      size_ = ptr - buffer_;
+      row_started_ = false;
+      rows_++;
+    }
+
+    char*
+    InsertBuilder::reserve(size_t size) throw(Exception, El::Exception)
+    {
+      // Terminating zero should fit as well
+      size_t required = size_ + size + 1;
+
+      if(required > capacity_)
+      {
+        size_t capacity = std::max(capacity_ * 2, required);
+        char* buffer = new char[capacity];
+
+        memcpy(buffer, buffer_, size_);
+        delete [] buffer_;
+
+        buffer_ = buffer;
+        capacity_ = capacity;
+      }
+
+      return buffer_ + size_;
+    }
+
+    char*
+    InsertBuilder::begin_value(size_t size) throw(Exception, El::Exception)
+    {
+      if(!row_started_)
+      {
+        throw Exception(
+          "El::MySQL::InsertBuilder::begin_value: row not begun");
+      }
+
+      char* ptr = reserve(size + 1);
+
+      if(first_value_)
+      {
+        first_value_ = false;
+      }
+      else
+      {
+        *ptr++ = ',';
+      }
+
+      return ptr;
+    }
+
+    void
+    InsertBuilder::add_null() throw(Exception, El::Exception)
+    {
+      char* ptr = begin_value(4);
+      memcpy(ptr, "NULL", 4);
+
+      size_ = ptr + 4 - buffer_;
+    }
+
+    void
+    InsertBuilder::add_string(const StringView& value)
+      throw(Exception, El::Exception)
+    {
+      if(value.is_null())
+      {
+        add_null();
+        return;
+      }
+
+      // Escaped text takes twice the length at most
+      char* ptr = begin_value(value.length() * 2 + 2);
+
+      *ptr++ = '\'';
+
+      ptr += mysql_real_escape_string(connection_->mysql(),
+                                      ptr,
+                                      value.data(),
+                                      value.length());
+      *ptr++ = '\'';
+
+      size_ = ptr - buffer_;
+    }
+
+    void
+    InsertBuilder::add_integer(int64_t value) throw(Exception, El::Exception)
+    {
+      if(value < 0)
+      {
+        char* ptr = begin_value(20);
+        *ptr++ = '-';
+
+        // Negated in unsigned type as the least value has no positive pair
+        char buff[20];
+        char* end = buff + sizeof(buff);
+        char* begin = end;
+
+        for(uint64_t val = -(uint64_t)value; val; val /= 10)
+        {
+          *--begin = '0' + val % 10;
+        }
+
+        memcpy(ptr, begin, end - begin);
+        size_ = ptr + (end - begin) - buffer_;
+      }
+      else
+      {
+        add_unsigned(value);
+      }
+    }
+
+    void
+    InsertBuilder::add_unsigned(uint64_t value)
+      throw(Exception, El::Exception)
+    {
+      char buff[20];
+      char* end = buff + sizeof(buff);
+      char* begin = end;
+
+      do
+      {
+        *--begin = '0' + value % 10;
+        value /= 10;
+      }
+      while(value);
+
+      char* ptr = begin_value(end - begin);
+      memcpy(ptr, begin, end - begin);
+
+      size_ = ptr + (end - begin) - buffer_;
+    }
+
+    void
+    InsertBuilder::add_double(double value) throw(Exception, El::Exception)
+    {
+      if(value != value || value - value != 0)
+      {
+        std::ostringstream ostr;
+        ostr << "El::MySQL::InsertBuilder::add_double: value " << value
+             << " can't be stored";
+
+        throw Exception(ostr.str());
+      }
+
+      char* ptr = begin_value(32);
+      size_ = ptr + snprintf(ptr, 32, "%.17g", value) - buffer_;
+    }
+
+    void
+    InsertBuilder::add_moment(const El::Moment& value)
+      throw(Exception, El::Exception)
+    {
+      char* ptr = begin_value(El::Moment::FORMAT_BUFF_SIZE + 2);
+
+      *ptr++ = '\'';
+      ptr = value.format_iso8601(ptr, false);
+      *ptr++ = '\'';
+
+      size_ = ptr - buffer_;
+    }
+
     //
     // ConnectionPoolFactory class
     //
-    ConnectionPoolFactory::ConnectionPoolFactory(unsigned long min_connections,
-                                                 unsigned long max_connections,
-                                                 const char* initialization,
-                                                 const char* charset)
+    ConnectionPoolFactory::ConnectionPoolFactory(
+      unsigned long min_connections,
+      unsigned long max_connections,
+      const char* initialization,
+      const char* charset,
+      const ACE_Time_Value& keep_alive_period,
+      bool thread_affinity)
       throw(InvalidArg, Exception, El::Exception)
         : db_(0),
           min_connections_(min_connections),
           max_connections_(max_connections),
           initialization_(initialization ? initialization : ""),
           charset_(charset ? charset : ""),
+          keep_alive_period_(keep_alive_period),
+          thread_affinity_(thread_affinity),
           used_connections_(0),
           waiting_connection_(0),
-          connection_released_(lock_)
+          pending_connections_(0),
+          connection_released_(lock_),
+          maintenance_(lock_),
+          thread_slots_(0),
+          stop_(false),
+          thread_started_(false),
+          wait_time_("el_mysql_pool_wait_seconds",
+                     "Time spent waiting for a pooled MySQL connection"),
+          timeouts_("el_mysql_pool_timeouts_total",
+                    "MySQL connection pool wait timeouts"),
+          opened_("el_mysql_pool_opened_total",
+                  "MySQL connections opened by pools"),
+          failures_("el_mysql_pool_failures_total",
+                    "MySQL pool connection open and ping failures"),
+          pings_("el_mysql_pool_pings_total",
+                 "Keep-alive pings of idle pooled MySQL connections"),
+          dropped_("el_mysql_pool_dropped_total",
+                   "Pooled MySQL connections closed as dead"),
+          affinity_hits_("el_mysql_pool_affinity_hits_total",
+                         "MySQL connections reused by the releasing thread"),
+          used_gauge_("el_mysql_pool_connections_used",
+                      "Pooled MySQL connections in use"),
+          idle_gauge_("el_mysql_pool_connections_idle",
+                      "Pooled MySQL connections waiting for use"),
+          published_used_(0),
+          published_idle_(0)
     {
       if(min_connections_ > max_connections_)
       {
         throw InvalidArg("El::MySQL::DB: min_connections should not be "
                          "greater than max_connections");
       }
+
+      if(thread_affinity_ &&
+         pthread_key_create(&thread_key_, thread_exit))
+      {
+        throw Exception("El::MySQL::ConnectionPoolFactory::"
+                        "ConnectionPoolFactory: pthread_key_create failed");
+      }
     }
       
     ConnectionPoolFactory::~ConnectionPoolFactory() throw()
     {
       DB::init_thread();
+
+      if(thread_started_)
+      {
+        {
+          Guard guard(lock_);
+          stop_ = true;
+          maintenance_.signal();
+        }
+
+        pthread_join(thread_, 0);
+      }
+
+      if(thread_affinity_)
+      {
+        ReusableConnectionArray connections;
+
+        {
+          Guard slots_guard(slots_lock_);
+          Guard guard(lock_);
+
+          pthread_key_delete(thread_key_);
+
+          // thread_exit can be already called for a slot and wait for
+          // slots_lock_, so slots are left for it to free. Slots of
+          // threads keeping running are leaked as the key is deleted.
+          while(thread_slots_)
+          {
+            ThreadSlot* slot = thread_slots_;
+            thread_slots_ = slot->next;
+
+            connections.push_back(
+              __atomic_exchange_n(&slot->connection,
+                                  (ReusableConnection*)0,
+                                  __ATOMIC_ACQUIRE));
+
+            slot->factory = 0;
+          }
+        }
+
+        // Closing parked connections out of the lock
+        connections.clear();
+      }
+
+      Guard guard(lock_);
+      
       connections_.clear();
+      used_connections_ = 0;
+      update_gauges();
+    }
+
+    void
+    ConnectionPoolFactory::db(DB* db) throw(Exception, El::Exception)
+    {      
+      DB::init_thread();
+
+      db_ = db;
+
+      if(keep_alive_period_ != ACE_Time_Value::zero)
+      {
+        if(pthread_create(&thread_, 0, thread_func, this))
+        {
+          throw Exception("El::MySQL::ConnectionPoolFactory::db: "
+                          "pthread_create failed");
+        }
+
+        thread_started_ = true;
+        return;
+      }
+
+      ReusableConnectionArray connections(min_connections_);
+      
+      for(size_t i = 0; i < min_connections_; i++)
+      {
+        connections[i] = create_connection(false);
+      }
+
+      Guard guard(lock_);
+      connections_.swap(connections);
+      update_gauges();
     }
     
     Connection*
@@ -480,91 +969,217 @@ namespace El
     {
       DB::init_thread();
 
-      Guard guard(lock_);
-
-      ReusableConnection_var connection = reuse_connection();
+      ReusableConnection_var connection;
+      bool parked = false;
 
-      if(connection.in() != 0)
+      if(thread_affinity_)
       {
-        return connection.retn();
-      }
+        ThreadSlot* slot =
+          static_cast<ThreadSlot*>(pthread_getspecific(thread_key_));
+        
+        connection = slot ?
+          __atomic_exchange_n(&slot->connection,
+                              (ReusableConnection*)0,
+                              __ATOMIC_ACQUIRE) : 0;
 
-      ACE_Time_Value abstime;
-      bool with_timeout = wait_time != 0;
-      
-      if(with_timeout)
-      {
-        abstime = ACE_OS::gettimeofday() + *wait_time;
+        if(connection.in())
+        {
+          affinity_hits_.increment();
+          parked = true;
+        }
+        else
+        {
+          thread_slot();
+        }
       }
 
-      waiting_connection_++;
-      
-      do
+      if(connection.in() == 0)
       {
-        if(connection_released_.wait(with_timeout ? &abstime : 0))
+        uint64_t started = El::Metrics::now();
+
         {
-          int error = ACE_OS::last_error();
-          
-          if(with_timeout && error == ETIME)
-          {
-            waiting_connection_--;
+          Guard guard(lock_);
+
+          connection = reuse_connection();
 
-            throw Timeout("El::DB::ConnectionPoolFactory::connect: "
-                          "timeout expired");
+          if(connection.in() == 0 &&
+             used_connections_ + pending_connections_ < max_connections_)
+          {
+            // Reserving a place for the connection to be opened
+            used_connections_++;
+            update_gauges();
           }
-          else
+          else if(connection.in() == 0)
           {
-            waiting_connection_--;
+            ACE_Time_Value abstime;
+            bool with_timeout = wait_time != 0;
+      
+            if(with_timeout)
+            {
+              abstime = ACE_OS::gettimeofday() + *wait_time;
+            }
+
+            __atomic_add_fetch(&waiting_connection_, 1, __ATOMIC_SEQ_CST);
+
+            // Connection parked after this point will be seen as
+            // waited for by the parking thread
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+      
+            while((connection = reuse_connection()).in() == 0)
+            {
+              if((connection = take_parked()).in() != 0)
+              {
+                parked = true;
+                break;
+              }
 
-            std::ostringstream ostr;
+              if(used_connections_ + pending_connections_ < max_connections_)
+              {
+                break;
+              }
+              
+              if(connection_released_.wait(with_timeout ? &abstime : 0))
+              {
+                int error = ACE_OS::last_error();
+
+                __atomic_sub_fetch(&waiting_connection_,
+                                   1,
+                                   __ATOMIC_SEQ_CST);
+          
+                if(with_timeout && error == ETIME)
+                {
+                  timeouts_.increment();
+                  wait_time_.record(El::Metrics::now() - started);
+
+                  throw Timeout("El::DB::ConnectionPoolFactory::connect: "
+                                "timeout expired");
+                }
+                else
+                {
+                  std::ostringstream ostr;
             
-            ostr << "El::DB::ConnectionPoolFactory::connect: "
-              "connection_released_.wait() failed. Errno " << error <<
-              ". Description:" << std::endl << ACE_OS::strerror(error);
+                  ostr << "El::DB::ConnectionPoolFactory::connect: "
+                    "connection_released_.wait() failed. Errno " << error <<
+                    ". Description:" << std::endl << ACE_OS::strerror(error);
             
-            throw Exception(ostr.str());
+                  throw Exception(ostr.str());
+                }
+              }
+            }
+
+            __atomic_sub_fetch(&waiting_connection_, 1, __ATOMIC_SEQ_CST);
+
+            if(connection.in() == 0)
+            {
+              used_connections_++;
+              update_gauges();
+            }
           }
+        }
+
+        wait_time_.record(El::Metrics::now() - started);
+      }
+
+      if(parked && keep_alive_period_ == ACE_Time_Value::zero)
+      {
+        // No maintenance thread to check the connection while parked
+        pings_.increment();
+        
+        if(!connection->ping())
+        {
+          failures_.increment();
+          dropped_.increment();
+
+          // Reopening in place of the dead one, counted as used already
+          connection = 0;
+        }
+      }
+
+      if(connection.in() == 0)
+      {
+        // Opening connection out of the lock not to block other callers
+        try
+        {
+          connection = create_connection(true);
+        }
+        catch(...)
+        {
+          Guard guard(lock_);
+          
+          used_connections_--;
+          update_gauges();
+
+          connection_released_.signal();
+          maintenance_.signal();
           
+          throw;
         }
       }
-      while(used_connections_ == max_connections_);
 
-      waiting_connection_--;
-      return reuse_connection();
+      connection->factory_ = this;
+      connection->db_ = RefCount::add_ref<DB>(db_);
+        
+      return connection.retn();
     }
 
     ConnectionPoolFactory::ReusableConnection*
-    ConnectionPoolFactory::reuse_connection() throw(Exception, El::Exception)
+    ConnectionPoolFactory::reuse_connection() throw()
     {
-      DB::init_thread();
-
-      if(!connections_.empty())
+      if(connections_.empty())
       {
-        used_connections_++;
-        
-        ReusableConnection_var connection = *connections_.rbegin();
-        connections_.resize(connections_.size() - 1);
+        return 0;
+      }
 
-        connection->factory_ = this;
-        connection->db_ = RefCount::add_ref<DB>(db_);
+      used_connections_++;
         
-        return connection.retn();
-      }
+      ReusableConnection_var connection = *connections_.rbegin();
+      connections_.resize(connections_.size() - 1);
+
+      update_gauges();
+      return connection.retn();
+    }
 
-      if(used_connections_ < max_connections_)
+    ConnectionPoolFactory::ReusableConnection*
+    ConnectionPoolFactory::take_parked() throw()
+    {
+      for(ThreadSlot* slot = thread_slots_; slot; slot = slot->next)
       {
-        std::auto_ptr<ReusableConnection>
-          connection(new ReusableConnection(db_,
-                                            this,
-                                            initialization_.c_str(),
-                                            charset_.c_str()));
-        used_connections_++;
-        return connection.release();
+        ReusableConnection* connection =
+          __atomic_exchange_n(&slot->connection,
+                              (ReusableConnection*)0,
+                              __ATOMIC_ACQUIRE);
+
+        if(connection)
+        {
+          // Parked connection is counted as used already
+          return connection;
+        }
       }
 
       return 0;
     }
 
+    ConnectionPoolFactory::ReusableConnection*
+    ConnectionPoolFactory::create_connection(bool hold_db)
+      throw(Exception, El::Exception)
+    {
+      try
+      {
+        ReusableConnection* connection =
+          new ReusableConnection(db_,
+                                 hold_db ? this : 0,
+                                 initialization_.c_str(),
+                                 charset_.c_str());
+        opened_.increment();
+        return connection;
+      }
+      catch(...)
+      {
+        failures_.increment();
+        throw;
+      }
+    }
+
     void
     ConnectionPoolFactory::released(const ReusableConnection* connection)
       throw()
@@ -574,28 +1189,382 @@ namespace El
       ReusableConnection* conn = const_cast<ReusableConnection*>(connection);
       conn->factory_ = 0;
       conn->db_ = 0;
+      conn->ref_count_ = 1;
+      conn->idle_since_ = El::Metrics::now();
 
-      Guard guard(lock_);
+      if(!thread_affinity_ || !park(conn))
+      {
+        release_to_pool(conn);
+      }
+    }
+
+    bool
+    ConnectionPoolFactory::park(ReusableConnection* connection) throw()
+    {
+      ThreadSlot* slot =
+        static_cast<ThreadSlot*>(pthread_getspecific(thread_key_));
+
+      ReusableConnection* empty = 0;
+
+      if(slot == 0 ||
+         !__atomic_compare_exchange_n(&slot->connection,
+                                      &empty,
+                                      connection,
+                                      false,
+                                      __ATOMIC_SEQ_CST,
+                                      __ATOMIC_RELAXED))
+      {
+        return false;
+      }
 
-      bool recycle = waiting_connection_ == 0 &&
-        (used_connections_ + connections_.size()) > min_connections_;
+      if(__atomic_load_n(&waiting_connection_, __ATOMIC_SEQ_CST))
+      {
+        // Someone waits for a connection and could miss the parked one
+        connection = __atomic_exchange_n(&slot->connection,
+                                         (ReusableConnection*)0,
+                                         __ATOMIC_ACQUIRE);
+        if(connection)
+        {
+          release_to_pool(connection);
+        }
+      }
 
-      used_connections_--;
+      return true;
+    }
+
+    void
+    ConnectionPoolFactory::release_to_pool(ReusableConnection* connection)
+      throw()
+    {
+      ReusableConnection_var conn = connection;
+
+      {
+        Guard guard(lock_);
+
+        bool recycle =
+          __atomic_load_n(&waiting_connection_, __ATOMIC_RELAXED) == 0 &&
+          (used_connections_ + connections_.size() + pending_connections_) >
+          min_connections_;
+
+        used_connections_--;
+
+        if(!recycle)
+        {
+          connections_.push_back(conn);
+          conn = 0;
+        }
+
+        update_gauges();
+        connection_released_.signal();
+      }
+
+      // Closing out of the lock, if recycled
+      conn = 0;
+    }
+
+    void
+    ConnectionPoolFactory::thread_slot() throw(El::Exception)
+    {
+      if(pthread_getspecific(thread_key_))
+      {
+        return;
+      }
+
+      ThreadSlot* slot = new ThreadSlot();
+      slot->factory = this;
+      slot->connection = 0;
+      slot->prev = 0;
+
+      {
+        Guard guard(lock_);
+
+        slot->next = thread_slots_;
+
+        if(thread_slots_)
+        {
+          thread_slots_->prev = slot;
+        }
+
+        thread_slots_ = slot;
+      }
+
+      pthread_setspecific(thread_key_, slot);
+    }
+
+    void
+    ConnectionPoolFactory::thread_exit(void* arg) throw()
+    {
+      ThreadSlot* slot = static_cast<ThreadSlot*>(arg);
+
+      DB::init_thread();
+
+      // Keeping the factory from being destroyed till the parked
+      // connection is returned to it
+      Guard slots_guard(slots_lock_);
       
-      if(recycle)
+      ConnectionPoolFactory* factory = slot->factory;
+
+      if(factory == 0)
       {
-        delete conn;
+        // Factory is destroyed already, parked connection closed by it
+        delete slot;
+        return;
       }
-      else
+      
+      {
+        Guard guard(factory->lock_);
+
+        if(slot->prev)
+        {
+          slot->prev->next = slot->next;
+        }
+        else
+        {
+          factory->thread_slots_ = slot->next;
+        }
+
+        if(slot->next)
+        {
+          slot->next->prev = slot->prev;
+        }
+      }
+
+      ReusableConnection* connection =
+        __atomic_exchange_n(&slot->connection,
+                            (ReusableConnection*)0,
+                            __ATOMIC_ACQUIRE);
+
+      delete slot;
+
+      if(connection)
+      {
+        factory->release_to_pool(connection);
+      }
+    }
+
+    void*
+    ConnectionPoolFactory::thread_func(void* arg) throw()
+    {
+      static_cast<ConnectionPoolFactory*>(arg)->run();
+      return 0;
+    }
+
+    void
+    ConnectionPoolFactory::run() throw()
+    {
+      DB::init_thread();
+
+      while(true)
+      {
+        try
+        {
+          warm_up();
+          check_idle();
+          reclaim_parked();
+        }
+        catch(const El::Exception& e)
+        {
+          Guard guard(lock_);
+          last_error_ = e.what();
+        }
+
+        Guard guard(lock_);
+
+        if(stop_)
+        {
+          break;
+        }
+
+        ACE_Time_Value abstime = ACE_OS::gettimeofday() + keep_alive_period_;
+        maintenance_.wait(&abstime);
+
+        if(stop_)
+        {
+          break;
+        }
+      }
+    }
+
+    void
+    ConnectionPoolFactory::warm_up() throw(El::Exception)
+    {
+      while(true)
       {
-        conn->ref_count_ = 1;
+        {
+          Guard guard(lock_);
+
+          if(stop_ || used_connections_ + connections_.size() +
+             pending_connections_ >= min_connections_)
+          {
+            return;
+          }
+
+          pending_connections_++;
+        }
+
+        ReusableConnection_var connection;
+
+        try
+        {
+          connection = create_connection(false);
+        }
+        catch(const El::Exception& e)
+        {
+          std::ostringstream ostr;
+          ostr << "El::MySQL::ConnectionPoolFactory::warm_up: "
+            "failed to open connection. Description:\n" << e;
+          
+          Guard guard(lock_);
+
+          pending_connections_--;
+          last_error_ = ostr.str();
+
+          // Will retry after keep_alive_period
+          return;
+        }
+
+        Guard guard(lock_);
+        
+        pending_connections_--;
+        
+        connection->idle_since_ = El::Metrics::now();
+        connections_.push_back(connection);
+        
+        update_gauges();
+        connection_released_.signal();
+      }
+    }
+
+    void
+    ConnectionPoolFactory::check_idle() throw(El::Exception)
+    {
+      uint64_t period = (uint64_t)keep_alive_period_.sec() * 1000000000ULL +
+        (uint64_t)keep_alive_period_.usec() * 1000;
       
-        ReusableConnection_var c = conn;
-        connections_.push_back(c);
+      uint64_t idle_since = El::Metrics::now() - period;
+
+      ReusableConnectionArray connections;
+
+      {
+        Guard guard(lock_);
+
+        for(ReusableConnectionArray::iterator it(connections_.begin());
+            it != connections_.end(); )
+        {
+          if((*it)->idle_since_ <= idle_since)
+          {
+            connections.push_back(*it);
+            it = connections_.erase(it);
+          }
+          else
+          {
+            ++it;
+          }
+        }
+
+        pending_connections_ += connections.size();
+        update_gauges();
       }
+
+      ReusableConnectionArray alive;
+      unsigned long dead = 0;
+
+      for(ReusableConnectionArray::iterator it(connections.begin());
+          it != connections.end(); ++it)
+      {
+        pings_.increment();
+        
+        if((*it)->ping())
+        {
+          (*it)->idle_since_ = El::Metrics::now();
+          alive.push_back(*it);
+        }
+        else
+        {
+          failures_.increment();
+          dropped_.increment();
+          dead++;
+        }
+      }
+
+      {
+        Guard guard(lock_);
+
+        pending_connections_ -= connections.size();
+        
+        // Recently released connections are on top of the stack
+        connections_.insert(connections_.begin(), alive.begin(), alive.end());
+        
+        update_gauges();
+
+        for(size_t i = 0; i < alive.size(); i++)
+        {
+          connection_released_.signal();
+        }
+      }
+
+      // Closing dead connections out of the lock
+      connections.clear();
       
-      connection_released_.signal();
+      if(dead)
+      {
+        warm_up();
+      }
+    }
+
+    void
+    ConnectionPoolFactory::reclaim_parked() throw()
+    {
+      if(!thread_affinity_)
+      {
+        return;
+      }
+
+      uint64_t period = (uint64_t)keep_alive_period_.sec() * 1000000000ULL +
+        (uint64_t)keep_alive_period_.usec() * 1000;
+      
+      uint64_t idle_since = El::Metrics::now() - period;
+
+      std::vector<ReusableConnection*> reclaimed;
+
+      {
+        Guard guard(lock_);
+
+        for(ThreadSlot* slot = thread_slots_; slot; slot = slot->next)
+        {
+          ReusableConnection* connection =
+            __atomic_exchange_n(&slot->connection,
+                                (ReusableConnection*)0,
+                                __ATOMIC_ACQUIRE);
+
+          if(connection == 0)
+          {
+            continue;
+          }
+
+          ReusableConnection* empty = 0;
+          
+          if(connection->idle_since_ > idle_since &&
+             __atomic_compare_exchange_n(&slot->connection,
+                                         &empty,
+                                         connection,
+                                         false,
+                                         __ATOMIC_SEQ_CST,
+                                         __ATOMIC_RELAXED))
+          {
+            // Was parked recently, putting back
+            continue;
+          }
+
+          reclaimed.push_back(connection);
+        }
+      }
+
+      for(std::vector<ReusableConnection*>::iterator it(reclaimed.begin());
+          it != reclaimed.end(); ++it)
+      {
+        release_to_pool(*it);
+      }
     }
-    
   }
 }
@@ -15,6 +15,8 @@
 #define _ELEMENTS_EL_MYSQL_DB_HPP_
 
 #include <stdint.h>
+#include <string.h>
+#include <pthread.h>
 
 #include <string>
 #include <memory>
@@ -22,6 +24,7 @@
 #include <vector>
 #include <list>
 #include <sstream>
+#include <limits>
 
 #include <ace/OS.h>
 #include <ace/Synch.h>
@@ -32,6 +35,7 @@
 #include <El/RefCount/All.hpp>
 #include <El/SyncPolicy.hpp>
 #include <El/Moment.hpp>
+#include <El/Metrics.hpp>
 
 #include <mysql/mysql.h>
 
@@ -197,9 +201,14 @@ namespace El
       unsigned long long insert_id() throw();
 
     protected:
+      //
+      // If hold_db is false, connection doesn't keep a reference to db,
+      // so can be created while db is being destructed.
+      //
       Connection(DB* db,
                  const char* initialization = 0,
-                 const char* charset = 0)
+                 const char* charset = 0,
+                 bool hold_db = true)
         throw(Exception, El::Exception);
       
       virtual ~Connection() throw();
@@ -261,13 +270,37 @@ namespace El
 
     typedef RefCount::SmartPtr<Result> Result_var;
 
+    //
+    // Reuses connections released, keeping at least min_connections of
+    // them opened and at most max_connections in use; connect blocks when
+    // all are in use.
+    //
+    // If keep_alive_period is not zero, a maintenance thread opens
+    // min_connections in background, so db() doesn't block on it, and
+    // reopens them after failures. Connections idle for keep_alive_period
+    // are pinged to keep them alive; ones failed to respond are closed.
+    //
+    // If thread_affinity is true, a thread keeps the connection it
+    // released last and gets it back on next connect without locking the
+    // pool. Such parked connections are counted as used; they are taken
+    // away by threads waiting for a connection and by the maintenance
+    // thread when idle for keep_alive_period. Without the maintenance
+    // thread parked connections are pinged when taken and reopened if
+    // dead.
+    //
+    // Pool state is exposed as el_mysql_pool_* metrics (see El::Metrics),
+    // summed over all pools of the process.
+    //
     class ConnectionPoolFactory : public ConnectionFactory
     {
     public:
       ConnectionPoolFactory(unsigned long min_connections,
                             unsigned long max_connections,
                             const char* initialization = 0,
-                            const char* charset = 0)
+                            const char* charset = 0,
+                            const ACE_Time_Value& keep_alive_period =
+                              ACE_Time_Value::zero,
+                            bool thread_affinity = false)
         throw(InvalidArg, Exception, El::Exception);
       
       virtual ~ConnectionPoolFactory() throw();
@@ -277,6 +310,15 @@ namespace El
 
       virtual void db(DB* db) throw(Exception, El::Exception);
 
+      // Connections in use, including parked ones
+      unsigned long used_connections() const throw();
+
+      // Connections opened and waiting in the pool
+      unsigned long idle_connections() const throw();
+
+      // Description of the last maintenance thread failure
+      std::string last_error() const throw(El::Exception);
+
     private:
 
       class ReusableConnection : public virtual Connection
@@ -295,8 +337,13 @@ namespace El
         
         virtual void destroy_i() const throw();
 
+        bool ping() throw();
+
       protected:
         ConnectionPoolFactory* factory_;
+
+        // El::Metrics::now() reading when returned to the pool
+        uint64_t idle_since_;
       };
 
       friend class ReusableConnection;
@@ -304,9 +351,43 @@ namespace El
       typedef RefCount::SmartPtr<ReusableConnection> ReusableConnection_var;
       typedef std::vector<ReusableConnection_var> ReusableConnectionArray;
 
+      //
+      // Connection parked by a thread. Slots are linked into a list so
+      // other threads can take connections away. A slot outliving its
+      // factory has factory reset to 0 and is freed on thread exit.
+      //
+      struct ThreadSlot
+      {
+        ConnectionPoolFactory* factory;
+        ReusableConnection* connection;
+        ThreadSlot* prev;
+        ThreadSlot* next;
+      };
+
     private:
       void released(const ReusableConnection* connection) throw();
-      ReusableConnection* reuse_connection() throw(Exception, El::Exception);
+
+      bool park(ReusableConnection* connection) throw();
+      void release_to_pool(ReusableConnection* connection) throw();
+
+      ReusableConnection* reuse_connection() throw();
+      ReusableConnection* take_parked() throw();
+
+      ReusableConnection* create_connection(bool hold_db)
+        throw(Exception, El::Exception);
+
+      void thread_slot() throw(El::Exception);
+      static void thread_exit(void* slot) throw();
+
+      void warm_up() throw(El::Exception);
+      void check_idle() throw(El::Exception);
+      void reclaim_parked() throw();
+
+      // Publishes pool state into gauges; is called under lock
+      void update_gauges() throw();
+
+      static void* thread_func(void* arg) throw();
+      void run() throw();
       
     private:      
       
@@ -315,17 +396,50 @@ namespace El
       unsigned long max_connections_;
       std::string initialization_;
       std::string charset_;
+      ACE_Time_Value keep_alive_period_;
+      bool thread_affinity_;
       
       unsigned long used_connections_;
       ReusableConnectionArray connections_;
+
+      // Modified under lock_, read by park() without it; accessed
+      // atomically
       unsigned long waiting_connection_;
 
+      // Connections being opened or pinged by the maintenance thread
+      unsigned long pending_connections_;
+
       typedef ACE_Thread_Mutex Mutex;
       typedef ACE_Guard<Mutex> Guard;
       typedef ACE_Condition<Mutex> Condition;
 
-      Mutex lock_;
+      mutable Mutex lock_;
       Condition connection_released_;
+      Condition maintenance_;
+
+      pthread_key_t thread_key_;
+      ThreadSlot* thread_slots_;
+
+      // Guards ThreadSlot::factory of all pools, so thread_exit doesn't
+      // race with the factory destruction
+      static Mutex slots_lock_;
+
+      bool stop_;
+      bool thread_started_;
+      pthread_t thread_;
+      std::string last_error_;
+
+      El::Metrics::Histogram wait_time_;
+      El::Metrics::Counter timeouts_;
+      El::Metrics::Counter opened_;
+      El::Metrics::Counter failures_;
+      El::Metrics::Counter pings_;
+      El::Metrics::Counter dropped_;
+      El::Metrics::Counter affinity_hits_;
+      El::Metrics::Gauge used_gauge_;
+      El::Metrics::Gauge idle_gauge_;
+      long published_used_;
+      long published_idle_;
     };
 
     class Type
@@ -454,6 +568,154 @@ namespace El
       Result_var result_;
       MYSQL_ROW row_;
     };
+
+    //
+    // Text referenced rather than copied. Views of column values are
+    // valid until the next row is fetched.
+    //
+    class StringView
+    {
+    public:
+      // Null str means NULL value
+      StringView(const char* str = 0) throw();
+      StringView(const char* str, size_t length) throw();
+      StringView(const std::string& str) throw();
+
+      bool is_null() const throw();
+
+      const char* data() const throw();
+      size_t length() const throw();
+
+      std::string str() const throw(IsNull, El::Exception);
+
+    private:
+      const char* data_;
+      size_t length_;
+    };
+
+    //
+    // Base for generated zero-copy row classes. Columns are addressed by
+    // index, and values are parsed right from the MYSQL_ROW buffers with
+    // no intermediate objects.
+    //
+    class RowView
+    {
+    public:
+      EL_EXCEPTION(Exception, El::MySQL::Exception);
+      EL_EXCEPTION(InvalidArg, Exception);
+
+      RowView(Result* result) throw(InvalidArg, Exception, El::Exception);
+
+      bool fetch_row() throw(Exception, El::Exception);
+
+      void data_seek(unsigned long long offset)
+        throw(Exception, El::Exception);
+
+      Result* result() const throw();
+
+      bool is_null(size_t index) const throw(Exception);
+
+      StringView string(size_t index) const throw(Exception);
+
+    protected:
+      // Column text; throws IsNull for NULL value
+      const char* text(size_t index, const char* name, size_t& length) const
+        throw(IsNull, Exception, El::Exception);
+
+      template <class TYPE>
+      TYPE integer(size_t index, const char* name) const
+        throw(IsNull, Exception, El::Exception);
+
+      double floating(size_t index, const char* name) const
+        throw(IsNull, Exception, El::Exception);
+
+      // BIT values come as big-endian binary strings
+      uint64_t bit(size_t index, const char* name) const
+        throw(IsNull, Exception, El::Exception);
+
+      El::Moment moment(size_t index, const char* name) const
+        throw(IsNull, Exception, El::Exception);
+
+      void throw_conversion_error(size_t index, const char* name) const
+        throw(Exception, El::Exception);
+
+    protected:
+      Result_var result_;
+      MYSQL_RES* res_;
+      MYSQL_ROW row_;
+      unsigned long* lengths_;
+    };
+
+    //
+    // Builds a multi-row INSERT query in a single buffer, escaping values
+    // right into it. Base for generated insert builders. The buffer grows
+    // if the capacity is exceeded, so rows should be executed by the
+    // caller before the query size reaches max_allowed_packet.
+    //
+    class InsertBuilder
+    {
+    public:
+      EL_EXCEPTION(Exception, El::MySQL::Exception);
+
+      // prefix is like "INSERT INTO table (col1,col2) VALUES "
+      InsertBuilder(Connection* connection,
+                    const char* prefix,
+                    size_t capacity = 1024 * 1024)
+        throw(Exception, El::Exception);
+
+      virtual ~InsertBuilder() throw();
+
+      unsigned long rows() const throw();
+
+      // Query text, zero-terminated
+      const char* query() const throw();
+      size_t size() const throw();
+
+      // Executes the query if any rows added, returning number of
+      // affected rows, and removes the rows
+      unsigned long execute() throw(Exception, El::Exception);
+
+      void reset() throw();
+
+    protected:
+      void begin_row() throw(Exception, El::Exception);
+      void end_row() throw(Exception, El::Exception);
+
+      // Removes values of the row begun
+      void cancel_row() throw();
+
+      void add_null() throw(Exception, El::Exception);
+      void add_string(const StringView& value)
+        throw(Exception, El::Exception);
+      void add_integer(int64_t value) throw(Exception, El::Exception);
+      void add_unsigned(uint64_t value) throw(Exception, El::Exception);
+      void add_double(double value) throw(Exception, El::Exception);
+      void add_moment(const El::Moment& value)
+        throw(Exception, El::Exception);
+
+    private:
+      // Makes room for size more characters
+      char* reserve(size_t size) throw(Exception, El::Exception);
+
+      // Makes room for the value of size characters and writes the
+      // separator if required
+      char* begin_value(size_t size) throw(Exception, El::Exception);
+
+    private:
+      InsertBuilder(const InsertBuilder&);
+      void operator=(const InsertBuilder&);
+
+    private:
+      Connection_var connection_;
+      char* buffer_;
+      size_t capacity_;
+      size_t size_;
+      size_t prefix_size_;
+      unsigned long rows_;
+      size_t row_start_;
+      bool row_started_;
+      bool first_value_;
+    };
   }
 }
 
@@ -623,27 +885,42 @@ namespace El
     //
     // ConnectionPoolFactory class
     //
+    inline
+    unsigned long
+    ConnectionPoolFactory::used_connections() const throw()
+    {
+      Guard guard(lock_);
+      return used_connections_;
+    }
+    
+    inline
+    unsigned long
+    ConnectionPoolFactory::idle_connections() const throw()
+    {
+      Guard guard(lock_);
+      return connections_.size();
+    }
+
+    inline
+    std::string
+    ConnectionPoolFactory::last_error() const throw(El::Exception)
+    {
+      Guard guard(lock_);
+      return last_error_;
+    }
+    
     inline
     void
-    ConnectionPoolFactory::db(DB* db) throw(Exception, El::Exception)
-    {      
-      DB::init_thread();
+    ConnectionPoolFactory::update_gauges() throw()
+    {
+      long used = used_connections_;
+      long idle = connections_.size();
 
-      db_ = db;
+      used_gauge_.add(used - published_used_);
+      idle_gauge_.add(idle - published_idle_);
 
-      connections_.resize(min_connections_);
-      
-      for(size_t i = 0; i < min_connections_; i++)
-      {
-        ReusableConnection_var connection =
-          new ReusableConnection(db,
-                                 0,
-                                 initialization_.c_str(),
-                                 charset_.c_str());
-        
-        connection->db_ = 0;
-        connections_[i] = connection;
-      }      
+      published_used_ = used;
+      published_idle_ = idle;
     }
     
     //
@@ -656,8 +933,9 @@ namespace El
       const char* initialization,
       const char* charset)
       throw(Exception, El::Exception)
-        : Connection(db, initialization, charset),
-          factory_(factory)
+        : Connection(db, initialization, charset, factory != 0),
+          factory_(factory),
+          idle_since_(0)
     {
     }
     
@@ -681,6 +959,14 @@ namespace El
         delete this;
       }
     }
+
+    inline
+    bool
+    ConnectionPoolFactory::ReusableConnection::ping() throw()
+    {
+      DB::init_thread();
+      return mysql_ping(mysql_) == 0;
+    }
     
     //
     // DB::MySQLLibInit class
@@ -1139,6 +1425,234 @@ namespace El
 
       return &value_;
     }
+
+    //
+    // StringView class
+    //
+    inline
+    StringView::StringView(const char* str) throw()
+        : data_(str),
+          length_(str ? strlen(str) : 0)
+    {
+    }
+
+    inline
+    StringView::StringView(const char* str, size_t length) throw()
+        : data_(str),
+          length_(length)
+    {
+    }
+
+    inline
+    StringView::StringView(const std::string& str) throw()
+        : data_(str.c_str()),
+          length_(str.length())
+    {
+    }
+
+    inline
+    bool
+    StringView::is_null() const throw()
+    {
+      return data_ == 0;
+    }
+
+    inline
+    const char*
+    StringView::data() const throw()
+    {
+      return data_;
+    }
+
+    inline
+    size_t
+    StringView::length() const throw()
+    {
+      return length_;
+    }
+
+    inline
+    std::string
+    StringView::str() const throw(IsNull, El::Exception)
+    {
+      if(data_ == 0)
+      {
+        throw IsNull("El::MySQL::StringView::str: value is null");
+      }
+
+      return std::string(data_, length_);
+    }
+
+    //
+    // RowView class
+    //
+    inline
+    RowView::RowView(Result* result)
+      throw(InvalidArg, Exception, El::Exception)
+        : result_(RefCount::add_ref(result)),
+          res_(0),
+          row_(0),
+          lengths_(0)
+    {
+      if(result == 0)
+      {
+        throw InvalidArg("El::MySQL::RowView::RowView: result is 0");
+      }
+
+      res_ = result->mysql_res();
+    }
+
+    inline
+    Result*
+    RowView::result() const throw()
+    {
+      return result_.in();
+    }
+
+    inline
+    bool
+    RowView::is_null(size_t index) const throw(Exception)
+    {
+      if(row_ == 0)
+      {
+        throw Exception("El::MySQL::RowView::is_null: no row fetched");
+      }
+
+      return row_[index] == 0;
+    }
+
+    inline
+    StringView
+    RowView::string(size_t index) const throw(Exception)
+    {
+      if(row_ == 0)
+      {
+        throw Exception("El::MySQL::RowView::string: no row fetched");
+      }
+
+      return row_[index] ?
+        StringView(row_[index], lengths_[index]) : StringView();
+    }
+
+    inline
+    const char*
+    RowView::text(size_t index, const char* name, size_t& length) const
+      throw(IsNull, Exception, El::Exception)
+    {
+      if(row_ == 0)
+      {
+        std::ostringstream ostr;
+        ostr << "El::MySQL::RowView::text: no row fetched for " << name;
+        throw Exception(ostr.str());
+      }
+
+      const char* value = row_[index];
+
+      if(value == 0)
+      {
+        std::ostringstream ostr;
+        ostr << "El::MySQL::RowView::text: " << name << " is null";
+        throw IsNull(ostr.str());
+      }
+
+      length = lengths_[index];
+      return value;
+    }
+
+    template <class TYPE>
+    TYPE
+    RowView::integer(size_t index, const char* name) const
+      throw(IsNull, Exception, El::Exception)
+    {
+      size_t length = 0;
+      const char* ptr = text(index, name, length);
+      const char* end = ptr + length;
+
+      bool negative = ptr != end && *ptr == '-';
+
+      if(negative)
+      {
+        if(TYPE(-1) > 0)
+        {
+          throw_conversion_error(index, name);
+        }
+
+        ++ptr;
+      }
+
+      if(ptr == end)
+      {
+        throw_conversion_error(index, name);
+      }
+
+      // Accumulating with the sign of the result so the least value of
+      // signed type doesn't overflow
+      TYPE value = 0;
+      TYPE limit = negative ? std::numeric_limits<TYPE>::min() :
+        std::numeric_limits<TYPE>::max();
+
+      for(; ptr != end; ++ptr)
+      {
+        unsigned char digit = *ptr - '0';
+
+        if(digit > 9 ||
+           (negative ? value < (limit + digit) / 10 :
+            value > (limit - digit) / 10))
+        {
+          throw_conversion_error(index, name);
+        }
+
+        value = negative ? value * 10 - digit : value * 10 + digit;
+      }
+
+      return value;
+    }
+
+    //
+    // InsertBuilder class
+    //
+    inline
+    unsigned long
+    InsertBuilder::rows() const throw()
+    {
+      return rows_;
+    }
+
+    inline
+    const char*
+    InsertBuilder::query() const throw()
+    {
+      return buffer_;
+    }
+
+    inline
+    size_t
+    InsertBuilder::size() const throw()
+    {
+      return size_;
+    }
+
+    inline
+    void
+    InsertBuilder::reset() throw()
+    {
+      size_ = prefix_size_;
+      buffer_[size_] = '\0';
+      rows_ = 0;
+      row_started_ = false;
+    }
+
+    inline
+    void
+    InsertBuilder::cancel_row() throw()
+    {
+      if(row_started_)
+      {
+        size_ = row_start_;
+        buffer_[size_] = '\0';
+        row_started_ = false;
+      }
+    }
   }
 }
 
@@ -1163,6 +1677,23 @@ operator<<(std::ostream& ostr, const El::MySQL::String& str)
   return ostr;
 }
 
+inline
+std::ostream&
+operator<<(std::ostream& ostr, const El::MySQL::StringView& str)
+  throw(El::Exception)
+{
+  if(str.is_null())
+  {
+    ostr << "(null)";
+  }
+  else
+  {
+    ostr.write(str.data(), str.length());
+  }
+
+  return ostr;
+}
+
 template <class TYPE>
 std::ostream&
 operator<<(std::ostream& ostr, const El::MySQL::Numeric<TYPE>& val)
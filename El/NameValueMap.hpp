@@ -26,9 +26,13 @@
 
 namespace El
 {
+  //
+  // Usually filled from request data (cookies, parameters), so hashed with
+  // per process seed
+  //
   class NameValueMap : public __gnu_cxx::hash_map<std::string,
                                                   std::string,
-                                                  El::Hash::String>
+                                                  El::Hash::SeededString>
   {
   public:
     NameValueMap(const char* text = 0,
@@ -19,6 +19,7 @@
 #include <iostream>
 
 #include <El/Exception.hpp>
+#include <El/Arena.hpp>
 #include <El/Moment.hpp>
 #include <El/String/Manip.hpp>
 #include <El/String/ListParser.hpp>
@@ -45,9 +46,20 @@ namespace El
         void read(El::BinaryInStream& bstr) throw(El::Exception);
       };
 
-      class CookieList : public std::list<Cookie>
+      //
+      // Can allocate its nodes in arena; copies always allocate on heap
+      // as can outlive source list arena
+      //
+      class CookieList : public std::list<Cookie, El::ArenaAllocator<Cookie> >
       {
       public:
+        typedef std::list<Cookie, El::ArenaAllocator<Cookie> > Base;
+
+      public:
+        CookieList() throw(El::Exception) {}
+        explicit CookieList(El::Arena* arena) throw(El::Exception);
+        CookieList(const CookieList& src) throw(El::Exception);
+
         // In cookies is in "name=value;name=value;..." form
         void add(const char* cookies) throw(InvalidArg, El::Exception);
 
@@ -131,6 +143,21 @@ namespace El
         bstr >> name >> value;
       }
 
+      //
+      // CookieList class
+      //
+      inline
+      CookieList::CookieList(El::Arena* arena) throw(El::Exception)
+          : Base(allocator_type(arena))
+      {
+      }
+
+      inline
+      CookieList::CookieList(const CookieList& src) throw(El::Exception)
+          : Base(src.begin(), src.end())
+      {
+      }
+
       //
       // CookieSetter struct
       //
@@ -197,7 +224,10 @@ namespace El
 
         if(!session)
         {
-          ostr << "; expires=" << expiration.http_cookie_expiration();
+          char buff[El::Moment::FORMAT_BUFF_SIZE];
+          expiration.format_http_cookie_expiration(buff);
+
+          ostr << "; expires=" << buff;
         }
 
         if(!domain.empty())
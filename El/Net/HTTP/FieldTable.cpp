@@ -0,0 +1,514 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Net/HTTP/FieldTable.cpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+#include <string>
+#include <sstream>
+#include <algorithm>
+
+#include <El/Exception.hpp>
+#include <El/String/Manip.hpp>
+#include <El/Hash/Hash64.hpp>
+
+#include "FieldTable.hpp"
+
+namespace
+{
+  const size_t NO_ENTRY = (size_t)-1;
+
+  inline
+  bool
+  whitespace(char chr) throw()
+  {
+    return chr == ' ' || chr == '\t';
+  }
+
+  inline
+  char
+  lower(char chr) throw()
+  {
+    return chr >= 'A' && chr <= 'Z' ? chr + ('a' - 'A') : chr;
+  }
+}
+
+namespace El
+{
+  namespace Net
+  {
+    namespace HTTP
+    {
+      //
+      // FieldTable class
+      //
+      uint32_t
+      FieldTable::hash(const char* name, size_t len) throw()
+      {
+        // Names come from requests, so seeded hash is used
+        uint64_t res = El::Hash::seed();
+        char buff[64];
+
+        do
+        {
+          size_t count = std::min(len, sizeof(buff));
+
+          for(size_t i = 0; i < count; ++i)
+          {
+            buff[i] = lower(name[i]);
+          }
+
+          res = El::Hash::hash64(buff, count, res);
+
+          name += count;
+          len -= count;
+        }
+        while(len);
+
+        return (uint32_t)res;
+      }
+
+      const char*
+      FieldTable::find(const char* name, size_t len) const throw()
+      {
+        if(entries_.empty())
+        {
+          return 0;
+        }
+
+        uint32_t hs = hash(name, len);
+        size_t mask = index_.size() - 1;
+        const char* data = &buffer_[0];
+
+        for(size_t slot = hs & mask; index_[slot]; slot = (slot + 1) & mask)
+        {
+          const Entry& entry = entries_[index_[slot] - 1];
+
+          if(entry.hash == hs && entry.name_length == len &&
+             strncasecmp(data + entry.name, name, len) == 0)
+          {
+            return data + entry.value;
+          }
+        }
+
+        return 0;
+      }
+
+      void
+      FieldTable::add(const char* name,
+                      size_t name_len,
+                      const char* value,
+                      size_t value_len)
+        throw(InvalidArg, El::Exception)
+      {
+        if(name == 0 || name_len == 0)
+        {
+          throw InvalidArg("El::Net::HTTP::FieldTable::add: empty name");
+        }
+
+        store(name, name_len, value, value_len);
+      }
+
+      void
+      FieldTable::store(const char* name,
+                        size_t name_len,
+                        const char* value,
+                        size_t value_len)
+        throw(InvalidArg, El::Exception)
+      {
+        size_t offset = append(name_len + value_len + 2);
+        char* data = &buffer_[offset];
+
+        memcpy(data, name, name_len);
+        data[name_len] = '\0';
+
+        if(value_len)
+        {
+          memcpy(data + name_len + 1, value, value_len);
+        }
+
+        data[name_len + value_len + 1] = '\0';
+
+        Entry entry;
+        entry.name = offset;
+        entry.name_length = name_len;
+        entry.value = offset + name_len + 1;
+        entry.value_length = value_len;
+        entry.hash = hash(name, name_len);
+
+        push(entry);
+      }
+
+      size_t
+      FieldTable::parse_headers(const char* block, size_t len)
+        throw(InvalidArg, El::Exception)
+      {
+        size_t entries = entries_.size();
+        size_t begin = append(len + 1);
+        size_t consumed = len;
+
+        memcpy(&buffer_[begin], block, len);
+        buffer_[begin + len] = '\0';
+
+        try
+        {
+          parse_headers(begin, begin + len, consumed);
+        }
+        catch(...)
+        {
+          truncate(entries, begin);
+          throw;
+        }
+
+        return consumed;
+      }
+
+      void
+      FieldTable::parse_headers(size_t begin, size_t end, size_t& consumed)
+        throw(InvalidArg, El::Exception)
+      {
+        // Buffer is not reallocated during parsing; it is only shrinked
+        // in place as lines continued are joined
+        char* data = &buffer_[0];
+        size_t last = NO_ENTRY;
+
+        for(size_t pos = begin; pos < end; )
+        {
+          char* line = data + pos;
+          char* eol = (char*)memchr(line, '\n', end - pos);
+          char* line_end = eol ? eol : data + end;
+
+          pos = eol ? eol - data + 1 : end;
+
+          if(line_end > line && line_end[-1] == '\r')
+          {
+            --line_end;
+          }
+
+          if(line_end == line)
+          {
+            consumed = pos - begin;
+            break;
+          }
+
+          if(whitespace(*line))
+          {
+            if(last == NO_ENTRY)
+            {
+              std::ostringstream ostr;
+              ostr << "El::Net::HTTP::FieldTable::parse_headers: "
+                "continuation line without header:\n"
+                   << std::string(line, line_end);
+
+              throw InvalidArg(ostr.str());
+            }
+
+            for(; whitespace(*line); ++line);
+            for(; line_end > line && whitespace(line_end[-1]); --line_end);
+
+            if(line == line_end)
+            {
+              continue;
+            }
+
+            Entry& entry = entries_[last];
+            char* value_end = data + entry.value + entry.value_length;
+
+            if(entry.value_length)
+            {
+              *value_end++ = ' ';
+            }
+
+            size_t len = line_end - line;
+            memmove(value_end, line, len);
+            value_end[len] = '\0';
+
+            entry.value_length = value_end + len - (data + entry.value);
+            continue;
+          }
+
+          char* colon = (char*)memchr(line, ':', line_end - line);
+
+          if(colon == 0)
+          {
+            std::ostringstream ostr;
+            ostr << "El::Net::HTTP::FieldTable::parse_headers: "
+              "character ':' not found while parsing HTTP header. Line:\n"
+                 << std::string(line, line_end);
+
+            throw InvalidArg(ostr.str());
+          }
+
+          char* name_end = colon;
+          for(; name_end > line && whitespace(name_end[-1]); --name_end);
+
+          if(name_end == line)
+          {
+            std::ostringstream ostr;
+            ostr << "El::Net::HTTP::FieldTable::parse_headers: "
+              "empty header name. Line:\n" << std::string(line, line_end);
+
+            throw InvalidArg(ostr.str());
+          }
+
+          char* value = colon + 1;
+
+          for(; value < line_end && whitespace(*value); ++value);
+          for(; line_end > value && whitespace(line_end[-1]); --line_end);
+
+          *name_end = '\0';
+          *line_end = '\0';
+
+          Entry entry;
+          entry.name = line - data;
+          entry.name_length = name_end - line;
+          entry.value = value - data;
+          entry.value_length = line_end - value;
+          entry.hash = hash(line, entry.name_length);
+
+          push(entry);
+          last = entries_.size() - 1;
+        }
+      }
+
+      void
+      FieldTable::parse_params(const char* params, size_t len, bool lax)
+        throw(InvalidArg, El::Exception)
+      {
+        size_t entries = entries_.size();
+        size_t begin = append(len + 1);
+
+        memcpy(&buffer_[begin], params, len);
+        buffer_[begin + len] = '\0';
+
+        try
+        {
+          parse_params(begin, begin + len, lax);
+        }
+        catch(...)
+        {
+          truncate(entries, begin);
+          throw;
+        }
+      }
+
+      void
+      FieldTable::parse_params(size_t begin, size_t end, bool lax)
+        throw(InvalidArg, El::Exception)
+      {
+        char* data = &buffer_[0];
+
+        for(size_t pos = begin; pos < end; )
+        {
+          char* item = data + pos;
+          char* amp = (char*)memchr(item, '&', end - pos);
+          char* item_end = amp ? amp : data + end;
+
+          pos = amp ? amp - data + 1 : end;
+
+          if(item == item_end)
+          {
+            continue;
+          }
+
+          char* eq = (char*)memchr(item, '=', item_end - item);
+
+          Entry entry;
+          entry.name = item - data;
+
+          try
+          {
+            // Decoding never makes string longer, so is done in place
+            entry.name_length =
+              El::String::Manip::mime_url_decode(
+                item, (eq ? eq : item_end) - item, item);
+
+            if(eq)
+            {
+              entry.value = eq + 1 - data;
+
+              entry.value_length =
+                El::String::Manip::mime_url_decode(
+                  eq + 1, item_end - eq - 1, eq + 1);
+            }
+            else
+            {
+              // Points to terminating zero of the name
+              entry.value = entry.name + entry.name_length;
+              entry.value_length = 0;
+            }
+          }
+          catch(const El::String::Manip::InvalidArg& e)
+          {
+            if(lax)
+            {
+              continue;
+            }
+
+            std::ostringstream ostr;
+            ostr << "El::Net::HTTP::FieldTable::parse_params: "
+              "El::String::Manip::InvalidArg caught. Description:\n" << e;
+
+            throw InvalidArg(ostr.str());
+          }
+
+          data[entry.name + entry.name_length] = '\0';
+          data[entry.value + entry.value_length] = '\0';
+
+          entry.hash = hash(data + entry.name, entry.name_length);
+          push(entry);
+        }
+      }
+
+      size_t
+      FieldTable::append(size_t len) throw(InvalidArg, El::Exception)
+      {
+        size_t offset = buffer_.size();
+
+        if(len > UINT32_MAX - offset)
+        {
+          std::ostringstream ostr;
+          ostr << "El::Net::HTTP::FieldTable::append: can't add " << len
+               << " bytes to " << offset << " bytes of table";
+
+          throw InvalidArg(ostr.str());
+        }
+
+        buffer_.resize(offset + len);
+        return offset;
+      }
+
+      void
+      FieldTable::push(const Entry& entry) throw(El::Exception)
+      {
+        if(entries_.empty())
+        {
+          // Typical request fits, so no regrowing happens
+          entries_.reserve(MIN_INDEX_SIZE / 2);
+        }
+
+        entries_.push_back(entry);
+
+        // Load factor is kept under 1/2 for probe sequences to be short
+        if(entries_.size() * 2 > index_.size())
+        {
+          rehash(index_.empty() ? MIN_INDEX_SIZE : index_.size() * 2);
+        }
+        else
+        {
+          insert(entries_.size() - 1);
+        }
+      }
+
+      void
+      FieldTable::insert(uint32_t entry) throw()
+      {
+        size_t mask = index_.size() - 1;
+        size_t slot = entries_[entry].hash & mask;
+
+        for(; index_[slot]; slot = (slot + 1) & mask);
+        index_[slot] = entry + 1;
+      }
+
+      void
+      FieldTable::rehash(size_t index_size) throw(El::Exception)
+      {
+        index_.assign(index_size, 0);
+
+        // Entries inserted in order, so first of same named fields is
+        // met first when probing
+        for(size_t i = 0; i < entries_.size(); ++i)
+        {
+          insert(i);
+        }
+      }
+
+      void
+      FieldTable::truncate(size_t entries, size_t buffer_size) throw()
+      {
+        entries_.resize(entries);
+        buffer_.resize(buffer_size);
+
+        if(index_.empty())
+        {
+          return;
+        }
+
+        // Index never shrinks, so no allocation happens
+        memset(&index_[0], 0, index_.size() * sizeof(index_[0]));
+
+        for(size_t i = 0; i < entries_.size(); ++i)
+        {
+          insert(i);
+        }
+      }
+
+      void
+      FieldTable::assign(const HeaderList& headers) throw(El::Exception)
+      {
+        clear();
+
+        for(HeaderList::const_iterator i(headers.begin()), e(headers.end());
+            i != e; ++i)
+        {
+          store(i->name.c_str(), i->name.length(),
+                i->value.c_str(), i->value.length());
+        }
+      }
+
+      void
+      FieldTable::assign(const ParamList& params) throw(El::Exception)
+      {
+        clear();
+
+        for(ParamList::const_iterator i(params.begin()), e(params.end());
+            i != e; ++i)
+        {
+          store(i->name.c_str(), i->name.length(),
+                i->value.c_str(), i->value.length());
+        }
+      }
+
+      void
+      FieldTable::copy(HeaderList& headers) const throw(El::Exception)
+      {
+        for(size_t i = 0; i < entries_.size(); ++i)
+        {
+          Field field = (*this)[i];
+
+          headers.push_back(Header());
+
+          Header& header = headers.back();
+          header.name.assign(field.name, field.name_length);
+          header.value.assign(field.value, field.value_length);
+        }
+      }
+
+      void
+      FieldTable::copy(ParamList& params) const throw(El::Exception)
+      {
+        for(size_t i = 0; i < entries_.size(); ++i)
+        {
+          Field field = (*this)[i];
+
+          params.push_back(Param());
+
+          Param& param = params.back();
+          param.name.assign(field.name, field.name_length);
+          param.value.assign(field.value, field.value_length);
+        }
+      }
+    }
+  }
+}
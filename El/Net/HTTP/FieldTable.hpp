@@ -0,0 +1,251 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Net/HTTP/FieldTable.hpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#ifndef _ELEMENTS_EL_NET_HTTP_FIELDTABLE_HPP_
+#define _ELEMENTS_EL_NET_HTTP_FIELDTABLE_HPP_
+
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#include <El/Exception.hpp>
+#include <El/Net/HTTP/Exception.hpp>
+#include <El/Net/HTTP/Params.hpp>
+
+namespace El
+{
+  namespace Net
+  {
+    namespace HTTP
+    {
+      //
+      // Flat alternative to HeaderList and ParamList. Names and values are
+      // zero-terminated strings placed one after another in a single
+      // buffer, lookups by name are case-insensitive and go through
+      // a small open addressing index. Cleared table keeps its memory, so
+      // a table reused for parsing request after request stops allocating
+      // once grown to the size of the biggest one.
+      //
+      // Pointers returned are valid till the next table modification.
+      //
+      class FieldTable
+      {
+      public:
+        struct Field
+        {
+          const char* name;
+          const char* value;
+          size_t name_length;
+          size_t value_length;
+        };
+
+      public:
+        FieldTable() throw(El::Exception);
+
+        //
+        // Appends fields of "Name: value" lines of HTTP header block,
+        // CRLF or LF terminated. Parsing stops after empty line which
+        // is not required to be present. Lines starting with whitespace
+        // continue previous field value. Returns number of bytes
+        // consumed. If throws, table is left as before the call.
+        //
+        size_t parse_headers(const char* block, size_t len)
+          throw(InvalidArg, El::Exception);
+
+        //
+        // Appends url-decoded fields of "name=value&name2" string. In lax
+        // mode improperly encoded items are skipped.
+        //
+        void parse_params(const char* params, size_t len, bool lax = false)
+          throw(InvalidArg, El::Exception);
+
+        void add(const char* name, const char* value)
+          throw(InvalidArg, El::Exception);
+
+        void add(const char* name,
+                 size_t name_len,
+                 const char* value,
+                 size_t value_len)
+          throw(InvalidArg, El::Exception);
+
+        // Value of first field with the name specified, or 0 if not found
+        const char* find(const char* name) const throw();
+        const char* find(const char* name, size_t len) const throw();
+
+        size_t size() const throw();
+        bool empty() const throw();
+
+        Field operator[](size_t index) const throw();
+
+        void clear() throw();
+        void swap(FieldTable& table) throw();
+
+        size_t memory_size() const throw();
+
+        void assign(const HeaderList& headers) throw(El::Exception);
+        void assign(const ParamList& params) throw(El::Exception);
+
+        void copy(HeaderList& headers) const throw(El::Exception);
+        void copy(ParamList& params) const throw(El::Exception);
+
+      private:
+        struct Entry
+        {
+          uint32_t name;
+          uint32_t name_length;
+          uint32_t value;
+          uint32_t value_length;
+          uint32_t hash;
+        };
+
+        typedef std::vector<Entry> EntryArray;
+
+        // Holds entry index + 1; 0 for free slot
+        typedef std::vector<uint32_t> Index;
+
+        enum { MIN_INDEX_SIZE = 64 };
+
+        static uint32_t hash(const char* name, size_t len) throw();
+
+        size_t append(size_t len) throw(InvalidArg, El::Exception);
+
+        // Adds field not checking name to be non-empty as list types
+        // converted from may have such
+        void store(const char* name,
+                   size_t name_len,
+                   const char* value,
+                   size_t value_len)
+          throw(InvalidArg, El::Exception);
+
+        void push(const Entry& entry) throw(El::Exception);
+        void insert(uint32_t entry) throw();
+        void rehash(size_t index_size) throw(El::Exception);
+        void truncate(size_t entries, size_t buffer_size) throw();
+
+        void parse_headers(size_t begin, size_t end, size_t& consumed)
+          throw(InvalidArg, El::Exception);
+
+        void parse_params(size_t begin, size_t end, bool lax)
+          throw(InvalidArg, El::Exception);
+
+      private:
+        std::vector<char> buffer_;
+        EntryArray entries_;
+        Index index_;
+      };
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Inlines
+///////////////////////////////////////////////////////////////////////////////
+
+namespace El
+{
+  namespace Net
+  {
+    namespace HTTP
+    {
+      //
+      // FieldTable class
+      //
+      inline
+      FieldTable::FieldTable() throw(El::Exception)
+      {
+      }
+
+      inline
+      void
+      FieldTable::add(const char* name, const char* value)
+        throw(InvalidArg, El::Exception)
+      {
+        add(name,
+            name ? strlen(name) : 0,
+            value,
+            value ? strlen(value) : 0);
+      }
+
+      inline
+      const char*
+      FieldTable::find(const char* name) const throw()
+      {
+        return name ? find(name, strlen(name)) : 0;
+      }
+
+      inline
+      size_t
+      FieldTable::size() const throw()
+      {
+        return entries_.size();
+      }
+
+      inline
+      bool
+      FieldTable::empty() const throw()
+      {
+        return entries_.empty();
+      }
+
+      inline
+      FieldTable::Field
+      FieldTable::operator[](size_t index) const throw()
+      {
+        const Entry& entry = entries_[index];
+        const char* data = &buffer_[0];
+
+        Field field;
+        field.name = data + entry.name;
+        field.value = data + entry.value;
+        field.name_length = entry.name_length;
+        field.value_length = entry.value_length;
+
+        return field;
+      }
+
+      inline
+      void
+      FieldTable::clear() throw()
+      {
+        buffer_.clear();
+        entries_.clear();
+
+        if(!index_.empty())
+        {
+          memset(&index_[0], 0, index_.size() * sizeof(index_[0]));
+        }
+      }
+
+      inline
+      void
+      FieldTable::swap(FieldTable& table) throw()
+      {
+        buffer_.swap(table.buffer_);
+        entries_.swap(table.entries_);
+        index_.swap(table.index_);
+      }
+
+      inline
+      size_t
+      FieldTable::memory_size() const throw()
+      {
+        return sizeof(*this) + buffer_.capacity() +
+          entries_.capacity() * sizeof(Entry) +
+          index_.capacity() * sizeof(Index::value_type);
+      }
+    }
+  }
+}
+
+#endif // _ELEMENTS_EL_NET_HTTP_FIELDTABLE_HPP_
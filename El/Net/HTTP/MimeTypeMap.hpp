@@ -16,11 +16,10 @@
 
 #include <string>
 
-#include <ext/hash_map>
-
 #include <El/Exception.hpp>
 #include <El/Net/HTTP/Exception.hpp>
 #include <El/Hash/Hash.hpp>
+#include <El/Hash/FlatMap.hpp>
 
 namespace El
 {
@@ -29,7 +28,7 @@ namespace El
     namespace HTTP
     {
       class MimeTypeMap :
-        public __gnu_cxx::hash_map<std::string, std::string, El::Hash::String>
+        public El::Hash::FlatMap<std::string, std::string, El::Hash::String>
       {
       public:
         
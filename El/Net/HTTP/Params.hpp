@@ -19,6 +19,7 @@
 #include <iostream>
 
 #include <El/Exception.hpp>
+#include <El/Arena.hpp>
 #include <El/String/Manip.hpp>
 #include <El/String/ListParser.hpp>
 #include <El/Net/HTTP/Exception.hpp>
@@ -45,12 +46,20 @@ namespace El
         void read(El::BinaryInStream& bstr) throw(El::Exception);
       };
 
-      class ParamList : public std::list<Param>
+      //
+      // Lists below can allocate their nodes in arena; copies always
+      // allocate on heap as can outlive source list arena
+      //
+      class ParamList : public std::list<Param, El::ArenaAllocator<Param> >
       {
       public:
+        typedef std::list<Param, El::ArenaAllocator<Param> > Base;
 
+      public:
         ParamList() throw(El::Exception) {}
+        explicit ParamList(El::Arena* arena) throw(El::Exception);
         ParamList(const char* params, bool lax = false) throw(El::Exception);
+        ParamList(const ParamList& src) throw(El::Exception);
         
         void add(const char* name, const char* value)
           throw(InvalidArg, El::Exception);
@@ -75,9 +84,15 @@ namespace El
         void read(El::BinaryInStream& bstr) throw(El::Exception);
       };
 
-      class HeaderList : public std::list<Header>
+      class HeaderList : public std::list<Header, El::ArenaAllocator<Header> >
       {
       public:
+        typedef std::list<Header, El::ArenaAllocator<Header> > Base;
+
+      public:
+        HeaderList() throw(El::Exception) {}
+        explicit HeaderList(El::Arena* arena) throw(El::Exception);
+        HeaderList(const HeaderList& src) throw(El::Exception);
 
         void add(const char* name, const char* value)
           throw(InvalidArg, El::Exception);
@@ -167,6 +182,18 @@ namespace El
       // ParamList class
       //
 
+      inline
+      ParamList::ParamList(El::Arena* arena) throw(El::Exception)
+          : Base(allocator_type(arena))
+      {
+      }
+
+      inline
+      ParamList::ParamList(const ParamList& src) throw(El::Exception)
+          : Base(src.begin(), src.end())
+      {
+      }
+
       inline
       ParamList::ParamList(const char* params, bool lax) throw(El::Exception)
       {
@@ -309,6 +336,18 @@ namespace El
       //
       // HeaderList class
       //
+      inline
+      HeaderList::HeaderList(El::Arena* arena) throw(El::Exception)
+          : Base(allocator_type(arena))
+      {
+      }
+
+      inline
+      HeaderList::HeaderList(const HeaderList& src) throw(El::Exception)
+          : Base(src.begin(), src.end())
+      {
+      }
+
       inline
       void
       HeaderList::add(const char* nm, const char* vl)
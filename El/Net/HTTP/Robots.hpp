@@ -18,14 +18,13 @@
 #include <sstream>
 #include <iostream>
 
-#include <ext/hash_map>
-
 #include <ace/OS.h>
 #include <ace/Synch.h>
 #include <ace/Guard_T.h>
 
 #include <El/Exception.hpp>
 #include <El/Hash/Hash.hpp>
+#include <El/Hash/FlatMap.hpp>
 #include <El/Net/Exception.hpp>
 #include <El/Net/HTTP/URL.hpp>
 
@@ -88,7 +87,7 @@ namespace El
           bool allowed(const char* path, const char* user_agent) const throw();
         };
 
-        typedef __gnu_cxx::hash_map<std::string, SiteInfo, El::Hash::String>
+        typedef El::Hash::FlatMap<std::string, SiteInfo, El::Hash::String>
         SiteInfoMap;
         
       private:
@@ -24,6 +24,7 @@
 #include <ace/INET_Addr.h>
 
 #include <El/CRC.hpp>
+#include <El/Metrics.hpp>
 
 #include "Session.hpp"
 #include "StatusCodes.hpp"
@@ -32,6 +33,113 @@
 namespace
 {
   const char WHITESPACES[] = " \t";
+
+  El::Metrics::Histogram connect_time(
+    "el_http_session_connect_seconds",
+    "Time HTTP sessions establish connections");
+
+  El::Metrics::Histogram send_time(
+    "el_http_session_send_request_seconds",
+    "Time HTTP sessions send requests");
+
+  El::Metrics::Histogram status_wait_time(
+    "el_http_session_response_status_seconds",
+    "Time from HTTP request sent till response status line received");
+
+  El::Metrics::Histogram headers_time(
+    "el_http_session_response_headers_seconds",
+    "Time from HTTP response status line till headers received");
+
+  //
+  // Reads line terminated with CR directly from the stream buffer.
+  // Returns character following CR (which should be LF) or -1 if
+  // stream ended before.
+  //
+  int
+  read_line(El::Net::Socket::StreamBuf& streambuf, std::string& line)
+    throw(El::Exception)
+  {
+    line.clear();
+
+    while(true)
+    {
+      if(streambuf.gptr() == streambuf.egptr() &&
+         streambuf.underflow() == std::char_traits<char>::eof())
+      {
+        return -1;
+      }
+
+      char* begin = streambuf.gptr();
+      char* end = streambuf.egptr();
+      char* cr = (char*)memchr(begin, '\r', end - begin);
+
+      if(cr == 0)
+      {
+        line.append(begin, end - begin);
+        streambuf.setg(streambuf.eback(), end, end);
+        continue;
+      }
+
+      line.append(begin, cr - begin);
+      streambuf.setg(streambuf.eback(), cr + 1, end);
+
+      if(streambuf.gptr() == streambuf.egptr() &&
+         streambuf.underflow() == std::char_traits<char>::eof())
+      {
+        return -1;
+      }
+
+      unsigned char ch = *streambuf.gptr();
+
+      streambuf.setg(streambuf.eback(),
+                     streambuf.gptr() + 1,
+                     streambuf.egptr());
+
+      return ch;
+    }
+  }
+
+  //
+  // Parses trailer line appending header to the list; returns false if
+  // line is malformed
+  //
+  bool
+  parse_trailer(const std::string& line, El::Net::HTTP::HeaderList& trailer)
+    throw(El::Exception)
+  {
+    std::string::size_type len = line.find(':');
+
+    if(len == std::string::npos)
+    {
+      return false;
+    }
+
+    const char* ptr = line.c_str();
+    size_t pos = strspn(ptr, WHITESPACES);
+
+    ptr += pos;
+    len -= pos;
+
+    if(!len)
+    {
+      return false;
+    }
+        
+    for(pos = len - 1; pos > 0 && strchr(WHITESPACES, ptr[pos]) != 0;
+        pos--);
+
+    trailer.push_back(El::Net::HTTP::Header());
+
+    trailer.rbegin()->name.assign(ptr, pos + 1);
+
+    ptr += len + 1;
+    ptr += strspn(ptr, WHITESPACES);
+    pos = strcspn(ptr, WHITESPACES);
+
+    trailer.rbegin()->value.assign(ptr, pos);
+
+    return true;
+  }
 };
 
 namespace El
@@ -61,7 +169,9 @@ namespace El
             content_length_(-1),
             transfer_encoding_(TE_NONE),
             content_encoding_(CE_IDENTITY),
-            response_body_stream_(0)
+            response_body_stream_(0),
+            request_sent_(0),
+            status_received_(0)
       {
         try
         {
@@ -162,10 +272,14 @@ namespace El
             interceptor_->socket_stream_created(*socket_stream_);
           }
             
+          El::Metrics::Timing timing(connect_time);
+
           socket_stream_->connect(url_->idn_host (),
                                   url_->port (),
                                   connect_timeout);
 
+          timing.stop();
+
           connect_timeout_.reset(
             connect_timeout ? new ACE_Time_Value(*connect_timeout) : 0);
           
@@ -193,6 +307,7 @@ namespace El
         {
           opened_ = false;
 
+          body_reader_.reset();
           deflate_decoding_stream_.reset();
           deflate_decoding_stream_reader_.reset();
           chunks_decoding_stream_.reset();
@@ -209,6 +324,8 @@ namespace El
         transfer_encoding_ = TE_NONE;
         content_encoding_ = CE_IDENTITY;
         response_body_stream_ = 0;
+        request_sent_ = 0;
+        status_received_ = 0;
         recv_buffer_size_ = 0;
         putback_buffer_size_ = 0;
         trailer_.clear();
@@ -249,15 +366,17 @@ namespace El
           case El::Net::HTTP::SC_TEMPORARY_REDIRECT:
             {
               std::string new_url;
-              El::Net::HTTP::Header header;
-            
-              while(recv_response_header(header) && new_url.empty())
+              FieldTable redirect_headers;
+
+              // Body encoding headers of redirect response don't matter
+              recv_header_block(redirect_headers);
+
+              const char* location =
+                redirect_headers.find(El::Net::HTTP::HD_LOCATION);
+
+              if(location)
               {
-                if(!strcasecmp(header.name.c_str(),
-                               El::Net::HTTP::HD_LOCATION))
-                {
-                  new_url = url_->abs_url(header.value.c_str());
-                }
+                new_url = url_->abs_url(location);
               }
 
               if(new_url.empty())
@@ -349,6 +468,8 @@ namespace El
                                 size_t body_len)
         throw(Timeout, Exception, El::Exception)
       {
+        uint64_t started = El::Metrics::now();
+
         switch(method)
         {
         case GET:
@@ -460,6 +581,9 @@ namespace El
             throw Exception(ostr.str());
           }
         }
+
+        request_sent_ = El::Metrics::now();
+        send_time.record(request_sent_ - started);
       }
       
       bool
@@ -473,15 +597,15 @@ namespace El
 
         if(!status_code_read_)
         {
-          std::string version;
-        
-          // Read HTTP protocol version and status
-          stream() >> version >> status_code_;
-          std::getline(stream(), status_text_, '\r');
+          Socket::StreamBuf& streambuf = socket_stream_->socket_streambuf();
+          int ch = 0;
 
-          char ch = stream().get();
+          // Skipping empty lines preceding status line
+          while((ch = read_line(streambuf, header_line_)) == '\n' &&
+                header_line_.find_first_not_of(" \t\n\v\f") ==
+                std::string::npos);
 
-          if(stream().fail() || stream().bad())
+          if(ch < 0)
           {
             status_code_ = 0;
             status_text_.clear();
@@ -510,12 +634,39 @@ namespace El
           
             std::ostringstream ostr;            
             ostr << "El::Net::HTTP::Session::recv_response_status: "
-              "unexpected character encountered: '" << ch << "'";
+              "unexpected character encountered: '" << (char)ch << "'";
+          
+            throw Exception(ostr.str());
+          }
+
+          // Skipping HTTP protocol version
+          const char* ptr = header_line_.c_str();
+          ptr += strspn(ptr, " \t\n\v\f");
+          ptr += strcspn(ptr, " \t\n\v\f");
+
+          char* end = 0;
+          unsigned long code = strtoul(ptr, &end, 10);
+
+          if(end == ptr)
+          {
+            valid_ = false;
+          
+            std::ostringstream ostr;            
+            ostr << "El::Net::HTTP::Session::recv_response_status: "
+              "invalid status line '" << header_line_ << "'";
           
             throw Exception(ostr.str());
           }
 
+          status_code_ = code;
+          status_text_ = end;
           status_code_read_ = true;
+
+          if(request_sent_)
+          {
+            status_received_ = El::Metrics::now();
+            status_wait_time.record(status_received_ - request_sent_);
+          }
         }
         
         return status_code_ >= SC_OK && status_code_ < SC_BAD_REQUEST;
@@ -535,139 +686,14 @@ namespace El
         {
           return false;
         }
-        
-        std::string line;
-        std::getline(stream(), line, '\r');
-          
-        char ch = stream().get();
-          
-        if(stream().fail() || stream().bad())
-        {
-          valid_ = false;
-          
-          int error = socket_stream_->last_error();
-
-          std::ostringstream ostr;            
-          ostr << "El::Net::HTTP::Session::recv_response_header: "
-            "read failed. Reason: " << error << ", "
-               << socket_stream_->last_error_desc();
-          
-          if (error == ETIME)
-          {
-            throw Timeout(ostr.str());
-          }
-          else
-          {
-            throw Exception(ostr.str());
-          }
-        }
-        
-        if(ch != '\n')
-        {
-          valid_ = false;
-          
-          std::ostringstream ostr;            
-          ostr << "El::Net::HTTP::Session::recv_response_header: "
-            "unexpected character encountered: '" << ch << "'";
-          
-          throw Exception(ostr.str());
-        }
 
-        if(line.empty())
+        if(!recv_header_line())
         {
-          //
-          // End of headers
-          //
-
-          headers_read_ = true;
-
-          if(transfer_encoding_ == TE_CHUNKED)
-          {
-            chunks_decoding_stream_.reset(
-              new ChunksDecodingStream(*socket_stream_,
-                                       trailer_,
-                                       recv_buffer_size_,
-                                       putback_buffer_size_,
-                                       interceptor_));
-            
-            response_body_stream_ = chunks_decoding_stream_.get();
-          }
-          else
-          {
-            response_body_stream_ = socket_stream_.get();
-
-            if(content_length_ >= 0)
-            {
-              socket_stream_->socket_streambuf().read_limit(content_length_);
-            }
-          }
-
-          if(!preserve_content_encoding_)
-          {
-            switch(content_encoding_)
-            {
-            case CE_GZIP:
-              {
-                validate_gzip_header();
-              
-                // no break here, continue as with deflate encoding
-              }
-            case CE_COMPRESS:
-              {
-                // no break here, continue as with deflate encoding
-              }
-            case CE_DEFLATE:
-              {
-                deflate_decoding_stream_reader_.reset(
-                  new El::Compress::ZLib::InputStreamReader(
-                    *response_body_stream_));
-
-                bool raw_deflate;
-                
-                switch(content_encoding_)
-                {
-                case CE_GZIP:
-                case CE_COMPRESS:
-                  {
-                    raw_deflate = true;
-                    break;
-                  }
-                default:
-                  {
-                    unsigned char buff[2];
-                    memset(buff, 0, sizeof(buff));
-                    
-                    size_t len =
-                      deflate_decoding_stream_reader_->
-                      read((char*)buff, sizeof(buff));
-                    
-                    raw_deflate = buff[0] != 0x78 || buff[1] != 0x9C;
-                    deflate_decoding_stream_reader_->putback((char*)buff, len);
-                    break;
-                  }
-                }
-                
-                deflate_decoding_stream_.reset(
-                  new El::Compress::ZLib::InStream(
-                    deflate_decoding_stream_reader_.get(),
-                    recv_buffer_size_,
-                    recv_buffer_size_,
-                    putback_buffer_size_,
-                    raw_deflate,
-                    true));
-
-                response_body_stream_ = deflate_decoding_stream_.get();
-
-                break;
-              }
-            default: ;
-            }
-          }
-          
+          headers_received();
           return false;
-        }          
+        }
 
-        std::string::size_type len = line.find(':');
+        std::string::size_type len = header_line_.find(':');
 
         if(len == std::string::npos)
         {
@@ -676,12 +702,12 @@ namespace El
           std::ostringstream ostr;            
           ostr << "El::Net::HTTP::Session::recv_response_header: "
             "character ':' not found while parsing HTTP response header. "
-            "Line:\n" << line;
+            "Line:\n" << header_line_;
           
           throw Exception(ostr.str());
         }
 
-        const char* ptr = line.c_str();
+        const char* ptr = header_line_.c_str();
         size_t pos = strspn(ptr, WHITESPACES);
 
         ptr += pos;
@@ -693,7 +719,7 @@ namespace El
           
           std::ostringstream ostr;            
           ostr << "El::Net::HTTP::Session::recv_response_header: "
-            "invalid HTTP response header:\n" << line;
+            "invalid HTTP response header:\n" << header_line_;
           
           throw Exception(ostr.str());
         }
@@ -711,21 +737,124 @@ namespace El
 
         header.value.assign(ptr, pos);
 
-        if(strcasecmp(header.name.c_str(), HD_CONTENT_LENGTH) == 0)
+        header_received(header.name.c_str(), header.value.c_str());
+        return true;
+      }
+
+      void
+      Session::recv_response_headers(FieldTable& headers)
+        throw(Timeout, Exception, El::Exception)
+      {
+        if(!valid())
+        {
+          throw Exception("El::Net::HTTP::Session::recv_response_headers: "
+                          "invalid session");
+        }
+
+        if(headers_read_)
+        {
+          return;
+        }
+
+        size_t first = headers.size();
+
+        recv_header_block(headers);
+
+        for(size_t i = first; i < headers.size(); ++i)
+        {
+          FieldTable::Field field = headers[i];
+          header_received(field.name, field.value);
+        }
+
+        headers_received();
+      }
+
+      void
+      Session::recv_header_block(FieldTable& headers)
+        throw(Timeout, Exception, El::Exception)
+      {
+        header_block_.clear();
+
+        while(recv_header_line())
+        {
+          header_block_.append(header_line_);
+          header_block_.append("\r\n", 2);
+        }
+
+        try
+        {
+          headers.parse_headers(header_block_.c_str(), header_block_.size());
+        }
+        catch(const InvalidArg& e)
+        {
+          valid_ = false;
+
+          std::ostringstream ostr;
+          ostr << "El::Net::HTTP::Session::recv_header_block: "
+            "invalid HTTP response header. Description:\n" << e;
+
+          throw Exception(ostr.str());
+        }
+      }
+
+      bool
+      Session::recv_header_line() throw(Timeout, Exception, El::Exception)
+      {
+        int ch = read_line(socket_stream_->socket_streambuf(), header_line_);
+          
+        if(ch < 0)
+        {
+          valid_ = false;
+          
+          int error = socket_stream_->last_error();
+
+          std::ostringstream ostr;            
+          ostr << "El::Net::HTTP::Session::recv_header_line: "
+            "read failed. Reason: " << error << ", "
+               << socket_stream_->last_error_desc();
+          
+          if (error == ETIME)
+          {
+            throw Timeout(ostr.str());
+          }
+          else
+          {
+            throw Exception(ostr.str());
+          }
+        }
+        
+        if(ch != '\n')
+        {
+          valid_ = false;
+          
+          std::ostringstream ostr;            
+          ostr << "El::Net::HTTP::Session::recv_header_line: "
+            "unexpected character encountered: '" << (char)ch << "'";
+          
+          throw Exception(ostr.str());
+        }
+
+        return !header_line_.empty();
+      }
+
+      void
+      Session::header_received(const char* name, const char* value)
+        throw(Exception, El::Exception)
+      {
+        if(strcasecmp(name, HD_CONTENT_LENGTH) == 0)
         {
           if(transfer_encoding_ != TE_CHUNKED)
           {
             char* invalid_char_ptr = 0;
-            long long len = strtoll(header.value.c_str(),
-                                    &invalid_char_ptr, 10);
+            long long len = strtoll(value, &invalid_char_ptr, 10);
 
             if((invalid_char_ptr != 0 && *invalid_char_ptr != '\0') || len < 0)
             {
               valid_ = false;
             
               std::ostringstream ostr;            
-              ostr << "El::Net::HTTP::Session::recv_response_header: "
-                "invalid Content-Length header:\n" << line;
+              ostr << "El::Net::HTTP::Session::header_received: "
+                "invalid Content-Length header:\n" << name << ": " << value;
           
               throw Exception(ostr.str());
             }
@@ -734,18 +863,19 @@ namespace El
           }
           
         }
-        else if(strcasecmp(header.name.c_str(), HD_TRANSFER_ENCODING) == 0)
+        else if(strcasecmp(name, HD_TRANSFER_ENCODING) == 0)
         {
           if(version_ == HTTP_1_0)
           {
             std::ostringstream ostr;            
-            ostr << "El::Net::HTTP::Session::recv_response_header: "
-              "unexpected for HTTP/1.0 Transfer-Encoding header:\n" << line;
+            ostr << "El::Net::HTTP::Session::header_received: "
+              "unexpected for HTTP/1.0 Transfer-Encoding header:\n"
+                 << name << ": " << value;
           
             throw Exception(ostr.str());            
           }
             
-          if(strcasecmp(header.value.c_str(), "chunked") == 0)
+          if(strcasecmp(value, "chunked") == 0)
           {
             transfer_encoding_ = TE_CHUNKED;
             content_length_ = -1;
@@ -753,86 +883,246 @@ namespace El
           else
           {
             std::ostringstream ostr;            
-            ostr << "El::Net::HTTP::Session::recv_response_header: "
-              "unsupported Transfer-Encoding header:\n" << line;
+            ostr << "El::Net::HTTP::Session::header_received: "
+              "unsupported Transfer-Encoding header:\n" << name << ": "
+                 << value;
           
             throw Exception(ostr.str());
           }
         }
-        else if(strcasecmp(header.name.c_str(), HD_CONTENT_ENCODING) == 0)
+        else if(strcasecmp(name, HD_CONTENT_ENCODING) == 0)
         {
-          if(strcasecmp(header.value.c_str(), "deflate") == 0)
+          if(strcasecmp(value, "deflate") == 0)
           {
             content_encoding_ = CE_DEFLATE;
           }
-          else if(strcasecmp(header.value.c_str(), "gzip") == 0)
+          else if(strcasecmp(value, "gzip") == 0)
           {
             content_encoding_ = CE_GZIP;
           }
-          else if(strcasecmp(header.value.c_str(), "none"))
+          else if(strcasecmp(value, "none"))
           {
             std::ostringstream ostr;            
-            ostr << "El::Net::HTTP::Session::recv_response_header: "
-              "content encoding '" << header.value << "' is not supported";
+            ostr << "El::Net::HTTP::Session::header_received: "
+              "content encoding '" << value << "' is not supported";
             
             throw Exception(ostr.str());
           }
         }
-        else if(strcasecmp(header.name.c_str(), HD_CONTENT_TYPE) == 0)
+        else if(strcasecmp(name, HD_CONTENT_TYPE) == 0)
         {
 //        if(charset_.empty())
 // Always reset charset which could be inherited from redirect response
 // and can not correspond to final content returned by server          
           {
-            content_type(header.value.c_str(), charset_);
+            content_type(value, charset_);
           }
         }
-        
-        return true;
       }
 
       void
-      Session::validate_gzip_header() throw(Timeout, Exception, El::Exception)
+      Session::headers_received() throw(Timeout, Exception, El::Exception)
       {
-        unsigned char id1 = response_body_stream_->get();
-        unsigned char id2 = response_body_stream_->get();
-        unsigned char compression_method = response_body_stream_->get();
-        unsigned char flags = response_body_stream_->get();
-        char mtime[4];
-        response_body_stream_->read(mtime, sizeof(mtime));
+        headers_read_ = true;
 
-        response_body_stream_->get(); // reading "extra" flags
-        response_body_stream_->get(); // reading OS flag
+        if(status_received_)
+        {
+          headers_time.record(El::Metrics::now() - status_received_);
+        }
 
-        if(!response_body_stream_->fail() &&
-           !response_body_stream_->bad())
+        if(transfer_encoding_ != TE_CHUNKED && content_length_ >= 0)
         {
-          if(id1 != 0x1F && id2 != 0x8B)
-          {
-            std::ostringstream ostr;            
-            ostr << "El::Net::HTTP::Session::validate_gzip_header: "
-              "reading GZIP header failed. Reason: unexpected ids 0x"
-                 << std::hex << (unsigned long)id1 << ", 0x" << std::hex
-                 << (unsigned long)id2 << " instead of 0x1F, 0x8B";
+          socket_stream_->socket_streambuf().read_limit(content_length_);
+        }
+      }
 
-            throw Exception(ostr.str());                
-          }
+      std::istream&
+      Session::response_body() const throw(Exception, El::Exception)
+      {
+        if(!headers_read_)
+        {
+          throw Exception("El::Net::HTTP::Session::response_body: "
+                          "didn't read up to the body yet");
+        }
 
-          if(compression_method != Z_DEFLATED)
-          {
-            std::ostringstream ostr;            
-            ostr << "El::Net::HTTP::Session::validate_gzip_header: "
-              "reading GZIP header failed. Reason: unexpected "
-              "compression method " << (unsigned long) compression_method
-                 << " instead of " << Z_DEFLATED;
-                
-            throw Exception(ostr.str());                
-          }
+        if(body_reader_.get() != 0)
+        {
+          throw Exception("El::Net::HTTP::Session::response_body: "
+                          "body is being read with read_body");
+        }
 
-          if(flags & 0x4) // extra field
-          {
-            char buff[2];
-            response_body_stream_->read(buff, sizeof(buff));
+        if(response_body_stream_ == 0)
+        {
+          create_body_stream();
+        }
+
+        return *response_body_stream_;
+      }
+
+      bool
+      Session::read_body(const char*& data, size_t& size)
+        throw(Timeout, Exception, El::Exception)
+      {
+        if(!headers_read_)
+        {
+          throw Exception("El::Net::HTTP::Session::read_body: "
+                          "didn't read up to the body yet");
+        }
+
+        if(response_body_stream_ != 0)
+        {
+          throw Exception("El::Net::HTTP::Session::read_body: "
+                          "body is being read from response_body stream");
+        }
+
+        if(body_reader_.get() == 0)
+        {
+          body_reader_.reset(
+            new BodyReader(socket_stream_->socket_streambuf(),
+                           transfer_encoding_ == TE_CHUNKED,
+                           preserve_content_encoding_ ?
+                             CE_IDENTITY : content_encoding_,
+                           trailer_,
+                           interceptor_));
+        }
+
+        try
+        {
+          return body_reader_->read(data, size);
+        }
+        catch(...)
+        {
+          valid_ = false;
+          throw;
+        }
+      }
+
+      void
+      Session::create_body_stream() const
+        throw(Timeout, Exception, El::Exception)
+      {
+        if(transfer_encoding_ == TE_CHUNKED)
+        {
+          chunks_decoding_stream_.reset(
+            new ChunksDecodingStream(*socket_stream_,
+                                     trailer_,
+                                     recv_buffer_size_,
+                                     putback_buffer_size_,
+                                     interceptor_));
+          
+          response_body_stream_ = chunks_decoding_stream_.get();
+        }
+        else
+        {
+          response_body_stream_ = socket_stream_.get();
+        }
+
+        if(!preserve_content_encoding_)
+        {
+          switch(content_encoding_)
+          {
+          case CE_GZIP:
+            {
+              validate_gzip_header();
+            
+              // no break here, continue as with deflate encoding
+            }
+          case CE_COMPRESS:
+            {
+              // no break here, continue as with deflate encoding
+            }
+          case CE_DEFLATE:
+            {
+              deflate_decoding_stream_reader_.reset(
+                new El::Compress::ZLib::InputStreamReader(
+                  *response_body_stream_));
+
+              bool raw_deflate;
+              
+              switch(content_encoding_)
+              {
+              case CE_GZIP:
+              case CE_COMPRESS:
+                {
+                  raw_deflate = true;
+                  break;
+                }
+              default:
+                {
+                  unsigned char buff[2];
+                  memset(buff, 0, sizeof(buff));
+                  
+                  size_t len =
+                    deflate_decoding_stream_reader_->
+                    read((char*)buff, sizeof(buff));
+                  
+                  raw_deflate = buff[0] != 0x78 || buff[1] != 0x9C;
+                  deflate_decoding_stream_reader_->putback((char*)buff, len);
+                  break;
+                }
+              }
+              
+              deflate_decoding_stream_.reset(
+                new El::Compress::ZLib::InStream(
+                  deflate_decoding_stream_reader_.get(),
+                  recv_buffer_size_,
+                  recv_buffer_size_,
+                  putback_buffer_size_,
+                  raw_deflate,
+                  true));
+
+              response_body_stream_ = deflate_decoding_stream_.get();
+
+              break;
+            }
+          default: ;
+          }
+        }
+      }
+
+      void
+      Session::validate_gzip_header() const
+        throw(Timeout, Exception, El::Exception)
+      {
+        unsigned char id1 = response_body_stream_->get();
+        unsigned char id2 = response_body_stream_->get();
+        unsigned char compression_method = response_body_stream_->get();
+        unsigned char flags = response_body_stream_->get();
+        char mtime[4];
+        response_body_stream_->read(mtime, sizeof(mtime));
+
+        response_body_stream_->get(); // reading "extra" flags
+        response_body_stream_->get(); // reading OS flag
+
+        if(!response_body_stream_->fail() &&
+           !response_body_stream_->bad())
+        {
+          if(id1 != 0x1F && id2 != 0x8B)
+          {
+            std::ostringstream ostr;            
+            ostr << "El::Net::HTTP::Session::validate_gzip_header: "
+              "reading GZIP header failed. Reason: unexpected ids 0x"
+                 << std::hex << (unsigned long)id1 << ", 0x" << std::hex
+                 << (unsigned long)id2 << " instead of 0x1F, 0x8B";
+
+            throw Exception(ostr.str());                
+          }
+
+          if(compression_method != Z_DEFLATED)
+          {
+            std::ostringstream ostr;            
+            ostr << "El::Net::HTTP::Session::validate_gzip_header: "
+              "reading GZIP header failed. Reason: unexpected "
+              "compression method " << (unsigned long) compression_method
+                 << " instead of " << Z_DEFLATED;
+                
+            throw Exception(ostr.str());                
+          }
+
+          if(flags & 0x4) // extra field
+          {
+            char buff[2];
+            response_body_stream_->read(buff, sizeof(buff));
 
             size_t len = ushort(buff);
             while(len--)
@@ -924,6 +1214,23 @@ namespace El
           
         }
 
+        if(body_reader_.get() != 0)
+        {
+          if(!body_reader_->finished())
+          {
+            throw Exception("Session::test_completion: "
+                            "still has unread some data");
+          }
+
+          // Content checksum is verified by the reader
+          return;
+        }
+
+        if(headers_read_ && response_body_stream_ == 0)
+        {
+          create_body_stream();
+        }
+        
         bool deflate_checked = false;
         
         if(!preserve_content_encoding_ && deflate_decoding_stream_.get() != 0)
@@ -1075,11 +1382,12 @@ namespace El
           throw Exception(ostr.str());
         }
 
-        std::istream& body_str = response_body();
         uint64_t size = 0;
 
         if(enforce_encoding && strcasecmp(enforce_encoding, "UTF-8") == 0)
         {
+          std::istream& body_str = response_body();
+          
           while(!body_str.fail() && size < max_size)
           {
             wchar_t chr = 0;
@@ -1103,9 +1411,51 @@ namespace El
               }
             }
           }
+
+          if(!body_str.fail())
+          {
+            return false;
+          }
+        }
+        else if(response_body_stream_ == 0)
+        {
+          // Decoded body slices are written as is avoiding stream copying
+          const char* data = 0;
+          size_t read_bytes = 0;
+          bool more = true;
+          
+          while(size < max_size && (more = read_body(data, read_bytes)))
+          {
+            read_bytes = std::min((uint64_t)read_bytes, max_size - size);
+            
+            file.write(data, read_bytes);
+        
+            if(file.fail())
+            {
+              std::ostringstream ostr;
+              ostr << "El::Net::HTTP::Session::save_body: failed to write to '"
+                   << file_name << "'";
+            
+              throw Exception(ostr.str());
+            }
+
+            size += read_bytes;
+
+            if(crc)
+            {
+              El::CRC(*crc, (const unsigned char*)data, read_bytes);
+            }
+          }
+
+          if(more)
+          {
+            return false;
+          }
         }
         else
         {
+          std::istream& body_str = response_body();
+          
           while(!body_str.fail() && size < max_size)
           {
             char buff[1024];
@@ -1132,16 +1482,14 @@ namespace El
               El::CRC(*crc, (const unsigned char*)buff, read_bytes);
             }
           }
+
+          if(!body_str.fail())
+          {
+            return false;
+          }
         }
-        
-        if(body_str.fail())
-        {
-          test_completion();
-        }
-        else
-        {
-          return false;
-        }
+
+        test_completion();
 
         if(file.bad() || file.fail())
         {
@@ -1418,27 +1766,7 @@ namespace El
           return false;
         }          
 
-        std::string::size_type len = line.find(':');
-
-        if(len == std::string::npos)
-        {
-          std::ostringstream ostr;            
-          ostr << "El::Net::HTTP::Session::ChunksDecodingStreamBuf::"
-            "read_trailer: character ':' not found while parsing trailer. "
-            "Line:\n" << line;
-
-          last_error_desc_ = ostr.str();
-
-          return false;
-        }
-
-        const char* ptr = line.c_str();
-        size_t pos = strspn(ptr, WHITESPACES);
-
-        ptr += pos;
-        len -= pos;
-
-        if(!len)
+        if(!parse_trailer(line, trailer_))
         {
           std::ostringstream ostr;            
           ostr << "El::Net::HTTP::Session::ChunksDecodingStreamBuf::"
@@ -1448,19 +1776,6 @@ namespace El
 
           return false;
         }
-        
-        for(pos = len - 1; pos > 0 && strchr(WHITESPACES, ptr[pos]) != 0;
-            pos--);
-
-        trailer_.push_back(Header());
-
-        trailer_.rbegin()->name.assign(ptr, pos + 1);
-
-        ptr += len + 1;
-        ptr += strspn(ptr, WHITESPACES);
-        pos = strcspn(ptr, WHITESPACES);
-
-        trailer_.rbegin()->value.assign(ptr, pos);
 
         return true;
       }
@@ -1488,8 +1803,574 @@ namespace El
         
         init(streambuf_.get());
       }
+
+      //
+      // Session::BodyReader
+      //
+
+      Session::BodyReader::BodyReader(Socket::StreamBuf& streambuf,
+                                      bool chunked,
+                                      ContentEncoding content_encoding,
+                                      HeaderList& trailer,
+                                      Interceptor* interceptor)
+        throw(Exception, El::Exception)
+          : streambuf_(streambuf),
+            chunked_(chunked),
+            content_encoding_(content_encoding),
+            trailer_(trailer),
+            interceptor_(interceptor),
+            chunk_size_(0),
+            chunk_data_end_(false),
+            transfer_finished_(false),
+            inflate_initialized_(false),
+            in_ptr_(0),
+            in_size_(0),
+            prefix_size_(0),
+            out_crc_(0),
+            out_bytes_(0),
+            content_finished_(false),
+            finished_(false)
+      {
+        memset(&zstream_, 0, sizeof(zstream_));
+
+        if(content_encoding_ != CE_IDENTITY)
+        {
+          out_buffer_.reset(new char[OUT_BUFFER_SIZE]);
+        }
+      }
+
+      Session::BodyReader::~BodyReader() throw()
+      {
+        if(inflate_initialized_)
+        {
+          inflateEnd(&zstream_);
+        }
+      }
+
+      bool
+      Session::BodyReader::read(const char*& data, size_t& size)
+        throw(Timeout, Exception, El::Exception)
+      {
+        if(finished_)
+        {
+          return false;
+        }
+
+        if(content_encoding_ == CE_IDENTITY ?
+           transfer_read(data, size) : inflate(data, size))
+        {
+          return true;
+        }
+
+        finished_ = true;
+        return false;
+      }
+
+      bool
+      Session::BodyReader::transfer_read(const char*& data, size_t& size)
+        throw(Timeout, Exception, El::Exception)
+      {
+        if(transfer_finished_)
+        {
+          return false;
+        }
+
+        if(!chunked_)
+        {
+          if(!fill())
+          {
+            if(streambuf_.has_read_limit() ?
+               streambuf_.read_limit() > 0 : streambuf_.last_error() != 0)
+            {
+              read_failed("transfer_read", "body truncated");
+            }
+
+            // Whole content-length read or server just closed connection
+            transfer_finished_ = true;
+            return false;
+          }
+
+          data = streambuf_.gptr();
+          size = streambuf_.egptr() - streambuf_.gptr();
+
+          consume(size);
+          return true;
+        }
+
+        while(chunk_size_ == 0)
+        {
+          if(!next_chunk())
+          {
+            transfer_finished_ = true;
+            return false;
+          }
+        }
+
+        if(!fill())
+        {
+          read_failed("transfer_read", "failed to read chunk");
+        }
+
+        size = streambuf_.egptr() - streambuf_.gptr();
+
+        if(size > chunk_size_)
+        {
+          size = chunk_size_;
+        }
+
+        data = streambuf_.gptr();
+        consume(size);
+
+        chunk_size_ -= size;
+        chunk_data_end_ = chunk_size_ == 0;
+
+        return true;
+      }
+
+      bool
+      Session::BodyReader::next_chunk()
+        throw(Timeout, Exception, El::Exception)
+      {
+        if(chunk_data_end_)
+        {
+          unsigned char ch1 = raw_byte();
+          unsigned char ch2 = raw_byte();
+
+          if(ch1 != '\r' || ch2 != '\n')
+          {
+            std::ostringstream ostr;            
+            ostr << "El::Net::HTTP::Session::BodyReader::next_chunk: "
+              "while reading chunk data end marker unexpected character "
+              "encountered: '" << (ch1 != '\r' ? (char)ch1 : (char)ch2)
+                 << "'";
+
+            throw Exception(ostr.str());
+          }
+
+          chunk_data_end_ = false;
+        }
+
+        int ch = read_line(streambuf_, line_);
+
+        if(ch < 0)
+        {
+          read_failed("next_chunk", "failed to read chunk size");
+        }
+
+        if(ch != '\n')
+        {
+          std::ostringstream ostr;            
+          ostr << "El::Net::HTTP::Session::BodyReader::next_chunk: "
+            "while reading chunk size unexpected character encountered: '"
+               << (char)ch << "'";
+
+          throw Exception(ostr.str());
+        }
+
+        char* end = 0;
+        unsigned long long chunk_size = strtoull(line_.c_str(), &end, 16);
+
+        if(end == line_.c_str() || strchr("\t ;", *end) == 0)
+        {
+          std::ostringstream ostr;            
+          ostr << "El::Net::HTTP::Session::BodyReader::next_chunk: "
+            "failed to read chunk size from line '" << line_ << "'";
+
+          throw Exception(ostr.str());
+        }
+
+        chunk_size_ = chunk_size;
+
+        if(interceptor_)
+        {
+          interceptor_->chunk_begins(chunk_size_);
+        }
+
+        if(chunk_size_)
+        {
+          return true;
+        }
+
+        while(true)
+        {
+          ch = read_line(streambuf_, line_);
+
+          if(ch < 0)
+          {
+            read_failed("next_chunk", "failed to read trailer");
+          }
+
+          if(ch != '\n')
+          {
+            std::ostringstream ostr;            
+            ostr << "El::Net::HTTP::Session::BodyReader::next_chunk: "
+              "while reading trailer unexpected character encountered: '"
+                 << (char)ch << "'";
+
+            throw Exception(ostr.str());
+          }
+
+          if(line_.empty())
+          {
+            // End of trailer
+            return false;
+          }
+
+          if(!parse_trailer(line_, trailer_))
+          {
+            std::ostringstream ostr;            
+            ostr << "El::Net::HTTP::Session::BodyReader::next_chunk: "
+              "invalid trailer. Line:\n" << line_;
+
+            throw Exception(ostr.str());
+          }
+        }
+      }
+
+      unsigned char
+      Session::BodyReader::raw_byte() throw(Timeout, Exception, El::Exception)
+      {
+        if(!fill())
+        {
+          read_failed("raw_byte", "failed to read chunk data end marker");
+        }
+
+        unsigned char ch = *streambuf_.gptr();
+        consume(1);
+
+        return ch;
+      }
+
+      bool
+      Session::BodyReader::next_input()
+        throw(Timeout, Exception, El::Exception)
+      {
+        const char* data = 0;
+        size_t size = 0;
+
+        while(transfer_read(data, size))
+        {
+          if(size)
+          {
+            in_ptr_ = data;
+            in_size_ = size;
+            return true;
+          }
+        }
+
+        return false;
+      }
+
+      bool
+      Session::BodyReader::input_buffered() const throw()
+      {
+        return in_size_ || prefix_size_ ||
+          (!transfer_finished_ && (!chunked_ || chunk_size_) &&
+           streambuf_.gptr() < streambuf_.egptr());
+      }
+      
+      unsigned char
+      Session::BodyReader::next_byte()
+        throw(Timeout, Exception, El::Exception)
+      {
+        if(!in_size_ && !next_input())
+        {
+          throw Exception("El::Net::HTTP::Session::BodyReader::next_byte: "
+                          "unexpected end of compressed content");
+        }
+
+        --in_size_;
+        return *in_ptr_++;
+      }
+      
+      void
+      Session::BodyReader::init_inflate()
+        throw(Timeout, Exception, El::Exception)
+      {
+        bool raw_deflate = true;
+              
+        switch(content_encoding_)
+        {
+        case CE_GZIP:
+          {
+            read_gzip_header();
+            out_crc_ = crc32(0L, Z_NULL, 0);
+            break;
+          }
+        case CE_DEFLATE:
+          {
+            while(prefix_size_ < sizeof(prefix_) && (in_size_ || next_input()))
+            {
+              prefix_[prefix_size_++] = *in_ptr_++;
+              --in_size_;
+            }
+
+            raw_deflate = prefix_size_ < sizeof(prefix_) ||
+              (unsigned char)prefix_[0] != 0x78 ||
+              (unsigned char)prefix_[1] != 0x9C;
+            
+            break;
+          }
+        default: ;
+        }
+
+        int ret = raw_deflate ?
+          inflateInit2(&zstream_, -15) : inflateInit(&zstream_);
+        
+        if(ret != Z_OK)
+        {
+          std::ostringstream ostr;            
+          ostr << "El::Net::HTTP::Session::BodyReader::init_inflate: "
+            "inflateInit failed with code " << ret;
+          
+          throw Exception(ostr.str());
+        }
+
+        inflate_initialized_ = true;
+      }
+      
+      bool
+      Session::BodyReader::inflate(const char*& data, size_t& size)
+        throw(Timeout, Exception, El::Exception)
+      {
+        if(content_finished_)
+        {
+          return false;
+        }
+        
+        if(!inflate_initialized_)
+        {
+          init_inflate();
+        }
+
+        zstream_.next_out = (Bytef*)out_buffer_.get();
+        zstream_.avail_out = OUT_BUFFER_SIZE;
+
+        bool stream_end = false;
+        
+        while(zstream_.avail_out)
+        {
+          if(zstream_.avail_in == 0)
+          {
+            //
+            // Not blocking for more input if have something to return
+            // already
+            //
+            if(zstream_.avail_out < OUT_BUFFER_SIZE && !input_buffered())
+            {
+              break;
+            }
+
+            if(prefix_size_)
+            {
+              zstream_.next_in = (Bytef*)prefix_;
+              zstream_.avail_in = prefix_size_;
+              prefix_size_ = 0;
+            }
+            else if(in_size_ || next_input())
+            {
+              zstream_.next_in = (Bytef*)in_ptr_;
+              zstream_.avail_in = in_size_;
+              in_size_ = 0;
+            }
+            else if(content_encoding_ == CE_GZIP)
+            {
+              throw Exception("El::Net::HTTP::Session::BodyReader::inflate: "
+                              "unexpected end of compressed content");
+            }
+            else
+            {
+              // Tolerating unterminated deflate streams as
+              // response_body() stream does
+              stream_end = true;
+              break;
+            }
+          }
+
+          int ret = ::inflate(&zstream_, Z_NO_FLUSH);
+
+          if(ret == Z_STREAM_END)
+          {
+            stream_end = true;
+            break;
+          }
+          
+          if(ret != Z_OK && ret != Z_BUF_ERROR)
+          {
+            std::ostringstream ostr;            
+            ostr << "El::Net::HTTP::Session::BodyReader::inflate: "
+              "inflate failed with code " << ret;
+
+            if(zstream_.msg)
+            {
+              ostr << ", " << zstream_.msg;
+            }
+            
+            throw Exception(ostr.str());
+          }
+        }
+
+        size = OUT_BUFFER_SIZE - zstream_.avail_out;
+        data = out_buffer_.get();
+
+        if(content_encoding_ == CE_GZIP)
+        {
+          out_crc_ = crc32(out_crc_, (const Bytef*)data, size);
+          out_bytes_ += size;
+        }
+
+        if(stream_end)
+        {
+          // Input left after the end of compressed stream
+          in_ptr_ = (const char*)zstream_.next_in;
+          in_size_ = zstream_.avail_in;
+          zstream_.avail_in = 0;
+
+          if(content_encoding_ == CE_GZIP)
+          {
+            read_gzip_trailer();
+          }
+
+          const char* rest = 0;
+          size_t rest_size = 0;
+          
+          while(transfer_read(rest, rest_size));
+          
+          content_finished_ = true;
+        }
+          
+        return size > 0;
+      }
+
+      void
+      Session::BodyReader::read_gzip_header()
+        throw(Timeout, Exception, El::Exception)
+      {
+        unsigned char id1 = next_byte();
+        unsigned char id2 = next_byte();
+        unsigned char compression_method = next_byte();
+        unsigned char flags = next_byte();
+
+        // Skipping mtime, "extra" flags and OS flag
+        for(size_t i = 0; i < 6; ++i)
+        {
+          next_byte();
+        }
+
+        if(id1 != 0x1F || id2 != 0x8B)
+        {
+          std::ostringstream ostr;            
+          ostr << "El::Net::HTTP::Session::BodyReader::read_gzip_header: "
+            "unexpected ids 0x" << std::hex << (unsigned long)id1 << ", 0x"
+               << std::hex << (unsigned long)id2 << " instead of 0x1F, 0x8B";
+
+          throw Exception(ostr.str());                
+        }
+
+        if(compression_method != Z_DEFLATED)
+        {
+          std::ostringstream ostr;            
+          ostr << "El::Net::HTTP::Session::BodyReader::read_gzip_header: "
+            "unexpected compression method "
+               << (unsigned long) compression_method << " instead of "
+               << Z_DEFLATED;
+                
+          throw Exception(ostr.str());                
+        }
+
+        if(flags & 0x4) // extra field
+        {
+          char buff[2];
+          buff[0] = next_byte();
+          buff[1] = next_byte();
+
+          for(size_t len = ushort(buff); len--; next_byte());
+        }
+
+        if(flags & 0x8) // Orig. name
+        {
+          while(next_byte() != '\0');
+        }
+
+        if(flags & 0x10) // Comment
+        {
+          while(next_byte() != '\0');
+        }
+
+        if(flags & 0x2) // CRC16
+        {
+          next_byte();
+          next_byte();
+        }
+      }
+      
+      void
+      Session::BodyReader::read_gzip_trailer()
+        throw(Timeout, Exception, El::Exception)
+      {
+        uint32_t crc = read_uint32();
+        
+        if(crc != out_crc_)
+        {
+          std::ostringstream ostr;
+          ostr << "El::Net::HTTP::Session::BodyReader::read_gzip_trailer: "
+            "data crc 0x" << std::hex << out_crc_
+               << " do not match expected one 0x" << std::hex << crc;
+            
+          throw Exception(ostr.str());              
+        }
+
+        uint32_t len = read_uint32();
+        
+        if(len != out_bytes_)
+        {
+          std::ostringstream ostr;
+          ostr << "El::Net::HTTP::Session::BodyReader::read_gzip_trailer: "
+            "uncompressed data len " << out_bytes_
+               << " do not match expected one " << len;
+            
+          throw Exception(ostr.str());              
+        }
+      }
+
+      uint32_t
+      Session::BodyReader::read_uint32()
+        throw(Timeout, Exception, El::Exception)
+      {
+        char buff[4];
+
+        for(size_t i = 0; i < sizeof(buff); ++i)
+        {
+          buff[i] = next_byte();
+        }
+
+        return ulong(buff);
+      }
+      
+      void
+      Session::BodyReader::read_failed(const char* method, const char* what)
+        throw(Timeout, Exception, El::Exception)
+      {
+        int error = streambuf_.last_error();
+        
+        std::ostringstream ostr;
+        ostr << "El::Net::HTTP::Session::BodyReader::" << method << ": "
+             << what;
+
+        if(!streambuf_.last_error_desc().empty())
+        {
+          ostr << ". Reason: " << error << ", "
+               << streambuf_.last_error_desc();
+        }
+          
+        if(error == ETIME)
+        {
+          throw Timeout(ostr.str());
+        }
+        
+        throw Exception(ostr.str());
+      }
       
     }
   }
 }
-
@@ -23,6 +23,7 @@
 #include <vector>
 
 #include <El/Exception.hpp>
+#include <El/ArrayPtr.hpp>
 
 #include <ace/OS.h>
 
@@ -33,6 +34,7 @@
 #include <El/Net/HTTP/Exception.hpp>
 #include <El/Net/HTTP/URL.hpp>
 #include <El/Net/HTTP/Params.hpp>
+#include <El/Net/HTTP/FieldTable.hpp>
 
 namespace El
 {
@@ -126,6 +128,13 @@ namespace El
         bool recv_response_header(Header& header)
           throw(Timeout, Exception, El::Exception);
 
+        //
+        // Receives all remaining response headers at once appending them
+        // to the table
+        //
+        void recv_response_headers(FieldTable& headers)
+          throw(Timeout, Exception, El::Exception);
+
         void close() throw();
 
         bool save_body(const char* file,
@@ -134,7 +143,21 @@ namespace El
                        const char* enforce_encoding = 0)
           throw(Exception, El::Exception);
         
+        //
+        // Stream of decoded response body; is created on first call
+        //
         std::istream& response_body() const throw(Exception, El::Exception);
+
+        //
+        // Reads next slice of decoded response body bypassing the stream
+        // layers of response_body(): chunk framing is parsed in place over
+        // the socket receive buffer and compressed content is inflated
+        // into a single buffer, so data is copied once at most. Slice is
+        // valid till the next call. Returns false when body is over.
+        // Can't be mixed with reading from response_body().
+        //
+        bool read_body(const char*& data, size_t& size)
+          throw(Timeout, Exception, El::Exception);
         
         void test_completion() throw(Timeout, Exception, El::Exception);
 
@@ -174,9 +197,28 @@ namespace El
       protected:
         class ChunksDecodingStream;
         class ChunksDecodingStreamBuf;
+        class BodyReader;
         
         std::iostream& stream() const throw(Exception, El::Exception);
-        void validate_gzip_header() throw(Timeout, Exception, El::Exception);
+        void validate_gzip_header() const
+          throw(Timeout, Exception, El::Exception);
+
+        // Reads line into header_line_; false if empty one terminating
+        // headers read
+        bool recv_header_line() throw(Timeout, Exception, El::Exception);
+
+        // Reads remaining headers appending them to the table, doesn't
+        // process them
+        void recv_header_block(FieldTable& headers)
+          throw(Timeout, Exception, El::Exception);
+
+        void header_received(const char* name, const char* value)
+          throw(Exception, El::Exception);
+
+        void headers_received() throw(Timeout, Exception, El::Exception);
+
+        void create_body_stream() const
+          throw(Timeout, Exception, El::Exception);
         
         static uint32_t ulong(const char* buff) throw();
         static uint16_t ushort(const char* buff) throw();
@@ -194,7 +236,10 @@ namespace El
         Interceptor* interceptor_;
         bool preserve_content_encoding_;
         bool opened_;
-        bool valid_;
+
+        // Body stream layers are created lazily by const response_body(),
+        // so they and the state it updates are mutable
+        mutable bool valid_;
         bool status_code_read_;
         bool headers_read_;
         std::auto_ptr<ACE_Time_Value> connect_timeout_;
@@ -206,23 +251,32 @@ namespace El
         TransferEncoding transfer_encoding_;
         ContentEncoding content_encoding_;
         std::string charset_;
-        HeaderList trailer_;
+        mutable HeaderList trailer_;
         El::String::Array all_urls_;
+        std::string header_line_;
+        std::string header_block_;
         
         typedef std::auto_ptr<Socket::Stream> SocketStreamPtr;
         SocketStreamPtr socket_stream_;
 
         typedef std::auto_ptr<ChunksDecodingStream> ChunksDecodingStreamPtr;
-        ChunksDecodingStreamPtr chunks_decoding_stream_;
+        mutable ChunksDecodingStreamPtr chunks_decoding_stream_;
 
-        std::auto_ptr<El::Compress::ZLib::InputStreamReader>
+        mutable std::auto_ptr<El::Compress::ZLib::InputStreamReader>
         deflate_decoding_stream_reader_;
 
-        std::auto_ptr<El::Compress::ZLib::InStream>
+        mutable std::auto_ptr<El::Compress::ZLib::InStream>
         deflate_decoding_stream_;
+
+        std::auto_ptr<BodyReader> body_reader_;
         
-        std::istream* response_body_stream_;
+        mutable std::istream* response_body_stream_;
         const std::string empty_str_;
+
+        // El::Metrics::now() values at the end of request sending and
+        // response status receiving; 0 if not happened yet
+        uint64_t request_sent_;
+        uint64_t status_received_;
       };
 
       class Session::ChunksDecodingStreamBuf
@@ -290,6 +344,92 @@ namespace El
 
         ChunksDecodingStreamBufPtr streambuf_;
       };
+
+      class Session::BodyReader
+      {
+      public:
+        BodyReader(Socket::StreamBuf& streambuf,
+                   bool chunked,
+                   ContentEncoding content_encoding,
+                   HeaderList& trailer,
+                   Interceptor* interceptor)
+          throw(Exception, El::Exception);
+
+        ~BodyReader() throw();
+
+        bool read(const char*& data, size_t& size)
+          throw(Timeout, Exception, El::Exception);
+
+        // true if body is read till the end
+        bool finished() const throw();
+
+      private:
+        enum { OUT_BUFFER_SIZE = 64 * 1024 };
+
+        // Next slice of data with transfer encoding removed; points into
+        // the socket receive buffer
+        bool transfer_read(const char*& data, size_t& size)
+          throw(Timeout, Exception, El::Exception);
+
+        bool next_chunk() throw(Timeout, Exception, El::Exception);
+
+        // Sets in_ptr_, in_size_ to the next slice of compressed data
+        bool next_input() throw(Timeout, Exception, El::Exception);
+        bool input_buffered() const throw();
+
+        unsigned char next_byte() throw(Timeout, Exception, El::Exception);
+        unsigned char raw_byte() throw(Timeout, Exception, El::Exception);
+
+        bool fill() throw(El::Exception);
+        void consume(size_t size) throw();
+
+        void init_inflate() throw(Timeout, Exception, El::Exception);
+        bool inflate(const char*& data, size_t& size)
+          throw(Timeout, Exception, El::Exception);
+        
+        void read_gzip_header() throw(Timeout, Exception, El::Exception);
+        void read_gzip_trailer() throw(Timeout, Exception, El::Exception);
+        uint32_t read_uint32() throw(Timeout, Exception, El::Exception);
+
+        void read_failed(const char* method, const char* what)
+          throw(Timeout, Exception, El::Exception);
+
+      private:
+        BodyReader(const BodyReader&);
+        void operator=(const BodyReader&);
+
+      private:
+        Socket::StreamBuf& streambuf_;
+        bool chunked_;
+        ContentEncoding content_encoding_;
+        HeaderList& trailer_;
+        Interceptor* interceptor_;
+
+        // Bytes left in current chunk
+        unsigned long long chunk_size_;
+        // CRLF expected before next chunk size line
+        bool chunk_data_end_;
+        bool transfer_finished_;
+        std::string line_;
+
+        bool inflate_initialized_;
+        z_stream zstream_;
+
+        // Compressed data not consumed yet
+        const char* in_ptr_;
+        size_t in_size_;
+
+        // Bytes peeked to detect deflate format
+        char prefix_[2];
+        size_t prefix_size_;
+        
+        El::ArrayPtr<char> out_buffer_;
+        uint32_t out_crc_;
+        uint32_t out_bytes_;
+
+        bool content_finished_;
+        bool finished_;
+      };
       
     } 
   }  
@@ -321,19 +461,6 @@ namespace El
                         "session is not opened");
       }
       
-      inline
-      std::istream&
-      Session::response_body() const throw(Exception, El::Exception)
-      {
-        if(response_body_stream_ == 0)
-        {
-          throw Exception("El::Net::HTTP::Session::response_body: "
-                          "didn't read up to the body yet");
-        }
-
-        return *response_body_stream_;
-      }
-      
       inline
       uint32_t
       Session::status_code() const throw()
@@ -473,6 +600,33 @@ namespace El
         return streambuf_->last_error_desc();
       }
 
+      //
+      // Session::BodyReader
+      //
+      inline
+      bool
+      Session::BodyReader::finished() const throw()
+      {
+        return finished_;
+      }
+
+      inline
+      bool
+      Session::BodyReader::fill() throw(El::Exception)
+      {
+        return streambuf_.gptr() < streambuf_.egptr() ||
+          streambuf_.underflow() != std::char_traits<char>::eof();
+      }
+
+      inline
+      void
+      Session::BodyReader::consume(size_t size) throw()
+      {
+        streambuf_.setg(streambuf_.eback(),
+                        streambuf_.gptr() + size,
+                        streambuf_.egptr());
+      }
+
     }
   }
 }
@@ -0,0 +1,618 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Net/HTTP/UserAgent.cpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+
+#include <El/Exception.hpp>
+#include <El/String/Manip.hpp>
+#include <El/Hash/Hash64.hpp>
+
+#include "UserAgent.hpp"
+
+namespace
+{
+  //
+  // Rule tables; row is value, pattern, pattern which should be found
+  // too and pattern which should not be found. IMPORTANT: all values
+  // should be maximum 20 chars len.
+  //
+  const char* const BROWSER[][4] =
+  {
+    { "msie", "msie", 0, 0 },
+    { "opera", "opera", 0, 0 },
+    { "firefox", "firefox", 0, 0 },
+    { "yabrowser", "yabrowser", 0, 0 },
+    { "chrome", "chrome", 0, 0 },
+    { "safari", "safari", 0, 0 },
+    { "ucweb", "ucweb", 0, 0 },
+    { "mozilla", "gecko", 0, 0 },
+    { "curl", "curl", 0, 0 },
+    { "msie", "mozilla/4.0 (compatible;)", 0, 0 },
+  };
+
+  const char* const FEED_READER[][4] =
+  {
+    { "newsbrain", "newsbrain", 0, 0 },
+    { "pubsub", "apple-pubsub", 0, 0 },
+    { "feeddemon", "feeddemon", 0, 0 },
+    { "rssowl", "rssowl", 0, 0 },
+    { "feedparser", "feedparser", 0, 0 },
+    { "tinytinyrss", "tt-rss", 0, 0 },
+    { "feedbooster", "feedbooster", 0, 0 },
+    { "feedspot", "feedspot", 0, 0 },
+    { "rsspopper", "rss popper", 0, 0 },
+    { "snarfer", "snarfer", 0, 0 },
+    { "winrss", "windows-rss-platform", 0, 0 },
+  };
+
+  const char* const CRAWLER[][4] =
+  {
+    { "googlebot", "googlebot", 0, 0 },
+    { "yandex", "yandex", 0, 0 },
+    { "mail.ru", "mail.ru", 0, 0 },
+    { "msnbot", "bing", 0, 0 },
+    { "msnbot", "msnbot", 0, 0 },
+    { "googlewebpreview", "google web preview", 0, 0 },
+    { "slurp", "yahoo", 0, 0 },
+    { "adsensebot", "mediapartners-google", 0, 0 },
+    { "yadirect", "yadirectbot", 0, 0 },
+    { "360spider", "360spider", 0, 0 },
+    { "alexa", "ia_archiver", 0, 0 },
+    { "googlefeedfetcher", "feedfetcher-google", 0, 0 },
+    { "feedfetcher", "feedfetcher", 0, 0 },
+    { "googlewltranscoder", "google wireless transcoder", 0, 0 },
+    { "adsbot-google", "adsbot-google", 0, 0 },
+    { "jeeves", "jeeves", 0, 0 },
+    { "teoma", "ask jeeves", 0, 0 },
+    { "altavista", "scooter", 0, 0 },
+    { "lycos", "lycos", 0, 0 },
+    { "rambler", "rambler", 0, 0 },
+    { "aport", "aport", 0, 0 },
+    { "webalta", "webalta", 0, 0 },
+    { "bazquxbot", "bazquxbot", 0, 0 },
+    { "docomo", "docomo", 0, 0 },
+    { "socialradar", "socialradarbot", 0, 0 },
+    { "integromedb", "integromedb.org/crawler", 0, 0 },
+    { "codegator", "codegator", 0, 0 },
+    { "icsbot", "icsbot", 0, 0 },
+    { "affectv", "affectv robot", 0, 0 },
+    { "theoldreader", "theoldreader", 0, 0 },
+    { "unwindfetchor", "unwindfetchor", 0, 0 },
+    { "thumbshots", "thumbshots.ru", 0, 0 },
+    { "diffbot", "diffbot.com", 0, 0 },
+    { "vkshare", "vkshare", 0, 0 },
+    { "rssreader", "rssreader", 0, 0 },
+    { "pr-cy", "pr-cy.ru", 0, 0 },
+    { "jakarta", "jakarta", 0, 0 },
+    { "odklbot", "odklbot", 0, 0 },
+    { "feeddigest", "feeddigest", 0, 0 },
+    { "baidu", "baiduspider", 0, 0 },
+    { "mlbot", "mlbot", 0, 0 },
+    { "voilabot", "voilabot", 0, 0 },
+    { "wordpress", "wordpress", 0, 0 },
+    { "begun", "begun", 0, 0 },
+    { "sogou", "sogou", 0, 0 },
+    { "panscient", "panscient", 0, 0 },
+    { "mj12bot", "mj12bot", 0, 0 },
+    { "comodo", "comodo-certificates", 0, 0 },
+    { "builtwith", "builtwith", 0, 0 },
+    { "ahrefsbot", "ahrefsbot", 0, 0 },
+    { "yodaobot", "yodaobot", 0, 0 },
+    { "ezooms", "ezooms", 0, 0 },
+    { "huaweisymspider", "huaweisymantecspider", 0, 0 },
+    { "edisterbot", "edisterbot", 0, 0 },
+    { "dle_spider", "dle_spider", 0, 0 },
+    { "netcraftsurvagent", "netcraftsurveyagent", 0, 0 },
+    { "discobot", "discobot", 0, 0 },
+    { "archive", "archive.org_bot", 0, 0 },
+    { "aboundex", "aboundex", 0, 0 },
+    { "wbsearch", "wbsearchbot", 0, 0 },
+    { "turnitinbot", "turnitinbot", 0, 0 },
+    { "httrack", "httrack", 0, 0 },
+    { "genieo", "genieo", 0, 0 },
+    { "indy-app", "indy library", 0, 0 },
+    { "superfeedr", "superfeedr", 0, 0 },
+    { "rssgraffiti", "rssgraffiti", 0, 0 },
+    { "ruby-app", "ruby", 0, 0 },
+    { "google-java-app", "google-http-java-client", 0, 0 },
+    { "solomonobot", "solomonobot", 0, 0 },
+    { "addthis", "addthis", 0, 0 },
+    { "liveinternet", "liveinternet", 0, 0 },
+    { "rogerbot", "rogerbot", 0, 0 },
+    { "facebookext", "facebookexternalhit", 0, 0 },
+    { "nigma", "nigma", 0, 0 },
+    { "proximic", "proximic", 0, 0 },
+    { "newsgator", "newsgatoronline", 0, 0 },
+    { "python-app", "python", 0, 0 },
+    { "acoonbot", "acoonbot", 0, 0 },
+    { "sistrix", "sistrix", 0, 0 },
+    { "zend-app", "zend_http_client", 0, 0 },
+    { "panopta", "panopta.com", 0, 0 },
+    { "iteco", "iteco dummy crawler", 0, 0 },
+    { "searchbot", "searchbot", 0, 0 },
+    { "simplepie", "simplepie", 0, 0 },
+    { "flipboardproxy", "flipboard", 0, 0 },
+    { "curl-app", "curl/", 0, 0 },
+    { "sputnikbot", "sputnikbot", 0, 0 },
+    { "bazqux", "bazqux", 0, 0 },
+    { "bitrixsmrss", "bitrixsmrss", 0, 0 },
+    { "perl-app", "lwp-trivial", 0, 0 },
+    { "admantx", "admantx", 0, 0 },
+    { "g2reader-bot", "g2reader-bot", 0, 0 },
+    { "squider", "squider", 0, 0 },
+    { "googlewidget", "developers.google.com", 0, 0 },
+    { "taptu", "taptu-downloader", 0, 0 },
+    { "siteshot", "site-shot", 0, 0 },
+    { "firephp", "firephp", 0, 0 },
+    { "omgilibot", "omgilibot", 0, 0 },
+    { "sensikabot", "sensikabot", 0, 0 },
+    { "dotbot", "dotbot", 0, 0 },
+    { "exabot", "exabot", 0, 0 },
+    { "grapeshot", "grapeshotcrawler", 0, 0 },
+    { "xspider", "xspider", 0, 0 },
+    { "seokicks", "seokicks", 0, 0 },
+    { "webindex", "webindex", 0, 0 },
+    { "ics", "compatible; ics)", 0, 0 },
+    { "feedburner", "feedburner/", 0, 0 },
+    { "infegy", "infegyatlas", 0, 0 },
+    { "netvibes", "netvibes", 0, 0 },
+    { "ltx71", "ltx71", 0, 0 },
+    { "protopage", "protopage", 0, 0 },
+    { "feedlybot", "feedlybot", 0, 0 },
+    { "drupal", "drupal", 0, 0 },
+    { "cliqzbot", "cliqzbot", 0, 0 },
+    { "subscribe", "subscribe.ru", 0, 0 },
+    { "xovibot", "xovibot", 0, 0 },
+    { "linkdexbot", "linkdexbot", 0, 0 },
+    { "twitterfeed", "twitterfeed", 0, 0 },
+    { "java-app", "java/", 0, 0 },
+    { "megaindex", "megaindex", 0, 0 },
+    { "semrush", "semrush", 0, 0 },
+  };
+
+  const char* const OS[][4] =
+  {
+    { "windows", "windows", 0, 0 },
+    { "macintosh", "macintosh", 0, 0 },
+    { "linux", "linux", 0, 0 },
+  };
+
+  const char* const COMPUTER[][4] =
+  {
+    { "generic", "mozilla/5.0 (windows", 0, "windows phone" },
+    { "generic", "mozilla/4.0 (windows", 0, "windows phone" },
+    { "generic",
+      "mozilla/5.0 (compatible, msie 11, windows nt 6.", 0, 0 },
+    { "generic",
+      "mozilla/5.0 (compatible; msie 10.6; windows nt 6.", 0, 0 },
+    { "generic",
+      "mozilla/5.0 (compatible; msie 10.0; windows nt 6.", 0, 0 },
+    { "generic",
+      "mozilla/5.0 (compatible; msie 9.0; windows nt 6.", 0, 0 },
+    { "generic",
+      "mozilla/4.0 (compatible; msie 8.0; windows nt 6.", 0, 0 },
+    { "generic",
+      "mozilla/4.0 (compatible; msie 8.0; windows nt 5.", 0, 0 },
+    { "generic",
+      "mozilla/4.0 (compatible; msie 7.0; windows nt 6.", 0, 0 },
+    { "generic",
+      "mozilla/4.0 (compatible; msie 7.0; windows nt 5.", 0, 0 },
+    { "generic",
+      "mozilla/4.0 (compatible; msie 6.0; windows nt 5.", 0, 0 },
+    { "generic", "mozilla/5.0 (macintosh", 0, "htc" },
+    { "generic", "opera/9.80 (windows nt ", 0, 0 },
+    { "generic", "opera/9.80 (macintosh;", 0, 0 },
+    { "generic", "x11", 0, 0 },
+    { "generic", "curl/", 0, 0 },
+  };
+
+  // Applied only if not a computer
+  const char* const TAB[][4] =
+  {
+    { "apple", "ipad", 0, 0 },
+    { "htc", "htc", "flyer", 0 },
+    { "htc", "htc", "pg", 0 },
+    { "sony", "sony tablet", 0, 0 },
+    { "huawei", "huawei mediapad", 0, 0 },
+    { "samsung", "gt-p", 0, 0 },
+    { "samsung", "gt-n8", 0, 0 },
+    { "google", "nexus 7", 0, 0 },
+    { "google", "nexus 10", 0, 0 },
+    { "asus", "transformer", 0, 0 },
+    { "blackberry", "playbook", 0, 0 },
+    { "blackberry", "rim tablet", 0, 0 },
+    { "acer", "a100", 0, 0 },
+    { "acer", "a101", 0, 0 },
+    { "acer", "a200", 0, 0 },
+    { "acer", "a500", 0, 0 },
+    { "acer", "a501", 0, 0 },
+    { "acer", "a510", 0, 0 },
+    { "acer", "a511", 0, 0 },
+    { "acer", "a701", 0, 0 },
+    { "opera", "opera tablet", 0, 0 },
+    { "fennec", "android", "tablet", 0 },
+  };
+
+  // Applied only if neither a computer nor a tab
+  const char* const PHONE[][4] =
+  {
+    { "apple", "(iphone;", 0, 0 },
+    { "apple", "(ipod;", 0, 0 },
+    { "sonyericsson", "sonyericsson", 0, 0 },
+    { "sony", "sony", 0, 0 },
+    { "huawei", "huawei", 0, 0 },
+    { "blackberry", "blackberry", 0, 0 },
+    { "lg", "lg-", 0, 0 },
+    { "htc", "htc", 0, 0 },
+    { "samsung", "gt-", 0, 0 },
+    { "samsung", "samsung", 0, 0 },
+    { "samsung", "galaxy", 0, 0 },
+    { "google", "nexus", 0, 0 },
+    { "opera", "opera mobi", 0, 0 },
+    { "opera", "opera mini", 0, 0 },
+    { "nokia", "nokia", 0, 0 },
+    { "nokia", "symbian", 0, 0 },
+    { "android", "android", 0, 0 },
+    { "microsoft", "windows phone", 0, 0 },
+  };
+}
+
+namespace El
+{
+  namespace Net
+  {
+    namespace HTTP
+    {
+      //
+      // UserAgentClassifier class
+      //
+      UserAgentClassifier::UserAgentClassifier(size_t memo_size)
+        throw(Exception, El::Exception)
+          : memo_size_(memo_size),
+            class_count_(0)
+      {
+        compile_rules(BROWSER, sizeof(BROWSER) / sizeof(BROWSER[0]),
+                      browser_);
+
+        compile_rules(FEED_READER,
+                      sizeof(FEED_READER) / sizeof(FEED_READER[0]),
+                      feed_reader_);
+
+        compile_rules(CRAWLER, sizeof(CRAWLER) / sizeof(CRAWLER[0]),
+                      crawler_);
+
+        compile_rules(OS, sizeof(OS) / sizeof(OS[0]), os_);
+
+        compile_rules(COMPUTER, sizeof(COMPUTER) / sizeof(COMPUTER[0]),
+                      computer_);
+
+        compile_rules(TAB, sizeof(TAB) / sizeof(TAB[0]), tab_);
+        compile_rules(PHONE, sizeof(PHONE) / sizeof(PHONE[0]), phone_);
+
+        crawler_.empty = "unknown-app";
+
+        build_automaton();
+      }
+
+      void
+      UserAgentClassifier::compile_rules(const RuleDef* table,
+                                         size_t count,
+                                         Category& category)
+        throw(Exception, El::Exception)
+      {
+        category.rules.reserve(count);
+
+        for(size_t i = 0; i < count; ++i)
+        {
+          const RuleDef& def = table[i];
+
+          Rule rule;
+          rule.value = def[0];
+          rule.pattern = pattern_id(def[1]);
+          rule.also = def[2] ? pattern_id(def[2]) : -1;
+          rule.except = def[3] ? pattern_id(def[3]) : -1;
+
+          category.rules.push_back(rule);
+          category.patterns.set(rule.pattern);
+        }
+      }
+
+      int
+      UserAgentClassifier::pattern_id(const char* pattern)
+        throw(Exception, El::Exception)
+      {
+        std::string lower;
+        El::String::Manip::to_lower(pattern, lower);
+
+        if(lower.empty())
+        {
+          throw Exception(
+            "El::Net::HTTP::UserAgentClassifier::pattern_id: empty pattern");
+        }
+
+        StringArray::const_iterator it =
+          std::find(patterns_.begin(), patterns_.end(), lower);
+
+        if(it != patterns_.end())
+        {
+          return it - patterns_.begin();
+        }
+
+        if(patterns_.size() == MAX_PATTERNS)
+        {
+          std::ostringstream ostr;
+          ostr << "El::Net::HTTP::UserAgentClassifier::pattern_id: "
+            "more than " << MAX_PATTERNS << " patterns";
+
+          throw Exception(ostr.str());
+        }
+
+        patterns_.push_back(lower);
+        return patterns_.size() - 1;
+      }
+
+      void
+      UserAgentClassifier::build_automaton() throw(Exception, El::Exception)
+      {
+        //
+        // Only bytes occurring in patterns get own character class, upper
+        // case letters share class with lower case ones
+        //
+        memset(classes_, 0, sizeof(classes_));
+        class_count_ = 1;
+
+        for(StringArray::const_iterator i(patterns_.begin()),
+              e(patterns_.end()); i != e; ++i)
+        {
+          for(const unsigned char* p = (const unsigned char*)i->c_str();
+              *p; ++p)
+          {
+            unsigned char chr = *p;
+
+            if(classes_[chr] == 0)
+            {
+              classes_[chr] = class_count_;
+
+              if(chr >= 'a' && chr <= 'z')
+              {
+                classes_[chr - 'a' + 'A'] = class_count_;
+              }
+
+              ++class_count_;
+            }
+          }
+        }
+
+        const size_t classes = class_count_;
+
+        //
+        // Trie of patterns; -1 for absent edge
+        //
+        std::vector<int> trie(classes, -1);
+        std::vector< std::vector<uint16_t> > outputs(1);
+
+        for(size_t id = 0; id < patterns_.size(); ++id)
+        {
+          size_t state = 0;
+
+          for(const unsigned char* p =
+                (const unsigned char*)patterns_[id].c_str(); *p; ++p)
+          {
+            size_t edge = state * classes + classes_[*p];
+
+            if(trie[edge] < 0)
+            {
+              trie[edge] = outputs.size();
+              outputs.push_back(std::vector<uint16_t>());
+              trie.resize(trie.size() + classes, -1);
+            }
+
+            state = trie[edge];
+          }
+
+          outputs[state].push_back(id);
+        }
+
+        size_t states = outputs.size();
+
+        if(states > MAX_STATES)
+        {
+          std::ostringstream ostr;
+          ostr << "El::Net::HTTP::UserAgentClassifier::build_automaton: "
+            "too many states " << states;
+
+          throw Exception(ostr.str());
+        }
+
+        //
+        // Breadth-first pass resolving failure links into full transition
+        // table and accumulating outputs of suffix states
+        //
+        transitions_.assign(states * classes, 0);
+
+        std::vector<size_t> fail(states, 0);
+        std::vector<size_t> queue;
+        queue.reserve(states);
+
+        for(size_t c = 0; c < classes; ++c)
+        {
+          if(trie[c] > 0)
+          {
+            transitions_[c] = trie[c];
+            queue.push_back(trie[c]);
+          }
+        }
+
+        for(size_t i = 0; i < queue.size(); ++i)
+        {
+          size_t state = queue[i];
+          const std::vector<uint16_t>& suffix = outputs[fail[state]];
+
+          outputs[state].insert(outputs[state].end(),
+                                suffix.begin(),
+                                suffix.end());
+
+          for(size_t c = 0; c < classes; ++c)
+          {
+            size_t edge = state * classes + c;
+            State next = transitions_[fail[state] * classes + c];
+
+            if(trie[edge] > 0)
+            {
+              fail[trie[edge]] = next;
+              transitions_[edge] = trie[edge];
+              queue.push_back(trie[edge]);
+            }
+            else
+            {
+              transitions_[edge] = next;
+            }
+          }
+        }
+
+        output_offsets_.resize(states + 1);
+        outputs_.clear();
+
+        for(size_t i = 0; i < states; ++i)
+        {
+          output_offsets_[i] = outputs_.size();
+
+          outputs_.insert(outputs_.end(),
+                          outputs[i].begin(),
+                          outputs[i].end());
+        }
+
+        output_offsets_[states] = outputs_.size();
+      }
+
+      void
+      UserAgentClassifier::scan(const char* user_agent,
+                                Matches& matches) const throw()
+      {
+        const size_t classes = class_count_;
+        const State* transitions = &transitions_[0];
+        const uint32_t* offsets = &output_offsets_[0];
+        const uint16_t* outputs = outputs_.empty() ? 0 : &outputs_[0];
+
+        size_t state = 0;
+
+        for(const unsigned char* p = (const unsigned char*)user_agent; *p;
+            ++p)
+        {
+          state = transitions[state * classes + classes_[*p]];
+
+          for(uint32_t i = offsets[state], e = offsets[state + 1]; i < e;
+              ++i)
+          {
+            matches.set(outputs[i]);
+          }
+        }
+      }
+
+      void
+      UserAgentClassifier::classify(const char* user_agent,
+                                    UserAgentInfo& info) const throw()
+      {
+        info = UserAgentInfo();
+
+        if(user_agent == 0)
+        {
+          return;
+        }
+
+        Matches matches;
+        scan(user_agent, matches);
+
+        bool empty = *user_agent == '\0';
+
+        info.browser = browser_.value(matches, empty);
+        info.feed_reader = feed_reader_.value(matches, empty);
+        info.crawler = crawler_.value(matches, empty);
+        info.os = os_.value(matches, empty);
+        info.computer = computer_.value(matches, empty);
+
+        if(*info.computer == '\0')
+        {
+          info.tab = tab_.value(matches, empty);
+
+          if(*info.tab == '\0')
+          {
+            info.phone = phone_.value(matches, empty);
+          }
+        }
+      }
+
+      void
+      UserAgentClassifier::lookup(const char* user_agent,
+                                  UserAgentInfo& info)
+        throw(El::Exception)
+      {
+        size_t len = user_agent ? strlen(user_agent) : 0;
+
+        if(user_agent == 0 || memo_size_ == 0 || len > MAX_MEMO_UA_LEN)
+        {
+          classify(user_agent, info);
+          return;
+        }
+
+        uint64_t hash = El::Hash::hash64(user_agent, len, El::Hash::seed());
+        Memo* memo = memo_;
+
+        MemoMap::iterator mit = memo->map.find(hash);
+
+        if(mit != memo->map.end())
+        {
+          MemoList::iterator it = mit->second;
+
+          if(it->user_agent.size() == len &&
+             memcmp(it->user_agent.c_str(), user_agent, len) == 0)
+          {
+            if(it != memo->lru.begin())
+            {
+              memo->lru.splice(memo->lru.begin(), memo->lru, it);
+            }
+
+            info = it->info;
+            return;
+          }
+
+          // Hash collision; colliding entry is replaced
+          memo->lru.erase(it);
+          memo->map.erase(mit);
+        }
+
+        classify(user_agent, info);
+
+        if(memo->map.size() >= memo_size_)
+        {
+          memo->map.erase(memo->lru.back().hash);
+          memo->lru.pop_back();
+        }
+
+        memo->lru.push_front(MemoEntry());
+
+        MemoEntry& entry = memo->lru.front();
+        entry.hash = hash;
+        entry.user_agent.assign(user_agent, len);
+        entry.info = info;
+
+        memo->map[hash] = memo->lru.begin();
+      }
+    }
+  }
+}
@@ -0,0 +1,343 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Net/HTTP/UserAgent.hpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#ifndef _ELEMENTS_EL_NET_HTTP_USERAGENT_HPP_
+#define _ELEMENTS_EL_NET_HTTP_USERAGENT_HPP_
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+#include <list>
+
+#include <ace/OS.h>
+#include <ace/TSS_T.h>
+
+#include <El/Exception.hpp>
+#include <El/Hash/Hash.hpp>
+#include <El/Hash/FlatMap.hpp>
+
+namespace El
+{
+  namespace Net
+  {
+    namespace HTTP
+    {
+      //
+      // All classifications of user agent; each member is a static string,
+      // empty if user agent is not recognized as such
+      //
+      struct UserAgentInfo
+      {
+        const char* browser;
+        const char* feed_reader;
+        const char* crawler;
+        const char* os;
+        const char* computer;
+        const char* tab;
+        const char* phone;
+
+        UserAgentInfo() throw();
+      };
+
+      //
+      // Recognizes user agents by substrings listed in rule tables.
+      // Substrings of all tables are compiled into single case-insensitive
+      // Aho-Corasick automaton, so user agent is classified in all
+      // categories by one pass over its bytes, without lowercased copy.
+      // Within category rules are applied in table order, first matching
+      // one wins.
+      //
+      // lookup additionally remembers results for memo_size most recently
+      // seen user agents per thread, as the same header is usually
+      // classified several times while request is processed.
+      //
+      class UserAgentClassifier
+      {
+      public:
+        EL_EXCEPTION(Exception, El::ExceptionBase);
+
+      public:
+        UserAgentClassifier(size_t memo_size = 64)
+          throw(Exception, El::Exception);
+
+        void classify(const char* user_agent, UserAgentInfo& info) const
+          throw();
+
+        void lookup(const char* user_agent, UserAgentInfo& info)
+          throw(El::Exception);
+
+        size_t patterns() const throw();
+        size_t states() const throw();
+
+      private:
+        typedef uint16_t State;
+
+        static const size_t MAX_PATTERNS = 512;
+        static const size_t MAX_STATES = 65536;
+
+        // Longer user agents are not memoized
+        static const size_t MAX_MEMO_UA_LEN = 1024;
+
+        struct Matches
+        {
+          uint64_t bits[MAX_PATTERNS / 64];
+
+          Matches() throw();
+
+          void set(size_t id) throw();
+          bool has(int id) const throw();
+          bool intersects(const Matches& val) const throw();
+        };
+
+        struct Rule
+        {
+          const char* value;
+          int pattern;
+
+          // If not negative should be found too
+          int also;
+
+          // If not negative should not be found
+          int except;
+
+          bool applies(const Matches& matches) const throw();
+        };
+
+        typedef std::vector<Rule> RuleArray;
+
+        struct Category
+        {
+          RuleArray rules;
+
+          // Main patterns of rules; if none found no rule can apply
+          Matches patterns;
+
+          // Result for empty user agent
+          const char* empty;
+
+          Category() throw();
+
+          const char* value(const Matches& matches, bool empty_ua) const
+            throw();
+        };
+
+        struct MemoEntry
+        {
+          uint64_t hash;
+          std::string user_agent;
+          UserAgentInfo info;
+        };
+
+        // Most recently used in front
+        typedef std::list<MemoEntry> MemoList;
+
+        typedef El::Hash::FlatMap<uint64_t,
+                                  MemoList::iterator,
+                                  El::Hash::Numeric<uint64_t> >
+        MemoMap;
+
+        struct Memo
+        {
+          MemoList lru;
+          MemoMap map;
+        };
+
+        typedef std::vector<std::string> StringArray;
+
+        //
+        // Rule table row is value, pattern, also and except;
+        // also and except can be 0
+        //
+        typedef const char* const RuleDef[4];
+
+        void compile_rules(const RuleDef* table,
+                           size_t count,
+                           Category& category)
+          throw(Exception, El::Exception);
+
+        int pattern_id(const char* pattern) throw(Exception, El::Exception);
+
+        void build_automaton() throw(Exception, El::Exception);
+
+        void scan(const char* user_agent, Matches& matches) const throw();
+
+      private:
+        size_t memo_size_;
+
+        Category browser_;
+        Category feed_reader_;
+        Category crawler_;
+        Category os_;
+        Category computer_;
+        Category tab_;
+        Category phone_;
+
+        StringArray patterns_;
+
+        // Byte to character class; 0 for bytes not occurring in patterns
+        unsigned char classes_[256];
+        size_t class_count_;
+
+        // class_count_ transitions per state
+        std::vector<State> transitions_;
+
+        // Patterns found when reaching state S are
+        // outputs_[output_offsets_[S] .. output_offsets_[S + 1])
+        std::vector<uint32_t> output_offsets_;
+        std::vector<uint16_t> outputs_;
+
+        ACE_TSS<Memo> memo_;
+
+      private:
+        UserAgentClassifier(const UserAgentClassifier&);
+        void operator=(const UserAgentClassifier&);
+      };
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Inlines
+///////////////////////////////////////////////////////////////////////////////
+
+namespace El
+{
+  namespace Net
+  {
+    namespace HTTP
+    {
+      //
+      // UserAgentInfo struct
+      //
+      inline
+      UserAgentInfo::UserAgentInfo() throw()
+          : browser(""),
+            feed_reader(""),
+            crawler(""),
+            os(""),
+            computer(""),
+            tab(""),
+            phone("")
+      {
+      }
+
+      //
+      // UserAgentClassifier::Matches struct
+      //
+      inline
+      UserAgentClassifier::Matches::Matches() throw()
+      {
+        memset(bits, 0, sizeof(bits));
+      }
+
+      inline
+      void
+      UserAgentClassifier::Matches::set(size_t id) throw()
+      {
+        bits[id >> 6] |= (uint64_t)1 << (id & 63);
+      }
+
+      inline
+      bool
+      UserAgentClassifier::Matches::has(int id) const throw()
+      {
+        return (bits[id >> 6] & ((uint64_t)1 << (id & 63))) != 0;
+      }
+
+      inline
+      bool
+      UserAgentClassifier::Matches::intersects(const Matches& val) const
+        throw()
+      {
+        uint64_t res = 0;
+
+        for(size_t i = 0; i < sizeof(bits) / sizeof(bits[0]); ++i)
+        {
+          res |= bits[i] & val.bits[i];
+        }
+
+        return res != 0;
+      }
+
+      //
+      // UserAgentClassifier::Rule struct
+      //
+      inline
+      bool
+      UserAgentClassifier::Rule::applies(const Matches& matches) const
+        throw()
+      {
+        return matches.has(pattern) &&
+          (also < 0 || matches.has(also)) &&
+          (except < 0 || !matches.has(except));
+      }
+
+      //
+      // UserAgentClassifier::Category struct
+      //
+      inline
+      UserAgentClassifier::Category::Category() throw()
+          : empty("")
+      {
+      }
+
+      inline
+      const char*
+      UserAgentClassifier::Category::value(const Matches& matches,
+                                           bool empty_ua) const throw()
+      {
+        if(empty_ua)
+        {
+          return empty;
+        }
+
+        if(!matches.intersects(patterns))
+        {
+          return "";
+        }
+
+        for(RuleArray::const_iterator i(rules.begin()), e(rules.end());
+            i != e; ++i)
+        {
+          if(i->applies(matches))
+          {
+            return i->value;
+          }
+        }
+
+        return "";
+      }
+
+      //
+      // UserAgentClassifier class
+      //
+      inline
+      size_t
+      UserAgentClassifier::patterns() const throw()
+      {
+        return patterns_.size();
+      }
+
+      inline
+      size_t
+      UserAgentClassifier::states() const throw()
+      {
+        return class_count_ ? transitions_.size() / class_count_ : 0;
+      }
+    }
+  }
+}
+
+#endif // _ELEMENTS_EL_NET_HTTP_USERAGENT_HPP_
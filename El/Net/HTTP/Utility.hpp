@@ -17,6 +17,7 @@
 #include <El/Exception.hpp>
 #include <El/BinaryStream.hpp>
 #include <El/Net/HTTP/Session.hpp>
+#include <El/Net/HTTP/UserAgent.hpp>
 
 namespace El
 {
@@ -24,6 +25,13 @@ namespace El
   {
     namespace HTTP
     {
+      //
+      // All classifications of user agent at once; use it instead of
+      // separate functions below when several are required
+      //
+      UserAgentInfo user_agent_info(const char* user_agent)
+        throw(El::Exception);
+
       const char* browser(const char* user_agent) throw(El::Exception);
       const char* feed_reader(const char* user_agent) throw(El::Exception);
       const char* crawler(const char* user_agent) throw(El::Exception);
@@ -296,7 +296,7 @@ namespace El
         }
 
         const char* current_etag =
-          request.in().headers().find(El::Net::HTTP::HD_IF_NONE_MATCH);
+          request.in().header_table().find(El::Net::HTTP::HD_IF_NONE_MATCH);
         
           
         if(current_etag && code_hash_b64 == current_etag)
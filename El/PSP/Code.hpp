@@ -16,6 +16,7 @@
 
 #include <string>
 #include <map>
+#include <memory>
 
 #include <ext/hash_map>
 
@@ -23,6 +24,7 @@
 #include <ace/Guard_T.h>
 
 #include <El/Exception.hpp>
+#include <El/Arena.hpp>
 
 #include <El/Cache/ObjectCache.hpp>
 #include <El/Cache/TextFileCache.hpp>
@@ -30,6 +32,7 @@
 #include <El/Apache/Request.hpp>
 
 #include <El/Python/Code.hpp>
+#include <El/Python/CodeStore.hpp>
 
 #include <El/PSP/Exception.hpp>
 #include <El/Hash/Hash.hpp>
@@ -43,6 +46,7 @@ namespace El
   namespace PSP
   {
     class Context;
+    class CodeCache;
 
     class Code : public El::Cache::TextFile
     {
@@ -57,7 +61,14 @@ namespace El
 
       const char* filename() const throw() { return filename_.c_str(); }
 
-      typedef std::map<std::string, El::Python::Object_var> ObjectMap;
+      // Per-request maps are allocated in request arena
+      typedef std::map<
+        std::string,
+        El::Python::Object_var,
+        std::less<std::string>,
+        El::ArenaAllocator<
+          std::pair<const std::string, El::Python::Object_var> > >
+      ObjectMap;
 
       typedef ACE_Thread_Mutex CodeMutex;
       typedef ACE_Guard<CodeMutex> CodeGuard;      
@@ -82,6 +93,7 @@ namespace El
 
       friend class El::PSP::Context;
       
+      CodeCache* container_;
       std::string filename_;      
       El::Python::Code code_;
       El::Python::Object_var cache_;
@@ -111,6 +123,15 @@ namespace El
         throw(El::Cache::Exception, El::Python::Exception, El::Exception);
 
       Code::CodeMutex& code_lock(const char* code_path) throw(El::Exception);
+
+      //
+      // Sets directory of compiled code shared with other processes and
+      // populated at deploy time. Is to be called before cache is used.
+      //
+      void code_store(const char* directory)
+        throw(El::Python::InvalidArg, El::Exception);
+
+      const El::Python::CodeStore* code_store() const throw();
         
     private:
       
@@ -120,6 +141,7 @@ namespace El
       
       El::Cache::VariablesMapCache localizations_;
       CodeMutexMap code_locks_;
+      std::auto_ptr<El::Python::CodeStore> code_store_;
     };
     
   }
@@ -144,6 +166,7 @@ namespace El
         : El::Cache::Object(sequence_number),
           El::Cache::BinaryFile(container, sequence_number, filename),
           El::Cache::TextFile(container, sequence_number, filename),
+          container_(dynamic_cast<CodeCache*>(container)),
           filename_(filename),
           run_number_(0)
     {
@@ -165,7 +188,11 @@ namespace El
 
       if(!size)
       {
-        code_.compile(text(), filename_.c_str());
+        // Text CRC is calculated by the time last chunk is read
+        code_.compile(text(),
+                      filename_.c_str(),
+                      container_ ? container_->code_store() : 0,
+                      hash());
       }
     }
     
@@ -178,6 +205,21 @@ namespace El
         : El::Cache::FileCache<Code>(review_filetime_period)
     {
     }
+
+    inline
+    void
+    CodeCache::code_store(const char* directory)
+      throw(El::Python::InvalidArg, El::Exception)
+    {
+      code_store_.reset(new El::Python::CodeStore(directory));
+    }
+
+    inline
+    const El::Python::CodeStore*
+    CodeCache::code_store() const throw()
+    {
+      return code_store_.get();
+    }
   }
 }
 
@@ -33,6 +33,7 @@ namespace El
         : El::Python::ObjectImpl(type),
           code_(0),
           localization_cache_(0),
+          valid_languages_(0),
           run_number_(0)
     {
       throw Exception(
@@ -54,7 +55,7 @@ namespace El
           config_(add_ref(config)),
           localization_(add_ref(localization)),
           localization_cache_(localization_cache),
-          valid_languages_(valid_languages),
+          valid_languages_(&valid_languages),
           forward_params_(
             El::Python::add_ref(forward_ags ? forward_ags : Py_None)),
           cache_(El::Python::add_ref(cache)),
@@ -102,14 +103,14 @@ namespace El
       El::Python::Lang_var valid_lang = new El::Python::Lang();
 
       El::PSP::Request::LangMap::const_iterator i =
-        valid_languages_.find(lang.l3_code());
+        valid_languages_->find(lang.l3_code());
 
-      if(i == valid_languages_.end())
+      if(i == valid_languages_->end())
       {
-        i = valid_languages_.find("*");
+        i = valid_languages_->find("*");
       }
 
-      if(i != valid_languages_.end())
+      if(i != valid_languages_->end())
       {
         *valid_lang = i->second;
       }
@@ -122,7 +122,8 @@ namespace El
       Config_var config_;
       El::PSP::Localization_var localization_;
       El::Cache::VariablesMapCache* localization_cache_;
-      El::PSP::Request::LangMap valid_languages_;
+      // Configuration map outliving request
+      const El::PSP::Request::LangMap* valid_languages_;
       El::Python::Object_var forward_params_;
       El::Python::Object_var cache_;
       El::Python::Object_var loc_dict_;
@@ -15,6 +15,7 @@
 
 #include <locale.h>
 #include <stdlib.h>
+#include <strings.h>
 
 #include <iostream>
 #include <string>
@@ -23,6 +24,7 @@
 
 #include <El/Exception.hpp>
 #include <El/Lang.hpp>
+#include <El/Metrics.hpp>
 #include <El/NameValueMap.hpp>
 #include <El/Logging/StreamLogger.hpp>
 #include <El/Localization/Loc.hpp>
@@ -58,6 +60,13 @@ namespace Aspect
   const char CACHE[] = "PSP_Cache";
 }
 
+namespace
+{
+  El::Metrics::Histogram request_time(
+    "el_psp_request_seconds",
+    "Time PSP requests are handled");
+}
+
 namespace El
 {
   namespace PSP
@@ -184,6 +193,39 @@ namespace El
                          0,
                          1);
 
+      register_directive("PSP_CacheSpillThreshold",
+                         "numeric:0,max",
+                         "PSP_CacheSpillThreshold <bytes>; entries of this "
+                           "size and bigger are kept in mmap-ed files, "
+                           "0 - disabled",
+                         0,
+                         1);
+
+      register_directive("PSP_CacheSpillDir",
+                         "string",
+                         "PSP_CacheSpillDir <directory>.",
+                         0,
+                         1);
+
+      register_directive("PSP_CodeStoreDir",
+                         "string",
+                         "PSP_CodeStoreDir <directory>; compiled code "
+                           "shared by processes, see ElPyCompile",
+                         0,
+                         1);
+
+      register_directive("PSP_CacheMemoryBudget",
+                         "numeric:0,max",
+                         "PSP_CacheMemoryBudget <bytes>; 0 - unlimited",
+                         0,
+                         1);
+
+      register_directive("PSP_CacheShards",
+                         "numeric:1,1024",
+                         "PSP_CacheShards <number>",
+                         0,
+                         1);
+
       register_directive("PSP_CacheKey",
                          "string:nws",
                          "PSP_CacheKey uri|uri_crawler|none.",
@@ -204,6 +246,13 @@ namespace El
                          0,
                          LONG_MAX);
       
+      register_directive("PSP_OutputBrigade",
+                         "numeric:0,1",
+                         "PSP_OutputBrigade <0|1>; 1 - pass response "
+                           "buffers to output filters by reference",
+                         0,
+                         1);
+      
       register_directive("PSP_CanonicalEndpoint",
                          "string",
                          "PSP_CanonicalEndpoint <host[:port]>.",
@@ -212,6 +261,7 @@ namespace El
 
       register_handler("psp-script");
       register_handler("psp-template");
+      register_handler("psp-metrics");
     }
  
     void
@@ -402,6 +452,26 @@ namespace El
       {
         config.entry_unused_check_period = arg.numeric();
       }
+      else if(dname == "PSP_CacheSpillThreshold")
+      {
+        config.cache_spill_threshold = arg.numeric();
+      }
+      else if(dname == "PSP_CacheSpillDir")
+      {
+        config.cache_spill_dir = arg.string();
+      }
+      else if(dname == "PSP_CodeStoreDir")
+      {
+        config.code_store_dir = arg.string();
+      }
+      else if(dname == "PSP_CacheMemoryBudget")
+      {
+        config.cache_memory_budget = arg.numeric();
+      }
+      else if(dname == "PSP_CacheShards")
+      {
+        config.cache_shards = arg.numeric();
+      }
       else if(dname == "PSP_CacheEnabled")
       {
         config.cache_enabled = arg.numeric() != 0;
@@ -414,6 +484,10 @@ namespace El
       {
         config.deflate_level = arg.numeric();
       }
+      else if(dname == "PSP_OutputBrigade")
+      {
+        config.output_brigade = arg.numeric();
+      }
       else if(dname == "PSP_CanonicalEndpoint")
       {
         config.canonical_endpoint = arg.string();
@@ -492,11 +566,20 @@ namespace El
           new RequestCache::Cache(conf.entry_timeout_delay,
                                   conf.entry_unused_check_period,
                                   conf.cache_trace_enabled ?
-                                  logger_.get() : 0));
+                                  logger_.get() : 0,
+                                  conf.cache_spill_threshold,
+                                  conf.cache_spill_dir.c_str(),
+                                  conf.cache_memory_budget,
+                                  conf.cache_shards ? conf.cache_shards : 16));
 
         cache_trace_enabled_ = conf.cache_trace_enabled;
       }
 
+      if(code_cache_.code_store() == 0 && !conf.code_store_dir.empty())
+      {
+        code_cache_.code_store(conf.code_store_dir.c_str());
+      }
+
       search_paths_.insert(conf.search_paths.begin(),
                            conf.search_paths.end());
 
@@ -653,6 +736,13 @@ namespace El
     Module::handler(Context& context) throw(El::Exception)
     {
       El::Apache::Request& request = context.request;
+
+      if(strcasecmp(request.ap_request->handler, "psp-metrics") == 0)
+      {
+        return metrics_handler(request);
+      }
+
+      El::Metrics::Timing timing(request_time);
       Config& conf = *context.config();
 
 //      std::cerr << "handler root: " << conf.root << std::endl;
@@ -703,6 +793,11 @@ namespace El
         }
       }
       
+      if(conf.output_brigade > 0)
+      {
+        request.brigade(true);
+      }
+      
       if(request_cache_.get())
       {
         bool log = cache_trace_enabled_ && logger_.get() != 0 &&
@@ -865,6 +960,16 @@ namespace El
       }
     }
 
+    int
+    Module::metrics_handler(El::Apache::Request& request)
+      throw(El::Exception)
+    {
+      request.out().content_type("text/plain; version=0.0.4");
+      El::Metrics::Registry::instance().scrape(request.out().stream());
+
+      return OK;
+    }
+
     int
     Module::handle_error(El::Apache::Request& request,
                          const char* error,
@@ -943,7 +1048,9 @@ namespace El
       try
       {
         El::PSP::Config_var psp_conf = create_conf(conf.options);
-        El::PSP::Code::ObjectMap objects;
+        El::PSP::Code::ObjectMap objects(
+          El::PSP::Code::ObjectMap::key_compare(),
+          El::PSP::Code::ObjectMap::allocator_type(&request.arena()));
 
         for(Config::ObjectInfoMap::iterator it = conf.objects.begin();
             it != conf.objects.end(); it++)
@@ -1099,7 +1206,7 @@ namespace El
       bool refered_by_search_engine = false;
       
       const char* referer =
-        request.in().headers().find(El::Net::HTTP::HD_REFERER);
+        request.in().header_table().find(El::Net::HTTP::HD_REFERER);
 
 //      referer = "http://webalta.ru/poisk?q=%D0%BE%D0%B1%D1%80%D0%B0%D0%B7%D1%86%D1%8B+%D1%84%D0%BE%D1%80%D0%BC%D1%8B+%D0%BF%D0%BE%D0%BB%D0%B8%D1%86%D0%B8%D0%B8";
 //      referer = "http://yandex.ru/yandsearch?text=%f7%f2%ee+%e8%e7%ee%e1%f0%e0%e6%e5%ed%ee+%ed%e0+%eb%ee%e3%ee%f2%e8%ef%e5+%e8%e7%e4%e0%f2%e5%eb%fc%f1%f2%e2%e0+%22%eb%e0%e1%e8%f0%e8%ed%f2+%ef%f0%e5%f1%f1%22?&lr=213";
@@ -1136,7 +1243,7 @@ namespace El
             
             const char* crawler =
               El::Net::HTTP::crawler(
-                request.in().headers().find(El::Net::HTTP::HD_USER_AGENT));
+                request.in().header_table().find(El::Net::HTTP::HD_USER_AGENT));
 
             if(*crawler != '\0')
             {
@@ -1311,7 +1418,8 @@ namespace El
         
         if((switch_param_lang || switch_url_lang) &&
            request.method_number() == M_GET &&
-           (host = request.in().headers().find(El::Net::HTTP::HD_HOST)) != 0)
+           (host = request.in().header_table().find(
+              El::Net::HTTP::HD_HOST)) != 0)
         {
           std::string redirect_url(request.secure() ? "https://" : "http://");
           redirect_url += host;
@@ -1408,7 +1516,7 @@ namespace El
       }
 
       const char* accept_enc =
-        request.in().headers().find(El::Net::HTTP::HD_ACCEPT_ENCODING);
+        request.in().header_table().find(El::Net::HTTP::HD_ACCEPT_ENCODING);
       
       if(accept_enc == 0)
       {
@@ -130,7 +130,13 @@ namespace El
       time_t entry_timeout_delay;
       time_t entry_unused_timeout;
       time_t entry_unused_check_period;
+      unsigned long cache_spill_threshold;
+      std::string cache_spill_dir;
+      std::string code_store_dir;
+      unsigned long cache_memory_budget;
+      unsigned long cache_shards;
       int deflate_level;
+      int output_brigade;
       std::string canonical_endpoint;
     };
     
@@ -192,6 +198,15 @@ namespace El
                            const El::Lang& lang,
                            ETagCalc etag_calc) throw(El::Exception);
 
+      //
+      // Responds with El::Metrics::Registry scrape. The registry is per
+      // process, so under prefork MPM it covers only the child serving
+      // the scrape request; threaded MPMs with single child process or
+      // per-child scrape targets are to be used for complete metrics.
+      //
+      static int metrics_handler(El::Apache::Request& request)
+        throw(El::Exception);
+
     void add_options(El::PSP::Config* conf,
                      const char* key,
                      const Directive::ArgArray& vals)
@@ -237,7 +252,11 @@ namespace El
           entry_timeout_delay(0),
           entry_unused_timeout(RequestCache::TIME_UNSET),
           entry_unused_check_period(0),
-          deflate_level(-2)
+          cache_spill_threshold(0),
+          cache_memory_budget(0),
+          cache_shards(0),
+          deflate_level(-2),
+          output_brigade(-1)
     {
     }
     
@@ -315,9 +334,26 @@ namespace El
       entry_unused_check_period = std::max(cf_base.entry_unused_check_period,
                                            cf_new.entry_unused_check_period);
 
+      cache_spill_threshold = std::max(cf_base.cache_spill_threshold,
+                                       cf_new.cache_spill_threshold);
+
+      cache_spill_dir = cf_new.cache_spill_dir.empty() ?
+        cf_base.cache_spill_dir : cf_new.cache_spill_dir;
+
+      code_store_dir = cf_new.code_store_dir.empty() ?
+        cf_base.code_store_dir : cf_new.code_store_dir;
+
+      cache_memory_budget = std::max(cf_base.cache_memory_budget,
+                                     cf_new.cache_memory_budget);
+
+      cache_shards = std::max(cf_base.cache_shards, cf_new.cache_shards);
+
       deflate_level = cf_new.deflate_level > -2 ? cf_new.deflate_level :
         cf_base.deflate_level;
 
+      output_brigade = cf_new.output_brigade < 0 ?
+        cf_base.output_brigade : cf_new.output_brigade;
+
       canonical_endpoint = cf_new.canonical_endpoint.empty() ?
         cf_base.canonical_endpoint : cf_new.canonical_endpoint;
     }
@@ -169,7 +169,8 @@ namespace El
     Request::In::In(PyTypeObject *type, PyObject *args, PyObject *kwds)
       throw(El::Exception)
         : El::Python::ObjectImpl(type),
-          request_(0)
+          request_(0),
+          valid_languages_(0)
     {
       throw Exception(
         "El::PSP::Request::In::In: unforseen way of object creation");
@@ -181,21 +182,15 @@ namespace El
       throw(El::Exception)
         : El::Python::ObjectImpl(&Type::instance),
           request_(&request),
-          valid_languages_(valid_languages)
+          valid_languages_(&valid_languages)
     {
-      for(LangMap::const_iterator it = valid_languages.begin();
-          it != valid_languages.end(); it++)
-      {
-        final_languages_.insert(it->second);
-      }      
-      
       lang_ = new El::Python::Lang(lang);
     }
 
     void
     Request::In::lang(const El::Lang& val) throw(El::Exception)
     {
-      if(final_languages_.find(val) == final_languages_.end())
+      if(!final_language(val))
       {
         std::ostringstream ostr;
         ostr << "EL::PSP::Request::In::lang: language " << val.l3_code()
@@ -290,14 +285,14 @@ namespace El
         if(lang == El::Lang::null)
         {
           El::PSP::Request::LangMap::const_iterator i =
-            valid_languages_.find(locale_lang.l3_code());
+            valid_languages_->find(locale_lang.l3_code());
           
-          if(i == valid_languages_.end())
+          if(i == valid_languages_->end())
           {
-            i = valid_languages_.find("*");
+            i = valid_languages_->find("*");
           }
           
-          if(i != valid_languages_.end())
+          if(i != valid_languages_->end())
           {
             lang = i->second;
           }
@@ -336,14 +331,14 @@ namespace El
           if(locale_lang != El::Lang::null)
           {
             El::PSP::Request::LangMap::const_iterator i =
-              valid_languages_.find(locale_lang.l3_code());
+              valid_languages_->find(locale_lang.l3_code());
           
-            if(i == valid_languages_.end())
+            if(i == valid_languages_->end())
             {
-              i = valid_languages_.find("*");
+              i = valid_languages_->find("*");
             }
           
-            if(i == valid_languages_.end())
+            if(i == valid_languages_->end())
             {
               lang = locale_lang;
             }
@@ -367,7 +362,7 @@ namespace El
         // Need to detect language
 
         if(locale_lang == El::Lang::null ||
-           final_languages_.find(locale_lang) != final_languages_.end())
+           final_language(locale_lang))
         {
           lang = *lang_;
         }
@@ -375,14 +370,14 @@ namespace El
         if(lang == El::Lang::null)
         {
           El::PSP::Request::LangMap::const_iterator i =
-            valid_languages_.find(locale_lang.l3_code());
+            valid_languages_->find(locale_lang.l3_code());
           
-          if(i == valid_languages_.end())
+          if(i == valid_languages_->end())
           {
-            i = valid_languages_.find("*");
+            i = valid_languages_->find("*");
           }
           
-          if(i != valid_languages_.end())
+          if(i != valid_languages_->end())
           {
             lang = i->second;
           }
@@ -408,7 +403,7 @@ namespace El
         // Need to detect country and language
         
         if(locale_lang == El::Lang::null ||
-           final_languages_.find(locale_lang) != final_languages_.end())
+           final_language(locale_lang))
         {
           lang = *lang_;
         }
@@ -424,14 +419,14 @@ namespace El
 //            lang = locale_lang;
 
             El::PSP::Request::LangMap::const_iterator i =
-              valid_languages_.find(locale_lang.l3_code());
+              valid_languages_->find(locale_lang.l3_code());
           
-            if(i == valid_languages_.end())
+            if(i == valid_languages_->end())
             {
-              i = valid_languages_.find("*");
+              i = valid_languages_->find("*");
             }
           
-            if(i == valid_languages_.end())
+            if(i == valid_languages_->end())
             {
               lang = locale_lang;
             }
@@ -455,6 +450,23 @@ namespace El
       return locale.retn();
     }
       
+    bool
+    Request::In::final_language(const El::Lang& lang) const throw()
+    {
+      // Few languages configured, so scan is cheaper than building
+      // hash set for each request
+      for(LangMap::const_iterator i(valid_languages_->begin()),
+            e(valid_languages_->end()); i != e; ++i)
+      {
+        if(i->second == lang)
+        {
+          return true;
+        }
+      }
+
+      return false;
+    }
+
     El::Country
     Request::In::detect_country(const El::Lang& lang, unsigned long step) const
       throw(El::Exception)
@@ -156,6 +156,9 @@ namespace El
                                    unsigned long step = 0)
           const throw(El::Exception);
 
+        // Checks if lang is one of valid_languages_ values
+        bool final_language(const El::Lang& lang) const throw();
+
       private:
         El::Apache::Request* request_;
         El::Python::Sequence_var headers_;
@@ -163,8 +166,9 @@ namespace El
         El::Python::Sequence_var cookies_;
         El::Python::Sequence_var accept_languages_;
         El::Python::Lang_var lang_;
-        LangMap valid_languages_;
-        LangSet final_languages_;
+
+        // Configuration map outliving request, so is not copied
+        const LangMap* valid_languages_;
 
         static El::Geography::AddressInfo address_info_;
       };
@@ -11,17 +11,49 @@
  * $id:$
  */
 
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+
 #include <sstream>
 #include <string>
 #include <iostream>
+#include <vector>
 
 #include <El/Exception.hpp>
-#include <El/CRC.hpp>
+#include <El/IO.hpp>
 #include <El/Apache/Request.hpp>
 #include <El/Net/HTTP/Utility.hpp>
 
 #include "RequestCache.hpp"
 
+namespace
+{
+  //
+  // Buffer mapped from unlinked spill file
+  //
+  class MappedBuffer : public El::Apache::SharedBuffer
+  {
+  public:
+    MappedBuffer(char* data, size_t size) throw();
+    virtual ~MappedBuffer() throw();
+  };
+
+  MappedBuffer::MappedBuffer(char* data, size_t size) throw()
+  {
+    data_ = data;
+    size_ = size;
+  }
+
+  MappedBuffer::~MappedBuffer() throw()
+  {
+    munmap(data_, size_);
+    data_ = 0;
+  }
+}
+
 namespace El
 {
   namespace PSP
@@ -29,6 +61,39 @@ namespace El
     namespace RequestCache
     {
       const char LOG_ASPECT[] = "PSP_Cache";
+
+      const size_t BUFFER_MIN_SIZE = 4096;
+      const size_t BUFFER_MAX_SIZE = 65536;
+      const size_t ENCODER_QUEUE_SIZE = 1000;
+      
+      //
+      // FrequencySketch class
+      //
+      FrequencySketch::FrequencySketch(size_t width) throw(El::Exception)
+          : mask_(1),
+            additions_(0)
+      {
+        while(mask_ < width)
+        {
+          mask_ <<= 1;
+        }
+
+        counters_.resize(mask_ * DEPTH, 0);
+        sample_size_ = mask_ * 10;
+        --mask_;
+      }
+
+      void
+      FrequencySketch::age() throw()
+      {
+        for(std::vector<unsigned char>::iterator i(counters_.begin()),
+              e(counters_.end()); i != e; ++i)
+        {
+          *i >>= 1;
+        }
+
+        additions_ /= 2;
+      }
       
       //
       // ConditionMap class 
@@ -94,13 +159,396 @@ namespace El
       
       Cache::Cache(time_t entry_timeout_delay,
                    time_t entry_unused_check_period,
-                   El::Logging::Logger* logger)
-        throw(El::Exception)
+                   El::Logging::Logger* logger,
+                   size_t spill_threshold,
+                   const char* spill_dir,
+                   size_t memory_budget,
+                   size_t shards)
+        throw(Exception, El::Exception)
           : entry_timeout_delay_(entry_timeout_delay),
             entry_unused_check_period_(entry_unused_check_period),
-            unused_entry_next_check_(0),
-            logger_(logger)
+            logger_(logger),
+            spill_threshold_(spill_threshold),
+            spill_dir_(spill_dir && *spill_dir ? spill_dir : P_tmpdir),
+            shard_budget_(0),
+            shard_count_(shards)
+      {
+        if(shards == 0)
+        {
+          throw Exception(
+            "El::PSP::RequestCache::Cache::Cache: shards is 0");
+        }
+
+        if(memory_budget)
+        {
+          shard_budget_ = std::max(memory_budget / shards, (size_t)1);
+        }
+        
+        shards_.reset(new Shard[shards]);
+        
+        encoder_ = new El::Service::ThreadPool(this,
+                                               "PSPCacheEncoder",
+                                               1,
+                                               0,
+                                               ENCODER_QUEUE_SIZE);
+        encoder_->start();
+      }
+
+      Cache::~Cache() throw()
+      {
+        try
+        {
+          encoder_->stop();
+          encoder_->wait();
+        }
+        catch(...)
+        {
+        }
+      }
+
+      bool
+      Cache::notify(El::Service::Event* event) throw(El::Exception)
+      {
+        El::Service::Error* error =
+          dynamic_cast<El::Service::Error*>(event);
+
+        if(error && logger_)
+        {
+          logger_->error(error->description, LOG_ASPECT);
+        }
+
+        return true;
+      }
+
+      bool
+      Cache::schedule_encoding(const Entry* entry) throw(El::Exception)
+      {
+        El::Service::ThreadPool::Task_var task = new EncodeTask(this, entry);
+        return encoder_->execute(task.in(), &ACE_Time_Value::zero);
+      }
+
+      bool
+      Cache::schedule_spill(const Entry* entry, size_t size)
+        throw(El::Exception)
+      {
+        if(spill_threshold_ == 0 || size < spill_threshold_)
+        {
+          return false;
+        }
+        
+        // If encoder is overloaded body is just kept in memory
+        El::Service::ThreadPool::Task_var task = new SpillTask(entry);
+        return encoder_->execute(task.in(), &ACE_Time_Value::zero);
+      }
+
+      void
+      Cache::encoded(const Entry* entry, uint64_t key, size_t size) throw()
+      {
+        {
+          Shard& sh = shard(key);
+          Guard guard(sh.lock);
+
+          ++sh.encodings;
+        }
+
+        resized(entry, key, size);
+      }
+
+      void
+      Cache::resized(const Entry* entry, uint64_t key, size_t size) throw()
+      {
+        Shard& sh = shard(key);
+        Guard guard(sh.lock);
+
+        NodeMap::iterator it = sh.map.find(key);
+
+        if(it == sh.map.end() || it->second->entry.in() != entry)
+        {
+          return;
+        }
+
+        Node& node = *it->second;
+        
+        sh.bytes += size - node.size;
+        node.size = size;
+
+        // Entry is in use, so kept
+        fit(sh, key, 0, false, 0);
+      }
+
+      Cache::Stat
+      Cache::stat() const throw()
+      {
+        Stat st;
+
+        for(size_t i = 0; i < shard_count_; ++i)
+        {
+          Shard& sh = shards_[i];
+          Guard guard(sh.lock);
+
+          st.hits += __atomic_load_n(&sh.hits, __ATOMIC_RELAXED);
+          st.bytes_served +=
+            __atomic_load_n(&sh.bytes_served, __ATOMIC_RELAXED);
+          st.bytes_saved += __atomic_load_n(&sh.bytes_saved, __ATOMIC_RELAXED);
+          st.misses += sh.misses;
+          st.encodings += sh.encodings;
+          st.entries += sh.map.size();
+          st.bytes += sh.bytes;
+          st.evictions += sh.evictions;
+          st.rejections += sh.rejections;
+          st.expirations += sh.expirations;
+        }
+
+        return st;
+      }
+
+      void
+      Cache::remove(Shard& shard, NodeList::iterator it) throw()
+      {
+        shard.bytes -= it->size;
+        shard.map.erase(it->key);
+        shard.lru.erase(it);
+      }
+
+      void
+      Cache::check_unused(Shard& shard, time_t now, std::ostream* log)
+        throw(El::Exception)
+      {
+        if(shard.next_unused_check > now)
+        {
+          return;
+        }
+
+        shard.next_unused_check = now + entry_unused_check_period_;
+
+        //
+        // Entries at LRU tail are the least recently used, so the most
+        // probable to be unused. All expired ones are removed stopping at
+        // the first one in use instead of scanning the whole map.
+        //
+        while(!shard.lru.empty())
+        {
+          NodeList::iterator it = --shard.lru.end();
+
+          if(it->entry->expire_unused() > now)
+          {
+            break;
+          }
+
+          if(log)
+          {
+            *log << "\nUnused: " << std::uppercase << std::hex << it->key
+                 << " (" << it->entry.in() << ")" << std::dec;
+          }
+          
+          remove(shard, it);
+          ++shard.expirations;
+        }
+      }
+
+      bool
+      Cache::fit(Shard& shard,
+                 uint64_t key,
+                 size_t size,
+                 bool admit,
+                 std::ostream* log)
+        throw(El::Exception)
+      {
+        if(shard_budget_ == 0)
+        {
+          return true;
+        }
+
+        if(size > shard_budget_)
+        {
+          ++shard.rejections;
+          
+          if(log)
+          {
+            *log << "\nRejected; exceeds shard budget " << shard_budget_;
+          }
+          
+          return false;
+        }
+        
+        unsigned long frequency = admit ? shard.sketch.estimate(key) : 0;
+
+        while(shard.bytes + size > shard_budget_ && !shard.lru.empty())
+        {
+          NodeList::iterator it = --shard.lru.end();
+
+          if(it->key == key)
+          {
+            if(shard.lru.size() == 1)
+            {
+              break;
+            }
+
+            // Keep entry being updated; evict preceding one
+            --it;
+          }
+          
+          if(admit && frequency <= shard.sketch.estimate(it->key))
+          {
+            ++shard.rejections;
+            
+            if(log)
+            {
+              *log << "\nRejected; frequency " << frequency
+                   << " not above victim's one";
+            }
+            
+            return false;
+          }
+
+          if(log)
+          {
+            *log << "\nEvicted: " << std::uppercase << std::hex << it->key
+                 << " (" << it->entry.in() << ")" << std::dec;
+          }
+
+          remove(shard, it);
+          ++shard.evictions;
+        }
+
+        return true;
+      }
+
+      Body*
+      Cache::spill(Body* body) throw(El::Exception)
+      {
+        size_t size = body->size();
+        const SegmentList& segments = body->segments();
+        
+        if(spill_threshold_ == 0 || size < spill_threshold_ ||
+           body->spilled())
+        {
+          return El::RefCount::add_ref(body);
+        }
+
+        std::string name = spill_dir_ + "/ElPSPCache.XXXXXX";
+        std::vector<char> path(name.c_str(), name.c_str() + name.length() + 1);
+
+        int fd = mkstemp(&path[0]);
+        std::ostringstream ostr;
+
+        if(fd < 0)
+        {
+          int error = errno;
+          
+          ostr << "El::PSP::RequestCache::Cache::spill: mkstemp failed for "
+               << &path[0] << ". Errno " << error << ", description:\n"
+               << strerror(error);
+        }
+        else
+        {
+          unlink(&path[0]);
+
+          for(SegmentList::const_iterator i(segments.begin()),
+                e(segments.end()); i != e && ostr.tellp() == 0; ++i)
+          {
+            for(const char* ptr = i->data, *end = ptr + i->size; ptr < end; )
+            {
+              ssize_t written = El::write(fd, ptr, end - ptr);
+
+              if(written <= 0)
+              {
+                int error = errno;
+                
+                ostr << "El::PSP::RequestCache::Cache::spill: write failed. "
+                  "Errno " << error << ", description:\n" << strerror(error);
+                
+                break;
+              }
+
+              ptr += written;
+            }
+          }
+
+          if(ostr.tellp() == 0)
+          {
+            void* data = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+
+            if(data == MAP_FAILED)
+            {
+              int error = errno;
+              
+              ostr << "El::PSP::RequestCache::Cache::spill: mmap failed. "
+                "Errno " << error << ", description:\n" << strerror(error);
+            }
+            else
+            {
+              close(fd);
+
+              El::Apache::SharedBuffer_var buffer =
+                new MappedBuffer((char*)data, size);
+              
+              Body_var mapped = new Body();
+              mapped->add(buffer.in(), buffer->data(), size);
+              mapped->spilled(true);
+              
+              return mapped.retn();
+            }
+          }
+
+          close(fd);
+        }
+
+        // Keep body in memory if failed to spill
+        
+        if(logger_)
+        {
+          logger_->error(ostr.str(), LOG_ASPECT);
+        }
+        
+        return El::RefCount::add_ref(body);
+      }
+
+      //
+      // Cache::EncodeTask class
+      //
+      Cache::EncodeTask::EncodeTask(Cache* cache, const Entry* entry)
+        throw(El::Exception)
+          : El::Service::ThreadPool::TaskBase(false),
+            cache_(cache),
+            entry_(El::RefCount::add_ref(const_cast<Entry*>(entry)))
+      {
+      }
+
+      void
+      Cache::EncodeTask::execute() throw(El::Exception)
+      {
+        try
+        {
+          entry_->encode();
+          cache_->encoded(entry_.in(), entry_->key(), entry_->memory_size());
+        }
+        catch(const El::Exception& e)
+        {
+          if(cache_->logger_)
+          {
+            std::ostringstream ostr;
+            ostr << "El::PSP::RequestCache::Cache::EncodeTask::execute: "
+              "El::Exception caught. Description:\n" << e;
+
+            cache_->logger_->error(ostr.str(), LOG_ASPECT);
+          }
+        }
+      }
+      
+      //
+      // Cache::SpillTask class
+      //
+      Cache::SpillTask::SpillTask(const Entry* entry) throw(El::Exception)
+          : El::Service::ThreadPool::TaskBase(false),
+            entry_(El::RefCount::add_ref(const_cast<Entry*>(entry)))
+      {
+      }
+
+      void
+      Cache::SpillTask::execute() throw(El::Exception)
       {
+        entry_->spill();
       }
       
       Entry*
@@ -140,7 +588,7 @@ namespace El
         case CKT_URI:
           {
             const char* uri = request.unparsed_uri();
-            El::CRC(key, (const unsigned char*)uri, strlen(uri));
+            key = El::Hash::hash64(uri, strlen(uri), El::Hash::seed());
             
             if(log)
             {
@@ -153,15 +601,15 @@ namespace El
         case CKT_URI_CRAWLER:
           {
             const char* uri = request.unparsed_uri();
-            El::CRC(key, (const unsigned char*)uri, strlen(uri));
+            key = El::Hash::hash64(uri, strlen(uri), El::Hash::seed());
 
             const char* ua =
-              request.in().headers().find(El::Net::HTTP::HD_USER_AGENT);
+              request.in().header_table().find(El::Net::HTTP::HD_USER_AGENT);
             
             if(ua)
             {
               const char* crawler = El::Net::HTTP::crawler(ua);
-              El::CRC(key, (const unsigned char*)crawler, strlen(crawler));
+              key = El::Hash::hash64(crawler, strlen(crawler), key);
             }
             
             if(log)
@@ -175,147 +623,116 @@ namespace El
         }
 
         Entry* entry = 0;
-        bool check_unused = false;
         time_t curr_time = request.time().sec();
-        
-        {
-          ReadGuard guard(lock_);
 
-          CacheMap::const_iterator it = cache_map_.find(key);
+        Shard& sh = shard(key);
+        Guard guard(sh.lock);
+
+        sh.sketch.increment(key);
+        check_unused(sh, curr_time, log ? ostr.get() : 0);
+
+        NodeMap::iterator it = sh.map.find(key);
+
+        if(it == sh.map.end())
+        {
+          Entry_var e(
+            new Entry(this, key, entry_timeout, entry_unused_timeout));
+            
+          if(log)
+          {
+            *ostr << " not found\nNew record created (" << std::uppercase
+                  << std::hex << e.in() << std::dec << "); TTL:"
+                  << entry_timeout << " sec, UTTL: " << entry_unused_timeout
+                  << " sec\nNo ready entry, will cache";
+          }
+            
+          request.callback(e.in(), PSP_CACHE_REQUEST_CALLBACK_ID);
+        }
+        else
+        {
+          // Move to LRU front
+          sh.lru.splice(sh.lru.begin(), sh.lru, it->second);
+          
+          entry = it->second->entry.in();
+          entry->expire_unused(curr_time + entry->unused_timeout());
 
-          if(it == cache_map_.end())
+          if(log)
           {
+            *ostr << " found (" << std::uppercase << std::hex << entry
+                  << std::dec << ")\nUTTL: " << entry->unused_timeout()
+                  << " sec";
+          }
+          
+          if(entry->expire() <= curr_time)
+          {
+            if(log)
+            {
+              *ostr << "\nExpired: keep for " << entry_timeout_delay_
+                    << " sec\nNo ready entry, will cache";
+            }
+              
+            entry->expire(curr_time + entry_timeout_delay_);
+            entry = 0;
+
             Entry_var e(
               new Entry(this, key, entry_timeout, entry_unused_timeout));
-            
+
             if(log)
             {
-              *ostr << " not found\nNew record created (" << std::uppercase
+              *ostr << "\nNew record created (" << std::uppercase
                     << std::hex << e.in() << std::dec << "); TTL:"
-                    << entry_timeout << " sec, UTTL: " << entry_unused_timeout
-                    << " sec\nNo ready entry, will cache";
+                    << entry_timeout << " sec, UTTL: "
+                    << entry_unused_timeout << " sec";
             }
-            
+              
             request.callback(e.in(), PSP_CACHE_REQUEST_CALLBACK_ID);
           }
           else
-          {            
-            entry = it->second.in();            
-            entry->expire_unused(curr_time + entry->unused_timeout());
-
+          {
             if(log)
             {
-              *ostr << " found (" << std::uppercase << std::hex << entry
-                    << std::dec << ")\nUTTL: " << entry->unused_timeout()
-                    << " sec";
+              *ostr << "; TTL: " << entry->expire() - curr_time << " sec";
             }
-          
-            if(entry->expire() <= curr_time)
-            {
-              if(log)
-              {
-                *ostr << "\nExpired: keep for " << entry_timeout_delay_
-                      << " sec\nNo ready entry, will cache";
-              }
               
-              entry->expire(curr_time + entry_timeout_delay_);
-              entry = 0;
-
-              Entry_var e(
-                new Entry(this, key, entry_timeout, entry_unused_timeout));
-
-              if(log)
-              {
-                *ostr << "\nNew record created (" << std::uppercase
-                      << std::hex << e.in() << std::dec << "); TTL:"
-                      << entry_timeout << " sec, UTTL: "
-                      << entry_unused_timeout << " sec";
-              }
-              
-              request.callback(e.in(), PSP_CACHE_REQUEST_CALLBACK_ID);
-            }
-            else
-            {
-              if(log)
-              {
-                *ostr << "; TTL: " << entry->expire() - curr_time << " sec";
-              }
-              
-              El::Apache::Request::In& in = request.in();
-          
-              if(in.accept_encoding("gzip") || in.accept_encoding("identity"))
-              {
-                if(log)
-                {
-                  *ostr << "\nHave ready entry, no caching";
-                }
-                
-                entry->add_ref();
-              }
-              else
-              {
-                if(log)
-                {
-                  *ostr << "\nNo gzip nor identity encoding supported\n"
-                    "No ready entry, no caching";
-                }
-                
-                entry = 0;
-              }              
-            }
-          }          
-
-          check_unused = entry == 0 && unused_entry_next_check_ <= curr_time;
-        }
-
-        if(check_unused)
-        {
-          size_t erased = 0;
+            El::Apache::Request::In& in = request.in();
           
-          if(log)
-          {
-            *ostr << "\nCheck Unused:";
-          }
-          
-          WriteGuard guard(lock_);
-          
-          for(CacheMap::iterator i(cache_map_.begin()),
-                e(cache_map_.end()); i != e; )
-          {
-            if(i->second->expire_unused() <= curr_time)
+            if(in.accept_encoding("gzip") || in.accept_encoding("identity"))
             {
-              CacheMap::iterator n(i);
-              ++n;
-
               if(log)
               {
-                *ostr << "\n  " << std::uppercase << std::hex << i->first
-                      << " (" << std::uppercase << i->second.in() << std::dec
-                      << ")";
-              }
-              
-              cache_map_.erase(i);
-              i = n;
-
-              ++erased;
+                *ostr << "\nHave ready entry, no caching";
+              }
+                
+              entry->add_ref();
             }
             else
             {
-              ++i;
-            }
+              if(log)
+              {
+                *ostr << "\nNo gzip nor identity encoding supported\n"
+                  "No ready entry, no caching";
+              }
+                
+              entry = 0;
+            }              
           }
+        }
 
-          unused_entry_next_check_ = curr_time + entry_unused_check_period_;
-
-          if(log)
-          {
-            *ostr << "\n" << erased << " erased; next check in "
-                  << entry_unused_check_period_ << " sec";
-          }
+        if(entry == 0)
+        {
+          ++sh.misses;
         }
         
         if(log)
         {
+          *ostr << "\nShard: " << sh.map.size() << " entries, " << sh.bytes
+                << " bytes; hits: "
+                << __atomic_load_n(&sh.hits, __ATOMIC_RELAXED)
+                << ", encodings: " << sh.encodings << ", bytes served: "
+                << __atomic_load_n(&sh.bytes_served, __ATOMIC_RELAXED)
+                << ", bytes saved: "
+                << __atomic_load_n(&sh.bytes_saved, __ATOMIC_RELAXED);
+          
           logger_->debug(ostr->str(), LOG_ASPECT);
         }
         
@@ -357,27 +774,107 @@ namespace El
         if(log)
         {
           const char* ct = val->content_type();
+          Body_var identity = val->body(Entry::V_IDENTITY);
+          Body_var gzip = val->body(Entry::V_GZIP);
           
           *ostr << "\nSaved; TTL: " << timeout << " sec, UTTL: "
                 << val->unused_timeout() << "  sec"
                 << "\nCode: " << val->result()
                 << "\nETag: " << val->etag()
-                << "\nDataLen: " << val->data_len()
+                << "\nIdentityLen: "
+                << (identity.in() ? identity->size() : 0)
+                << "\nGZipLen: " << (gzip.in() ? gzip->size() : 0)
                 << "\nContentType: '" << (ct ? ct : "") << "'"
                 << "\nHeaders:";
 
-          for(El::Net::HTTP::HeaderList::const_iterator
-                i(val->headers().begin()), e(val->headers().end()); i != e;
-              ++i)
+          const El::Net::HTTP::FieldTable& headers = val->headers();
+
+          for(size_t i = 0; i < headers.size(); ++i)
           {
-            *ostr << "\n" << i->name << ":" << i->value;
+            El::Net::HTTP::FieldTable::Field field = headers[i];
+            *ostr << "\n" << field.name << ":" << field.value;
           }
-          
-          logger_->debug(ostr->str(), LOG_ASPECT);
         }
         
-        WriteGuard guard(lock_);
-        cache_map_[key] = El::RefCount::add_ref(val);
+        size_t size = val->memory_size();
+        
+        Shard& sh = shard(key);
+        Guard guard(sh.lock);
+
+        NodeMap::iterator it = sh.map.find(key);
+
+        // Refreshed entry of a key already cached is always admitted
+        bool refresh = it != sh.map.end();
+
+        if(refresh)
+        {
+          remove(sh, it->second);
+        }
+
+        if(fit(sh, key, size, !refresh, log ? ostr.get() : 0))
+        {
+          sh.lru.push_front(Node(key, val, size));
+          sh.map[key] = sh.lru.begin();
+          sh.bytes += size;
+        }
+        
+        if(log)
+        {
+          logger_->debug(ostr->str(), LOG_ASPECT);
+        }
+      }
+      
+      //
+      // Body class
+      //
+      void
+      Body::add(El::Apache::SharedBuffer* buffer,
+                const char* data,
+                size_t size)
+        throw(El::Exception)
+      {
+        if(!segments_.empty())
+        {
+          Segment& last = segments_.back();
+
+          if(last.buffer.in() == buffer && last.data + last.size == data)
+          {
+            last.size += size;
+            size_ += size;
+            return;
+          }
+        }
+
+        segments_.push_back(Segment(buffer, data, size));
+        size_ += size;
+      }
+      
+      void
+      Body::write(const char* buffer, size_t size) throw(El::Exception)
+      {
+        while(size)
+        {
+          if(own_buffer_.in() == 0 ||
+             own_buffer_used_ == own_buffer_->size())
+          {
+            size_t len = own_buffer_.in() ?
+              std::min(own_buffer_->size() * 2, BUFFER_MAX_SIZE) :
+              BUFFER_MIN_SIZE;
+
+            own_buffer_ = new El::Apache::SharedBuffer(len);
+            own_buffer_used_ = 0;
+          }
+
+          size_t len = std::min(size, own_buffer_->size() - own_buffer_used_);
+          char* ptr = own_buffer_->data() + own_buffer_used_;
+            
+          memcpy(ptr, buffer, len);
+          add(own_buffer_.in(), ptr, len);
+
+          own_buffer_used_ += len;
+          buffer += len;
+          size -= len;
+        }
       }
       
       //
@@ -388,9 +885,8 @@ namespace El
                    time_t entry_timeout,
                    time_t entry_unused_timeout) throw(Exception, El::Exception)
           : key_(key),
-            buff_(0),
-            buff_len_(0),
-            data_len_(0),
+            variant_(V_IDENTITY),
+            encoding_scheduled_(false),
             content_type_(0),
             result_(0),
             expire_(0),
@@ -403,16 +899,6 @@ namespace El
       
       Entry::~Entry() throw()
       {
-        // Need to destruct gzip_ before buff_ is freed as it can flash
-        // data in destructor writing to buff_
-        
-        gzip_.reset(0);
-        
-        if(buff_)
-        {
-          free(buff_);
-        }
-
         if(content_type_)
         {
           free(content_type_);
@@ -443,103 +929,190 @@ namespace El
       void
       Entry::start_writing(bool deflate) throw(El::Exception)
       {
-        if(!deflate)
-        {
-          gzip_.reset(
-            new El::Compress::ZLib::GZip(this, Z_DEFAULT_COMPRESSION));
-        }
+        // Response is stored as is; other variant produced on demand
+        variant_ = deflate ? V_GZIP : V_IDENTITY;
+        bodies_[variant_] = new Body();
       }
       
       void
       Entry::on_write(const char* buffer, size_t size) throw(El::Exception)
       {
-        if(cache_ == 0)
+        Body* body = bodies_[variant_].in();
+        
+        if(cache_ == 0 || body == 0)
         {
           return;
         }
 
-        if(gzip_.get())
+        try
         {
-          gzip_->stream().write(buffer, size);
+          body->write(buffer, size);
         }
-        else
+        catch(const std::bad_alloc&)
         {
-          write_buff(buffer, size);
+          cache_ = 0;
+          bodies_[variant_] = 0;
+          throw;
         }
       }
 
-      size_t
-      Entry::write(const char* buff, size_t len)
+      void
+      Entry::on_write_shared(El::Apache::SharedBuffer* buffer,
+                             const char* data,
+                             size_t size)
+        throw(El::Exception)
       {
-        write_buff(buff, len);
-        return len;
+        Body* body = bodies_[variant_].in();
+        
+        if(cache_ && body)
+        {
+          body->add(buffer, data, size);
+        }
       }
       
       void
-      Entry::write_buff(const char* buffer, size_t size) throw(El::Exception)
+      Entry::finalize(int result) throw(El::Exception)
+      {
+        if(result != OK || cache_ == 0 || bodies_[variant_].in() == 0)
+        {
+          bodies_[variant_] = 0;
+          return;
+        }
+
+        result_ = result;
+
+        Body* body = bodies_[variant_].in();
+        body->close();
+
+        size_t size = body->size();
+        cache_->entry(this, key_);
+
+        // Big body is moved to disk by encoder thread not to delay response
+        cache_->schedule_spill(this, size);
+      }
+
+      void
+      Entry::spill() throw(El::Exception)
       {
-        if(buff_len_ - data_len_ < size)
+        for(size_t i = 0; i < V_COUNT; ++i)
         {
-          size_t tmp_len = std::max(2 * buff_len_, buff_len_ + size);
-          unsigned char* tmp = (unsigned char*)realloc(buff_, tmp_len);
+          Body_var src = body((Variant)i);
 
-          if(tmp == 0)
+          if(src.in() == 0)
           {
-            cache_ = 0;
-            
-            if(buff_)
+            continue;
+          }
+
+          Body_var dest = cache_->spill(src.in());
+
+          if(dest.in() != src.in())
+          {
+            WriteGuard_ guard(lock_);
+
+            if(bodies_[i].in() == src.in())
             {
-              free(buff_);
-              buff_ = 0;
-              buff_len_ = 0;
-              data_len_ = 0;
+              bodies_[i] = dest;
             }
-            
-            throw std::bad_alloc();
           }
-          
-          buff_ = tmp;
-          buff_len_ = tmp_len;
         }
-        
-        memcpy(buff_ + data_len_, buffer, size);
-        data_len_ += size;
+
+        // Spilled bodies are not accounted in memory budget
+        cache_->resized(this, key_, memory_size());
       }
-      
+
       void
-      Entry::finalize(int result) throw(El::Exception)
+      Entry::encode() throw(El::Exception)
       {
-        if(result != OK || cache_ == 0)
+        Body_var src;
+        Variant variant;
+        
         {
-          gzip_.reset(0);
-          return;
+          ReadGuard_ guard(lock_);
+
+          if(bodies_[V_IDENTITY].in() && bodies_[V_GZIP].in())
+          {
+            return;
+          }
+
+          variant = bodies_[V_GZIP].in() ? V_IDENTITY : V_GZIP;
+          src = bodies_[variant == V_GZIP ? V_IDENTITY : V_GZIP];
         }
 
-        if(gzip_.get())
+        if(src.in() == 0)
         {
-          gzip_->finalize();
-          gzip_.reset(0);
+          return;
         }
-        
-        result_ = result;
 
-        if(buff_len_ > data_len_)
+        Body_var dest = new Body();
+
+        if(variant == V_GZIP)
         {
-          unsigned char* tmp = (unsigned char*)malloc(data_len_);
+          BodyWriter writer(dest.in());
+          El::Compress::ZLib::GZip gzip(&writer, Z_DEFAULT_COMPRESSION);
+          std::ostream& ostr = gzip.stream();
+
+          const SegmentList& segments = src->segments();
+          
+          for(SegmentList::const_iterator i(segments.begin()),
+                e(segments.end()); i != e; ++i)
+          {
+            ostr.write(i->data, i->size);
+          }
           
-          if(tmp)
+          gzip.finalize();
+        }
+        else
+        {
+          BodyReader reader(src.in());
+          El::Compress::ZLib::GUnzip gunzip(&reader);
+          El::Compress::ZLib::InStream& istr = gunzip.stream();
+            
+          char buff[4096];
+            
+          while(true)
           {
-            memcpy(tmp, buff_, data_len_);
+            istr.read(buff, sizeof(buff));
+            size_t read_bytes = istr.gcount();
 
-            free(buff_);
-            buff_ = tmp;
-            buff_len_ = data_len_;
+            if(read_bytes == 0)
+            {
+              break;
+            }
+            
+            dest->write(buff, read_bytes);
           }
         }
 
-        cache_->entry(this, key_);
+        dest->close();
+        dest = cache_->spill(dest.in());
+
+        WriteGuard_ guard(lock_);
+        bodies_[variant] = dest;
       }
 
+      void
+      Entry::schedule_encoding() const throw(El::Exception)
+      {
+        {
+          WriteGuard_ guard(lock_);
+
+          if(encoding_scheduled_)
+          {
+            return;
+          }
+
+          encoding_scheduled_ = true;
+        }
+
+        if(!cache_->schedule_encoding(this))
+        {
+          // Encoder is overloaded; will be rescheduled on next hit
+          
+          WriteGuard_ guard(lock_);
+          encoding_scheduled_ = false;
+        }
+      }
+      
       void
       Entry::send_cache_control(El::Apache::Request& request) const
         throw(El::Exception)
@@ -554,6 +1127,66 @@ namespace El
              El::String::Manip::string(max_age)).c_str());
         }          
       }
+
+      std::string
+      Entry::variant_etag(Variant variant) const throw(El::Exception)
+      {
+        if(variant != V_GZIP || etag_.empty())
+        {
+          return etag_;
+        }
+
+        // Different representations should have different strong etags
+        
+        std::string::size_type len = etag_.length();
+        
+        return etag_[len - 1] == '"' && len > 1 ?
+          etag_.substr(0, len - 1) + "-gzip\"" : etag_ + "-gzip";
+      }
+      
+      bool
+      Entry::etag_match(const char* inm, const std::string& etag) const
+        throw(El::Exception)
+      {
+        while(*inm)
+        {
+          inm += strspn(inm, " \t,");
+          
+          const char* end = strchr(inm, ',');
+
+          if(end == 0)
+          {
+            end = inm + strlen(inm);
+          }
+
+          const char* tag_end = end;
+          
+          for(; tag_end > inm && (tag_end[-1] == ' ' || tag_end[-1] == '\t');
+              --tag_end);
+
+          if(tag_end - inm == 1 && *inm == '*')
+          {
+            return true;
+          }
+
+          const char* tag = inm;
+          
+          if(tag_end - tag > 2 && tag[0] == 'W' && tag[1] == '/')
+          {
+            tag += 2;
+          }
+
+          if((size_t)(tag_end - tag) == etag.length() &&
+             strncmp(tag, etag.c_str(), etag.length()) == 0)
+          {
+            return true;
+          }
+
+          inm = end;
+        }
+
+        return false;
+      }
       
       int
       Entry::respond(El::Apache::Request& request,
@@ -562,11 +1195,13 @@ namespace El
         std::auto_ptr<std::ostringstream> ostr;
         bool log = logger && logger->will_log(El::Logging::DEBUG);
 
+        El::Apache::Request::In& in = request.in();
+        
+        const char* inm =
+          in.header_table().find(El::Net::HTTP::HD_IF_NONE_MATCH);
+          
         if(log)
         {
-          const char* inm =
-            request.in().headers().find(El::Net::HTTP::HD_IF_NONE_MATCH);
-          
           ostr.reset(new std::ostringstream());
           *ostr << "Entry::respond: responding for key "
                 << std::uppercase << std::hex << key_ << " ("
@@ -577,40 +1212,70 @@ namespace El
                 << (inm ? inm : "");
         }
 
-        if(!etag_.empty())
-        {  
-          const char* inm =
-            request.in().headers().find(El::Net::HTTP::HD_IF_NONE_MATCH);
-          
-          if(inm && etag_ == inm)
-          {
-            request.out().send_header(El::Net::HTTP::HD_ETAG, inm);
-            send_cache_control(request);
-            
-            if(log)
-            {
-              *ostr << "\nNot modified; responded with " << HTTP_NOT_MODIFIED;
-              logger->debug(ostr->str(), LOG_ASPECT);
-            }
+        Body_var identity = body(V_IDENTITY);
+        Body_var gzip = body(V_GZIP);
+        
+        Variant variant =
+          gzip.in() && in.accept_encoding("gzip") ? V_GZIP : V_IDENTITY;
+
+        if(identity.in() == 0 || gzip.in() == 0)
+        {
+          schedule_encoding();
+        }
+
+        std::string etag = variant_etag(variant);
+        El::Apache::Request::Out& out = request.out();
+        
+        if(!etag.empty() && inm &&
+           (etag_match(inm, etag) || etag_match(inm, etag_)))
+        {
+          out.send_header(El::Net::HTTP::HD_ETAG, etag.c_str());
+          out.send_header(El::Net::HTTP::HD_VARY, "Accept-Encoding");
+          send_cache_control(request);
             
-            return HTTP_NOT_MODIFIED;
+          if(log)
+          {
+            *ostr << "\nNot modified; responded with " << HTTP_NOT_MODIFIED;
+            logger->debug(ostr->str(), LOG_ASPECT);
           }
+
+          cache_->served(key_, 0, 0);
+          return HTTP_NOT_MODIFIED;
         }
         
-        El::Apache::Request::Out& out = request.out();
-        
         if(content_type_)
         {
           out.content_type(content_type_);
         }
 
         bool do_cache_control = true;
+        bool do_vary = true;
         
-        for(El::Net::HTTP::HeaderList::const_iterator i(headers_.begin()),
-              e(headers_.end()); i != e; ++i)
+        for(size_t i = 0; i < headers_.size(); ++i)
         {
-          const char* name = i->name.c_str();
-          out.send_header(name, i->value.c_str());
+          El::Net::HTTP::FieldTable::Field field = headers_[i];
+          const char* name = field.name;
+
+          if(strcasecmp(name, El::Net::HTTP::HD_ETAG) == 0 && !etag.empty())
+          {
+            continue;
+          }
+
+          if(strcasecmp(name, El::Net::HTTP::HD_VARY) == 0)
+          {
+            do_vary = false;
+
+            if(strcasestr(field.value, "accept-encoding") == 0)
+            {
+              out.send_header(
+                name,
+                (std::string(field.value) + ", Accept-Encoding").c_str());
+
+              continue;
+            }
+          }
+          
+          out.send_header(name, field.value);
 
           if(strcasecmp(name, El::Net::HTTP::HD_CACHE_CONTROL) == 0)
           {
@@ -618,57 +1283,100 @@ namespace El
           }
         }
 
+        if(!etag.empty())
+        {
+          out.send_header(El::Net::HTTP::HD_ETAG, etag.c_str());
+        }
+        
+        if(do_vary)
+        {
+          out.send_header(El::Net::HTTP::HD_VARY, "Accept-Encoding");
+        }
+
         if(do_cache_control)
         {
           send_cache_control(request);
         }
+
+        size_t served = 0;
+        size_t saved = 0;
         
-        if(data_len_)
+        if(variant == V_GZIP)
         {
-          El::Apache::Request::In& in = request.in();
+          if(log)
+          {
+            *ostr << "\nWriting gzip-ed content";
+          }
+
+          served = gzip->size();
           
-          if(in.accept_encoding("gzip"))
+          if(identity.in() && identity->size() > served)
           {
-            if(log)
-            {
-              *ostr << "\nWriting gzip-ed content";
-            }
+            saved = identity->size() - served;
+          }
+          
+          out.send_header(El::Net::HTTP::HD_CONTENT_ENCODING, "gzip");
+
+          const SegmentList& segments = gzip->segments();
+          
+          for(SegmentList::const_iterator i(segments.begin()),
+                e(segments.end()); i != e; ++i)
+          {
+            out.write(i->buffer.in(), i->data, i->size);
+          }
+        }
+        else if(identity.in())
+        {
+          if(log)
+          {
+            *ostr << "\nWriting plain content";
+          }
             
-            out.send_header(El::Net::HTTP::HD_CONTENT_ENCODING, "gzip");  
-            out.stream().write((const char*)buff_, data_len_);
+          served = identity->size();
+          out.send_header(El::Net::HTTP::HD_CONTENT_ENCODING, "identity");
+
+          const SegmentList& segments = identity->segments();
+          
+          for(SegmentList::const_iterator i(segments.begin()),
+                e(segments.end()); i != e; ++i)
+          {
+            out.write(i->buffer.in(), i->data, i->size);
           }
-          else
+        }
+        else
+        {
+          if(log)
           {
-            if(log)
-            {
-              *ostr << "\nWriting plain content";
-            }
+            *ostr << "\nInflating content; identity variant is encoding";
+          }
             
-            out.send_header(El::Net::HTTP::HD_CONTENT_ENCODING, "identity");
+          out.send_header(El::Net::HTTP::HD_CONTENT_ENCODING, "identity");
             
-            GZippedDataReader reader(buff_, data_len_);
-            El::Compress::ZLib::GUnzip gunzip(&reader);
-            El::Compress::ZLib::InStream& istr = gunzip.stream();
-            std::ostream& ostr = out.stream();
+          BodyReader reader(gzip.in());
+          El::Compress::ZLib::GUnzip gunzip(&reader);
+          El::Compress::ZLib::InStream& istr = gunzip.stream();
+          std::ostream& body_ostr = out.stream();
             
-            char buff[1024];
+          char buff[4096];
             
-            while(true)
-            {
-              istr.read(buff, sizeof(buff));
-              size_t read_bytes = istr.gcount();
+          while(true)
+          {
+            istr.read(buff, sizeof(buff));
+            size_t read_bytes = istr.gcount();
 
-              if(read_bytes)
-              {
-                ostr.write(buff, read_bytes);
-              }
-              else
-              {
-                break;
-              }
+            if(read_bytes)
+            {
+              body_ostr.write(buff, read_bytes);
+              served += read_bytes;
+            }
+            else
+            {
+              break;
             }
           }
         }
+
+        cache_->served(key_, served, saved);
         
         if(log)
         {
@@ -19,20 +19,24 @@
 #include <string>
 #include <memory>
 #include <sstream>
-
-#include <ext/hash_map>
+#include <vector>
+#include <list>
 
 #include <ace/OS.h>
 #include <ace/Synch.h>
 #include <ace/Guard_T.h>
 
 #include <El/Exception.hpp>
+#include <El/ArrayPtr.hpp>
 #include <El/String/Manip.hpp>
 #include <El/Hash/Hash.hpp>
+#include <El/Hash/FlatMap.hpp>
 #include <El/RefCount/All.hpp>
 #include <El/SyncPolicy.hpp>
 #include <El/Logging/Logger.hpp>
+#include <El/Service/ThreadPool.hpp>
 
+#include <El/Net/HTTP/FieldTable.hpp>
 #include <El/Apache/Request.hpp>
 
 namespace El
@@ -90,18 +94,102 @@ namespace El
       };      
 
       struct ConditionMap :
-        public __gnu_cxx::hash_map<CondKey,CondValue,CondKeyHash>
+        public El::Hash::FlatMap<CondKey,CondValue,CondKeyHash>
       {
         bool request_cacheable(El::Apache::Request& request) const
           throw(El::Exception);
       };
 
       class Cache;
+
+      //
+      // Entry body is a sequence of references to immutable buffers, so
+      // response output buffers can be kept as is and cached data
+      // be passed to output filters without copying
+      //
+      struct Segment
+      {
+        El::Apache::SharedBuffer_var buffer;
+        const char* data;
+        size_t size;
+
+        Segment(El::Apache::SharedBuffer* buf, const char* dt, size_t sz)
+          throw();
+      };
+
+      typedef std::vector<Segment> SegmentList;
+
+      class Body :
+        public virtual El::RefCount::DefaultImpl<El::Sync::ThreadPolicy>
+      {
+      public:
+        Body() throw(El::Exception);
+        virtual ~Body() throw() {}
+
+        const SegmentList& segments() const throw() { return segments_; }
+        size_t size() const throw() { return size_; }
+
+        // Body is mapped from spill file, so takes no memory budget
+        bool spilled() const throw() { return spilled_; }
+        void spilled(bool val) throw() { spilled_ = val; }
+
+        void write(const char* buffer, size_t size) throw(El::Exception);
+
+        void add(El::Apache::SharedBuffer* buffer,
+                 const char* data,
+                 size_t size)
+          throw(El::Exception);
+
+        void clear() throw();
+
+        // Releases partially filled buffer
+        void close() throw();
+
+      private:
+        SegmentList segments_;
+        size_t size_;
+        El::Apache::SharedBuffer_var own_buffer_;
+        size_t own_buffer_used_;
+        bool spilled_;
+      };
+
+      typedef El::RefCount::SmartPtr<Body> Body_var;
+
+      class BodyWriter : public El::Compress::ZLib::OutStreamCallback
+      {
+      public:
+        BodyWriter(Body* body) throw() : body_(body) {}
+        virtual ~BodyWriter() throw() {}
+        
+        virtual size_t write(const char* buff, size_t len);
+
+      private:
+        Body* body_;
+      };
+      
+      class BodyReader : public El::Compress::ZLib::InStreamCallback
+      {
+      public:
+        BodyReader(const Body* body) throw();
+        virtual ~BodyReader() throw() {}
+        
+        virtual size_t read(char* buff, size_t len);
+        virtual void putback(char* buff, size_t len);
+
+      private:
+        const SegmentList& segments_;
+        size_t segment_;
+        size_t offset_;
+      };
       
+      //
+      // Entry keeps identity and gzip response variants. The one missing
+      // is produced by cache encoder thread on first demand, until that
+      // the existing variant is served.
+      //
       class Entry :
         virtual public El::RefCount::DefaultImpl<El::Sync::ThreadPolicy>,
-        virtual public El::Apache::Request::Callback,
-        virtual public El::Compress::ZLib::OutStreamCallback
+        virtual public El::Apache::Request::Callback
       {
       public:
         
@@ -128,10 +216,22 @@ namespace El
         void etag(const char* value) throw(El::Exception);
         const char* etag() const throw(El::Exception);
 
-        size_t data_len() const throw() { return data_len_; }
+        enum Variant
+        {
+          V_IDENTITY,
+          V_GZIP,
+          V_COUNT
+        };
+        
+        Body_var body(Variant variant) const throw();
         int result() const throw() { return result_; }
 
-        const El::Net::HTTP::HeaderList& headers() const throw();
+        uint64_t key() const throw() { return key_; }
+
+        // Total size of variant bodies
+        size_t memory_size() const throw();
+
+        const El::Net::HTTP::FieldTable& headers() const throw();
         
         static time_t time(time_t tm) throw();          
 
@@ -153,38 +253,35 @@ namespace El
         virtual void on_write(const char* buffer, size_t size)
           throw(El::Exception);
 
+        virtual void on_write_shared(El::Apache::SharedBuffer* buffer,
+                                     const char* data,
+                                     size_t size)
+          throw(El::Exception);
+
         virtual void pre_ap_rwrite() throw() {}
         virtual void post_ap_rwrite() throw() {}
         
         virtual void finalize(int result) throw(El::Exception);
-        
-        virtual size_t write(const char* buff, size_t len);
-        
-      private:
-        void write_buff(const char* buffer, size_t size) throw(El::Exception);
 
-      private:
+        // Produces missing variant; called by cache encoder thread
+        void encode() throw(El::Exception);
+
+        // Moves big bodies to disk; called by cache encoder thread
+        void spill() throw(El::Exception);
         
-        class GZippedDataReader : public El::Compress::ZLib::InStreamCallback
-        {
-        public:
-          GZippedDataReader(const unsigned char* buff, size_t data_len)
-            throw();
+      private:
+        bool etag_match(const char* inm, const std::string& etag) const
+          throw(El::Exception);
         
-          virtual size_t read(char* buff, size_t len);
-          virtual void putback(char* buff, size_t len);
-          virtual ~GZippedDataReader() throw() {}
+        std::string variant_etag(Variant variant) const throw(El::Exception);
 
-        private:
-          const unsigned char* ptr_;
-          const unsigned char* end_;
-        };
+        void schedule_encoding() const throw(El::Exception);
         
       private:
         uint64_t key_;
-        unsigned char* buff_;
-        size_t buff_len_;
-        size_t data_len_;
+        Variant variant_;
+        Body_var bodies_[V_COUNT];
+        mutable bool encoding_scheduled_;
         char* content_type_;
         int result_;
         time_t expire_;
@@ -192,9 +289,8 @@ namespace El
         time_t timeout_;
         time_t unused_timeout_;
         std::string etag_;
-        El::Net::HTTP::HeaderList headers_;
+        El::Net::HTTP::FieldTable headers_;
         Cache* cache_;
-        std::auto_ptr<El::Compress::ZLib::GZip> gzip_;
 
       private:
         Entry(const Entry&);
@@ -203,13 +299,96 @@ namespace El
       
       typedef El::RefCount::SmartPtr<Entry> Entry_var;
 
-      class Cache
+      //
+      // Count-min sketch of 4-bit saturating counters used as TinyLFU
+      // frequency estimator. Counters are halved after sample_size
+      // increments, so the estimate reflects recent popularity.
+      //
+      class FrequencySketch
       {
       public:
+        FrequencySketch(size_t width = 4096) throw(El::Exception);
+
+        void increment(uint64_t key) throw();
+        unsigned long estimate(uint64_t key) const throw();
+
+      private:
+        static const size_t DEPTH = 4;
+        static const unsigned char MAX_COUNT = 15;
+        
+        size_t index(uint64_t key, size_t row) const throw();
+        void age() throw();
+        
+      private:
+        std::vector<unsigned char> counters_;
+        size_t mask_;
+        size_t additions_;
+        size_t sample_size_;
+      };
+      
+      //
+      // Cache is split into shards each having its own lock, LRU list,
+      // frequency sketch and byte budget. New entry is admitted to a full
+      // shard only if its key is estimated more popular than LRU victim's.
+      //
+      class Cache : public El::Service::Callback
+      {
+      public:
+        struct Stat
+        {
+          // Requests served from cache
+          unsigned long long hits;
+
+          // Requests found no ready entry
+          unsigned long long misses;
+          
+          // Missing variants produced by encoder thread
+          unsigned long long encodings;
+
+          // Body bytes served from cache
+          unsigned long long bytes_served;
+
+          // Bytes saved by serving gzip variant instead of identity one
+          unsigned long long bytes_saved;
+
+          // Entries currently cached and their body bytes
+          unsigned long long entries;
+          unsigned long long bytes;
+
+          // Entries removed to fit memory budget
+          unsigned long long evictions;
+
+          // Entries not admitted by TinyLFU policy or being too big
+          unsigned long long rejections;
+          
+          // Entries removed as unused
+          unsigned long long expirations;
+
+          Stat() throw();
+
+          double hit_ratio() const throw();
+        };
+        
+      public:
+        //
+        // Bodies of spill_threshold bytes and bigger are moved by encoder
+        // thread into unlinked files in spill_dir and mmap-ed; 0 disables
+        // spilling.
+        // memory_budget is a total size limit of cached bodies kept in
+        // memory, 0 - unlimited.
+        // Each shard removes unused entries from its LRU tail not more
+        // often than once in entry_unused_check_period.
+        //
         Cache(time_t entry_timeout_delay,
               time_t entry_unused_check_period,
-              El::Logging::Logger* logger)
-          throw(El::Exception);
+              El::Logging::Logger* logger,
+              size_t spill_threshold = 0,
+              const char* spill_dir = 0,
+              size_t memory_budget = 0,
+              size_t shards = 16)
+          throw(Exception, El::Exception);
+
+        virtual ~Cache() throw();
         
         Entry* entry(El::Apache::Request& request,
                      CacheKeyType key_type,
@@ -219,24 +398,119 @@ namespace El
 
         void entry(Entry* val, uint64_t key) throw(El::Exception);
 
+        Stat stat() const throw();
+
       private:
+        friend class Entry;
+        
+        virtual bool notify(El::Service::Event* event) throw(El::Exception);
+
+        bool schedule_encoding(const Entry* entry) throw(El::Exception);
+        
+        bool schedule_spill(const Entry* entry, size_t size)
+          throw(El::Exception);
+        
+        void served(uint64_t key, size_t bytes, size_t saved) throw();
+        void encoded(const Entry* entry, uint64_t key, size_t size) throw();
+        void resized(const Entry* entry, uint64_t key, size_t size) throw();
+        
+        Body* spill(Body* body) throw(El::Exception);
+        
+      private:
+
+        class EncodeTask : public El::Service::ThreadPool::TaskBase
+        {
+        public:
+          EncodeTask(Cache* cache, const Entry* entry) throw(El::Exception);
+          virtual ~EncodeTask() throw() {}
+
+          virtual void execute() throw(El::Exception);
+
+        private:
+          Cache* cache_;
+          Entry_var entry_;
+        };
+
+        class SpillTask : public El::Service::ThreadPool::TaskBase
+        {
+        public:
+          SpillTask(const Entry* entry) throw(El::Exception);
+          virtual ~SpillTask() throw() {}
+
+          virtual void execute() throw(El::Exception);
+
+        private:
+          Entry_var entry_;
+        };
+
+        struct Node
+        {
+          uint64_t key;
+          Entry_var entry;
+          size_t size;
+
+          Node(uint64_t k, Entry* e, size_t sz) throw();
+        };
+
+        // Most recently used in front
+        typedef std::list<Node> NodeList;
+        
+        typedef El::Hash::FlatMap<uint64_t,
+                                  NodeList::iterator,
+                                  El::Hash::Numeric<uint64_t> >
+        NodeMap;
 
-        typedef __gnu_cxx::hash_map<uint64_t,
-                                    Entry_var,
-                                    El::Hash::Numeric<uint64_t> >
-        CacheMap;
+        typedef ACE_Thread_Mutex Mutex;
+        typedef ACE_Guard<Mutex> Guard;
 
-        typedef ACE_RW_Thread_Mutex    Mutex;
-        typedef ACE_Read_Guard<Mutex>  ReadGuard;
-        typedef ACE_Write_Guard<Mutex> WriteGuard;
+        struct Shard
+        {
+          Mutex lock;
+          NodeList lru;
+          NodeMap map;
+          FrequencySketch sketch;
+          size_t bytes;
+          time_t next_unused_check;
+
+          // Updated by respond without shard lock, so atomically
+          unsigned long long hits;
+          unsigned long long bytes_served;
+          unsigned long long bytes_saved;
+
+          // Updated under shard lock
+          unsigned long long misses;
+          unsigned long long encodings;
+          unsigned long long evictions;
+          unsigned long long rejections;
+          unsigned long long expirations;
+
+          Shard() throw(El::Exception);
+        };
 
-        Mutex lock_;
+        Shard& shard(uint64_t key) const throw();
+
+        void remove(Shard& shard, NodeList::iterator it) throw();
+        
+        void check_unused(Shard& shard, time_t now, std::ostream* log)
+          throw(El::Exception);
+        
+        bool fit(Shard& shard,
+                 uint64_t key,
+                 size_t size,
+                 bool admit,
+                 std::ostream* log)
+          throw(El::Exception);
+        
         time_t entry_timeout_delay_;
         time_t entry_unused_check_period_;
-        time_t unused_entry_next_check_;
-        
-        CacheMap cache_map_;
         El::Logging::Logger* logger_;
+
+        size_t spill_threshold_;
+        std::string spill_dir_;
+        size_t shard_budget_;
+        size_t shard_count_;
+        El::ArrayPtr<Shard> shards_;
+        El::Service::ThreadPool_var encoder_;
       };
     };
     
@@ -260,7 +534,7 @@ namespace El
       size_t
       CondKeyHash::operator()(const CondKey& val) const throw()
       {
-        return __gnu_cxx::__stl_hash_string(val.value.c_str());
+        return El::Hash::hash64(val.value.data(), val.value.length());
       }
 
       //
@@ -277,7 +551,7 @@ namespace El
       // Entry struct
       //
       inline
-      const El::Net::HTTP::HeaderList&
+      const El::Net::HTTP::FieldTable&
       Entry::headers() const throw()
       {
         return headers_;
@@ -357,34 +631,268 @@ namespace El
         return etag_.c_str();
       }
 
+      inline
+      Body_var
+      Entry::body(Variant variant) const throw()
+      {
+        ReadGuard_ guard(lock_);
+        return bodies_[variant];
+      }
+      
+      inline
+      size_t
+      Entry::memory_size() const throw()
+      {
+        ReadGuard_ guard(lock_);
+
+        size_t size = 0;
+        
+        for(size_t i = 0; i < V_COUNT; ++i)
+        {
+          if(bodies_[i].in() && !bodies_[i]->spilled())
+          {
+            size += bodies_[i]->size();
+          }
+        }
+
+        return size;
+      }
+      
       //
-      // Entry::GZippedDataReader class
+      // Segment struct
       //
       inline
-      Entry::GZippedDataReader::GZippedDataReader(const unsigned char* buff,
-                                                  size_t data_len)
+      Segment::Segment(El::Apache::SharedBuffer* buf,
+                       const char* dt,
+                       size_t sz)
         throw()
-          : ptr_(buff),
-            end_(buff + data_len)
+          : buffer(El::RefCount::add_ref(buf)),
+            data(dt),
+            size(sz)
+      {
+      }
+
+      //
+      // Body class
+      //
+      inline
+      Body::Body() throw(El::Exception)
+          : size_(0),
+            own_buffer_used_(0),
+            spilled_(false)
+      {
+      }
+
+      inline
+      void
+      Body::close() throw()
+      {
+        own_buffer_ = 0;
+        own_buffer_used_ = 0;
+      }
+      
+      inline
+      void
+      Body::clear() throw()
+      {
+        close();
+        segments_.clear();
+        size_ = 0;
+      }
+      
+      //
+      // BodyWriter class
+      //
+      inline
+      size_t
+      BodyWriter::write(const char* buff, size_t len)
+      {
+        body_->write(buff, len);
+        return len;
+      }
+      
+      //
+      // BodyReader class
+      //
+      inline
+      BodyReader::BodyReader(const Body* body) throw()
+          : segments_(body->segments()),
+            segment_(0),
+            offset_(0)
       {
       }
       
       inline  
       size_t
-      Entry::GZippedDataReader::read(char* buff, size_t len)
+      BodyReader::read(char* buff, size_t len)
       {
-        size_t read_bytes = std::min(len, (size_t)(end_ - ptr_));
-        memcpy(buff, ptr_, read_bytes);
-        ptr_ += read_bytes;
+        size_t read_bytes = 0;
+        
+        while(len && segment_ < segments_.size())
+        {
+          const Segment& segment = segments_[segment_];
+          size_t bytes = std::min(len, segment.size - offset_);
+          
+          memcpy(buff, segment.data + offset_, bytes);
+
+          buff += bytes;
+          len -= bytes;
+          read_bytes += bytes;
+          offset_ += bytes;
+
+          if(offset_ == segment.size)
+          {
+            ++segment_;
+            offset_ = 0;
+          }
+        }
+        
         return read_bytes;
       }      
         
       inline  
       void
-      Entry::GZippedDataReader::putback(char* buff, size_t len)
+      BodyReader::putback(char* buff, size_t len)
       {
-        ptr_ -= len;
-      }      
+        while(len)
+        {
+          if(offset_ == 0)
+          {
+            offset_ = segments_[--segment_].size;
+          }
+
+          size_t bytes = std::min(len, offset_);
+          offset_ -= bytes;
+          len -= bytes;
+        }
+      }
+
+      //
+      // FrequencySketch class
+      //
+      inline
+      size_t
+      FrequencySketch::index(uint64_t key, size_t row) const throw()
+      {
+        return (row * (mask_ + 1)) + (El::Hash::mix64(key, row) & mask_);
+      }
+
+      inline
+      void
+      FrequencySketch::increment(uint64_t key) throw()
+      {
+        unsigned long min = estimate(key);
+
+        if(min < MAX_COUNT)
+        {
+          // Conservative update: only minimal counters incremented
+          
+          for(size_t i = 0; i < DEPTH; ++i)
+          {
+            unsigned char& counter = counters_[index(key, i)];
+
+            if(counter == min)
+            {
+              ++counter;
+            }
+          }
+        }
+
+        if(++additions_ >= sample_size_)
+        {
+          age();
+        }
+      }
+
+      inline
+      unsigned long
+      FrequencySketch::estimate(uint64_t key) const throw()
+      {
+        unsigned long min = MAX_COUNT;
+        
+        for(size_t i = 0; i < DEPTH; ++i)
+        {
+          min = std::min(min, (unsigned long)counters_[index(key, i)]);
+        }
+
+        return min;
+      }
+      
+      //
+      // Cache::Stat struct
+      //
+      inline
+      Cache::Stat::Stat() throw()
+          : hits(0),
+            misses(0),
+            encodings(0),
+            bytes_served(0),
+            bytes_saved(0),
+            entries(0),
+            bytes(0),
+            evictions(0),
+            rejections(0),
+            expirations(0)
+      {
+      }
+
+      inline
+      double
+      Cache::Stat::hit_ratio() const throw()
+      {
+        unsigned long long requests = hits + misses;
+        return requests ? (double)hits / requests : 0;
+      }
+
+      //
+      // Cache::Node struct
+      //
+      inline
+      Cache::Node::Node(uint64_t k, Entry* e, size_t sz) throw()
+          : key(k),
+            entry(El::RefCount::add_ref(e)),
+            size(sz)
+      {
+      }
+      
+      //
+      // Cache::Shard struct
+      //
+      inline
+      Cache::Shard::Shard() throw(El::Exception)
+          : bytes(0),
+            next_unused_check(0),
+            hits(0),
+            bytes_served(0),
+            bytes_saved(0),
+            misses(0),
+            encodings(0),
+            evictions(0),
+            rejections(0),
+            expirations(0)
+      {
+      }
+      
+      //
+      // Cache class
+      //
+      inline
+      Cache::Shard&
+      Cache::shard(uint64_t key) const throw()
+      {
+        return shards_[(key ^ (key >> 32)) % shard_count_];
+      }
+      
+      inline
+      void
+      Cache::served(uint64_t key, size_t bytes, size_t saved) throw()
+      {
+        Shard& sh = shard(key);
+        
+        __atomic_fetch_add(&sh.hits, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&sh.bytes_served, bytes, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&sh.bytes_saved, saved, __ATOMIC_RELAXED);
+      }
     }
   }
 }
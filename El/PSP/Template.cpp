@@ -81,7 +81,7 @@ namespace El
                                          hash_b64);
         
         const char* current_etag =
-          request.in().headers().find(El::Net::HTTP::HD_IF_NONE_MATCH);
+          request.in().header_table().find(El::Net::HTTP::HD_IF_NONE_MATCH);
         
         request.out().send_header(El::Net::HTTP::HD_ETAG, hash_b64.c_str());
 
@@ -144,20 +144,20 @@ namespace El
       else if(strncmp(var_name, "browser", 7) == 0)
       {
         const char* ua =
-          request_.in().headers().find(El::Net::HTTP::HD_USER_AGENT);
+          request_.in().header_table().find(El::Net::HTTP::HD_USER_AGENT);
         
         return encode(El::Net::HTTP::browser(ua), output, chunk);
       }
       else if(strncmp(var_name, "os", 2) == 0)
       {
         const char* ua =
-          request_.in().headers().find(El::Net::HTTP::HD_USER_AGENT);
+          request_.in().header_table().find(El::Net::HTTP::HD_USER_AGENT);
         
         return encode(El::Net::HTTP::os(ua), output, chunk);
       }
       else if(strncmp(var_name, "header ", 7) == 0)
       {
-        return encode(request_.in().headers().find(var_name + 7),
+        return encode(request_.in().header_table().find(var_name + 7),
                       output,
                       chunk);
       }
@@ -70,7 +70,10 @@ namespace El
     }
     
     void
-    Code::compile(const char* text, const char* name)
+    Code::compile(const char* text,
+                  const char* name,
+                  const CodeStore* store,
+                  uint64_t text_crc)
       throw(InvalidArg, Exception, El::Exception)
     {
       clear();
@@ -88,6 +91,24 @@ namespace El
         name_ = name && *name != '\0' ? name : "<no name>";
 
         set_global_dict();
+
+        if(store)
+        {
+          try
+          {
+            code_ = store->load(name_.c_str(), text_crc);
+          }
+          catch(const El::Exception&)
+          {
+            // Broken entry will be overwritten with one saved below
+            PyErr_Clear();
+          }
+
+          if(code_.in())
+          {
+            return;
+          }
+        }
         
         code_ = (PyCodeObject*)Py_CompileString(text_.c_str(),
                                                 name_.c_str(),
@@ -102,6 +123,19 @@ namespace El
           handle_error("El::Python::Code::compile: Py_CompileString failed",
                        ostr.str().c_str());
         }
+
+        if(store)
+        {
+          try
+          {
+            store->save(name_.c_str(), text_crc, code_.in());
+          }
+          catch(const El::Exception&)
+          {
+            // Read-only store is fine; code is stored at deploy time then
+            PyErr_Clear();
+          }
+        }
       }
       catch(...)
       {
@@ -25,6 +25,7 @@
 #include <El/Python/Utility.hpp>
 #include <El/Python/RefCount.hpp>
 #include <El/Python/Sandbox.hpp>
+#include <El/Python/CodeStore.hpp>
 
 namespace El
 {
@@ -45,8 +46,15 @@ namespace El
 
       Code& operator=(const Code& src) throw(El::Exception);
 
+      //
+      // If store specified, code is taken from it when stored for text
+      // CRC provided, otherwise compiled code is saved into it. Store
+      // errors are not propagated; code is just compiled then.
+      //
       void compile(const char* text,
-                   const char* name = 0)
+                   const char* name = 0,
+                   const CodeStore* store = 0,
+                   uint64_t text_crc = 0)
         throw(InvalidArg, Exception, El::Exception);
 
       PyObject* run(PyObject* global_dictionary = 0,
@@ -0,0 +1,319 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Python/CodeStore.cpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#include <Python.h>
+#include <marshal.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <string>
+#include <sstream>
+#include <vector>
+
+#include <El/Exception.hpp>
+#include <El/IO.hpp>
+#include <El/Hash/Hash64.hpp>
+
+#include <El/Python/Object.hpp>
+#include <El/Python/Utility.hpp>
+
+#include "CodeStore.hpp"
+
+namespace
+{
+  //
+  // Read-only mapping of entry file
+  //
+  struct Mapping
+  {
+    void* data;
+    size_t size;
+
+    Mapping() throw() : data(MAP_FAILED), size(0) {}
+
+    ~Mapping() throw()
+    {
+      if(data != MAP_FAILED)
+      {
+        munmap(data, size);
+      }
+    }
+  };
+
+  bool
+  write_all(int fd, const void* data, size_t size) throw()
+  {
+    for(const char* ptr = (const char*)data, *end = ptr + size; ptr < end; )
+    {
+      ssize_t written = El::write(fd, ptr, end - ptr);
+
+      if(written <= 0)
+      {
+        return false;
+      }
+
+      ptr += written;
+    }
+
+    return true;
+  }
+}
+
+namespace El
+{
+  namespace Python
+  {
+    const char CodeStore::SIGNATURE[8] =
+    {
+      'E', 'L', 'P', 'Y', 'C', 'O', 'D', 'E'
+    };
+
+    CodeStore::CodeStore(const char* directory)
+      throw(InvalidArg, El::Exception)
+        : directory_(directory ? directory : "")
+    {
+      size_t len = directory_.length();
+
+      if(len > 1 && directory_[len - 1] == '/')
+      {
+        directory_.resize(len - 1);
+      }
+
+      struct stat st;
+
+      if(directory_.empty() || stat(directory_.c_str(), &st) != 0 ||
+         !S_ISDIR(st.st_mode))
+      {
+        std::ostringstream ostr;
+        ostr << "El::Python::CodeStore::CodeStore: '" << directory_
+             << "' is not a directory";
+
+        throw InvalidArg(ostr.str());
+      }
+    }
+
+    std::string
+    CodeStore::path(const char* name) const throw(El::Exception)
+    {
+      // Not seeded to be same for all processes
+      uint64_t hash = El::Hash::hash64(name, strlen(name));
+
+      char buff[17];
+      snprintf(buff, sizeof(buff), "%016llx", (unsigned long long)hash);
+
+      std::string result(directory_);
+      result += "/";
+      result += buff;
+      result += ".elc";
+
+      return result;
+    }
+
+    PyCodeObject*
+    CodeStore::load(const char* name, uint64_t text_crc) const
+      throw(Exception, El::Exception)
+    {
+      std::string file = path(name);
+      int fd = open(file.c_str(), O_RDONLY);
+
+      if(fd < 0)
+      {
+        int error = errno;
+
+        if(error == ENOENT)
+        {
+          return 0;
+        }
+
+        std::ostringstream ostr;
+        ostr << "El::Python::CodeStore::load: open failed for " << file
+             << ". Errno " << error << ", description:\n" << strerror(error);
+
+        throw Exception(ostr.str());
+      }
+
+      Mapping mapping;
+      struct stat st;
+
+      if(fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(Header))
+      {
+        mapping.size = st.st_size;
+        mapping.data = mmap(0, mapping.size, PROT_READ, MAP_SHARED, fd, 0);
+      }
+
+      int error = errno;
+      close(fd);
+
+      if(mapping.data == MAP_FAILED)
+      {
+        std::ostringstream ostr;
+        ostr << "El::Python::CodeStore::load: can't map " << file;
+
+        if(mapping.size)
+        {
+          ostr << ". Errno " << error << ", description:\n"
+               << strerror(error);
+        }
+        else
+        {
+          ostr << "; file is truncated";
+        }
+
+        throw Exception(ostr.str());
+      }
+
+      const char* data = (const char*)mapping.data;
+
+      Header header;
+      memcpy(&header, data, sizeof(header));
+
+      if(memcmp(header.signature, SIGNATURE, sizeof(SIGNATURE)) ||
+         header.format != FORMAT ||
+         sizeof(header) + header.name_length + header.code_size !=
+         mapping.size)
+      {
+        std::ostringstream ostr;
+        ostr << "El::Python::CodeStore::load: " << file
+             << " is not a valid entry";
+
+        throw Exception(ostr.str());
+      }
+
+      size_t name_len = strlen(name);
+      data += sizeof(header);
+
+      if(header.python_magic != (uint32_t)PyImport_GetMagicNumber() ||
+         header.text_crc != text_crc || header.name_length != name_len ||
+         memcmp(data, name, name_len))
+      {
+        // Stale entry or entry of other code with same name hash
+        return 0;
+      }
+
+      data += name_len;
+
+      Object_var code =
+        PyMarshal_ReadObjectFromString((char*)data, header.code_size);
+
+      if(code.in() == 0)
+      {
+        std::ostringstream ostr;
+        ostr << "; file " << file;
+
+        handle_error(
+          "El::Python::CodeStore::load: PyMarshal_ReadObjectFromString "
+          "failed",
+          ostr.str().c_str());
+      }
+
+      if(!PyCode_Check(code.in()))
+      {
+        std::ostringstream ostr;
+        ostr << "El::Python::CodeStore::load: unexpected object type in "
+             << file;
+
+        throw Exception(ostr.str());
+      }
+
+      return (PyCodeObject*)code.retn();
+    }
+
+    void
+    CodeStore::save(const char* name, uint64_t text_crc, PyCodeObject* code)
+      const throw(Exception, El::Exception)
+    {
+      Object_var marshalled =
+        PyMarshal_WriteObjectToString((PyObject*)code, Py_MARSHAL_VERSION);
+
+      if(marshalled.in() == 0)
+      {
+        handle_error(
+          "El::Python::CodeStore::save: PyMarshal_WriteObjectToString failed");
+      }
+
+      size_t code_size = 0;
+
+      const char* code_data =
+        string_from_string(marshalled.in(),
+                           code_size,
+                           "El::Python::CodeStore::save");
+
+      size_t name_len = strlen(name);
+
+      Header header;
+      memset(&header, 0, sizeof(header));
+      memcpy(header.signature, SIGNATURE, sizeof(SIGNATURE));
+      header.format = FORMAT;
+      header.python_magic = PyImport_GetMagicNumber();
+      header.text_crc = text_crc;
+      header.name_length = name_len;
+      header.code_size = code_size;
+
+      std::string file = path(name);
+      std::string tmp = file + ".XXXXXX";
+      std::vector<char> tmp_path(tmp.c_str(), tmp.c_str() + tmp.length() + 1);
+
+      int fd = mkstemp(&tmp_path[0]);
+
+      if(fd < 0)
+      {
+        int error = errno;
+
+        std::ostringstream ostr;
+        ostr << "El::Python::CodeStore::save: mkstemp failed for "
+             << &tmp_path[0] << ". Errno " << error << ", description:\n"
+             << strerror(error);
+
+        throw Exception(ostr.str());
+      }
+
+      // Store can be populated by user other than one server runs as
+      bool success = fchmod(fd, 0644) == 0 &&
+        write_all(fd, &header, sizeof(header)) &&
+        write_all(fd, name, name_len) &&
+        write_all(fd, code_data, code_size);
+
+      int error = errno;
+
+      if(close(fd) != 0 && success)
+      {
+        success = false;
+        error = errno;
+      }
+
+      if(success && rename(&tmp_path[0], file.c_str()) != 0)
+      {
+        success = false;
+        error = errno;
+      }
+
+      if(!success)
+      {
+        unlink(&tmp_path[0]);
+
+        std::ostringstream ostr;
+        ostr << "El::Python::CodeStore::save: failed to write " << file
+             << ". Errno " << error << ", description:\n" << strerror(error);
+
+        throw Exception(ostr.str());
+      }
+    }
+  }
+}
@@ -0,0 +1,83 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Python/CodeStore.hpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#ifndef _ELEMENTS_EL_PYTHON_CODESTORE_HPP_
+#define _ELEMENTS_EL_PYTHON_CODESTORE_HPP_
+
+#include <Python.h>
+#include <stdint.h>
+
+#include <string>
+
+#include <El/Exception.hpp>
+
+#include <El/Python/Exception.hpp>
+#include <El/Python/RefCount.hpp>
+
+namespace El
+{
+  namespace Python
+  {
+    //
+    // Directory of marshalled code objects shared by processes, so code
+    // compiled once (by any process or ahead of time) is not compiled
+    // again. Entry is kept per code name and is valid only for source
+    // text of the CRC and the interpreter version it was compiled for.
+    //
+    // Entry file is fixed size header followed by the code name and
+    // the marshalled code; it is mmap-ed and unmarshalled in place.
+    // Entries are written into temporary files renamed over the old ones,
+    // so readers never see a partially written entry.
+    //
+    class CodeStore
+    {
+    public:
+      CodeStore(const char* directory) throw(InvalidArg, El::Exception);
+
+      //
+      // Returns code compiled from text with CRC specified or 0 if not
+      // stored. Throws if entry is unreadable.
+      //
+      PyCodeObject* load(const char* name, uint64_t text_crc) const
+        throw(Exception, El::Exception);
+
+      void save(const char* name, uint64_t text_crc, PyCodeObject* code)
+        const throw(Exception, El::Exception);
+
+      // Entry file path for the code name
+      std::string path(const char* name) const throw(El::Exception);
+
+      const char* directory() const throw() { return directory_.c_str(); }
+
+    private:
+      struct Header
+      {
+        char signature[8];
+        uint32_t format;
+        uint32_t python_magic;
+        uint64_t text_crc;
+        uint32_t name_length;
+        uint32_t code_size;
+      };
+
+      enum { FORMAT = 1 };
+
+      static const char SIGNATURE[8];
+
+    private:
+      std::string directory_;
+    };
+  }
+}
+
+#endif // _ELEMENTS_EL_PYTHON_CODESTORE_HPP_
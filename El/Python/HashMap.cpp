@@ -0,0 +1,505 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Python/HashMap.cpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#include <Python.h>
+
+#include <sstream>
+#include <algorithm>
+
+#include <El/Python/Utility.hpp>
+#include <El/Python/RefCount.hpp>
+
+#include "HashMap.hpp"
+
+namespace El
+{
+  namespace Python
+  {
+    HashMap::Type HashMap::Type::instance;
+
+    //
+    // El::Python::HashMap class
+    //
+    HashMap::HashMap(PyTypeObject *type, PyObject *args, PyObject *kwds)
+      throw(El::Exception)
+        : ObjectImpl(type ? type : &Type::instance),
+          size_(0),
+          version_(0)
+    {
+    }
+
+    HashMap::~HashMap() throw()
+    {
+      clear();
+    }
+
+    size_t
+    HashMap::lookup(PyObject* key, long hs) const
+      throw(Exception, El::Exception)
+    {
+      while(true)
+      {
+        size_t mask = index_.size() - 1;
+        size_t slot = hs & mask;
+        bool changed = false;
+
+        for(uint32_t entry = index_[slot]; entry;
+            slot = (slot + 1) & mask, entry = index_[slot])
+        {
+          const Entry& e = entries_[entry - 1];
+
+          if(e.key == 0 || e.hash != hs)
+          {
+            continue;
+          }
+
+          if(plain_compare(e.key, key))
+          {
+            if(equal(e.key, key))
+            {
+              break;
+            }
+
+            continue;
+          }
+
+          // Entry key is held as __eq__ can erase it
+          Object_var entry_key = add_ref(e.key);
+          unsigned long version = version_;
+
+          bool eq = equal(entry_key.in(), key);
+
+          // Released before the check as can run __del__
+          entry_key = 0;
+
+          if(version != version_)
+          {
+            changed = true;
+            break;
+          }
+
+          if(eq)
+          {
+            break;
+          }
+        }
+
+        if(!changed)
+        {
+          return slot;
+        }
+      }
+    }
+
+    PyObject*
+    HashMap::find(PyObject* key) const throw(Exception, El::Exception)
+    {
+      if(size_ == 0)
+      {
+        return 0;
+      }
+
+      uint32_t entry = index_[lookup(key, hash(key))];
+      return entry ? entries_[entry - 1].value : 0;
+    }
+
+    void
+    HashMap::insert(PyObject* key, PyObject* value)
+      throw(Exception, El::Exception)
+    {
+      long hs = hash(key);
+      size_t slot = 0;
+
+      while(true)
+      {
+        if(!index_.empty())
+        {
+          slot = lookup(key, hs);
+
+          if(index_[slot])
+          {
+            Entry& entry = entries_[index_[slot] - 1];
+            Object_var old = entry.value;
+            entry.value = add_ref(value);
+            return;
+          }
+        }
+
+        // Load factor, erased entries counted, is kept under 1/2
+        if((entries_.size() + 1) * 2 <= index_.size())
+        {
+          break;
+        }
+
+        // Looked up again as key comparison can change the map
+        rehash(size_ + 1);
+      }
+
+      Entry entry;
+      entry.key = key;
+      entry.value = value;
+      entry.hash = hs;
+
+      entries_.push_back(entry);
+
+      Py_INCREF(key);
+      Py_INCREF(value);
+
+      index_[slot] = entries_.size();
+      ++size_;
+      ++version_;
+    }
+
+    bool
+    HashMap::erase(PyObject* key) throw(Exception, El::Exception)
+    {
+      if(size_ == 0)
+      {
+        return false;
+      }
+
+      uint32_t index = index_[lookup(key, hash(key))];
+
+      if(index == 0)
+      {
+        return false;
+      }
+
+      Entry& entry = entries_[index - 1];
+
+      // Released when map is consistent as destructors can access it
+      Object_var old_key = entry.key;
+      Object_var old_value = entry.value;
+
+      entry.key = 0;
+      entry.value = 0;
+      ++version_;
+
+      size_t erased = entries_.size() - --size_;
+
+      if(erased > size_ && erased > MIN_INDEX_SIZE)
+      {
+        rehash(size_);
+      }
+
+      return true;
+    }
+
+    void
+    HashMap::clear() throw()
+    {
+      EntryArray entries;
+      entries.swap(entries_);
+
+      if(!index_.empty())
+      {
+        memset(&index_[0], 0, index_.size() * sizeof(index_[0]));
+      }
+
+      size_ = 0;
+      ++version_;
+
+      for(EntryArray::iterator it(entries.begin()), ie(entries.end());
+          it != ie; ++it)
+      {
+        Py_XDECREF(it->key);
+        Py_XDECREF(it->value);
+      }
+    }
+
+    void
+    HashMap::reserve(size_t size) throw(El::Exception)
+    {
+      entries_.reserve(size);
+
+      if(size * 2 > index_.size())
+      {
+        rehash(size);
+      }
+    }
+
+    void
+    HashMap::rehash(size_t entries) throw(El::Exception)
+    {
+      size_t index_size = MIN_INDEX_SIZE;
+      for(; index_size < entries * 4; index_size *= 2);
+
+      Index index(index_size, 0);
+
+      EntryArray::iterator dst = entries_.begin();
+
+      for(EntryArray::iterator it(entries_.begin()), ie(entries_.end());
+          it != ie; ++it)
+      {
+        if(it->key)
+        {
+          *dst++ = *it;
+        }
+      }
+
+      entries_.erase(dst, entries_.end());
+
+      size_t mask = index_size - 1;
+
+      for(size_t i = 0; i < entries_.size(); ++i)
+      {
+        size_t slot = entries_[i].hash & mask;
+        for(; index[slot]; slot = (slot + 1) & mask);
+
+        index[slot] = i + 1;
+      }
+
+      index_.swap(index);
+      ++version_;
+    }
+
+    void
+    HashMap::write(El::BinaryOutStream& bstr) const throw(El::Exception)
+    {
+      bstr << (uint64_t)size_;
+
+      for(const_iterator it(begin()), ie(end()); it != ie; ++it)
+      {
+        write_object(bstr, it.key());
+        write_object(bstr, it.value());
+      }
+    }
+
+    void
+    HashMap::read(El::BinaryInStream& bstr) throw(El::Exception)
+    {
+      clear();
+
+      uint64_t size = 0;
+      bstr >> size;
+
+      reserve(std::min(size, (uint64_t)MAX_READ_RESERVE));
+
+      for(uint64_t i = 0; i < size; ++i)
+      {
+        Object_var key = read_object(bstr, true);
+        Object_var value = read_object(bstr, false);
+
+        insert(key.in(), value.in());
+      }
+    }
+
+    void
+    HashMap::write_object(El::BinaryOutStream& bstr, PyObject* obj)
+      throw(El::Exception)
+    {
+      if(PyString_CheckExact(obj))
+      {
+        uint32_t len = PyString_GET_SIZE(obj);
+
+        bstr << (uint8_t)OT_STRING << len;
+        bstr.write_raw_bytes((const unsigned char*)PyString_AS_STRING(obj),
+                             len);
+      }
+      else if(PyInt_CheckExact(obj))
+      {
+        bstr << (uint8_t)OT_INT << (int64_t)PyInt_AS_LONG(obj);
+      }
+      else
+      {
+        bstr << (uint8_t)OT_OBJECT << obj;
+      }
+    }
+
+    PyObject*
+    HashMap::read_object(El::BinaryInStream& bstr, bool intern)
+      throw(El::Exception)
+    {
+      uint8_t tag = 0;
+      bstr >> tag;
+
+      switch(tag)
+      {
+      case OT_STRING:
+        {
+          uint32_t len = 0;
+          bstr >> len;
+
+          Object_var str = PyString_FromStringAndSize(0, len);
+
+          if(str.in() == 0)
+          {
+            handle_error("El::Python::HashMap::read_object: "
+                         "PyString_FromStringAndSize failed");
+          }
+
+          bstr.read_raw_bytes((unsigned char*)PyString_AS_STRING(str.in()),
+                              len);
+
+          PyObject* res = str.retn();
+
+          if(intern)
+          {
+            // Makes lookups by string literals of Python code, which are
+            // interned as well, be resolved by pointer comparison
+            PyString_InternInPlace(&res);
+          }
+
+          return res;
+        }
+      case OT_INT:
+        {
+          int64_t val = 0;
+          bstr >> val;
+
+          PyObject* res = PyInt_FromLong(val);
+
+          if(res == 0)
+          {
+            handle_error(
+              "El::Python::HashMap::read_object: PyInt_FromLong failed");
+          }
+
+          return res;
+        }
+      case OT_OBJECT:
+        {
+          Object_var obj;
+          bstr >> obj;
+          return obj.retn();
+        }
+      }
+
+      std::ostringstream ostr;
+      ostr << "El::Python::HashMap::read_object: unexpected object tag "
+           << (unsigned long)tag;
+
+      throw Exception(ostr.str());
+    }
+
+    PyObject*
+    HashMap::py_size() throw(El::Exception)
+    {
+      return Py_BuildValue("k", size_);
+    }
+
+    PyObject*
+    HashMap::py_keys() throw(El::Exception)
+    {
+      El::Python::Object_var list = PyList_New(size_);
+
+      if(list.in() == 0)
+      {
+        return 0;
+      }
+
+      size_t i = 0;
+
+      for(const_iterator it(begin()), ie(end()); it != ie; ++it, ++i)
+      {
+        PyObject* key = it.key();
+        Py_INCREF(key);
+        PyList_SET_ITEM(list.in(), i, key);
+      }
+
+      return list.retn();
+    }
+
+    PyObject*
+    HashMap::py_sorted_keys() throw(El::Exception)
+    {
+      El::Python::Object_var list = py_keys();
+
+      if(list.in() == 0 || PyList_Sort(list.in()) < 0)
+      {
+        return 0;
+      }
+
+      return list.retn();
+    }
+
+    //
+    // El::Python::HashMap::Type class
+    //
+    HashMap::Type::Type()
+      throw(El::Python::Exception, El::Exception)
+        : El::Python::ObjectTypeImpl<HashMap, HashMap::Type>(
+          "el.HashMap", "Hash table based associative container")
+    {
+      memset(&map_methods_, 0, sizeof(map_methods_));
+
+      map_methods_.mp_length = &mp_length;
+      map_methods_.mp_subscript = &mp_subscript;
+      map_methods_.mp_ass_subscript = &mp_ass_subscript;
+
+      tp_as_mapping = &map_methods_;
+    }
+
+    Py_ssize_t
+    HashMap::Type::mp_length(PyObject* m)
+    {
+      return static_cast<HashMap*>(m)->size();
+    }
+
+    PyObject*
+    HashMap::Type::mp_subscript(PyObject* m, PyObject* k)
+    {
+      try
+      {
+        PyObject* value = static_cast<HashMap*>(m)->find(k);
+
+        if(value == 0)
+        {
+          set_key_error("non-existing key provided");
+          return 0;
+        }
+
+        Py_INCREF(value);
+        return value;
+      }
+      catch(El::Exception& e)
+      {
+        set_error(e);
+      }
+
+      return 0;
+    }
+
+    int
+    HashMap::Type::mp_ass_subscript(PyObject* m, PyObject* k, PyObject* v)
+    {
+      HashMap& mp = *static_cast<HashMap*>(m);
+
+      if(mp.is_constant())
+      {
+        set_runtime_error("el.HashMap assign failed as object is constant");
+        return -1;
+      }
+
+      try
+      {
+        if(v == 0)
+        {
+          mp.erase(k);
+        }
+        else
+        {
+          mp.insert(k, v);
+        }
+
+        return 0;
+      }
+      catch(El::Exception& e)
+      {
+        set_error(e);
+      }
+
+      return -1;
+    }
+  }
+}
@@ -0,0 +1,368 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Python/HashMap.hpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#ifndef _ELEMENTS_EL_PYTHON_HASHMAP_HPP_
+#define _ELEMENTS_EL_PYTHON_HASHMAP_HPP_
+
+#include <Python.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#include <El/Exception.hpp>
+#include <El/BinaryStream.hpp>
+
+#include <El/Python/Exception.hpp>
+#include <El/Python/RefCount.hpp>
+#include <El/Python/Object.hpp>
+#include <El/Python/Utility.hpp>
+
+namespace El
+{
+  namespace Python
+  {
+    //
+    // Associative container with the same interface for Python code as
+    // el.Map has, but implemented as a hash table. Key hashes are
+    // computed once and kept with entries, str and int keys are hashed
+    // and compared without going through generic object protocol.
+    // Iteration goes in insertion order; el.Map is to be used where keys
+    // are required to be iterated in sorted order.
+    //
+    class HashMap : public El::Python::ObjectImpl
+    {
+    public:
+      HashMap(PyTypeObject *type = 0, PyObject *args = 0, PyObject *kwds = 0)
+        throw(El::Exception);
+
+      virtual ~HashMap() throw();
+
+      // Returns borrowed reference or 0 if key not found
+      PyObject* find(PyObject* key) const throw(Exception, El::Exception);
+
+      void insert(PyObject* key, PyObject* value)
+        throw(Exception, El::Exception);
+
+      bool erase(PyObject* key) throw(Exception, El::Exception);
+
+      void clear() throw();
+      void reserve(size_t size) throw(El::Exception);
+
+      size_t size() const throw();
+      bool empty() const throw();
+
+      //
+      // Strings and integers are written in compact form, other objects
+      // as operator<<(El::BinaryOutStream&, PyObject*) writes them
+      //
+      virtual void write(El::BinaryOutStream& bstr) const throw(El::Exception);
+      virtual void read(El::BinaryInStream& bstr) throw(El::Exception);
+
+      class const_iterator
+      {
+      public:
+        PyObject* key() const throw();
+        PyObject* value() const throw();
+
+        const_iterator& operator++() throw();
+
+        bool operator==(const const_iterator& it) const throw();
+        bool operator!=(const const_iterator& it) const throw();
+
+      private:
+        friend class HashMap;
+
+        const_iterator(const HashMap* map, size_t entry) throw();
+
+        const HashMap* map_;
+        size_t entry_;
+      };
+
+      const_iterator begin() const throw();
+      const_iterator end() const throw();
+
+      PyObject* py_size() throw(El::Exception);
+      PyObject* py_keys() throw(El::Exception);
+      PyObject* py_sorted_keys() throw(El::Exception);
+
+      class Type : public El::Python::ObjectTypeImpl<HashMap, HashMap::Type>
+      {
+      public:
+        Type() throw(El::Python::Exception, El::Exception);
+
+        static Type instance;
+
+        PY_TYPE_METHOD_NOARGS(
+          py_size,
+          "size",
+          "Returns associative container size");
+
+        PY_TYPE_METHOD_NOARGS(
+          py_keys,
+          "keys",
+          "Returns keys list in insertion order");
+
+        PY_TYPE_METHOD_NOARGS(
+          py_sorted_keys,
+          "sorted_keys",
+          "Returns sorted keys list");
+
+      private:
+        static Py_ssize_t mp_length(PyObject* m);
+        static PyObject* mp_subscript(PyObject* m, PyObject* k);
+
+        static int mp_ass_subscript(PyObject* m,
+                                    PyObject* k,
+                                    PyObject* v);
+
+      private:
+        PyMappingMethods map_methods_;
+      };
+
+    private:
+      struct Entry
+      {
+        // Both 0 for erased entry
+        PyObject* key;
+        PyObject* value;
+        long hash;
+      };
+
+      typedef std::vector<Entry> EntryArray;
+
+      // Holds entry index + 1; 0 for free slot. Slot of erased entry is
+      // kept occupied till rehash for probe sequences not to be broken.
+      typedef std::vector<uint32_t> Index;
+
+      enum { MIN_INDEX_SIZE = 8 };
+
+      // Entries reserved by read at most, as size read can be anything
+      enum { MAX_READ_RESERVE = 65536 };
+
+      enum ObjectTag
+      {
+        OT_OBJECT,
+        OT_STRING,
+        OT_INT
+      };
+
+      static long hash(PyObject* key) throw(Exception, El::Exception);
+
+      static bool equal(PyObject* key1, PyObject* key2)
+        throw(Exception, El::Exception);
+
+      // Returns true if keys are compared without running Python code
+      static bool plain_compare(PyObject* key1, PyObject* key2) throw();
+
+      //
+      // Returns index slot with entry for the key or free slot to place
+      // it to. Key comparison can run Python code changing the map, so
+      // lookup is restarted if it happens.
+      //
+      size_t lookup(PyObject* key, long hs) const
+        throw(Exception, El::Exception);
+
+      void rehash(size_t entries) throw(El::Exception);
+
+      static void write_object(El::BinaryOutStream& bstr, PyObject* obj)
+        throw(El::Exception);
+
+      static PyObject* read_object(El::BinaryInStream& bstr, bool intern)
+        throw(El::Exception);
+
+    private:
+      EntryArray entries_;
+      Index index_;
+      size_t size_;
+
+      // Incremented on entries or index change
+      unsigned long version_;
+    };
+
+    typedef SmartPtr<HashMap> HashMap_var;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Inlines
+///////////////////////////////////////////////////////////////////////////////
+
+namespace El
+{
+  namespace Python
+  {
+    //
+    // HashMap::const_iterator class
+    //
+    inline
+    HashMap::const_iterator::const_iterator(const HashMap* map, size_t entry)
+      throw()
+        : map_(map),
+          entry_(entry)
+    {
+      const EntryArray& entries = map_->entries_;
+      for(; entry_ < entries.size() && entries[entry_].key == 0; ++entry_);
+    }
+
+    inline
+    PyObject*
+    HashMap::const_iterator::key() const throw()
+    {
+      return map_->entries_[entry_].key;
+    }
+
+    inline
+    PyObject*
+    HashMap::const_iterator::value() const throw()
+    {
+      return map_->entries_[entry_].value;
+    }
+
+    inline
+    HashMap::const_iterator&
+    HashMap::const_iterator::operator++() throw()
+    {
+      const EntryArray& entries = map_->entries_;
+      for(++entry_; entry_ < entries.size() && entries[entry_].key == 0;
+          ++entry_);
+
+      return *this;
+    }
+
+    inline
+    bool
+    HashMap::const_iterator::operator==(const const_iterator& it) const
+      throw()
+    {
+      return entry_ == it.entry_;
+    }
+
+    inline
+    bool
+    HashMap::const_iterator::operator!=(const const_iterator& it) const
+      throw()
+    {
+      return entry_ != it.entry_;
+    }
+
+    //
+    // HashMap class
+    //
+    inline
+    size_t
+    HashMap::size() const throw()
+    {
+      return size_;
+    }
+
+    inline
+    bool
+    HashMap::empty() const throw()
+    {
+      return size_ == 0;
+    }
+
+    inline
+    HashMap::const_iterator
+    HashMap::begin() const throw()
+    {
+      return const_iterator(this, 0);
+    }
+
+    inline
+    HashMap::const_iterator
+    HashMap::end() const throw()
+    {
+      return const_iterator(this, entries_.size());
+    }
+
+    inline
+    long
+    HashMap::hash(PyObject* key) throw(Exception, El::Exception)
+    {
+      if(PyString_CheckExact(key))
+      {
+        // String caches its hash
+        long hs = ((PyStringObject*)key)->ob_shash;
+
+        if(hs != -1)
+        {
+          return hs;
+        }
+      }
+      else if(PyInt_CheckExact(key))
+      {
+        // Same value as int hash function returns, so keys equal to
+        // int (like float 1.0 to 1) are found
+        long hs = PyInt_AS_LONG(key);
+        return hs == -1 ? -2 : hs;
+      }
+
+      long hs = PyObject_Hash(key);
+
+      if(hs == -1)
+      {
+        handle_error("El::Python::HashMap::hash: PyObject_Hash failed");
+      }
+
+      return hs;
+    }
+
+    inline
+    bool
+    HashMap::plain_compare(PyObject* key1, PyObject* key2) throw()
+    {
+      return key1 == key2 ||
+        (PyString_CheckExact(key1) && PyString_CheckExact(key2)) ||
+        (PyInt_CheckExact(key1) && PyInt_CheckExact(key2));
+    }
+
+    inline
+    bool
+    HashMap::equal(PyObject* key1, PyObject* key2)
+      throw(Exception, El::Exception)
+    {
+      if(key1 == key2)
+      {
+        return true;
+      }
+
+      if(PyString_CheckExact(key1) && PyString_CheckExact(key2))
+      {
+        Py_ssize_t len = PyString_GET_SIZE(key1);
+
+        return len == PyString_GET_SIZE(key2) &&
+          memcmp(PyString_AS_STRING(key1), PyString_AS_STRING(key2), len) ==
+          0;
+      }
+
+      if(PyInt_CheckExact(key1) && PyInt_CheckExact(key2))
+      {
+        return PyInt_AS_LONG(key1) == PyInt_AS_LONG(key2);
+      }
+
+      int res = PyObject_RichCompareBool(key1, key2, Py_EQ);
+
+      if(res < 0)
+      {
+        handle_error(
+          "El::Python::HashMap::equal: PyObject_RichCompareBool failed");
+      }
+
+      return res != 0;
+    }
+  }
+}
+
+#endif // _ELEMENTS_EL_PYTHON_HASHMAP_HPP_
@@ -162,7 +162,9 @@ namespace El
         handle_error("El::Python::Moment::iso8601");
       }
 
-      return PyString_FromString(iso8601(timezone).c_str());
+      char buff[FORMAT_BUFF_SIZE];
+      return PyString_FromStringAndSize(buff,
+                                        format_iso8601(buff, timezone) - buff);
     }
 
     PyObject*
@@ -176,7 +178,11 @@ namespace El
         handle_error("El::Python::Moment::rfc0822");
       }
 
-      return PyString_FromString(rfc0822(timezone, usec).c_str());
+      char buff[FORMAT_BUFF_SIZE];
+
+      return PyString_FromStringAndSize(
+        buff,
+        format_rfc0822(buff, timezone, usec) - buff);
     }
 
     PyObject*
@@ -189,7 +195,8 @@ namespace El
     PyObject*
     Moment::py_dense_format() throw(El::Exception)
     {
-      return PyString_FromString(dense_format().c_str());      
+      char buff[FORMAT_BUFF_SIZE];
+      return PyString_FromStringAndSize(buff, format_dense(buff) - buff);
     }    
   }
 }
@@ -36,7 +36,9 @@ namespace El
                                    const char* name,
                                    unsigned long processes,
                                    unsigned long timeout,
-                                   const char* libs)
+                                   const char* libs,
+                                   bool zygote,
+                                   const RecyclePolicy& recycle_policy)
       throw(Exception, El::Exception)
         : El::Service::ServiceBase<El::Sync::ThreadRWPolicy>(callback,
                                                              name,
@@ -49,7 +51,12 @@ namespace El
                                    libs,
                                    name,
                                    processes,
-                                   timeout)
+                                   timeout,
+                                   SIZE_MAX,
+                                   SIZE_MAX,
+                                   TaskQueue::ES_BACK,
+                                   zygote,
+                                   recycle_policy)
     {
     }
 
@@ -78,7 +78,9 @@ namespace El
                      const char* name = 0,
                      unsigned long processes = 1,
                      unsigned long timeout = 0 /* msec */,
-                     const char* libs = 0)
+                     const char* libs = 0,
+                     bool zygote = false,
+                     const RecyclePolicy& recycle_policy = RecyclePolicy())
         throw(Exception, El::Exception);
       
       virtual ~SandboxService() throw() {}
@@ -12,9 +12,13 @@
  */
 
 #include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #include <poll.h>
 #include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
 
 #include <sstream>
 #include <iostream>
@@ -22,6 +26,7 @@
 #include <ace/OS.h>
 
 #include <El/Exception.hpp>
+#include <El/ArrayPtr.hpp>
 #include <El/RefCount/All.hpp>
 #include <El/BinaryStream.hpp>
 #include <El/String/Manip.hpp>
@@ -45,6 +50,8 @@ namespace El
       int input = 0;
       int output = 0;
       bool initial_process_create = true;
+      unsigned long executed_tasks = 0;
+      size_t base_rss = 0;
       
       while(true)
       {
@@ -74,8 +81,13 @@ namespace El
                                      error);
 
                 initial_process_create = false;
+                executed_tasks = 0;
 
-                if(!pid)
+                if(pid)
+                {
+                  base_rss = process_rss(pid);
+                }
+                else
                 {
                   task->error(error.c_str());
                 }
@@ -92,11 +104,16 @@ namespace El
                               input,
                               output,
                               timeout_occured,
+                              !zygote_,
                               error);
 
                 task->timeout_occured(timeout_occured);
                 task->error(error.c_str());
               }
+              else if(pid)
+              {
+                ++executed_tasks;
+              }
             }
             else
             {
@@ -104,6 +121,23 @@ namespace El
             }
 
             task->signal_completion();
+
+            //
+            // Checking after completion signaled so the task owner is not
+            // delayed; new process is created when next task dequeued.
+            //
+            std::string reason;
+            
+            if(pid && recycle_required(pid, executed_tasks, base_rss, reason))
+            {
+              close_process(false,
+                            pid,
+                            input,
+                            output,
+                            false,
+                            !zygote_,
+                            reason);
+            }
           }
           else
           {
@@ -113,14 +147,14 @@ namespace El
         catch(const El::Exception& e)
         {
           std::string error = e.what();
-          close_process(false, pid, input, output, false, error);
+          close_process(false, pid, input, output, false, !zygote_, error);
           
           throw;
         }
       }
 
       std::string error;
-      close_process(true, pid, input, output, false, error);
+      close_process(true, pid, input, output, false, !zygote_, error);
     }
 
     bool
@@ -157,15 +191,42 @@ namespace El
                                 std::string& error)
       throw(Exception, El::Exception)
     {
+      pid_t pid = zygote_ ? fork_process(input, output, error) :
+        exec_process(false, input, output, error);
+
+      if(pid && !initial)
+      {
+        std::ostringstream ostr;
+        ostr << "El::Service::ProcessPool::create_process: pid " << pid;
+          
+        El::Service::Error error(ostr.str(), this, El::Service::Error::NOTICE);
+        callback_->notify(&error);
+      }
+
+      return pid;
+    }
+
+    pid_t
+    ProcessPool::exec_process(bool zygote,
+                              int& input,
+                              int& output,
+                              std::string& error)
+      throw(Exception, El::Exception)
+    {
+      //
+      // Zygote process communicates through unix socket as it passes
+      // file descriptors of forked processes back.
+      //
       int pipe_out[2];
-      int r = pipe(pipe_out);
+      int r = zygote ? socketpair(AF_UNIX, SOCK_STREAM, 0, pipe_out) :
+        pipe(pipe_out);
 
       if(r)
       {
         int error = ACE_OS::last_error();
                 
         std::ostringstream ostr;
-        ostr << "El::Service::ProcessPool::create_process: "
+        ostr << "El::Service::ProcessPool::exec_process: "
           "socketpair failed with code " << error << ". Description:\n"
              << ACE_OS::strerror(error) << std::endl;
 
@@ -173,7 +234,17 @@ namespace El
       }
 
       int pipe_in[2];
-      r = pipe(pipe_in);
+
+      if(zygote)
+      {
+        pipe_in[0] = dup(pipe_out[1]);
+        pipe_in[1] = dup(pipe_out[0]);
+        r = pipe_in[0] < 0 || pipe_in[1] < 0 ? -1 : 0;
+      }
+      else
+      {
+        r = pipe(pipe_in);
+      }
 
       if(r)
       {
@@ -181,9 +252,22 @@ namespace El
                 
         close(pipe_out[0]);
         close(pipe_out[1]);
+
+        if(zygote)
+        {
+          if(pipe_in[0] >= 0)
+          {
+            close(pipe_in[0]);
+          }
+
+          if(pipe_in[1] >= 0)
+          {
+            close(pipe_in[1]);
+          }
+        }
                 
         std::ostringstream ostr;
-        ostr << "El::Service::ProcessPool::create_process: "
+        ostr << "El::Service::ProcessPool::exec_process: "
           "socketpair failed with code " << error << ". Description:\n"
              << ACE_OS::strerror(error) << std::endl;
 
@@ -218,14 +302,14 @@ namespace El
         {
           int error = ACE_OS::last_error();
 
-          std::cerr << "El::Service::ProcessPool::create_process: execlp "
+          std::cerr << "El::Service::ProcessPool::exec_process: execlp "
             "failed with code " << error << ". Description:\n"
                     << ACE_OS::strerror(error) << std::endl;
                   
           exit(-1);
         }
 
-        std::cerr << "El::Service::ProcessPool::create_process: "
+        std::cerr << "El::Service::ProcessPool::exec_process: "
           "shouldn't be here\n";
      
         exit(-1);
@@ -254,7 +338,14 @@ namespace El
                        data,
                        timeout_occured))
       {
-        close_process(false, pid, input, output, timeout_occured, data);
+        close_process(false,
+                      pid,
+                      input,
+                      output,
+                      timeout_occured,
+                      true,
+                      data);
+
         error = data;
         
         return 0;
@@ -266,21 +357,161 @@ namespace El
 
         if(check_error_result(bstr, error))
         {
-          close_process(false, pid, input, output, false, error);
+          close_process(false, pid, input, output, false, true, error);
           return 0;
         }
       }
 
-      if(!initial)
+      return pid;
+    }
+
+    pid_t
+    ProcessPool::fork_process(int& input, int& output, std::string& error)
+      throw(Exception, El::Exception)
+    {
+      ZygoteGuard guard(zygote_lock_);
+
+      if(zygote_pid_ == 0)
       {
-        std::ostringstream ostr;
-        ostr << "El::Service::ProcessPool::create_process: pid " << pid;
+        zygote_pid_ =
+          exec_process(true, zygote_input_, zygote_output_, error);
+
+        if(zygote_pid_ == 0)
+        {
+          return 0;
+        }
+      }
+
+      std::ostringstream ostr;
+
+      {
+        El::BinaryOutStream bstr(ostr);
+        bstr << "FORK";
+      }
+      
+      std::string data;
+      bool timeout_occured = false;
+      
+      if(send_command(ostr.str(),
+                      zygote_output_,
+                      zygote_input_,
+                      data,
+                      timeout_occured))
+      {
+        std::istringstream istr(data);
+        El::BinaryInStream bstr(istr);
+
+        if(check_error_result(bstr, error))
+        {
+          return 0;
+        }
+
+        uint64_t pid = 0;
+        bstr >> pid;
+
+        int fds[2];
+        
+        if(receive_descriptors(zygote_input_,
+                               fds,
+                               2,
+                               data,
+                               timeout_occured))
+        {
+          input = fds[0];
+          output = fds[1];
           
-        El::Service::Error error(ostr.str(), this, El::Service::Error::NOTICE);
-        callback_->notify(&error);
+          return pid;
+        }
+
+        //
+        // Forked process exits by itself as nobody holds its pipes' ends.
+        //
       }
 
-      return pid;
+      error = std::string("zygote failure: ") + data;
+      
+      close_process(false,
+                    zygote_pid_,
+                    zygote_input_,
+                    zygote_output_,
+                    timeout_occured,
+                    true,
+                    data);
+
+      return 0;
+    }
+
+    void
+    ProcessPool::close_zygote() throw(El::Exception)
+    {
+      ZygoteGuard guard(zygote_lock_);
+      
+      std::string error;
+      
+      close_process(true,
+                    zygote_pid_,
+                    zygote_input_,
+                    zygote_output_,
+                    false,
+                    true,
+                    error);
+    }
+
+    bool
+    ProcessPool::recycle_required(pid_t pid,
+                                  unsigned long executed_tasks,
+                                  size_t base_rss,
+                                  std::string& reason) const
+      throw(El::Exception)
+    {
+      if(recycle_policy_.max_tasks &&
+         executed_tasks >= recycle_policy_.max_tasks)
+      {
+        std::ostringstream ostr;
+        ostr << "recycled after " << executed_tasks << " tasks";
+        reason = ostr.str();
+        
+        return true;
+      }
+
+      if(recycle_policy_.max_rss_growth)
+      {
+        size_t rss = process_rss(pid);
+
+        if(rss > base_rss && rss - base_rss > recycle_policy_.max_rss_growth)
+        {
+          std::ostringstream ostr;
+          ostr << "recycled as RSS grown from " << base_rss << " to " << rss
+               << " bytes";
+
+          reason = ostr.str();
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    size_t
+    ProcessPool::process_rss(pid_t pid) throw()
+    {
+      char path[64];
+      snprintf(path, sizeof(path), "/proc/%lu/statm", (unsigned long)pid);
+
+      FILE* file = fopen(path, "r");
+
+      if(file == 0)
+      {
+        return 0;
+      }
+
+      unsigned long size = 0;
+      unsigned long resident = 0;
+      int res = fscanf(file, "%lu %lu", &size, &resident);
+      
+      fclose(file);
+
+      return res == 2 ? (size_t)resident * sysconf(_SC_PAGESIZE) : 0;
     }
 
     bool
@@ -436,6 +667,81 @@ namespace El
       return true;      
     }
     
+    bool
+    ProcessPool::receive_descriptors(int fd,
+                                     int* fds,
+                                     size_t count,
+                                     std::string& error,
+                                     bool& timeout_occured) const
+      throw(El::Exception)
+    {
+      timeout_occured = false;
+      error.clear();
+
+      pollfd pfd;
+      
+      pfd.fd = fd;
+      pfd.events = POLLIN | POLLPRI | POLLRDBAND | POLLRDNORM;
+      pfd.revents = 0;
+
+      int r = 0;
+
+      while((r = poll(&pfd, 1, timeout_)) < 0 && errno == EINTR);
+
+      if(r == 0)
+      {
+        error = "Read timeout";
+        timeout_occured = true;
+        return false;
+      }
+      
+      char byte = 0;
+      iovec iov;
+      
+      iov.iov_base = &byte;
+      iov.iov_len = 1;
+
+      El::ArrayPtr<char> control(new char[CMSG_SPACE(sizeof(int) * count)]);
+      
+      msghdr msg;
+      memset(&msg, 0, sizeof(msg));
+      
+      msg.msg_iov = &iov;
+      msg.msg_iovlen = 1;
+      msg.msg_control = control.get();
+      msg.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+
+      ssize_t size = 0;
+
+      if(r > 0)
+      {
+        while((size = recvmsg(fd, &msg, 0)) < 0 && errno == EINTR);
+      }
+
+      cmsghdr* cmsg = r > 0 && size == 1 ? CMSG_FIRSTHDR(&msg) : 0;
+
+      if(cmsg == 0 || cmsg->cmsg_level != SOL_SOCKET ||
+         cmsg->cmsg_type != SCM_RIGHTS ||
+         cmsg->cmsg_len != CMSG_LEN(sizeof(int) * count))
+      {
+        int e = ACE_OS::last_error();    
+          
+        std::ostringstream ostr;
+        ostr << "file descriptors receiving failed with code " << e;
+
+        if(e)
+        {
+          ostr << "; description: " << ACE_OS::strerror(e);
+        }
+
+        error = ostr.str();
+        return false;
+      }
+      
+      memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * count);
+      return true;
+    }
+    
     bool
     ProcessPool::send_command(const std::string& data,
                               int output,
@@ -632,6 +938,7 @@ namespace El
                                int& input,
                                int& output,
                                bool timeout_occured,
+                               bool own_child,
                                std::string& error)
       throw(El::Exception)
     {
@@ -649,6 +956,20 @@ namespace El
 
       pid_t closed_pid = pid;
       std::string close_error;
+
+      if(pid && !own_child)
+      {
+        //
+        // Process forked from zygote one is reaped by zygote; it exits
+        // by itself on input pipe closure.
+        //
+        if(timeout_occured)
+        {
+          kill(pid, SIGKILL);
+        }
+
+        pid = 0;
+      }
       
       if(pid)
       {
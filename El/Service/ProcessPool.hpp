@@ -126,8 +126,27 @@ namespace El
         std::string error_;
       };
 
+      //
+      // Worker process is closed (and recreated on next task) after
+      // max_tasks tasks executed or after its resident set grown by more
+      // than max_rss_growth bytes since creation. 0 means no limit.
+      //
+      struct RecyclePolicy
+      {
+        unsigned long max_tasks;
+        size_t max_rss_growth;
+
+        RecyclePolicy(unsigned long tasks = 0, size_t rss_growth = 0)
+          throw();
+      };
+
     public:
-      
+
+      //
+      // In zygote mode single template process is created and initialized
+      // with task factory, and worker processes are forked from it sharing
+      // initialized memory copy-on-write.
+      //
       ProcessPool(
         Callback* callback,
         const char* factory_lib,
@@ -139,7 +158,9 @@ namespace El
         unsigned long timeout = 0, // msec
         size_t max_result_len = SIZE_MAX,
         size_t queue_size = SIZE_MAX,
-        TaskQueue::EnqueueStrategy enqueue_strategy = TaskQueue::ES_BACK)
+        TaskQueue::EnqueueStrategy enqueue_strategy = TaskQueue::ES_BACK,
+        bool zygote = false,
+        const RecyclePolicy& recycle_policy = RecyclePolicy())
         throw(InvalidArg, El::Exception);
 
       virtual ~ProcessPool() throw();
@@ -165,6 +186,25 @@ namespace El
                            std::string& error)
         throw(Exception, El::Exception);
 
+      pid_t exec_process(bool zygote,
+                         int& input,
+                         int& output,
+                         std::string& error)
+        throw(Exception, El::Exception);
+
+      pid_t fork_process(int& input, int& output, std::string& error)
+        throw(Exception, El::Exception);
+
+      void close_zygote() throw(El::Exception);
+
+      bool recycle_required(pid_t pid,
+                            unsigned long executed_tasks,
+                            size_t base_rss,
+                            std::string& reason) const
+        throw(El::Exception);
+
+      static size_t process_rss(pid_t pid) throw();
+
       bool write(int fd,
                  const void* buff,
                  size_t count,
@@ -178,6 +218,13 @@ namespace El
                 bool& timeout_occured) const
         throw(El::Exception);
       
+      bool receive_descriptors(int fd,
+                               int* fds,
+                               size_t count,
+                               std::string& error,
+                               bool& timeout_occured) const
+        throw(El::Exception);
+
       bool send_command(const std::string& data,
                         int output,
                         int input,
@@ -200,6 +247,7 @@ namespace El
                          int& input,
                          int& output,
                          bool timeout_occured,
+                         bool own_child,
                          std::string& error)
         throw(El::Exception);
 
@@ -214,6 +262,17 @@ namespace El
       TaskQueue::EnqueueStrategy enqueue_strategy_;
       int timeout_;
       size_t max_result_len_;
+
+      bool zygote_;
+      RecyclePolicy recycle_policy_;
+
+      typedef ACE_Thread_Mutex ZygoteMutex;
+      typedef ACE_Guard<ZygoteMutex> ZygoteGuard;
+
+      ZygoteMutex zygote_lock_;
+      pid_t zygote_pid_;
+      int zygote_input_;
+      int zygote_output_;
     };
 
     typedef El::RefCount::SmartPtr<ProcessPool> ProcessPool_var;    
@@ -245,7 +304,9 @@ namespace El
                              unsigned long timeout,
                              size_t max_result_len,
                              size_t queue_size,
-                             TaskQueue::EnqueueStrategy enqueue_strategy)
+                             TaskQueue::EnqueueStrategy enqueue_strategy,
+                             bool zygote,
+                             const RecyclePolicy& recycle_policy)
       throw(InvalidArg, El::Exception)
         : ServiceBase<El::Sync::ThreadRWPolicy>(callback,
                                                 name,
@@ -259,7 +320,12 @@ namespace El
           queue_size_(queue_size),
           enqueue_strategy_(enqueue_strategy),
           timeout_(timeout ? timeout : -1),
-          max_result_len_(max_result_len)
+          max_result_len_(max_result_len),
+          zygote_(zygote),
+          recycle_policy_(recycle_policy),
+          zygote_pid_(0),
+          zygote_input_(0),
+          zygote_output_(0)
     {
       if(queue_size == 0)
       {
@@ -271,6 +337,13 @@ namespace El
     inline
     ProcessPool::~ProcessPool() throw()
     {
+      try
+      {
+        close_zygote();
+      }
+      catch(...)
+      {
+      }
     }
 
     inline
@@ -296,6 +369,23 @@ namespace El
       // Otherwise the object would be unusable after started again.
       //
       tasks_.max_size(queue_size_);
+
+      //
+      // No worker thread left to fork from zygote process.
+      //
+      close_zygote();
+    }
+    
+    //
+    // ProcessPool::RecyclePolicy struct
+    //
+    inline
+    ProcessPool::RecyclePolicy::RecyclePolicy(unsigned long tasks,
+                                              size_t rss_growth)
+      throw()
+        : max_tasks(tasks),
+          max_rss_growth(rss_growth)
+    {
     }
     
     //
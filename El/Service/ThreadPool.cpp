@@ -15,9 +15,21 @@
 
 #include <El/Exception.hpp>
 #include <El/RefCount/All.hpp>
+#include <El/Metrics.hpp>
 
 #include "ThreadPool.hpp"
 
+namespace
+{
+  El::Metrics::Histogram queue_wait_time(
+    "el_thread_pool_queue_wait_seconds",
+    "Time tasks wait in thread pool queues");
+
+  El::Metrics::Histogram execute_time(
+    "el_thread_pool_execute_seconds",
+    "Time thread pool tasks are executed");
+}
+
 namespace El
 {
   namespace Service
@@ -31,6 +43,10 @@ namespace El
 
         if(tasks_.dequeue(task))
         {
+          uint64_t dequeued = El::Metrics::now();
+          queue_wait_time.record(
+            dequeued - __atomic_load_n(&task->enqueued_, __ATOMIC_RELAXED));
+
           bool to_execute = task->execution_required();
 
           if(!to_execute)
@@ -43,6 +59,7 @@ namespace El
           if(to_execute)
           {
             task->execute();
+            execute_time.record(El::Metrics::now() - dequeued);
           }
         }
         else
@@ -64,7 +81,8 @@ namespace El
       }
 
       Task_var task_ptr(El::RefCount::add_ref(task));
-      
+      __atomic_store_n(&task->enqueued_, El::Metrics::now(), __ATOMIC_RELAXED);
+
       ReadGuard guard(srv_lock_);
 
       if(started_ && stop_)
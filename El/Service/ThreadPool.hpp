@@ -15,6 +15,7 @@
 #define _ELEMENTS_EL_THREADPOOL_HPP_
 
 #include <limits.h>
+#include <stdint.h>
 
 #include <ace/OS.h>
 
@@ -45,6 +46,7 @@ namespace El
         public virtual El::RefCount::DefaultImpl<El::Sync::ThreadPolicy>
       {
       public:
+        Task() throw();
         virtual ~Task() throw();
         virtual void execute() throw(El::Exception) = 0;
 
@@ -52,6 +54,15 @@ namespace El
         // otherwise it can be dropped if not yet executed at the moment
         // of stopping ThreadPool
         virtual bool execution_required() throw(El::Exception) = 0;
+
+      private:
+        friend class ThreadPool;
+
+        // El::Metrics::now() value at the moment of task enqueuing, is
+        // used for measuring time task waited in the queue. Accessed
+        // atomically as the same task can be enqueued by several threads
+        // at once; the latest enqueuing wins then.
+        uint64_t enqueued_;
       };
 
       typedef El::RefCount::SmartPtr<Task> Task_var;
@@ -194,6 +205,12 @@ namespace El
     //
     // ThreadPool::Task class
     //
+    inline
+    ThreadPool::Task::Task() throw()
+        : enqueued_(0)
+    {
+    }
+
     inline
     ThreadPool::Task::~Task() throw()
     {
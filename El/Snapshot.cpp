@@ -0,0 +1,38 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Snapshot.cpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#include "Snapshot.hpp"
+
+namespace El
+{
+  namespace Sync
+  {
+    __thread unsigned long reader_slot_ = 0;
+
+    namespace
+    {
+      unsigned long next_reader_slot = 0;
+    }
+
+    unsigned long
+    assign_reader_slot() throw()
+    {
+      unsigned long slot =
+        __atomic_fetch_add(&next_reader_slot, 1, __ATOMIC_RELAXED) %
+        READER_SLOTS;
+
+      reader_slot_ = slot + 1;
+      return slot;
+    }
+  }
+}
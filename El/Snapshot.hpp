@@ -0,0 +1,212 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/Snapshot.hpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#ifndef _ELEMENTS_EL_SNAPSHOT_HPP_
+#define _ELEMENTS_EL_SNAPSHOT_HPP_
+
+#include <ace/OS.h>
+#include <ace/Synch.h>
+#include <ace/Guard_T.h>
+
+namespace El
+{
+  namespace Sync
+  {
+    // Number of reader counters of a snapshot; threads are assigned to
+    // them round robin, so up to READER_SLOTS threads count their
+    // readers each in own cache line
+    enum { READER_SLOTS = 64 };
+
+    // Slot of the calling thread
+    unsigned long reader_slot() throw();
+
+    //
+    // Holds current version of an immutable object. Readers pin the
+    // version with Snapshot::Reader taking no lock. publish replaces the
+    // version and deletes the previous one once all readers which could
+    // have seen it are gone: readers register in a counter of the current
+    // epoch and publish flips the epoch and waits for the counters of the
+    // previous one to drain.
+    //
+    template<typename T>
+    class Snapshot
+    {
+    public:
+      Snapshot(T* value = 0) throw();
+      ~Snapshot() throw();
+
+      // Should not be called by a thread holding a reader of this
+      // snapshot as waits for them to go
+      void publish(T* value) throw();
+
+      class Reader
+      {
+      public:
+        Reader(const Snapshot& snapshot) throw();
+        ~Reader() throw();
+
+        const T* get() const throw();
+        const T* operator->() const throw();
+
+      private:
+        Reader(const Reader&);
+        void operator=(const Reader&);
+
+      private:
+        unsigned long* counters_;
+        unsigned long epoch_;
+        const T* value_;
+      };
+
+    private:
+      Snapshot(const Snapshot&);
+      void operator=(const Snapshot&);
+
+    private:
+      typedef ACE_Thread_Mutex Mutex;
+      typedef ACE_Guard<Mutex> Guard;
+
+      // Serializes publish calls
+      Mutex lock_;
+
+      // Reader counters of both epochs; padded so counters of different
+      // slots never share a cache line
+      struct ReaderSlot
+      {
+        unsigned long readers[2];
+        char padding[128 - 2 * sizeof(unsigned long)];
+      };
+
+      T* value_;
+      unsigned long epoch_;
+      mutable ReaderSlot slots_[READER_SLOTS];
+    };
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Inlines
+///////////////////////////////////////////////////////////////////////////////
+
+namespace El
+{
+  namespace Sync
+  {
+    extern __thread unsigned long reader_slot_;
+
+    unsigned long assign_reader_slot() throw();
+
+    inline
+    unsigned long
+    reader_slot() throw()
+    {
+      // Zero while not assigned
+      unsigned long slot = reader_slot_;
+      return slot ? slot - 1 : assign_reader_slot();
+    }
+
+    //
+    // Snapshot class
+    //
+    template<typename T>
+    Snapshot<T>::Snapshot(T* value) throw()
+        : value_(value),
+          epoch_(0)
+    {
+      for(size_t i = 0; i < READER_SLOTS; ++i)
+      {
+        slots_[i].readers[0] = 0;
+        slots_[i].readers[1] = 0;
+      }
+    }
+
+    template<typename T>
+    Snapshot<T>::~Snapshot() throw()
+    {
+      delete value_;
+    }
+
+    template<typename T>
+    void
+    Snapshot<T>::publish(T* value) throw()
+    {
+      Guard guard(lock_);
+
+      T* previous = __atomic_exchange_n(&value_, value, __ATOMIC_SEQ_CST);
+
+      //
+      // Readers registered in the new epoch load value after the flip, so
+      // see the new version; readers of the previous epoch are waited for.
+      //
+      unsigned long epoch = epoch_ & 1;
+      __atomic_store_n(&epoch_, epoch_ + 1, __ATOMIC_SEQ_CST);
+
+      for(size_t i = 0; i < READER_SLOTS; ++i)
+      {
+        while(__atomic_load_n(slots_[i].readers + epoch, __ATOMIC_ACQUIRE))
+        {
+          ACE_OS::sleep(ACE_Time_Value(0, 1000));
+        }
+      }
+
+      delete previous;
+    }
+
+    //
+    // Snapshot::Reader class
+    //
+    template<typename T>
+    Snapshot<T>::Reader::Reader(const Snapshot& snapshot) throw()
+        : counters_(snapshot.slots_[reader_slot()].readers)
+    {
+      while(true)
+      {
+        epoch_ = __atomic_load_n(&snapshot.epoch_, __ATOMIC_SEQ_CST) & 1;
+        __atomic_add_fetch(counters_ + epoch_, 1, __ATOMIC_SEQ_CST);
+
+        if((__atomic_load_n(&snapshot.epoch_, __ATOMIC_SEQ_CST) & 1) ==
+           epoch_)
+        {
+          break;
+        }
+
+        // Epoch flipped meanwhile; publish may not wait for this reader
+        __atomic_sub_fetch(counters_ + epoch_, 1, __ATOMIC_RELEASE);
+      }
+
+      value_ = __atomic_load_n(&snapshot.value_, __ATOMIC_SEQ_CST);
+    }
+
+    template<typename T>
+    Snapshot<T>::Reader::~Reader() throw()
+    {
+      __atomic_sub_fetch(counters_ + epoch_, 1, __ATOMIC_RELEASE);
+    }
+
+    template<typename T>
+    const T*
+    Snapshot<T>::Reader::get() const throw()
+    {
+      return value_;
+    }
+
+    template<typename T>
+    const T*
+    Snapshot<T>::Reader::operator->() const throw()
+    {
+      return value_;
+    }
+  }
+}
+
+#endif // _ELEMENTS_EL_SNAPSHOT_HPP_
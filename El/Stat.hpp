@@ -37,6 +37,11 @@ namespace El
 {
   namespace Stat
   {
+    //
+    // Keeps min, max and average times updated under a mutex. For hot
+    // paths El::Metrics::Histogram (El/Metrics.hpp) is preferred as it
+    // takes no locks and keeps latency distribution.
+    //
     class TimeMeter
     {
     public:    
@@ -85,6 +85,8 @@ namespace El
     {
       size_t operator()(const El::String::LightString& str) const
         throw(El::Exception);
+
+      size_t operator()(const char* str) const throw();
     };
   }
 }
@@ -332,7 +334,14 @@ namespace El
     LightString::operator()(const El::String::LightString& str) const
       throw(El::Exception)
     {
-      return str.c_str() ? __gnu_cxx::__stl_hash_string(str.c_str()) : 0;
+      return str.c_str() ? hash64(str.c_str(), str.length()) : 0;
+    }
+
+    inline
+    size_t
+    LightString::operator()(const char* str) const throw()
+    {
+      return str ? hash64(str, strlen(str)) : 0;
     }
     
   }
@@ -13,6 +13,11 @@
 #include <string>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  include <tmmintrin.h>
+#endif
 
 #include <ace/OS.h>
 
@@ -20,6 +25,7 @@
 
 #include "Manip.hpp"
 #include "Unicode.hpp"
+#include "Scan.hpp"
 
 const iconv_t El::String::Manip::Transcoder::NULL_HANDLE_ =
   reinterpret_cast<const iconv_t>(-1);
@@ -314,6 +320,550 @@ namespace
 
 }
 
+namespace
+{
+  const char HEX_DIGITS[] = "0123456789ABCDEF";
+  const char HEX_DIGITS_LOWER[] = "0123456789abcdef";
+
+  //
+  // Byte classes for El::String::Scan
+  //
+  using El::String::Scan::in_range;
+
+#ifdef __SSE2__
+  using El::String::Scan::equal;
+  using El::String::Scan::negate;
+
+  inline
+  __m128i
+  alnum(__m128i chr) throw()
+  {
+    return _mm_or_si128(
+      _mm_or_si128(in_range(chr, '0', '9'), in_range(chr, 'A', 'Z')),
+      in_range(chr, 'a', 'z'));
+  }
+#endif
+
+  inline
+  bool
+  alnum(unsigned char chr) throw()
+  {
+    return in_range(chr, '0', '9') || in_range(chr, 'A', 'Z') ||
+      in_range(chr, 'a', 'z');
+  }
+
+  // Chars mime_url_encode doesn't copy as is
+  struct MimeUrlEscaped
+  {
+    static bool match(unsigned char chr) throw()
+    {
+      return !alnum(chr) && chr != '-' && chr != '_' && chr != '*' &&
+        chr != '.' && chr != ',';
+    }
+
+#ifdef __SSE2__
+    static __m128i match(__m128i chr) throw()
+    {
+      return negate(
+        _mm_or_si128(
+          _mm_or_si128(alnum(chr),
+                       _mm_or_si128(equal(chr, '-'), equal(chr, '_'))),
+          _mm_or_si128(equal(chr, '*'),
+                       _mm_or_si128(equal(chr, '.'), equal(chr, ',')))));
+    }
+#endif
+  };
+
+  // Chars mime_url_encode replaces with %XX
+  struct MimeUrlPercent
+  {
+    static bool match(unsigned char chr) throw()
+    {
+      return chr != ' ' && MimeUrlEscaped::match(chr);
+    }
+
+#ifdef __SSE2__
+    static __m128i match(__m128i chr) throw()
+    {
+      return _mm_andnot_si128(equal(chr, ' '), MimeUrlEscaped::match(chr));
+    }
+#endif
+  };
+
+  struct MimeUrlEncoded
+  {
+    static bool match(unsigned char chr) throw()
+    {
+      return chr == '+' || chr == '%';
+    }
+
+#ifdef __SSE2__
+    static __m128i match(__m128i chr) throw()
+    {
+      return _mm_or_si128(equal(chr, '+'), equal(chr, '%'));
+    }
+#endif
+  };
+
+  // Chars quoted_printable_encode doesn't copy as is
+  struct QuotedPrintableEscaped
+  {
+    static bool match(unsigned char chr) throw()
+    {
+      return !alnum(chr) && chr != '<' && chr != '>' && chr != '"' &&
+        chr != '\'' && chr != '/';
+    }
+
+#ifdef __SSE2__
+    static __m128i match(__m128i chr) throw()
+    {
+      return negate(
+        _mm_or_si128(
+          _mm_or_si128(alnum(chr),
+                       _mm_or_si128(equal(chr, '<'), equal(chr, '>'))),
+          _mm_or_si128(equal(chr, '"'),
+                       _mm_or_si128(equal(chr, '\''), equal(chr, '/')))));
+    }
+#endif
+  };
+
+  // Printable ASCII chars
+  struct XmlPrintable
+  {
+    static bool match(unsigned char chr) throw()
+    {
+      return in_range(chr, 0x20, 0x7E);
+    }
+
+#ifdef __SSE2__
+    static __m128i match(__m128i chr) throw()
+    {
+      return in_range(chr, 0x20, 0x7E);
+    }
+#endif
+  };
+
+  // Chars xml_encode doesn't copy as is in text
+  struct XmlTextEscaped
+  {
+    static bool match(unsigned char chr) throw()
+    {
+      return !XmlPrintable::match(chr) || chr == '<' || chr == '>' ||
+        chr == '&';
+    }
+
+#ifdef __SSE2__
+    static __m128i match(__m128i chr) throw()
+    {
+      return _mm_or_si128(
+        _mm_or_si128(negate(XmlPrintable::match(chr)), equal(chr, '<')),
+        _mm_or_si128(equal(chr, '>'), equal(chr, '&')));
+    }
+#endif
+  };
+
+  // Chars xml_encode doesn't copy as is in attribute value
+  struct XmlAttrEscaped
+  {
+    static bool match(unsigned char chr) throw()
+    {
+      return XmlTextEscaped::match(chr) || chr == '"' || chr == '\'';
+    }
+
+#ifdef __SSE2__
+    static __m128i match(__m128i chr) throw()
+    {
+      return _mm_or_si128(
+        XmlTextEscaped::match(chr),
+        _mm_or_si128(equal(chr, '"'), equal(chr, '\'')));
+    }
+#endif
+  };
+
+  struct NonAscii
+  {
+    static bool match(unsigned char chr) throw()
+    {
+      return chr > 0x7F;
+    }
+
+#ifdef __SSE2__
+    static __m128i match(__m128i chr) throw()
+    {
+      return _mm_cmplt_epi8(chr, _mm_setzero_si128());
+    }
+#endif
+  };
+
+  struct Ampersand
+  {
+    static bool match(unsigned char chr) throw()
+    {
+      return chr == '&';
+    }
+
+#ifdef __SSE2__
+    static __m128i match(__m128i chr) throw()
+    {
+      return equal(chr, '&');
+    }
+#endif
+  };
+
+  //
+  // Writes entity for chr the way xml_encode(const wchar_t*, ...) does
+  //
+  void
+  xml_encode_char(wchar_t chr, std::string& dest, unsigned long flags)
+    throw(El::Exception)
+  {
+    bool numeric = false;
+
+    if((chr & ~0xFF) == 0 && chr >= 0x20 && chr <= 0x7E)
+    {
+      bool attr = flags & El::String::Manip::XE_ATTRIBUTE_ENCODING;
+
+      if(flags & El::String::Manip::XE_FORCE_NUMERIC_ENCODING)
+      {
+        numeric = chr == L'<' || chr == L'>' || chr == L'&' ||
+          (attr && (chr == L'\'' || chr == L'"'));
+      }
+      else
+      {
+        switch(chr)
+        {
+        case L'<': dest.append("&lt;", 4); return;
+        case L'>': dest.append("&gt;", 4); return;
+        case L'&': dest.append("&amp;", 5); return;
+        }
+
+        if(attr)
+        {
+          switch(chr)
+          {
+          case L'\'': dest.append("&#x27;", 6); return;
+          case L'"': dest.append("&quot;", 6); return;
+          }
+        }
+      }
+
+      if(!numeric)
+      {
+        dest.push_back((char)(chr & 0xFF));
+        return;
+      }
+    }
+    else if((flags & El::String::Manip::XE_PRESERVE_UTF8) != 0 &&
+            chr >= 0x370)
+    {
+      El::String::Manip::wchar_to_utf8(chr, dest);
+      return;
+    }
+    else if(chr == 0x0A &&
+            (flags & El::String::Manip::XE_ATTRIBUTE_ENCODING) == 0)
+    {
+      dest.push_back((char)chr);
+      return;
+    }
+
+    // As std::hex formatted int
+    char buff[16];
+    char* end = buff + sizeof(buff);
+    char* ptr = end;
+    unsigned int val = (unsigned int)(int)chr;
+
+    do
+    {
+      *--ptr = HEX_DIGITS_LOWER[val & 0xF];
+      val >>= 4;
+    }
+    while(val);
+
+    dest.append("&#x", 3);
+    dest.append(ptr, end - ptr);
+    dest.push_back(';');
+  }
+
+  //
+  // Decodes UTF-8 sequences in [ptr, end) the way utf8_to_wchar does
+  // for valid input. Returns false if input is not valid.
+  //
+  bool
+  xml_encode_utf8(const unsigned char* ptr,
+                  const unsigned char* end,
+                  std::string& dest,
+                  unsigned long flags)
+    throw(El::Exception)
+  {
+    while(ptr != end)
+    {
+      unsigned long chr = *ptr++;
+      size_t len = 0;
+      unsigned long wchr = 0;
+
+      if((chr & 0x80) == 0)
+      {
+        wchr = chr;
+      }
+      else if((chr & 0xE0) == 0xC0)
+      {
+        len = 1;
+        wchr = chr & 0x1F;
+      }
+      else if((chr & 0xF0) == 0xE0)
+      {
+        len = 2;
+        wchr = chr & 0xF;
+      }
+      else if((chr & 0xF8) == 0xF0)
+      {
+        len = 3;
+        wchr = chr & 0x7;
+      }
+      else if((chr & 0xFC) == 0xF8)
+      {
+        len = 4;
+        wchr = chr & 0x3;
+      }
+      else if((chr & 0xFE) == 0xFC)
+      {
+        len = 5;
+        wchr = chr & 0x1;
+      }
+      else
+      {
+        return false;
+      }
+
+      if((size_t)(end - ptr) < len)
+      {
+        return false;
+      }
+
+      for(; len; --len)
+      {
+        chr = *ptr++;
+
+        if((chr & 0xC0) != 0x80)
+        {
+          return false;
+        }
+
+        wchr = (wchr << 6) | (chr & 0x3F);
+      }
+
+      xml_encode_char((wchar_t)wchr, dest, flags);
+    }
+
+    return true;
+  }
+
+  //
+  // Quoted printable encoding; only counts result size if dest is 0
+  //
+  size_t
+  encode_quoted_printable(const unsigned char* src,
+                          size_t src_len,
+                          char* dest,
+                          size_t char_per_line)
+    throw()
+  {
+    size_t size = 0;
+    size_t len = 0;
+
+    for(const unsigned char *ptr(src), *end(src + src_len); ptr != end; )
+    {
+      size_t as_is = El::String::Scan::find_first<QuotedPrintableEscaped>(
+        ptr, end);
+
+      while(as_is)
+      {
+        size_t count = std::min(
+          as_is, len < char_per_line ? char_per_line - len : 0);
+
+        if(count == 0)
+        {
+          if(dest)
+          {
+            memcpy(dest + size, "=\r\n", 3);
+            dest[size + 3] = *ptr;
+          }
+
+          size += 4;
+          len = 1;
+          ++ptr;
+          --as_is;
+        }
+        else
+        {
+          if(dest)
+          {
+            memcpy(dest + size, ptr, count);
+          }
+
+          size += count;
+          len += count;
+          ptr += count;
+          as_is -= count;
+        }
+      }
+
+      if(ptr == end)
+      {
+        break;
+      }
+
+      len += 3;
+
+      if(len > char_per_line)
+      {
+        if(dest)
+        {
+          memcpy(dest + size, "=\r\n", 3);
+        }
+
+        size += 3;
+        len = 3;
+      }
+
+      if(dest)
+      {
+        char* out = dest + size;
+        *out++ = '=';
+        *out++ = HEX_DIGITS[*ptr >> 4];
+        *out = HEX_DIGITS[*ptr & 0xF];
+      }
+
+      size += 3;
+      ++ptr;
+    }
+
+    return size;
+  }
+
+  //
+  // Base64 encoding of triple_count 3 byte groups
+  //
+  char*
+  base64_encode_scalar(const unsigned char* src,
+                       size_t triple_count,
+                       char* dest)
+    throw()
+  {
+    for(; triple_count; --triple_count, src += 3)
+    {
+      *dest++ = BASE64_CHARS[(src[0] >> 2) & 0x3F];
+      *dest++ = BASE64_CHARS[((src[0] << 4) & 0x30) | ((src[1] >> 4) & 0xF)];
+      *dest++ = BASE64_CHARS[((src[1] << 2) & 0x3C) | ((src[2] >> 6) & 0x3)];
+      *dest++ = BASE64_CHARS[src[2] & 0x3F];
+    }
+
+    return dest;
+  }
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define EL_STRING_MANIP_BASE64_SSSE3
+
+  //
+  // 12 source bytes into 16 chars per step: bytes are spread into 32-bit
+  // lanes, 6-bit indexes extracted with multiplies and translated to
+  // chars with pshufb lookup of per-range offsets
+  //
+  __attribute__((target("ssse3")))
+  char*
+  base64_encode_triples_ssse3(const unsigned char* src,
+                              size_t triple_count,
+                              const unsigned char* src_end,
+                              char* dest)
+    throw()
+  {
+    const __m128i shuffle = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7,
+                                         4, 5, 3, 4, 1, 2, 0, 1);
+
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '+' - 62,
+                                          '/' - 63, 'A', 0, 0);
+
+    // Last 4 of 16 loaded bytes are not used
+    for(; triple_count >= 4 && src_end - src >= 16;
+        triple_count -= 4, src += 12, dest += 16)
+    {
+      __m128i in = _mm_shuffle_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)), shuffle);
+
+      __m128i hi = _mm_mulhi_epu16(
+        _mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00)),
+        _mm_set1_epi32(0x04000040));
+
+      __m128i lo = _mm_mullo_epi16(
+        _mm_and_si128(in, _mm_set1_epi32(0x003F03F0)),
+        _mm_set1_epi32(0x01000010));
+
+      __m128i indexes = _mm_or_si128(hi, lo);
+
+      // 0 for A-Z, 1 for a-z, 2-11 for 0-9, 12 for + and 13 for /
+      __m128i range = _mm_subs_epu8(indexes, _mm_set1_epi8(51));
+
+      range = _mm_or_si128(
+        range,
+        _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indexes),
+                      _mm_set1_epi8(13)));
+
+      _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(dest),
+        _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indexes));
+    }
+
+    return base64_encode_scalar(src, triple_count, dest);
+  }
+
+  bool
+  cpu_has_ssse3() throw()
+  {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("ssse3");
+  }
+#endif
+
+  //
+  // src_end is end of source buffer, as vectorized version reads 16 bytes
+  // to encode 12
+  //
+  char*
+  base64_encode_triples(const unsigned char* src,
+                        size_t triple_count,
+                        const unsigned char* src_end,
+                        char* dest)
+    throw()
+  {
+#ifdef EL_STRING_MANIP_BASE64_SSSE3
+    static const bool ssse3 = cpu_has_ssse3();
+
+    if(ssse3)
+    {
+      return base64_encode_triples_ssse3(src, triple_count, src_end, dest);
+    }
+#endif
+
+    return base64_encode_scalar(src, triple_count, dest);
+  }
+
+  inline
+  int
+  hex_value(unsigned char chr) throw()
+  {
+    if(in_range(chr, '0', '9'))
+    {
+      return chr - '0';
+    }
+
+    chr |= 0x20;
+    return in_range(chr, 'a', 'f') ? chr - 'a' + 10 : -1;
+  }
+}
+
 namespace El
 {
   namespace String
@@ -323,9 +873,18 @@ namespace El
       void 
       mime_url_encode(const char* from, std::string& to) throw (El::Exception)
       {
-        std::ostringstream ostr;
-        mime_url_encode(from, ostr);      
-        to = ostr.str();
+        size_t len = from ? strlen(from) : 0;
+
+        // from can point to to's buffer
+        std::string res;
+        res.resize(mime_url_encoded_size(from, len));
+
+        if(!res.empty())
+        {
+          mime_url_encode(from, len, &res[0]);
+        }
+
+        to.swap(res);
       }
 
       void
@@ -337,26 +896,13 @@ namespace El
           return;
         }
 
-        char ch; 
-        for (const char* ptr = from; (ch = *ptr) != '\0'; ptr++)
-        {      
-          if (ch == ' ')
-          {
-            to << '+';
-            continue;
-          }
-          else if ((ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z') ||
-                   (ch >= '0' && ch <= '9') || ch == '-' || ch == '_' ||
-                   ch == '*' || ch == '.' || ch == ',')
-          {
-            to << ch;
-            continue;
-          }
-                           
-          to << "%";
-          to << std::setw(2) << std::setfill('0') << std::uppercase
-             << std::hex << std::right << (unsigned short) (ch & 0xFF)
-             << std::dec;
+        char buff[256 * 3];
+
+        for(const char *ptr(from), *end(from + strlen(from)); ptr != end; )
+        {
+          size_t len = std::min((size_t)(end - ptr), sizeof(buff) / 3);
+          to.write(buff, mime_url_encode(ptr, len, buff));
+          ptr += len;
         }
       }
       
@@ -364,73 +910,142 @@ namespace El
       mime_url_decode(const char* from, std::string& to)
         throw(InvalidArg, El::Exception)
       {
-        std::ostringstream ostr;
-        mime_url_decode(from, ostr);      
-        to = ostr.str();
+        size_t len = from ? strlen(from) : 0;
+
+        if(len == 0)
+        {
+          to.clear();
+          return;
+        }
+
+        std::string res;
+        res.resize(len);
+        res.resize(mime_url_decode(from, len, &res[0]));
+        to.swap(res);
       }
 
       void
       mime_url_decode(const char* from, std::ostream& to)
         throw(InvalidArg, El::Exception)
       {
-        if(from == 0)
+        std::string res;
+        mime_url_decode(from, res);
+        to.write(res.c_str(), res.size());
+      }
+
+      size_t
+      mime_url_encoded_size(const char* src, size_t src_len) throw()
+      {
+        const unsigned char* ptr = (const unsigned char*)src;
+        return src_len + Scan::count<MimeUrlPercent>(ptr, ptr + src_len) * 2;
+      }
+
+      size_t
+      mime_url_encode(const char* src, size_t src_len, char* dest) throw()
+      {
+        const unsigned char* ptr = (const unsigned char*)src;
+        const unsigned char* end = ptr + src_len;
+        char* out = dest;
+
+        while(true)
         {
-          return;
+          size_t len = Scan::find_first<MimeUrlEscaped>(ptr, end);
+
+          memcpy(out, ptr, len);
+          out += len;
+          ptr += len;
+
+          if(ptr == end)
+          {
+            break;
+          }
+
+          unsigned char chr = *ptr++;
+
+          if(chr == ' ')
+          {
+            *out++ = '+';
+          }
+          else
+          {
+            *out++ = '%';
+            *out++ = HEX_DIGITS[chr >> 4];
+            *out++ = HEX_DIGITS[chr & 0xF];
+          }
         }
 
-        const char* src = from;
+        return out - dest;
+      }
 
-        char chr = 0;
-        while((chr = *src++) != '\0')
+      size_t
+      mime_url_decode(const char* src, size_t src_len, char* dest)
+        throw(InvalidArg, El::Exception)
+      {
+        const unsigned char* begin = (const unsigned char*)src;
+        const unsigned char* ptr = begin;
+        const unsigned char* end = ptr + src_len;
+        char* out = dest;
+
+        while(true)
         {
-          switch(chr)
+          size_t len = Scan::find_first<MimeUrlEncoded>(ptr, end);
+
+          // Decoding in place is allowed
+          memmove(out, ptr, len);
+          out += len;
+          ptr += len;
+
+          if(ptr == end)
           {
-          case '+':
+            break;
+          }
+
+          if(*ptr++ == '+')
+          {
+            *out++ = ' ';
+            continue;
+          }
+
+          if(end - ptr >= 2)
+          {
+            int hi = hex_value(ptr[0]);
+            int lo = hex_value(ptr[1]);
+
+            if(hi >= 0 && lo >= 0)
             {
-              to << " ";
-              break;
+              *out++ = (char)((hi << 4) | lo);
+              ptr += 2;
+              continue;
             }
-          case '%':
-            {
-              if(*src == '\0' || src[1] == '\0')
-              {
-                std::ostringstream ostr;
-                ostr << "El::String::Manip::mime_url_decode: invalid encoding "
-                  "at position " << (src - from) << " in line '" << from
-                     << "'";
-                  
-                throw InvalidArg(ostr.str());
-              }
 
-              char buff[3];
-              strncpy(buff, src, 2);
-              buff[2] = '\0';
+            // Accept what strtoul accepts, like " A" or "-1"
+            char buff[3];
+            buff[0] = ptr[0];
+            buff[1] = ptr[1];
+            buff[2] = '\0';
 
-              char* endptr = 0;
-              size_t val = strtoul(buff, &endptr, 16);
+            char* endptr = 0;
+            size_t val = strtoul(buff, &endptr, 16);
 
-              if(endptr != 0 && *endptr != '\0')
-              {
-                std::ostringstream ostr;
-                ostr << "El::String::Manip::mime_url_decode: invalid encoding "
-                  "at position " << (src - from) << " in line '" << from
-                     << "'";
-                  
-                throw InvalidArg(ostr.str());
-              }
-              
-              to << (char)val;
-              src += 2;
-              break;
-            }
-          default:
+            if(endptr != 0 && *endptr == '\0')
             {
-              to << chr;
-              break;
+              *out++ = (char)val;
+              ptr += 2;
+              continue;
             }
           }
+
+          std::ostringstream ostr;
+          ostr << "El::String::Manip::mime_url_decode: invalid encoding "
+            "at position " << (ptr - begin) << " in line '";
+
+          ostr.write(src, src_len);
+          ostr << "'";
+
+          throw InvalidArg(ostr.str());
         }
-        
+
+        return out - dest;
       }
       
       void
@@ -1179,40 +1794,171 @@ namespace El
       }
 
       void
-      quoted_printable_encode(const unsigned char* src,
-                              size_t src_len,
-                              std::ostream& dest,
-                              size_t char_per_line)
+      xml_encode(const char* src, std::ostream& dest, unsigned long flags)
         throw(El::Exception)
       {
-        size_t len = 0;
-        
-        for(const unsigned char *p(src), *e(src + src_len); p != e; ++p)
+        std::string res;
+        xml_encode(src, res, flags);
+        dest.write(res.c_str(), res.size());
+      }
+
+      void
+      xml_encode(const char* src, std::string& dest, unsigned long flags)
+        throw(El::Exception)
+      {
+        if(src == 0 || *src == '\0')
         {
-          char ch = *p;
-          
-          bool as_is = (ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z') ||
-            (ch >= '0' && ch <= '9') || ch == '<' || ch == '>' || ch == '"' ||
-            ch == '\'' || ch == '/';
-          
-          len += as_is ? 1 : 3;
+          dest.clear();
+          return;
+        }
 
-          if(len > char_per_line)
+        size_t len = strlen(src);
+        const unsigned char* ptr = (const unsigned char*)src;
+        const unsigned char* end = ptr + len;
+        bool attr = flags & XE_ATTRIBUTE_ENCODING;
+
+        // src can point to dest's buffer
+        std::string res;
+        res.reserve(len + len / 8);
+
+        while(true)
+        {
+          size_t as_is = attr ? Scan::find_first<XmlAttrEscaped>(ptr, end) :
+            Scan::find_first<XmlTextEscaped>(ptr, end);
+
+          res.append((const char*)ptr, as_is);
+          ptr += as_is;
+
+          if(ptr == end)
           {
-            dest << "=\r\n";
-            len = as_is ? 1 : 3;
+            break;
           }
 
-          if(as_is)
+          if(XmlPrintable::match(*ptr))
           {
-            dest << ch;
-          }          
-          else
+            xml_encode_char(*ptr++, res, flags);
+            continue;
+          }
+
+          // Multibyte sequences contain no printable ASCII chars
+          const unsigned char* run_end =
+            ptr + 1 + Scan::find_first<XmlPrintable>(ptr + 1, end);
+
+          if(!xml_encode_utf8(ptr, run_end, res, flags))
+          {
+            // Let UTF-8 decoder report or skip malformed sequences
+            std::wstring val;
+
+            utf8_to_wchar(src,
+                          val,
+                          flags & XE_LAX_ENCODING,
+                          UAC_XML_1_0);
+
+            std::ostringstream ostr;
+            xml_encode(val.c_str(), ostr, flags);
+            dest = ostr.str();
+            return;
+          }
+
+          ptr = run_end;
+        }
+
+        dest.swap(res);
+      }
+
+      void
+      xml_decode(const char* src, std::string& dest)
+        throw(InvalidArg, El::Exception)
+      {
+        if(src == 0)
+        {
+          dest.clear();
+          return;
+        }
+
+        size_t len = strlen(src);
+        const unsigned char* ptr = (const unsigned char*)src;
+        const unsigned char* end = ptr + len;
+
+        if(Scan::find_first<NonAscii>(ptr, end) != len)
+        {
+          std::wstring val;
+          utf8_to_wchar(src, val);
+          xml_decode(val.c_str(), dest);
+          return;
+        }
+
+        std::string res;
+        res.reserve(len);
+
+        while(true)
+        {
+          size_t text = Scan::find_first<Ampersand>(ptr, end);
+
+          res.append((const char*)ptr, text);
+          ptr += text;
+
+          if(ptr == end)
+          {
+            break;
+          }
+
+          const unsigned char* entity_end = ptr + 1;
+
+          for(; entity_end != end && *entity_end != ';' &&
+                *entity_end != '\n' && *entity_end != '\r'; ++entity_end);
+
+          if(entity_end != end)
           {
-            dest << '=' << std::setw(2) << std::setfill('0') << std::uppercase
-                 << std::hex << std::right << (unsigned short)*p;
+            ++entity_end;
           }
+
+          std::wstring entity(ptr, entity_end);
+          wchar_t chr = 0;
+
+          xml_decode_entity(entity.c_str(), chr);
+          wchar_to_utf8(chr, res);
+
+          ptr = entity_end;
         }
+
+        dest.swap(res);
+      }
+
+      void
+      quoted_printable_encode(const unsigned char* src,
+                              size_t src_len,
+                              std::ostream& dest,
+                              size_t char_per_line)
+        throw(El::Exception)
+      {
+        std::string res;
+        res.resize(quoted_printable_encoded_size(src, src_len, char_per_line));
+
+        if(!res.empty())
+        {
+          quoted_printable_encode(src, src_len, &res[0], char_per_line);
+          dest.write(res.c_str(), res.size());
+        }
+      }
+
+      size_t
+      quoted_printable_encoded_size(const unsigned char* src,
+                                    size_t src_len,
+                                    size_t char_per_line)
+        throw()
+      {
+        return encode_quoted_printable(src, src_len, 0, char_per_line);
+      }
+
+      size_t
+      quoted_printable_encode(const unsigned char* src,
+                              size_t src_len,
+                              char* dest,
+                              size_t char_per_line)
+        throw()
+      {
+        return encode_quoted_printable(src, src_len, dest, char_per_line);
       }
 
       void
@@ -1279,66 +2025,100 @@ namespace El
         {
           return;
         }
-        
+
+        std::string res;
+        res.resize(base64_encoded_size(src_len, chunk_per_line));
+        base64_encode(src, src_len, &res[0], chunk_per_line);
+        dest.write(res.c_str(), res.size());
+      }
+
+      size_t
+      base64_encoded_size(size_t src_len, size_t chunk_per_line) throw()
+      {
+        if(src_len == 0)
+        {
+          return 0;
+        }
+
+        size_t chunks = (src_len + 2) / 3;
+
+        // With chunk_per_line == 0 line break is written once before
+        // first chunk
+        return chunks * 4 +
+          (chunk_per_line ? (chunks - 1) / chunk_per_line * 2 : 2);
+      }
+
+      size_t
+      base64_encode(const unsigned char* src,
+                    size_t src_len,
+                    char* dest,
+                    size_t chunk_per_line)
+        throw()
+      {
+        if(src == 0 || src_len == 0)
+        {
+          return 0;
+        }
+
+        const unsigned char* end = src + src_len;
+        char* out = dest;
+
+        if(chunk_per_line == 0)
+        {
+          *out++ = '\r';
+          *out++ = '\n';
+          chunk_per_line = SIZE_MAX;
+        }
+
         size_t triple_count = src_len / 3;
         size_t chunks = 0;
-        
-        for(size_t i = 0; i < triple_count; ++i, ++chunks)
+
+        while(triple_count)
         {
           if(chunks == chunk_per_line)
           {
-            dest << "\r\n";
+            *out++ = '\r';
+            *out++ = '\n';
             chunks = 0;
           }
-          
-          unsigned long i1 = ((*src) >> 2) & 0x3F;
-          unsigned long i2 = (((*src) << 4) & 0x30) | ((src[1] >> 4) & 0xF);
-          src++;
-          
-          unsigned long i3 = (((*src) << 2) & 0x3C) | ((src[1] >> 6) & 0x3);
-          src++;
-          
-          unsigned long i4 = (*src++) & 0x3F;
-          
-          dest << BASE64_CHARS[i1] << BASE64_CHARS[i2] << BASE64_CHARS[i3]
-               << BASE64_CHARS[i4];
+
+          size_t count = std::min(triple_count, chunk_per_line - chunks);
+
+          out = base64_encode_triples(src, count, end, out);
+          src += count * 3;
+          triple_count -= count;
+          chunks += count;
         }
-        
-        switch(src_len % 3)
+
+        size_t rest = src_len % 3;
+
+        if(rest)
         {
-        case 1:
+          if(chunks == chunk_per_line)
           {
-            if(chunks == chunk_per_line)
-            {
-              dest << "\r\n";
-            }
-            
-            dest << BASE64_CHARS[((*src) >> 2) & 0x3F]
-                 << BASE64_CHARS[(((*src) << 4) & 0x30)]
-                 << "==";
-            
-            break;
+            *out++ = '\r';
+            *out++ = '\n';
           }
-        case 2:
-          {
-            if(chunks == chunk_per_line)
-            {
-              dest << "\r\n";
-            }
 
-            unsigned long i1 = ((*src) >> 2) & 0x3F;
-            unsigned long i2 = (((*src) << 4) & 0x30) | ((src[1] >> 4) & 0xF);
-            src++;
+          *out++ = BASE64_CHARS[(src[0] >> 2) & 0x3F];
 
-            unsigned long i3 = (((*src++) << 2) & 0x3C);
-              
-            dest << BASE64_CHARS[i1] << BASE64_CHARS[i2] << BASE64_CHARS[i3]
-                 << "=";
-            
-            break;
+          if(rest == 1)
+          {
+            *out++ = BASE64_CHARS[(src[0] << 4) & 0x30];
+            *out++ = '=';
           }
+          else
+          {
+            *out++ =
+              BASE64_CHARS[((src[0] << 4) & 0x30) | ((src[1] >> 4) & 0xF)];
+
+            *out++ = BASE64_CHARS[(src[1] << 2) & 0x3C];
+          }
+
+          *out++ = '=';
         }
-        
+
+        return out - dest;
       }
 
       static
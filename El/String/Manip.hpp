@@ -57,6 +57,21 @@ namespace El
       void mime_url_decode(const char* from, std::ostream& to)
         throw(InvalidArg, El::Exception);
 
+      //
+      // Buffer oriented versions of functions above and below. Encoders
+      // write exactly the number of chars *_encoded_size functions return;
+      // decoder result is not longer than source. All return number of
+      // chars written to dest.
+      //
+      size_t mime_url_encoded_size(const char* src, size_t src_len)
+        throw();
+
+      size_t mime_url_encode(const char* src, size_t src_len, char* dest)
+        throw();
+
+      size_t mime_url_decode(const char* src, size_t src_len, char* dest)
+        throw(InvalidArg, El::Exception);
+
       //
       // UTF-8 encoding transcoding
       //
@@ -204,6 +219,16 @@ namespace El
                          std::ostream& dest,
                          size_t chunk_per_line = SIZE_MAX)
         throw(El::Exception);
+
+      size_t base64_encoded_size(size_t src_len,
+                                 size_t chunk_per_line = SIZE_MAX)
+        throw();
+
+      size_t base64_encode(const unsigned char* src,
+                           size_t src_len,
+                           char* dest,
+                           size_t chunk_per_line = SIZE_MAX)
+        throw();
       
       void base64_decode(const char* src,
                          unsigned char* dest,
@@ -228,6 +253,17 @@ namespace El
                                    std::ostream& dest,
                                    size_t char_per_line = 76)
         throw(El::Exception);
+
+      size_t quoted_printable_encoded_size(const unsigned char* src,
+                                           size_t src_len,
+                                           size_t char_per_line = 76)
+        throw();
+
+      size_t quoted_printable_encode(const unsigned char* src,
+                                     size_t src_len,
+                                     char* dest,
+                                     size_t char_per_line = 76)
+        throw();
       
       //
       // Punycode encoding
@@ -694,9 +730,15 @@ namespace El
                     std::string& dest)
         throw(El::Exception)
       {
-        std::ostringstream ostr;
-        base64_encode(src, src_len, ostr);
-        dest = ostr.str();
+        std::string res;
+        res.resize(src ? base64_encoded_size(src_len) : 0);
+
+        if(!res.empty())
+        {
+          base64_encode(src, src_len, &res[0]);
+        }
+
+        dest.swap(res);
       }
 
       inline
@@ -731,41 +773,6 @@ namespace El
         dest = ostr.str();
       }
 
-      inline
-      void
-      xml_encode(const char* src, std::ostream& dest, unsigned long flags)
-        throw(El::Exception)
-      {
-        std::wstring val;
-
-        utf8_to_wchar(src,
-                      val,
-                      flags & El::String::Manip::XE_LAX_ENCODING,
-                      UAC_XML_1_0);
-        
-        xml_encode(val.c_str(), dest, flags);
-      }
-
-      inline
-      void
-      xml_encode(const char* src, std::string& dest, unsigned long flags)
-        throw(El::Exception)
-      {
-        std::ostringstream ostr;
-        xml_encode(src, ostr, flags);
-        dest = ostr.str();
-      }
-
-      inline
-      void
-      xml_decode(const char* src, std::string& dest)
-        throw(InvalidArg, El::Exception)
-      {
-        std::wstring val;
-        utf8_to_wchar(src, val);
-        xml_decode(val.c_str(), dest);
-      }
-
       inline
       bool
       uac_xml_1_0_compliant(wchar_t wchr) throw()
@@ -0,0 +1,184 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/String/Scan.hpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#ifndef _ELEMENTS_EL_STRING_SCAN_HPP_
+#define _ELEMENTS_EL_STRING_SCAN_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+namespace El
+{
+  namespace String
+  {
+    //
+    // Byte class scanning 16 bytes at a time where SSE2 is available.
+    // CLASS provides
+    //
+    //   static bool match(unsigned char chr) throw();
+    //
+    // and, if __SSE2__ is defined,
+    //
+    //   static __m128i match(__m128i chr) throw();
+    //
+    // the latter setting bytes of the result to 0xFF for matching bytes
+    // and to 0 for others.
+    //
+    namespace Scan
+    {
+      // Offset of first matching byte; end - begin if none
+      template<typename CLASS>
+      size_t find_first(const unsigned char* begin, const unsigned char* end)
+        throw();
+
+      // Number of matching bytes
+      template<typename CLASS>
+      size_t count(const unsigned char* begin, const unsigned char* end)
+        throw();
+
+      bool in_range(unsigned char chr, unsigned char lo, unsigned char hi)
+        throw();
+
+#ifdef __SSE2__
+      __m128i in_range(__m128i chr, unsigned char lo, unsigned char hi)
+        throw();
+
+      __m128i equal(__m128i chr, char val) throw();
+      __m128i negate(__m128i mask) throw();
+
+      unsigned long trailing_zeros(uint32_t mask) throw();
+      unsigned long bit_count(uint32_t mask) throw();
+#endif
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Inlines
+///////////////////////////////////////////////////////////////////////////////
+
+namespace El
+{
+  namespace String
+  {
+    namespace Scan
+    {
+      inline
+      bool
+      in_range(unsigned char chr, unsigned char lo, unsigned char hi) throw()
+      {
+        return (unsigned char)(chr - lo) <= (unsigned char)(hi - lo);
+      }
+
+#ifdef __SSE2__
+      inline
+      __m128i
+      in_range(__m128i chr, unsigned char lo, unsigned char hi) throw()
+      {
+        // Unsigned chr - lo <= hi - lo
+        __m128i shifted = _mm_sub_epi8(chr, _mm_set1_epi8(lo));
+
+        return _mm_cmpeq_epi8(
+          _mm_min_epu8(shifted, _mm_set1_epi8(hi - lo)), shifted);
+      }
+
+      inline
+      __m128i
+      equal(__m128i chr, char val) throw()
+      {
+        return _mm_cmpeq_epi8(chr, _mm_set1_epi8(val));
+      }
+
+      inline
+      __m128i
+      negate(__m128i mask) throw()
+      {
+        return _mm_xor_si128(mask, _mm_set1_epi8(-1));
+      }
+
+      inline
+      unsigned long
+      trailing_zeros(uint32_t mask) throw()
+      {
+        return __builtin_ctz(mask);
+      }
+
+      inline
+      unsigned long
+      bit_count(uint32_t mask) throw()
+      {
+        return __builtin_popcount(mask);
+      }
+#endif
+
+      template<typename CLASS>
+      size_t
+      find_first(const unsigned char* begin, const unsigned char* end)
+        throw()
+      {
+        const unsigned char* ptr = begin;
+
+#ifdef __SSE2__
+        for(; end - ptr >= 16; ptr += 16)
+        {
+          uint32_t mask = _mm_movemask_epi8(
+            CLASS::match(
+              _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr))));
+
+          if(mask)
+          {
+            return ptr - begin + trailing_zeros(mask);
+          }
+        }
+#endif
+
+        for(; ptr != end && !CLASS::match(*ptr); ++ptr);
+        return ptr - begin;
+      }
+
+      template<typename CLASS>
+      size_t
+      count(const unsigned char* begin, const unsigned char* end) throw()
+      {
+        const unsigned char* ptr = begin;
+        size_t result = 0;
+
+#ifdef __SSE2__
+        for(; end - ptr >= 16; ptr += 16)
+        {
+          result += bit_count(
+            _mm_movemask_epi8(
+              CLASS::match(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr)))));
+        }
+#endif
+
+        for(; ptr != end; ++ptr)
+        {
+          if(CLASS::match(*ptr))
+          {
+            ++result;
+          }
+        }
+
+        return result;
+      }
+    }
+  }
+}
+
+#endif // _ELEMENTS_EL_STRING_SCAN_HPP_
@@ -202,7 +202,7 @@ namespace El
     StringConstPtr::operator()(const El::String::StringConstPtr& str) const
       throw(El::Exception)
     {
-      return str.c_str() ? __gnu_cxx::__stl_hash_string(str.c_str()) : 0;
+      return str.c_str() ? hash64(str.c_str(), strlen(str.c_str())) : 0;
     }
     
   }
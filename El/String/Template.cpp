@@ -141,6 +141,11 @@ namespace El
                           bool lax) const
         throw(VariableNotFound, El::Exception)
       {
+        ReferenceOutput* reference_output =
+          dynamic_cast<ReferenceOutput*>(output.rdbuf());
+
+        bool referenced = false;
+        
         for(ChunkList::const_iterator it(chunks_.begin()), ie(chunks_.end());
             it != ie; ++it)
         {
@@ -168,9 +173,29 @@ namespace El
           else
           {
             variables.chunk(chunk);
-            output << chunk.text;
+
+            if(reference_output &&
+               chunk.text.size() >= REFERENCE_OUTPUT_MIN_SIZE && output.good())
+            {
+              if(!reference_output->write_reference(chunk.text.c_str(),
+                                                    chunk.text.size()))
+              {
+                output.setstate(std::ios::badbit);
+              }
+              
+              referenced = true;
+            }
+            else
+            {
+              output << chunk.text;
+            }
           }
         }
+
+        if(referenced && !reference_output->flush_references())
+        {
+          output.setstate(std::ios::badbit);
+        }
       }
  
       std::string
@@ -19,10 +19,9 @@
 #include <iostream>
 #include <sstream>
 
-#include <ext/hash_map>
-
 #include <El/Exception.hpp>
 #include <El/Hash/Hash.hpp>
+#include <El/Hash/FlatMap.hpp>
 
 namespace El
 {
@@ -67,9 +66,30 @@ namespace El
           throw(ParsingFailed, Exception, El::Exception) = 0;
       };
       
+      //
+      // Stream buffer implementing this interface gets template literal text
+      // by reference instead of copying it. Referenced text stays valid
+      // until flush_references call. Both return false if output failed.
+      //
+      struct ReferenceOutput
+      {
+        virtual ~ReferenceOutput() throw() {}
+
+        virtual bool write_reference(const char* text, size_t size)
+          throw(El::Exception) = 0;
+
+        virtual bool flush_references() throw(El::Exception) = 0;
+      };
+      
       class Parser
       {
       public:
+        //
+        // Literal chunks shorter than this are copied into the output
+        // even if it supports ReferenceOutput
+        //
+        static const size_t REFERENCE_OUTPUT_MIN_SIZE = 256;
+        
         Parser(const char* string,
                const char* var_left_marker,
                const char* var_right_marker,
@@ -109,9 +129,9 @@ namespace El
       };
 
       class VariablesMap : public Variables,
-                           public __gnu_cxx::hash_map<std::string,
-                           std::string,
-                           El::Hash::String>
+                           public El::Hash::FlatMap<std::string,
+                                                    std::string,
+                                                    El::Hash::String>
       {
       public:
         VariablesMap() throw(El::Exception);
@@ -11,12 +11,146 @@
  * $Id:$
  */
 
+#include <string.h>
+
 #include <sstream>
+#include <algorithm>
 
 #include <El/Exception.hpp>
 
 #include "BTreeDBM.hpp"
 
+namespace
+{
+  typedef El::TokyoCabinet::BTreeDBM::Exception Exception;
+
+  // Same order as tccmplexical, the default B-tree comparator
+  inline
+  int
+  compare(const void* abuf, int asiz, const void* bbuf, int bsiz) throw()
+  {
+    int res = memcmp(abuf, bbuf, std::min(asiz, bsiz));
+    return res ? res : asiz - bsiz;
+  }
+
+  struct KeyLess
+  {
+    bool operator()(const El::TokyoCabinet::BTreeDBM::Key& a,
+                    const El::TokyoCabinet::BTreeDBM::Key& b) const throw()
+    {
+      return compare(a.buf, a.size, b.buf, b.size) < 0;
+    }
+  };
+
+  //
+  // Cursor with key and value buffers reused while iterating, so
+  // records are read without per-record memory allocations
+  //
+  class Cursor
+  {
+  public:
+    Cursor(TCBDB* dbm, const char* method)
+      throw(Exception, El::Exception);
+
+    ~Cursor() throw();
+
+    bool first() throw();
+    bool jump(const void *kbuf, int ksiz) throw();
+    bool next() throw();
+
+    // Reads current record into key and value buffers
+    bool read() throw();
+
+    const void* key() const throw() { return tcxstrptr(key_); }
+    int key_size() const throw() { return tcxstrsize(key_); }
+    const void* value() const throw() { return tcxstrptr(value_); }
+    int value_size() const throw() { return tcxstrsize(value_); }
+
+    // Throws if last positioning or reading failed for other reason
+    // than there is no record
+    void check_end() const throw(Exception, El::Exception);
+
+  private:
+    TCBDB* dbm_;
+    const char* method_;
+    BDBCUR* cursor_;
+    TCXSTR* key_;
+    TCXSTR* value_;
+  };
+
+  Cursor::Cursor(TCBDB* dbm, const char* method)
+    throw(Exception, El::Exception)
+      : dbm_(dbm),
+        method_(method),
+        cursor_(tcbdbcurnew(dbm)),
+        key_(tcxstrnew()),
+        value_(tcxstrnew())
+  {
+    if(cursor_ == 0)
+    {
+      int ecode = tcbdbecode(dbm_);
+      std::ostringstream ostr;
+
+      ostr << "::El::TokyoCabinet::BTreeDBM::" << method_
+           << ": tcbdbcurnew failed (" << ecode << "). Description:\n"
+           << tcbdberrmsg(ecode);
+
+      tcxstrdel(key_);
+      tcxstrdel(value_);
+
+      throw Exception(ostr.str());
+    }
+  }
+
+  Cursor::~Cursor() throw()
+  {
+    tcbdbcurdel(cursor_);
+    tcxstrdel(key_);
+    tcxstrdel(value_);
+  }
+
+  bool
+  Cursor::first() throw()
+  {
+    return tcbdbcurfirst(cursor_);
+  }
+
+  bool
+  Cursor::jump(const void *kbuf, int ksiz) throw()
+  {
+    return tcbdbcurjump(cursor_, kbuf, ksiz);
+  }
+
+  bool
+  Cursor::next() throw()
+  {
+    return tcbdbcurnext(cursor_);
+  }
+
+  bool
+  Cursor::read() throw()
+  {
+    return tcbdbcurrec(cursor_, key_, value_);
+  }
+
+  void
+  Cursor::check_end() const throw(Exception, El::Exception)
+  {
+    int ecode = tcbdbecode(dbm_);
+
+    if(ecode != TCENOREC)
+    {
+      std::ostringstream ostr;
+
+      ostr << "::El::TokyoCabinet::BTreeDBM::" << method_
+           << ": cursor operation failed (" << ecode << "). Description:\n"
+           << tcbdberrmsg(ecode);
+
+      throw Exception(ostr.str());
+    }
+  }
+}
+
 namespace El
 {
   namespace TokyoCabinet
@@ -161,7 +295,8 @@ namespace El
     }
       
     void
-    BTreeDBM::erase(const void *kbuf, int ksiz) throw(Exception, El::Exception)
+    BTreeDBM::erase(const void *kbuf, int ksiz)
+      throw(NotFound, Exception, El::Exception)
     {
       if(!tcbdbout(dbm_, kbuf, ksiz))
       {
@@ -171,6 +306,11 @@ namespace El
         ostr << "::El::TokyoCabinet::BTreeDBM::erase: "
           "tcbdbout failed (" << ecode
              << "). Description:\n" << tcbdberrmsg(ecode);
+
+        if(ecode == TCENOREC)
+        {
+          throw NotFound(ostr.str());
+        }
         
         throw Exception(ostr.str());
       }
@@ -221,6 +361,198 @@ namespace El
     {
       return tcbdbpath(dbm_);
     }
+
+    void
+    BTreeDBM::begin_transaction() throw(Exception, El::Exception)
+    {
+      if(!tcbdbtranbegin(dbm_))
+      {
+        int ecode = tcbdbecode(dbm_);
+        std::ostringstream ostr;
+
+        ostr << "::El::TokyoCabinet::BTreeDBM::begin_transaction: "
+          "tcbdbtranbegin failed (" << ecode
+             << "). Description:\n" << tcbdberrmsg(ecode);
+        
+        throw Exception(ostr.str());
+      }
+    }
+
+    void
+    BTreeDBM::commit_transaction() throw(Exception, El::Exception)
+    {
+      if(!tcbdbtrancommit(dbm_))
+      {
+        int ecode = tcbdbecode(dbm_);
+        std::ostringstream ostr;
+
+        ostr << "::El::TokyoCabinet::BTreeDBM::commit_transaction: "
+          "tcbdbtrancommit failed (" << ecode
+             << "). Description:\n" << tcbdberrmsg(ecode);
+        
+        throw Exception(ostr.str());
+      }
+    }
+
+    void
+    BTreeDBM::abort_transaction() throw(Exception, El::Exception)
+    {
+      if(!tcbdbtranabort(dbm_))
+      {
+        int ecode = tcbdbecode(dbm_);
+        std::ostringstream ostr;
+
+        ostr << "::El::TokyoCabinet::BTreeDBM::abort_transaction: "
+          "tcbdbtranabort failed (" << ecode
+             << "). Description:\n" << tcbdberrmsg(ecode);
+        
+        throw Exception(ostr.str());
+      }
+    }
+
+    void
+    BTreeDBM::sync() throw(Exception, El::Exception)
+    {
+      if(!tcbdbsync(dbm_))
+      {
+        int ecode = tcbdbecode(dbm_);
+        std::ostringstream ostr;
+
+        ostr << "::El::TokyoCabinet::BTreeDBM::sync: "
+          "tcbdbsync failed (" << ecode
+             << "). Description:\n" << tcbdberrmsg(ecode);
+        
+        throw Exception(ostr.str());
+      }
+    }
+
+    size_t
+    BTreeDBM::scan(Visitor& visitor,
+                   const void *from,
+                   int from_size,
+                   const void *to,
+                   int to_size,
+                   bool to_inclusive) const
+      throw(Exception, El::Exception)
+    {
+      Cursor cursor(dbm_, "scan");
+      size_t count = 0;
+
+      for(bool found = from ? cursor.jump(from, from_size) : cursor.first();
+          found; found = cursor.next())
+      {
+        if(!cursor.read())
+        {
+          break;
+        }
+
+        if(to)
+        {
+          int res = compare(cursor.key(), cursor.key_size(), to, to_size);
+
+          if(res > 0 || (res == 0 && !to_inclusive))
+          {
+            return count;
+          }
+        }
+
+        ++count;
+
+        if(!visitor.visit(cursor.key(),
+                          cursor.key_size(),
+                          cursor.value(),
+                          cursor.value_size()))
+        {
+          return count;
+        }
+      }
+
+      cursor.check_end();
+      return count;
+    }
+
+    size_t
+    BTreeDBM::scan_prefix(Visitor& visitor,
+                          const void *prefix,
+                          int prefix_size) const
+      throw(Exception, El::Exception)
+    {
+      // Keys with the prefix are less than the prefix with last byte
+      // which is not 0xFF incremented and following bytes cut off
+      std::string to((const char*)prefix, prefix_size);
+
+      while(!to.empty() && (unsigned char)to[to.size() - 1] == 0xFF)
+      {
+        to.resize(to.size() - 1);
+      }
+
+      if(to.empty())
+      {
+        return scan(visitor, prefix, prefix_size);
+      }
+
+      to[to.size() - 1] = (unsigned char)to[to.size() - 1] + 1;
+
+      return scan(visitor, prefix, prefix_size, to.c_str(), to.size());
+    }
+
+    size_t
+    BTreeDBM::find_bulk(const KeyArray& keys, Visitor& visitor) const
+      throw(Exception, El::Exception)
+    {
+      KeyArray sorted(keys);
+      std::sort(sorted.begin(), sorted.end(), KeyLess());
+
+      Cursor cursor(dbm_, "find_bulk");
+      size_t count = 0;
+
+      // Cursor is positioned at the record with the least key not less
+      // than the key looked up, so keys less than the record key are
+      // known to be missed without jumping
+      bool positioned = false;
+
+      for(KeyArray::const_iterator it(sorted.begin()), ie(sorted.end());
+          it != ie; ++it)
+      {
+        if(it != sorted.begin() &&
+           compare(it->buf, it->size, (it - 1)->buf, (it - 1)->size) == 0)
+        {
+          continue;
+        }
+
+        int res = positioned ?
+          compare(it->buf, it->size, cursor.key(), cursor.key_size()) : 1;
+
+        if(res > 0)
+        {
+          if(!cursor.jump(it->buf, it->size) || !cursor.read())
+          {
+            // No more records beyond the key
+            cursor.check_end();
+            return count;
+          }
+
+          positioned = true;
+
+          res = compare(it->buf, it->size, cursor.key(), cursor.key_size());
+        }
+
+        if(res == 0)
+        {
+          ++count;
+
+          if(!visitor.visit(cursor.key(),
+                            cursor.key_size(),
+                            cursor.value(),
+                            cursor.value_size()))
+          {
+            return count;
+          }
+        }
+      }
+
+      return count;
+    }
     
   }
 }
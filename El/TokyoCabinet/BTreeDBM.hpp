@@ -16,6 +16,8 @@
 
 #include <tcbdb.h>
 
+#include <vector>
+
 #include <El/Exception.hpp>
 #include <El/TokyoCabinet/DBM.hpp>
 
@@ -28,6 +30,34 @@ namespace El
     public:
       EL_EXCEPTION(Exception, El::TokyoCabinet::DBM::Exception);
 
+      //
+      // Receives records of scans and bulk lookups. Buffers are reused
+      // between calls, so are valid during the call only. Database should
+      // not be modified from the visit call. Returning false stops the
+      // iteration.
+      //
+      class Visitor
+      {
+      public:
+        virtual bool visit(const void *kbuf,
+                           int ksiz,
+                           const void *vbuf,
+                           int vsiz)
+          throw(El::Exception) = 0;
+
+        virtual ~Visitor() throw() {}
+      };
+
+      struct Key
+      {
+        const void* buf;
+        int size;
+
+        Key(const void* buf_val = 0, int size_val = 0) throw();
+      };
+
+      typedef std::vector<Key> KeyArray;
+
     public:
       
       // Parameters description in
@@ -56,7 +86,7 @@ namespace El
         throw(Exception, El::Exception);
       
       virtual void erase(const void *kbuf, int ksiz)
-        throw(Exception, El::Exception);
+        throw(NotFound, Exception, El::Exception);
 
       virtual void* find(const void *kbuf, int ksiz, int* vsiz = 0) const
         throw(Exception, El::Exception);
@@ -67,6 +97,43 @@ namespace El
         throw(Exception, El::Exception);
       
       virtual const char* path() const throw();
+
+      virtual void begin_transaction() throw(Exception, El::Exception);
+      virtual void commit_transaction() throw(Exception, El::Exception);
+      virtual void abort_transaction() throw(Exception, El::Exception);
+
+      virtual void sync() throw(Exception, El::Exception);
+
+      //
+      // Visits records in key order starting from the first one with key
+      // not less than from (or from the first record if from is null)
+      // until key exceeds to (the last record if to is null); to is
+      // exclusive unless to_inclusive is true. Keys are compared
+      // lexicographically as database uses the default comparator.
+      // Returns number of records visited.
+      //
+      size_t scan(Visitor& visitor,
+                  const void *from = 0,
+                  int from_size = 0,
+                  const void *to = 0,
+                  int to_size = 0,
+                  bool to_inclusive = false) const
+        throw(Exception, El::Exception);
+
+      // Visits records which keys start with prefix
+      size_t scan_prefix(Visitor& visitor,
+                         const void *prefix,
+                         int prefix_size) const
+        throw(Exception, El::Exception);
+
+      //
+      // Visits records found for keys. Keys are looked up in sorted order
+      // which keeps B-tree pages hot in cache, so records are visited in
+      // key order; duplicate keys are visited once. Returns number of
+      // records found.
+      //
+      size_t find_bulk(const KeyArray& keys, Visitor& visitor) const
+        throw(Exception, El::Exception);
       
     protected:
       virtual ~BTreeDBM() throw();      
@@ -88,6 +155,16 @@ namespace El
 {
   namespace TokyoCabinet
   {
+    //
+    // BTreeDBM::Key struct
+    //
+    inline
+    BTreeDBM::Key::Key(const void* buf_val, int size_val) throw()
+        : buf(buf_val),
+          size(size_val)
+    {
+    }
+    
     //
     // BTreeDBM class
     //
@@ -0,0 +1,658 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file   Elements/El/TokyoCabinet/BatchWriter.cpp
+ * @author Karen Arutyunov
+ * $Id:$
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <sstream>
+
+#include <El/Exception.hpp>
+#include <El/Metrics.hpp>
+
+#include "BatchWriter.hpp"
+
+namespace
+{
+  // Approximate memory used by a buffered record besides key and value
+  const size_t RECORD_OVERHEAD = 64;
+
+  El::Metrics::Histogram batch_write_histogram(
+    "el_tokyocabinet_batch_write_seconds",
+    "Time of writing a batch of records in a single transaction");
+
+  El::Metrics::Counter records_written_counter(
+    "el_tokyocabinet_batch_records_total",
+    "Records written by batches");
+}
+
+namespace El
+{
+  namespace TokyoCabinet
+  {
+    BatchWriter::BatchWriter(DBM* dbm,
+                             size_t batch_size,
+                             size_t max_pending_size,
+                             const ACE_Time_Value& commit_period,
+                             bool sync)
+      throw(Exception, El::Exception)
+        : batch_size_(batch_size),
+          max_pending_size_(max_pending_size),
+          commit_period_(commit_period),
+          sync_(sync),
+          changed_(lock_),
+          pending_size_(0),
+          writing_size_(0),
+          blocked_(0),
+          batches_taken_(0),
+          batches_synced_(0),
+          flush_target_(0),
+          stop_(false),
+          closed_(false)
+    {
+      if(dbm == 0)
+      {
+        throw Exception("::El::TokyoCabinet::BatchWriter::BatchWriter: "
+                        "dbm is null");
+      }
+
+      if(batch_size_ == 0 || max_pending_size_ < batch_size_)
+      {
+        std::ostringstream ostr;
+        ostr << "::El::TokyoCabinet::BatchWriter::BatchWriter: "
+          "invalid batch size " << batch_size_ << " or max pending size "
+             << max_pending_size_;
+
+        throw Exception(ostr.str());
+      }
+
+      dbm_ = El::RefCount::add_ref(dbm);
+
+      int error = pthread_create(&thread_, 0, thread_func, this);
+
+      if(error)
+      {
+        std::ostringstream ostr;
+        ostr << "::El::TokyoCabinet::BatchWriter::BatchWriter: "
+          "pthread_create failed. Reason: " << ACE_OS::strerror(error);
+
+        throw Exception(ostr.str());
+      }
+    }
+
+    BatchWriter::~BatchWriter() throw()
+    {
+      try
+      {
+        close();
+      }
+      catch(...)
+      {
+      }
+    }
+
+    void
+    BatchWriter::insert(const void *kbuf, int ksiz, const void *vbuf, int vsiz)
+      throw(Exception, El::Exception)
+    {
+      Guard guard(lock_);
+
+      wait_space("insert", ksiz + vsiz);
+
+      Record& record = add_record(kbuf, ksiz, vsiz);
+      record.value.assign((const char*)vbuf, vsiz);
+      record.erased = false;
+    }
+
+    void
+    BatchWriter::erase(const void *kbuf, int ksiz)
+      throw(Exception, El::Exception)
+    {
+      Guard guard(lock_);
+
+      wait_space("erase", ksiz);
+
+      Record& record = add_record(kbuf, ksiz, 0);
+      record.value.clear();
+      record.erased = true;
+    }
+
+    int
+    BatchWriter::add_int(const void *kbuf, int ksiz, int num)
+      throw(Exception, El::Exception)
+    {
+      Guard guard(lock_);
+
+      wait_space("add_int", ksiz + sizeof(int));
+
+      int value = 0;
+      bool exists = false;
+      bool is_int = true;
+
+      const Record* record =
+        find_record(std::string((const char*)kbuf, ksiz));
+
+      if(record)
+      {
+        exists = !record->erased;
+        is_int = !exists || record->value.size() == sizeof(int);
+
+        if(exists && is_int)
+        {
+          memcpy(&value, record->value.c_str(), sizeof(int));
+        }
+      }
+      else
+      {
+        // Lock is held so the writer thread couldn't take a new batch
+        // with the record meanwhile
+        int vsiz = 0;
+        void* buff = dbm_->find(kbuf, ksiz, &vsiz);
+
+        if(buff)
+        {
+          exists = true;
+          is_int = vsiz == sizeof(int);
+
+          if(is_int)
+          {
+            memcpy(&value, buff, sizeof(int));
+          }
+
+          free(buff);
+        }
+      }
+
+      if(!is_int)
+      {
+        throw Exception("::El::TokyoCabinet::BatchWriter::add_int: "
+                        "existing record is not an integer");
+      }
+
+      value += num;
+
+      Record& new_record = add_record(kbuf, ksiz, sizeof(int));
+      new_record.value.assign((const char*)&value, sizeof(int));
+      new_record.erased = false;
+
+      return value;
+    }
+
+    void*
+    BatchWriter::find(const void *kbuf, int ksiz, int* vsiz) const
+      throw(Exception, El::Exception)
+    {
+      std::string key((const char*)kbuf, ksiz);
+
+      {
+        Guard guard(lock_);
+
+        const Record* record = find_record(key);
+
+        if(record)
+        {
+          if(record->erased)
+          {
+            return 0;
+          }
+
+          // Same as Tokyo Cabinet does, allocated by malloc with
+          // terminating zero appended
+          size_t size = record->value.size();
+          char* buff = (char*)malloc(size + 1);
+
+          if(buff == 0)
+          {
+            throw Exception("::El::TokyoCabinet::BatchWriter::find: "
+                            "malloc failed");
+          }
+
+          memcpy(buff, record->value.c_str(), size);
+          buff[size] = '\0';
+
+          if(vsiz)
+          {
+            *vsiz = size;
+          }
+
+          return buff;
+        }
+      }
+
+      // Record is written already; if it is being modified by now, either
+      // version is ok
+      return dbm_->find(kbuf, ksiz, vsiz);
+    }
+
+    void
+    BatchWriter::clear() throw(Exception, El::Exception)
+    {
+      Guard guard(lock_);
+
+      check_state("clear");
+
+      while(writing_size_ && error_.empty())
+      {
+        wait_condition();
+      }
+
+      check_state("clear");
+
+      pending_.clear();
+      pending_size_ = 0;
+
+      // Lock is held so the writer thread doesn't write meanwhile
+      dbm_->clear();
+    }
+
+    void
+    BatchWriter::copy(const char* path) const throw(Exception, El::Exception)
+    {
+      const_cast<BatchWriter*>(this)->flush();
+      dbm_->copy(path);
+    }
+
+    void
+    BatchWriter::begin_transaction() throw(Exception, El::Exception)
+    {
+      throw Exception("::El::TokyoCabinet::BatchWriter::begin_transaction: "
+                      "not supported");
+    }
+
+    void
+    BatchWriter::commit_transaction() throw(Exception, El::Exception)
+    {
+      throw Exception("::El::TokyoCabinet::BatchWriter::commit_transaction: "
+                      "not supported");
+    }
+
+    void
+    BatchWriter::abort_transaction() throw(Exception, El::Exception)
+    {
+      throw Exception("::El::TokyoCabinet::BatchWriter::abort_transaction: "
+                      "not supported");
+    }
+
+    void
+    BatchWriter::flush() throw(Exception, El::Exception)
+    {
+      Guard guard(lock_);
+
+      if(closed_)
+      {
+        // Everything is flushed on close
+        check_state("flush");
+        return;
+      }
+
+      // Records of the failed batch are pending, so are retried
+      error_.clear();
+
+      // Batch to be taken next holds all records buffered by now; it is
+      // taken even if empty to synchronize previous ones
+      unsigned long long target = batches_taken_ + 1;
+
+      if(flush_target_ < target)
+      {
+        flush_target_ = target;
+        changed_.broadcast();
+      }
+
+      while(batches_synced_ < target && error_.empty())
+      {
+        wait_condition();
+      }
+
+      check_state("flush");
+    }
+
+    void
+    BatchWriter::close() throw(Exception, El::Exception)
+    {
+      {
+        Guard guard(lock_);
+
+        if(closed_)
+        {
+          return;
+        }
+
+        closed_ = true;
+        stop_ = true;
+        flush_target_ = batches_taken_ + 1;
+        error_.clear();
+
+        changed_.broadcast();
+      }
+
+      pthread_join(thread_, 0);
+
+      Guard guard(lock_);
+
+      if(!error_.empty())
+      {
+        throw Exception(error_);
+      }
+    }
+
+    const BatchWriter::Record*
+    BatchWriter::find_record(const std::string& key) const throw()
+    {
+      RecordMap::const_iterator it = pending_.find(key);
+
+      if(it != pending_.end())
+      {
+        return &it->second;
+      }
+
+      it = writing_.find(key);
+      return it == writing_.end() ? 0 : &it->second;
+    }
+
+    BatchWriter::Record&
+    BatchWriter::add_record(const void* kbuf, int ksiz, size_t vsiz)
+      throw(Exception, El::Exception)
+    {
+      if(pending_.empty())
+      {
+        pending_since_ = ACE_OS::gettimeofday();
+      }
+
+      std::pair<RecordMap::iterator, bool> res =
+        pending_.insert(
+          RecordMap::value_type(std::string((const char*)kbuf, ksiz),
+                                Record()));
+
+      if(res.second)
+      {
+        pending_size_ += ksiz + RECORD_OVERHEAD;
+      }
+      else
+      {
+        pending_size_ -= res.first->second.value.size();
+      }
+
+      pending_size_ += vsiz;
+
+      if(pending_size_ >= batch_size_)
+      {
+        changed_.broadcast();
+      }
+
+      return res.first->second;
+    }
+
+    void
+    BatchWriter::wait_space(const char* method, size_t size)
+      throw(Exception, El::Exception)
+    {
+      check_state(method);
+
+      size += RECORD_OVERHEAD;
+
+      // Record bigger than the limit passes when nothing is buffered
+      if(pending_size_ + writing_size_ + size > max_pending_size_ &&
+         (pending_size_ || writing_size_))
+      {
+        ++blocked_;
+        changed_.broadcast();
+
+        try
+        {
+          do
+          {
+            wait_condition();
+          }
+          while(pending_size_ + writing_size_ + size > max_pending_size_ &&
+                (pending_size_ || writing_size_) && error_.empty() &&
+                !closed_);
+        }
+        catch(...)
+        {
+          --blocked_;
+          throw;
+        }
+
+        --blocked_;
+      }
+
+      check_state(method);
+    }
+
+    void
+    BatchWriter::check_state(const char* method) const throw(Exception)
+    {
+      if(!error_.empty())
+      {
+        std::ostringstream ostr;
+        ostr << "::El::TokyoCabinet::BatchWriter::" << method
+             << ": writing failed. Description:\n" << error_;
+
+        throw Exception(ostr.str());
+      }
+
+      if(closed_ && strcmp(method, "flush"))
+      {
+        std::ostringstream ostr;
+        ostr << "::El::TokyoCabinet::BatchWriter::" << method
+             << ": writer is closed";
+
+        throw Exception(ostr.str());
+      }
+    }
+
+    void
+    BatchWriter::wait_condition(const ACE_Time_Value* abstime)
+      throw(Exception, El::Exception)
+    {
+      if(changed_.wait(abstime))
+      {
+        int error = ACE_OS::last_error();
+
+        if(abstime && error == ETIME)
+        {
+          return;
+        }
+
+        std::ostringstream ostr;
+        ostr << "::El::TokyoCabinet::BatchWriter::wait_condition: "
+          "changed_.wait() failed. Errno " << error << ". Description:\n"
+             << ACE_OS::strerror(error);
+
+        throw Exception(ostr.str());
+      }
+    }
+
+    void
+    BatchWriter::write(const RecordMap& records) throw(El::Exception)
+    {
+      El::Metrics::Timing timing(batch_write_histogram);
+
+      dbm_->begin_transaction();
+
+      try
+      {
+        for(RecordMap::const_iterator it(records.begin()),
+              ie(records.end()); it != ie; ++it)
+        {
+          const std::string& key = it->first;
+          const Record& record = it->second;
+
+          if(record.erased)
+          {
+            try
+            {
+              dbm_->erase(key.c_str(), key.size());
+            }
+            catch(const DBM::NotFound&)
+            {
+            }
+          }
+          else
+          {
+            dbm_->insert(key.c_str(),
+                         key.size(),
+                         record.value.c_str(),
+                         record.value.size());
+          }
+        }
+
+        dbm_->commit_transaction();
+      }
+      catch(...)
+      {
+        try
+        {
+          dbm_->abort_transaction();
+        }
+        catch(...)
+        {
+        }
+
+        timing.cancel();
+        throw;
+      }
+
+      records_written_counter.increment(records.size());
+    }
+
+    void
+    BatchWriter::restore_batch() throw(El::Exception)
+    {
+      for(RecordMap::const_iterator it(writing_.begin()), ie(writing_.end());
+          it != ie; ++it)
+      {
+        if(pending_.insert(*it).second)
+        {
+          pending_size_ +=
+            it->first.size() + it->second.value.size() + RECORD_OVERHEAD;
+        }
+      }
+
+      if(!writing_.empty())
+      {
+        pending_since_ = ACE_OS::gettimeofday();
+      }
+
+      writing_.clear();
+      writing_size_ = 0;
+    }
+
+    void*
+    BatchWriter::thread_func(void* arg) throw()
+    {
+      static_cast<BatchWriter*>(arg)->run();
+      return 0;
+    }
+
+    void
+    BatchWriter::run() throw()
+    {
+      Guard guard(lock_);
+
+      while(true)
+      {
+        std::string error;
+
+        try
+        {
+          // Nothing is taken after failure until flush retries
+          bool failed = !error_.empty();
+
+          bool take = !failed && (pending_size_ >= batch_size_ ||
+                                  flush_target_ > batches_taken_);
+
+          if(!take && !failed && !pending_.empty())
+          {
+            take = stop_ || blocked_ ||
+              ACE_OS::gettimeofday() >= pending_since_ + commit_period_;
+          }
+
+          if(!take)
+          {
+            if(stop_)
+            {
+              break;
+            }
+
+            ACE_Time_Value abstime = pending_since_ + commit_period_;
+            wait_condition(pending_.empty() || failed ? 0 : &abstime);
+            continue;
+          }
+
+          writing_.swap(pending_);
+          writing_size_ = pending_size_;
+          pending_size_ = 0;
+
+          unsigned long long batch = ++batches_taken_;
+          bool sync = sync_ || flush_target_ >= batch;
+
+          // Records being written are still found by other threads as
+          // the writer thread only reads writing_ map without lock
+          guard.release();
+
+          try
+          {
+            if(!writing_.empty())
+            {
+              write(writing_);
+            }
+
+            if(sync)
+            {
+              dbm_->sync();
+            }
+          }
+          catch(const El::Exception& e)
+          {
+            std::ostringstream ostr;
+            ostr << "batch " << batch << " of " << writing_.size()
+                 << " records failed. Description:\n" << e.what();
+
+            error = ostr.str();
+          }
+
+          guard.acquire();
+
+          if(error.empty())
+          {
+            writing_.clear();
+            writing_size_ = 0;
+
+            if(sync)
+            {
+              batches_synced_ = batch;
+            }
+          }
+          else
+          {
+            restore_batch();
+          }
+        }
+        catch(const El::Exception& e)
+        {
+          error = e.what();
+        }
+
+        if(!error.empty())
+        {
+          // Writer stays in failed state until flush is called; records
+          // are kept to be retried and are still found meanwhile
+          error_ = error;
+        }
+
+        changed_.broadcast();
+      }
+    }
+  }
+}
@@ -0,0 +1,237 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file   Elements/El/TokyoCabinet/BatchWriter.hpp
+ * @author Karen Arutyunov
+ * $Id:$
+ */
+
+#ifndef _ELEMENTS_EL_TOKYOCABINET_BATCHWRITER_HPP_
+#define _ELEMENTS_EL_TOKYOCABINET_BATCHWRITER_HPP_
+
+#include <pthread.h>
+
+#include <string>
+#include <ext/hash_map>
+
+#include <ace/OS.h>
+#include <ace/Synch.h>
+#include <ace/Guard_T.h>
+
+#include <El/Exception.hpp>
+#include <El/Hash/Hash.hpp>
+#include <El/TokyoCabinet/DBM.hpp>
+
+namespace El
+{
+  namespace TokyoCabinet
+  {
+    //
+    // Buffers modifications of the database and applies them by batches
+    // from a background thread, each batch in a single transaction.
+    // Records modified are visible to find calls of any thread right
+    // away. When size of buffered records (including ones being written)
+    // reaches max_pending_size modifying calls block until the writer
+    // thread catches up.
+    //
+    // While the object exists the database should not be modified
+    // directly as such modifications would become a part of a batch
+    // transaction.
+    //
+    class BatchWriter : public virtual DBM
+    {
+    public:
+      EL_EXCEPTION(Exception, El::TokyoCabinet::DBM::Exception);
+
+    public:
+
+      //
+      // Batch is written when its size reaches batch_size, or on
+      // commit_period expiration, or when flush is called. If sync is
+      // true, database is synchronized with the device after each batch.
+      //
+      BatchWriter(DBM* dbm,
+                  size_t batch_size = 4 * 1024 * 1024,
+                  size_t max_pending_size = 64 * 1024 * 1024,
+                  const ACE_Time_Value& commit_period = ACE_Time_Value(1),
+                  bool sync = false)
+        throw(Exception, El::Exception);
+
+      virtual void insert(const void *kbuf,
+                          int ksiz,
+                          const void *vbuf,
+                          int vsiz)
+        throw(Exception, El::Exception);
+
+      // Operation is applied to the latest value of the record
+      virtual int add_int(const void *kbuf, int ksiz, int num)
+        throw(Exception, El::Exception);
+
+      // Erasing of record which doesn't exist is not an error
+      virtual void erase(const void *kbuf, int ksiz)
+        throw(Exception, El::Exception);
+
+      virtual void* find(const void *kbuf, int ksiz, int* vsiz = 0) const
+        throw(Exception, El::Exception);
+
+      virtual void clear() throw(Exception, El::Exception);
+
+      virtual void copy(const char* path) const
+        throw(Exception, El::Exception);
+
+      virtual const char* path() const throw();
+
+      // Batches are transactions already, so not supported
+      virtual void begin_transaction() throw(Exception, El::Exception);
+      virtual void commit_transaction() throw(Exception, El::Exception);
+      virtual void abort_transaction() throw(Exception, El::Exception);
+
+      // Same as flush
+      virtual void sync() throw(Exception, El::Exception);
+
+      //
+      // Returns when all modifications made before the call are written
+      // and database is synchronized with the device. If a batch failed
+      // to be written, its records are kept buffered and modifying calls
+      // throw until flush retries writing them and succeeds; the error
+      // names the failed batch.
+      //
+      void flush() throw(Exception, El::Exception);
+
+      //
+      // Flushes modifications and stops the writer thread; the object
+      // can't be modified after that. Records of a failed batch are
+      // retried once. Called on destruction if not called explicitly.
+      //
+      void close() throw(Exception, El::Exception);
+
+      // Size of records buffered and not written yet; limited by
+      // max_pending_size
+      size_t pending_size() const throw();
+
+    protected:
+      virtual ~BatchWriter() throw();
+
+    private:
+      struct Record
+      {
+        std::string value;
+        bool erased;
+
+        Record() throw() : erased(false) {}
+      };
+
+      typedef __gnu_cxx::hash_map<std::string, Record, El::Hash::String>
+      RecordMap;
+
+      const Record* find_record(const std::string& key) const throw();
+
+      Record& add_record(const void* kbuf, int ksiz, size_t vsiz)
+        throw(Exception, El::Exception);
+
+      void wait_space(const char* method, size_t size)
+        throw(Exception, El::Exception);
+
+      void write(const RecordMap& records) throw(El::Exception);
+
+      // Returns records of the failed batch to pending ones unless
+      // modified meanwhile
+      void restore_batch() throw(El::Exception);
+
+      void check_state(const char* method) const throw(Exception);
+
+      void wait_condition(const ACE_Time_Value* abstime = 0)
+        throw(Exception, El::Exception);
+
+      static void* thread_func(void* arg) throw();
+      void run() throw();
+
+    private:
+      BatchWriter(const BatchWriter&);
+      void operator=(const BatchWriter&);
+
+    private:
+      typedef ACE_Thread_Mutex Mutex;
+      typedef ACE_Guard<Mutex> Guard;
+      typedef ACE_Condition<Mutex> Condition;
+
+      DBM_var dbm_;
+
+      size_t batch_size_;
+      size_t max_pending_size_;
+      ACE_Time_Value commit_period_;
+      bool sync_;
+
+      mutable Mutex lock_;
+      Condition changed_;
+
+      // Records being buffered and being written by the thread
+      RecordMap pending_;
+      RecordMap writing_;
+      size_t pending_size_;
+      size_t writing_size_;
+
+      // Number of callers waiting for buffer space
+      unsigned long blocked_;
+
+      // Time the oldest pending record was buffered at
+      ACE_Time_Value pending_since_;
+
+      // Batches are numbered when taken for writing
+      unsigned long long batches_taken_;
+      unsigned long long batches_synced_;
+
+      // Number of the batch flush callers wait to be synced
+      unsigned long long flush_target_;
+
+      std::string error_;
+      bool stop_;
+      bool closed_;
+      pthread_t thread_;
+    };
+
+    typedef RefCount::SmartPtr<BatchWriter> BatchWriter_var;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Inlines
+///////////////////////////////////////////////////////////////////////////////
+
+namespace El
+{
+  namespace TokyoCabinet
+  {
+    //
+    // BatchWriter class
+    //
+    inline
+    const char*
+    BatchWriter::path() const throw()
+    {
+      return dbm_->path();
+    }
+
+    inline
+    void
+    BatchWriter::sync() throw(Exception, El::Exception)
+    {
+      flush();
+    }
+
+    inline
+    size_t
+    BatchWriter::pending_size() const throw()
+    {
+      Guard guard(lock_);
+      return pending_size_ + writing_size_;
+    }
+  }
+}
+
+#endif // _ELEMENTS_EL_TOKYOCABINET_BATCHWRITER_HPP_
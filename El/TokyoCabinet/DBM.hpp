@@ -29,6 +29,9 @@ namespace El
     public:
       EL_EXCEPTION(Exception, El::TokyoCabinet::Exception);
 
+      // Thrown by erase if record doesn't exist
+      EL_EXCEPTION(NotFound, Exception);
+
       virtual void insert(const void *kbuf,
                           int ksiz,
                           const void *vbuf,
@@ -39,7 +42,7 @@ namespace El
         throw(Exception, El::Exception) = 0;
       
       virtual void erase(const void *kbuf, int ksiz)
-        throw(Exception, El::Exception) = 0;
+        throw(NotFound, Exception, El::Exception) = 0;
 
       virtual void* find(const void *kbuf, int ksiz, int* vsiz = 0) const
         throw(Exception, El::Exception) = 0;
@@ -51,6 +54,21 @@ namespace El
 
       virtual const char* path() const throw() = 0;
 
+      //
+      // Modifications made between begin_transaction and
+      // commit_transaction calls are applied atomically. Modifications
+      // made by other threads meanwhile become a part of the transaction.
+      // By default modifications are applied right away, so beginning
+      // and committing do nothing while aborting is not supported.
+      //
+      virtual void begin_transaction() throw(Exception, El::Exception);
+      virtual void commit_transaction() throw(Exception, El::Exception);
+      virtual void abort_transaction() throw(Exception, El::Exception);
+
+      // Synchronizes database content with the device; does nothing by
+      // default
+      virtual void sync() throw(Exception, El::Exception);
+
     protected:
       virtual ~DBM() throw() {}
     };
@@ -67,6 +85,34 @@ namespace El
 {
   namespace TokyoCabinet
   {
+    //
+    // DBM class
+    //
+    inline
+    void
+    DBM::begin_transaction() throw(Exception, El::Exception)
+    {
+    }
+
+    inline
+    void
+    DBM::commit_transaction() throw(Exception, El::Exception)
+    {
+    }
+
+    inline
+    void
+    DBM::abort_transaction() throw(Exception, El::Exception)
+    {
+      throw Exception("::El::TokyoCabinet::DBM::abort_transaction: "
+                      "not supported");
+    }
+
+    inline
+    void
+    DBM::sync() throw(Exception, El::Exception)
+    {
+    }
   }
 }
 
@@ -188,7 +188,8 @@ namespace El
     }
       
     void
-    HashDBM::erase(const void *kbuf, int ksiz) throw(Exception, El::Exception)
+    HashDBM::erase(const void *kbuf, int ksiz)
+      throw(NotFound, Exception, El::Exception)
     {
       if(!tchdbout(dbm_, kbuf, ksiz))
       {
@@ -198,6 +199,11 @@ namespace El
         ostr << "::El::TokyoCabinet::HashDBM::erase: "
           "tchdbout failed (" << ecode
              << "). Description:\n" << tchdberrmsg(ecode);
+
+        if(ecode == TCENOREC)
+        {
+          throw NotFound(ostr.str());
+        }
         
         throw Exception(ostr.str());
       }
@@ -248,6 +254,70 @@ namespace El
     {
       return tchdbpath(dbm_);
     }
+
+    void
+    HashDBM::begin_transaction() throw(Exception, El::Exception)
+    {
+      if(!tchdbtranbegin(dbm_))
+      {
+        int ecode = tchdbecode(dbm_);
+        std::ostringstream ostr;
+
+        ostr << "::El::TokyoCabinet::HashDBM::begin_transaction: "
+          "tchdbtranbegin failed (" << ecode
+             << "). Description:\n" << tchdberrmsg(ecode);
+        
+        throw Exception(ostr.str());
+      }
+    }
+
+    void
+    HashDBM::commit_transaction() throw(Exception, El::Exception)
+    {
+      if(!tchdbtrancommit(dbm_))
+      {
+        int ecode = tchdbecode(dbm_);
+        std::ostringstream ostr;
+
+        ostr << "::El::TokyoCabinet::HashDBM::commit_transaction: "
+          "tchdbtrancommit failed (" << ecode
+             << "). Description:\n" << tchdberrmsg(ecode);
+        
+        throw Exception(ostr.str());
+      }
+    }
+
+    void
+    HashDBM::abort_transaction() throw(Exception, El::Exception)
+    {
+      if(!tchdbtranabort(dbm_))
+      {
+        int ecode = tchdbecode(dbm_);
+        std::ostringstream ostr;
+
+        ostr << "::El::TokyoCabinet::HashDBM::abort_transaction: "
+          "tchdbtranabort failed (" << ecode
+             << "). Description:\n" << tchdberrmsg(ecode);
+        
+        throw Exception(ostr.str());
+      }
+    }
+
+    void
+    HashDBM::sync() throw(Exception, El::Exception)
+    {
+      if(!tchdbsync(dbm_))
+      {
+        int ecode = tchdbecode(dbm_);
+        std::ostringstream ostr;
+
+        ostr << "::El::TokyoCabinet::HashDBM::sync: "
+          "tchdbsync failed (" << ecode
+             << "). Description:\n" << tchdberrmsg(ecode);
+        
+        throw Exception(ostr.str());
+      }
+    }
     
   }
 }
@@ -58,7 +58,7 @@ namespace El
         throw(Exception, El::Exception);
       
       virtual void erase(const void *kbuf, int ksiz)
-        throw(Exception, El::Exception);
+        throw(NotFound, Exception, El::Exception);
 
       virtual void* find(const void *kbuf, int ksiz, int* vsiz = 0) const
         throw(Exception, El::Exception);
@@ -69,6 +69,12 @@ namespace El
         throw(Exception, El::Exception);
       
       virtual const char* path() const throw();
+
+      virtual void begin_transaction() throw(Exception, El::Exception);
+      virtual void commit_transaction() throw(Exception, El::Exception);
+      virtual void abort_transaction() throw(Exception, El::Exception);
+
+      virtual void sync() throw(Exception, El::Exception);
       
     protected:
       virtual ~HashDBM() throw();      
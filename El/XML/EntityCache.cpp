@@ -0,0 +1,122 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/XML/EntityCache.cpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#include <ace/OS.h>
+
+#include <El/Exception.hpp>
+
+#include "EntityCache.hpp"
+
+namespace El
+{
+  namespace XML
+  {
+    //
+    // EntityCache class
+    //
+    EntityCache::Content*
+    EntityCache::find(const char* key) throw(El::Exception)
+    {
+      time_t now = ACE_OS::gettimeofday().sec();
+
+      Guard guard(lock_);
+
+      NodeMap::iterator mit = map_.find(key);
+
+      if(mit == map_.end())
+      {
+        ++stat_.misses;
+        return 0;
+      }
+
+      NodeList::iterator it = mit->second;
+
+      if(it->expire <= now)
+      {
+        remove(it);
+
+        ++stat_.expirations;
+        ++stat_.misses;
+        return 0;
+      }
+
+      if(it != lru_.begin())
+      {
+        lru_.splice(lru_.begin(), lru_, it);
+      }
+
+      ++stat_.hits;
+      return El::RefCount::add_ref(it->content.in());
+    }
+
+    EntityCache::Content*
+    EntityCache::insert(const char* key, std::string& data)
+      throw(El::Exception)
+    {
+      Content_var content = new Content(data);
+      size_t size = content->size();
+
+      if(size > max_entry_size_ || (max_bytes_ && size > max_bytes_))
+      {
+        Guard guard(lock_);
+        ++stat_.rejections;
+
+        return content.retn();
+      }
+
+      time_t expire = ACE_OS::gettimeofday().sec() + entry_timeout_;
+
+      Guard guard(lock_);
+
+      NodeMap::iterator mit = map_.find(key);
+
+      if(mit != map_.end())
+      {
+        remove(mit->second);
+      }
+
+      while(!lru_.empty() &&
+            ((max_entries_ && map_.size() >= max_entries_) ||
+             (max_bytes_ && stat_.bytes + size > max_bytes_)))
+      {
+        remove(--lru_.end());
+        ++stat_.evictions;
+      }
+
+      lru_.push_front(Node(key, content.in(), expire));
+      map_[lru_.front().key] = lru_.begin();
+      stat_.bytes += size;
+
+      return content.retn();
+    }
+
+    void
+    EntityCache::clear() throw()
+    {
+      Guard guard(lock_);
+
+      map_.clear();
+      lru_.clear();
+      stat_.bytes = 0;
+    }
+
+    void
+    EntityCache::remove(NodeList::iterator it) throw()
+    {
+      stat_.bytes -= it->content->size();
+
+      map_.erase(it->key);
+      lru_.erase(it);
+    }
+  }
+}
@@ -0,0 +1,241 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/XML/EntityCache.hpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#ifndef _ELEMENTS_EL_XML_ENTITYCACHE_HPP_
+#define _ELEMENTS_EL_XML_ENTITYCACHE_HPP_
+
+#include <string>
+#include <list>
+
+#include <ace/OS.h>
+#include <ace/Synch.h>
+#include <ace/Guard_T.h>
+
+#include <El/Exception.hpp>
+#include <El/RefCount/All.hpp>
+#include <El/SyncPolicy.hpp>
+#include <El/Hash/Hash.hpp>
+#include <El/Hash/FlatMap.hpp>
+
+namespace El
+{
+  namespace XML
+  {
+    //
+    // In-memory tier in front of EntityResolver file cache. Keeps bodies
+    // of recently resolved external entities (DTDs, schemas) keyed by
+    // system id, so hot ones are served without touching file system.
+    // Can be shared by any number of resolvers in any threads.
+    //
+    class EntityCache :
+      public virtual El::RefCount::DefaultImpl<El::Sync::ThreadPolicy>
+    {
+    public:
+      EL_EXCEPTION(Exception, El::ExceptionBase);
+
+      class Content :
+        public virtual El::RefCount::DefaultImpl<El::Sync::ThreadPolicy>
+      {
+      public:
+        Content(std::string& data) throw(El::Exception);
+        virtual ~Content() throw() {}
+
+        const char* data() const throw() { return data_.c_str(); }
+        size_t size() const throw() { return data_.size(); }
+
+      private:
+        std::string data_;
+      };
+
+      typedef El::RefCount::SmartPtr<Content> Content_var;
+
+      struct Stat
+      {
+        // Lookups served from memory
+        unsigned long long hits;
+
+        // Lookups found no entry or expired one
+        unsigned long long misses;
+
+        // Entities currently cached and their bytes
+        unsigned long long entries;
+        unsigned long long bytes;
+
+        // Entries removed to fit max_entries or max_bytes
+        unsigned long long evictions;
+
+        // Entries removed being older than entry_timeout
+        unsigned long long expirations;
+
+        // Entities not cached being bigger than max_entry_size
+        unsigned long long rejections;
+
+        Stat() throw();
+
+        double hit_ratio() const throw();
+      };
+
+    public:
+      //
+      // 0 for max_entries or max_bytes means unlimited. Entity stays in
+      // memory not longer than entry_timeout, so it is periodically
+      // revalidated against file cache and network as before.
+      //
+      EntityCache(size_t max_entries = 256,
+                  size_t max_bytes = 1024 * 1024 * 32,
+                  size_t max_entry_size = 1024 * 1024 * 2,
+                  time_t entry_timeout = 3600)
+        throw(Exception, El::Exception);
+
+      virtual ~EntityCache() throw() {}
+
+      // Returns 0 if not found
+      Content* find(const char* key) throw(El::Exception);
+
+      //
+      // Takes content of data (leaving it empty) and returns cached
+      // object. Content is returned even if not admitted to cache.
+      //
+      Content* insert(const char* key, std::string& data)
+        throw(El::Exception);
+
+      void clear() throw();
+
+      Stat stat() const throw();
+
+    private:
+
+      struct Node
+      {
+        std::string key;
+        Content_var content;
+        time_t expire;
+
+        Node(const char* k, Content* c, time_t exp) throw(El::Exception);
+      };
+
+      // Most recently used in front
+      typedef std::list<Node> NodeList;
+
+      typedef El::Hash::FlatMap<std::string,
+                                NodeList::iterator,
+                                El::Hash::String>
+      NodeMap;
+
+      typedef ACE_Thread_Mutex Mutex;
+      typedef ACE_Guard<Mutex> Guard;
+
+      void remove(NodeList::iterator it) throw();
+
+    private:
+      size_t max_entries_;
+      size_t max_bytes_;
+      size_t max_entry_size_;
+      time_t entry_timeout_;
+
+      mutable Mutex lock_;
+      NodeList lru_;
+      NodeMap map_;
+      Stat stat_;
+
+    private:
+      EntityCache(const EntityCache&);
+      void operator=(const EntityCache&);
+    };
+
+    typedef El::RefCount::SmartPtr<EntityCache> EntityCache_var;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Inlines
+///////////////////////////////////////////////////////////////////////////////
+
+namespace El
+{
+  namespace XML
+  {
+    //
+    // EntityCache::Content class
+    //
+    inline
+    EntityCache::Content::Content(std::string& data) throw(El::Exception)
+    {
+      data_.swap(data);
+    }
+
+    //
+    // EntityCache::Stat struct
+    //
+    inline
+    EntityCache::Stat::Stat() throw()
+        : hits(0),
+          misses(0),
+          entries(0),
+          bytes(0),
+          evictions(0),
+          expirations(0),
+          rejections(0)
+    {
+    }
+
+    inline
+    double
+    EntityCache::Stat::hit_ratio() const throw()
+    {
+      unsigned long long requests = hits + misses;
+      return requests ? (double)hits / requests : 0;
+    }
+
+    //
+    // EntityCache::Node struct
+    //
+    inline
+    EntityCache::Node::Node(const char* k, Content* c, time_t exp)
+      throw(El::Exception)
+        : key(k),
+          content(El::RefCount::add_ref(c)),
+          expire(exp)
+    {
+    }
+
+    //
+    // EntityCache class
+    //
+    inline
+    EntityCache::EntityCache(size_t max_entries,
+                             size_t max_bytes,
+                             size_t max_entry_size,
+                             time_t entry_timeout)
+      throw(Exception, El::Exception)
+        : max_entries_(max_entries),
+          max_bytes_(max_bytes),
+          max_entry_size_(max_entry_size),
+          entry_timeout_(entry_timeout)
+    {
+    }
+
+    inline
+    EntityCache::Stat
+    EntityCache::stat() const throw()
+    {
+      Guard guard(lock_);
+
+      Stat st(stat_);
+      st.entries = map_.size();
+      return st;
+    }
+  }
+}
+
+#endif // _ELEMENTS_EL_XML_ENTITYCACHE_HPP_
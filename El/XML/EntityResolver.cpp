@@ -20,6 +20,8 @@
 
 #include <ace/OS.h>
 
+#include <xercesc/util/BinMemInputStream.hpp>
+
 #include <El/Exception.hpp>
 #include <El/ArrayPtr.hpp>
 #include <El/String/Manip.hpp>
@@ -103,7 +105,8 @@ namespace El
         return new InputSource(publicId,
                                systemId,
                                net_strategy_,
-                               file_strategy_);
+                               file_strategy_,
+                               entity_cache_.in());
       }
       catch(const El::Exception& e)
       {
@@ -122,10 +125,12 @@ namespace El
       const XMLCh* const publicId,
       const XMLCh* const systemId,
       const NetStrategy& net_strategy,
-      const FileStrategy& file_strategy)
+      const FileStrategy& file_strategy,
+      EntityCache* entity_cache)
       throw(El::Exception)
         : net_strategy_(net_strategy),
-          file_strategy_(file_strategy)
+          file_strategy_(file_strategy),
+          entity_cache_(El::RefCount::add_ref(entity_cache))
     {
       if(publicId)
       {
@@ -151,7 +156,8 @@ namespace El
       return new InputStream(pub_id_.c_str(),
                              sys_id_.c_str(),
                              net_strategy_,
-                             file_strategy_);
+                             file_strategy_,
+                             entity_cache_.in());
     }
 
     //
@@ -161,13 +167,30 @@ namespace El
       const char* pub_id,
       const char* sys_id,
       const NetStrategy& net_strategy,
-      const FileStrategy& file_strategy)
+      const FileStrategy& file_strategy,
+      EntityCache* entity_cache)
       throw(xercesc::SAXException)
     {
 //      std::cerr << "IS: " << pub_id << "===" << sys_id << std::endl;
 
       try
       {
+        if(entity_cache)
+        {
+          content_ = entity_cache->find(sys_id);
+
+          if(content_.in())
+          {
+            stream_.reset(
+              new xercesc::BinMemInputStream(
+                (const XMLByte*)content_->data(),
+                content_->size(),
+                xercesc::BinMemInputStream::BufOpt_Reference));
+
+            return;
+          }
+        }
+        
         if(file_strategy.cache_dir.empty())
         {
           create_network_stream(pub_id,
@@ -181,7 +204,11 @@ namespace El
                              net_strategy,
                              file_strategy);
         }
-        
+
+        if(entity_cache)
+        {
+          cache_stream(sys_id, entity_cache);
+        }
       }
       catch(const El::Exception& e)
       {
@@ -478,6 +505,34 @@ namespace El
                   file_strategy.cache_file_expire);
     }
 
+    void
+    EntityResolver::InputSource::InputStream::cache_stream(
+      const char* sys_id,
+      EntityCache* entity_cache)
+      throw(xercesc::SAXException, El::Exception)
+    {
+      std::string data;
+      XMLByte buff[4096];
+
+      for(XMLSize_t read = 0;
+          (read = stream_->readBytes(buff, sizeof(buff))) > 0; )
+      {
+        data.append((const char*)buff, read);
+      }
+
+      stream_.reset(0);
+      session_.reset(0);
+      file_.close();
+      
+      content_ = entity_cache->insert(sys_id, data);
+
+      stream_.reset(
+        new xercesc::BinMemInputStream(
+          (const XMLByte*)content_->data(),
+          content_->size(),
+          xercesc::BinMemInputStream::BufOpt_Reference));
+    }
+
     void
     EntityResolver::InputSource::InputStream::clean_cache(
       const char* cache_dir,
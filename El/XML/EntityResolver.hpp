@@ -31,6 +31,7 @@
 #include <El/Exception.hpp>
 #include <El/Net/HTTP/Session.hpp>
 #include <El/XML/InputStream.hpp>
+#include <El/XML/EntityCache.hpp>
 
 namespace El
 {
@@ -79,9 +80,16 @@ namespace El
       };
       
     public:
-      
+
+      //
+      // If entity_cache specified entities are served from it when
+      // possible; on miss entity is loaded as usual (through file cache if
+      // configured) and put to entity_cache. The cache can be shared
+      // between resolvers.
+      //
       EntityResolver(const NetStrategy& net_strategy = NetStrategy(),
-                     const FileStrategy& file_strategy = FileStrategy())
+                     const FileStrategy& file_strategy = FileStrategy(),
+                     EntityCache* entity_cache = 0)
         throw(El::Exception);
 
       virtual xercesc::InputSource* resolveEntity(const XMLCh* const publicId,
@@ -96,7 +104,8 @@ namespace El
         InputSource(const XMLCh* const publicId,
                     const XMLCh* const systemId,
                     const NetStrategy& net_strategy,
-                    const FileStrategy& file_strategy)
+                    const FileStrategy& file_strategy,
+                    EntityCache* entity_cache)
           throw(El::Exception);
       
         virtual xercesc::BinInputStream* makeStream() const
@@ -110,7 +119,8 @@ namespace El
           InputStream(const char* pub_id,
                       const char* sys_id,
                       const NetStrategy& net_strategy,
-                      const FileStrategy& file_strategy)
+                      const FileStrategy& file_strategy,
+                      EntityCache* entity_cache)
             throw(xercesc::SAXException);
       
           virtual XMLFilePos curPos() const throw();
@@ -140,6 +150,9 @@ namespace El
             const FileStrategy& file_strategy)
             throw(xercesc::SAXException, El::Exception);
           
+          void cache_stream(const char* sys_id, EntityCache* entity_cache)
+            throw(xercesc::SAXException, El::Exception);
+
           void clean_cache(const char* cache_dir,
                            time_t cache_clean_period,
                            time_t cache_file_expire) const
@@ -148,7 +161,8 @@ namespace El
         protected:
           std::fstream file_;
           std::auto_ptr<El::Net::HTTP::Session> session_;
-          std::auto_ptr<El::XML::InputStream> stream_;
+          std::auto_ptr<xercesc::BinInputStream> stream_;
+          EntityCache::Content_var content_;
 
         private:
           typedef ACE_Process_Mutex Mutex;
@@ -167,6 +181,7 @@ namespace El
         std::string sys_id_;
         NetStrategy net_strategy_;      
         FileStrategy file_strategy_;
+        EntityCache_var entity_cache_;
 
       private:
         void operator=(const InputSource&);
@@ -176,6 +191,7 @@ namespace El
     protected:
       NetStrategy net_strategy_;
       FileStrategy file_strategy_;
+      EntityCache_var entity_cache_;
 
     private:
       void operator=(const EntityResolver&);
@@ -197,10 +213,12 @@ namespace El
     //
     inline
     EntityResolver::EntityResolver(const NetStrategy& net_strategy,
-                                   const FileStrategy& file_strategy)
+                                   const FileStrategy& file_strategy,
+                                   EntityCache* entity_cache)
       throw(El::Exception)
         : net_strategy_(net_strategy),
-          file_strategy_(file_strategy)
+          file_strategy_(file_strategy),
+          entity_cache_(El::RefCount::add_ref(entity_cache))
     {
     }
 
@@ -0,0 +1,548 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/XML/GrammarPool.cpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#include <limits.h>
+
+#include <memory>
+#include <sstream>
+
+#include <xercesc/util/XMLUni.hpp>
+#include <xercesc/util/XMLString.hpp>
+#include <xercesc/parsers/SAX2XMLReaderImpl.hpp>
+#include <xercesc/sax/SAXException.hpp>
+#include <xercesc/validators/common/Grammar.hpp>
+
+#include <El/Exception.hpp>
+#include <El/ArrayPtr.hpp>
+
+#include "GrammarPool.hpp"
+
+namespace
+{
+  //
+  // Reader guarding its parses, so grammars it gets from pool stay alive
+  // while used
+  //
+  class PooledReader : public xercesc::SAX2XMLReaderImpl
+  {
+  public:
+    PooledReader(El::XML::GrammarPool* pool) throw(El::Exception);
+    virtual ~PooledReader() throw();
+
+    virtual void parse(const xercesc::InputSource& source);
+    virtual void parse(const XMLCh* const system_id);
+    virtual void parse(const char* const system_id);
+
+    virtual bool parseFirst(const xercesc::InputSource& source,
+                            xercesc::XMLPScanToken& to_fill);
+
+    virtual bool parseFirst(const XMLCh* const system_id,
+                            xercesc::XMLPScanToken& to_fill);
+
+    virtual bool parseFirst(const char* const system_id,
+                            xercesc::XMLPScanToken& to_fill);
+
+    virtual bool parseNext(xercesc::XMLPScanToken& token);
+    virtual void parseReset(xercesc::XMLPScanToken& token);
+
+    virtual xercesc::Grammar* loadGrammar(
+      const xercesc::InputSource& source,
+      const xercesc::Grammar::GrammarType grammar_type,
+      const bool to_cache = false);
+
+    virtual xercesc::Grammar* loadGrammar(
+      const XMLCh* const system_id,
+      const xercesc::Grammar::GrammarType grammar_type,
+      const bool to_cache = false);
+
+    virtual xercesc::Grammar* loadGrammar(
+      const char* const system_id,
+      const xercesc::Grammar::GrammarType grammar_type,
+      const bool to_cache = false);
+
+  private:
+    typedef El::XML::GrammarPool::ParseGuard ParseGuard;
+
+    // Starts guard of progressive parse
+    void progressive_started() throw(El::Exception);
+
+    El::XML::GrammarPool& pool_;
+
+    // Guard of progressive parse in progress
+    std::auto_ptr<ParseGuard> progressive_;
+  };
+
+  PooledReader::PooledReader(El::XML::GrammarPool* pool)
+    throw(El::Exception)
+      : xercesc::SAX2XMLReaderImpl(pool->getMemoryManager(), pool),
+        pool_(*pool)
+  {
+  }
+
+  PooledReader::~PooledReader() throw()
+  {
+  }
+
+  void
+  PooledReader::parse(const xercesc::InputSource& source)
+  {
+    ParseGuard guard(pool_, this);
+    xercesc::SAX2XMLReaderImpl::parse(source);
+  }
+
+  void
+  PooledReader::parse(const XMLCh* const system_id)
+  {
+    ParseGuard guard(pool_, this);
+    xercesc::SAX2XMLReaderImpl::parse(system_id);
+  }
+
+  void
+  PooledReader::parse(const char* const system_id)
+  {
+    ParseGuard guard(pool_, this);
+    xercesc::SAX2XMLReaderImpl::parse(system_id);
+  }
+
+  void
+  PooledReader::progressive_started() throw(El::Exception)
+  {
+    // Guard of abandoned progressive parse is released first
+    progressive_.reset(0);
+    progressive_.reset(new ParseGuard(pool_, this));
+  }
+
+  bool
+  PooledReader::parseFirst(const xercesc::InputSource& source,
+                           xercesc::XMLPScanToken& to_fill)
+  {
+    progressive_started();
+
+    try
+    {
+      if(xercesc::SAX2XMLReaderImpl::parseFirst(source, to_fill))
+      {
+        return true;
+      }
+    }
+    catch(...)
+    {
+      progressive_.reset(0);
+      throw;
+    }
+
+    progressive_.reset(0);
+    return false;
+  }
+
+  bool
+  PooledReader::parseFirst(const XMLCh* const system_id,
+                           xercesc::XMLPScanToken& to_fill)
+  {
+    progressive_started();
+
+    try
+    {
+      if(xercesc::SAX2XMLReaderImpl::parseFirst(system_id, to_fill))
+      {
+        return true;
+      }
+    }
+    catch(...)
+    {
+      progressive_.reset(0);
+      throw;
+    }
+
+    progressive_.reset(0);
+    return false;
+  }
+
+  bool
+  PooledReader::parseFirst(const char* const system_id,
+                           xercesc::XMLPScanToken& to_fill)
+  {
+    progressive_started();
+
+    try
+    {
+      if(xercesc::SAX2XMLReaderImpl::parseFirst(system_id, to_fill))
+      {
+        return true;
+      }
+    }
+    catch(...)
+    {
+      progressive_.reset(0);
+      throw;
+    }
+
+    progressive_.reset(0);
+    return false;
+  }
+
+  bool
+  PooledReader::parseNext(xercesc::XMLPScanToken& token)
+  {
+    try
+    {
+      if(xercesc::SAX2XMLReaderImpl::parseNext(token))
+      {
+        return true;
+      }
+    }
+    catch(...)
+    {
+      progressive_.reset(0);
+      throw;
+    }
+
+    progressive_.reset(0);
+    return false;
+  }
+
+  void
+  PooledReader::parseReset(xercesc::XMLPScanToken& token)
+  {
+    xercesc::SAX2XMLReaderImpl::parseReset(token);
+    progressive_.reset(0);
+  }
+
+  xercesc::Grammar*
+  PooledReader::loadGrammar(const xercesc::InputSource& source,
+                            const xercesc::Grammar::GrammarType grammar_type,
+                            const bool to_cache)
+  {
+    ParseGuard guard(pool_, this);
+    return xercesc::SAX2XMLReaderImpl::loadGrammar(source,
+                                                   grammar_type,
+                                                   to_cache);
+  }
+
+  xercesc::Grammar*
+  PooledReader::loadGrammar(const XMLCh* const system_id,
+                            const xercesc::Grammar::GrammarType grammar_type,
+                            const bool to_cache)
+  {
+    ParseGuard guard(pool_, this);
+    return xercesc::SAX2XMLReaderImpl::loadGrammar(system_id,
+                                                   grammar_type,
+                                                   to_cache);
+  }
+
+  xercesc::Grammar*
+  PooledReader::loadGrammar(const char* const system_id,
+                            const xercesc::Grammar::GrammarType grammar_type,
+                            const bool to_cache)
+  {
+    ParseGuard guard(pool_, this);
+    return xercesc::SAX2XMLReaderImpl::loadGrammar(system_id,
+                                                   grammar_type,
+                                                   to_cache);
+  }
+}
+
+namespace El
+{
+  namespace XML
+  {
+    //
+    // GrammarPool class
+    //
+    GrammarPool::GrammarPool(size_t max_grammars,
+                             xercesc::MemoryManager* const memory_manager)
+      throw(Exception, El::Exception)
+        : xercesc::XMLGrammarPoolImpl(memory_manager),
+          max_grammars_(max_grammars),
+          epoch_(0),
+          resetting_reader_(false),
+          uri_pool_(0)
+    {
+      //
+      // Parsers intern URIs into pool-provided string pool while
+      // building grammars, so it should tolerate concurrent parses
+      //
+      uri_pool_ = new xercesc::XMLSynchronizedStringPool(
+        xercesc::XMLGrammarPoolImpl::getURIStringPool(),
+        109,
+        memory_manager);
+    }
+
+    GrammarPool::~GrammarPool() throw()
+    {
+      delete_retired(true);
+      delete uri_pool_;
+    }
+
+    xercesc::SAX2XMLReader*
+    GrammarPool::create_reader(xercesc::EntityResolver* entity_resolver)
+      throw(Exception, El::Exception)
+    {
+      std::auto_ptr<xercesc::SAX2XMLReader> reader;
+
+      try
+      {
+        reader.reset(new PooledReader(this));
+
+        reader->setFeature(xercesc::XMLUni::fgXercesCacheGrammarFromParse,
+                           true);
+
+        reader->setFeature(xercesc::XMLUni::fgXercesUseCachedGrammarInParse,
+                           true);
+      }
+      catch(const xercesc::SAXException& e)
+      {
+        El::ArrayPtr<char> msg(
+          xercesc::XMLString::transcode(e.getMessage()));
+
+        std::ostringstream ostr;
+        ostr << "El::XML::GrammarPool::create_reader: "
+          "xercesc::SAXException caught. Description:\n" << msg.get();
+
+        throw Exception(ostr.str());
+      }
+
+      if(entity_resolver)
+      {
+        reader->setEntityResolver(entity_resolver);
+      }
+
+      return reader.release();
+    }
+
+    void
+    GrammarPool::parse(xercesc::SAX2XMLReader& reader,
+                       const xercesc::InputSource& source)
+    {
+      if(dynamic_cast<PooledReader*>(&reader))
+      {
+        // Guards itself
+        reader.parse(source);
+        return;
+      }
+
+      ParseGuard guard(*this, &reader);
+      reader.parse(source);
+    }
+
+    bool
+    GrammarPool::cacheGrammar(xercesc::Grammar* const grammar)
+    {
+      Guard guard(lock_);
+
+      if(!xercesc::XMLGrammarPoolImpl::cacheGrammar(grammar))
+      {
+        return false;
+      }
+
+      lru_.push_front(grammar);
+      map_[(uintptr_t)grammar] = lru_.begin();
+
+      while(max_grammars_ && map_.size() > max_grammars_)
+      {
+        const xercesc::Grammar* victim = lru_.back();
+
+        xercesc::Grammar* orphan =
+          xercesc::XMLGrammarPoolImpl::orphanGrammar(
+            victim->getGrammarDescription()->getGrammarKey());
+
+        forget(victim);
+
+        if(orphan)
+        {
+          retire(orphan);
+          ++stat_.evictions;
+        }
+      }
+
+      delete_retired();
+      return true;
+    }
+
+    xercesc::Grammar*
+    GrammarPool::retrieveGrammar(xercesc::XMLGrammarDescription* const desc)
+    {
+      Guard guard(lock_);
+
+      xercesc::Grammar* grammar =
+        xercesc::XMLGrammarPoolImpl::retrieveGrammar(desc);
+
+      if(grammar == 0)
+      {
+        ++stat_.misses;
+        return 0;
+      }
+
+      GrammarMap::iterator it = map_.find((uintptr_t)grammar);
+
+      if(it != map_.end() && it->second != lru_.begin())
+      {
+        lru_.splice(lru_.begin(), lru_, it->second);
+      }
+
+      ++stat_.hits;
+      return grammar;
+    }
+
+    xercesc::Grammar*
+    GrammarPool::orphanGrammar(const XMLCh* const key)
+    {
+      Guard guard(lock_);
+
+      xercesc::Grammar* grammar =
+        xercesc::XMLGrammarPoolImpl::orphanGrammar(key);
+
+      if(grammar)
+      {
+        forget(grammar);
+      }
+
+      return grammar;
+    }
+
+    bool
+    GrammarPool::clear()
+    {
+      Guard guard(lock_);
+
+      // Reader forgets grammars got from pool, pool keeps them
+      if(resetting_reader_)
+      {
+        return true;
+      }
+
+      while(!lru_.empty())
+      {
+        const xercesc::Grammar* grammar = lru_.back();
+
+        xercesc::Grammar* orphan =
+          xercesc::XMLGrammarPoolImpl::orphanGrammar(
+            grammar->getGrammarDescription()->getGrammarKey());
+
+        forget(grammar);
+
+        if(orphan)
+        {
+          retire(orphan);
+        }
+      }
+
+      delete_retired();
+      return true;
+    }
+
+    xercesc::XSModel*
+    GrammarPool::getXSModel(bool& changed)
+    {
+      Guard guard(lock_);
+      return xercesc::XMLGrammarPoolImpl::getXSModel(changed);
+    }
+
+    xercesc::XMLStringPool*
+    GrammarPool::getURIStringPool()
+    {
+      return uri_pool_;
+    }
+
+    unsigned long long
+    GrammarPool::parse_started(xercesc::SAX2XMLReader* reader) throw()
+    {
+      Guard guard(lock_);
+
+      unsigned long long epoch = epoch_;
+      ++parses_[epoch];
+
+      if(reader == 0)
+      {
+        return epoch;
+      }
+
+      //
+      // The only way to make reader drop grammars it got from pool is to
+      // reset the pool through it; clear called back in this thread is
+      // made no-op for that, other threads wait for the lock
+      //
+      resetting_reader_ = true;
+
+      try
+      {
+        reader->resetCachedGrammarPool();
+      }
+      catch(...)
+      {
+      }
+
+      resetting_reader_ = false;
+      return epoch;
+    }
+
+    void
+    GrammarPool::parse_finished(unsigned long long epoch) throw()
+    {
+      Guard guard(lock_);
+
+      ParseCounter::iterator it = parses_.find(epoch);
+
+      if(it != parses_.end() && --it->second == 0)
+      {
+        parses_.erase(it);
+        delete_retired();
+      }
+    }
+
+    void
+    GrammarPool::forget(const xercesc::Grammar* grammar) throw()
+    {
+      GrammarMap::iterator it = map_.find((uintptr_t)grammar);
+
+      if(it != map_.end())
+      {
+        lru_.erase(it->second);
+        map_.erase(it);
+      }
+    }
+
+    void
+    GrammarPool::retire(xercesc::Grammar* grammar) throw()
+    {
+      try
+      {
+        retired_.push_back(RetiredGrammar(grammar, epoch_));
+      }
+      catch(...)
+      {
+        // Leaked rather than deleted while can be in use
+      }
+
+      // Parses starting from now can't get the grammar
+      if(!parses_.empty())
+      {
+        ++epoch_;
+      }
+    }
+
+    void
+    GrammarPool::delete_retired(bool force) throw()
+    {
+      // Grammars retired before the oldest parse in progress started
+      unsigned long long epoch = force || parses_.empty() ?
+        ULLONG_MAX : parses_.begin()->first;
+
+      while(!retired_.empty() && retired_.front().epoch < epoch)
+      {
+        delete retired_.front().grammar;
+        retired_.pop_front();
+      }
+    }
+  }
+}
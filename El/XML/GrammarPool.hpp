@@ -0,0 +1,295 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file Elements/El/XML/GrammarPool.hpp
+ * @author Karen Arutyunov
+ * $id:$
+ */
+
+#ifndef _ELEMENTS_EL_XML_GRAMMARPOOL_HPP_
+#define _ELEMENTS_EL_XML_GRAMMARPOOL_HPP_
+
+#include <stdint.h>
+
+#include <list>
+#include <deque>
+#include <map>
+
+#include <xercesc/util/PlatformUtils.hpp>
+#include <xercesc/util/SynchronizedStringPool.hpp>
+#include <xercesc/internal/XMLGrammarPoolImpl.hpp>
+#include <xercesc/sax2/SAX2XMLReader.hpp>
+#include <xercesc/sax/EntityResolver.hpp>
+#include <xercesc/sax/InputSource.hpp>
+
+#include <ace/OS.h>
+#include <ace/Synch.h>
+#include <ace/Guard_T.h>
+
+#include <El/Exception.hpp>
+#include <El/Hash/Hash.hpp>
+#include <El/Hash/FlatMap.hpp>
+
+namespace El
+{
+  namespace XML
+  {
+    //
+    // Process wide grammar pool. DTD and schema grammars built while
+    // parsing are cached keyed by grammar key (system id for DTD, target
+    // namespace for schema) and reused by all parsers created with
+    // create_reader, so shared DTDs are parsed once per process instead
+    // of once per document.
+    //
+    // All pool operations are serialized. When max_grammars is exceeded
+    // least recently used grammar is removed from pool; as parsers in
+    // other threads can still refer it, it is deleted when parses which
+    // started before its removal are complete. Parses are tracked by
+    // readers made by create_reader themselves; parses of other readers
+    // using the pool should be run by parse or guarded by ParseGuard.
+    //
+    class GrammarPool : public xercesc::XMLGrammarPoolImpl
+    {
+    public:
+      EL_EXCEPTION(Exception, El::ExceptionBase);
+
+      struct Stat
+      {
+        // Grammar lookups satisfied from pool
+        unsigned long long hits;
+
+        // Grammar lookups not satisfied from pool
+        unsigned long long misses;
+
+        // Grammars currently in pool
+        unsigned long long grammars;
+
+        // Grammars removed to fit max_grammars
+        unsigned long long evictions;
+
+        // Removed grammars waiting for parses in progress to complete
+        unsigned long long retired;
+
+        Stat() throw();
+
+        double hit_ratio() const throw();
+      };
+
+      //
+      // Marks parse in progress; create on stack around
+      // SAX2XMLReader::parse call of reader using the pool if not
+      // parsing with GrammarPool::parse. Reader keeps grammars got from
+      // pool between parses, so if reused should be passed to forget
+      // ones pool could delete since.
+      //
+      class ParseGuard
+      {
+      public:
+        ParseGuard(GrammarPool& pool,
+                   xercesc::SAX2XMLReader* reader = 0) throw();
+        ~ParseGuard() throw();
+
+      private:
+        GrammarPool& pool_;
+        unsigned long long epoch_;
+
+      private:
+        ParseGuard(const ParseGuard&);
+        void operator=(const ParseGuard&);
+      };
+
+    public:
+      // 0 for max_grammars means unlimited
+      GrammarPool(size_t max_grammars = 64,
+                  xercesc::MemoryManager* const memory_manager =
+                    xercesc::XMLPlatformUtils::fgMemoryManager)
+        throw(Exception, El::Exception);
+
+      virtual ~GrammarPool() throw();
+
+      //
+      // Creates SAX2 reader using the pool with grammar caching enabled.
+      // Its parse, progressive parse and loadGrammar calls are guarded,
+      // so it can be reused across parses. Caller owns the reader.
+      //
+      xercesc::SAX2XMLReader* create_reader(
+        xercesc::EntityResolver* entity_resolver = 0)
+        throw(Exception, El::Exception);
+
+      //
+      // Parses source with reader using the pool, keeping grammars it
+      // uses alive till the end. Xerces and content handler exceptions
+      // are propagated as is.
+      //
+      void parse(xercesc::SAX2XMLReader& reader,
+                 const xercesc::InputSource& source);
+
+      Stat stat() const throw();
+
+      //
+      // xercesc::XMLGrammarPool interface
+      //
+      virtual bool cacheGrammar(xercesc::Grammar* const grammar);
+
+      virtual xercesc::Grammar* retrieveGrammar(
+        xercesc::XMLGrammarDescription* const desc);
+
+      virtual xercesc::Grammar* orphanGrammar(const XMLCh* const key);
+
+      virtual bool clear();
+
+      virtual xercesc::XSModel* getXSModel(bool& changed);
+
+      virtual xercesc::XMLStringPool* getURIStringPool();
+
+    private:
+      // Grammar objects are keyed by their address
+      typedef std::list<const xercesc::Grammar*> GrammarList;
+
+      typedef El::Hash::FlatMap<uintptr_t,
+                                GrammarList::iterator,
+                                El::Hash::Numeric<uintptr_t> >
+      GrammarMap;
+
+      //
+      // Grammar removed from pool in epoch; parses started in it or
+      // earlier could get it
+      //
+      struct RetiredGrammar
+      {
+        xercesc::Grammar* grammar;
+        unsigned long long epoch;
+
+        RetiredGrammar(xercesc::Grammar* grammar_val,
+                       unsigned long long epoch_val)
+          throw();
+      };
+
+      typedef std::deque<RetiredGrammar> RetiredGrammarList;
+
+      // Numbers of parses in progress by epoch they started in
+      typedef std::map<unsigned long long, size_t> ParseCounter;
+
+      typedef ACE_Recursive_Thread_Mutex Mutex;
+      typedef ACE_Guard<Mutex> Guard;
+
+      // Returns epoch parse started in
+      unsigned long long parse_started(xercesc::SAX2XMLReader* reader)
+        throw();
+
+      void parse_finished(unsigned long long epoch) throw();
+
+      void forget(const xercesc::Grammar* grammar) throw();
+      void retire(xercesc::Grammar* grammar) throw();
+
+      // Deletes retired grammars no parse in progress could get; all if
+      // force is true
+      void delete_retired(bool force = false) throw();
+
+    private:
+      size_t max_grammars_;
+
+      mutable Mutex lock_;
+      GrammarList lru_;
+      GrammarMap map_;
+
+      // Incremented when grammars are retired
+      unsigned long long epoch_;
+
+      RetiredGrammarList retired_;
+      ParseCounter parses_;
+      bool resetting_reader_;
+      Stat stat_;
+
+      xercesc::XMLSynchronizedStringPool* uri_pool_;
+
+    private:
+      GrammarPool(const GrammarPool&);
+      void operator=(const GrammarPool&);
+    };
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Inlines
+///////////////////////////////////////////////////////////////////////////////
+
+namespace El
+{
+  namespace XML
+  {
+    //
+    // GrammarPool::Stat struct
+    //
+    inline
+    GrammarPool::Stat::Stat() throw()
+        : hits(0),
+          misses(0),
+          grammars(0),
+          evictions(0),
+          retired(0)
+    {
+    }
+
+    inline
+    double
+    GrammarPool::Stat::hit_ratio() const throw()
+    {
+      unsigned long long requests = hits + misses;
+      return requests ? (double)hits / requests : 0;
+    }
+
+    //
+    // GrammarPool::ParseGuard class
+    //
+    inline
+    GrammarPool::ParseGuard::ParseGuard(GrammarPool& pool,
+                                        xercesc::SAX2XMLReader* reader)
+      throw()
+        : pool_(pool),
+          epoch_(pool.parse_started(reader))
+    {
+    }
+
+    inline
+    GrammarPool::ParseGuard::~ParseGuard() throw()
+    {
+      pool_.parse_finished(epoch_);
+    }
+
+    //
+    // GrammarPool::RetiredGrammar struct
+    //
+    inline
+    GrammarPool::RetiredGrammar::RetiredGrammar(
+      xercesc::Grammar* grammar_val,
+      unsigned long long epoch_val)
+      throw()
+        : grammar(grammar_val),
+          epoch(epoch_val)
+    {
+    }
+
+    //
+    // GrammarPool class
+    //
+    inline
+    GrammarPool::Stat
+    GrammarPool::stat() const throw()
+    {
+      Guard guard(lock_);
+
+      Stat st(stat_);
+      st.grammars = map_.size();
+      st.retired = retired_.size();
+      return st;
+    }
+  }
+}
+
+#endif // _ELEMENTS_EL_XML_GRAMMARPOOL_HPP_
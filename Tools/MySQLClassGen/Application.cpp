@@ -31,6 +31,8 @@ namespace
 "  command arguments ::= (class=<class> query=\"<query>\" "
 "[ignore-not-null-flag=(1|0)])+ "
 "[ignore-binary-flag=(1|0)])+ "
+"[view=(1|0)])+ "
+"[insert=(1|0)])+ "
 "[user=<user>] "
 "[passwd=<passwd>] "
 "[db=<db>] "
@@ -172,6 +174,8 @@ Application::gen(const ArgList& arguments)
   std::string class_name;
   bool ignore_not_null_flag = false;
   bool ignore_binary_flag = false;
+  bool view = false;
+  bool insert = false;
 
   ClassInfoList class_info;
   
@@ -264,6 +268,36 @@ Application::gen(const ArgList& arguments)
 
       ignore_binary_flag = atol(it->value.c_str());
     }
+    else if(it->name == "view")
+    {
+      if(class_name.empty())
+      {
+        throw InvalidArg("view argument should "
+                         "follow class argument but go before query argument");
+      }
+
+      if(!query.empty())
+      {
+        throw InvalidArg("view argument should go before query argument");
+      }
+
+      view = atol(it->value.c_str());
+    }
+    else if(it->name == "insert")
+    {
+      if(class_name.empty())
+      {
+        throw InvalidArg("insert argument should "
+                         "follow class argument but go before query argument");
+      }
+
+      if(!query.empty())
+      {
+        throw InvalidArg("insert argument should go before query argument");
+      }
+
+      insert = atol(it->value.c_str());
+    }
 
     if(!class_name.empty() && !query.empty())
     {
@@ -273,11 +307,15 @@ Application::gen(const ArgList& arguments)
       info.query = query;
       info.ignore_not_null_flag = ignore_not_null_flag;
       info.ignore_binary_flag = ignore_binary_flag;
+      info.view = view;
+      info.insert = insert;
 
       class_name.clear();
       query.clear();
       ignore_not_null_flag = false;
       ignore_binary_flag = false;
+      view = false;
+      insert = false;
       
       class_info.push_back(info);
     }
@@ -317,6 +355,8 @@ Application::gen(const ArgList& arguments)
     std::string class_name = it->name;
     bool ignore_not_null_flag = it->ignore_not_null_flag;
     bool ignore_binary_flag = it->ignore_binary_flag;
+    bool view = it->view;
+    bool insert = it->insert;
     
     El::MySQL::Result_var result = connection_->query(query.c_str());
 
@@ -424,6 +464,9 @@ Application::gen(const ArgList& arguments)
 
     for(unsigned long i = 0; i < num_fields; i++)
     {
+      file_stream << ident << "if(use_columns <= " << i << ")\n" << ident
+                  << "{\n" << ident << "  return;\n" << ident << "}\n\n";
+
       write_field_check(file_stream,
                         (*result)[i],
                         class_name.c_str(),
@@ -445,6 +488,24 @@ Application::gen(const ArgList& arguments)
                          ident);
     }
 
+    if(view)
+    {
+      write_view_class(file_stream,
+                       *result,
+                       (class_name + "View").c_str(),
+                       ignore_not_null_flag,
+                       ignore_binary_flag,
+                       ident);
+    }
+
+    if(insert)
+    {
+      write_insert_class(file_stream,
+                         *result,
+                         (class_name + "Insert").c_str(),
+                         ident);
+    }
+
 // Closing namespaces
   
     for(StringList::const_iterator it = namspaces.begin();
@@ -601,9 +662,6 @@ Application::write_field_check(std::ostream& ostr,
                                std::string& ident)
   throw(InvalidArg, Exception, El::Exception)
 {
-  ostr << ident << "if(use_columns >= " << index << ")\n" << ident
-       << "{\n" << ident << "  return;\n" << ident << "}\n\n";
-
   ostr << ident;
   
   if(index == 0)
@@ -920,3 +978,438 @@ Application::write_common_check_code(std::ostream& ostr,
        << "       << result_->num_fields();\n\n" << ident
        << "  throw Exception(ostr.str());\n" << ident << "}\n\n";
 }
+
+bool
+Application::column_type(const MYSQL_FIELD& field,
+                         std::string& type,
+                         std::string& getter,
+                         std::string& adder)
+  throw(El::Exception)
+{
+  bool is_unsigned = field.flags & UNSIGNED_FLAG;
+  
+  switch(field.type)
+  {
+  case FIELD_TYPE_BIT:
+    {
+      type = "uint64_t";
+      getter = "bit";
+      adder = "add_unsigned";
+      return true;
+    }
+  case FIELD_TYPE_TINY:
+    {
+      type = is_unsigned ? "unsigned char" : "char";
+      break;
+    }
+  case FIELD_TYPE_YEAR:
+  case FIELD_TYPE_SHORT:
+    {
+      type = is_unsigned ? "uint16_t" : "int16_t";
+      break;
+    }
+  case FIELD_TYPE_LONG:
+  case FIELD_TYPE_INT24:
+    {
+      type = is_unsigned ? "uint32_t" : "int32_t";
+      break;
+    }
+  case FIELD_TYPE_LONGLONG:
+    {
+      type = is_unsigned ? "uint64_t" : "int64_t";
+      break;
+    }
+  case FIELD_TYPE_FLOAT:
+    {
+      type = "float";
+      getter = "floating";
+      adder = "add_double";
+      return true;
+    }
+  case FIELD_TYPE_DECIMAL:
+  case FIELD_TYPE_NEWDECIMAL:
+  case FIELD_TYPE_DOUBLE:
+    {
+      type = "double";
+      getter = "floating";
+      adder = "add_double";
+      return true;
+    }
+  case FIELD_TYPE_STRING:
+  case FIELD_TYPE_VAR_STRING:
+  case FIELD_TYPE_BLOB:
+  case FIELD_TYPE_ENUM:
+  case FIELD_TYPE_TIME:
+    {
+      type = "El::MySQL::StringView";
+      getter = "string";
+      adder = "add_string";
+      return true;
+    }
+  case FIELD_TYPE_TIMESTAMP:
+  case FIELD_TYPE_DATE:
+  case FIELD_TYPE_DATETIME:
+    {
+      type = "El::Moment";
+      getter = "moment";
+      adder = "add_moment";
+      return true;
+    }
+  default:
+    {
+      return false;
+    }
+  }
+
+  // Integer types
+  getter = std::string("integer<") + type + ">";
+  adder = is_unsigned ? "add_unsigned" : "add_integer";
+  
+  return true;
+}
+
+void
+Application::write_view_class(std::ostream& ostr,
+                              El::MySQL::Result& result,
+                              const char* class_name,
+                              bool ignore_not_null_flag,
+                              bool ignore_binary_flag,
+                              std::string& ident)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  unsigned long num_fields = result.num_fields();
+  
+// Writing class declaration
+
+  ostr << "//\n// " << class_name << " class declaration\n//\n"
+       << ident << "class " << class_name
+       << ": public El::MySQL::RowView\n" << ident << "{\n" << ident
+       << "public:\n";
+
+  ident += "  ";
+
+  ostr << ident << class_name << "(El::MySQL::Result* result)\n"
+       << ident << "  throw(Exception, El::Exception);\n\n";
+
+  for(unsigned long i = 0; i < num_fields; i++)
+  {
+    const MYSQL_FIELD& field = result[i];
+    std::string type;
+    std::string getter;
+    std::string adder;
+    
+    if(!column_type(field, type, getter, adder))
+    {
+      std::ostringstream ostr;
+      ostr << "Unsupported type " << field.type << " encountered in field "
+           << field.name << " of class " << class_name;
+      
+      throw InvalidArg(ostr.str());
+    }
+
+    if(getter == "string")
+    {
+      // NULL value is a null view
+      ostr << ident << type << " " << field.name << "() const\n" << ident
+           << "  throw(Exception);\n\n";
+    }
+    else
+    {
+      ostr << ident << type << " " << field.name << "() const\n" << ident
+           << "  throw(El::MySQL::IsNull, Exception, El::Exception);\n\n";
+    }
+
+    if((field.flags & NOT_NULL_FLAG) == 0)
+    {
+      ostr << ident << "bool " << field.name << "_is_null() const\n"
+           << ident << "  throw(Exception);\n\n";
+    }
+  }
+
+  ident.resize(ident.size() - 2);
+  ostr << ident << "};\n\n";
+
+// Writing class definition
+  
+  ostr << "//\n// " << class_name << " class definition\n//\n"
+       << ident << "inline\n" << ident << class_name << "::"
+       << class_name << "(El::MySQL::Result* result)\n" << ident
+       << "  throw(Exception, El::Exception)\n"
+       << ident << "    : El::MySQL::RowView(result)\n" << ident << "{\n";
+    
+  ident += "  ";
+
+  ostr << ident << "if(result->num_fields() != " << num_fields << ")\n"
+       << ident << "{\n" << ident << "  std::ostringstream ostr;\n" << ident
+       << "  ostr << \"" << class_name << "::" << class_name
+       << ": unexpected number of fields \"\n" << ident
+       << "       << result->num_fields() << \" instead of " << num_fields
+       << "\";\n\n" << ident << "  throw Exception(ostr.str());\n" << ident
+       << "}\n\n";
+
+  for(unsigned long i = 0; i < num_fields; i++)
+  {
+    write_field_check(ostr,
+                      result[i],
+                      class_name,
+                      ignore_not_null_flag,
+                      ignore_binary_flag,
+                      i,
+                      ident);
+  }
+
+  ident.resize(ident.size() - 2);
+  ostr << ident << "}\n\n";
+
+  for(unsigned long i = 0; i < num_fields; i++)
+  {
+    const MYSQL_FIELD& field = result[i];
+    std::string type;
+    std::string getter;
+    std::string adder;
+    
+    column_type(field, type, getter, adder);
+
+    ostr << ident << "inline\n" << ident << type << std::endl << ident
+         << class_name << "::" << field.name << "() const\n" << ident;
+
+    if(getter == "string")
+    {
+      ostr << "  throw(Exception)\n" << ident << "{\n" << ident
+           << "  return string(" << i << ");\n";
+    }
+    else
+    {
+      ostr << "  throw(El::MySQL::IsNull, Exception, El::Exception)\n"
+           << ident << "{\n" << ident << "  return " << getter << "(" << i
+           << ", \"" << field.name << "\");\n";
+    }
+
+    ostr << ident << "}\n\n";
+
+    if((field.flags & NOT_NULL_FLAG) == 0)
+    {
+      ostr << ident << "inline\n" << ident << "bool\n" << ident
+           << class_name << "::" << field.name << "_is_null() const\n"
+           << ident << "  throw(Exception)\n" << ident << "{\n" << ident
+           << "  return is_null(" << i << ");\n" << ident << "}\n\n";
+    }
+  }
+}
+
+void
+Application::write_insert_class(std::ostream& ostr,
+                                El::MySQL::Result& result,
+                                const char* class_name,
+                                std::string& ident)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  unsigned long num_fields = result.num_fields();
+
+  // Auto-increment columns are left for the server to fill
+  std::string table;
+  std::string columns;
+  std::list<unsigned long> indexes;
+  
+  for(unsigned long i = 0; i < num_fields; i++)
+  {
+    const MYSQL_FIELD& field = result[i];
+    const char* field_table = field.org_table;
+
+    if(field_table == 0 || *field_table == '\0' || field.org_name == 0 ||
+       *field.org_name == '\0' || (!table.empty() && table != field_table))
+    {
+      std::ostringstream ostr;
+      ostr << "Field " << field.name << " of class " << class_name
+           << " is not a column of the table the query selects from";
+      
+      throw InvalidArg(ostr.str());
+    }
+
+    table = field_table;
+
+    std::string type;
+    std::string getter;
+    std::string adder;
+    
+    if(!column_type(field, type, getter, adder))
+    {
+      std::ostringstream ostr;
+      ostr << "Unsupported type " << field.type << " encountered in field "
+           << field.name << " of class " << class_name;
+      
+      throw InvalidArg(ostr.str());
+    }
+
+    if(field.flags & AUTO_INCREMENT_FLAG)
+    {
+      continue;
+    }
+
+    if(!indexes.empty())
+    {
+      columns += ",";
+    }
+
+    columns += std::string("`") + field.org_name + "`";
+    indexes.push_back(i);
+  }
+
+  if(indexes.empty())
+  {
+    std::ostringstream ostr;
+    ostr << "No columns to insert for class " << class_name;
+    throw InvalidArg(ostr.str());
+  }
+  
+// Writing class declaration
+
+  ostr << "//\n// " << class_name << " class declaration\n//\n"
+       << ident << "class " << class_name
+       << ": public El::MySQL::InsertBuilder\n" << ident << "{\n" << ident
+       << "public:\n";
+
+  ident += "  ";
+
+  ostr << ident << class_name << "(El::MySQL::Connection* connection,\n"
+       << ident << std::string(strlen(class_name) + 1, ' ')
+       << "size_t capacity = 1024 * 1024)\n"
+       << ident << "  throw(Exception, El::Exception);\n\n";
+
+  std::list<std::string> params;
+  
+  for(std::list<unsigned long>::const_iterator it = indexes.begin();
+      it != indexes.end(); it++)
+  {
+    const MYSQL_FIELD& field = result[*it];
+    std::string type;
+    std::string getter;
+    std::string adder;
+    
+    column_type(field, type, getter, adder);
+
+    if(adder == "add_string")
+    {
+      params.push_back("const " + type + "& " + field.name);
+    }
+    else if((field.flags & NOT_NULL_FLAG) == 0)
+    {
+      // Null pointer means NULL value
+      params.push_back("const " + type + "* " + field.name);
+    }
+    else if(adder == "add_moment")
+    {
+      params.push_back("const " + type + "& " + field.name);
+    }
+    else
+    {
+      params.push_back(type + " " + field.name);
+    }
+  }
+
+  ostr << ident << "void add(";
+  
+  for(std::list<std::string>::const_iterator it = params.begin();
+      it != params.end(); it++)
+  {
+    if(it != params.begin())
+    {
+      ostr << ",\n" << ident << "         ";
+    }
+
+    ostr << *it;
+  }
+  
+  ostr << ")\n" << ident << "  throw(Exception, El::Exception);\n";
+
+  ident.resize(ident.size() - 2);
+  ostr << ident << "};\n\n";
+
+// Writing class definition
+
+  ostr << "//\n// " << class_name << " class definition\n//\n"
+       << ident << "inline\n" << ident << class_name << "::"
+       << class_name << "(El::MySQL::Connection* connection,\n" << ident
+       << std::string(strlen(class_name) * 2 + 3, ' ')
+       << "size_t capacity)\n" << ident
+       << "  throw(Exception, El::Exception)\n" << ident
+       << "    : El::MySQL::InsertBuilder(\n" << ident
+       << "        connection,\n" << ident
+       << "        \"INSERT INTO `" << table << "` (\"";
+
+  // Column list split into literals of reasonable length
+  for(std::string::size_type pos = 0; pos < columns.size(); )
+  {
+    std::string::size_type end = columns.find(',', pos + 50);
+    end = end == std::string::npos ? columns.size() : end + 1;
+
+    ostr << "\n" << ident << "        \"" << columns.substr(pos, end - pos)
+         << "\"";
+
+    pos = end;
+  }
+
+  ostr << "\n" << ident << "        \") VALUES \",\n" << ident
+       << "        capacity)\n" << ident << "{\n" << ident << "}\n\n";
+
+  ostr << ident << "inline\n" << ident << "void\n" << ident << class_name
+       << "::add(";
+
+  for(std::list<std::string>::const_iterator it = params.begin();
+      it != params.end(); it++)
+  {
+    if(it != params.begin())
+    {
+      ostr << ",\n" << ident << std::string(strlen(class_name) + 7, ' ');
+    }
+
+    ostr << *it;
+  }
+  
+  ostr << ")\n" << ident << "  throw(Exception, El::Exception)\n" << ident
+       << "{\n";
+
+  ident += "  ";
+
+  ostr << ident << "begin_row();\n\n" << ident << "try\n" << ident
+       << "{\n";
+
+  // Blocks for nullable columns are separated with blank lines
+  bool separate = false;
+  
+  for(std::list<unsigned long>::const_iterator it = indexes.begin();
+      it != indexes.end(); it++)
+  {
+    const MYSQL_FIELD& field = result[*it];
+    std::string type;
+    std::string getter;
+    std::string adder;
+    
+    column_type(field, type, getter, adder);
+
+    if(adder == "add_string" || (field.flags & NOT_NULL_FLAG))
+    {
+      ostr << (separate ? "\n" : "") << ident << "  " << adder << "("
+           << field.name << ");\n";
+      
+      separate = false;
+    }
+    else
+    {
+      ostr << (it == indexes.begin() ? "" : "\n") << ident << "  if("
+           << field.name << ")\n" << ident << "  {\n"
+           << ident << "    " << adder << "(*" << field.name << ");\n"
+           << ident << "  }\n" << ident << "  else\n" << ident << "  {\n"
+           << ident << "    add_null();\n" << ident << "  }\n";
+
+      separate = true;
+    }
+  }
+
+  ostr << "\n" << ident << "  end_row();\n" << ident << "}\n" << ident
+       << "catch(...)\n" << ident << "{\n" << ident << "  cancel_row();\n"
+       << ident << "  throw;\n" << ident << "}\n";
+
+  ident.resize(ident.size() - 2);
+  ostr << ident << "}\n\n";
+}
@@ -76,6 +76,34 @@ private:
                          std::string& ident)
     throw(InvalidArg, Exception, El::Exception);
   
+  //
+  // Zero-copy flavour of row class and multi-row insert builder.
+  // Column type mapping of both is provided by column_type which
+  // returns false for unsupported type.
+  //
+  static
+  void write_view_class(std::ostream& ostr,
+                        El::MySQL::Result& result,
+                        const char* class_name,
+                        bool ignore_not_null_flag,
+                        bool ignore_binary_flag,
+                        std::string& ident)
+    throw(InvalidArg, Exception, El::Exception);
+
+  static
+  void write_insert_class(std::ostream& ostr,
+                          El::MySQL::Result& result,
+                          const char* class_name,
+                          std::string& ident)
+    throw(InvalidArg, Exception, El::Exception);
+
+  static
+  bool column_type(const MYSQL_FIELD& field,
+                   std::string& type,
+                   std::string& getter,
+                   std::string& adder)
+    throw(El::Exception);
+
   static
   void write_common_check_code(std::ostream& ostr,
                                const char* ident,
@@ -90,6 +118,8 @@ private:
     std::string query;
     bool ignore_not_null_flag;
     bool ignore_binary_flag;
+    bool view;
+    bool insert;
   };
 
   typedef std::list<ClassInfo> ClassInfoList;
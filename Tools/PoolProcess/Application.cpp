@@ -14,6 +14,8 @@
 #include <limits.h>
 #include <dlfcn.h>
 #include <sys/resource.h>
+#include <sys/socket.h>
+#include <signal.h>
 #include <unistd.h>
 
 #include <string>
@@ -256,6 +258,8 @@ Application::execute(ArgList& arguments)
       std::string error;
       std::ostringstream ostr;
       El::BinaryOutStream bostr(ostr);
+
+      int fds[2] = { -1, -1 };
     
       if(command == "INIT")
       {
@@ -265,6 +269,17 @@ Application::execute(ArgList& arguments)
       {
         error = execute_task(bistr, bostr);
       }
+      else if(command == "FORK")
+      {
+        bool child = false;
+        error = fork_process(bostr, child, fds);
+
+        if(child)
+        {
+          // Forked process continues with own pipes
+          continue;
+        }
+      }
       else
       {
         error = "Unknown command";
@@ -284,6 +299,14 @@ Application::execute(ArgList& arguments)
         
         res = write_data(signature, ostr.str());        
       }
+
+      if(fds[0] >= 0)
+      {
+        res = res && send_descriptors(fds, 2);
+        
+        close(fds[0]);
+        close(fds[1]);
+      }
       
       if(!res)
       {
@@ -445,6 +468,147 @@ Application::execute_task(El::BinaryInStream& input,
   return "";
 }
 
+std::string
+Application::fork_process(El::BinaryOutStream& output,
+                          bool& child,
+                          int* fds) const
+  throw(Exception, El::Exception)
+{
+  if(task_factory_ == 0)
+  {
+    return "not initialized";
+  }
+
+  int pipe_in[2];
+  int pipe_out[2];
+
+  if(pipe(pipe_in))
+  {
+    int e = ACE_OS::last_error();
+    
+    std::ostringstream ostr;
+    ostr << "pipe failed with code " << e << ". Description:\n"
+         << ACE_OS::strerror(e);
+
+    return ostr.str();
+  }
+
+  if(pipe(pipe_out))
+  {
+    int e = ACE_OS::last_error();
+
+    close(pipe_in[0]);
+    close(pipe_in[1]);
+    
+    std::ostringstream ostr;
+    ostr << "pipe failed with code " << e << ". Description:\n"
+         << ACE_OS::strerror(e);
+
+    return ostr.str();
+  }
+
+  // Zygote do not wait for forked processes
+  signal(SIGCHLD, SIG_IGN);
+  
+  pid_t pid = fork();
+
+  if(pid < 0)
+  {
+    int e = ACE_OS::last_error();
+
+    close(pipe_in[0]);
+    close(pipe_in[1]);
+    close(pipe_out[0]);
+    close(pipe_out[1]);
+    
+    std::ostringstream ostr;
+    ostr << "fork failed with code " << e << ". Description:\n"
+         << ACE_OS::strerror(e);
+
+    return ostr.str();
+  }
+
+  if(pid == 0)
+  {
+    signal(SIGCHLD, SIG_DFL);
+
+    close(IN_FILENO);
+
+    if(OUT_FILENO != IN_FILENO)
+    {
+      close(OUT_FILENO);
+    }
+    
+    close(pipe_in[1]);
+    close(pipe_out[0]);
+
+    IN_FILENO = pipe_in[0];
+    OUT_FILENO = pipe_out[1];
+
+    child = true;
+    return "";
+  }
+
+  close(pipe_in[0]);
+  close(pipe_out[1]);
+
+  // Descriptors for the pool side to write tasks to and read results from
+  fds[0] = pipe_out[0];
+  fds[1] = pipe_in[1];
+  
+  output << "S" << (uint64_t)pid;
+  return "";
+}
+
+bool
+Application::send_descriptors(const int* fds, size_t count)
+  throw(Exception, El::Exception)
+{
+  char byte = 0;
+  iovec iov;
+      
+  iov.iov_base = &byte;
+  iov.iov_len = 1;
+
+  std::string control(CMSG_SPACE(sizeof(int) * count), '\0');
+      
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+      
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = &control[0];
+  msg.msg_controllen = control.size();
+
+  cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int) * count);
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * count);
+
+  ssize_t size = 0;
+  while((size = sendmsg(OUT_FILENO, &msg, 0)) < 0 && errno == EINTR);
+
+  if(size != 1)
+  {
+    int e = ACE_OS::last_error();    
+    
+    std::ostringstream ostr;
+    
+    ostr << "Application::send_descriptors: sendmsg failed with code " << e;
+
+    if(e)
+    {
+      ostr << ". Description:\n" << ACE_OS::strerror(e);
+    }
+
+    throw Exception(ostr.str());
+  }
+
+  return true;
+}
+
 bool
 Application::read_data(uint32_t& signature, std::string& data)
   throw(Exception, El::Exception)
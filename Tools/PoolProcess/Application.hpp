@@ -63,6 +63,14 @@ private:
   std::string execute_task(El::BinaryInStream& input,
                            El::BinaryOutStream& output) const
     throw(Exception, El::Exception);
+
+  std::string fork_process(El::BinaryOutStream& output,
+                           bool& child,
+                           int* fds) const
+    throw(Exception, El::Exception);
+  
+  static bool send_descriptors(const int* fds, size_t count)
+    throw(Exception, El::Exception);
   
   static bool read_data(uint32_t& signature, std::string& data)
     throw(Exception, El::Exception);
@@ -0,0 +1,392 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file   Elements/Tools/PyCompile/Application.cpp
+ * @author Karen Arutyunov
+ * $Id:$
+ */
+
+#include <Python.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <errno.h>
+#include <string.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <ace/OS.h>
+
+#include <El/CRC.hpp>
+
+#include <El/Python/Utility.hpp>
+#include <El/Python/Code.hpp>
+#include <El/Python/CodeStore.hpp>
+
+#include "Application.hpp"
+
+namespace
+{
+  const char USAGE[] =
+  "\nUsage:\nElPyCompile <command> <command arguments>\n\n"
+  "Synopsis 1:\nElPyCompile help\n\n"
+  "Synopsis 2:\nElPyCompile compile store=<directory> root=<directory> "
+  "[ext=<extension>]\n"
+  "Compiles files with the extension (.psp by default) found under root "
+  "directory\nand saves code into store directory unless already there. "
+  "Root directory\nis to be the same as PSP_RootDir and store directory as "
+  "PSP_CodeStoreDir.\n\n"
+  "Synopsis 3:\nElPyCompile load store=<directory> root=<directory> "
+  "[ext=<extension>]\n"
+  "Loads code of the files from store directory reporting time taken.\n";
+}
+
+int
+main(int argc, char** argv)
+{
+  try
+  {
+    El::Python::Use use;
+    
+    Application app;
+    return app.run(argc, argv);
+  }
+  catch(const Application::InvalidArg& e)
+  {
+    std::cerr << e << "\nRun 'ElPyCompile help' for usage details\n";
+  }
+  catch(const El::Exception& e)
+  {
+    std::cerr << e << std::endl;
+  }
+  catch(...)
+  {
+    std::cerr << "ElPyCompile: unknown exception caught\n";
+  }
+  
+  return -1;
+}
+
+Application::Application() throw(Application::Exception, El::Exception)
+{
+}
+
+Application::~Application() throw()
+{
+}
+
+int
+Application::run(int& argc, char** argv)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  if(argc < 2)
+  {
+    throw InvalidArg("Too few arguments");
+  }
+
+  int i = 1;  
+  std::string command = argv[i];
+
+  ArgList arguments;
+
+  for(i++; i < argc; i++)
+  {
+    char* argument = argv[i];
+    
+    Argument arg;
+    const char* eq = strstr(argument, "=");
+
+    if(eq == 0)
+    {
+      arg.name = argument;
+    }
+    else
+    {
+      arg.name.assign(argument, eq - argument);
+      arg.value = eq + 1;
+    }
+
+    arguments.push_back(arg);
+  }
+
+  if(command == "help")
+  {
+    return help(arguments);
+  }
+  else if(command == "compile")
+  {
+    return compile(arguments);
+  }
+  else if(command == "load")
+  {
+    return load(arguments);
+  }
+  else
+  {
+    std::ostringstream ostr;
+    ostr << "unknown command '" << command << "'";
+   
+    throw InvalidArg(ostr.str());
+  }
+
+  return 0;
+}
+
+int
+Application::help(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  std::cerr << USAGE;
+  return 0;
+}
+
+int
+Application::compile(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  std::string store_dir;
+  FileList file_list;
+  
+  files(arguments, store_dir, file_list);
+
+  El::Python::CodeStore store(store_dir.c_str());
+  Stat stat;
+
+  for(FileList::const_iterator it = file_list.begin(); it != file_list.end();
+      ++it)
+  {
+    const char* name = it->c_str();
+    
+    try
+    {
+      std::string text;
+      uint64_t crc = 0;
+      
+      read_file(name, text, crc);
+
+      ACE_Time_Value start = ACE_OS::gettimeofday();
+
+      El::Python::CodeObject_var code = store.load(name, crc);
+
+      if(code.in() == 0)
+      {
+        El::Python::Code compiled;
+        compiled.compile(text.c_str(), name);
+        
+        store.save(name, crc, compiled.code());
+        ++stat.processed;
+      }
+
+      stat.time += ACE_OS::gettimeofday() - start;
+    }
+    catch(const El::Exception& e)
+    {
+      std::cerr << name << ": " << e << std::endl;
+      ++stat.failed;
+    }
+    
+    ++stat.files;
+  }
+
+  report("compiled", stat);
+  return stat.failed ? 1 : 0;
+}
+
+int
+Application::load(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  std::string store_dir;
+  FileList file_list;
+  
+  files(arguments, store_dir, file_list);
+
+  El::Python::CodeStore store(store_dir.c_str());
+  Stat stat;
+
+  for(FileList::const_iterator it = file_list.begin(); it != file_list.end();
+      ++it)
+  {
+    const char* name = it->c_str();
+    
+    try
+    {
+      std::string text;
+      uint64_t crc = 0;
+      
+      read_file(name, text, crc);
+
+      ACE_Time_Value start = ACE_OS::gettimeofday();
+      El::Python::CodeObject_var code = store.load(name, crc);
+      stat.time += ACE_OS::gettimeofday() - start;
+
+      if(code.in())
+      {
+        ++stat.processed;
+      }
+      else
+      {
+        std::cerr << name << ": not stored or stale\n";
+      }
+    }
+    catch(const El::Exception& e)
+    {
+      std::cerr << name << ": " << e << std::endl;
+      ++stat.failed;
+    }
+    
+    ++stat.files;
+  }
+
+  report("loaded", stat);
+  return stat.failed ? 1 : 0;
+}
+
+void
+Application::files(const ArgList& arguments,
+                   std::string& store,
+                   FileList& file_list)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  std::string root;
+  std::string ext(".psp");
+  
+  for(ArgList::const_iterator it = arguments.begin(); it != arguments.end();
+      it++)
+  {
+    const std::string& name = it->name;
+    const std::string& value = it->value;
+
+    if(name == "store")
+    {
+      store = value;
+    }
+    else if(name == "root")
+    {
+      root = value;
+    }
+    else if(name == "ext")
+    {
+      ext = value;
+    }
+  }
+
+  if(store.empty())
+  {
+    throw InvalidArg("store directory not specified");
+  }
+
+  // Same as PSP_RootDir value is processed by PSP module, so code names
+  // match ones module uses
+  if(!root.empty() && root[root.length() - 1] == '/')
+  {
+    root.resize(root.length() - 1);
+  }
+
+  if(root.empty())
+  {
+    throw InvalidArg("root directory not specified");
+  }
+
+  find_files(root, ext, file_list);
+}
+
+void
+Application::find_files(const std::string& dir,
+                        const std::string& ext,
+                        FileList& file_list)
+  throw(Exception, El::Exception)
+{
+  DIR* d = opendir(dir.c_str());
+
+  if(d == 0)
+  {
+    int error = errno;
+    
+    std::ostringstream ostr;
+    ostr << "Application::find_files: opendir failed for '" << dir
+         << "'. Errno " << error << ", description:\n" << strerror(error);
+
+    throw Exception(ostr.str());
+  }
+
+  try
+  {
+    for(struct dirent* entry = readdir(d); entry; entry = readdir(d))
+    {
+      const char* name = entry->d_name;
+      
+      if(*name == '.')
+      {
+        continue;
+      }
+
+      std::string path = dir + "/" + name;
+      struct stat st;
+
+      if(stat(path.c_str(), &st) != 0)
+      {
+        continue;
+      }
+
+      if(S_ISDIR(st.st_mode))
+      {
+        find_files(path, ext, file_list);
+      }
+      else if(S_ISREG(st.st_mode) && path.length() > ext.length() &&
+              path.compare(path.length() - ext.length(),
+                           ext.length(),
+                           ext) == 0)
+      {
+        file_list.push_back(path);
+      }
+    }
+  }
+  catch(...)
+  {
+    closedir(d);
+    throw;
+  }
+
+  closedir(d);
+}
+
+void
+Application::read_file(const char* name, std::string& text, uint64_t& crc)
+  throw(Exception, El::Exception)
+{
+  std::fstream file(name, std::ios::in);
+
+  if(!file.is_open())
+  {
+    std::ostringstream ostr;
+    ostr << "file '" << name << "' can't be opened";
+    throw Exception(ostr.str());
+  }
+
+  std::ostringstream ostr;
+  ostr << file.rdbuf();
+  text = ostr.str();
+
+  // Calculated same way as El::Cache::ObjectHolder does
+  unsigned long long hash = 0;
+  El::CRC(hash, (const unsigned char*)text.c_str(), text.length());
+  crc = hash;
+}
+
+void
+Application::report(const char* command, const Stat& stat) throw()
+{
+  std::cerr << stat.files << " files, " << stat.processed << " "
+            << command << ", " << stat.failed << " failed; "
+            << stat.time.msec() << " msec\n";
+}
@@ -0,0 +1,108 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file   Elements/Tools/PyCompile/Application.hpp
+ * @author Karen Arutyunov
+ * $Id:$
+ */
+
+#ifndef _ELEMENTS_TOOLS_PYCOMPILE_APPLICATION_HPP_
+#define _ELEMENTS_TOOLS_PYCOMPILE_APPLICATION_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <list>
+
+#include <ace/OS.h>
+
+#include <El/Exception.hpp>
+
+#include <El/Python/CodeStore.hpp>
+
+class Application
+{
+public:    
+    EL_EXCEPTION(Exception, El::ExceptionBase);
+    EL_EXCEPTION(InvalidArg, Exception);
+    
+public:
+    
+  Application() throw(Exception, El::Exception);
+  virtual ~Application() throw();
+
+  int run(int& argc, char** argv) throw(InvalidArg, Exception, El::Exception);
+
+private:
+
+  struct Argument
+  {
+    std::string name;
+    std::string value;
+
+    Argument(const char* nm = 0, const char* vl = 0)
+      throw(El::Exception);
+  };
+
+  typedef std::list<Argument> ArgList;
+  typedef std::list<std::string> FileList;
+
+  struct Stat
+  {
+    unsigned long files;
+    unsigned long processed;
+    unsigned long failed;
+    ACE_Time_Value time;
+
+    Stat() throw() : files(0), processed(0), failed(0) {}
+  };
+
+  int help(const ArgList& arguments)
+    throw(InvalidArg, Exception, El::Exception);
+
+  int compile(const ArgList& arguments)
+    throw(InvalidArg, Exception, El::Exception);
+
+  int load(const ArgList& arguments)
+    throw(InvalidArg, Exception, El::Exception);
+
+  void files(const ArgList& arguments,
+             std::string& store,
+             FileList& file_list)
+    throw(InvalidArg, Exception, El::Exception);
+
+  static void find_files(const std::string& dir,
+                         const std::string& ext,
+                         FileList& file_list)
+    throw(Exception, El::Exception);
+
+  static void read_file(const char* name,
+                        std::string& text,
+                        uint64_t& crc)
+    throw(Exception, El::Exception);
+
+  static void report(const char* command, const Stat& stat) throw();
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Inlines
+///////////////////////////////////////////////////////////////////////////////
+
+//
+// Application::Argument class
+//
+
+inline
+Application::Argument::Argument(const char* nm, const char* vl)
+  throw(El::Exception)
+    : name(nm ? nm : ""),
+      value(vl ? vl : "")
+{
+}
+
+#endif // _ELEMENTS_TOOLS_PYCOMPILE_APPLICATION_HPP_
@@ -0,0 +1,426 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file   ArenaMain.cpp
+ * @author Karen Arutyunov
+ * $Id:$
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <new>
+#include <map>
+#include <string>
+#include <sstream>
+#include <iostream>
+
+#include <ace/OS.h>
+
+#include <El/Exception.hpp>
+#include <El/Arena.hpp>
+#include <El/String/ListParser.hpp>
+#include <El/Net/HTTP/Params.hpp>
+#include <El/Net/HTTP/Cookies.hpp>
+
+//
+// Allocation counting hook
+//
+namespace
+{
+  unsigned long long heap_allocations = 0;
+}
+
+void*
+operator new(size_t size) throw(std::bad_alloc)
+{
+  ++heap_allocations;
+
+  void* ptr = malloc(size ? size : 1);
+
+  if(ptr == 0)
+  {
+    throw std::bad_alloc();
+  }
+
+  return ptr;
+}
+
+void
+operator delete(void* ptr) throw()
+{
+  free(ptr);
+}
+
+void*
+operator new[](size_t size) throw(std::bad_alloc)
+{
+  return operator new(size);
+}
+
+void
+operator delete[](void* ptr) throw()
+{
+  operator delete(ptr);
+}
+
+namespace
+{
+  const char USAGE[] =
+    "Usage: ElTestArena [--iterations=<iteration count>]";
+
+  const char QUERY[] =
+    "q=elements&lang=eng&c=us&s=0&n=20&v=1&m=a&p=1&t=1&h=0&sort=date";
+
+  const char* const HEADERS[][2] =
+  {
+    { "Host", "example.com" },
+    { "User-Agent", "Mozilla/5.0 (X11; Linux x86_64)" },
+    { "Accept", "text/html" },
+    { "Accept-Language", "en-US,en" },
+    { "Accept-Encoding", "gzip" },
+    { "Connection", "keep-alive" },
+    { "Referer", "http://example.com/" },
+    { "Cookie", "uid=1; sid=2; l=eng; c=us" }
+  };
+
+  double
+  seconds(const ACE_Time_Value& tm) throw()
+  {
+    return tm.sec() + (double)tm.usec() / 1000000;
+  }
+
+  //
+  // Arena with blocks aligned to 8 bytes only, like ones APR pools give
+  //
+  class MisalignedArena : public El::Arena
+  {
+  public:
+    typedef std::map<char*, size_t> BlockMap;
+    BlockMap blocks;
+
+  public:
+    MisalignedArena() throw() : El::Arena(256) {}
+    virtual ~MisalignedArena() throw() { release(); }
+
+    // true if allocated range lays within one of blocks
+    bool
+    contains(const char* ptr, size_t size) const throw()
+    {
+      BlockMap::const_iterator it = blocks.upper_bound((char*)ptr);
+
+      if(it == blocks.begin())
+      {
+        return false;
+      }
+
+      --it;
+      return ptr + size <= it->first + it->second;
+    }
+
+  protected:
+    virtual void*
+    allocate_block(size_t size) throw(El::Exception)
+    {
+      char* block = static_cast<char*>(::operator new(size + 16));
+
+      if((uintptr_t)block % 16 == 0)
+      {
+        block += 8;
+      }
+
+      blocks[block] = size;
+      return block;
+    }
+
+    virtual void
+    free_block(void* block, size_t size) throw()
+    {
+      char* ptr = static_cast<char*>(block);
+      blocks.erase(ptr);
+
+      ::operator delete((uintptr_t)ptr % 16 ? ptr - 8 : ptr);
+    }
+  };
+}
+
+class Application
+{
+public:
+  EL_EXCEPTION(Exception, El::ExceptionBase);
+
+public:
+  Application() throw() {}
+  virtual ~Application() throw() {}
+
+  int run(int& argc, char** argv) throw();
+
+private:
+  void check_arena() throw(Exception, El::Exception);
+  void check_containers() throw(Exception, El::Exception);
+
+  // Returns heap allocations made
+  unsigned long long process_request(bool use_arena)
+    throw(Exception, El::Exception);
+
+  void bench(size_t iterations) throw(Exception, El::Exception);
+};
+
+int
+main(int argc, char** argv)
+{
+  Application app;
+  return app.run(argc, argv);
+}
+
+int
+Application::run(int& argc, char** argv) throw()
+{
+  try
+  {
+    size_t iterations = 100000;
+
+    for(int i = 1; i < argc; i++)
+    {
+      const char* arg = argv[i];
+
+      if(!strncmp(arg, "--iterations=", 13))
+      {
+        iterations = atol(arg + 13);
+      }
+      else
+      {
+        std::ostringstream ostr;
+        ostr << "Unexpected argument '" << arg << "'\n" << USAGE;
+        throw Exception(ostr.str());
+      }
+    }
+
+    check_arena();
+    check_containers();
+
+    if(iterations)
+    {
+      bench(iterations);
+    }
+
+    return 0;
+  }
+  catch(const El::Exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+  }
+  catch(...)
+  {
+    std::cerr << "unknown exception caught.\n";
+  }
+
+  return -1;
+}
+
+void
+Application::check_arena() throw(Exception, El::Exception)
+{
+  El::Arena arena(1024);
+
+  for(size_t i = 1; i < 200; ++i)
+  {
+    size_t alignment = (size_t)1 << (i % 5);
+
+    char* ptr = static_cast<char*>(arena.allocate(i, alignment));
+
+    if((uintptr_t)ptr % alignment)
+    {
+      std::ostringstream ostr;
+      ostr << "Application::check_arena: " << i << " bytes allocated at "
+           << (void*)ptr << " not aligned to " << alignment;
+
+      throw Exception(ostr.str());
+    }
+
+    memset(ptr, 0xA5, i);
+  }
+
+  const El::Arena::Stat& stat = arena.stat();
+
+  if(stat.allocations != 199 || stat.bytes != 199 * 200 / 2 ||
+     stat.block_bytes < stat.bytes)
+  {
+    std::ostringstream ostr;
+    ostr << "Application::check_arena: unexpected stat; allocations "
+         << stat.allocations << ", bytes " << stat.bytes << ", blocks "
+         << stat.blocks << ", block bytes " << stat.block_bytes;
+
+    throw Exception(ostr.str());
+  }
+
+  arena.release();
+
+  // Alignments larger than one of blocks should not make allocations
+  // cross block boundary
+  {
+    MisalignedArena misaligned;
+
+    for(size_t i = 1; i < 500; ++i)
+    {
+      size_t alignment = i % 7 == 0 ? 64 : (i % 2 ? 16 : 32);
+      size_t size = i % 13 + 1;
+
+      char* ptr = static_cast<char*>(misaligned.allocate(size, alignment));
+
+      if((uintptr_t)ptr % alignment || !misaligned.contains(ptr, size))
+      {
+        std::ostringstream ostr;
+        ostr << "Application::check_arena: " << size << " bytes aligned to "
+             << alignment << " allocated at " << (void*)ptr
+             << " outside of block";
+
+        throw Exception(ostr.str());
+      }
+
+      memset(ptr, 0xA5, size);
+    }
+
+    if(misaligned.stat().blocks < 10)
+    {
+      std::ostringstream ostr;
+      ostr << "Application::check_arena: only " << misaligned.stat().blocks
+           << " blocks taken for aligned allocations";
+
+      throw Exception(ostr.str());
+    }
+  }
+
+  // Big allocation goes into dedicated block not abandoning current one
+  unsigned long long allocations = heap_allocations;
+
+  char* small1 = static_cast<char*>(arena.allocate(8));
+  arena.allocate(10000);
+  char* small2 = static_cast<char*>(arena.allocate(8));
+
+  if(heap_allocations != allocations + 2 ||
+     small2 != small1 + El::Arena::ALIGNMENT)
+  {
+    throw Exception(
+      "Application::check_arena: current block abandoned after big "
+      "allocation");
+  }
+}
+
+void
+Application::check_containers() throw(Exception, El::Exception)
+{
+  El::Arena arena;
+
+  El::Net::HTTP::ParamList params(&arena);
+  params.add("a", "1");
+  params.add("b", "2");
+
+  // Copy goes to heap, so can outlive arena
+  El::Net::HTTP::ParamList copy(params);
+
+  if(copy.get_allocator().arena() != 0 || copy.size() != 2 ||
+     copy.begin()->name != "a" || copy.rbegin()->value != "2")
+  {
+    throw Exception(
+      "Application::check_containers: unexpected parameter list copy");
+  }
+
+  typedef std::map<int,
+                   int,
+                   std::less<int>,
+                   El::ArenaAllocator<std::pair<const int, int> > >
+    IntMap;
+
+  IntMap::allocator_type allocator(&arena);
+  IntMap map(IntMap::key_compare(), allocator);
+
+  unsigned long long allocations = heap_allocations;
+
+  for(int i = 0; i < 50; ++i)
+  {
+    map[i] = i;
+  }
+
+  if(heap_allocations != allocations)
+  {
+    throw Exception(
+      "Application::check_containers: map nodes allocated in heap");
+  }
+}
+
+unsigned long long
+Application::process_request(bool use_arena)
+  throw(Exception, El::Exception)
+{
+  unsigned long long allocations = heap_allocations;
+
+  {
+    El::Arena arena;
+    El::Arena* pa = use_arena ? &arena : 0;
+
+    El::Net::HTTP::ParamList params(pa);
+    El::Net::HTTP::HeaderList headers(pa);
+    El::Net::HTTP::CookieList cookies(pa);
+
+    El::String::ListParser parser(QUERY, "&");
+
+    const char* item = 0;
+    while((item = parser.next_item()) != 0)
+    {
+      params.add(item);
+    }
+
+    for(size_t i = 0; i < sizeof(HEADERS) / sizeof(HEADERS[0]); ++i)
+    {
+      headers.add(HEADERS[i][0], HEADERS[i][1]);
+
+      if(strcmp(HEADERS[i][0], "Cookie") == 0)
+      {
+        cookies.add(HEADERS[i][1]);
+      }
+    }
+
+    if(params.size() != 11 || headers.size() != 8 || cookies.size() != 4)
+    {
+      std::ostringstream ostr;
+      ostr << "Application::process_request: unexpected parsing result; "
+           << params.size() << " params, " << headers.size()
+           << " headers, " << cookies.size() << " cookies";
+
+      throw Exception(ostr.str());
+    }
+  }
+
+  return heap_allocations - allocations;
+}
+
+void
+Application::bench(size_t iterations) throw(Exception, El::Exception)
+{
+  for(size_t mode = 0; mode < 2; ++mode)
+  {
+    bool use_arena = mode == 1;
+    unsigned long long allocations = 0;
+
+    ACE_Time_Value start = ACE_OS::gettimeofday();
+
+    for(size_t i = 0; i < iterations; ++i)
+    {
+      allocations += process_request(use_arena);
+    }
+
+    double time = seconds(ACE_OS::gettimeofday() - start);
+
+    std::cout << (use_arena ? "arena" : "heap") << ": "
+              << (double)allocations / iterations
+              << " heap allocations/request, "
+              << time * 1000000000 / iterations << " ns/request"
+              << std::endl;
+  }
+}
@@ -11,6 +11,8 @@
  * $Id:$
  */
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 
 #include <iostream>
 #include <sstream>
@@ -31,6 +33,8 @@
 #include <El/Stat.hpp>
 */
 
+#include <ace/OS.h>
+
 #include <El/Exception.hpp>
 #include <El/String/Manip.hpp>
 #include <El/ArrayPtr.hpp>
@@ -39,7 +43,65 @@
 
 namespace
 {
-  const char USAGE[] = "\nUsage:\nTestBase64 decode <file> | help\n";
+  const char USAGE[] =
+    "\nUsage:\nTestBase64 decode <file> | bench [size=<bytes>] | help\n";
+
+  const char BASE64_CHARS[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  //
+  // Char at a time encoder base64_encode used to be; encoders
+  // output should match its one byte to byte
+  //
+  void
+  legacy_base64_encode(const unsigned char* src,
+                       size_t src_len,
+                       std::ostream& dest,
+                       size_t chunk_per_line)
+    throw(El::Exception)
+  {
+    size_t triple_count = src_len / 3;
+    size_t chunks = 0;
+        
+    for(size_t i = 0; i < triple_count; ++i, ++chunks, src += 3)
+    {
+      if(chunks == chunk_per_line)
+      {
+        dest << "\r\n";
+        chunks = 0;
+      }
+          
+      dest << BASE64_CHARS[(src[0] >> 2) & 0x3F]
+           << BASE64_CHARS[((src[0] << 4) & 0x30) | ((src[1] >> 4) & 0xF)]
+           << BASE64_CHARS[((src[1] << 2) & 0x3C) | ((src[2] >> 6) & 0x3)]
+           << BASE64_CHARS[src[2] & 0x3F];
+    }
+
+    size_t rest = src_len % 3;
+        
+    if(rest && chunks == chunk_per_line)
+    {
+      dest << "\r\n";
+    }
+
+    if(rest == 1)
+    {
+      dest << BASE64_CHARS[(src[0] >> 2) & 0x3F]
+           << BASE64_CHARS[(src[0] << 4) & 0x30] << "==";
+    }
+    else if(rest == 2)
+    {
+      dest << BASE64_CHARS[(src[0] >> 2) & 0x3F]
+           << BASE64_CHARS[((src[0] << 4) & 0x30) | ((src[1] >> 4) & 0xF)]
+           << BASE64_CHARS[(src[1] << 2) & 0x3C] << "=";
+    }
+  }
+
+  double
+  seconds(const ACE_Time_Value& tm) throw()
+  {
+    return tm.sec() + (double)tm.usec() / 1000000;
+  }
 }
 
 int
@@ -121,6 +183,10 @@ Application::run(int& argc, char** argv)
   {
     return decode(arguments);
   }
+  else if(command == "bench")
+  {
+    return bench(arguments);
+  }
 
   test(arguments);
   return 0;
@@ -230,6 +296,149 @@ Application::test(const ArgList& arguments)
     }
   }
 
+  const size_t chunks_per_line[] = { 0, 1, 2, 3, 4, 5, 19, 64, SIZE_MAX };
+  
+  for(size_t len = 0; len < 300; ++len)
+  {
+    UCharArrayPtr src(new unsigned char[len + 1]);
+
+    for(size_t i = 0; i < len; i++)
+    {
+      src[i] = (unsigned char)rand();
+    }
+    
+    for(size_t i = 0;
+        i < sizeof(chunks_per_line) / sizeof(chunks_per_line[0]); ++i)
+    {
+      size_t cpl = chunks_per_line[i];
+      
+      std::ostringstream expected;
+      legacy_base64_encode(src.get(), len, expected, cpl);
+
+      std::ostringstream encoded;
+      El::String::Manip::base64_encode(src.get(), len, encoded, cpl);
+
+      size_t size = El::String::Manip::base64_encoded_size(len, cpl);
+      std::string buff(size + 1, '#');
+      
+      size_t written =
+        El::String::Manip::base64_encode(src.get(), len, &buff[0], cpl);
+
+      if(encoded.str() != expected.str() || written != size ||
+         buff.compare(0, size, expected.str()) != 0 || buff[size] != '#')
+      {
+        std::ostringstream ostr;
+        ostr << "Application::test: unexpected encoding of " << len
+             << " bytes with " << cpl << " chunks per line";
+      
+        throw Exception(ostr.str());
+      }
+    }
+  }
+
+  return 0;
+}
+
+int
+Application::bench(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  size_t size = 65536;
+  
+  for(ArgList::const_iterator i(arguments.begin()), e(arguments.end());
+      i != e; ++i)
+  {
+    if(i->name == "size")
+    {
+      size = atol(i->value.c_str());
+    }
+    else
+    {
+      std::ostringstream ostr;
+      ostr << "unexpected argument " << i->name;
+      throw InvalidArg(ostr.str());
+    }
+  }
+
+  std::string src;
+  src.reserve(size);
+  
+  for(size_t i = 0; i < size; ++i)
+  {
+    src.push_back((char)rand());
+  }
+
+  const unsigned char* data = (const unsigned char*)src.c_str();
+  size_t iterations = 256 * 1024 * 1024 / (size + 1) + 1;
+
+  std::string buff(El::String::Manip::base64_encoded_size(size, 19), '\0');
+  size_t total = 0;
+
+  const char* names[] =
+  {
+    "legacy stream",
+    "stream",
+    "string",
+    "buffer, 76 chars per line",
+    "decode"
+  };
+
+  std::string encoded;
+  El::String::Manip::base64_encode(data, size, encoded);
+
+  for(size_t mode = 0; mode < sizeof(names) / sizeof(names[0]); ++mode)
+  {
+    ACE_Time_Value start = ACE_OS::gettimeofday();
+    
+    for(size_t i = 0; i < iterations; ++i)
+    {
+      switch(mode)
+      {
+      case 0:
+        {
+          std::ostringstream ostr;
+          legacy_base64_encode(data, size, ostr, SIZE_MAX);
+          total += ostr.tellp();
+          break;
+        }
+      case 1:
+        {
+          std::ostringstream ostr;
+          El::String::Manip::base64_encode(data, size, ostr);
+          total += ostr.tellp();
+          break;
+        }
+      case 2:
+        {
+          std::string res;
+          El::String::Manip::base64_encode(data, size, res);
+          total += res.size();
+          break;
+        }
+      case 3:
+        {
+          total +=
+            El::String::Manip::base64_encode(data, size, &buff[0], 19);
+          break;
+        }
+      default:
+        {
+          std::string res;
+          El::String::Manip::base64_decode(encoded.c_str(), res);
+          total += res.size();
+          break;
+        }
+      }
+    }
+    
+    double time = seconds(ACE_OS::gettimeofday() - start);
+    
+    std::cout << names[mode] << ": "
+              << (double)size * iterations / time / 1048576 << " MB/s"
+              << std::endl;
+  }
+
+  std::cout << "total: " << total << std::endl;
   return 0;
 }
 
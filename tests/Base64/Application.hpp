@@ -53,6 +53,9 @@ private:
 
   int test(const ArgList& arguments)
     throw(InvalidArg, Exception, El::Exception);
+
+  int bench(const ArgList& arguments)
+    throw(InvalidArg, Exception, El::Exception);
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -17,13 +17,18 @@
 #include <string>
 #include <iostream>
 #include <sstream>
+#include <vector>
+#include <algorithm>
 
 #include <tr1/functional>
 
 #include <google/sparse_hash_map>
 
+#include <ace/OS.h>
+
 #include <El/CRC.hpp>
 #include <El/Hash/Hash.hpp>
+#include <El/Hash/Hash64.hpp>
 #include <El/Stat.hpp>
 
 #include "Application.hpp"
@@ -31,6 +36,94 @@
 namespace
 {
   const char USAGE[] = "\nUsage:\nElTestCRC [help]\n";
+
+  const size_t AVALANCHE_SAMPLES = 10000;
+
+  // Expected flip probability is 0.5; with AVALANCHE_SAMPLES samples per
+  // cell statistical deviation stays well below
+  const double AVALANCHE_MAX_BIAS = 0.05;
+
+  const size_t THROUGHPUT_BYTES = 256 * 1024 * 1024;
+
+  typedef std::vector<unsigned char> Buffer;
+
+  void
+  random_fill(Buffer& buffer) throw()
+  {
+    for(Buffer::iterator it = buffer.begin(); it != buffer.end(); ++it)
+    {
+      *it = (unsigned char)(rand() >> 7);
+    }
+  }
+
+  //
+  // For each input bit counts probability of each output bit flip when
+  // the input bit is flipped; returns max deviation from 0.5
+  //
+  template<typename HASH>
+  double
+  avalanche_bias(size_t size, const HASH& hash) throw(El::Exception)
+  {
+    size_t input_bits = size * 8;
+    std::vector<unsigned long> flips(input_bits * 64);
+    Buffer key(size);
+
+    for(size_t i = 0; i < AVALANCHE_SAMPLES; ++i)
+    {
+      random_fill(key);
+      uint64_t h = hash(&key[0], size);
+
+      for(size_t bit = 0; bit < input_bits; ++bit)
+      {
+        key[bit / 8] ^= 1 << (bit % 8);
+        uint64_t diff = h ^ hash(&key[0], size);
+        key[bit / 8] ^= 1 << (bit % 8);
+
+        for(size_t out = 0; out < 64; ++out)
+        {
+          flips[bit * 64 + out] += (diff >> out) & 1;
+        }
+      }
+    }
+
+    double max_bias = 0;
+
+    for(size_t i = 0; i < flips.size(); ++i)
+    {
+      double bias = (double)flips[i] / AVALANCHE_SAMPLES - 0.5;
+      max_bias = std::max(max_bias, bias < 0 ? -bias : bias);
+    }
+
+    return max_bias;
+  }
+
+  struct Hash64
+  {
+    uint64_t operator()(const unsigned char* data, size_t size) const
+    {
+      return El::Hash::hash64(data, size);
+    }
+  };
+
+  struct Mix64
+  {
+    uint64_t operator()(const unsigned char* data, size_t size) const
+    {
+      uint64_t val = 0;
+      memcpy(&val, data, std::min(size, sizeof(val)));
+      return El::Hash::mix64(val);
+    }
+  };
+
+  struct StlHashString
+  {
+    uint64_t operator()(const unsigned char* data, size_t size) const
+    {
+      // Hashes up to first zero byte, so can only be weaker than measured
+      std::string str((const char*)data, size);
+      return __gnu_cxx::__stl_hash_string(str.c_str());
+    }
+  };
 }
 
 int
@@ -110,7 +203,10 @@ Application::run(int& argc, char** argv)
   }
 
   test(arguments);
+  test_hash64();
+  test_avalanche();
   test_performance(arguments);
+  test_throughput();
   return 0;
 }
 
@@ -233,6 +329,7 @@ Application::test_performance(const ArgList& arguments)
   CRC_Distribution crc32_distr;
   CRC_Distribution adler32_distr;
   CRC_Distribution fnv_hash_distr;
+  CRC_Distribution hash64_distr;
 
   El::Stat::TimeMeter crc_meter("El::CRC");
   El::Stat::TimeMeter crc_ull_meter("El::CRC<unsigned long long>");
@@ -240,6 +337,7 @@ Application::test_performance(const ArgList& arguments)
   El::Stat::TimeMeter crc32_meter("crc32");
   El::Stat::TimeMeter adler32_meter("adler32");
   El::Stat::TimeMeter fnv_hash_meter("fnv_hash<4>");
+  El::Stat::TimeMeter hash64_meter("El::Hash::hash64");
     
   for(unsigned long i = 0; i < 1000000; i++)
   {
@@ -341,6 +439,26 @@ Application::test_performance(const ArgList& arguments)
       it->second++;
     }
 
+    //
+    // El::Hash::hash64
+    //
+    
+    {
+      El::Stat::TimeMeasurement measurement(hash64_meter);
+      crc_ull = El::Hash::hash64(rand_str, sizeof(rand_str) - 1);
+    }
+    
+    it = hash64_distr.find(crc_ull);
+
+    if(it == hash64_distr.end())
+    {
+      hash64_distr[crc_ull] = 1;
+    }
+    else
+    {
+      it->second++;
+    }
+
     //
     // crc32
     //
@@ -454,6 +572,23 @@ Application::test_performance(const ArgList& arguments)
 
   std::cerr << "  Failures: " << failures << std::endl;
 
+  //
+  // El::Hash::hash64
+  //
+  hash64_meter.dump(std::cerr);
+  
+  failures = 0;
+  for(CRC_Distribution::iterator it = hash64_distr.begin();
+      it != hash64_distr.end(); it++)
+  {
+    if(it->second > 1)
+    {
+      failures += it->second;  
+    }
+  }
+
+  std::cerr << "  Failures: " << failures << std::endl;
+
   //
   // crc32
   //
@@ -490,3 +625,180 @@ Application::test_performance(const ArgList& arguments)
 
   return 0;
 }
+
+void
+Application::test_hash64() throw(Exception, El::Exception)
+{
+  std::cerr << "* Testing El::Hash::hash64 ...\n";
+
+  const char text[] = "http://www.example.com/path?query=value";
+  const size_t len = sizeof(text) - 1;
+
+  //
+  // Only size bytes to be hashed, no terminating zero required
+  //
+  char copy[sizeof(text) + 8];
+  memcpy(copy, text, len);
+  memset(copy + len, 'x', sizeof(copy) - len);
+
+  if(El::Hash::hash64(text, len) != El::Hash::hash64(copy, len))
+  {
+    throw Exception("Application::test_hash64: hash depends on data beyond "
+                    "specified size");
+  }
+
+  if(El::Hash::hash64(text, len) == El::Hash::hash64(text, len - 1) ||
+     El::Hash::hash64(text, 0) == El::Hash::hash64(text, 1))
+  {
+    throw Exception("Application::test_hash64: hash doesn't depend on size");
+  }
+
+  if(El::Hash::hash64(text, len, 1) == El::Hash::hash64(text, len, 2) ||
+     El::Hash::mix64(1, 1) == El::Hash::mix64(1, 2))
+  {
+    throw Exception("Application::test_hash64: hash doesn't depend on seed");
+  }
+
+  if(El::Hash::seed() != El::Hash::seed())
+  {
+    throw Exception("Application::test_hash64: process seed changes");
+  }
+
+  El::Hash::String hash_string;
+  El::Hash::SeededString seeded_string;
+
+  if(hash_string(text) != hash_string(std::string(text)) ||
+     seeded_string(text) != seeded_string(std::string(text)))
+  {
+    throw Exception("Application::test_hash64: const char* and std::string "
+                    "hashes differ");
+  }
+
+  //
+  // Every length around read width boundaries and every byte position
+  // should matter
+  //
+  Buffer data(200);
+  random_fill(data);
+
+  for(size_t size = 1; size < data.size(); ++size)
+  {
+    uint64_t h = El::Hash::hash64(&data[0], size);
+
+    for(size_t i = 0; i < size; ++i)
+    {
+      data[i] ^= 0x10;
+      bool same = El::Hash::hash64(&data[0], size) == h;
+      data[i] ^= 0x10;
+
+      if(same)
+      {
+        std::ostringstream ostr;
+        ostr << "Application::test_hash64: byte " << i << " doesn't affect "
+          "hash of " << size << " bytes";
+
+        throw Exception(ostr.str());
+      }
+    }
+  }
+}
+
+void
+Application::test_avalanche() throw(Exception, El::Exception)
+{
+  std::cerr << "* Testing avalanche ...\n";
+
+  const size_t sizes[] = { 3, 4, 8, 15, 16, 17, 31, 48, 49, 64 };
+
+  for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+  {
+    size_t size = sizes[i];
+    double bias = avalanche_bias(size, Hash64());
+
+    std::cerr << "  hash64 " << size << " bytes: max bias " << bias
+              << ", hash_string: " << avalanche_bias(size, StlHashString())
+              << std::endl;
+
+    if(bias > AVALANCHE_MAX_BIAS)
+    {
+      std::ostringstream ostr;
+      ostr << "Application::test_avalanche: hash64 bias " << bias
+           << " for " << size << " bytes keys";
+
+      throw Exception(ostr.str());
+    }
+  }
+
+  double bias = avalanche_bias(sizeof(uint64_t), Mix64());
+  std::cerr << "  mix64: max bias " << bias << std::endl;
+
+  if(bias > AVALANCHE_MAX_BIAS)
+  {
+    std::ostringstream ostr;
+    ostr << "Application::test_avalanche: mix64 bias " << bias;
+    throw Exception(ostr.str());
+  }
+}
+
+void
+Application::test_throughput() throw(Exception, El::Exception)
+{
+  std::cerr << "* Testing throughput ...\n";
+
+  const size_t sizes[] = { 8, 16, 32, 64, 256, 4096 };
+
+  Buffer data(4096 + 1);
+  random_fill(data);
+
+  // No zero bytes so hash_string processes same data
+  std::replace(data.begin(), data.end(), (unsigned char)0, (unsigned char)1);
+
+  for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+  {
+    size_t size = sizes[i];
+    size_t count = THROUGHPUT_BYTES / size;
+
+    unsigned char saved = data[size];
+    data[size] = 0;
+
+    uint64_t sum = 0;
+    double rates[3];
+
+    for(size_t j = 0; j < 3; ++j)
+    {
+      ACE_Time_Value start = ACE_OS::gettimeofday();
+
+      for(size_t k = 0; k < count; ++k)
+      {
+        // Varying first byte so calls can't be folded
+        data[0] = (unsigned char)(k | 1);
+
+        switch(j)
+        {
+        case 0: sum += El::Hash::hash64(&data[0], size); break;
+        case 1:
+          {
+            sum += __gnu_cxx::__stl_hash_string((const char*)&data[0]);
+            break;
+          }
+        default:
+          {
+            sum += El::Hash::Fnv_hash<8>::hash((const char*)&data[0], size);
+            break;
+          }
+        }
+      }
+
+      ACE_Time_Value time = ACE_OS::gettimeofday() - start;
+      double sec = time.sec() + (double)time.usec() / 1000000;
+
+      rates[j] = sec > 0 ? (double)size * count / sec / 1024 / 1024 : 0;
+    }
+
+    data[size] = saved;
+
+    std::cerr << "  " << size << " bytes: hash64 " << rates[0]
+              << " MB/s, hash_string " << rates[1] << " MB/s, fnv_hash<8> "
+              << rates[2] << " MB/s (" << (sum & 1) << ")\n";
+  }
+}
@@ -53,6 +53,10 @@ private:
 
   int test_performance(const ArgList& arguments)
     throw(InvalidArg, Exception, El::Exception);
+
+  void test_hash64() throw(Exception, El::Exception);
+  void test_avalanche() throw(Exception, El::Exception);
+  void test_throughput() throw(Exception, El::Exception);
 };
 
 ///////////////////////////////////////////////////////////////////////////////
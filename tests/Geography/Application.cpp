@@ -13,20 +13,64 @@
 #include <string.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <unistd.h>
+#include <utime.h>
 
 #include <string>
 #include <iostream>
 #include <sstream>
+#include <fstream>
 #include <vector>
 #include <algorithm>
+#include <memory>
 
+#include <ace/OS.h>
+
+#include <El/Moment.hpp>
 #include <El/Geography/AddressInfo.hpp>
 
 #include "Application.hpp"
 
 namespace
 {
-  const char USAGE[] = "\nUsage:\nElGeography (help|host <hostname>)\n";
+  const char USAGE[] =
+    "\nUsage:\nElGeography (help|host <hostname>|"
+    "parity [count=<number>] [file=<path>] [file_v6=<path>]|reload|"
+    "bench [lookups=<number>] [threads=<number>] [geoip=<0|1>] "
+    "[file=<path>] [file_v6=<path>])\n";
+
+  const size_t PARITY_COUNT = 1000000;
+  const size_t BENCH_LOOKUPS = 10000000;
+  const size_t BENCH_THREADS = 8;
+  const size_t BENCH_ADDRESSES = 65536;
+
+  // Seconds to wait for reloaded index to be published
+  const size_t RELOAD_TIMEOUT = 10;
+
+  void
+  write_csv(const std::string& path, const char* country, time_t mtime)
+    throw(Application::Exception, El::Exception)
+  {
+    {
+      std::fstream file(path.c_str(), std::ios::out);
+
+      if(!file.is_open())
+      {
+        std::ostringstream ostr;
+        ostr << "write_csv: failed to create " << path;
+        throw Application::Exception(ostr.str());
+      }
+
+      file << "\"1.0.0.0\",\"1.0.0.255\",\"16777216\",\"16777471\",\""
+           << country << "\",\"Country\"\n";
+    }
+
+    struct utimbuf times;
+    times.actime = mtime;
+    times.modtime = mtime;
+
+    utime(path.c_str(), &times);
+  }
 }
 
 int
@@ -109,6 +153,18 @@ Application::run(int& argc, char** argv)
   {
     test(arguments);
   }
+  else if(command == "parity")
+  {
+    return parity(arguments);
+  }
+  else if(command == "reload")
+  {
+    return reload(arguments);
+  }
+  else if(command == "bench")
+  {
+    return bench(arguments);
+  }
   else
   {
     std::cerr << "no valid command specified. " << USAGE;
@@ -146,3 +202,277 @@ Application::test(const ArgList& arguments)
   
   return 0;
 }
+
+El::Geography::AddressInfo*
+Application::address_info(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  std::string file;
+  std::string file_v6;
+  
+  for(ArgList::const_iterator it = arguments.begin(); it != arguments.end();
+      it++)
+  {
+    if(it->name == "file")
+    {
+      file = it->value;
+    }
+    else if(it->name == "file_v6")
+    {
+      file_v6 = it->value;
+    }
+  }
+
+  if(!file.empty())
+  {
+    return new El::Geography::AddressInfo(file.c_str(),
+                                          GEOIP_STANDARD,
+                                          0,
+                                          file_v6.c_str());
+  }
+
+  return new El::Geography::AddressInfo(GEOIP_CITY_EDITION_REV1,
+                                        GEOIP_STANDARD,
+                                        0);
+}
+
+std::string
+Application::random_ip() throw(El::Exception)
+{
+  std::ostringstream ostr;
+  
+  ostr << rand() % 256 << "." << rand() % 256 << "." << rand() % 256 << "."
+       << rand() % 256;
+
+  return ostr.str();
+}
+
+int
+Application::parity(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  size_t count = PARITY_COUNT;
+  
+  for(ArgList::const_iterator it = arguments.begin(); it != arguments.end();
+      it++)
+  {
+    if(it->name == "count")
+    {
+      count = atol(it->value.c_str());
+    }
+  }
+
+  std::auto_ptr<El::Geography::AddressInfo> info(address_info(arguments));
+
+  El::Geography::AddressIndex_var index = info->index();
+
+  std::cout << "Index: " << index->ipv4_ranges() << " IPv4 ranges, "
+            << index->ipv6_ranges() << " IPv6 ranges" << std::endl;
+
+  size_t found = 0;
+  
+  for(size_t i = 0; i < count; i++)
+  {
+    std::string ip = random_ip();
+    
+    El::Country indexed = info->country(ip.c_str());
+    El::Country direct = info->geoip_country(ip.c_str());
+
+    if(indexed != direct)
+    {
+      std::ostringstream ostr;
+      ostr << "Application::parity: " << ip << " is in " << indexed
+           << " by index, but in " << direct << " by GeoIP";
+      
+      throw Exception(ostr.str());
+    }
+
+    if(indexed != El::Country::null)
+    {
+      ++found;
+    }
+  }
+
+  std::cout << count << " addresses checked, " << found << " located"
+            << std::endl;
+  
+  return 0;
+}
+
+int
+Application::reload(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  std::ostringstream path;
+  path << "/tmp/ElTestGeography." << getpid() << ".csv";
+
+  time_t now = ACE_OS::time();
+  write_csv(path.str(), "US", now - 10);
+
+  try
+  {
+    // Database file is checked every second
+    El::Geography::AddressInfo info(path.str().c_str(), GEOIP_STANDARD, 1);
+
+    if(info.country("1.0.0.1") != El::Country("US"))
+    {
+      throw Exception("Application::reload: unexpected initial country");
+    }
+
+    write_csv(path.str(), "RU", now);
+
+    // Lookups are served with the old index until the new one is built
+    // by background thread
+    El::Country country;
+
+    for(size_t i = 0; i < RELOAD_TIMEOUT * 100; ++i)
+    {
+      country = info.country("1.0.0.1");
+
+      if(country != El::Country("US"))
+      {
+        break;
+      }
+
+      ACE_OS::sleep(ACE_Time_Value(0, 10000));
+    }
+
+    if(country != El::Country("RU"))
+    {
+      std::ostringstream ostr;
+      ostr << "Application::reload: country " << country
+           << " instead of reloaded RU";
+
+      throw Exception(ostr.str());
+    }
+  }
+  catch(...)
+  {
+    unlink(path.str().c_str());
+    throw;
+  }
+
+  unlink(path.str().c_str());
+
+  std::cout << "Index reloaded" << std::endl;
+  return 0;
+}
+
+int
+Application::bench(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  size_t lookups = BENCH_LOOKUPS;
+  size_t threads = BENCH_THREADS;
+  bool geoip = false;
+  
+  for(ArgList::const_iterator it = arguments.begin(); it != arguments.end();
+      it++)
+  {
+    if(it->name == "lookups")
+    {
+      lookups = atol(it->value.c_str());
+    }
+    else if(it->name == "threads")
+    {
+      threads = atol(it->value.c_str());
+    }
+    else if(it->name == "geoip")
+    {
+      geoip = it->value == "1";
+    }
+  }
+
+  if(threads == 0)
+  {
+    throw InvalidArg("Application::bench: threads is 0");
+  }
+
+  std::auto_ptr<El::Geography::AddressInfo> info(address_info(arguments));
+
+  AddressArray addresses;
+  addresses.reserve(BENCH_ADDRESSES);
+
+  for(size_t i = 0; i < BENCH_ADDRESSES; i++)
+  {
+    addresses.push_back(random_ip());
+  }
+
+  for(size_t pass = 0; pass < (geoip ? 2 : 1); pass++)
+  {
+    El::Service::ThreadPool_var pool(
+      new El::Service::ThreadPool(this, "GeographyBench", threads));
+
+    typedef std::vector<LookupTask_var> TaskArray;
+    TaskArray tasks;
+    
+    for(size_t i = 0; i < threads; i++)
+    {
+      LookupTask_var task =
+        new LookupTask(*info, addresses, lookups / threads, pass == 1);
+      
+      tasks.push_back(task);
+      pool->execute(task.in());
+    }
+
+    ACE_Time_Value start = ACE_OS::gettimeofday();
+
+    pool->start();
+    pool->stop();
+    pool->wait();
+
+    ACE_Time_Value time = ACE_OS::gettimeofday() - start;
+
+    size_t found = 0;
+    
+    for(TaskArray::const_iterator it = tasks.begin(); it != tasks.end();
+        ++it)
+    {
+      found += (*it)->found;
+    }
+
+    double sec = time.sec() + (double)time.usec() / 1000000;
+    
+    std::cout << (pass ? "GeoIP: " : "Index: ") << lookups << " lookups in "
+              << threads << " threads, " << found << " located, time "
+              << El::Moment::time(time) << ", "
+              << (sec > 0 ? (double)lookups / sec : 0) << " lookups/sec"
+              << std::endl;
+  }
+  
+  return 0;
+}
+
+bool
+Application::notify(El::Service::Event* event) throw(El::Exception)
+{
+  El::Service::Error* error = dynamic_cast<El::Service::Error*>(event);
+
+  if(error)
+  {
+    std::cerr << "Application::notify: " << error->description << std::endl;
+  }
+  
+  return true;
+}
+
+//
+// Application::LookupTask class
+//
+void
+Application::LookupTask::execute() throw(El::Exception)
+{
+  size_t count = addresses.size();
+  
+  for(size_t i = 0; i < lookups; i++)
+  {
+    const char* ip = addresses[i % count].c_str();
+    
+    El::Country country = geoip ? info.geoip_country(ip) : info.country(ip);
+
+    if(country != El::Country::null)
+    {
+      ++found;
+    }
+  }
+}
@@ -14,12 +14,17 @@
 #ifndef _ELEMENTS_TESTS_GEOGRAPHY_APPLICATION_HPP_
 #define _ELEMENTS_TESTS_GEOGRAPHY_APPLICATION_HPP_
 
+#include <stdint.h>
+
 #include <string>
 #include <list>
+#include <vector>
 
 #include <El/Exception.hpp>
+#include <El/Service/ThreadPool.hpp>
+#include <El/Geography/AddressInfo.hpp>
 
-class Application
+class Application : public virtual El::Service::Callback
 {
 public:    
     EL_EXCEPTION(Exception, El::ExceptionBase);
@@ -51,6 +56,44 @@ private:
   int test(const ArgList& arguments)
     throw(InvalidArg, Exception, El::Exception);
 
+  int parity(const ArgList& arguments)
+    throw(InvalidArg, Exception, El::Exception);
+
+  int reload(const ArgList& arguments)
+    throw(InvalidArg, Exception, El::Exception);
+
+  int bench(const ArgList& arguments)
+    throw(InvalidArg, Exception, El::Exception);
+
+  virtual bool notify(El::Service::Event* event) throw(El::Exception);
+
+  static El::Geography::AddressInfo* address_info(const ArgList& arguments)
+    throw(InvalidArg, Exception, El::Exception);
+
+  static std::string random_ip() throw(El::Exception);
+
+  typedef std::vector<std::string> AddressArray;
+
+  struct LookupTask : public El::Service::ThreadPool::TaskBase
+  {
+    El::Geography::AddressInfo& info;
+    const AddressArray& addresses;
+    size_t lookups;
+    bool geoip;
+    size_t found;
+
+    LookupTask(El::Geography::AddressInfo& info_val,
+               const AddressArray& addresses_val,
+               size_t lookups_val,
+               bool geoip_val)
+      throw(El::Exception);
+
+    virtual ~LookupTask() throw() {}
+
+    virtual void execute() throw(El::Exception);
+  };
+
+  typedef El::RefCount::SmartPtr<LookupTask> LookupTask_var;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -68,4 +111,22 @@ Application::Argument::Argument(const char* nm, const char* vl)
 {
 }
 
+//
+// Application::LookupTask class
+//
+inline
+Application::LookupTask::LookupTask(El::Geography::AddressInfo& info_val,
+                                    const AddressArray& addresses_val,
+                                    size_t lookups_val,
+                                    bool geoip_val)
+  throw(El::Exception)
+    : El::Service::ThreadPool::TaskBase(true),
+      info(info_val),
+      addresses(addresses_val),
+      lookups(lookups_val),
+      geoip(geoip_val),
+      found(0)
+{
+}
+
 #endif // _ELEMENTS_TESTS_GEOGRAPHY_APPLICATION_HPP_
@@ -15,6 +15,7 @@
 #include <fstream>
 #include <iostream>
 #include <list>
+#include <vector>
 #include <fstream>
 
 #include <libxml/xmlmemory.h>
@@ -33,10 +34,12 @@
 
 #include <El/Service/Service.hpp>
 #include <El/Service/ThreadPool.hpp>
+#include <El/FileSystem.hpp>
 
 #include <El/LibXML/Use.hpp>
 #include <El/LibXML/HTMLParser.hpp>
 #include <El/LibXML/Traverser.hpp>
+#include <El/LibXML/HTMLStreamParser.hpp>
 
 namespace
 {
@@ -45,10 +48,127 @@ namespace
     "--xpath=<xpath expression>? --agent=<user-agent>? --encoding=<encoding>? "
     "--threads=<thread count>? --iterations=<iteration count>? "
     "--max-size=<max downlowd size>? --timeout=<request timeout in sec>? "
-    "--redirects=<redirects count>? --dump=(xml|plain|render-html)?";
+    "--redirects=<redirects count>? --dump=(xml|plain|render-html)? "
+    "--stream?\n"
+    "       ElTestHTMLParser --bench=<html files directory> "
+    "--iterations=<iteration count>? --chunk=<stream chunk size>?";
 
   const char USER_AGENT[] =
     "Mozilla/4.0 (compatible; MSIE 6.0; Windows NT 5.1; SV1; .NET CLR 1.1.4322)";
+
+  const int PARSE_OPTIONS = HTML_PARSE_NONET;
+
+  double
+  seconds(const ACE_Time_Value& tm) throw()
+  {
+    return tm.sec() + (double)tm.usec() / 1000000;
+  }
+
+  // Whitespace sequences collapsed to single space
+  std::string
+  normalize(const std::string& text) throw(El::Exception)
+  {
+    std::string result;
+    result.reserve(text.length());
+
+    bool space = false;
+    
+    for(std::string::const_iterator i(text.begin()), e(text.end()); i != e;
+        ++i)
+    {
+      if(isspace((unsigned char)*i))
+      {
+        space = true;
+        continue;
+      }
+
+      if(space && !result.empty())
+      {
+        result += ' ';
+      }
+
+      space = false;
+      result += *i;
+    }
+
+    return result;
+  }
+
+  // Document tree built with fresh parser context as before pooling
+  void
+  dom_fresh_text(const std::string& page, std::ostream& ostr)
+    throw(El::Exception)
+  {
+    El::LibXML::ErrorRecorderHandler error_handler;
+    El::LibXML::Use::set_error_handler(&error_handler);
+
+    htmlDocPtr doc = htmlReadMemory(page.c_str(),
+                                    page.length(),
+                                    0,
+                                    0,
+                                    PARSE_OPTIONS);
+
+    El::LibXML::Use::set_error_handler(0);
+
+    if(doc == 0)
+    {
+      throw El::LibXML::Exception("htmlReadMemory failed");
+    }
+
+    try
+    {
+      El::LibXML::Traverser traverser;
+
+      El::LibXML::TextBuilder builder(ostr,
+                                      El::LibXML::TextBuilder::OT_TEXT);
+
+      traverser.traverse_list(doc->children, builder);
+    }
+    catch(...)
+    {
+      xmlFreeDoc(doc);
+      throw;
+    }
+
+    xmlFreeDoc(doc);
+  }
+
+  void
+  dom_text(const std::string& page, std::ostream& ostr)
+    throw(El::Exception)
+  {
+    El::LibXML::HTMLParser parser;
+
+    htmlDocPtr doc = parser.parse(page.c_str(),
+                                  page.length(),
+                                  0,
+                                  0,
+                                  0,
+                                  PARSE_OPTIONS);
+
+    El::LibXML::Traverser traverser;
+    El::LibXML::TextBuilder builder(ostr, El::LibXML::TextBuilder::OT_TEXT);
+    traverser.traverse_list(doc->children, builder);
+  }
+
+  // Page is fed in chunk_size portions as if it comes from network
+  void
+  stream_text(const std::string& page, std::ostream& ostr, size_t chunk_size)
+    throw(El::Exception)
+  {
+    El::LibXML::StreamTextBuilder builder(ostr,
+                                          El::LibXML::TextBuilder::OT_TEXT);
+
+    El::LibXML::HTMLStreamParser parser(builder);
+
+    parser.parse(page.c_str(),
+                 page.length(),
+                 0,
+                 0,
+                 0,
+                 PARSE_OPTIONS,
+                 chunk_size);
+  }
 }
 
 class Application : public virtual El::Service::Callback
@@ -57,7 +177,13 @@ public:
   EL_EXCEPTION(Exception, El::ExceptionBase);
     
 public:
-  Application() throw() : dump_format_(DF_NONE), iterations_(1) {}
+  Application() throw()
+      : dump_format_(DF_NONE),
+        iterations_(1),
+        stream_(false)
+  {
+  }
+
   virtual ~Application() throw() {}
   
   int run(int& argc, char** argv) throw();
@@ -65,6 +191,8 @@ public:
 private:
   virtual bool notify(El::Service::Event* event) throw(El::Exception);  
 
+  void bench(const char* dir, size_t chunk_size) throw(El::Exception);
+
 private:
 
   typedef ACE_Thread_Mutex  Mutex;
@@ -85,6 +213,7 @@ private:
   std::string xpath_;
   DumpFormat dump_format_;
   size_t iterations_;
+  bool stream_;
   
   El::Service::ThreadPool_var thread_pool_;
 
@@ -131,6 +260,8 @@ Application::run(int& argc, char** argv) throw()
     size_t timeout = 60;
     size_t max_size = ULONG_MAX;
     size_t threads = 1;
+    size_t chunk_size = 4096;
+    std::string bench_dir;
 
     for(int i = 1; i < argc; i++)
     {
@@ -197,6 +328,23 @@ Application::run(int& argc, char** argv) throw()
           throw Exception(ostr.str());
         }        
       }
+      else if(!strncmp(arg, "--chunk=", 8))
+      {
+        if(!El::String::Manip::numeric(arg + 8, chunk_size))
+        {
+          std::ostringstream ostr;
+          ostr << "Invalid --chunk value\n" << USAGE;
+          throw Exception(ostr.str());
+        }        
+      }
+      else if(!strncmp(arg, "--bench=", 8))
+      {
+        bench_dir = arg + 8;
+      }
+      else if(!strcmp(arg, "--stream"))
+      {
+        stream_ = true;
+      }
       else if(!strncmp(arg, "--dump=", 7))
       {
         const char* format = arg + 7;
@@ -216,6 +364,21 @@ Application::run(int& argc, char** argv) throw()
       } 
     }
 
+    if(!bench_dir.empty())
+    {
+      bench(bench_dir.c_str(), chunk_size);
+      return 0;
+    }
+
+    if(stream_ && (dump_format_ == DF_XML || !xpath_.empty()))
+    {
+      std::ostringstream ostr;
+      ostr << "--stream can't be used with --dump=xml or --xpath\n"
+           << USAGE;
+      
+      throw Exception(ostr.str());
+    }
+
     if(!strncasecmp(uri_.c_str(), "http://", 7))
     {
       El::Net::HTTP::HeaderList headers;
@@ -363,6 +526,36 @@ Application::notify(El::Service::Event* event)
   try
   {
     El::LibXML::ErrorRecorderHandler error_handler;
+
+    if(stream_)
+    {
+      std::ostringstream text;
+      
+      El::LibXML::StreamTextBuilder builder(
+        dump_format_ == DF_NONE ? text : ostr,
+        dump_format_ == DF_RENDER_HTML ?
+        El::LibXML::TextBuilder::OT_RENDERED_HTML :
+        El::LibXML::TextBuilder::OT_TEXT);
+
+      El::LibXML::HTMLStreamParser parser(builder);
+      
+      parser.parse_file(uri_.c_str(),
+                        encoding_.c_str(),
+                        &error_handler,
+                        HTML_PARSE_NONET);
+
+      error_handler.dump(estr);
+
+      {
+        Guard guard(lock_);
+        std::cerr << estr.str();
+        std::cout << ostr.str();
+      }
+
+      thread_pool_->execute(parse_task);
+      return true;
+    }
+    
     El::LibXML::HTMLParser parser;
 
     htmlDocPtr doc = parser.parse_file(uri_.c_str(),
@@ -470,3 +663,112 @@ Application::notify(El::Service::Event* event)
   
   return true;
 }
+
+void
+Application::bench(const char* dir, size_t chunk_size) throw(El::Exception)
+{
+  typedef std::vector<std::string> PageArray;
+
+  PageArray pages;
+  size_t corpus_size = 0;
+
+  {
+    El::FileSystem::DirectoryReader reader(dir);
+
+    for(size_t i = 0; i < reader.count(); ++i)
+    {
+      const dirent& entry = reader[i];
+
+      if(entry.d_type != DT_REG)
+      {
+        continue;
+      }
+
+      std::string path = std::string(dir) + "/" + entry.d_name;
+      std::fstream file(path.c_str(), std::ios::in);
+
+      if(!file.is_open())
+      {
+        std::ostringstream ostr;
+        ostr << "Application::bench: can't open '" << path << "'";
+        throw Exception(ostr.str());
+      }
+
+      std::ostringstream ostr;
+      ostr << file.rdbuf();
+
+      pages.push_back(ostr.str());
+      corpus_size += pages.rbegin()->length();
+    }
+  }
+
+  if(pages.empty())
+  {
+    std::ostringstream ostr;
+    ostr << "Application::bench: no files in '" << dir << "'";
+    throw Exception(ostr.str());
+  }
+
+  std::cout << "Corpus: " << pages.size() << " pages, " << corpus_size
+            << " bytes; stream chunk " << chunk_size << " bytes\n";
+
+  size_t mismatches = 0;
+  
+  for(PageArray::const_iterator i(pages.begin()), e(pages.end()); i != e;
+      ++i)
+  {
+    std::ostringstream dom;
+    dom_text(*i, dom);
+    
+    std::ostringstream stream;
+    stream_text(*i, stream, chunk_size);
+
+    if(normalize(dom.str()) != normalize(stream.str()))
+    {
+      ++mismatches;
+    }
+  }
+
+  std::cout << "Text mismatches: " << mismatches << std::endl;
+
+  const char* modes[] = { "dom-fresh", "dom", "stream" };
+
+  for(size_t mode = 0; mode < sizeof(modes) / sizeof(modes[0]); ++mode)
+  {
+    size_t text_size = 0;
+    ACE_Time_Value start = ACE_OS::gettimeofday();
+    
+    for(size_t it = 0; it < iterations_; ++it)
+    {
+      for(PageArray::const_iterator i(pages.begin()), e(pages.end());
+          i != e; ++i)
+      {
+        std::ostringstream ostr;
+
+        switch(mode)
+        {
+        case 0: dom_fresh_text(*i, ostr); break;
+        case 1: dom_text(*i, ostr); break;
+        default: stream_text(*i, ostr, chunk_size); break;
+        }
+
+        text_size += ostr.str().length();
+      }
+    }
+
+    double time = seconds(ACE_OS::gettimeofday() - start);
+    size_t docs = pages.size() * iterations_;
+
+    std::cout << modes[mode] << ": " << docs << " docs in " << time
+              << " sec, " << (time > 0 ? docs / time : 0) << " docs/sec, "
+              << (time > 0 ? (double)corpus_size * iterations_ / time /
+                  (1024 * 1024) : 0)
+              << " MB/sec, text " << text_size << " bytes\n";
+  }
+
+  if(mismatches)
+  {
+    throw Exception("Application::bench: streaming text differs from "
+                    "DOM one");
+  }
+}
@@ -0,0 +1,624 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file   FieldsMain.cpp
+ * @author Karen Arutyunov
+ * $Id:$
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <new>
+#include <string>
+#include <sstream>
+#include <iostream>
+
+#include <ace/OS.h>
+
+#include <El/Exception.hpp>
+#include <El/String/ListParser.hpp>
+#include <El/Net/HTTP/Params.hpp>
+#include <El/Net/HTTP/FieldTable.hpp>
+
+//
+// Allocation counting hook
+//
+namespace
+{
+  unsigned long long heap_allocations = 0;
+}
+
+void*
+operator new(size_t size) throw(std::bad_alloc)
+{
+  ++heap_allocations;
+
+  void* ptr = malloc(size ? size : 1);
+
+  if(ptr == 0)
+  {
+    throw std::bad_alloc();
+  }
+
+  return ptr;
+}
+
+void
+operator delete(void* ptr) throw()
+{
+  free(ptr);
+}
+
+void*
+operator new[](size_t size) throw(std::bad_alloc)
+{
+  return operator new(size);
+}
+
+void
+operator delete[](void* ptr) throw()
+{
+  operator delete(ptr);
+}
+
+namespace
+{
+  const char USAGE[] =
+    "Usage: ElTestHTTPFields [--iterations=<iteration count>]";
+
+  const char QUERY[] =
+    "q=elements+lib&lang=eng&c=us&s=0&n=20&v=1&m=a&p=1&t=1&h=0&sort=date";
+
+  const char HEADER_BLOCK[] =
+    "Host: example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) Gecko/20100101\r\n"
+    "Accept: text/html,application/xhtml+xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Connection: keep-alive\r\n"
+    "Referer: http://example.com/search?q=elements\r\n"
+    "Cookie: uid=1; sid=2; l=eng; c=us\r\n"
+    "If-None-Match: \"5d8c72a5edda8\"\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "\r\n";
+
+  // Looked up by request processing code, some are absent
+  const char* const LOOKUPS[] =
+  {
+    "host",
+    "user-agent",
+    "accept-encoding",
+    "if-none-match",
+    "referer",
+    "x-forwarded-for",
+    "authorization"
+  };
+
+  double
+  seconds(const ACE_Time_Value& tm) throw()
+  {
+    return tm.sec() + (double)tm.usec() / 1000000;
+  }
+}
+
+class Application
+{
+public:
+  EL_EXCEPTION(Exception, El::ExceptionBase);
+
+public:
+  Application() throw() {}
+  virtual ~Application() throw() {}
+
+  int run(int& argc, char** argv) throw();
+
+private:
+  void check_headers() throw(Exception, El::Exception);
+  void check_params() throw(Exception, El::Exception);
+  void check_index() throw(Exception, El::Exception);
+  void check_conversion() throw(Exception, El::Exception);
+
+  static void check_value(const El::Net::HTTP::FieldTable& table,
+                          const char* name,
+                          const char* expected,
+                          const char* context)
+    throw(Exception, El::Exception);
+
+  // Parses header block into the list; returns lookup hits
+  static size_t process_list(El::Net::HTTP::HeaderList& headers,
+                             El::Net::HTTP::ParamList& params)
+    throw(Exception, El::Exception);
+
+  static size_t process_table(El::Net::HTTP::FieldTable& headers,
+                              El::Net::HTTP::FieldTable& params)
+    throw(Exception, El::Exception);
+
+  void bench(size_t iterations) throw(Exception, El::Exception);
+};
+
+int
+main(int argc, char** argv)
+{
+  Application app;
+  return app.run(argc, argv);
+}
+
+int
+Application::run(int& argc, char** argv) throw()
+{
+  try
+  {
+    size_t iterations = 100000;
+
+    for(int i = 1; i < argc; i++)
+    {
+      const char* arg = argv[i];
+
+      if(!strncmp(arg, "--iterations=", 13))
+      {
+        iterations = atol(arg + 13);
+      }
+      else
+      {
+        std::ostringstream ostr;
+        ostr << "Unexpected argument '" << arg << "'\n" << USAGE;
+        throw Exception(ostr.str());
+      }
+    }
+
+    check_headers();
+    check_params();
+    check_index();
+    check_conversion();
+
+    if(iterations)
+    {
+      bench(iterations);
+    }
+
+    return 0;
+  }
+  catch(const El::Exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+  }
+  catch(...)
+  {
+    std::cerr << "unknown exception caught.\n";
+  }
+
+  return -1;
+}
+
+void
+Application::check_value(const El::Net::HTTP::FieldTable& table,
+                         const char* name,
+                         const char* expected,
+                         const char* context)
+  throw(Exception, El::Exception)
+{
+  const char* value = table.find(name);
+
+  if(expected == 0 ? value != 0 : value == 0 || strcmp(value, expected))
+  {
+    std::ostringstream ostr;
+    ostr << "Application::" << context << ": unexpected value of '"
+         << name << "': " << (value ? value : "<none>") << " instead of "
+         << (expected ? expected : "<none>");
+
+    throw Exception(ostr.str());
+  }
+}
+
+void
+Application::check_headers() throw(Exception, El::Exception)
+{
+  const char block[] =
+    "Content-Type :  text/html; charset=utf-8 \r\n"
+    "X-Folded: first\r\n"
+    " \t second\r\n"
+    "\tthird\r\n"
+    "Empty:\n"
+    "set-cookie: a=1\r\n"
+    "Set-Cookie: b=2\r\n"
+    "\r\n"
+    "body";
+
+  El::Net::HTTP::FieldTable table;
+
+  size_t consumed = table.parse_headers(block, sizeof(block) - 1);
+
+  if(consumed != sizeof(block) - 5 || table.size() != 5)
+  {
+    std::ostringstream ostr;
+    ostr << "Application::check_headers: " << consumed
+         << " bytes consumed, " << table.size() << " fields parsed";
+
+    throw Exception(ostr.str());
+  }
+
+  check_value(table, "content-type", "text/html; charset=utf-8",
+              "check_headers");
+
+  check_value(table, "X-FOLDED", "first second third", "check_headers");
+  check_value(table, "empty", "", "check_headers");
+  check_value(table, "Set-Cookie", "a=1", "check_headers");
+  check_value(table, "Content", 0, "check_headers");
+
+  El::Net::HTTP::FieldTable::Field field = table[4];
+
+  if(strcmp(field.name, "Set-Cookie") || field.value_length != 3 ||
+     table[1].value_length != strlen(table[1].value))
+  {
+    throw Exception("Application::check_headers: unexpected fields");
+  }
+
+  // Failed parsing leaves table intact
+  const char* const invalid[] =
+  {
+    "Valid: 1\r\nNo colon\r\n",
+    "Valid: 1\r\n: no name\r\n",
+    " continuation\r\n"
+  };
+
+  for(size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i)
+  {
+    try
+    {
+      table.parse_headers(invalid[i], strlen(invalid[i]));
+
+      std::ostringstream ostr;
+      ostr << "Application::check_headers: no exception for '"
+           << invalid[i] << "'";
+
+      throw Exception(ostr.str());
+    }
+    catch(const El::Net::HTTP::InvalidArg&)
+    {
+    }
+
+    if(table.size() != 5)
+    {
+      throw Exception(
+        "Application::check_headers: table modified by failed parsing");
+    }
+
+    check_value(table, "valid", 0, "check_headers");
+    check_value(table, "x-folded", "first second third", "check_headers");
+  }
+
+  // No terminating empty line and last line without LF
+  consumed = table.parse_headers("A: 1\nB:2", 8);
+
+  if(consumed != 8 || table.size() != 7)
+  {
+    throw Exception(
+      "Application::check_headers: unterminated block parsing failed");
+  }
+
+  check_value(table, "b", "2", "check_headers");
+}
+
+void
+Application::check_params() throw(Exception, El::Exception)
+{
+  const char query[] = "a=1&&b=x+y%20z&flag&c=%D0%B0&=v&a=2";
+
+  El::Net::HTTP::FieldTable table;
+  table.parse_params(query, sizeof(query) - 1);
+
+  El::Net::HTTP::ParamList list(query);
+
+  if(table.size() != list.size())
+  {
+    std::ostringstream ostr;
+    ostr << "Application::check_params: " << table.size()
+         << " params parsed instead of " << list.size();
+
+    throw Exception(ostr.str());
+  }
+
+  size_t i = 0;
+
+  for(El::Net::HTTP::ParamList::const_iterator it(list.begin()),
+        e(list.end()); it != e; ++it, ++i)
+  {
+    El::Net::HTTP::FieldTable::Field field = table[i];
+
+    if(it->name != field.name || it->value != field.value ||
+       it->name.length() != field.name_length ||
+       it->value.length() != field.value_length)
+    {
+      std::ostringstream ostr;
+      ostr << "Application::check_params: param " << i << " is '"
+           << field.name << "'='" << field.value << "' instead of '"
+           << it->name << "'='" << it->value << "'";
+
+      throw Exception(ostr.str());
+    }
+  }
+
+  check_value(table, "a", "1", "check_params");
+  check_value(table, "B", "x y z", "check_params");
+  check_value(table, "flag", "", "check_params");
+
+  const char invalid[] = "x=1&y=%Z&z=3";
+
+  try
+  {
+    table.parse_params(invalid, sizeof(invalid) - 1);
+    throw Exception("Application::check_params: no exception for '%Z'");
+  }
+  catch(const El::Net::HTTP::InvalidArg&)
+  {
+  }
+
+  check_value(table, "x", 0, "check_params");
+
+  table.clear();
+  table.parse_params(invalid, sizeof(invalid) - 1, true);
+
+  if(table.size() != 2)
+  {
+    throw Exception("Application::check_params: lax parsing failed");
+  }
+
+  check_value(table, "z", "3", "check_params");
+}
+
+void
+Application::check_index() throw(Exception, El::Exception)
+{
+  El::Net::HTTP::FieldTable table;
+
+  // Make index grow several times
+  for(size_t i = 0; i < 1000; ++i)
+  {
+    std::ostringstream name;
+    name << "X-Header-" << i;
+
+    std::ostringstream value;
+    value << i;
+
+    table.add(name.str().c_str(), value.str().c_str());
+  }
+
+  std::string long_name(300, 'N');
+  table.add(long_name.c_str(), "long");
+
+  for(size_t i = 0; i < 1000; ++i)
+  {
+    std::ostringstream name;
+    name << "x-HEADER-" << i;
+
+    std::ostringstream value;
+    value << i;
+
+    check_value(table, name.str().c_str(), value.str().c_str(),
+                "check_index");
+  }
+
+  std::string long_lower(300, 'n');
+  check_value(table, long_lower.c_str(), "long", "check_index");
+  check_value(table, "X-Header-1000", 0, "check_index");
+
+  // Same named field added after others is not found
+  table.add("x-header-7", "duplicate");
+  check_value(table, "X-Header-7", "7", "check_index");
+
+  try
+  {
+    table.add("", "value");
+    throw Exception("Application::check_index: empty name accepted");
+  }
+  catch(const El::Net::HTTP::InvalidArg&)
+  {
+  }
+
+  // Reused table doesn't allocate
+  table.clear();
+
+  unsigned long long allocations = heap_allocations;
+  table.parse_headers(HEADER_BLOCK, sizeof(HEADER_BLOCK) - 1);
+
+  if(heap_allocations != allocations)
+  {
+    throw Exception(
+      "Application::check_index: cleared table allocated on parsing");
+  }
+}
+
+void
+Application::check_conversion() throw(Exception, El::Exception)
+{
+  El::Net::HTTP::FieldTable table;
+  table.parse_headers(HEADER_BLOCK, sizeof(HEADER_BLOCK) - 1);
+
+  El::Net::HTTP::HeaderList headers;
+  table.copy(headers);
+
+  El::Net::HTTP::FieldTable table2;
+  table2.assign(headers);
+
+  if(headers.size() != table.size() || table2.size() != table.size())
+  {
+    throw Exception(
+      "Application::check_conversion: unexpected header count");
+  }
+
+  size_t i = 0;
+
+  for(El::Net::HTTP::HeaderList::const_iterator it(headers.begin()),
+        e(headers.end()); it != e; ++it, ++i)
+  {
+    if(it->name != table[i].name || it->value != table[i].value ||
+       strcmp(table2[i].name, table[i].name) ||
+       strcmp(table2[i].value, table[i].value))
+    {
+      std::ostringstream ostr;
+      ostr << "Application::check_conversion: header " << i
+           << " differs; '" << table[i].name << "', '" << it->name
+           << "', '" << table2[i].name << "'";
+
+      throw Exception(ostr.str());
+    }
+
+    if(strcmp(headers.find(it->name.c_str()),
+              table.find(it->name.c_str())))
+    {
+      throw Exception(
+        "Application::check_conversion: lookup results differ");
+    }
+  }
+
+  El::Net::HTTP::ParamList params(QUERY);
+
+  table.clear();
+  table.assign(params);
+
+  El::Net::HTTP::ParamList params2;
+  table.copy(params2);
+
+  if(params2.size() != params.size() ||
+     params2.rbegin()->name != "sort" || params2.rbegin()->value != "date")
+  {
+    throw Exception(
+      "Application::check_conversion: unexpected parameter list");
+  }
+}
+
+size_t
+Application::process_list(El::Net::HTTP::HeaderList& headers,
+                          El::Net::HTTP::ParamList& params)
+  throw(Exception, El::Exception)
+{
+  // As Session::recv_response_header does, line by line
+  const char* ptr = HEADER_BLOCK;
+  El::Net::HTTP::Header header;
+
+  while(true)
+  {
+    const char* eol = strstr(ptr, "\r\n");
+
+    if(eol == ptr)
+    {
+      break;
+    }
+
+    const char* colon = (const char*)memchr(ptr, ':', eol - ptr);
+    const char* value = colon + 1 + strspn(colon + 1, " \t");
+
+    header.name.assign(ptr, colon - ptr);
+    header.value.assign(value, eol - value);
+
+    headers.push_back(header);
+    ptr = eol + 2;
+  }
+
+  El::String::ListParser parser(QUERY, "&");
+
+  const char* item = 0;
+  while((item = parser.next_item()) != 0)
+  {
+    params.add(item);
+  }
+
+  size_t hits = 0;
+
+  for(size_t i = 0; i < sizeof(LOOKUPS) / sizeof(LOOKUPS[0]); ++i)
+  {
+    hits += headers.find(LOOKUPS[i]) != 0;
+  }
+
+  hits += params.find("lang") != 0;
+  hits += params.find("sort") != 0;
+
+  return hits;
+}
+
+size_t
+Application::process_table(El::Net::HTTP::FieldTable& headers,
+                           El::Net::HTTP::FieldTable& params)
+  throw(Exception, El::Exception)
+{
+  headers.parse_headers(HEADER_BLOCK, sizeof(HEADER_BLOCK) - 1);
+  params.parse_params(QUERY, sizeof(QUERY) - 1);
+
+  size_t hits = 0;
+
+  for(size_t i = 0; i < sizeof(LOOKUPS) / sizeof(LOOKUPS[0]); ++i)
+  {
+    hits += headers.find(LOOKUPS[i]) != 0;
+  }
+
+  hits += params.find("lang") != 0;
+  hits += params.find("sort") != 0;
+
+  return hits;
+}
+
+void
+Application::bench(size_t iterations) throw(Exception, El::Exception)
+{
+  for(size_t mode = 0; mode < 3; ++mode)
+  {
+    unsigned long long allocations = heap_allocations;
+    size_t hits = 0;
+
+    // Tables are reused from request to request as by request handlers
+    El::Net::HTTP::FieldTable header_table;
+    El::Net::HTTP::FieldTable param_table;
+
+    ACE_Time_Value start = ACE_OS::gettimeofday();
+
+    for(size_t i = 0; i < iterations; ++i)
+    {
+      if(mode == 0)
+      {
+        El::Net::HTTP::HeaderList headers;
+        El::Net::HTTP::ParamList params;
+
+        hits += process_list(headers, params);
+      }
+      else if(mode == 1)
+      {
+        El::Net::HTTP::FieldTable headers;
+        El::Net::HTTP::FieldTable params;
+
+        hits += process_table(headers, params);
+      }
+      else
+      {
+        header_table.clear();
+        param_table.clear();
+
+        hits += process_table(header_table, param_table);
+      }
+    }
+
+    double time = seconds(ACE_OS::gettimeofday() - start);
+
+    if(hits != iterations * 7)
+    {
+      std::ostringstream ostr;
+      ostr << "Application::bench: " << hits << " lookup hits instead of "
+           << iterations * 7;
+
+      throw Exception(ostr.str());
+    }
+
+    const char* const names[] = { "list", "table", "reused table" };
+
+    std::cout << names[mode] << ": "
+              << (double)(heap_allocations - allocations) / iterations
+              << " heap allocations/request, "
+              << time * 1000000000 / iterations << " ns/request"
+              << std::endl;
+  }
+}
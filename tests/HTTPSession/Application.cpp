@@ -11,10 +11,21 @@
  * $Id:$
  */
 #include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <zlib.h>
+
 #include <string>
 #include <iostream>
 #include <sstream>
 
+#include <El/Net/HTTP/StatusCodes.hpp>
 #include <El/Net/HTTP/Session.hpp>
 
 #include "Application.hpp"
@@ -24,7 +35,248 @@ namespace
   const char USAGE[] =
   "\nUsage:\nElTestHTTPSession (help|"
   "request (header=\"<name>:<value>\")* [preserve-content-encoding=(0|1)] "
-  "[print-headers=(0|1)] url=<url> )* \n";
+  "[print-headers=(0|1)] [read-body=(0|1)] url=<url> )* |"
+  "bench [size=<bytes>] [runs=<number>] | redirect)\n";
+
+  enum Framing
+  {
+    FR_LENGTH,
+    FR_CHUNKED,
+    FR_CLOSE
+  };
+
+  struct Case
+  {
+    const char* name;
+    const char* encoding;
+    Framing framing;
+  };
+
+  const Case CASES[] =
+  {
+    { "identity, content-length", 0, FR_LENGTH },
+    { "identity, chunked", 0, FR_CHUNKED },
+    { "gzip, chunked", "gzip", FR_CHUNKED },
+    { "gzip, till close", "gzip", FR_CLOSE },
+    { "deflate, content-length", "deflate", FR_LENGTH },
+    { "deflate, chunked", "deflate", FR_CHUNKED }
+  };
+
+  //
+  // Serves single connection of a local server writing response by
+  // random size pieces
+  //
+  struct Server
+  {
+    int socket;
+    std::string response;
+    size_t max_write;
+    unsigned int seed;
+    std::string error;
+
+    static void* run(void* arg) throw();
+  };
+
+  void*
+  Server::run(void* arg) throw()
+  {
+    Server* server = static_cast<Server*>(arg);
+    int sock = accept(server->socket, 0, 0);
+
+    if(sock < 0)
+    {
+      server->error = "accept failed";
+      return 0;
+    }
+
+    std::string request;
+    char buff[1024];
+    
+    while(request.find("\r\n\r\n") == std::string::npos)
+    {
+      ssize_t len = recv(sock, buff, sizeof(buff), 0);
+
+      if(len <= 0)
+      {
+        server->error = "failed to read request";
+        close(sock);
+        return 0;
+      }
+
+      request.append(buff, len);
+    }
+
+    const char* ptr = server->response.c_str();
+    size_t left = server->response.size();
+
+    while(left)
+    {
+      size_t len = std::min((size_t)rand_r(&server->seed) %
+                            server->max_write + 1, left);
+
+      ssize_t written = send(sock, ptr, len, MSG_NOSIGNAL);
+
+      if(written <= 0)
+      {
+        server->error = "failed to write response";
+        break;
+      }
+
+      ptr += written;
+      left -= written;
+    }
+
+    close(sock);
+    return 0;
+  }
+
+  //
+  // Returns socket listening on loopback interface
+  //
+  int
+  listen_local(unsigned short& port)
+    throw(Application::Exception, El::Exception)
+  {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+
+    if(sock < 0)
+    {
+      throw Application::Exception("listen_local: socket failed");
+    }
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    socklen_t addr_len = sizeof(addr);
+  
+    if(bind(sock, (sockaddr*)&addr, sizeof(addr)) ||
+       listen(sock, 5) ||
+       getsockname(sock, (sockaddr*)&addr, &addr_len))
+    {
+      close(sock);
+      throw Application::Exception("listen_local: failed to listen");
+    }
+
+    port = ntohs(addr.sin_port);
+    return sock;
+  }
+
+  std::string
+  make_body(size_t size) throw(El::Exception)
+  {
+    const char* WORDS[] =
+    {
+      "elements ", "abstractions ", "library ", "stream ", "socket ",
+      "session ", "chunk ", "body ", "\n", "decode ", "buffer ", "<p>"
+    };
+
+    std::string body;
+    body.reserve(size + 16);
+
+    unsigned int seed = 1;
+
+    while(body.size() < size)
+    {
+      body += WORDS[rand_r(&seed) % (sizeof(WORDS) / sizeof(WORDS[0]))];
+    }
+
+    body.resize(size);
+    return body;
+  }
+
+  std::string
+  compress(const std::string& body, bool gzip)
+    throw(Application::Exception, El::Exception)
+  {
+    z_stream zstream;
+    memset(&zstream, 0, sizeof(zstream));
+
+    if(deflateInit2(&zstream,
+                    Z_DEFAULT_COMPRESSION,
+                    Z_DEFLATED,
+                    gzip ? 16 + MAX_WBITS : MAX_WBITS,
+                    8,
+                    Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+      throw Application::Exception("compress: deflateInit2 failed");
+    }
+
+    std::string result(deflateBound(&zstream, body.size()), '\0');
+
+    zstream.next_in = (Bytef*)body.c_str();
+    zstream.avail_in = body.size();
+    zstream.next_out = (Bytef*)&result[0];
+    zstream.avail_out = result.size();
+
+    int ret = deflate(&zstream, Z_FINISH);
+    result.resize(zstream.total_out);
+    deflateEnd(&zstream);
+
+    if(ret != Z_STREAM_END)
+    {
+      throw Application::Exception("compress: deflate failed");
+    }
+
+    return result;
+  }
+  
+  std::string
+  make_response(const std::string& body, const Case& test_case)
+    throw(Application::Exception, El::Exception)
+  {
+    std::string content = test_case.encoding ?
+      compress(body, strcmp(test_case.encoding, "gzip") == 0) : body;
+    
+    std::ostringstream ostr;
+    ostr << "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n";
+
+    if(test_case.encoding)
+    {
+      ostr << "Content-Encoding: " << test_case.encoding << "\r\n";
+    }
+    
+    switch(test_case.framing)
+    {
+    case FR_LENGTH:
+      {
+        ostr << "Content-Length: " << content.size() << "\r\n\r\n"
+             << content;
+        break;
+      }
+    case FR_CLOSE:
+      {
+        ostr << "Connection: close\r\n\r\n" << content;
+        break;
+      }
+    case FR_CHUNKED:
+      {
+        ostr << "Transfer-Encoding: chunked\r\n\r\n";
+
+        unsigned int seed = 1;
+        
+        for(size_t pos = 0, i = 0; pos < content.size(); ++i)
+        {
+          size_t len =
+            std::min((size_t)rand_r(&seed) % 32768 + 1, content.size() - pos);
+          
+          ostr << std::hex << len << std::dec << (i % 3 ? "" : ";ext=1")
+               << "\r\n";
+          
+          ostr.write(content.c_str() + pos, len);
+          ostr << "\r\n";
+          
+          pos += len;
+        }
+
+        ostr << "0\r\nX-Checksum: " << content.size() << "\r\n\r\n";
+        break;
+      }
+    }
+
+    return ostr.str();
+  }
 }
 
 int
@@ -108,6 +360,14 @@ Application::run(int& argc, char** argv)
   {
     test(arguments);
   }
+  else if(command == "bench")
+  {
+    return bench(arguments);
+  }
+  else if(command == "redirect")
+  {
+    return redirect(arguments);
+  }
   
   return 0;
 }
@@ -127,6 +387,7 @@ Application::test(const ArgList& arguments)
   El::Net::HTTP::HeaderList headers;
   bool preserve_content_encoding = false;
   bool print_headers = false;
+  bool read_body = false;
   
   for(ArgList::const_iterator it = arguments.begin(); it != arguments.end();
       it++)
@@ -156,23 +417,36 @@ Application::test(const ArgList& arguments)
         }
       }
 
-      std::istream& body_stream = session.response_body();
-      unsigned long read_bytes = 0;
-
-      while(true)
+      if(read_body)
       {
-        char buff[1024];
-        body_stream.read(buff, sizeof(buff));
-
-        read_bytes = body_stream.gcount();
-
-        if(read_bytes)
+        const char* data = 0;
+        size_t size = 0;
+        
+        while(session.read_body(data, size))
         {
-          std::cout.write(buff, read_bytes);
+          std::cout.write(data, size);
         }
-        else
+      }
+      else
+      {
+        std::istream& body_stream = session.response_body();
+        unsigned long read_bytes = 0;
+
+        while(true)
         {
-          break;
+          char buff[1024];
+          body_stream.read(buff, sizeof(buff));
+
+          read_bytes = body_stream.gcount();
+
+          if(read_bytes)
+          {
+            std::cout.write(buff, read_bytes);
+          }
+          else
+          {
+            break;
+          }
         }
       }
 
@@ -181,6 +455,7 @@ Application::test(const ArgList& arguments)
       headers.clear();
       preserve_content_encoding = false;
       print_headers = false;
+      read_body = false;
     }
     else if(it->name == "header")
     {
@@ -202,9 +477,348 @@ Application::test(const ArgList& arguments)
     {
       print_headers = it->value == "1";
     }
+    else if(it->name == "read-body")
+    {
+      read_body = it->value == "1";
+    }
+    
+  }
+
+  return 0;
+}
+
+int
+Application::bench(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  size_t size = 32 * 1024 * 1024;
+  size_t runs = 3;
+  
+  for(ArgList::const_iterator it = arguments.begin(); it != arguments.end();
+      it++)
+  {
+    if(it->name == "size")
+    {
+      size = atol(it->value.c_str());
+    }
+    else if(it->name == "runs")
+    {
+      runs = atol(it->value.c_str());
+    }
+    else
+    {
+      std::ostringstream ostr;
+      ostr << "Application::bench: unexpected argument " << it->name;
+      throw InvalidArg(ostr.str());
+    }
+  }
+
+  unsigned short port = 0;
+  int sock = listen_local(port);
+  
+  //
+  // First pass checks decoding of small bodies delivered by tiny
+  // pieces to exercise chunk framing and gzip header split across
+  // socket reads, second one measures throughput
+  //
+  size_t sizes[] = { 100 * 1024, size };
+  size_t max_writes[] = { 7, 1024 * 1024 };
+
+  for(size_t pass = 0; pass < 2; ++pass)
+  {
+    std::string body = make_body(sizes[pass]);
+
+    std::cout << (pass ? "benchmarking " : "checking ") << body.size()
+              << " bytes body" << std::endl;
     
+    for(size_t i = 0; i < sizeof(CASES) / sizeof(CASES[0]); ++i)
+    {
+      Server server;
+      server.socket = sock;
+      server.response = make_response(body, CASES[i]);
+      server.max_write = max_writes[pass];
+      server.seed = i;
+
+      ACE_Time_Value best[2];
+      
+      for(size_t run = 0; run < (pass ? runs : 1) * 2; ++run)
+      {
+        pthread_t thread;
+      
+        if(pthread_create(&thread, 0, Server::run, &server))
+        {
+          close(sock);
+          throw Exception("Application::bench: pthread_create failed");
+        }
+
+        bool read_body = run % 2;
+        ACE_Time_Value read_time;
+        std::string result;
+        std::string error;
+        
+        try
+        {
+          result = receive(port, read_body, read_time);
+        }
+        catch(const El::Exception& e)
+        {
+          error = e.what();
+        }
+
+        pthread_join(thread, 0);
+
+        if(error.empty())
+        {
+          error = server.error;
+        }
+        
+        if(error.empty() && result != body)
+        {
+          error = "body differs from one sent";
+        }
+
+        if(!error.empty())
+        {
+          close(sock);
+          
+          std::ostringstream ostr;
+          ostr << "Application::bench: " << CASES[i].name
+               << (read_body ? ", read_body: " : ", stream: ") << error;
+          
+          throw Exception(ostr.str());
+        }
+
+        if(run < 2 || read_time < best[read_body])
+        {
+          best[read_body] = read_time;
+        }
+      }
+
+      if(pass)
+      {
+        std::cout << "  " << CASES[i].name << ":";
+
+        for(size_t j = 0; j < 2; ++j)
+        {
+          double sec = best[j].sec() + (double)best[j].usec() / 1000000;
+          
+          std::cout << (j ? ", read_body " : " stream ")
+                    << (sec > 0 ? body.size() / sec / 1024 / 1024 : 0)
+                    << " MB/s";
+        }
+
+        std::cout << std::endl;
+      }
+    }
+  }
+
+  close(sock);
+  return 0;
+}
+
+int
+Application::redirect(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  unsigned short port = 0;
+  int sock = listen_local(port);
+
+  unsigned short target_port = 0;
+  int target_sock = -1;
+
+  try
+  {
+    target_sock = listen_local(target_port);
+  }
+  catch(...)
+  {
+    close(sock);
+    throw;
+  }
+
+  std::string body = make_body(1024);
+
+  //
+  // Headers following Location describe redirect response body which is
+  // not read, so should not fail the request even if not supported
+  //
+  std::ostringstream ostr;
+  ostr << "HTTP/1.1 302 Found\r\nLocation: http://127.0.0.1:" << target_port
+       << "/\r\nContent-Encoding: br\r\nTransfer-Encoding: compress\r\n\r\n";
+
+  Server servers[2];
+
+  servers[0].socket = sock;
+  servers[0].response = ostr.str();
+
+  servers[1].socket = target_sock;
+  servers[1].response = make_response(body, CASES[0]);
+
+  pthread_t threads[2];
+  size_t started = 0;
+
+  for(; started < 2; ++started)
+  {
+    servers[started].max_write = 7;
+    servers[started].seed = started;
+
+    if(pthread_create(&threads[started], 0, Server::run, &servers[started]))
+    {
+      break;
+    }
+  }
+
+  std::string result;
+  std::string error;
+
+  if(started < 2)
+  {
+    error = "pthread_create failed";
+  }
+  else
+  {
+    try
+    {
+      std::ostringstream url;
+      url << "http://127.0.0.1:" << port << "/";
+
+      El::Net::HTTP::Session session(url.str().c_str());
+
+      ACE_Time_Value timeout(20);
+      session.open(&timeout, &timeout, &timeout);
+
+      session.send_request(El::Net::HTTP::GET,
+                           El::Net::HTTP::ParamList(),
+                           El::Net::HTTP::HeaderList(),
+                           0,
+                           0,
+                           1);
+
+      if(!session.recv_response_status() ||
+         session.status_code() != El::Net::HTTP::SC_OK)
+      {
+        std::ostringstream ostr;
+        ostr << "unexpected status " << session.status_code();
+        error = ostr.str();
+      }
+      else
+      {
+        El::Net::HTTP::Header header;
+        while(session.recv_response_header(header));
+
+        std::istream& body_stream = session.response_body();
+        char buff[1024];
+
+        do
+        {
+          body_stream.read(buff, sizeof(buff));
+          result.append(buff, body_stream.gcount());
+        }
+        while(body_stream.gcount());
+      }
+    }
+    catch(const El::Exception& e)
+    {
+      error = e.what();
+    }
+  }
+
+  if(!error.empty())
+  {
+    // Unblocks servers still waiting for connection
+    shutdown(sock, SHUT_RDWR);
+    shutdown(target_sock, SHUT_RDWR);
+  }
+
+  for(size_t i = 0; i < started; ++i)
+  {
+    pthread_join(threads[i], 0);
+
+    if(error.empty())
+    {
+      error = servers[i].error;
+    }
+  }
+
+  close(sock);
+  close(target_sock);
+
+  if(error.empty() && result != body)
+  {
+    error = "body differs from one sent";
+  }
+
+  if(!error.empty())
+  {
+    throw Exception(std::string("Application::redirect: ") + error);
   }
 
   return 0;
 }
 
+std::string
+Application::receive(unsigned short port,
+                     bool read_body,
+                     ACE_Time_Value& read_time)
+  throw(Exception, El::Exception)
+{
+  std::ostringstream ostr;
+  ostr << "http://127.0.0.1:" << port << "/";
+
+  El::Net::HTTP::Session session(ostr.str().c_str());
+      
+  ACE_Time_Value timeout(20);
+  session.open(&timeout, &timeout, &timeout, 1024, 16 * 1024, 1024);
+  
+  session.send_request(El::Net::HTTP::GET);
+  
+  if(!session.recv_response_status())
+  {
+    throw Exception("Application::receive: unexpected status");
+  }
+
+  El::Net::HTTP::Header header;
+  bool chunked = false;
+  
+  while(session.recv_response_header(header))
+  {
+    chunked |= strcasecmp(header.name.c_str(), "Transfer-Encoding") == 0;
+  }
+
+  std::string body;
+  ACE_Time_Value start = ACE_OS::gettimeofday();
+  
+  if(read_body)
+  {
+    const char* data = 0;
+    size_t size = 0;
+        
+    while(session.read_body(data, size))
+    {
+      body.append(data, size);
+    }
+  }
+  else
+  {
+    std::istream& body_stream = session.response_body();
+    char buff[16 * 1024];
+
+    do
+    {
+      body_stream.read(buff, sizeof(buff));
+      body.append(buff, body_stream.gcount());
+    }
+    while(body_stream.gcount());
+  }
+
+  session.test_completion();
+  read_time = ACE_OS::gettimeofday() - start;
+
+  if(chunked && session.trailer().find("X-Checksum") == 0)
+  {
+    throw Exception("Application::receive: trailer not received");
+  }
+  
+  return body;
+}
+
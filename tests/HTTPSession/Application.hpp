@@ -17,6 +17,8 @@
 #include <string>
 #include <list>
 
+#include <ace/OS.h>
+
 #include <El/Exception.hpp>
 
 class Application
@@ -50,6 +52,25 @@ private:
 
   int test(const ArgList& arguments)
     throw(InvalidArg, Exception, El::Exception);
+
+  int bench(const ArgList& arguments)
+    throw(InvalidArg, Exception, El::Exception);
+
+  //
+  // Follows redirect of local server which response has headers
+  // unsupported for body after Location one
+  //
+  int redirect(const ArgList& arguments)
+    throw(InvalidArg, Exception, El::Exception);
+
+  //
+  // Receives response to GET request from local server reading body
+  // from response_body() stream or with read_body
+  //
+  static std::string receive(unsigned short port,
+                             bool read_body,
+                             ACE_Time_Value& read_time)
+    throw(Exception, El::Exception);
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,390 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file   HTTPUserAgentMain.cpp
+ * @author Karen Arutyunov
+ * $Id:$
+ */
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+
+#include <ace/OS.h>
+
+#include <El/Exception.hpp>
+#include <El/Net/HTTP/UserAgent.hpp>
+#include <El/Net/HTTP/Utility.hpp>
+
+namespace
+{
+  const char USAGE[] =
+    "Usage: ElTestHTTPUserAgent <user agents file> "
+    "--iterations=<iteration count>? --verbose?";
+
+  struct Expectation
+  {
+    const char* user_agent;
+    const char* browser;
+    const char* feed_reader;
+    const char* crawler;
+    const char* os;
+    const char* computer;
+    const char* tab;
+    const char* phone;
+  };
+
+  const Expectation EXPECTATIONS[] =
+  {
+    { "Mozilla/5.0 (Windows NT 6.1; WOW64; rv:45.0) Gecko/20100101 "
+      "Firefox/45.0",
+      "firefox", "", "", "windows", "generic", "", "" },
+    { "Mozilla/5.0 (iPad; CPU OS 9_2_1 like Mac OS X) AppleWebKit/601.1.46 "
+      "(KHTML, like Gecko) Version/9.0 Mobile/13D15 Safari/601.1",
+      "safari", "", "", "", "", "apple", "" },
+    { "Mozilla/5.0 (iPhone; CPU iPhone OS 9_2_1 like Mac OS X) "
+      "AppleWebKit/601.1.46 (KHTML, like Gecko) Version/9.0 Mobile/13D15 "
+      "Safari/601.1",
+      "safari", "", "", "", "", "", "apple" },
+    { "Mozilla/5.0 (Linux; U; Android 3.2.1; ru-ru; HTC Flyer P510e "
+      "Build/HTK75C) AppleWebKit/534.13 (KHTML, like Gecko) Version/4.0 "
+      "Safari/534.13",
+      "safari", "", "", "linux", "", "htc", "" },
+    { "Mozilla/5.0 (compatible; MSIE 10.0; Windows Phone 8.0; Trident/6.0; "
+      "IEMobile/10.0; ARM; Touch; NOKIA; Lumia 920)",
+      "msie", "", "", "windows", "", "", "nokia" },
+    { "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like "
+      "Gecko; Google Web Preview) Chrome/27.0.1453 Safari/537.36",
+      "chrome", "", "googlewebpreview", "linux", "generic", "", "" },
+    { "Mozilla/5.0 (compatible; bingbot/2.0; "
+      "+http://www.bing.com/bingbot.htm)",
+      "", "", "msnbot", "", "", "", "" },
+    { "Tiny Tiny RSS/16.3 (4e6c8a6) (http://tt-rss.org/)",
+      "", "tinytinyrss", "", "", "", "", "" },
+    { "CURL/7.35.0",
+      "curl", "", "curl-app", "", "generic", "", "" },
+    { "Mozilla/4.0 (compatible;)",
+      "msie", "", "", "", "", "", "" },
+    { "",
+      "", "", "unknown-app", "", "", "", "" },
+  };
+
+  double
+  seconds(const ACE_Time_Value& tm) throw()
+  {
+    return tm.sec() + (double)tm.usec() / 1000000;
+  }
+
+  bool
+  operator==(const El::Net::HTTP::UserAgentInfo& a,
+             const El::Net::HTTP::UserAgentInfo& b) throw()
+  {
+    return strcmp(a.browser, b.browser) == 0 &&
+      strcmp(a.feed_reader, b.feed_reader) == 0 &&
+      strcmp(a.crawler, b.crawler) == 0 &&
+      strcmp(a.os, b.os) == 0 &&
+      strcmp(a.computer, b.computer) == 0 &&
+      strcmp(a.tab, b.tab) == 0 &&
+      strcmp(a.phone, b.phone) == 0;
+  }
+
+  std::ostream&
+  operator<<(std::ostream& ostr, const El::Net::HTTP::UserAgentInfo& info)
+    throw(El::Exception)
+  {
+    ostr << "browser=" << info.browser
+         << " feed_reader=" << info.feed_reader
+         << " crawler=" << info.crawler
+         << " os=" << info.os
+         << " computer=" << info.computer
+         << " tab=" << info.tab
+         << " phone=" << info.phone;
+
+    return ostr;
+  }
+}
+
+class Application
+{
+public:
+  EL_EXCEPTION(Exception, El::ExceptionBase);
+
+public:
+  Application() throw() {}
+  virtual ~Application() throw() {}
+
+  int run(int& argc, char** argv) throw();
+
+private:
+  typedef std::vector<std::string> StringArray;
+
+  void check_expectations() throw(Exception, El::Exception);
+
+  void check_corpus(const StringArray& user_agents, bool verbose)
+    throw(Exception, El::Exception);
+
+  void bench(const StringArray& user_agents, size_t iterations)
+    throw(El::Exception);
+};
+
+int
+main(int argc, char** argv)
+{
+  Application app;
+  return app.run(argc, argv);
+}
+
+int
+Application::run(int& argc, char** argv) throw()
+{
+  try
+  {
+    std::string file;
+    size_t iterations = 1000;
+    bool verbose = false;
+
+    for(int i = 1; i < argc; i++)
+    {
+      const char* arg = argv[i];
+
+      if(!strncmp(arg, "--iterations=", 13))
+      {
+        iterations = atol(arg + 13);
+      }
+      else if(!strcmp(arg, "--verbose"))
+      {
+        verbose = true;
+      }
+      else if(*arg != '-' && file.empty())
+      {
+        file = arg;
+      }
+      else
+      {
+        std::ostringstream ostr;
+        ostr << "Unexpected argument '" << arg << "'\n" << USAGE;
+        throw Exception(ostr.str());
+      }
+    }
+
+    if(file.empty())
+    {
+      std::ostringstream ostr;
+      ostr << "User agents file not specified\n" << USAGE;
+      throw Exception(ostr.str());
+    }
+
+    std::fstream istr(file.c_str(), std::ios::in);
+
+    if(!istr.is_open())
+    {
+      std::ostringstream ostr;
+      ostr << "Can't open '" << file << "'";
+      throw Exception(ostr.str());
+    }
+
+    StringArray user_agents;
+    std::string line;
+
+    while(std::getline(istr, line))
+    {
+      if(!line.empty())
+      {
+        user_agents.push_back(line);
+      }
+    }
+
+    check_expectations();
+    check_corpus(user_agents, verbose);
+
+    if(iterations)
+    {
+      bench(user_agents, iterations);
+    }
+
+    return 0;
+  }
+  catch(const El::Exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+  }
+  catch(...)
+  {
+    std::cerr << "unknown exception caught.\n";
+  }
+
+  return -1;
+}
+
+void
+Application::check_expectations() throw(Exception, El::Exception)
+{
+  for(size_t i = 0; i < sizeof(EXPECTATIONS) / sizeof(EXPECTATIONS[0]); ++i)
+  {
+    const Expectation& exp = EXPECTATIONS[i];
+
+    El::Net::HTTP::UserAgentInfo expected;
+    expected.browser = exp.browser;
+    expected.feed_reader = exp.feed_reader;
+    expected.crawler = exp.crawler;
+    expected.os = exp.os;
+    expected.computer = exp.computer;
+    expected.tab = exp.tab;
+    expected.phone = exp.phone;
+
+    El::Net::HTTP::UserAgentInfo info =
+      El::Net::HTTP::user_agent_info(exp.user_agent);
+
+    if(!(info == expected))
+    {
+      std::ostringstream ostr;
+      ostr << "Application::check_expectations: for '" << exp.user_agent
+           << "'\n  expected: " << expected << "\n  got: " << info;
+
+      throw Exception(ostr.str());
+    }
+  }
+
+  El::Net::HTTP::UserAgentInfo info = El::Net::HTTP::user_agent_info(0);
+
+  if(!(info == El::Net::HTTP::UserAgentInfo()))
+  {
+    throw Exception("Application::check_expectations: null user agent "
+                    "classified");
+  }
+}
+
+void
+Application::check_corpus(const StringArray& user_agents, bool verbose)
+  throw(Exception, El::Exception)
+{
+  El::Net::HTTP::UserAgentClassifier classifier(16);
+
+  for(size_t pass = 0; pass < 2; ++pass)
+  {
+    for(StringArray::const_iterator i(user_agents.begin()),
+          e(user_agents.end()); i != e; ++i)
+    {
+      const char* ua = i->c_str();
+
+      El::Net::HTTP::UserAgentInfo scanned;
+      classifier.classify(ua, scanned);
+
+      El::Net::HTTP::UserAgentInfo memoized;
+      classifier.lookup(ua, memoized);
+
+      El::Net::HTTP::UserAgentInfo separate;
+      separate.browser = El::Net::HTTP::browser(ua);
+      separate.feed_reader = El::Net::HTTP::feed_reader(ua);
+      separate.crawler = El::Net::HTTP::crawler(ua);
+      separate.os = El::Net::HTTP::os(ua);
+      separate.computer = El::Net::HTTP::computer(ua);
+      separate.tab = El::Net::HTTP::tab(ua);
+      separate.phone = El::Net::HTTP::phone(ua);
+
+      if(!(scanned == memoized) || !(scanned == separate))
+      {
+        std::ostringstream ostr;
+        ostr << "Application::check_corpus: inconsistent results for '"
+             << ua << "'\n  classify: " << scanned << "\n  lookup: "
+             << memoized << "\n  functions: " << separate;
+
+        throw Exception(ostr.str());
+      }
+
+      if(verbose && pass == 0)
+      {
+        std::cout << ua << "\n  " << scanned << std::endl;
+      }
+    }
+  }
+
+  std::cout << user_agents.size() << " user agents, "
+            << classifier.patterns() << " patterns, "
+            << classifier.states() << " automaton states" << std::endl;
+}
+
+void
+Application::bench(const StringArray& user_agents, size_t iterations)
+  throw(El::Exception)
+{
+  // Memo fitting whole corpus, so lookups after first pass are hits
+  El::Net::HTTP::UserAgentClassifier classifier(user_agents.size());
+
+  size_t bytes = 0;
+
+  for(StringArray::const_iterator i(user_agents.begin()),
+        e(user_agents.end()); i != e; ++i)
+  {
+    bytes += i->size();
+  }
+
+  double count = (double)user_agents.size() * iterations;
+  size_t found = 0;
+
+  const char* names[] =
+  {
+    "scan",
+    "memoized lookup",
+    "7 functions per user agent"
+  };
+
+  for(size_t mode = 0; mode < sizeof(names) / sizeof(names[0]); ++mode)
+  {
+    ACE_Time_Value start = ACE_OS::gettimeofday();
+
+    for(size_t n = 0; n < iterations; ++n)
+    {
+      for(StringArray::const_iterator i(user_agents.begin()),
+            e(user_agents.end()); i != e; ++i)
+      {
+        const char* ua = i->c_str();
+        El::Net::HTTP::UserAgentInfo info;
+
+        switch(mode)
+        {
+        case 0:
+          {
+            classifier.classify(ua, info);
+            break;
+          }
+        case 1:
+          {
+            classifier.lookup(ua, info);
+            break;
+          }
+        default:
+          {
+            info.browser = El::Net::HTTP::browser(ua);
+            info.feed_reader = El::Net::HTTP::feed_reader(ua);
+            info.crawler = El::Net::HTTP::crawler(ua);
+            info.os = El::Net::HTTP::os(ua);
+            info.computer = El::Net::HTTP::computer(ua);
+            info.tab = El::Net::HTTP::tab(ua);
+            info.phone = El::Net::HTTP::phone(ua);
+            break;
+          }
+        }
+
+        found += *info.crawler != '\0';
+      }
+    }
+
+    double time = seconds(ACE_OS::gettimeofday() - start);
+
+    std::cout << names[mode] << ": " << time * 1000000000 / count
+              << " ns/user agent, " << bytes * iterations / time / 1048576
+              << " MB/s" << std::endl;
+  }
+
+  std::cout << "crawlers: " << found / 3 / iterations << std::endl;
+}
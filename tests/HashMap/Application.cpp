@@ -0,0 +1,559 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file   Elements/test/HashMap/Application.cpp
+ * @author Karen Arutyunov
+ * $Id:$
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include <ext/hash_map>
+
+#include <ace/OS.h>
+
+#include <El/Hash/Hash.hpp>
+#include <El/Hash/FlatMap.hpp>
+#include <El/Hash/FlatSet.hpp>
+
+#include "Application.hpp"
+
+namespace
+{
+  const char USAGE[] = "\nUsage:\nElTestHashMap <command> <args>\n"
+  "Synopsis 1: ElTestHashMap help\n"
+  "Synopsis 2: ElTestHashMap run\n"
+  "Synopsis 3: ElTestHashMap bench [count=<elements>]\n";
+
+  const size_t TEST_OPERATIONS = 1000000;
+  const size_t TEST_KEY_RANGE = 5000;
+  const size_t TEST_STRINGS = 10000;
+
+  const size_t BENCH_COUNT = 1000000;
+
+  typedef El::Hash::FlatMap<uint64_t, size_t, El::Hash::Numeric<uint64_t> >
+  FlatNumericMap;
+
+  typedef __gnu_cxx::hash_map<uint64_t,
+                              size_t,
+                              El::Hash::Numeric<uint64_t> >
+  NodeNumericMap;
+
+  typedef El::Hash::FlatMap<std::string, size_t, El::Hash::String>
+  FlatStringMap;
+
+  typedef __gnu_cxx::hash_map<std::string, size_t, El::Hash::String>
+  NodeStringMap;
+
+  typedef std::vector<uint64_t> NumericArray;
+  typedef std::vector<std::string> StringArray;
+
+  struct BenchResult
+  {
+    ACE_Time_Value insert;
+    ACE_Time_Value find;
+    ACE_Time_Value miss;
+    ACE_Time_Value erase;
+    size_t memory;
+  };
+
+  //
+  // Node based map: bucket array plus a node with next pointer per element;
+  // allocator overhead per node is not counted
+  //
+  template<typename MAP>
+  size_t
+  memory_usage(const MAP& map) throw()
+  {
+    return map.bucket_count() * sizeof(void*) +
+      map.size() * (sizeof(typename MAP::value_type) + sizeof(void*));
+  }
+
+  template<typename VALUE, typename KEY, typename KEY_OF, typename HASH,
+           typename EQUAL>
+  size_t
+  memory_usage(const El::Hash::FlatTable<VALUE, KEY, KEY_OF, HASH, EQUAL>&
+               map) throw()
+  {
+    return map.memory_size();
+  }
+
+  inline
+  const char*
+  lookup_key(const std::string& key) throw()
+  {
+    // Lookups come as const char* from request/config parsing code
+    return key.c_str();
+  }
+
+  inline
+  uint64_t
+  lookup_key(uint64_t key) throw()
+  {
+    return key;
+  }
+
+  template<typename MAP, typename ARRAY>
+  void
+  bench_map(const ARRAY& keys,
+            const ARRAY& lookup,
+            const ARRAY& missing,
+            BenchResult& result)
+    throw(Application::Exception, El::Exception)
+  {
+    MAP map;
+    size_t found = 0;
+
+    ACE_Time_Value start = ACE_OS::gettimeofday();
+
+    for(size_t i = 0; i < keys.size(); ++i)
+    {
+      map.insert(typename MAP::value_type(keys[i], i));
+    }
+
+    result.insert = ACE_OS::gettimeofday() - start;
+    result.memory = memory_usage(map);
+
+    start = ACE_OS::gettimeofday();
+
+    for(size_t i = 0; i < lookup.size(); ++i)
+    {
+      found += map.find(lookup_key(lookup[i])) != map.end();
+    }
+
+    result.find = ACE_OS::gettimeofday() - start;
+    start = ACE_OS::gettimeofday();
+
+    for(size_t i = 0; i < missing.size(); ++i)
+    {
+      found += map.find(lookup_key(missing[i])) != map.end();
+    }
+
+    result.miss = ACE_OS::gettimeofday() - start;
+    start = ACE_OS::gettimeofday();
+
+    for(size_t i = 0; i < lookup.size(); ++i)
+    {
+      found += map.erase(lookup_key(lookup[i]));
+    }
+
+    result.erase = ACE_OS::gettimeofday() - start;
+
+    if(found != keys.size() * 2 || !map.empty())
+    {
+      std::ostringstream ostr;
+      ostr << "bench_map: unexpected lookup result " << found << " for "
+           << keys.size() << " keys";
+
+      throw Application::Exception(ostr.str());
+    }
+  }
+
+  double
+  mops(size_t count, const ACE_Time_Value& time) throw()
+  {
+    double sec = time.sec() + (double)time.usec() / 1000000;
+    return sec > 0 ? (double)count / sec / 1000000 : 0;
+  }
+
+  void
+  print_result(const char* name, size_t count, const BenchResult& result)
+    throw(El::Exception)
+  {
+    std::cout << "  " << name << ": insert "
+              << mops(count, result.insert) << " M/s, find "
+              << mops(count, result.find) << " M/s, miss "
+              << mops(count, result.miss) << " M/s, erase "
+              << mops(count, result.erase) << " M/s, "
+              << (double)result.memory / count << " bytes/entry\n";
+  }
+}
+
+int
+main(int argc, char** argv)
+{
+  srand(time(0));
+
+  try
+  {
+    Application app;
+    return app.run(argc, argv);
+  }
+  catch(const Application::InvalidArg& e)
+  {
+    std::cerr << "Invalid argument: " << e
+              << "\nRun 'ElTestHashMap help' for usage details\n";
+  }
+  catch(const El::Exception& e)
+  {
+    std::cerr << "ElTestHashMap: El::Exception caught. "
+      "Description:" << std::endl << e << std::endl;
+  }
+  catch(...)
+  {
+    std::cerr << "ElTestHashMap: unknown exception caught\n";
+  }
+
+  return -1;
+}
+
+Application::Application() throw(Application::Exception, El::Exception)
+{
+}
+
+Application::~Application() throw()
+{
+}
+
+int
+Application::run(int& argc, char** argv)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  std::string command;
+
+  int i = 1;
+
+  if(argc > 1)
+  {
+    command = argv[i++];
+  }
+
+  ArgList arguments;
+
+  for(; i < argc; i++)
+  {
+    char* argument = argv[i];
+
+    Argument arg;
+    const char* eq = strstr(argument, "=");
+
+    if(eq == 0)
+    {
+      arg.name = argument;
+    }
+    else
+    {
+      arg.name.assign(argument, eq - argument);
+      arg.value = eq + 1;
+    }
+
+    arguments.push_back(arg);
+  }
+
+  if(command == "help")
+  {
+    return help(arguments);
+  }
+  else if(command == "bench")
+  {
+    return bench(arguments);
+  }
+
+  return test(arguments);
+}
+
+int
+Application::help(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  std::cerr << USAGE;
+  return 0;
+}
+
+int
+Application::test(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  test_numeric();
+  test_string();
+
+  return 0;
+}
+
+void
+Application::test_numeric() throw(Exception, El::Exception)
+{
+  std::cerr << "* Testing numeric keys against std::map ...\n";
+
+  typedef std::map<uint64_t, size_t> ReferenceMap;
+
+  FlatNumericMap map;
+  ReferenceMap reference;
+
+  for(size_t i = 0; i < TEST_OPERATIONS; ++i)
+  {
+    uint64_t key = rand() % TEST_KEY_RANGE;
+
+    switch(rand() % 3)
+    {
+    case 0:
+      {
+        map[key] = i;
+        reference[key] = i;
+        break;
+      }
+    case 1:
+      {
+        if(map.erase(key) != reference.erase(key))
+        {
+          std::ostringstream ostr;
+          ostr << "Application::test_numeric: erase result mismatch for "
+               << key;
+
+          throw Exception(ostr.str());
+        }
+
+        break;
+      }
+    default:
+      {
+        FlatNumericMap::const_iterator it = map.find(key);
+        ReferenceMap::const_iterator rit = reference.find(key);
+
+        if((it == map.end()) != (rit == reference.end()) ||
+           (it != map.end() && it->second != rit->second))
+        {
+          std::ostringstream ostr;
+          ostr << "Application::test_numeric: find result mismatch for "
+               << key;
+
+          throw Exception(ostr.str());
+        }
+
+        break;
+      }
+    }
+  }
+
+  size_t count = 0;
+
+  for(FlatNumericMap::const_iterator it = map.begin(); it != map.end(); ++it)
+  {
+    ReferenceMap::const_iterator rit = reference.find(it->first);
+
+    if(rit == reference.end() || rit->second != it->second)
+    {
+      std::ostringstream ostr;
+      ostr << "Application::test_numeric: unexpected element " << it->first;
+      throw Exception(ostr.str());
+    }
+
+    ++count;
+  }
+
+  if(count != reference.size() || map.size() != reference.size())
+  {
+    std::ostringstream ostr;
+    ostr << "Application::test_numeric: " << count << " elements iterated, "
+         << map.size() << " reported, " << reference.size() << " expected";
+
+    throw Exception(ostr.str());
+  }
+
+  //
+  // Erasing while iterating is allowed for all but erased element
+  //
+  for(FlatNumericMap::iterator it = map.begin(); it != map.end(); )
+  {
+    if(it->first % 2)
+    {
+      map.erase(it++);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+
+  for(ReferenceMap::iterator it = reference.begin(); it != reference.end(); )
+  {
+    if(it->first % 2)
+    {
+      reference.erase(it++);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+
+  if(map.size() != reference.size())
+  {
+    std::ostringstream ostr;
+    ostr << "Application::test_numeric: " << map.size()
+         << " elements left after erasure while " << reference.size()
+         << " expected";
+
+    throw Exception(ostr.str());
+  }
+}
+
+void
+Application::test_string() throw(Exception, El::Exception)
+{
+  std::cerr << "* Testing string keys and heterogeneous lookup ...\n";
+
+  FlatStringMap map;
+
+  for(size_t i = 0; i < TEST_STRINGS; ++i)
+  {
+    std::ostringstream ostr;
+    ostr << "key-" << i;
+
+    if(!map.insert(std::make_pair(ostr.str(), i)).second)
+    {
+      throw Exception("Application::test_string: unexpected duplicate");
+    }
+  }
+
+  FlatStringMap copy;
+  copy = map;
+
+  for(size_t i = 0; i < TEST_STRINGS; ++i)
+  {
+    char key[32];
+    sprintf(key, "key-%lu", (unsigned long)i);
+
+    FlatStringMap::const_iterator it = copy.find(key);
+
+    if(it == copy.end() || it->second != i || map.count(key) != 1)
+    {
+      std::ostringstream ostr;
+      ostr << "Application::test_string: can't find " << key;
+      throw Exception(ostr.str());
+    }
+  }
+
+  if(map.find("key-") != map.end() || map.erase("none") != 0)
+  {
+    throw Exception("Application::test_string: unexpected element found");
+  }
+
+  El::Hash::FlatSet<std::string, El::Hash::String> set;
+
+  set.insert("alpha");
+  set.insert("beta");
+
+  if(set.insert(std::string("alpha")).second || set.size() != 2 ||
+     set.find("beta") == set.end() || set.find("gamma") != set.end())
+  {
+    throw Exception("Application::test_string: set lookup failed");
+  }
+
+  set.erase(set.find("alpha"));
+
+  if(set.size() != 1 || set.count("alpha"))
+  {
+    throw Exception("Application::test_string: set erasure failed");
+  }
+}
+
+int
+Application::bench(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  size_t count = BENCH_COUNT;
+
+  for(ArgList::const_iterator it = arguments.begin(); it != arguments.end();
+      it++)
+  {
+    if(it->name == "count")
+    {
+      count = atol(it->value.c_str());
+    }
+    else
+    {
+      std::ostringstream ostr;
+      ostr << "Application::bench: unexpected argument " << it->name;
+      throw InvalidArg(ostr.str());
+    }
+  }
+
+  if(count == 0)
+  {
+    throw InvalidArg("Application::bench: count should be positive");
+  }
+
+  NumericArray numeric_keys;
+  NumericArray numeric_missing;
+  StringArray string_keys;
+  StringArray string_missing;
+
+  numeric_keys.reserve(count);
+  numeric_missing.reserve(count);
+  string_keys.reserve(count);
+  string_missing.reserve(count);
+
+  for(size_t i = 0; i < count; ++i)
+  {
+    // Sparse keys like hashes the request cache is keyed with
+    uint64_t key = ((uint64_t)i * 0x9E3779B97F4A7C15ULL) | 1;
+
+    numeric_keys.push_back(key);
+    numeric_missing.push_back(key + 1);
+
+    std::ostringstream ostr;
+    ostr << "/path/to/some/resource-" << key;
+
+    string_keys.push_back(ostr.str());
+    string_missing.push_back(ostr.str() + ".missing");
+  }
+
+  //
+  // Looking up in an order different from insertion one, otherwise node
+  // based containers get their nodes sequentially allocated and prefetched
+  //
+  NumericArray numeric_lookup(numeric_keys);
+  StringArray string_lookup(string_keys);
+
+  std::random_shuffle(numeric_lookup.begin(), numeric_lookup.end());
+  std::random_shuffle(string_lookup.begin(), string_lookup.end());
+
+  std::cout << "benchmarking " << count << " elements\n";
+
+  BenchResult result;
+
+  std::cout << "uint64_t keys:\n";
+
+  bench_map<NodeNumericMap>(numeric_keys,
+                            numeric_lookup,
+                            numeric_missing,
+                            result);
+  print_result("__gnu_cxx::hash_map", count, result);
+
+  bench_map<FlatNumericMap>(numeric_keys,
+                            numeric_lookup,
+                            numeric_missing,
+                            result);
+  print_result("El::Hash::FlatMap  ", count, result);
+
+  std::cout << "std::string keys looked up by const char*:\n";
+
+  bench_map<NodeStringMap>(string_keys,
+                           string_lookup,
+                           string_missing,
+                           result);
+  print_result("__gnu_cxx::hash_map", count, result);
+
+  bench_map<FlatStringMap>(string_keys,
+                           string_lookup,
+                           string_missing,
+                           result);
+  print_result("El::Hash::FlatMap  ", count, result);
+
+  return 0;
+}
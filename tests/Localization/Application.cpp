@@ -0,0 +1,578 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file   Elements/tests/Localization/Application.cpp
+ * @author Karen Arutyunov
+ * $Id:$
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <vector>
+
+#include <ace/OS.h>
+#include <ace/Synch.h>
+#include <ace/Guard_T.h>
+
+#include <El/Lang.hpp>
+#include <El/Country.hpp>
+#include <El/Localization/Loc.hpp>
+
+#include "Application.hpp"
+
+namespace
+{
+  const char USAGE[] = "\nUsage:\nElTestLocalization <command> <args>\n"
+  "Synopsis 1: ElTestLocalization help\n"
+  "Synopsis 2: ElTestLocalization run\n"
+  "Synopsis 3: ElTestLocalization bench [threads=<count>] "
+  "[count=<lookups per thread>]\n";
+
+  const size_t TEST_RELOADS = 50;
+  const size_t BENCH_THREADS = 8;
+  const size_t BENCH_COUNT = 1000000;
+
+  //
+  // Localization files; variant of set 1 differs to check readers see
+  // either complete snapshot during reload
+  //
+  const char* const FILES[][2] =
+  {
+    { "eng/countries.loc", "USA United States\nRUS Russia\n" },
+    { "eng/languages.loc", "eng English\nrus Russian\n" },
+    { "eng/words.loc", "year year years\nday day days\n" },
+    { "rus/countries.loc", "USA Soedinennye Shtaty\nRUS Rossiya\n" },
+    { "rus/languages.loc", "eng Angliyskiy\nrus Russkiy\n" },
+    { "rus/words.loc", "year god goda let\nday den dnya dney\n" }
+  };
+
+  const char* const SETS[] = { "1", "2" };
+
+  const char* const USA_ENG[] =
+  {
+    "United States",
+    "United States of America"
+  };
+
+  typedef ACE_RW_Thread_Mutex RWMutex;
+  typedef ACE_Read_Guard<RWMutex> ReadGuard;
+
+  //
+  // Lookups executed by a thread
+  //
+  struct Reader
+  {
+    bool locked;
+    size_t count;
+    volatile bool* stop;
+
+    RWMutex* lock;
+    std::string error;
+
+    Reader() throw() : locked(false), count(0), stop(0), lock(0) {}
+
+    void lookup(std::ostringstream& ostr,
+                const El::Country& country,
+                const El::Lang& lang) const
+      throw(El::Exception);
+
+    void check(std::ostringstream& ostr,
+               const El::Country& country,
+               const El::Lang& eng,
+               const El::Lang& rus) const
+      throw(Application::Exception, El::Exception);
+
+    static void* run(void* arg);
+  };
+
+  inline
+  void
+  Reader::lookup(std::ostringstream& ostr,
+                 const El::Country& country,
+                 const El::Lang& lang) const
+    throw(El::Exception)
+  {
+    El::Loc::Localizer& localizer = El::Loc::Localizer::instance();
+
+    ostr.str("");
+
+    if(locked)
+    {
+      // How every lookup was done before snapshots
+      ReadGuard guard(*lock);
+      localizer.country(country, lang, ostr);
+    }
+    else
+    {
+      localizer.country(country, lang, ostr);
+    }
+  }
+
+  void
+  Reader::check(std::ostringstream& ostr,
+                const El::Country& country,
+                const El::Lang& eng,
+                const El::Lang& rus) const
+    throw(Application::Exception, El::Exception)
+  {
+    El::Loc::Localizer& localizer = El::Loc::Localizer::instance();
+
+    lookup(ostr, country, eng);
+    std::string name = ostr.str();
+
+    if(name != USA_ENG[0] && name != USA_ENG[1])
+    {
+      std::ostringstream estr;
+      estr << "Reader::check: unexpected country name '" << name << "'";
+      throw Application::Exception(estr.str());
+    }
+
+    ostr.str("");
+    localizer.plural("year", 23, rus, ostr);
+
+    if(ostr.str() != "23 goda")
+    {
+      std::ostringstream estr;
+      estr << "Reader::check: unexpected plural form '" << ostr.str()
+           << "'";
+
+      throw Application::Exception(estr.str());
+    }
+  }
+
+  void*
+  Reader::run(void* arg)
+  {
+    Reader* reader = static_cast<Reader*>(arg);
+
+    try
+    {
+      El::Country country("USA");
+      El::Lang eng(El::Lang::EC_ENG);
+      El::Lang rus(El::Lang::EC_RUS);
+
+      std::ostringstream ostr;
+
+      if(reader->stop)
+      {
+        while(!*reader->stop)
+        {
+          reader->check(ostr, country, eng, rus);
+          ++reader->count;
+        }
+      }
+      else
+      {
+        for(size_t i = 0; i < reader->count; ++i)
+        {
+          reader->lookup(ostr, country, eng);
+        }
+      }
+    }
+    catch(const El::Exception& e)
+    {
+      reader->error = e.what();
+    }
+
+    return 0;
+  }
+
+  typedef std::vector<Reader> ReaderArray;
+
+  void
+  run_readers(ReaderArray& readers)
+    throw(Application::Exception, El::Exception)
+  {
+    std::vector<pthread_t> threads(readers.size());
+
+    for(size_t i = 0; i < readers.size(); ++i)
+    {
+      if(pthread_create(&threads[i], 0, Reader::run, &readers[i]))
+      {
+        throw Application::Exception(
+          "run_readers: pthread_create failed");
+      }
+    }
+
+    for(size_t i = 0; i < threads.size(); ++i)
+    {
+      pthread_join(threads[i], 0);
+    }
+  }
+
+  void
+  check_errors(const ReaderArray& readers)
+    throw(Application::Exception, El::Exception)
+  {
+    for(ReaderArray::const_iterator it(readers.begin());
+        it != readers.end(); ++it)
+    {
+      if(!it->error.empty())
+      {
+        throw Application::Exception(it->error);
+      }
+    }
+  }
+
+  double
+  mops(size_t count, const ACE_Time_Value& time) throw()
+  {
+    double sec = time.sec() + (double)time.usec() / 1000000;
+    return sec > 0 ? (double)count / sec / 1000000 : 0;
+  }
+}
+
+int
+main(int argc, char** argv)
+{
+  try
+  {
+    Application app;
+    return app.run(argc, argv);
+  }
+  catch(const Application::InvalidArg& e)
+  {
+    std::cerr << "Invalid argument: " << e
+              << "\nRun 'ElTestLocalization help' for usage details\n";
+  }
+  catch(const El::Exception& e)
+  {
+    std::cerr << "ElTestLocalization: El::Exception caught. "
+      "Description:" << std::endl << e << std::endl;
+  }
+  catch(...)
+  {
+    std::cerr << "ElTestLocalization: unknown exception caught\n";
+  }
+
+  return -1;
+}
+
+Application::Application() throw(Application::Exception, El::Exception)
+{
+}
+
+Application::~Application() throw()
+{
+  remove_files();
+}
+
+int
+Application::run(int& argc, char** argv)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  std::string command;
+
+  int i = 1;
+
+  if(argc > 1)
+  {
+    command = argv[i++];
+  }
+
+  ArgList arguments;
+
+  for(; i < argc; i++)
+  {
+    char* argument = argv[i];
+
+    Argument arg;
+    const char* eq = strstr(argument, "=");
+
+    if(eq == 0)
+    {
+      arg.name = argument;
+    }
+    else
+    {
+      arg.name.assign(argument, eq - argument);
+      arg.value = eq + 1;
+    }
+
+    arguments.push_back(arg);
+  }
+
+  if(command == "help")
+  {
+    return help(arguments);
+  }
+
+  create_files();
+
+  if(command == "bench")
+  {
+    return bench(arguments);
+  }
+
+  return test(arguments);
+}
+
+int
+Application::help(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  std::cerr << USAGE;
+  return 0;
+}
+
+void
+Application::create_files() throw(Exception, El::Exception)
+{
+  char dir[] = "/tmp/ElTestLocalization.XXXXXX";
+
+  if(mkdtemp(dir) == 0)
+  {
+    throw Exception("Application::create_files: mkdtemp failed");
+  }
+
+  dir_ = dir;
+
+  for(size_t s = 0; s < sizeof(SETS) / sizeof(SETS[0]); ++s)
+  {
+    std::string set_dir = dir_ + "/" + SETS[s];
+
+    mkdir(set_dir.c_str(), 0755);
+    mkdir((set_dir + "/eng").c_str(), 0755);
+    mkdir((set_dir + "/rus").c_str(), 0755);
+
+    for(size_t i = 0; i < sizeof(FILES) / sizeof(FILES[0]); ++i)
+    {
+      std::string path = set_dir + "/" + FILES[i][0];
+      std::fstream file(path.c_str(), std::ios::out);
+
+      if(!file.is_open())
+      {
+        std::ostringstream ostr;
+        ostr << "Application::create_files: failed to create " << path;
+        throw Exception(ostr.str());
+      }
+
+      std::string content = FILES[i][1];
+
+      if(s == 1 && i == 0)
+      {
+        content = std::string("USA ") + USA_ENG[1] + "\nRUS Russia\n";
+      }
+
+      file << content;
+    }
+  }
+}
+
+void
+Application::remove_files() throw()
+{
+  if(dir_.empty())
+  {
+    return;
+  }
+
+  for(size_t s = 0; s < sizeof(SETS) / sizeof(SETS[0]); ++s)
+  {
+    std::string set_dir = dir_ + "/" + SETS[s];
+
+    for(size_t i = 0; i < sizeof(FILES) / sizeof(FILES[0]); ++i)
+    {
+      unlink((set_dir + "/" + FILES[i][0]).c_str());
+    }
+
+    rmdir((set_dir + "/eng").c_str());
+    rmdir((set_dir + "/rus").c_str());
+    rmdir(set_dir.c_str());
+  }
+
+  rmdir(dir_.c_str());
+  dir_.clear();
+}
+
+int
+Application::test(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  test_lookups();
+  test_reload();
+
+  return 0;
+}
+
+void
+Application::test_lookups() throw(Exception, El::Exception)
+{
+  std::cerr << "* Testing lookups ...\n";
+
+  El::Loc::Localizer& localizer = El::Loc::Localizer::instance();
+  El::Lang eng(El::Lang::EC_ENG);
+  El::Lang rus(El::Lang::EC_RUS);
+
+  if(localizer.supported(eng))
+  {
+    throw Exception("Application::test_lookups: language supported "
+                    "before initialization");
+  }
+
+  localizer.init((dir_ + "/" + SETS[0]).c_str());
+
+  std::ostringstream ostr;
+  localizer.country(El::Country("RUS"), rus, ostr) << "|";
+  localizer.language(eng, eng, ostr) << "|";
+  localizer.plural("day", 1, eng, ostr) << "|";
+  localizer.plural("day", 12, rus, ostr);
+
+  if(ostr.str() != "Rossiya|English|1 day|12 dney")
+  {
+    std::ostringstream estr;
+    estr << "Application::test_lookups: unexpected lookup result '"
+         << ostr.str() << "'";
+
+    throw Exception(estr.str());
+  }
+
+  if(!localizer.supported(rus) ||
+     localizer.supported(El::Lang(El::Lang::EC_GER)))
+  {
+    throw Exception("Application::test_lookups: unexpected language "
+                    "support");
+  }
+
+  try
+  {
+    localizer.language(eng, El::Lang(El::Lang::EC_GER), ostr);
+
+    throw Exception("Application::test_lookups: lookup for unsupported "
+                    "language succeeded");
+  }
+  catch(const El::Loc::UnsupportedLanguage&)
+  {
+  }
+}
+
+void
+Application::test_reload() throw(Exception, El::Exception)
+{
+  std::cerr << "* Testing lookups during reload ...\n";
+
+  El::Loc::Localizer& localizer = El::Loc::Localizer::instance();
+
+  volatile bool stop = false;
+  ReaderArray readers(4);
+
+  for(ReaderArray::iterator it(readers.begin()); it != readers.end(); ++it)
+  {
+    it->stop = &stop;
+  }
+
+  std::vector<pthread_t> threads(readers.size());
+
+  for(size_t i = 0; i < readers.size(); ++i)
+  {
+    if(pthread_create(&threads[i], 0, Reader::run, &readers[i]))
+    {
+      throw Exception("Application::test_reload: pthread_create failed");
+    }
+  }
+
+  std::string error;
+
+  try
+  {
+    for(size_t i = 0; i < TEST_RELOADS; ++i)
+    {
+      localizer.init((dir_ + "/" + SETS[i % 2]).c_str());
+      usleep(1000);
+    }
+  }
+  catch(const El::Exception& e)
+  {
+    error = e.what();
+  }
+
+  stop = true;
+
+  for(size_t i = 0; i < threads.size(); ++i)
+  {
+    pthread_join(threads[i], 0);
+  }
+
+  if(!error.empty())
+  {
+    throw Exception(error);
+  }
+
+  check_errors(readers);
+}
+
+int
+Application::bench(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  size_t threads = BENCH_THREADS;
+  size_t count = BENCH_COUNT;
+
+  for(ArgList::const_iterator it = arguments.begin(); it != arguments.end();
+      ++it)
+  {
+    if(it->name == "threads")
+    {
+      threads = atol(it->value.c_str());
+    }
+    else if(it->name == "count")
+    {
+      count = atol(it->value.c_str());
+    }
+    else
+    {
+      std::ostringstream ostr;
+      ostr << "unexpected argument " << it->name;
+      throw InvalidArg(ostr.str());
+    }
+  }
+
+  if(threads == 0 || count == 0)
+  {
+    throw InvalidArg("threads and count should be positive");
+  }
+
+  El::Loc::Localizer::instance().init((dir_ + "/" + SETS[0]).c_str());
+
+  std::cout << "Country name lookups, " << threads << " threads, "
+            << count << " lookups each:\n";
+
+  RWMutex lock;
+
+  for(size_t mode = 0; mode < 2; ++mode)
+  {
+    ReaderArray readers(threads);
+
+    for(ReaderArray::iterator it(readers.begin()); it != readers.end();
+        ++it)
+    {
+      it->locked = mode == 0;
+      it->count = count;
+      it->lock = &lock;
+    }
+
+    ACE_Time_Value start = ACE_OS::gettimeofday();
+    run_readers(readers);
+    ACE_Time_Value time = ACE_OS::gettimeofday() - start;
+
+    check_errors(readers);
+
+    std::cout << "  " << (mode == 0 ? "read locked" : "snapshot") << ": "
+              << mops(count * threads, time) << " M/s\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,411 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file   MetricsMain.cpp
+ * @author Karen Arutyunov
+ * $Id:$
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iostream>
+
+#include <ace/OS.h>
+
+#include <El/Exception.hpp>
+#include <El/Stat.hpp>
+#include <El/Metrics.hpp>
+
+namespace
+{
+  const char USAGE[] =
+    "Usage: ElTestMetrics [--iterations=<iteration count>] "
+    "[--threads=<thread count>]";
+
+  EL_EXCEPTION(Exception, El::ExceptionBase);
+
+  El::Metrics::Histogram test_histogram("el_test_histogram",
+                                        "Test histogram",
+                                        1);
+
+  El::Metrics::Counter test_counter("el_test_total", "Test counter");
+  El::Metrics::Gauge test_gauge("el_test_gauge", "Test gauge");
+
+  El::Metrics::Histogram bound_histogram("el_test_bound",
+                                         "Values on bucket bounds",
+                                         1);
+
+  El::Metrics::Histogram bench_histogram("el_test_bench_seconds",
+                                         "Benchmark timings");
+
+  El::Stat::TimeMeter bench_meter("Benchmark timings");
+
+  struct Worker
+  {
+    unsigned long iterations;
+    unsigned long base;
+    bool meter;
+
+    static void* record(void* arg);
+    static void* bench(void* arg);
+  };
+
+  void*
+  Worker::record(void* arg)
+  {
+    Worker& worker = *static_cast<Worker*>(arg);
+
+    for(unsigned long i = 0; i < worker.iterations; ++i)
+    {
+      test_histogram.record(worker.base + i);
+      test_counter.increment();
+    }
+
+    return 0;
+  }
+
+  void*
+  Worker::bench(void* arg)
+  {
+    Worker& worker = *static_cast<Worker*>(arg);
+
+    if(worker.meter)
+    {
+      for(unsigned long i = 0; i < worker.iterations; ++i)
+      {
+        El::Stat::TimeMeasurement measurement(bench_meter);
+      }
+    }
+    else
+    {
+      for(unsigned long i = 0; i < worker.iterations; ++i)
+      {
+        El::Metrics::Timing timing(bench_histogram);
+      }
+    }
+
+    return 0;
+  }
+
+  void
+  run_workers(std::vector<Worker>& workers, void* (*func)(void*))
+    throw(Exception)
+  {
+    std::vector<pthread_t> threads(workers.size());
+
+    for(size_t i = 0; i < workers.size(); ++i)
+    {
+      if(pthread_create(&threads[i], 0, func, &workers[i]))
+      {
+        throw Exception("run_workers: pthread_create failed");
+      }
+    }
+
+    for(size_t i = 0; i < threads.size(); ++i)
+    {
+      pthread_join(threads[i], 0);
+    }
+  }
+
+  void
+  check_buckets() throw(Exception)
+  {
+    typedef El::Metrics::Histogram Histogram;
+
+    for(uint64_t value = 0; value < 100000; ++value)
+    {
+      size_t bucket = Histogram::bucket(value);
+
+      if(bucket >= Histogram::BUCKETS ||
+         Histogram::bucket_lowest(bucket) > value ||
+         Histogram::bucket_highest(bucket) < value)
+      {
+        std::ostringstream ostr;
+        ostr << "check_buckets: value " << value << " is out of bucket "
+             << bucket;
+
+        throw Exception(ostr.str());
+      }
+    }
+
+    for(size_t i = 1; i < Histogram::BUCKETS; ++i)
+    {
+      if(Histogram::bucket_lowest(i) != Histogram::bucket_highest(i - 1) + 1)
+      {
+        std::ostringstream ostr;
+        ostr << "check_buckets: bucket " << i
+             << " is not adjacent to previous one";
+
+        throw Exception(ostr.str());
+      }
+    }
+
+    if(Histogram::bucket(~(uint64_t)0) != Histogram::BUCKETS - 1 ||
+       Histogram::bucket_highest(Histogram::BUCKETS - 1) != ~(uint64_t)0)
+    {
+      throw Exception("check_buckets: unexpected last bucket");
+    }
+  }
+
+  void
+  check_metrics(unsigned long threads, unsigned long iterations)
+    throw(Exception, El::Exception)
+  {
+    std::vector<Worker> workers(threads);
+
+    for(size_t i = 0; i < workers.size(); ++i)
+    {
+      workers[i].iterations = iterations;
+      workers[i].base = i * iterations + 1;
+    }
+
+    run_workers(workers, Worker::record);
+
+    // Values recorded from this thread are summed with ones of exited
+    // threads
+    test_histogram.record(0);
+    test_counter.increment();
+
+    uint64_t count = threads * iterations + 1;
+
+    if(test_counter.value() != count)
+    {
+      std::ostringstream ostr;
+      ostr << "check_metrics: counter value " << test_counter.value()
+           << " instead of " << count;
+
+      throw Exception(ostr.str());
+    }
+
+    El::Metrics::Histogram::Snapshot snapshot;
+    test_histogram.snapshot(snapshot);
+
+    // Values recorded are 0, 1, ..., count - 1
+    uint64_t sum = count * (count - 1) / 2;
+
+    if(snapshot.count() != count || snapshot.sum() != sum)
+    {
+      std::ostringstream ostr;
+      ostr << "check_metrics: histogram count " << snapshot.count()
+           << ", sum " << snapshot.sum() << " instead of " << count
+           << ", " << sum;
+
+      throw Exception(ostr.str());
+    }
+
+    uint64_t median = snapshot.percentile(0.5);
+    uint64_t expected = count / 2;
+
+    if(median < expected || median > expected + expected / 8 + 1)
+    {
+      std::ostringstream ostr;
+      ostr << "check_metrics: median " << median << " while expected "
+           << expected;
+
+      throw Exception(ostr.str());
+    }
+
+    test_gauge.set(10);
+    test_gauge.add(-3);
+
+    El::Metrics::Gauge gauge("el_test_gauge", "Test gauge");
+
+    if(gauge.value() != 7)
+    {
+      throw Exception("check_metrics: unexpected gauge value");
+    }
+
+    try
+    {
+      El::Metrics::Counter counter("el_test_gauge", "Test gauge");
+      throw Exception("check_metrics: metric type mismatch not detected");
+    }
+    catch(const El::Metrics::InvalidArg&)
+    {
+    }
+
+    std::ostringstream ostr;
+    El::Metrics::Registry::instance().scrape(ostr);
+    std::string exposition = ostr.str();
+
+    std::ostringstream total_ostr;
+    total_ostr << "el_test_total " << count << "\n";
+    std::string total = total_ostr.str();
+
+    std::ostringstream count_ostr;
+    count_ostr << "el_test_histogram_count " << count << "\n";
+    std::string histogram_count = count_ostr.str();
+
+    const char* expected_lines[] =
+    {
+      "# TYPE el_test_total counter\n",
+      "# TYPE el_test_gauge gauge\nel_test_gauge 7\n",
+      "# TYPE el_test_histogram histogram\n",
+      "el_test_histogram_bucket{le=\"1\"} 2\n",
+      "el_test_histogram_bucket{le=\"2\"} 3\n",
+      "el_test_histogram_bucket{le=\"4\"} 5\n",
+      total.c_str(),
+      histogram_count.c_str()
+    };
+
+    for(size_t i = 0; i < sizeof(expected_lines) / sizeof(expected_lines[0]);
+        ++i)
+    {
+      if(exposition.find(expected_lines[i]) == std::string::npos)
+      {
+        std::ostringstream ostr;
+        ostr << "check_metrics: '" << expected_lines[i]
+             << "' not found in exposition:\n" << exposition;
+
+        throw Exception(ostr.str());
+      }
+    }
+  }
+
+  void
+  check_bounds() throw(Exception, El::Exception)
+  {
+    bound_histogram.record(4);
+    bound_histogram.record(5);
+    bound_histogram.record(16);
+    bound_histogram.record(1024);
+    bound_histogram.record(1100);
+
+    std::ostringstream ostr;
+    El::Metrics::Registry::instance().scrape(ostr);
+    std::string exposition = ostr.str();
+
+    //
+    // Values equal to bound are counted by its bucket; bounds above 16
+    // are highest values of histogram buckets starting with powers of 2,
+    // so values within precision above power of 2, like 1100, are not
+    // counted under it
+    //
+    const char* expected_lines[] =
+    {
+      "el_test_bound_bucket{le=\"4\"} 1\n",
+      "el_test_bound_bucket{le=\"8\"} 2\n",
+      "el_test_bound_bucket{le=\"17\"} 3\n",
+      "el_test_bound_bucket{le=\"575\"} 3\n",
+      "el_test_bound_bucket{le=\"1151\"} 5\n",
+      "el_test_bound_bucket{le=\"+Inf\"} 5\n"
+    };
+
+    for(size_t i = 0; i < sizeof(expected_lines) / sizeof(expected_lines[0]);
+        ++i)
+    {
+      if(exposition.find(expected_lines[i]) == std::string::npos)
+      {
+        std::ostringstream ostr;
+        ostr << "check_bounds: '" << expected_lines[i]
+             << "' not found in exposition:\n" << exposition;
+
+        throw Exception(ostr.str());
+      }
+    }
+
+    if(exposition.find("el_test_bound_bucket{le=\"2\"}") !=
+       std::string::npos ||
+       exposition.find("el_test_bound_bucket{le=\"2303\"}") !=
+       std::string::npos)
+    {
+      std::ostringstream ostr;
+      ostr << "check_bounds: unexpected bounds in exposition:\n"
+           << exposition;
+
+      throw Exception(ostr.str());
+    }
+  }
+
+  void
+  bench(unsigned long threads, unsigned long iterations)
+    throw(Exception, El::Exception)
+  {
+    for(unsigned long meter = 0; meter < 2; ++meter)
+    {
+      std::vector<Worker> workers(threads);
+
+      for(size_t i = 0; i < workers.size(); ++i)
+      {
+        workers[i].iterations = iterations;
+        workers[i].meter = meter;
+      }
+
+      uint64_t start = El::Metrics::now();
+      run_workers(workers, Worker::bench);
+      uint64_t time = El::Metrics::now() - start;
+
+      std::cerr << (meter ? "El::Stat::TimeMeter" : "El::Metrics::Histogram")
+                << ": " << threads << " threads, "
+                << (double)time / (threads * iterations)
+                << " nsec of wall time per measurement\n";
+    }
+
+    El::Metrics::Histogram::Snapshot snapshot;
+    bench_histogram.snapshot(snapshot);
+
+    std::cerr << "Measurement time nsec: p50 " << snapshot.percentile(0.5)
+              << ", p99 " << snapshot.percentile(0.99) << ", p99.9 "
+              << snapshot.percentile(0.999) << std::endl;
+  }
+}
+
+int
+main(int argc, char** argv)
+{
+  unsigned long iterations = 100000;
+  unsigned long threads = 4;
+
+  for(int i = 1; i < argc; ++i)
+  {
+    const char* arg = argv[i];
+
+    if(strncmp(arg, "--iterations=", 13) == 0)
+    {
+      iterations = atol(arg + 13);
+    }
+    else if(strncmp(arg, "--threads=", 10) == 0)
+    {
+      threads = atol(arg + 10);
+    }
+    else
+    {
+      std::cerr << USAGE << std::endl;
+      return -1;
+    }
+  }
+
+  if(iterations == 0 || threads == 0)
+  {
+    std::cerr << USAGE << std::endl;
+    return -1;
+  }
+
+  try
+  {
+    check_buckets();
+    check_metrics(threads, iterations);
+    check_bounds();
+    bench(threads, iterations);
+
+    return 0;
+  }
+  catch(const El::Exception& e)
+  {
+    std::cerr << "ElTestMetrics: El::Exception caught. Description:\n" << e
+              << std::endl;
+  }
+
+  return -1;
+}
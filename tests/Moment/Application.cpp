@@ -10,18 +10,24 @@
  * @author Karen Arutyunov
  * $Id:$
  */
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
 #include <string>
 #include <iostream>
 #include <sstream>
 
+#include <ace/OS.h>
+
 #include <El/Moment.hpp>
 
 #include "Application.hpp"
 
 namespace
 {
-  const char USAGE[] = "\nUsage:\nTestMoment [help]\n";
+  const char USAGE[] =
+    "\nUsage:\nTestMoment [help|bench [iterations=<count>]]\n";
 }
 
 int
@@ -98,6 +104,11 @@ Application::run(int& argc, char** argv)
     return help(arguments);
   }
 
+  if(command == "bench")
+  {
+    return bench(arguments);
+  }
+
   test(arguments);
   return 0;
 }
@@ -402,6 +413,207 @@ Application::test(const ArgList& arguments)
     
   }
 
+  {
+    // Buffer formatting functions should produce same text as string ones
+    El::Moment moments[] =
+    {
+      El::Moment(ACE_Time_Value(1400148778, 23650)),
+      El::Moment(ACE_Time_Value(1400148778, 23650), El::Moment::TZ_LOCAL),
+      El::Moment("2005-12-17", El::Moment::TF_ISO_8601),
+      El::Moment(ACE_Time_Value(-2208988800LL, 1))
+    };
+
+    for(size_t i = 0; i < sizeof(moments) / sizeof(moments[0]); ++i)
+    {
+      const El::Moment& moment = moments[i];
+      char buff[El::Moment::FORMAT_BUFF_SIZE];
+
+      std::ostringstream expected;
+      expected << moment.iso8601() << "|" << moment.iso8601(false, false)
+               << "|" << moment.rfc0822(true, true) << "|"
+               << moment.epoch(true) << "|" << moment.dense_format() << "|"
+               << moment.http_cookie_expiration() << "|"
+               << El::Moment::time(moment, true);
+
+      std::ostringstream result;
+      result << std::string(buff, moment.format_iso8601(buff)) << "|";
+      result << std::string(buff, moment.format_iso8601(buff, false, false))
+             << "|";
+      result << std::string(buff, moment.format_rfc0822(buff, true, true))
+             << "|";
+      result << std::string(buff, moment.format_epoch(buff, true)) << "|";
+      result << std::string(buff, moment.format_dense(buff)) << "|";
+      result << std::string(buff, moment.format_http_cookie_expiration(buff))
+             << "|";
+      result << std::string(buff, El::Moment::format_time(buff, moment, true));
+
+      if(result.str() != expected.str())
+      {
+        std::ostringstream ostr;
+        ostr << "Application::test: buffer formatting '" << result.str()
+             << "' differs from '" << expected.str() << "'";
+      
+        throw Exception(ostr.str());
+      }
+    }
+
+    if(moments[0].rfc0822(true, true) != "Thu, 15 May 2014 10:12:58.023650 GMT")
+    {
+      std::ostringstream ostr;
+      ostr << "Application::test: unexpected rfc0822 format '"
+           << moments[0].rfc0822(true, true) << "'";
+
+      throw Exception(ostr.str());
+    }
+  }
+
+  {
+    // Calendar arithmetic should be in line with gmtime_r and timegm
+    for(time_t sec = -62135596800LL; sec < 253402300799LL;
+        sec += 86400 * 7 + 3671)
+    {
+      tm expected;
+      ACE_OS::gmtime_r(&sec, &expected);
+
+      El::Moment moment = El::Moment(ACE_Time_Value(sec));
+
+      if(moment.tm_year != expected.tm_year ||
+         moment.tm_mon != expected.tm_mon ||
+         moment.tm_mday != expected.tm_mday ||
+         moment.tm_hour != expected.tm_hour ||
+         moment.tm_min != expected.tm_min ||
+         moment.tm_sec != expected.tm_sec ||
+         moment.tm_wday != expected.tm_wday ||
+         moment.tm_yday != expected.tm_yday ||
+         ACE_Time_Value(moment).sec() != sec)
+      {
+        std::ostringstream ostr;
+        ostr << "Application::test: unexpected moment '"
+             << moment.iso8601() << "' for " << sec << " seconds";
+
+        throw Exception(ostr.str());
+      }
+    }
+  }
+
+  {
+    char buff[El::Moment::FORMAT_BUFF_SIZE];
+
+    for(time_t sec = 1400148778; sec < 1400148781; ++sec)
+    {
+      for(unsigned long i = 0; i < 2; ++i)
+      {
+        std::string expected = El::Moment(ACE_Time_Value(sec)).rfc0822();
+
+        if(std::string(buff, El::Moment::http_date(buff, sec)) != expected)
+        {
+          std::ostringstream ostr;
+          ostr << "Application::test: http_date '" << buff
+               << "' differs from '" << expected << "'";
+
+          throw Exception(ostr.str());
+        }
+      }
+    }
+  }
+
   return 0;
 }
 
+
+int
+Application::bench(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  unsigned long iterations = 1000000;
+
+  for(ArgList::const_iterator it = arguments.begin(); it != arguments.end();
+      ++it)
+  {
+    if(it->name == "iterations")
+    {
+      iterations = atol(it->value.c_str());
+    }
+    else
+    {
+      std::ostringstream ostr;
+      ostr << "Application::bench: unexpected argument '" << it->name << "'";
+      throw InvalidArg(ostr.str());
+    }
+  }
+
+  if(iterations == 0)
+  {
+    throw InvalidArg("Application::bench: iterations should be positive");
+  }
+
+  const char* names[] =
+  {
+    "rfc0822()",
+    "format_rfc0822()",
+    "iso8601()",
+    "format_iso8601()",
+    "Moment(ACE_Time_Value)",
+    "gmtime_r",
+    "set_rfc0822",
+    "set_iso8601",
+    "http_date"
+  };
+
+  const El::Moment moment(ACE_Time_Value(1400148778, 23650));
+  const char rfc0822[] = "Thu, 15 May 2014 10:12:58 GMT";
+  const char iso8601[] = "2014-05-15 10:12:58.02365 Z";
+
+  size_t length = 0;
+  char buff[El::Moment::FORMAT_BUFF_SIZE];
+
+  for(size_t test = 0; test < sizeof(names) / sizeof(names[0]); ++test)
+  {
+    ACE_Time_Value start = ACE_OS::gettimeofday();
+
+    for(unsigned long i = 0; i < iterations; ++i)
+    {
+      time_t sec = 1400148778 + i / 1000;
+
+      switch(test)
+      {
+      case 0: length += moment.rfc0822().length(); break;
+      case 1: length += moment.format_rfc0822(buff) - buff; break;
+      case 2: length += moment.iso8601().length(); break;
+      case 3: length += moment.format_iso8601(buff) - buff; break;
+      case 4: length += El::Moment(ACE_Time_Value(sec)).tm_mday; break;
+      case 5:
+        {
+          tm result;
+          length += ACE_OS::gmtime_r(&sec, &result)->tm_mday;
+          break;
+        }
+      case 6:
+        {
+          El::Moment parsed;
+          parsed.set_rfc0822(rfc0822);
+          length += parsed.tm_mday;
+          break;
+        }
+      case 7:
+        {
+          El::Moment parsed;
+          parsed.set_iso8601(iso8601);
+          length += parsed.tm_mday;
+          break;
+        }
+      case 8: length += El::Moment::http_date(buff, sec) - buff; break;
+      }
+    }
+
+    ACE_Time_Value time = ACE_OS::gettimeofday() - start;
+
+    std::cerr << names[test] << ": "
+              << (time.sec() * 1000000000.0 + time.usec() * 1000.0) /
+                 iterations << " nsec per call\n";
+  }
+
+  // Prevents loops from being optimized out
+  std::cerr << "Total length: " << length << std::endl;
+  return 0;
+}
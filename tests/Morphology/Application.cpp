@@ -0,0 +1,462 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file   Elements/tests/Morphology/Application.cpp
+ * @author Karen Arutyunov
+ * $Id:$
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+
+#include <El/Lang.hpp>
+#include <El/Dictionary/Morphology.hpp>
+
+#include "Application.hpp"
+
+namespace
+{
+  const char USAGE[] = "\nUsage:\nElTestMorphology <command> <args>\n"
+  "Synopsis 1: ElTestMorphology help\n"
+  "Synopsis 2: ElTestMorphology run [lemmas=<count>]\n";
+
+  // Makes .nrm file of few megabytes, so is parsed in several ranges
+  const size_t TEST_LEMMAS = 60000;
+  const size_t THREADS = 4;
+
+  // Each checked lemma is followed by CHECK_STEP - 1 skipped ones
+  const size_t CHECK_STEP = 13;
+
+  const char* const LANGS[] = { "eng", "rus" };
+
+  // Letters lemma words are not spelled with, so forms never clash
+  const char* const SUFFIXES[] = { "", "x", "yz", "zyx" };
+
+  const size_t FORMS = sizeof(SUFFIXES) / sizeof(SUFFIXES[0]);
+
+  //
+  // Lemma word of language lang; spells number with a-p letters as
+  // digits are not dictionary word characters
+  //
+  std::string
+  lemma_word(size_t lang, size_t lemma) throw(El::Exception)
+  {
+    std::string word(1, "er"[lang]);
+
+    for(; lemma; lemma /= 16)
+    {
+      word += (char)('a' + lemma % 16);
+    }
+
+    return word;
+  }
+
+  //
+  // If word form has normal forms of both its and next lemma, so
+  // normal form lists of different lengths are loaded
+  //
+  inline
+  bool
+  ambiguous(size_t form, size_t lemma, size_t lemmas) throw()
+  {
+    return form == 1 && lemma % 7 == 0 && lemma < lemmas;
+  }
+
+  void
+  write_file(const std::string& path, const std::string& content)
+    throw(Application::Exception, El::Exception)
+  {
+    std::fstream file(path.c_str(), std::ios::out);
+
+    if(!file.is_open())
+    {
+      std::ostringstream ostr;
+      ostr << "write_file: failed to create " << path;
+      throw Application::Exception(ostr.str());
+    }
+
+    file << content;
+  }
+}
+
+int
+main(int argc, char** argv)
+{
+  try
+  {
+    Application app;
+    return app.run(argc, argv);
+  }
+  catch(const Application::InvalidArg& e)
+  {
+    std::cerr << "Invalid argument: " << e
+              << "\nRun 'ElTestMorphology help' for usage details\n";
+  }
+  catch(const El::Exception& e)
+  {
+    std::cerr << "ElTestMorphology: El::Exception caught. "
+      "Description:" << std::endl << e << std::endl;
+  }
+  catch(...)
+  {
+    std::cerr << "ElTestMorphology: unknown exception caught\n";
+  }
+
+  return -1;
+}
+
+Application::Application() throw(Application::Exception, El::Exception)
+    : lemmas_(0)
+{
+}
+
+Application::~Application() throw()
+{
+  remove_files();
+}
+
+int
+Application::run(int& argc, char** argv)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  std::string command;
+
+  int i = 1;
+
+  if(argc > 1)
+  {
+    command = argv[i++];
+  }
+
+  ArgList arguments;
+
+  for(; i < argc; i++)
+  {
+    char* argument = argv[i];
+
+    Argument arg;
+    const char* eq = strstr(argument, "=");
+
+    if(eq == 0)
+    {
+      arg.name = argument;
+    }
+    else
+    {
+      arg.name.assign(argument, eq - argument);
+      arg.value = eq + 1;
+    }
+
+    arguments.push_back(arg);
+  }
+
+  if(command == "help")
+  {
+    return help(arguments);
+  }
+
+  return test(arguments);
+}
+
+int
+Application::help(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  std::cerr << USAGE;
+  return 0;
+}
+
+int
+Application::test(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  size_t lemmas = TEST_LEMMAS;
+
+  for(ArgList::const_iterator it = arguments.begin(); it != arguments.end();
+      ++it)
+  {
+    if(it->name == "lemmas")
+    {
+      lemmas = atol(it->value.c_str());
+    }
+    else
+    {
+      std::ostringstream ostr;
+      ostr << "unexpected argument " << it->name;
+      throw InvalidArg(ostr.str());
+    }
+  }
+
+  if(lemmas < CHECK_STEP)
+  {
+    std::ostringstream ostr;
+    ostr << "lemmas should be at least " << CHECK_STEP;
+    throw InvalidArg(ostr.str());
+  }
+
+  create_files(lemmas);
+
+  test_load();
+  test_errors();
+
+  return 0;
+}
+
+void
+Application::create_files(size_t lemmas) throw(Exception, El::Exception)
+{
+  char dir[] = "/tmp/ElTestMorphology.XXXXXX";
+
+  if(mkdtemp(dir) == 0)
+  {
+    throw Exception("Application::create_files: mkdtemp failed");
+  }
+
+  dir_ = dir;
+  lemmas_ = lemmas;
+
+  for(size_t l = 0; l < sizeof(LANGS) / sizeof(LANGS[0]); ++l)
+  {
+    std::ostringstream nrm;
+    std::ostringstream mrf;
+    size_t buff_size = 1;
+    size_t norm_forms = 0;
+
+    for(size_t lemma = 1; lemma <= lemmas; ++lemma)
+    {
+      std::string word = lemma_word(l, lemma);
+
+      for(size_t f = 0; f < FORMS; ++f)
+      {
+        std::string form = word + SUFFIXES[f];
+
+        nrm << form << "\t" << lemma;
+        ++norm_forms;
+
+        if(ambiguous(f, lemma, lemmas))
+        {
+          nrm << " " << lemma + 1;
+          ++norm_forms;
+        }
+
+        nrm << "\n";
+        buff_size += form.length() + 1;
+
+        mrf << (f ? " " : "") << form << ":" << lemma;
+      }
+
+      mrf << "\n";
+    }
+
+    std::string path = dir_ + "/" + LANGS[l];
+
+    std::ostringstream header;
+    header << LANGS[l] << "\t" << lemmas * FORMS << "\t" << buff_size
+           << "\t" << norm_forms << "\n";
+
+    write_file(path + ".nrm", header.str() + nrm.str());
+
+    header.str("");
+    header << LANGS[l] << "\t" << lemmas << "\t" << lemmas * (FORMS - 1)
+           << "\n";
+
+    write_file(path + ".mrf", header.str() + mrf.str());
+
+    write_file(path + ".stp",
+               lemma_word(l, 1) + "\n" + lemma_word(l, 2) + SUFFIXES[1] +
+               "\n");
+
+    files_.push_back(path);
+  }
+
+  // Same as eng one but referring word missing in normal forms
+  write_file(dir_ + "/broken.nrm", "eng\t1\t16\t1\nword\t1\n");
+  write_file(dir_ + "/broken.mrf", "eng\t1\t1\nword:1 missing:1\n");
+}
+
+void
+Application::remove_files() throw()
+{
+  if(dir_.empty())
+  {
+    return;
+  }
+
+  const char* const EXTENSIONS[] = { ".nrm", ".mrf", ".stp" };
+
+  files_.push_back(dir_ + "/broken");
+
+  for(StringArray::const_iterator it(files_.begin()); it != files_.end();
+      ++it)
+  {
+    for(size_t i = 0; i < sizeof(EXTENSIONS) / sizeof(EXTENSIONS[0]); ++i)
+    {
+      unlink((*it + EXTENSIONS[i]).c_str());
+    }
+  }
+
+  rmdir(dir_.c_str());
+
+  dir_.clear();
+  files_.clear();
+}
+
+std::string
+Application::dump(size_t threads) throw(Exception, El::Exception)
+{
+  El::Dictionary::Morphology::WordInfoManager manager(10, 30, 10);
+  std::ostringstream warnings;
+
+  manager.load(files_, &warnings, threads);
+
+  std::ostringstream ostr;
+  ostr << "hash " << manager.hash() << "\nlanguages "
+       << manager.languages() << "\nwarnings " << warnings.str() << "\n";
+
+  for(size_t l = 0; l < sizeof(LANGS) / sizeof(LANGS[0]); ++l)
+  {
+    El::Lang lang(LANGS[l]);
+    StringArray forms;
+
+    for(size_t lemma = 1; lemma <= lemmas_; lemma += CHECK_STEP)
+    {
+      std::string word = lemma_word(l, lemma);
+
+      for(size_t f = 0; f < FORMS; ++f)
+      {
+        std::string form = word + SUFFIXES[f];
+        forms.push_back(form);
+
+        bool is_stop_word = false;
+
+        const char* normal_form =
+          manager.get_normal_form(form.c_str(), lang, is_stop_word);
+
+        // First of ambiguous normal forms can be of either lemma
+        if(normal_form == 0 ||
+           (!ambiguous(f, lemma, lemmas_) && normal_form != word))
+        {
+          std::ostringstream estr;
+          estr << "Application::dump: unexpected normal form '"
+               << (normal_form ? normal_form : "") << "' of word '"
+               << form << "' loaded with " << threads << " threads";
+
+          throw Exception(estr.str());
+        }
+
+        ostr << form << " " << is_stop_word << "\n";
+      }
+    }
+
+    El::Dictionary::Morphology::WordArray words(forms.begin(),
+                                                forms.end());
+
+    El::Dictionary::Morphology::LemmaInfoArrayArray lemmas;
+
+    manager.get_lemmas(words,
+                       &lang,
+                       El::Dictionary::Morphology::Lemma::GS_NONE,
+                       lemmas);
+
+    for(size_t i = 0; i < lemmas.size(); ++i)
+    {
+      const El::Dictionary::Morphology::LemmaInfoArray& infos = lemmas[i];
+
+      ostr << words[i].c_str() << ":";
+
+      for(El::Dictionary::Morphology::LemmaInfoArray::const_iterator
+            it(infos.begin()); it != infos.end(); ++it)
+      {
+        ostr << " " << it->lang.l3_code() << "/" << it->norm_form.id << "/"
+             << it->norm_form.text << "/" << it->word_forms.size();
+      }
+
+      ostr << "\n";
+    }
+  }
+
+  return ostr.str();
+}
+
+void
+Application::test_load() throw(Exception, El::Exception)
+{
+  std::cerr << "* Testing parallel load ...\n";
+
+  std::string serial = dump(1);
+  std::string parallel = dump(THREADS);
+
+  if(serial != parallel)
+  {
+    std::ostringstream ostr;
+    ostr << "Application::test_load: dictionaries loaded with 1 and "
+         << THREADS << " threads differ; serial:\n"
+         << serial.substr(0, 1024) << "\nparallel:\n"
+         << parallel.substr(0, 1024);
+
+    throw Exception(ostr.str());
+  }
+
+  if(serial.find("\nlanguages 2\n") == std::string::npos)
+  {
+    std::ostringstream ostr;
+    ostr << "Application::test_load: unexpected load result:\n"
+         << serial.substr(0, 1024);
+
+    throw Exception(ostr.str());
+  }
+}
+
+void
+Application::test_errors() throw(Exception, El::Exception)
+{
+  std::cerr << "* Testing load errors ...\n";
+
+  const char* const BAD_FILES[] = { "missing", "broken" };
+
+  for(size_t b = 0; b < sizeof(BAD_FILES) / sizeof(BAD_FILES[0]); ++b)
+  {
+    for(size_t threads = 1; threads <= THREADS; threads += THREADS - 1)
+    {
+      El::Dictionary::Morphology::WordInfoManager manager(10, 30, 10);
+
+      StringArray files(files_);
+      files.push_back(dir_ + "/" + BAD_FILES[b]);
+
+      try
+      {
+        manager.load(files, 0, threads);
+
+        std::ostringstream ostr;
+        ostr << "Application::test_errors: loading " << BAD_FILES[b]
+             << " dictionary with " << threads << " threads succeeded";
+
+        throw Exception(ostr.str());
+      }
+      catch(const El::Dictionary::Morphology::InvalidArg&)
+      {
+      }
+
+      // Manager hash is initially 1
+      if(manager.languages() || manager.hash() != 1)
+      {
+        std::ostringstream ostr;
+        ostr << "Application::test_errors: manager changed by failed "
+          "load of " << BAD_FILES[b] << " dictionary with " << threads
+             << " threads";
+
+        throw Exception(ostr.str());
+      }
+    }
+  }
+}
@@ -11,12 +11,15 @@
  * $Id:$
  */
 #include <string.h>
+#include <pthread.h>
+
 #include <string>
 #include <iostream>
 #include <list>
 #include <sstream>
 
 #include <El/Moment.hpp>
+#include <El/Metrics.hpp>
 
 #include "Application.hpp"
 
@@ -182,6 +185,9 @@ Application::test(const ArgList& arguments)
 
   test_new_connections_factory();
   test_pool_connections_factory();
+  test_pool_maintenance();
+  test_parked_ping();
+  bench_pool();
   return 0;
 }
 
@@ -335,6 +341,253 @@ Application::test_pool_connections_factory()
   connection2 = 0;
 }
 
+El::MySQL::DB*
+Application::create_db(El::MySQL::ConnectionFactory* factory)
+  throw(Exception, El::Exception)
+{
+  return unix_socket_.empty() ?
+    new El::MySQL::DB(user_.c_str(),
+                      passwd_.c_str(),
+                      db_.c_str(),
+                      port_,
+                      host_.c_str(),
+                      client_flag_,
+                      factory) :
+    new El::MySQL::DB(user_.c_str(),
+                      passwd_.c_str(),
+                      db_.c_str(),
+                      unix_socket_.c_str(),
+                      client_flag_,
+                      factory);
+}
+
+void
+Application::test_pool_maintenance() throw(Exception, El::Exception)
+{
+  El::Metrics::Counter pings("el_mysql_pool_pings_total",
+                             "Keep-alive pings of idle pooled MySQL "
+                             "connections");
+  
+  El::Metrics::Counter affinity_hits("el_mysql_pool_affinity_hits_total",
+                                     "MySQL connections reused by the "
+                                     "releasing thread");
+  
+  El::MySQL::ConnectionPoolFactory* factory =
+    new El::MySQL::ConnectionPoolFactory(2, 4, 0, 0, ACE_Time_Value(1), true);
+
+  El::MySQL::DB_var dbase = create_db(factory);
+
+  // Connections are opened by the maintenance thread
+  for(unsigned long i = 0; i < 100 && factory->idle_connections() < 2; i++)
+  {
+    ACE_OS::sleep(ACE_Time_Value(0, 100000));
+  }
+
+  if(factory->idle_connections() != 2)
+  {
+    std::ostringstream ostr;
+    ostr << "Application::test_pool_maintenance: "
+         << factory->idle_connections()
+         << " connections warmed up instead of 2; last error: "
+         << factory->last_error();
+
+    throw Exception(ostr.str());
+  }
+
+  uint64_t ping_count = pings.value();
+
+  for(unsigned long i = 0; i < 50 && pings.value() < ping_count + 2; i++)
+  {
+    ACE_OS::sleep(ACE_Time_Value(0, 100000));
+  }
+
+  if(pings.value() < ping_count + 2)
+  {
+    throw Exception("Application::test_pool_maintenance: idle connections "
+                    "not pinged");
+  }
+
+  uint64_t hits = affinity_hits.value();
+  
+  El::MySQL::Connection_var connection = dbase->connect();
+  El::MySQL::Result_var result = connection->query("select * from TestMySQL");
+  result = 0;
+
+  El::MySQL::Connection* released = connection.in();
+  connection = 0;
+
+  connection = dbase->connect();
+
+  if(connection.in() != released || affinity_hits.value() != hits + 1)
+  {
+    throw Exception("Application::test_pool_maintenance: released "
+                    "connection not reused by the thread");
+  }
+
+  result = connection->query("select * from TestMySQL");
+  result = 0;
+
+  // Parked connection is taken away by concurrent threads
+  PoolWorkerArray workers(8);
+
+  for(size_t i = 0; i < workers.size(); i++)
+  {
+    workers[i].dbase = dbase.in();
+    workers[i].iterations = 200;
+    workers[i].query = true;
+  }
+
+  connection = 0;
+  
+  run_workers(workers);
+
+  // Connection released last by this thread can stay parked
+  if(factory->used_connections() > 1 || factory->idle_connections() > 4)
+  {
+    std::ostringstream ostr;
+    ostr << "Application::test_pool_maintenance: "
+         << factory->used_connections() << " connections used and "
+         << factory->idle_connections() << " idle after workers exited";
+
+    throw Exception(ostr.str());
+  }
+}
+
+void
+Application::test_parked_ping() throw(Exception, El::Exception)
+{
+  El::Metrics::Counter pings("el_mysql_pool_pings_total",
+                             "Keep-alive pings of idle pooled MySQL "
+                             "connections");
+
+  // No maintenance thread to check parked connections
+  El::MySQL::ConnectionPoolFactory* factory =
+    new El::MySQL::ConnectionPoolFactory(1,
+                                         2,
+                                         0,
+                                         0,
+                                         ACE_Time_Value::zero,
+                                         true);
+
+  El::MySQL::DB_var dbase = create_db(factory);
+
+  El::MySQL::Connection_var connection = dbase->connect();
+  El::MySQL::Connection* released = connection.in();
+  connection = 0;
+
+  uint64_t ping_count = pings.value();
+  connection = dbase->connect();
+
+  if(connection.in() != released || pings.value() != ping_count + 1)
+  {
+    throw Exception("Application::test_parked_ping: parked connection "
+                    "not pinged when taken");
+  }
+
+  El::MySQL::Result_var result = connection->query("select * from TestMySQL");
+}
+
+void
+Application::bench_pool() throw(Exception, El::Exception)
+{
+  const unsigned long THREADS = 8;
+  const unsigned long ITERATIONS = 100000;
+  
+  for(unsigned long affinity = 0; affinity < 2; affinity++)
+  {
+    El::MySQL::ConnectionPoolFactory* factory =
+      new El::MySQL::ConnectionPoolFactory(THREADS,
+                                           THREADS,
+                                           0,
+                                           0,
+                                           ACE_Time_Value::zero,
+                                           affinity);
+
+    El::MySQL::DB_var dbase = create_db(factory);
+    
+    PoolWorkerArray workers(THREADS);
+
+    for(size_t i = 0; i < workers.size(); i++)
+    {
+      workers[i].dbase = dbase.in();
+      workers[i].iterations = ITERATIONS;
+      workers[i].query = false;
+    }
+
+    uint64_t start = El::Metrics::now();
+    run_workers(workers);
+    uint64_t time = El::Metrics::now() - start;
+
+    std::cerr << (affinity ? "Thread affine pool" : "Shared pool") << ": "
+              << THREADS << " threads, "
+              << (double)time / (THREADS * ITERATIONS)
+              << " nsec of wall time per connect\n";
+  }
+}
+
+void
+Application::run_workers(PoolWorkerArray& workers)
+  throw(Exception, El::Exception)
+{
+  std::vector<pthread_t> threads(workers.size());
+
+  for(size_t i = 0; i < workers.size(); i++)
+  {
+    if(pthread_create(&threads[i], 0, PoolWorker::run, &workers[i]))
+    {
+      throw Exception("Application::run_workers: pthread_create failed");
+    }
+  }
+
+  for(size_t i = 0; i < threads.size(); i++)
+  {
+    pthread_join(threads[i], 0);
+  }
+
+  for(size_t i = 0; i < workers.size(); i++)
+  {
+    if(!workers[i].error.empty())
+    {
+      std::ostringstream ostr;
+      ostr << "Application::run_workers: worker failed. Description:\n"
+           << workers[i].error;
+
+      throw Exception(ostr.str());
+    }
+  }
+}
+
+//
+// Application::PoolWorker struct
+//
+void*
+Application::PoolWorker::run(void* arg)
+{
+  PoolWorker& worker = *static_cast<PoolWorker*>(arg);
+
+  try
+  {
+    ACE_Time_Value timeout(10);
+    
+    for(unsigned long i = 0; i < worker.iterations; i++)
+    {
+      El::MySQL::Connection_var connection = worker.dbase->connect(&timeout);
+
+      if(worker.query)
+      {
+        El::MySQL::Result_var result =
+          connection->query("select * from TestMySQL");
+      }
+    }
+  }
+  catch(const El::Exception& e)
+  {
+    worker.error = e.what();
+  }
+
+  return 0;
+}
+
 bool
 Application::notify(El::Service::Event* event) throw(El::Exception)
 {
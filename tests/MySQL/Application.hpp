@@ -16,6 +16,7 @@
 
 #include <string>
 #include <list>
+#include <vector>
 
 #include <El/Exception.hpp>
 #include <El/RefCount/All.hpp>
@@ -59,6 +60,27 @@ private:
 
   void test_new_connections_factory() throw(Exception, El::Exception);
   void test_pool_connections_factory() throw(Exception, El::Exception);
+  void test_pool_maintenance() throw(Exception, El::Exception);
+  void test_parked_ping() throw(Exception, El::Exception);
+  void bench_pool() throw(Exception, El::Exception);
+
+  El::MySQL::DB* create_db(El::MySQL::ConnectionFactory* factory)
+    throw(Exception, El::Exception);
+
+  struct PoolWorker
+  {
+    El::MySQL::DB* dbase;
+    unsigned long iterations;
+    bool query;
+    std::string error;
+
+    static void* run(void* arg);
+  };
+
+  typedef std::vector<PoolWorker> PoolWorkerArray;
+
+  static void run_workers(PoolWorkerArray& workers)
+    throw(Exception, El::Exception);
 
   virtual bool notify(El::Service::Event* event) throw(El::Exception);
   
@@ -11,6 +11,8 @@
  * $Id:$
  */
 #include <string.h>
+#include <unistd.h>
+
 #include <string>
 #include <iostream>
 #include <list>
@@ -220,7 +222,255 @@ Application::test(const ArgList& arguments)
               << ", comment=" << record.comment()
               << std::endl;
   }
+
+  check_view_and_insert();
+  check_field_checks();
   
   return 0;
 }
 
+void
+Application::check_field_checks() throw(Exception, El::Exception)
+{
+  {
+    // Only columns used are checked
+    El::MySQL::Result_var result =
+      connection_->query("select id, url from AllTypes limit 1");
+
+    Namespace1::Namespace2::Record record(result.in(), 2);
+  }
+
+  El::MySQL::Result_var result =
+    connection_->query("select id, id as url from AllTypes limit 1");
+
+  try
+  {
+    Namespace1::Namespace2::Record record(result.in(), 2);
+  }
+  catch(const Namespace1::Namespace2::Record::Exception&)
+  {
+    return;
+  }
+
+  throw Exception("Application::check_field_checks: field of unexpected "
+                  "type not detected");
+}
+
+void
+Application::check_view_and_insert() throw(Exception, El::Exception)
+{
+  std::ostringstream prefix_ostr;
+  prefix_ostr << "http://elements.test/" << getpid() << "-"
+              << ACE_OS::gettimeofday().sec() << "/";
+  
+  std::string prefix = prefix_ostr.str();
+
+  // Text requiring escaping
+  const char NAME[] = "O'Brien \\ \"quoted\"\n\0zero";
+  std::string name(NAME, sizeof(NAME) - 1);
+
+  El::Moment created(ACE_Time_Value(ACE_OS::gettimeofday().sec()));
+
+  const unsigned long ROWS = 1000;
+  unsigned long inserted = 0;
+
+  {
+    // Small capacity for the buffer to grow
+    Namespace1::Namespace2::RecordInsert insert(connection_.in(), 256);
+
+    for(unsigned long i = 0; i < ROWS; i++)
+    {
+      std::ostringstream ostr;
+      ostr << prefix << i;
+      std::string url = ostr.str();
+
+      float density = i / 4.0;
+      double rate = i;
+      uint64_t flags = i % 8;
+      uint16_t start_year = 2000 + i % 50;
+
+      insert.add(url,
+                 created,
+                 "U",
+                 name,
+                 i * 0.5,
+                 i % 2 ? &density : 0,
+                 &rate,
+                 &flags,
+                 &start_year,
+                 i % 3 ? &created : 0,
+                 i % 2 ? El::MySQL::StringView("red,blue") :
+                   El::MySQL::StringView(),
+                 i % 5 ? El::MySQL::StringView(url) :
+                   El::MySQL::StringView());
+
+      if(insert.size() > 64 * 1024)
+      {
+        inserted += insert.execute();
+      }
+    }
+
+    inserted += insert.execute();
+  }
+
+  if(inserted != ROWS)
+  {
+    std::ostringstream ostr;
+    ostr << "Application::check_view_and_insert: " << inserted
+         << " rows inserted instead of " << ROWS;
+    
+    throw Exception(ostr.str());
+  }
+
+  std::string query = std::string("select * from AllTypes where url like '") +
+    prefix + "%' order by id";
+
+  El::MySQL::Result_var view_result = connection_->query(query.c_str());
+  El::MySQL::Result_var row_result = connection_->query(query.c_str());
+  
+  Namespace1::Namespace2::RecordView view(view_result.in());
+  Namespace1::Namespace2::Record record(row_result.in());
+
+  unsigned long i = 0;
+
+  for(; view.fetch_row(); i++)
+  {
+    if(!record.fetch_row())
+    {
+      throw Exception(
+        "Application::check_view_and_insert: row flavour has less rows");
+    }
+
+    std::ostringstream ostr;
+    ostr << prefix << i;
+    std::string url = ostr.str();
+
+    const char* mismatch = 0;
+
+    if(view.url().str() != url || std::string(record.url()) != url)
+    {
+      mismatch = "url";
+    }
+    else if(ACE_Time_Value(view.created()) != ACE_Time_Value(created) ||
+            ACE_Time_Value(El::Moment(record.created())) !=
+            ACE_Time_Value(created))
+    {
+      mismatch = "created";
+    }
+    else if(view.creator_type().str() != "U" ||
+            view.creator_name().str() != name ||
+            std::string(record.creator_name()) != name)
+    {
+      mismatch = "creator";
+    }
+    else if(view.activity() != i * 0.5 ||
+            double(record.activity()) != view.activity())
+    {
+      mismatch = "activity";
+    }
+    else if(view.density_is_null() != (i % 2 == 0) ||
+            (i % 2 && view.density() != float(i / 4.0)))
+    {
+      mismatch = "density";
+    }
+    else if(view.rate() != i || view.flags() != i % 8 ||
+            view.start_year() != 2000 + i % 50 ||
+            view.start_year() != record.start_year().value())
+    {
+      mismatch = "rate, flags or start_year";
+    }
+    else if(view.timeX_is_null() != (i % 3 == 0) ||
+            (i % 3 && ACE_Time_Value(view.timeX()) != ACE_Time_Value(created)))
+    {
+      mismatch = "timeX";
+    }
+    else if(view.rgb_is_null() != (i % 2 == 0) ||
+            (i % 2 && view.rgb().str() != "red,blue"))
+    {
+      mismatch = "rgb";
+    }
+    else if(view.comment().is_null() != (i % 5 == 0) ||
+            (i % 5 && view.comment().str() != url))
+    {
+      mismatch = "comment";
+    }
+
+    if(mismatch)
+    {
+      std::ostringstream ostr;
+      ostr << "Application::check_view_and_insert: unexpected " << mismatch
+           << " of row " << i;
+      
+      throw Exception(ostr.str());
+    }
+  }
+
+  if(i != ROWS)
+  {
+    std::ostringstream ostr;
+    ostr << "Application::check_view_and_insert: " << i
+         << " rows read instead of " << ROWS;
+    
+    throw Exception(ostr.str());
+  }
+
+  bench_view(query.c_str());
+
+  std::string delete_query =
+    std::string("delete from AllTypes where url like '") + prefix + "%'";
+  
+  connection_->query(delete_query.c_str());
+}
+
+void
+Application::bench_view(const char* query) throw(Exception, El::Exception)
+{
+  const unsigned long PASSES = 20;
+
+  El::MySQL::Result_var result = connection_->query(query);
+  
+  for(unsigned long flavour = 0; flavour < 2; flavour++)
+  {
+    unsigned long long rows = 0;
+    double sum = 0;
+
+    ACE_Time_Value start = ACE_OS::gettimeofday();
+
+    if(flavour)
+    {
+      Namespace1::Namespace2::RecordView view(result.in());
+      
+      for(unsigned long i = 0; i < PASSES; i++)
+      {
+        for(view.data_seek(0); view.fetch_row(); rows++)
+        {
+          sum += view.url().length() + view.creator_name().length() +
+            view.activity() + view.rate() +
+            ACE_Time_Value(view.created()).sec();
+        }
+      }
+    }
+    else
+    {
+      Namespace1::Namespace2::Record record(result.in());
+      
+      for(unsigned long i = 0; i < PASSES; i++)
+      {
+        for(record.data_seek(0); record.fetch_row(); rows++)
+        {
+          sum += record.url().length() + record.creator_name().length() +
+            record.activity() + record.rate() +
+            ACE_Time_Value(El::Moment(record.created())).sec();
+        }
+      }
+    }
+
+    ACE_Time_Value time = ACE_OS::gettimeofday() - start;
+    double sec = time.sec() + time.usec() / 1000000.0;
+
+    std::cerr << (flavour ? "RecordView" : "Record") << ": " << rows
+              << " rows, " << (unsigned long long)(rows / sec)
+              << " rows per second (checksum " << sum << ")\n";
+  }
+}
+
@@ -52,6 +52,15 @@ private:
   int test(const ArgList& arguments)
     throw(InvalidArg, Exception, El::Exception);
 
+  // Inserts rows with generated insert builder and reads them back
+  // with both row class flavours
+  void check_view_and_insert() throw(Exception, El::Exception);
+
+  // Ensures generated row classes reject a used column of unexpected type
+  void check_field_checks() throw(Exception, El::Exception);
+
+  void bench_view(const char* query) throw(Exception, El::Exception);
+
 private:
   El::MySQL::Connection_var connection_;
 };
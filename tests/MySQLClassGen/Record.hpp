@@ -5,7 +5,7 @@
  *             Commercial; contact karen.arutyunov@gmail.com
  */
 
-// Copyright (C) 2005 Karen Arutyunov
+// Copyright (C) 2005-2008 Karen Arutyunov
 //
 // This program was generated by MySQL Class Generating Compiler
 // MySQLClassGen (TM)
@@ -23,8 +23,10 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
 
-#ifndef _NAMESPACE1_NAMESPACE2_RECORD__429145051_
-#define _NAMESPACE1_NAMESPACE2_RECORD__429145051_
+#ifndef _NAMESPACE1_NAMESPACE2_RECORD__1661968815_
+#define _NAMESPACE1_NAMESPACE2_RECORD__1661968815_
+
+#include <limits.h>
 
 #include <string>
 #include <sstream>
@@ -46,7 +48,7 @@ namespace Namespace1
       EL_EXCEPTION(IsNull, Exception);
 
     public:
-      Record(El::MySQL::Result*)
+      Record(El::MySQL::Result* result, unsigned long use_columns = ULONG_MAX)
         throw(Exception, El::Exception);
 
       El::MySQL::UnsignedLongLong id() const
@@ -94,19 +96,26 @@ namespace Namespace1
 // Record class definition
 //
     inline
-    Record::Record(El::MySQL::Result* result)
+    Record::Record(El::MySQL::Result* result, unsigned long use_columns)
       throw(Exception, El::Exception)
         : Row(result)
     {
-      if(result->num_fields() != 13)
+      unsigned long num_columns = std::min(use_columns, (unsigned long)13);
+
+      if(result->num_fields() != num_columns)
       {
         std::ostringstream ostr;
         ostr << "Record::Record: unexpected number of fields "
-             << result->num_fields() << " instead of 13";
+             << result->num_fields() << " instead of " << num_columns;
 
         throw Exception(ostr.str());
       }
 
+      if(use_columns <= 0)
+      {
+        return;
+      }
+
       enum_field_types type = (*result)[0].type;
 
       if(type != 8)
@@ -119,13 +128,13 @@ namespace Namespace1
       }
 
       unsigned int flags = 
-        (*result)[0].flags & (NOT_NULL_FLAG|UNSIGNED_FLAG|BINARY_FLAG);
+        (*result)[0].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
 
-      if(flags != 33)
+      if(flags != 0x21)
       {
         std::ostringstream ostr;
-        ostr << "Record::Record: unexpected flags " << flags
-             << " instead of 33 for field id";
+        ostr << "Record::Record: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x21 for field id";
 
         throw Exception(ostr.str());
       }
@@ -141,6 +150,11 @@ namespace Namespace1
         throw Exception(ostr.str());
       }
 
+      if(use_columns <= 1)
+      {
+        return;
+      }
+
       type = (*result)[1].type;
 
       if(type != 253)
@@ -153,13 +167,13 @@ namespace Namespace1
       }
 
       flags = 
-        (*result)[1].flags & (NOT_NULL_FLAG|UNSIGNED_FLAG|BINARY_FLAG);
+        (*result)[1].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
 
-      if(flags != 1)
+      if(flags != 0x1)
       {
         std::ostringstream ostr;
-        ostr << "Record::Record: unexpected flags " << flags
-             << " instead of 1 for field url";
+        ostr << "Record::Record: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x1 for field url";
 
         throw Exception(ostr.str());
       }
@@ -175,6 +189,11 @@ namespace Namespace1
         throw Exception(ostr.str());
       }
 
+      if(use_columns <= 2)
+      {
+        return;
+      }
+
       type = (*result)[2].type;
 
       if(type != 7)
@@ -187,13 +206,13 @@ namespace Namespace1
       }
 
       flags = 
-        (*result)[2].flags & (NOT_NULL_FLAG|UNSIGNED_FLAG|BINARY_FLAG);
+        (*result)[2].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
 
-      if(flags != 161)
+      if(flags != 0xa1)
       {
         std::ostringstream ostr;
-        ostr << "Record::Record: unexpected flags " << flags
-             << " instead of 161 for field created";
+        ostr << "Record::Record: unexpected flags 0x" << std::hex
+             << flags << " instead of 0xa1 for field created";
 
         throw Exception(ostr.str());
       }
@@ -209,6 +228,11 @@ namespace Namespace1
         throw Exception(ostr.str());
       }
 
+      if(use_columns <= 3)
+      {
+        return;
+      }
+
       type = (*result)[3].type;
 
       if(type != 254)
@@ -221,13 +245,13 @@ namespace Namespace1
       }
 
       flags = 
-        (*result)[3].flags & (NOT_NULL_FLAG|UNSIGNED_FLAG|BINARY_FLAG);
+        (*result)[3].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
 
-      if(flags != 1)
+      if(flags != 0x1)
       {
         std::ostringstream ostr;
-        ostr << "Record::Record: unexpected flags " << flags
-             << " instead of 1 for field creator_type";
+        ostr << "Record::Record: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x1 for field creator_type";
 
         throw Exception(ostr.str());
       }
@@ -243,6 +267,11 @@ namespace Namespace1
         throw Exception(ostr.str());
       }
 
+      if(use_columns <= 4)
+      {
+        return;
+      }
+
       type = (*result)[4].type;
 
       if(type != 253)
@@ -255,13 +284,13 @@ namespace Namespace1
       }
 
       flags = 
-        (*result)[4].flags & (NOT_NULL_FLAG|UNSIGNED_FLAG|BINARY_FLAG);
+        (*result)[4].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
 
-      if(flags != 1)
+      if(flags != 0x1)
       {
         std::ostringstream ostr;
-        ostr << "Record::Record: unexpected flags " << flags
-             << " instead of 1 for field creator_name";
+        ostr << "Record::Record: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x1 for field creator_name";
 
         throw Exception(ostr.str());
       }
@@ -277,6 +306,11 @@ namespace Namespace1
         throw Exception(ostr.str());
       }
 
+      if(use_columns <= 5)
+      {
+        return;
+      }
+
       type = (*result)[5].type;
 
       if(type != 5)
@@ -289,13 +323,13 @@ namespace Namespace1
       }
 
       flags = 
-        (*result)[5].flags & (NOT_NULL_FLAG|UNSIGNED_FLAG|BINARY_FLAG);
+        (*result)[5].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
 
-      if(flags != 1)
+      if(flags != 0x1)
       {
         std::ostringstream ostr;
-        ostr << "Record::Record: unexpected flags " << flags
-             << " instead of 1 for field activity";
+        ostr << "Record::Record: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x1 for field activity";
 
         throw Exception(ostr.str());
       }
@@ -311,6 +345,11 @@ namespace Namespace1
         throw Exception(ostr.str());
       }
 
+      if(use_columns <= 6)
+      {
+        return;
+      }
+
       type = (*result)[6].type;
 
       if(type != 4)
@@ -323,13 +362,13 @@ namespace Namespace1
       }
 
       flags = 
-        (*result)[6].flags & (NOT_NULL_FLAG|UNSIGNED_FLAG|BINARY_FLAG);
+        (*result)[6].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
 
-      if(flags != 0)
+      if(flags != 0x0)
       {
         std::ostringstream ostr;
-        ostr << "Record::Record: unexpected flags " << flags
-             << " instead of 0 for field density";
+        ostr << "Record::Record: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x0 for field density";
 
         throw Exception(ostr.str());
       }
@@ -345,6 +384,11 @@ namespace Namespace1
         throw Exception(ostr.str());
       }
 
+      if(use_columns <= 7)
+      {
+        return;
+      }
+
       type = (*result)[7].type;
 
       if(type != 246)
@@ -357,13 +401,13 @@ namespace Namespace1
       }
 
       flags = 
-        (*result)[7].flags & (NOT_NULL_FLAG|UNSIGNED_FLAG|BINARY_FLAG);
+        (*result)[7].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
 
-      if(flags != 0)
+      if(flags != 0x0)
       {
         std::ostringstream ostr;
-        ostr << "Record::Record: unexpected flags " << flags
-             << " instead of 0 for field rate";
+        ostr << "Record::Record: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x0 for field rate";
 
         throw Exception(ostr.str());
       }
@@ -379,6 +423,11 @@ namespace Namespace1
         throw Exception(ostr.str());
       }
 
+      if(use_columns <= 8)
+      {
+        return;
+      }
+
       type = (*result)[8].type;
 
       if(type != 16)
@@ -391,13 +440,13 @@ namespace Namespace1
       }
 
       flags = 
-        (*result)[8].flags & (NOT_NULL_FLAG|UNSIGNED_FLAG|BINARY_FLAG);
+        (*result)[8].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
 
-      if(flags != 0)
+      if(flags != 0x20)
       {
         std::ostringstream ostr;
-        ostr << "Record::Record: unexpected flags " << flags
-             << " instead of 0 for field flags";
+        ostr << "Record::Record: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x20 for field flags";
 
         throw Exception(ostr.str());
       }
@@ -413,6 +462,11 @@ namespace Namespace1
         throw Exception(ostr.str());
       }
 
+      if(use_columns <= 9)
+      {
+        return;
+      }
+
       type = (*result)[9].type;
 
       if(type != 13)
@@ -425,13 +479,13 @@ namespace Namespace1
       }
 
       flags = 
-        (*result)[9].flags & (NOT_NULL_FLAG|UNSIGNED_FLAG|BINARY_FLAG);
+        (*result)[9].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
 
-      if(flags != 32)
+      if(flags != 0x20)
       {
         std::ostringstream ostr;
-        ostr << "Record::Record: unexpected flags " << flags
-             << " instead of 32 for field start_year";
+        ostr << "Record::Record: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x20 for field start_year";
 
         throw Exception(ostr.str());
       }
@@ -447,6 +501,11 @@ namespace Namespace1
         throw Exception(ostr.str());
       }
 
+      if(use_columns <= 10)
+      {
+        return;
+      }
+
       type = (*result)[10].type;
 
       if(type != 12)
@@ -459,13 +518,13 @@ namespace Namespace1
       }
 
       flags = 
-        (*result)[10].flags & (NOT_NULL_FLAG|UNSIGNED_FLAG|BINARY_FLAG);
+        (*result)[10].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
 
-      if(flags != 128)
+      if(flags != 0x80)
       {
         std::ostringstream ostr;
-        ostr << "Record::Record: unexpected flags " << flags
-             << " instead of 128 for field timeX";
+        ostr << "Record::Record: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x80 for field timeX";
 
         throw Exception(ostr.str());
       }
@@ -481,6 +540,11 @@ namespace Namespace1
         throw Exception(ostr.str());
       }
 
+      if(use_columns <= 11)
+      {
+        return;
+      }
+
       type = (*result)[11].type;
 
       if(type != 254)
@@ -493,13 +557,13 @@ namespace Namespace1
       }
 
       flags = 
-        (*result)[11].flags & (NOT_NULL_FLAG|UNSIGNED_FLAG|BINARY_FLAG);
+        (*result)[11].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
 
-      if(flags != 0)
+      if(flags != 0x0)
       {
         std::ostringstream ostr;
-        ostr << "Record::Record: unexpected flags " << flags
-             << " instead of 0 for field rgb";
+        ostr << "Record::Record: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x0 for field rgb";
 
         throw Exception(ostr.str());
       }
@@ -515,6 +579,11 @@ namespace Namespace1
         throw Exception(ostr.str());
       }
 
+      if(use_columns <= 12)
+      {
+        return;
+      }
+
       type = (*result)[12].type;
 
       if(type != 252)
@@ -527,13 +596,13 @@ namespace Namespace1
       }
 
       flags = 
-        (*result)[12].flags & (NOT_NULL_FLAG|UNSIGNED_FLAG|BINARY_FLAG);
+        (*result)[12].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
 
-      if(flags != 0)
+      if(flags != 0x0)
       {
         std::ostringstream ostr;
-        ostr << "Record::Record: unexpected flags " << flags
-             << " instead of 0 for field comment";
+        ostr << "Record::Record: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x0 for field comment";
 
         throw Exception(ostr.str());
       }
@@ -556,6 +625,8 @@ namespace Namespace1
     Record::id() const
       throw(Exception, El::Exception)
     {
+      El::MySQL::DB::init_thread();
+
       if(row_ == 0)
       {
         throw Exception("Record::id: row_ is 0");
@@ -600,6 +671,8 @@ namespace Namespace1
     Record::url() const
       throw(Exception, El::Exception)
     {
+      El::MySQL::DB::init_thread();
+
       if(row_ == 0)
       {
         throw Exception("Record::url: row_ is 0");
@@ -631,6 +704,8 @@ namespace Namespace1
     Record::created() const
       throw(Exception, El::Exception)
     {
+      El::MySQL::DB::init_thread();
+
       if(row_ == 0)
       {
         throw Exception("Record::created: row_ is 0");
@@ -662,6 +737,8 @@ namespace Namespace1
     Record::creator_type() const
       throw(Exception, El::Exception)
     {
+      El::MySQL::DB::init_thread();
+
       if(row_ == 0)
       {
         throw Exception("Record::creator_type: row_ is 0");
@@ -693,6 +770,8 @@ namespace Namespace1
     Record::creator_name() const
       throw(Exception, El::Exception)
     {
+      El::MySQL::DB::init_thread();
+
       if(row_ == 0)
       {
         throw Exception("Record::creator_name: row_ is 0");
@@ -724,6 +803,8 @@ namespace Namespace1
     Record::activity() const
       throw(Exception, El::Exception)
     {
+      El::MySQL::DB::init_thread();
+
       if(row_ == 0)
       {
         throw Exception("Record::activity: row_ is 0");
@@ -768,6 +849,8 @@ namespace Namespace1
     Record::density() const
       throw(Exception, El::Exception)
     {
+      El::MySQL::DB::init_thread();
+
       if(row_ == 0)
       {
         throw Exception("Record::density: row_ is 0");
@@ -812,6 +895,8 @@ namespace Namespace1
     Record::rate() const
       throw(Exception, El::Exception)
     {
+      El::MySQL::DB::init_thread();
+
       if(row_ == 0)
       {
         throw Exception("Record::rate: row_ is 0");
@@ -856,6 +941,8 @@ namespace Namespace1
     Record::flags() const
       throw(Exception, El::Exception)
     {
+      El::MySQL::DB::init_thread();
+
       if(row_ == 0)
       {
         throw Exception("Record::flags: row_ is 0");
@@ -870,7 +957,7 @@ namespace Namespace1
         throw Exception(ostr.str());
       }
 
-      unsigned char value = 0;
+      unsigned short value = 0;
       bool is_null = row_[8] == 0;
 
       if(!is_null)
@@ -886,7 +973,7 @@ namespace Namespace1
         {
           std::ostringstream ostr;
           ostr << "Record::flags: failed to convert 'flags' field data"
-            " to unsigned char";
+            " to unsigned short";
 
           throw Exception(ostr.str());
         }
@@ -900,6 +987,8 @@ namespace Namespace1
     Record::start_year() const
       throw(Exception, El::Exception)
     {
+      El::MySQL::DB::init_thread();
+
       if(row_ == 0)
       {
         throw Exception("Record::start_year: row_ is 0");
@@ -944,6 +1033,8 @@ namespace Namespace1
     Record::timeX() const
       throw(Exception, El::Exception)
     {
+      El::MySQL::DB::init_thread();
+
       if(row_ == 0)
       {
         throw Exception("Record::timeX: row_ is 0");
@@ -975,6 +1066,8 @@ namespace Namespace1
     Record::rgb() const
       throw(Exception, El::Exception)
     {
+      El::MySQL::DB::init_thread();
+
       if(row_ == 0)
       {
         throw Exception("Record::rgb: row_ is 0");
@@ -1006,6 +1099,8 @@ namespace Namespace1
     Record::comment() const
       throw(Exception, El::Exception)
     {
+      El::MySQL::DB::init_thread();
+
       if(row_ == 0)
       {
         throw Exception("Record::comment: row_ is 0");
@@ -1032,47 +1127,90 @@ namespace Namespace1
       return tmp;
     }
 
-  }
-}
-
-namespace Namespace1
-{
-  namespace Namespace2
-  {
 //
-// Record2 class declaration
+// RecordView class declaration
 //
-    class Record2: public El::MySQL::Row
+    class RecordView: public El::MySQL::RowView
     {
     public:
-      EL_EXCEPTION(Exception, El::MySQL::Exception);
-      EL_EXCEPTION(IsNull, Exception);
-
-    public:
-      Record2(El::MySQL::Result*)
+      RecordView(El::MySQL::Result* result)
         throw(Exception, El::Exception);
 
-      El::MySQL::UnsignedLongLong id() const
-       throw(Exception, El::Exception);
+      uint64_t id() const
+        throw(El::MySQL::IsNull, Exception, El::Exception);
 
-      El::MySQL::String url() const
-       throw(Exception, El::Exception);
+      El::MySQL::StringView url() const
+        throw(Exception);
+
+      El::Moment created() const
+        throw(El::MySQL::IsNull, Exception, El::Exception);
+
+      El::MySQL::StringView creator_type() const
+        throw(Exception);
+
+      El::MySQL::StringView creator_name() const
+        throw(Exception);
+
+      double activity() const
+        throw(El::MySQL::IsNull, Exception, El::Exception);
+
+      float density() const
+        throw(El::MySQL::IsNull, Exception, El::Exception);
+
+      bool density_is_null() const
+        throw(Exception);
+
+      double rate() const
+        throw(El::MySQL::IsNull, Exception, El::Exception);
+
+      bool rate_is_null() const
+        throw(Exception);
+
+      uint64_t flags() const
+        throw(El::MySQL::IsNull, Exception, El::Exception);
+
+      bool flags_is_null() const
+        throw(Exception);
+
+      uint16_t start_year() const
+        throw(El::MySQL::IsNull, Exception, El::Exception);
+
+      bool start_year_is_null() const
+        throw(Exception);
+
+      El::Moment timeX() const
+        throw(El::MySQL::IsNull, Exception, El::Exception);
+
+      bool timeX_is_null() const
+        throw(Exception);
+
+      El::MySQL::StringView rgb() const
+        throw(Exception);
+
+      bool rgb_is_null() const
+        throw(Exception);
+
+      El::MySQL::StringView comment() const
+        throw(Exception);
+
+      bool comment_is_null() const
+        throw(Exception);
 
     };
 
 //
-// Record2 class definition
+// RecordView class definition
 //
     inline
-    Record2::Record2(El::MySQL::Result* result)
+    RecordView::RecordView(El::MySQL::Result* result)
       throw(Exception, El::Exception)
-        : Row(result)
+        : El::MySQL::RowView(result)
     {
-      if(result->num_fields() != 2)
+      if(result->num_fields() != 13)
       {
         std::ostringstream ostr;
-        ostr << "Record2::Record2: unexpected number of fields "
-             << result->num_fields() << " instead of 2";
+        ostr << "RecordView::RecordView: unexpected number of fields "
+             << result->num_fields() << " instead of 13";
 
         throw Exception(ostr.str());
       }
@@ -1082,20 +1220,20 @@ namespace Namespace1
       if(type != 8)
       {
         std::ostringstream ostr;
-        ostr << "Record2::Record2: unexpected type " << type
+        ostr << "RecordView::RecordView: unexpected type " << type
              << " instead of 8 for field id";
 
         throw Exception(ostr.str());
       }
 
       unsigned int flags = 
-        (*result)[0].flags & (NOT_NULL_FLAG|UNSIGNED_FLAG|BINARY_FLAG);
+        (*result)[0].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
 
-      if(flags != 33)
+      if(flags != 0x21)
       {
         std::ostringstream ostr;
-        ostr << "Record2::Record2: unexpected flags " << flags
-             << " instead of 33 for field id";
+        ostr << "RecordView::RecordView: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x21 for field id";
 
         throw Exception(ostr.str());
       }
@@ -1105,7 +1243,7 @@ namespace Namespace1
       if(strcmp(name, "id"))
       {
         std::ostringstream ostr;
-        ostr << "Record2::Record2: unexpected name " << name
+        ostr << "RecordView::RecordView: unexpected name " << name
              << " instead of id for field id";
 
         throw Exception(ostr.str());
@@ -1116,20 +1254,20 @@ namespace Namespace1
       if(type != 253)
       {
         std::ostringstream ostr;
-        ostr << "Record2::Record2: unexpected type " << type
+        ostr << "RecordView::RecordView: unexpected type " << type
              << " instead of 253 for field url";
 
         throw Exception(ostr.str());
       }
 
       flags = 
-        (*result)[1].flags & (NOT_NULL_FLAG|UNSIGNED_FLAG|BINARY_FLAG);
+        (*result)[1].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
 
-      if(flags != 1)
+      if(flags != 0x1)
       {
         std::ostringstream ostr;
-        ostr << "Record2::Record2: unexpected flags " << flags
-             << " instead of 1 for field url";
+        ostr << "RecordView::RecordView: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x1 for field url";
 
         throw Exception(ostr.str());
       }
@@ -1139,63 +1277,854 @@ namespace Namespace1
       if(strcmp(name, "url"))
       {
         std::ostringstream ostr;
-        ostr << "Record2::Record2: unexpected name " << name
+        ostr << "RecordView::RecordView: unexpected name " << name
              << " instead of url for field url";
 
         throw Exception(ostr.str());
       }
 
-    }
+      type = (*result)[2].type;
 
-    inline
-    El::MySQL::UnsignedLongLong
-    Record2::id() const
-      throw(Exception, El::Exception)
-    {
-      if(row_ == 0)
+      if(type != 7)
       {
-        throw Exception("Record2::id: row_ is 0");
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected type " << type
+             << " instead of 7 for field created";
+
+        throw Exception(ostr.str());
       }
 
-      if(0 >= result_->num_fields())
+      flags = 
+        (*result)[2].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
+
+      if(flags != 0xa1)
       {
         std::ostringstream ostr;
-        ostr << "Record2::id: unexpected index 0 when number of fileds is "
-             << result_->num_fields();
+        ostr << "RecordView::RecordView: unexpected flags 0x" << std::hex
+             << flags << " instead of 0xa1 for field created";
 
         throw Exception(ostr.str());
       }
 
-      unsigned long long value = 0;
-      bool is_null = row_[0] == 0;
+      name = (*result)[2].name;
 
-      if(!is_null)
+      if(strcmp(name, "created"))
       {
-        unsigned long* lengths = mysql_fetch_lengths(result_->mysql_res());
-        std::string tmp;
-        tmp.assign(row_[0], lengths[0]);
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected name " << name
+             << " instead of created for field created";
 
-        std::istringstream istr(tmp);
-        istr >> value;
+        throw Exception(ostr.str());
+      }
 
-        if(istr.fail())
-        {
-          std::ostringstream ostr;
-          ostr << "Record2::id: failed to convert 'id' field data"
-            " to unsigned long long";
+      type = (*result)[3].type;
 
-          throw Exception(ostr.str());
-        }
+      if(type != 254)
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected type " << type
+             << " instead of 254 for field creator_type";
+
+        throw Exception(ostr.str());
       }
 
-      return El::MySQL::UnsignedLongLong(is_null, value);
-    }
+      flags = 
+        (*result)[3].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
+
+      if(flags != 0x1)
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x1 for field creator_type";
+
+        throw Exception(ostr.str());
+      }
+
+      name = (*result)[3].name;
+
+      if(strcmp(name, "creator_type"))
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected name " << name
+             << " instead of creator_type for field creator_type";
+
+        throw Exception(ostr.str());
+      }
+
+      type = (*result)[4].type;
+
+      if(type != 253)
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected type " << type
+             << " instead of 253 for field creator_name";
+
+        throw Exception(ostr.str());
+      }
+
+      flags = 
+        (*result)[4].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
+
+      if(flags != 0x1)
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x1 for field creator_name";
+
+        throw Exception(ostr.str());
+      }
+
+      name = (*result)[4].name;
+
+      if(strcmp(name, "creator_name"))
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected name " << name
+             << " instead of creator_name for field creator_name";
+
+        throw Exception(ostr.str());
+      }
+
+      type = (*result)[5].type;
+
+      if(type != 5)
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected type " << type
+             << " instead of 5 for field activity";
+
+        throw Exception(ostr.str());
+      }
+
+      flags = 
+        (*result)[5].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
+
+      if(flags != 0x1)
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x1 for field activity";
+
+        throw Exception(ostr.str());
+      }
+
+      name = (*result)[5].name;
+
+      if(strcmp(name, "activity"))
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected name " << name
+             << " instead of activity for field activity";
+
+        throw Exception(ostr.str());
+      }
+
+      type = (*result)[6].type;
+
+      if(type != 4)
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected type " << type
+             << " instead of 4 for field density";
+
+        throw Exception(ostr.str());
+      }
+
+      flags = 
+        (*result)[6].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
+
+      if(flags != 0x0)
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x0 for field density";
+
+        throw Exception(ostr.str());
+      }
+
+      name = (*result)[6].name;
+
+      if(strcmp(name, "density"))
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected name " << name
+             << " instead of density for field density";
+
+        throw Exception(ostr.str());
+      }
+
+      type = (*result)[7].type;
+
+      if(type != 246)
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected type " << type
+             << " instead of 246 for field rate";
+
+        throw Exception(ostr.str());
+      }
+
+      flags = 
+        (*result)[7].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
+
+      if(flags != 0x0)
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x0 for field rate";
+
+        throw Exception(ostr.str());
+      }
+
+      name = (*result)[7].name;
+
+      if(strcmp(name, "rate"))
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected name " << name
+             << " instead of rate for field rate";
+
+        throw Exception(ostr.str());
+      }
+
+      type = (*result)[8].type;
+
+      if(type != 16)
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected type " << type
+             << " instead of 16 for field flags";
+
+        throw Exception(ostr.str());
+      }
+
+      flags = 
+        (*result)[8].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
+
+      if(flags != 0x20)
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x20 for field flags";
+
+        throw Exception(ostr.str());
+      }
+
+      name = (*result)[8].name;
+
+      if(strcmp(name, "flags"))
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected name " << name
+             << " instead of flags for field flags";
+
+        throw Exception(ostr.str());
+      }
+
+      type = (*result)[9].type;
+
+      if(type != 13)
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected type " << type
+             << " instead of 13 for field start_year";
+
+        throw Exception(ostr.str());
+      }
+
+      flags = 
+        (*result)[9].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
+
+      if(flags != 0x20)
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x20 for field start_year";
+
+        throw Exception(ostr.str());
+      }
+
+      name = (*result)[9].name;
+
+      if(strcmp(name, "start_year"))
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected name " << name
+             << " instead of start_year for field start_year";
+
+        throw Exception(ostr.str());
+      }
+
+      type = (*result)[10].type;
+
+      if(type != 12)
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected type " << type
+             << " instead of 12 for field timeX";
+
+        throw Exception(ostr.str());
+      }
+
+      flags = 
+        (*result)[10].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
+
+      if(flags != 0x80)
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x80 for field timeX";
+
+        throw Exception(ostr.str());
+      }
+
+      name = (*result)[10].name;
+
+      if(strcmp(name, "timeX"))
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected name " << name
+             << " instead of timeX for field timeX";
+
+        throw Exception(ostr.str());
+      }
+
+      type = (*result)[11].type;
+
+      if(type != 254)
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected type " << type
+             << " instead of 254 for field rgb";
+
+        throw Exception(ostr.str());
+      }
+
+      flags = 
+        (*result)[11].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
+
+      if(flags != 0x0)
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x0 for field rgb";
+
+        throw Exception(ostr.str());
+      }
+
+      name = (*result)[11].name;
+
+      if(strcmp(name, "rgb"))
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected name " << name
+             << " instead of rgb for field rgb";
+
+        throw Exception(ostr.str());
+      }
+
+      type = (*result)[12].type;
+
+      if(type != 252)
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected type " << type
+             << " instead of 252 for field comment";
+
+        throw Exception(ostr.str());
+      }
+
+      flags = 
+        (*result)[12].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
+
+      if(flags != 0x0)
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x0 for field comment";
+
+        throw Exception(ostr.str());
+      }
+
+      name = (*result)[12].name;
+
+      if(strcmp(name, "comment"))
+      {
+        std::ostringstream ostr;
+        ostr << "RecordView::RecordView: unexpected name " << name
+             << " instead of comment for field comment";
+
+        throw Exception(ostr.str());
+      }
+
+    }
+
+    inline
+    uint64_t
+    RecordView::id() const
+      throw(El::MySQL::IsNull, Exception, El::Exception)
+    {
+      return integer<uint64_t>(0, "id");
+    }
+
+    inline
+    El::MySQL::StringView
+    RecordView::url() const
+      throw(Exception)
+    {
+      return string(1);
+    }
+
+    inline
+    El::Moment
+    RecordView::created() const
+      throw(El::MySQL::IsNull, Exception, El::Exception)
+    {
+      return moment(2, "created");
+    }
+
+    inline
+    El::MySQL::StringView
+    RecordView::creator_type() const
+      throw(Exception)
+    {
+      return string(3);
+    }
+
+    inline
+    El::MySQL::StringView
+    RecordView::creator_name() const
+      throw(Exception)
+    {
+      return string(4);
+    }
+
+    inline
+    double
+    RecordView::activity() const
+      throw(El::MySQL::IsNull, Exception, El::Exception)
+    {
+      return floating(5, "activity");
+    }
+
+    inline
+    float
+    RecordView::density() const
+      throw(El::MySQL::IsNull, Exception, El::Exception)
+    {
+      return floating(6, "density");
+    }
+
+    inline
+    bool
+    RecordView::density_is_null() const
+      throw(Exception)
+    {
+      return is_null(6);
+    }
+
+    inline
+    double
+    RecordView::rate() const
+      throw(El::MySQL::IsNull, Exception, El::Exception)
+    {
+      return floating(7, "rate");
+    }
+
+    inline
+    bool
+    RecordView::rate_is_null() const
+      throw(Exception)
+    {
+      return is_null(7);
+    }
+
+    inline
+    uint64_t
+    RecordView::flags() const
+      throw(El::MySQL::IsNull, Exception, El::Exception)
+    {
+      return bit(8, "flags");
+    }
+
+    inline
+    bool
+    RecordView::flags_is_null() const
+      throw(Exception)
+    {
+      return is_null(8);
+    }
+
+    inline
+    uint16_t
+    RecordView::start_year() const
+      throw(El::MySQL::IsNull, Exception, El::Exception)
+    {
+      return integer<uint16_t>(9, "start_year");
+    }
+
+    inline
+    bool
+    RecordView::start_year_is_null() const
+      throw(Exception)
+    {
+      return is_null(9);
+    }
+
+    inline
+    El::Moment
+    RecordView::timeX() const
+      throw(El::MySQL::IsNull, Exception, El::Exception)
+    {
+      return moment(10, "timeX");
+    }
+
+    inline
+    bool
+    RecordView::timeX_is_null() const
+      throw(Exception)
+    {
+      return is_null(10);
+    }
+
+    inline
+    El::MySQL::StringView
+    RecordView::rgb() const
+      throw(Exception)
+    {
+      return string(11);
+    }
+
+    inline
+    bool
+    RecordView::rgb_is_null() const
+      throw(Exception)
+    {
+      return is_null(11);
+    }
+
+    inline
+    El::MySQL::StringView
+    RecordView::comment() const
+      throw(Exception)
+    {
+      return string(12);
+    }
+
+    inline
+    bool
+    RecordView::comment_is_null() const
+      throw(Exception)
+    {
+      return is_null(12);
+    }
+
+//
+// RecordInsert class declaration
+//
+    class RecordInsert: public El::MySQL::InsertBuilder
+    {
+    public:
+      RecordInsert(El::MySQL::Connection* connection,
+                   size_t capacity = 1024 * 1024)
+        throw(Exception, El::Exception);
+
+      void add(const El::MySQL::StringView& url,
+               const El::Moment& created,
+               const El::MySQL::StringView& creator_type,
+               const El::MySQL::StringView& creator_name,
+               double activity,
+               const float* density,
+               const double* rate,
+               const uint64_t* flags,
+               const uint16_t* start_year,
+               const El::Moment* timeX,
+               const El::MySQL::StringView& rgb,
+               const El::MySQL::StringView& comment)
+        throw(Exception, El::Exception);
+    };
+
+//
+// RecordInsert class definition
+//
+    inline
+    RecordInsert::RecordInsert(El::MySQL::Connection* connection,
+                               size_t capacity)
+      throw(Exception, El::Exception)
+        : El::MySQL::InsertBuilder(
+            connection,
+            "INSERT INTO `AllTypes` ("
+            "`url`,`created`,`creator_type`,`creator_name`,`activity`,"
+            "`density`,`rate`,`flags`,`start_year`,`timeX`,`rgb`,"
+            "`comment`"
+            ") VALUES ",
+            capacity)
+    {
+    }
+
+    inline
+    void
+    RecordInsert::add(const El::MySQL::StringView& url,
+                       const El::Moment& created,
+                       const El::MySQL::StringView& creator_type,
+                       const El::MySQL::StringView& creator_name,
+                       double activity,
+                       const float* density,
+                       const double* rate,
+                       const uint64_t* flags,
+                       const uint16_t* start_year,
+                       const El::Moment* timeX,
+                       const El::MySQL::StringView& rgb,
+                       const El::MySQL::StringView& comment)
+      throw(Exception, El::Exception)
+    {
+      begin_row();
+
+      try
+      {
+        add_string(url);
+        add_moment(created);
+        add_string(creator_type);
+        add_string(creator_name);
+        add_double(activity);
+
+        if(density)
+        {
+          add_double(*density);
+        }
+        else
+        {
+          add_null();
+        }
+
+        if(rate)
+        {
+          add_double(*rate);
+        }
+        else
+        {
+          add_null();
+        }
+
+        if(flags)
+        {
+          add_unsigned(*flags);
+        }
+        else
+        {
+          add_null();
+        }
+
+        if(start_year)
+        {
+          add_unsigned(*start_year);
+        }
+        else
+        {
+          add_null();
+        }
+
+        if(timeX)
+        {
+          add_moment(*timeX);
+        }
+        else
+        {
+          add_null();
+        }
+
+        add_string(rgb);
+        add_string(comment);
+
+        end_row();
+      }
+      catch(...)
+      {
+        cancel_row();
+        throw;
+      }
+    }
+
+  }
+}
+
+namespace Namespace1
+{
+  namespace Namespace2
+  {
+//
+// Record2 class declaration
+//
+    class Record2: public El::MySQL::Row
+    {
+    public:
+      EL_EXCEPTION(Exception, El::MySQL::Exception);
+      EL_EXCEPTION(IsNull, Exception);
+
+    public:
+      Record2(El::MySQL::Result* result, unsigned long use_columns = ULONG_MAX)
+        throw(Exception, El::Exception);
+
+      El::MySQL::UnsignedLongLong id() const
+       throw(Exception, El::Exception);
+
+      El::MySQL::String url() const
+       throw(Exception, El::Exception);
+
+    };
+
+//
+// Record2 class definition
+//
+    inline
+    Record2::Record2(El::MySQL::Result* result, unsigned long use_columns)
+      throw(Exception, El::Exception)
+        : Row(result)
+    {
+      unsigned long num_columns = std::min(use_columns, (unsigned long)2);
+
+      if(result->num_fields() != num_columns)
+      {
+        std::ostringstream ostr;
+        ostr << "Record2::Record2: unexpected number of fields "
+             << result->num_fields() << " instead of " << num_columns;
+
+        throw Exception(ostr.str());
+      }
+
+      if(use_columns <= 0)
+      {
+        return;
+      }
+
+      enum_field_types type = (*result)[0].type;
+
+      if(type != 8)
+      {
+        std::ostringstream ostr;
+        ostr << "Record2::Record2: unexpected type " << type
+             << " instead of 8 for field id";
+
+        throw Exception(ostr.str());
+      }
+
+      unsigned int flags = 
+        (*result)[0].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
+
+      if(flags != 0x21)
+      {
+        std::ostringstream ostr;
+        ostr << "Record2::Record2: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x21 for field id";
+
+        throw Exception(ostr.str());
+      }
+
+      const char* name = (*result)[0].name;
+
+      if(strcmp(name, "id"))
+      {
+        std::ostringstream ostr;
+        ostr << "Record2::Record2: unexpected name " << name
+             << " instead of id for field id";
+
+        throw Exception(ostr.str());
+      }
+
+      if(use_columns <= 1)
+      {
+        return;
+      }
+
+      type = (*result)[1].type;
+
+      if(type != 253)
+      {
+        std::ostringstream ostr;
+        ostr << "Record2::Record2: unexpected type " << type
+             << " instead of 253 for field url";
+
+        throw Exception(ostr.str());
+      }
+
+      flags = 
+        (*result)[1].flags & (UNSIGNED_FLAG|NOT_NULL_FLAG|BINARY_FLAG);
+
+      if(flags != 0x1)
+      {
+        std::ostringstream ostr;
+        ostr << "Record2::Record2: unexpected flags 0x" << std::hex
+             << flags << " instead of 0x1 for field url";
+
+        throw Exception(ostr.str());
+      }
+
+      name = (*result)[1].name;
+
+      if(strcmp(name, "url"))
+      {
+        std::ostringstream ostr;
+        ostr << "Record2::Record2: unexpected name " << name
+             << " instead of url for field url";
+
+        throw Exception(ostr.str());
+      }
+
+    }
+
+    inline
+    El::MySQL::UnsignedLongLong
+    Record2::id() const
+      throw(Exception, El::Exception)
+    {
+      El::MySQL::DB::init_thread();
+
+      if(row_ == 0)
+      {
+        throw Exception("Record2::id: row_ is 0");
+      }
+
+      if(0 >= result_->num_fields())
+      {
+        std::ostringstream ostr;
+        ostr << "Record2::id: unexpected index 0 when number of fileds is "
+             << result_->num_fields();
+
+        throw Exception(ostr.str());
+      }
+
+      unsigned long long value = 0;
+      bool is_null = row_[0] == 0;
+
+      if(!is_null)
+      {
+        unsigned long* lengths = mysql_fetch_lengths(result_->mysql_res());
+        std::string tmp;
+        tmp.assign(row_[0], lengths[0]);
+
+        std::istringstream istr(tmp);
+        istr >> value;
+
+        if(istr.fail())
+        {
+          std::ostringstream ostr;
+          ostr << "Record2::id: failed to convert 'id' field data"
+            " to unsigned long long";
+
+          throw Exception(ostr.str());
+        }
+      }
+
+      return El::MySQL::UnsignedLongLong(is_null, value);
+    }
+
+    inline
+    El::MySQL::String
+    Record2::url() const
+      throw(Exception, El::Exception)
+    {
+      El::MySQL::DB::init_thread();
 
-    inline
-    El::MySQL::String
-    Record2::url() const
-      throw(Exception, El::Exception)
-    {
       if(row_ == 0)
       {
         throw Exception("Record2::url: row_ is 0");
@@ -1225,4 +2154,4 @@ namespace Namespace1
   }
 }
 
-#endif // _NAMESPACE1_NAMESPACE2_RECORD__429145051_
+#endif // _NAMESPACE1_NAMESPACE2_RECORD__1661968815_
@@ -118,6 +118,24 @@ Application::help(const ArgList& arguments)
 int
 Application::test(const ArgList& arguments)
   throw(InvalidArg, Exception, El::Exception)
+{
+  int result = test_pool(false, El::Service::ProcessPool::RecyclePolicy());
+
+  std::cerr << "Testing zygote mode ...\n";
+
+  // Recycling workers frequently to exercise forking from zygote
+  int zygote_result =
+    test_pool(true,
+              El::Service::ProcessPool::RecyclePolicy(3, 1024 * 1024 * 100));
+  
+  return result ? result : zygote_result;
+}
+
+int
+Application::test_pool(
+  bool zygote,
+  const El::Service::ProcessPool::RecyclePolicy& recycle_policy)
+  throw(InvalidArg, Exception, El::Exception)
 {
   typedef std::vector<DoublingTask_var> DoublingTaskArray;
 
@@ -133,7 +151,10 @@ Application::test(const ArgList& arguments)
                                  10,
                                  300,
                                  1024 * 20,
-                                 30));
+                                 30,
+                                 El::Service::ProcessPool::TaskQueue::ES_BACK,
+                                 zygote,
+                                 recycle_policy));
 
   DoublingTask_var task;
   
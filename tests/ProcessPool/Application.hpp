@@ -59,6 +59,10 @@ private:
 
   int test(const ArgList& arguments)
     throw(InvalidArg, Exception, El::Exception);
+
+  int test_pool(bool zygote,
+                const El::Service::ProcessPool::RecyclePolicy& recycle_policy)
+    throw(InvalidArg, Exception, El::Exception);
 };
   
 ///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,619 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file   PythonMapMain.cpp
+ * @author Karen Arutyunov
+ * $Id:$
+ */
+
+#include <Python.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iostream>
+
+#include <ace/OS.h>
+
+#include <El/Exception.hpp>
+#include <El/BinaryStream.hpp>
+
+#include <El/Python/Utility.hpp>
+#include <El/Python/RefCount.hpp>
+#include <El/Python/Map.hpp>
+#include <El/Python/HashMap.hpp>
+
+namespace
+{
+  const char USAGE[] =
+    "Usage: ElTestPythonMap [--entries=<entry count>] "
+    "[--iterations=<iteration count>]";
+
+  typedef std::vector<El::Python::Object_var> ObjectArray;
+
+  double
+  seconds(const ACE_Time_Value& tm) throw()
+  {
+    return tm.sec() + (double)tm.usec() / 1000000;
+  }
+}
+
+class Application
+{
+public:
+  EL_EXCEPTION(Exception, El::ExceptionBase);
+
+public:
+  Application() throw() {}
+  virtual ~Application() throw() {}
+
+  int run(int& argc, char** argv) throw();
+
+private:
+  void check_operations() throw(Exception, El::Exception);
+  void check_protocol() throw(Exception, El::Exception);
+  void check_serialization() throw(Exception, El::Exception);
+  void check_mutating_keys() throw(Exception, El::Exception);
+
+  static void check_value(const El::Python::HashMap& map,
+                          PyObject* key,
+                          long expected,
+                          const char* context)
+    throw(Exception, El::Exception);
+
+  // String keys like PSP code passes, or integer ones
+  static void make_keys(ObjectArray& keys, size_t count, bool strings)
+    throw(Exception, El::Exception);
+
+  void bench(size_t entries, size_t iterations, bool string_keys)
+    throw(Exception, El::Exception);
+};
+
+int
+main(int argc, char** argv)
+{
+  El::Python::Use use;
+
+  Application app;
+  return app.run(argc, argv);
+}
+
+int
+Application::run(int& argc, char** argv) throw()
+{
+  try
+  {
+    size_t entries = 10000;
+    size_t iterations = 10;
+
+    for(int i = 1; i < argc; i++)
+    {
+      const char* arg = argv[i];
+
+      if(!strncmp(arg, "--entries=", 10))
+      {
+        entries = atol(arg + 10);
+      }
+      else if(!strncmp(arg, "--iterations=", 13))
+      {
+        iterations = atol(arg + 13);
+      }
+      else
+      {
+        std::ostringstream ostr;
+        ostr << "Unexpected argument '" << arg << "'\n" << USAGE;
+        throw Exception(ostr.str());
+      }
+    }
+
+    check_operations();
+    check_protocol();
+    check_serialization();
+    check_mutating_keys();
+
+    if(entries && iterations)
+    {
+      bench(entries, iterations, true);
+      bench(entries, iterations, false);
+    }
+
+    return 0;
+  }
+  catch(const El::Exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+  }
+  catch(...)
+  {
+    std::cerr << "unknown exception caught.\n";
+  }
+
+  return -1;
+}
+
+void
+Application::check_value(const El::Python::HashMap& map,
+                         PyObject* key,
+                         long expected,
+                         const char* context)
+  throw(Exception, El::Exception)
+{
+  PyObject* value = map.find(key);
+
+  if(expected < 0 ? value != 0 :
+     value == 0 || PyInt_AsLong(value) != expected)
+  {
+    std::ostringstream ostr;
+    ostr << "Application::" << context << ": unexpected value of ";
+    El::Python::print(ostr, key);
+    ostr << ": ";
+
+    if(value)
+    {
+      El::Python::print(ostr, value);
+    }
+    else
+    {
+      ostr << "<none>";
+    }
+
+    ostr << " instead of " << expected;
+
+    throw Exception(ostr.str());
+  }
+}
+
+void
+Application::make_keys(ObjectArray& keys, size_t count, bool strings)
+  throw(Exception, El::Exception)
+{
+  keys.resize(count);
+
+  for(size_t i = 0; i < count; ++i)
+  {
+    if(strings)
+    {
+      std::ostringstream ostr;
+      ostr << "key_" << i * 7919;
+      keys[i] = PyString_FromString(ostr.str().c_str());
+    }
+    else
+    {
+      keys[i] = PyInt_FromLong(i * 7919);
+    }
+  }
+}
+
+void
+Application::check_operations() throw(Exception, El::Exception)
+{
+  El::Python::HashMap_var map = new El::Python::HashMap();
+
+  ObjectArray keys;
+  make_keys(keys, 1000, true);
+
+  for(size_t i = 0; i < keys.size(); ++i)
+  {
+    El::Python::Object_var value = PyInt_FromLong(i);
+    map->insert(keys[i].in(), value.in());
+  }
+
+  // Equal but not same objects
+  for(size_t i = 0; i < keys.size(); ++i)
+  {
+    El::Python::Object_var key =
+      PyString_FromString(PyString_AS_STRING(keys[i].in()));
+
+    check_value(*map, key.in(), i, "check_operations");
+  }
+
+  El::Python::Object_var absent = PyString_FromString("absent");
+  check_value(*map, absent.in(), -1, "check_operations");
+
+  // Erase every other, so erased entries are left in between
+  for(size_t i = 0; i < keys.size(); i += 2)
+  {
+    if(!map->erase(keys[i].in()))
+    {
+      throw Exception("Application::check_operations: erase failed");
+    }
+  }
+
+  if(map->erase(keys[0].in()) || map->size() != keys.size() / 2)
+  {
+    throw Exception("Application::check_operations: unexpected size");
+  }
+
+  for(size_t i = 0; i < keys.size(); ++i)
+  {
+    check_value(*map, keys[i].in(), i % 2 ? (long)i : -1,
+                "check_operations");
+  }
+
+  // Replace value, iteration order is of insertion
+  El::Python::Object_var value = PyInt_FromLong(7);
+  map->insert(keys[1].in(), value.in());
+
+  size_t i = 1;
+
+  for(El::Python::HashMap::const_iterator it(map->begin()), ie(map->end());
+      it != ie; ++it, i += 2)
+  {
+    if(it.key() != keys[i].in())
+    {
+      throw Exception("Application::check_operations: unexpected order");
+    }
+  }
+
+  // Keys equal across types: 1 == 1L == 1.0
+  map->clear();
+
+  El::Python::Object_var int_key = PyInt_FromLong(1);
+  El::Python::Object_var long_key = PyLong_FromLong(1);
+  El::Python::Object_var float_key = PyFloat_FromDouble(1.0);
+  El::Python::Object_var tuple_key = Py_BuildValue("(si)", "a", 1);
+  El::Python::Object_var tuple_key2 = Py_BuildValue("(si)", "a", 1);
+
+  map->insert(int_key.in(), value.in());
+  map->insert(tuple_key.in(), int_key.in());
+
+  check_value(*map, long_key.in(), 7, "check_operations");
+  check_value(*map, float_key.in(), 7, "check_operations");
+  check_value(*map, tuple_key2.in(), 1, "check_operations");
+
+  El::Python::Object_var list_key = PyList_New(0);
+
+  try
+  {
+    map->insert(list_key.in(), value.in());
+    throw Exception("Application::check_operations: unhashable key added");
+  }
+  catch(const El::Python::Exception&)
+  {
+    PyErr_Clear();
+  }
+
+  if(map->size() != 2)
+  {
+    throw Exception("Application::check_operations: unexpected size");
+  }
+}
+
+void
+Application::check_protocol() throw(Exception, El::Exception)
+{
+  El::Python::HashMap_var map = new El::Python::HashMap();
+  PyObject* obj = map.in();
+
+  El::Python::Object_var key = PyString_FromString("a");
+  El::Python::Object_var value = PyInt_FromLong(10);
+
+  if(PyObject_SetItem(obj, key.in(), value.in()) < 0 ||
+     PyMapping_Size(obj) != 1)
+  {
+    throw Exception("Application::check_protocol: PyObject_SetItem failed");
+  }
+
+  El::Python::Object_var res = PyObject_GetItem(obj, key.in());
+
+  if(res.in() != value.in())
+  {
+    throw Exception("Application::check_protocol: PyObject_GetItem failed");
+  }
+
+  El::Python::Object_var absent = PyString_FromString("b");
+  res = PyObject_GetItem(obj, absent.in());
+
+  if(res.in() || !PyErr_ExceptionMatches(PyExc_KeyError))
+  {
+    throw Exception("Application::check_protocol: KeyError expected");
+  }
+
+  PyErr_Clear();
+
+  El::Python::Object_var list_key = PyList_New(0);
+  res = PyObject_GetItem(obj, list_key.in());
+
+  if(res.in() || !PyErr_ExceptionMatches(PyExc_TypeError))
+  {
+    throw Exception("Application::check_protocol: TypeError expected");
+  }
+
+  PyErr_Clear();
+
+  if(PyObject_DelItem(obj, key.in()) < 0 || map->size() != 0)
+  {
+    throw Exception("Application::check_protocol: PyObject_DelItem failed");
+  }
+}
+
+void
+Application::check_serialization() throw(Exception, El::Exception)
+{
+  El::Python::HashMap_var map = new El::Python::HashMap();
+
+  ObjectArray keys;
+  make_keys(keys, 100, true);
+
+  ObjectArray int_keys;
+  make_keys(int_keys, 100, false);
+
+  for(size_t i = 0; i < keys.size(); ++i)
+  {
+    El::Python::Object_var value = PyInt_FromLong(i);
+    map->insert(keys[i].in(), value.in());
+    map->insert(int_keys[i].in(), keys[i].in());
+  }
+
+  El::Python::Object_var key = PyUnicode_FromString("unicode");
+  El::Python::Object_var value = Py_BuildValue("(dsi)", 1.5, "x", 3);
+  El::Python::Object_var nested = new El::Python::HashMap();
+
+  map->insert(key.in(), value.in());
+  map->insert(value.in(), nested.in());
+
+  std::ostringstream ostr;
+
+  {
+    El::BinaryOutStream bstr(ostr);
+    bstr << map;
+  }
+
+  std::istringstream istr(ostr.str());
+  El::BinaryInStream bstr(istr);
+
+  El::Python::Object_var obj;
+  bstr >> obj;
+
+  El::Python::HashMap_var map2 =
+    El::Python::HashMap::Type::down_cast(obj.in(), true);
+
+  if(map2->size() != map->size())
+  {
+    throw Exception("Application::check_serialization: unexpected size");
+  }
+
+  El::Python::HashMap::const_iterator it2 = map2->begin();
+
+  for(El::Python::HashMap::const_iterator it(map->begin()), ie(map->end());
+      it != ie; ++it, ++it2)
+  {
+    if(PyObject_RichCompareBool(it.key(), it2.key(), Py_EQ) != 1 ||
+       (it.value() != nested.in() &&
+        PyObject_RichCompareBool(it.value(), it2.value(), Py_EQ) != 1))
+    {
+      throw Exception("Application::check_serialization: maps differ");
+    }
+  }
+
+  if(!El::Python::HashMap::Type::check_type(map2->find(value.in())))
+  {
+    throw Exception(
+      "Application::check_serialization: nested map not restored");
+  }
+}
+
+void
+Application::check_mutating_keys() throw(Exception, El::Exception)
+{
+  //
+  // Key which on first comparison erases itself from the map and makes
+  // it rehash
+  //
+  const char CODE[] =
+    "class Key(object):\n"
+    "  def __init__(self, map):\n"
+    "    self.map = map\n"
+    "  def __hash__(self):\n"
+    "    return 1\n"
+    "  def __eq__(self, other):\n"
+    "    map = self.map\n"
+    "    if map is not None:\n"
+    "      self.map = None\n"
+    "      del map[self]\n"
+    "      for i in range(100):\n"
+    "        map[i] = i\n"
+    "    return False\n";
+
+  El::Python::Object_var globals = PyDict_New();
+
+  if(globals.in() == 0 ||
+     PyDict_SetItemString(globals.in(),
+                          "__builtins__",
+                          PyEval_GetBuiltins()) < 0)
+  {
+    El::Python::handle_error(
+      "Application::check_mutating_keys: globals creation failed");
+  }
+
+  El::Python::Object_var res =
+    PyRun_String(CODE, Py_file_input, globals.in(), globals.in());
+
+  if(res.in() == 0)
+  {
+    El::Python::handle_error(
+      "Application::check_mutating_keys: PyRun_String failed");
+  }
+
+  PyObject* key_type = PyDict_GetItemString(globals.in(), "Key");
+  El::Python::HashMap_var map = new El::Python::HashMap();
+
+  // Passed through varargs, so converted explicitly
+  PyObject* map_obj = map.in();
+
+  El::Python::Object_var mutating_key =
+    PyObject_CallFunctionObjArgs(key_type, map_obj, (PyObject*)0);
+
+  El::Python::Object_var key =
+    PyObject_CallFunctionObjArgs(key_type, Py_None, (PyObject*)0);
+
+  if(mutating_key.in() == 0 || key.in() == 0)
+  {
+    El::Python::handle_error(
+      "Application::check_mutating_keys: key creation failed");
+  }
+
+  El::Python::Object_var value = PyInt_FromLong(1000);
+
+  map->insert(mutating_key.in(), value.in());
+  map->insert(key.in(), value.in());
+
+  if(map->size() != 101)
+  {
+    std::ostringstream ostr;
+    ostr << "Application::check_mutating_keys: unexpected size "
+         << map->size();
+
+    throw Exception(ostr.str());
+  }
+
+  check_value(*map, mutating_key.in(), -1, "check_mutating_keys");
+  check_value(*map, key.in(), 1000, "check_mutating_keys");
+
+  for(long i = 0; i < 100; ++i)
+  {
+    El::Python::Object_var int_key = PyInt_FromLong(i);
+    check_value(*map, int_key.in(), i, "check_mutating_keys");
+  }
+}
+
+void
+Application::bench(size_t entries, size_t iterations, bool string_keys)
+  throw(Exception, El::Exception)
+{
+  ObjectArray keys;
+  make_keys(keys, entries, string_keys);
+
+  // Keys equal to stored ones but not same objects, as keys coming from
+  // other code are
+  ObjectArray lookup_keys;
+  make_keys(lookup_keys, entries, string_keys);
+
+  El::Python::Object_var value = PyInt_FromLong(1);
+
+  ACE_Time_Value map_insert;
+  ACE_Time_Value map_lookup;
+  ACE_Time_Value map_serialize;
+  ACE_Time_Value hash_insert;
+  ACE_Time_Value hash_lookup;
+  ACE_Time_Value hash_serialize;
+
+  size_t map_bytes = 0;
+  size_t hash_bytes = 0;
+
+  for(size_t i = 0; i < iterations; ++i)
+  {
+    {
+      El::Python::Map_var map = new El::Python::Map();
+
+      ACE_Time_Value start = ACE_OS::gettimeofday();
+
+      for(size_t j = 0; j < entries; ++j)
+      {
+        (*map)[keys[j]] = value;
+      }
+
+      ACE_Time_Value mid = ACE_OS::gettimeofday();
+      map_insert += mid - start;
+
+      size_t found = 0;
+
+      for(size_t j = 0; j < entries; ++j)
+      {
+        found += map->find(lookup_keys[j]) != map->end();
+      }
+
+      ACE_Time_Value end = ACE_OS::gettimeofday();
+      map_lookup += end - mid;
+
+      if(found != entries)
+      {
+        throw Exception("Application::bench: map lookup failed");
+      }
+
+      std::ostringstream ostr;
+
+      {
+        El::BinaryOutStream bstr(ostr);
+        map->write(bstr);
+      }
+
+      std::string data = ostr.str();
+      std::istringstream istr(data);
+      El::BinaryInStream bstr(istr);
+
+      El::Python::Map_var map2 = new El::Python::Map();
+      map2->read(bstr);
+
+      map_serialize += ACE_OS::gettimeofday() - end;
+      map_bytes = data.size();
+    }
+
+    {
+      El::Python::HashMap_var map = new El::Python::HashMap();
+
+      ACE_Time_Value start = ACE_OS::gettimeofday();
+
+      for(size_t j = 0; j < entries; ++j)
+      {
+        map->insert(keys[j].in(), value.in());
+      }
+
+      ACE_Time_Value mid = ACE_OS::gettimeofday();
+      hash_insert += mid - start;
+
+      size_t found = 0;
+
+      for(size_t j = 0; j < entries; ++j)
+      {
+        found += map->find(lookup_keys[j].in()) != 0;
+      }
+
+      ACE_Time_Value end = ACE_OS::gettimeofday();
+      hash_lookup += end - mid;
+
+      if(found != entries)
+      {
+        throw Exception("Application::bench: hash map lookup failed");
+      }
+
+      std::ostringstream ostr;
+
+      {
+        El::BinaryOutStream bstr(ostr);
+        map->write(bstr);
+      }
+
+      std::string data = ostr.str();
+      std::istringstream istr(data);
+      El::BinaryInStream bstr(istr);
+
+      El::Python::HashMap_var map2 = new El::Python::HashMap();
+      map2->read(bstr);
+
+      hash_serialize += ACE_OS::gettimeofday() - end;
+      hash_bytes = data.size();
+    }
+  }
+
+  double ops = (double)entries * iterations;
+
+  std::cout << entries << " entries, " << (string_keys ? "str" : "int")
+            << " keys, ns per entry:\n  el.Map:     insert "
+            << seconds(map_insert) * 1e9 / ops << ", lookup "
+            << seconds(map_lookup) * 1e9 / ops << ", write+read "
+            << seconds(map_serialize) * 1e9 / ops << " (" << map_bytes
+            << " bytes)\n  el.HashMap: insert "
+            << seconds(hash_insert) * 1e9 / ops << ", lookup "
+            << seconds(hash_lookup) * 1e9 / ops << ", write+read "
+            << seconds(hash_serialize) * 1e9 / ops << " (" << hash_bytes
+            << " bytes)\n";
+}
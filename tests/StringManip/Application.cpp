@@ -16,6 +16,9 @@
 #include <string>
 #include <iostream>
 #include <sstream>
+#include <iomanip>
+
+#include <ace/OS.h>
 
 #include <El/String/Manip.hpp>
 
@@ -23,7 +26,148 @@
 
 namespace
 {
-  const char USAGE[] = "\nUsage:\nElTestStringManip [help]\n";
+  const char USAGE[] =
+    "\nUsage:\nElTestStringManip [bench [iterations=<count>] | help]\n";
+
+  //
+  // Char at a time encoders used to be; encoders output should match
+  // their one byte to byte
+  //
+  void
+  legacy_mime_url_encode(const char* from, std::ostream& to)
+    throw(El::Exception)
+  {
+    char ch; 
+    for (const char* ptr = from; (ch = *ptr) != '\0'; ptr++)
+    {      
+      if (ch == ' ')
+      {
+        to << '+';
+        continue;
+      }
+      else if ((ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z') ||
+               (ch >= '0' && ch <= '9') || ch == '-' || ch == '_' ||
+               ch == '*' || ch == '.' || ch == ',')
+      {
+        to << ch;
+        continue;
+      }
+                           
+      to << "%";
+      to << std::setw(2) << std::setfill('0') << std::uppercase
+         << std::hex << std::right << (unsigned short) (ch & 0xFF)
+         << std::dec;
+    }
+  }
+
+  void
+  legacy_quoted_printable_encode(const unsigned char* src,
+                                 size_t src_len,
+                                 std::ostream& dest,
+                                 size_t char_per_line)
+    throw(El::Exception)
+  {
+    size_t len = 0;
+        
+    for(const unsigned char *p(src), *e(src + src_len); p != e; ++p)
+    {
+      char ch = *p;
+          
+      bool as_is = (ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z') ||
+        (ch >= '0' && ch <= '9') || ch == '<' || ch == '>' || ch == '"' ||
+        ch == '\'' || ch == '/';
+          
+      len += as_is ? 1 : 3;
+
+      if(len > char_per_line)
+      {
+        dest << "=\r\n";
+        len = as_is ? 1 : 3;
+      }
+
+      if(as_is)
+      {
+        dest << ch;
+      }          
+      else
+      {
+        dest << '=' << std::setw(2) << std::setfill('0') << std::uppercase
+             << std::hex << std::right << (unsigned short)*p;
+      }
+    }
+  }
+
+  void
+  legacy_xml_encode(const char* src, std::string& dest, unsigned long flags)
+    throw(El::Exception)
+  {
+    std::wstring val;
+
+    El::String::Manip::utf8_to_wchar(
+      src,
+      val,
+      flags & El::String::Manip::XE_LAX_ENCODING,
+      El::String::Manip::UAC_XML_1_0);
+
+    std::ostringstream ostr;
+    El::String::Manip::xml_encode(val.c_str(), ostr, flags);
+    dest = ostr.str();
+  }
+
+  void
+  legacy_xml_decode(const char* src, std::string& dest)
+    throw(El::Exception)
+  {
+    std::wstring val;
+    El::String::Manip::utf8_to_wchar(src, val);
+    El::String::Manip::xml_decode(val.c_str(), dest);
+  }
+
+  //
+  // Random text of pieces exercising escaping, valid and broken UTF-8
+  //
+  std::string
+  random_text(const char* const* pieces, size_t count, size_t len)
+    throw(El::Exception)
+  {
+    std::string text;
+
+    for(size_t i = 0; i < len; ++i)
+    {
+      text += pieces[rand() % count];
+    }
+
+    return text;
+  }
+
+  const char* const TEXT_PIECES[] =
+  {
+    "a", "Hello world ", "<", ">", "&", "'", "\"", "\n", "\t", "\r", "\x01",
+    "\x7F", "abcdefghijklmnopqrstuvwxyz0123456789", "&amp;", "-_*.,+%",
+    "\xD0\x9F\xD1\x80\xD0\xB8", "\xC3\xA9", "\xE2\x82\xAC",
+    "\xF0\x9F\x98\x80", "\xC0\xBC", "\xCD\xB0", "\xCD\xAF", "\x80",
+    "\xC3", "\xE2\x82", "\xFF"
+  };
+
+  const char* const ENTITY_PIECES[] =
+  {
+    "abc", "&amp;", "&lt;", "&gt;", "&quot;", "&#x41;", "&#65;", "&#x44f;",
+    "&nbsp;", "&mdash;", " text ", "\xC3\xA9", "0123456789abcdefghijklmnop"
+  };
+
+  std::string
+  escape(const std::string& text) throw(El::Exception)
+  {
+    std::string res;
+    El::String::Manip::mime_url_encode(text.c_str(), res);
+    return res;
+  }
+
+  double
+  seconds(const ACE_Time_Value& tm) throw()
+  {
+    return tm.sec() + (double)tm.usec() / 1000000;
+  }
 }
 
 int
@@ -68,7 +212,7 @@ Application::run(int& argc, char** argv)
 {
   std::string command;
   
-  int i = 0;  
+  int i = 1;  
 
   if(argc > 1)
   {
@@ -77,7 +221,7 @@ Application::run(int& argc, char** argv)
 
   ArgList arguments;
 
-  for(i++; i < argc; i++)
+  for(; i < argc; i++)
   {
     char* argument = argv[i];
     
@@ -101,6 +245,10 @@ Application::run(int& argc, char** argv)
   {
     return help(arguments);
   }
+  else if(command == "bench")
+  {
+    return bench(arguments);
+  }
 
   test(arguments);
   return 0;
@@ -218,6 +366,307 @@ Application::test(const ArgList& arguments)
       }
     }
   }
+
+  test_encoding();  
+  return 0;
+}
+
+void
+Application::test_encoding() throw(Exception, El::Exception)
+{
+  const size_t text_pieces = sizeof(TEXT_PIECES) / sizeof(TEXT_PIECES[0]);
   
+  const size_t entity_pieces =
+    sizeof(ENTITY_PIECES) / sizeof(ENTITY_PIECES[0]);
+
+  const size_t chars_per_line[] = { 0, 1, 2, 3, 4, 5, 19, 76 };
+  
+  for(size_t n = 0; n < 10000; ++n)
+  {
+    std::string text =
+      random_text(TEXT_PIECES, text_pieces, rand() % 16);
+
+    std::ostringstream expected;
+    legacy_mime_url_encode(text.c_str(), expected);
+
+    std::string encoded;
+    El::String::Manip::mime_url_encode(text.c_str(), encoded);
+
+    std::string decoded;
+    El::String::Manip::mime_url_decode(encoded.c_str(), decoded);
+
+    if(encoded != expected.str() || decoded != text)
+    {
+      std::ostringstream ostr;
+      ostr << "Application::test_encoding: mime_url_encode for '"
+           << escape(text) << "' gives '" << encoded << "' decoded as '"
+           << escape(decoded) << "' while expected '" << expected.str()
+           << "'";
+      
+      throw Exception(ostr.str());
+    }
+
+    for(size_t i = 0;
+        i < sizeof(chars_per_line) / sizeof(chars_per_line[0]); ++i)
+    {
+      const unsigned char* src = (const unsigned char*)text.c_str();
+      size_t cpl = chars_per_line[i];
+      
+      std::ostringstream expected;
+      legacy_quoted_printable_encode(src, text.length(), expected, cpl);
+
+      size_t size = El::String::Manip::quoted_printable_encoded_size(
+        src, text.length(), cpl);
+      
+      std::string encoded(size, '\0');
+
+      size_t written = El::String::Manip::quoted_printable_encode(
+        src, text.length(), size ? &encoded[0] : 0, cpl);
+
+      if(encoded != expected.str() || written != size)
+      {
+        std::ostringstream ostr;
+        ostr << "Application::test_encoding: quoted_printable_encode for '"
+             << escape(text) << "' with " << cpl << " chars per line gives '"
+             << escape(encoded) << "' while expected '"
+             << escape(expected.str()) << "'";
+      
+        throw Exception(ostr.str());
+      }
+    }
+
+    for(unsigned long flags = 0; flags <= 0x1F; ++flags)
+    {
+      std::string expected;
+      std::string encoded;
+
+      try
+      {
+        legacy_xml_encode(text.c_str(), expected, flags);
+      }
+      catch(const El::String::Manip::InvalidArg& e)
+      {
+        expected = e.what();
+      }
+      
+      try
+      {
+        El::String::Manip::xml_encode(text.c_str(), encoded, flags);
+      }
+      catch(const El::String::Manip::InvalidArg& e)
+      {
+        encoded = e.what();
+      }
+
+      if(encoded != expected)
+      {
+        std::ostringstream ostr;
+        ostr << "Application::test_encoding: xml_encode for '"
+             << escape(text) << "' with flags 0x" << std::hex << flags
+             << std::dec << " gives '" << escape(encoded)
+             << "' while expected '" << escape(expected) << "'";
+      
+        throw Exception(ostr.str());
+      }
+    }
+
+    text = random_text(ENTITY_PIECES, entity_pieces, rand() % 8);
+
+    std::string expected_decoded;
+    legacy_xml_decode(text.c_str(), expected_decoded);
+
+    El::String::Manip::xml_decode(text.c_str(), decoded);
+
+    if(decoded != expected_decoded)
+    {
+      std::ostringstream ostr;
+      ostr << "Application::test_encoding: xml_decode for '"
+           << escape(text) << "' gives '" << escape(decoded)
+           << "' while expected '" << escape(expected_decoded) << "'";
+      
+      throw Exception(ostr.str());
+    }
+  }
+
+  const char* const BAD_URL_ENCODINGS[] = { "%", "a%4", "%4g", "%0x1" };
+  
+  for(size_t i = 0;
+      i < sizeof(BAD_URL_ENCODINGS) / sizeof(BAD_URL_ENCODINGS[0]); ++i)
+  {
+    std::string decoded = "unchanged";
+    
+    try
+    {
+      El::String::Manip::mime_url_decode(BAD_URL_ENCODINGS[i], decoded);
+    }
+    catch(const El::String::Manip::InvalidArg&)
+    {
+    }
+
+    if(decoded != "unchanged")
+    {
+      std::ostringstream ostr;
+      ostr << "Application::test_encoding: mime_url_decode accepted '"
+           << BAD_URL_ENCODINGS[i] << "'";
+      
+      throw Exception(ostr.str());
+    }
+  }
+}
+
+int
+Application::bench(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  size_t iterations = 10000;
+  
+  for(ArgList::const_iterator i(arguments.begin()), e(arguments.end());
+      i != e; ++i)
+  {
+    if(i->name == "iterations")
+    {
+      iterations = atol(i->value.c_str());
+    }
+    else
+    {
+      std::ostringstream ostr;
+      ostr << "unexpected argument " << i->name;
+      throw InvalidArg(ostr.str());
+    }
+  }
+
+  std::string url = "http://www.example.com/path/to/page.html?q=";
+
+  while(url.length() < 256)
+  {
+    url += "search terms & more ";
+  }
+
+  std::string text;
+
+  while(text.length() < 4096)
+  {
+    text += "The quick brown fox jumps over the lazy dog, 3 < 4 & \"5\" > 4; "
+      "\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82 ";
+  }
+
+  std::string encoded_url;
+  El::String::Manip::mime_url_encode(url.c_str(), encoded_url);
+
+  std::string encoded_text;
+  El::String::Manip::xml_encode(text.c_str(), encoded_text);
+
+  const char* names[] =
+  {
+    "mime_url_encode legacy",
+    "mime_url_encode",
+    "mime_url_decode",
+    "quoted_printable_encode legacy",
+    "quoted_printable_encode",
+    "xml_encode legacy",
+    "xml_encode",
+    "xml_decode legacy",
+    "xml_decode"
+  };
+
+  size_t total = 0;
+  
+  for(size_t mode = 0; mode < sizeof(names) / sizeof(names[0]); ++mode)
+  {
+    size_t bytes = 0;
+    ACE_Time_Value start = ACE_OS::gettimeofday();
+
+    for(size_t i = 0; i < iterations; ++i)
+    {
+      std::string res;
+      
+      switch(mode)
+      {
+      case 0:
+        {
+          std::ostringstream ostr;
+          legacy_mime_url_encode(url.c_str(), ostr);
+          res = ostr.str();
+          bytes += url.length();
+          break;
+        }
+      case 1:
+        {
+          El::String::Manip::mime_url_encode(url.c_str(), res);
+          bytes += url.length();
+          break;
+        }
+      case 2:
+        {
+          El::String::Manip::mime_url_decode(encoded_url.c_str(), res);
+          bytes += encoded_url.length();
+          break;
+        }
+      case 3:
+        {
+          std::ostringstream ostr;
+          
+          legacy_quoted_printable_encode(
+            (const unsigned char*)text.c_str(), text.length(), ostr, 76);
+          
+          res = ostr.str();
+          bytes += text.length();
+          break;
+        }
+      case 4:
+        {
+          std::ostringstream ostr;
+          
+          El::String::Manip::quoted_printable_encode(
+            (const unsigned char*)text.c_str(), text.length(), ostr);
+          
+          res = ostr.str();
+          bytes += text.length();
+          break;
+        }
+      case 5:
+        {
+          legacy_xml_encode(text.c_str(),
+                            res,
+                            El::String::Manip::XE_TEXT_ENCODING |
+                            El::String::Manip::XE_PRESERVE_UTF8);
+          
+          bytes += text.length();
+          break;
+        }
+      case 6:
+        {
+          El::String::Manip::xml_encode(text.c_str(),
+                                        res,
+                                        El::String::Manip::XE_TEXT_ENCODING |
+                                        El::String::Manip::XE_PRESERVE_UTF8);
+          
+          bytes += text.length();
+          break;
+        }
+      case 7:
+        {
+          legacy_xml_decode(encoded_text.c_str(), res);
+          bytes += encoded_text.length();
+          break;
+        }
+      default:
+        {
+          El::String::Manip::xml_decode(encoded_text.c_str(), res);
+          bytes += encoded_text.length();
+          break;
+        }
+      }
+
+      total += res.length();
+    }
+
+    double time = seconds(ACE_OS::gettimeofday() - start);
+    
+    std::cout << names[mode] << ": " << bytes / time / 1048576 << " MB/s"
+              << std::endl;
+  }
+
+  std::cout << "total: " << total << std::endl;
   return 0;
 }
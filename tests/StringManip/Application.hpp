@@ -51,6 +51,11 @@ private:
   int test(const ArgList& arguments)
     throw(InvalidArg, Exception, El::Exception);
 
+  void test_encoding() throw(Exception, El::Exception);
+
+  int bench(const ArgList& arguments)
+    throw(InvalidArg, Exception, El::Exception);
+
 };
 
 ///////////////////////////////////////////////////////////////////////////////
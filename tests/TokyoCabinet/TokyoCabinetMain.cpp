@@ -0,0 +1,904 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file   TokyoCabinetMain.cpp
+ * @author Karen Arutyunov
+ * $Id:$
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <iostream>
+
+#include <ace/OS.h>
+
+#include <El/Exception.hpp>
+#include <El/TokyoCabinet/HashDBM.hpp>
+#include <El/TokyoCabinet/BTreeDBM.hpp>
+#include <El/TokyoCabinet/BatchWriter.hpp>
+
+namespace
+{
+  const char USAGE[] =
+    "Usage: ElTestTokyoCabinet [--records=<record count>] "
+    "[--threads=<thread count>]";
+
+  EL_EXCEPTION(Exception, El::ExceptionBase);
+
+  std::string
+  db_path(const char* name, const char* ext = "tcb") throw(El::Exception)
+  {
+    std::ostringstream ostr;
+    ostr << "/tmp/ElTestTokyoCabinet." << getpid() << "." << name << "."
+         << ext;
+    return ostr.str();
+  }
+
+  El::TokyoCabinet::BTreeDBM*
+  open_db(const std::string& path, bool sync) throw(El::Exception)
+  {
+    unlink(path.c_str());
+
+    return new El::TokyoCabinet::BTreeDBM(
+      path.c_str(),
+      BDBOWRITER | BDBOCREAT | BDBOTRUNC | (sync ? BDBOTSYNC : 0));
+  }
+
+  // Opens hash or B+ tree database file
+  El::TokyoCabinet::DBM*
+  open_file(const std::string& path, bool hash, bool create)
+    throw(El::Exception)
+  {
+    if(hash)
+    {
+      return new El::TokyoCabinet::HashDBM(
+        path.c_str(),
+        create ? (HDBOWRITER | HDBOCREAT | HDBOTRUNC) : HDBOREADER);
+    }
+
+    return new El::TokyoCabinet::BTreeDBM(
+      path.c_str(),
+      create ? (BDBOWRITER | BDBOCREAT | BDBOTRUNC) : BDBOREADER);
+  }
+
+  std::string
+  record_key(unsigned long thread, unsigned long index) throw(El::Exception)
+  {
+    std::ostringstream ostr;
+    ostr << "key-" << thread << "-" << index;
+    return ostr.str();
+  }
+
+  // Returns record value or "<none>" if not found
+  std::string
+  record_value(El::TokyoCabinet::DBM* dbm, const std::string& key)
+    throw(El::Exception)
+  {
+    int size = 0;
+    char* value = (char*)dbm->find(key.c_str(), key.size(), &size);
+
+    if(value == 0)
+    {
+      return "<none>";
+    }
+
+    std::string result(value, size);
+    free(value);
+
+    return result;
+  }
+
+  // Collects "key=value" strings of records visited; stops after limit
+  // records if it is not zero
+  struct Collector : public El::TokyoCabinet::BTreeDBM::Visitor
+  {
+    std::string records;
+    size_t limit;
+
+    Collector(size_t limit_val = 0) throw() : limit(limit_val) {}
+    virtual ~Collector() throw() {}
+
+    virtual bool visit(const void *kbuf,
+                       int ksiz,
+                       const void *vbuf,
+                       int vsiz)
+      throw(El::Exception)
+    {
+      if(!records.empty())
+      {
+        records += ",";
+      }
+
+      records.append((const char*)kbuf, ksiz);
+      records += "=";
+      records.append((const char*)vbuf, vsiz);
+
+      return limit == 0 || --limit > 0;
+    }
+  };
+
+  // Fails inserting record with fail_key, so batches including it
+  class FailingDBM : public virtual El::TokyoCabinet::DBM
+  {
+  public:
+    std::string fail_key;
+
+    FailingDBM(El::TokyoCabinet::DBM* dbm) throw()
+        : dbm_(El::RefCount::add_ref(dbm))
+    {
+    }
+
+    virtual void insert(const void *kbuf,
+                        int ksiz,
+                        const void *vbuf,
+                        int vsiz)
+      throw(Exception, El::Exception)
+    {
+      if(fail_key == std::string((const char*)kbuf, ksiz))
+      {
+        throw Exception("FailingDBM::insert: failure requested");
+      }
+
+      dbm_->insert(kbuf, ksiz, vbuf, vsiz);
+    }
+
+    virtual int add_int(const void *kbuf, int ksiz, int num)
+      throw(Exception, El::Exception)
+    {
+      return dbm_->add_int(kbuf, ksiz, num);
+    }
+
+    virtual void erase(const void *kbuf, int ksiz)
+      throw(NotFound, Exception, El::Exception)
+    {
+      dbm_->erase(kbuf, ksiz);
+    }
+
+    virtual void* find(const void *kbuf, int ksiz, int* vsiz = 0) const
+      throw(Exception, El::Exception)
+    {
+      return dbm_->find(kbuf, ksiz, vsiz);
+    }
+
+    virtual void clear() throw(Exception, El::Exception)
+    {
+      dbm_->clear();
+    }
+
+    virtual void copy(const char* path) const
+      throw(Exception, El::Exception)
+    {
+      dbm_->copy(path);
+    }
+
+    virtual const char* path() const throw()
+    {
+      return dbm_->path();
+    }
+
+    virtual void begin_transaction() throw(Exception, El::Exception)
+    {
+      dbm_->begin_transaction();
+    }
+
+    virtual void commit_transaction() throw(Exception, El::Exception)
+    {
+      dbm_->commit_transaction();
+    }
+
+    virtual void abort_transaction() throw(Exception, El::Exception)
+    {
+      dbm_->abort_transaction();
+    }
+
+  protected:
+    virtual ~FailingDBM() throw() {}
+
+  private:
+    El::TokyoCabinet::DBM_var dbm_;
+  };
+
+  typedef El::RefCount::SmartPtr<FailingDBM> FailingDBM_var;
+
+  struct Counter : public El::TokyoCabinet::BTreeDBM::Visitor
+  {
+    unsigned long long bytes;
+
+    Counter() throw() : bytes(0) {}
+    virtual ~Counter() throw() {}
+
+    virtual bool visit(const void *kbuf,
+                       int ksiz,
+                       const void *vbuf,
+                       int vsiz)
+      throw(El::Exception)
+    {
+      bytes += ksiz + vsiz;
+      return true;
+    }
+  };
+
+  struct Worker
+  {
+    El::TokyoCabinet::DBM* dbm;
+    unsigned long thread;
+    unsigned long records;
+    std::string error;
+
+    static void* write(void* arg);
+  };
+
+  void*
+  Worker::write(void* arg)
+  {
+    Worker& worker = *static_cast<Worker*>(arg);
+
+    try
+    {
+      for(unsigned long i = 0; i < worker.records; ++i)
+      {
+        std::string key = record_key(worker.thread, i);
+
+        std::ostringstream ostr;
+        ostr << "value-" << i;
+        std::string value = ostr.str();
+
+        worker.dbm->insert(key.c_str(), key.size(),
+                           value.c_str(), value.size());
+
+        // Each write should be visible right away
+        if(i % 16 == 0 && record_value(worker.dbm, key) != value)
+        {
+          std::ostringstream ostr;
+          ostr << "Worker::write: unexpected value '"
+               << record_value(worker.dbm, key) << "' of '" << key << "'";
+
+          worker.error = ostr.str();
+          break;
+        }
+      }
+    }
+    catch(const El::Exception& e)
+    {
+      worker.error = e.what();
+    }
+
+    return 0;
+  }
+
+  // Returns time taken
+  ACE_Time_Value
+  run_workers(El::TokyoCabinet::DBM* dbm,
+              unsigned long threads,
+              unsigned long records)
+    throw(Exception, El::Exception)
+  {
+    std::vector<Worker> workers(threads);
+    std::vector<pthread_t> handles(threads);
+
+    ACE_Time_Value start = ACE_OS::gettimeofday();
+
+    for(size_t i = 0; i < workers.size(); ++i)
+    {
+      workers[i].dbm = dbm;
+      workers[i].thread = i;
+      workers[i].records = records / threads;
+
+      if(pthread_create(&handles[i], 0, Worker::write, &workers[i]))
+      {
+        throw Exception("run_workers: pthread_create failed");
+      }
+    }
+
+    for(size_t i = 0; i < handles.size(); ++i)
+    {
+      pthread_join(handles[i], 0);
+    }
+
+    ACE_Time_Value time = ACE_OS::gettimeofday() - start;
+
+    for(size_t i = 0; i < workers.size(); ++i)
+    {
+      if(!workers[i].error.empty())
+      {
+        throw Exception(workers[i].error);
+      }
+    }
+
+    return time;
+  }
+
+  void
+  check_overlay() throw(Exception, El::Exception)
+  {
+    std::string path = db_path("overlay");
+
+    El::TokyoCabinet::DBM_var dbm = open_db(path, false);
+
+    // Period long enough for records to stay buffered
+    El::TokyoCabinet::BatchWriter_var writer =
+      new El::TokyoCabinet::BatchWriter(dbm.in(),
+                                        1024 * 1024,
+                                        4 * 1024 * 1024,
+                                        ACE_Time_Value(3600));
+
+    writer->insert("a", 1, "1", 1);
+    writer->insert("b", 1, "2", 1);
+    writer->insert("a", 1, "3", 1);
+    writer->erase("b", 1);
+    writer->erase("c", 1);
+
+    int sum = writer->add_int("n", 1, 5);
+    sum = writer->add_int("n", 1, 2);
+
+    if(record_value(writer.in(), "a") != "3" ||
+       record_value(writer.in(), "b") != "<none>" || sum != 7)
+    {
+      throw Exception("check_overlay: unexpected buffered values");
+    }
+
+    if(record_value(dbm.in(), "a") != "<none>")
+    {
+      throw Exception("check_overlay: record written before flush");
+    }
+
+    writer->flush();
+
+    if(record_value(dbm.in(), "a") != "3" ||
+       record_value(dbm.in(), "b") != "<none>" ||
+       writer->pending_size() != 0)
+    {
+      throw Exception("check_overlay: unexpected values after flush");
+    }
+
+    writer->erase("a", 1);
+
+    if(writer->add_int("n", 1, 1) != 8 ||
+       record_value(writer.in(), "a") != "<none>")
+    {
+      throw Exception("check_overlay: unexpected values after erase");
+    }
+
+    writer->close();
+
+    if(record_value(dbm.in(), "a") != "<none>")
+    {
+      throw Exception("check_overlay: record not erased on close");
+    }
+
+    try
+    {
+      writer->insert("a", 1, "1", 1);
+      throw Exception("check_overlay: insert after close succeeded");
+    }
+    catch(const El::TokyoCabinet::BatchWriter::Exception&)
+    {
+    }
+
+    writer = 0;
+    dbm = 0;
+
+    unlink(path.c_str());
+  }
+
+  void
+  check_files() throw(Exception, El::Exception)
+  {
+    for(unsigned long hash = 0; hash < 2; ++hash)
+    {
+      const char* type = hash ? "HashDBM" : "BTreeDBM";
+      std::string path = db_path("files", hash ? "tch" : "tcb");
+
+      El::TokyoCabinet::DBM_var dbm = open_file(path, hash, true);
+
+      dbm->insert("a", 1, "1", 1);
+      dbm->insert("b", 1, "2", 1);
+
+      El::TokyoCabinet::BatchWriter_var writer =
+        new El::TokyoCabinet::BatchWriter(dbm.in(),
+                                          1024,
+                                          4 * 1024,
+                                          ACE_Time_Value(3600));
+
+      // Erasing records which don't exist in the file is not an error
+      writer->erase("a", 1);
+      writer->erase("x", 1);
+      writer->insert("c", 1, "3", 1);
+      writer->add_int("n", 1, 5);
+
+      writer->flush();
+
+      writer->erase("a", 1);
+      writer->insert("d", 1, "4", 1);
+      writer->add_int("n", 1, 2);
+
+      writer->close();
+
+      writer = 0;
+      dbm = 0;
+
+      dbm = open_file(path, hash, false);
+
+      int n = 0;
+      int size = 0;
+      void* value = dbm->find("n", 1, &size);
+
+      if(value)
+      {
+        if(size == sizeof(n))
+        {
+          memcpy(&n, value, sizeof(n));
+        }
+
+        free(value);
+      }
+
+      if(record_value(dbm.in(), "a") != "<none>" ||
+         record_value(dbm.in(), "b") != "2" ||
+         record_value(dbm.in(), "c") != "3" ||
+         record_value(dbm.in(), "d") != "4" ||
+         record_value(dbm.in(), "x") != "<none>" || n != 7)
+      {
+        std::ostringstream ostr;
+        ostr << "check_files: unexpected " << type << " file content";
+        throw Exception(ostr.str());
+      }
+
+      dbm = 0;
+      unlink(path.c_str());
+    }
+  }
+
+  void
+  check_retry() throw(Exception, El::Exception)
+  {
+    std::string path = db_path("retry");
+
+    El::TokyoCabinet::DBM_var dbm = open_db(path, false);
+    FailingDBM_var failing = new FailingDBM(dbm.in());
+
+    failing->fail_key = "b";
+
+    El::TokyoCabinet::BatchWriter_var writer =
+      new El::TokyoCabinet::BatchWriter(failing.in(),
+                                        1024,
+                                        4 * 1024,
+                                        ACE_Time_Value(3600));
+
+    writer->insert("a", 1, "1", 1);
+    writer->insert("b", 1, "2", 1);
+
+    try
+    {
+      writer->flush();
+      throw Exception("check_retry: failed batch flushed");
+    }
+    catch(const El::TokyoCabinet::BatchWriter::Exception& e)
+    {
+      if(strstr(e.what(), "batch 1 of 2 records failed") == 0)
+      {
+        std::ostringstream ostr;
+        ostr << "check_retry: unexpected error:\n" << e.what();
+        throw Exception(ostr.str());
+      }
+    }
+
+    // Failed batch transaction is aborted while its records are kept
+    if(record_value(dbm.in(), "a") != "<none>" ||
+       record_value(writer.in(), "a") != "1" ||
+       record_value(writer.in(), "b") != "2")
+    {
+      throw Exception("check_retry: unexpected values after failure");
+    }
+
+    try
+    {
+      writer->insert("c", 1, "3", 1);
+      throw Exception("check_retry: insert after failure succeeded");
+    }
+    catch(const El::TokyoCabinet::BatchWriter::Exception&)
+    {
+    }
+
+    failing->fail_key.clear();
+    writer->flush();
+
+    if(record_value(dbm.in(), "a") != "1" ||
+       record_value(dbm.in(), "b") != "2" ||
+       writer->pending_size() != 0)
+    {
+      throw Exception("check_retry: unexpected values after retry");
+    }
+
+    failing->fail_key = "c";
+    writer->insert("c", 1, "3", 1);
+
+    // Failed batch is retried once on close
+    try
+    {
+      writer->close();
+      throw Exception("check_retry: failed batch written on close");
+    }
+    catch(const El::TokyoCabinet::BatchWriter::Exception&)
+    {
+    }
+
+    if(record_value(dbm.in(), "c") != "<none>")
+    {
+      throw Exception("check_retry: failed record written");
+    }
+
+    writer = 0;
+    failing = 0;
+    dbm = 0;
+
+    unlink(path.c_str());
+  }
+
+  void
+  check_threads(unsigned long threads, unsigned long records)
+    throw(Exception, El::Exception)
+  {
+    std::string path = db_path("threads");
+
+    El::TokyoCabinet::DBM_var dbm = open_db(path, false);
+
+    // Small limits for batches to be taken and for callers to block
+    // waiting for the writer thread
+    size_t max_pending_size = 64 * 1024;
+
+    El::TokyoCabinet::BatchWriter_var writer =
+      new El::TokyoCabinet::BatchWriter(dbm.in(),
+                                        16 * 1024,
+                                        max_pending_size,
+                                        ACE_Time_Value(0, 10000));
+
+    run_workers(writer.in(), threads, records);
+
+    if(writer->pending_size() > max_pending_size)
+    {
+      std::ostringstream ostr;
+      ostr << "check_threads: pending size " << writer->pending_size()
+           << " exceeds the limit " << max_pending_size;
+
+      throw Exception(ostr.str());
+    }
+
+    writer->flush();
+
+    for(unsigned long thread = 0; thread < threads; ++thread)
+    {
+      for(unsigned long i = 0; i < records / threads; ++i)
+      {
+        std::string key = record_key(thread, i);
+
+        std::ostringstream ostr;
+        ostr << "value-" << i;
+
+        if(record_value(dbm.in(), key) != ostr.str())
+        {
+          std::ostringstream ostr;
+          ostr << "check_threads: record '" << key << "' is not flushed";
+          throw Exception(ostr.str());
+        }
+      }
+    }
+
+    writer = 0;
+    dbm = 0;
+
+    unlink(path.c_str());
+  }
+
+  void
+  check_scan_result(const char* name,
+                    size_t count,
+                    const Collector& collector,
+                    size_t expected_count,
+                    const char* expected)
+    throw(Exception)
+  {
+    if(count != expected_count || collector.records != expected)
+    {
+      std::ostringstream ostr;
+      ostr << "check_scan: " << name << " visited " << count << " records '"
+           << collector.records << "' instead of " << expected_count
+           << " '" << expected << "'";
+
+      throw Exception(ostr.str());
+    }
+  }
+
+  void
+  check_scan() throw(Exception, El::Exception)
+  {
+    std::string path = db_path("scan");
+
+    El::TokyoCabinet::BTreeDBM_var dbm = open_db(path, false);
+
+    const char* keys[] =
+    {
+      "c", "ab\xFF", "a", "abc", "b", "ab", "ab\xFF\xFF"
+    };
+
+    for(size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i)
+    {
+      dbm->insert(keys[i], strlen(keys[i]), "v", 1);
+    }
+
+    {
+      Collector collector;
+      size_t count = dbm->scan(collector);
+
+      check_scan_result("full scan", count, collector, 7,
+                        "a=v,ab=v,abc=v,ab\xFF=v,ab\xFF\xFF=v,b=v,c=v");
+    }
+
+    {
+      Collector collector;
+      size_t count = dbm->scan(collector, "aa", 2, "b", 1);
+
+      check_scan_result("range scan", count, collector, 4,
+                        "ab=v,abc=v,ab\xFF=v,ab\xFF\xFF=v");
+    }
+
+    {
+      Collector collector;
+      size_t count = dbm->scan(collector, "ab", 2, "b", 1, true);
+
+      check_scan_result("inclusive range scan", count, collector, 5,
+                        "ab=v,abc=v,ab\xFF=v,ab\xFF\xFF=v,b=v");
+    }
+
+    {
+      Collector collector;
+      size_t count = dbm->scan(collector, "d", 1);
+
+      check_scan_result("scan past the end", count, collector, 0, "");
+    }
+
+    {
+      Collector collector(2);
+      size_t count = dbm->scan(collector, "b", 1);
+
+      check_scan_result("stopped scan", count, collector, 2, "b=v,c=v");
+    }
+
+    {
+      Collector collector;
+      size_t count = dbm->scan_prefix(collector, "ab\xFF", 3);
+
+      check_scan_result("prefix scan", count, collector, 2,
+                        "ab\xFF=v,ab\xFF\xFF=v");
+    }
+
+    {
+      Collector collector;
+      size_t count = dbm->scan_prefix(collector, "ab", 2);
+
+      check_scan_result("prefix scan", count, collector, 4,
+                        "ab=v,abc=v,ab\xFF=v,ab\xFF\xFF=v");
+    }
+
+    {
+      Collector collector;
+      size_t count = dbm->scan_prefix(collector, "\xFF", 1);
+
+      check_scan_result("empty prefix scan", count, collector, 0, "");
+    }
+
+    {
+      const char* lookup[] = { "c", "zz", "abc", "a", "aa", "a", "" };
+
+      El::TokyoCabinet::BTreeDBM::KeyArray lookup_keys;
+
+      for(size_t i = 0; i < sizeof(lookup) / sizeof(lookup[0]); ++i)
+      {
+        lookup_keys.push_back(
+          El::TokyoCabinet::BTreeDBM::Key(lookup[i], strlen(lookup[i])));
+      }
+
+      Collector collector;
+      size_t count = dbm->find_bulk(lookup_keys, collector);
+
+      check_scan_result("bulk find", count, collector, 3, "a=v,abc=v,c=v");
+    }
+
+    dbm = 0;
+    unlink(path.c_str());
+  }
+
+  void
+  bench_scan(unsigned long records) throw(Exception, El::Exception)
+  {
+    std::string path = db_path("bench_scan");
+
+    El::TokyoCabinet::BTreeDBM_var dbm = open_db(path, false);
+
+    std::vector<std::string> keys(records);
+
+    for(unsigned long i = 0; i < records; ++i)
+    {
+      std::ostringstream ostr;
+      ostr << "key-" << i;
+      keys[i] = ostr.str();
+
+      dbm->insert(keys[i].c_str(), keys[i].size(), "0123456789", 10);
+    }
+
+    std::random_shuffle(keys.begin(), keys.end());
+
+    El::TokyoCabinet::BTreeDBM::KeyArray lookup_keys;
+
+    for(unsigned long i = 0; i < records; ++i)
+    {
+      lookup_keys.push_back(
+        El::TokyoCabinet::BTreeDBM::Key(keys[i].c_str(), keys[i].size()));
+    }
+
+    for(unsigned long method = 0; method < 3; ++method)
+    {
+      Counter counter;
+      size_t count = 0;
+
+      ACE_Time_Value start = ACE_OS::gettimeofday();
+
+      switch(method)
+      {
+      case 0:
+        {
+          for(unsigned long i = 0; i < records; ++i)
+          {
+            int size = 0;
+            void* value = dbm->find(keys[i].c_str(), keys[i].size(), &size);
+
+            if(value)
+            {
+              counter.visit(keys[i].c_str(), keys[i].size(), value, size);
+              free(value);
+              ++count;
+            }
+          }
+
+          break;
+        }
+      case 1:
+        {
+          count = dbm->find_bulk(lookup_keys, counter);
+          break;
+        }
+      case 2:
+        {
+          count = dbm->scan_prefix(counter, "key-", 4);
+          break;
+        }
+      }
+
+      ACE_Time_Value time = ACE_OS::gettimeofday() - start;
+
+      if(count != records)
+      {
+        std::ostringstream ostr;
+        ostr << "bench_scan: " << count << " records read instead of "
+             << records;
+
+        throw Exception(ostr.str());
+      }
+
+      const char* names[] = { "point lookups", "bulk find", "prefix scan" };
+      double sec = time.sec() + time.usec() / 1000000.0;
+
+      std::cerr << "BTreeDBM " << names[method] << ": " << records
+                << " records, " << (unsigned long)(records / sec)
+                << " records per second\n";
+    }
+
+    dbm = 0;
+    unlink(path.c_str());
+  }
+
+  void
+  bench(unsigned long threads, unsigned long records)
+    throw(Exception, El::Exception)
+  {
+    std::string path = db_path("bench");
+
+    for(unsigned long batched = 0; batched < 2; ++batched)
+    {
+      // Database synchronized on each modification as an indexer
+      // requiring durability would open it
+      El::TokyoCabinet::DBM_var dbm = open_db(path, true);
+      El::TokyoCabinet::DBM_var target = dbm;
+
+      if(batched)
+      {
+        target = new El::TokyoCabinet::BatchWriter(dbm.in());
+      }
+
+      ACE_Time_Value time = run_workers(target.in(), threads, records);
+
+      if(batched)
+      {
+        ACE_Time_Value start = ACE_OS::gettimeofday();
+        target->sync();
+        time += ACE_OS::gettimeofday() - start;
+      }
+
+      double sec = time.sec() + time.usec() / 1000000.0;
+
+      std::cerr << (batched ? "BatchWriter" : "BTreeDBM") << ": "
+                << threads << " threads, " << records / threads * threads
+                << " records, " << (unsigned long)(records / sec)
+                << " inserts per second\n";
+
+      target = 0;
+      dbm = 0;
+    }
+
+    unlink(path.c_str());
+  }
+}
+
+int
+main(int argc, char** argv)
+{
+  unsigned long records = 20000;
+  unsigned long threads = 4;
+
+  for(int i = 1; i < argc; ++i)
+  {
+    const char* arg = argv[i];
+
+    if(strncmp(arg, "--records=", 10) == 0)
+    {
+      records = atol(arg + 10);
+    }
+    else if(strncmp(arg, "--threads=", 10) == 0)
+    {
+      threads = atol(arg + 10);
+    }
+    else
+    {
+      std::cerr << USAGE << std::endl;
+      return -1;
+    }
+  }
+
+  if(records == 0 || threads == 0)
+  {
+    std::cerr << USAGE << std::endl;
+    return -1;
+  }
+
+  try
+  {
+    check_overlay();
+    check_files();
+    check_retry();
+    check_threads(threads, records);
+    check_scan();
+    bench(threads, records);
+    bench_scan(records);
+
+    return 0;
+  }
+  catch(const El::Exception& e)
+  {
+    std::cerr << "ElTestTokyoCabinet: El::Exception caught. Description:\n"
+              << e << std::endl;
+  }
+
+  return -1;
+}
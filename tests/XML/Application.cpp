@@ -0,0 +1,760 @@
+/*
+ * product   : Elements - useful abstractions library.
+ * copyright : Copyright (c) 2005-2016 Karen Arutyunov
+ * licenses  : GNU GPL v2; see accompanying LICENSE file
+ *             Commercial; contact karen.arutyunov@gmail.com
+ */
+
+/**
+ * @file   Elements/tests/XML/Application.cpp
+ * @author Karen Arutyunov
+ * $Id:$
+ */
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <memory>
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include <xercesc/util/XMLString.hpp>
+#include <xercesc/util/XMLException.hpp>
+#include <xercesc/sax/SAXException.hpp>
+#include <xercesc/sax2/Attributes.hpp>
+#include <xercesc/sax2/DefaultHandler.hpp>
+#include <xercesc/sax2/SAX2XMLReader.hpp>
+
+#include <El/Exception.hpp>
+#include <El/ArrayPtr.hpp>
+
+#include <El/XML/Use.hpp>
+#include <El/XML/InputStream.hpp>
+#include <El/XML/EntityCache.hpp>
+#include <El/XML/EntityResolver.hpp>
+#include <El/XML/GrammarPool.hpp>
+
+#include "Application.hpp"
+
+namespace
+{
+  const char USAGE[] = "\nUsage:\nElTestXML <command> <args>\n"
+  "Synopsis 1: ElTestXML help\n"
+  "Synopsis 2: ElTestXML run\n";
+
+  //
+  // DTDs are served by resolver from entity cache, so host is never
+  // connected
+  //
+  const char DTD_URL[] = "http://dtd.el.test/";
+  const char DTDS[] = "abc";
+
+  const size_t THREADS = 4;
+  const size_t THREAD_PARSES = 300;
+
+  std::string
+  transcode(const XMLCh* str) throw(El::Exception)
+  {
+    El::ArrayPtr<char> val(xercesc::XMLString::transcode(str));
+    return val.get() ? val.get() : "";
+  }
+
+  //
+  // Collects kind attributes of item elements; DTD provides default
+  // value, so items without one show DTD was applied
+  //
+  class Handler : public xercesc::DefaultHandler
+  {
+  public:
+    std::string kinds;
+
+    virtual void startElement(const XMLCh* const uri,
+                              const XMLCh* const localname,
+                              const XMLCh* const qname,
+                              const xercesc::Attributes& attrs);
+  };
+
+  void
+  Handler::startElement(const XMLCh* const uri,
+                        const XMLCh* const localname,
+                        const XMLCh* const qname,
+                        const xercesc::Attributes& attrs)
+  {
+    if(transcode(localname) != "item")
+    {
+      return;
+    }
+
+    for(XMLSize_t i = 0; i < attrs.getLength(); ++i)
+    {
+      if(transcode(attrs.getLocalName(i)) == "kind")
+      {
+        kinds += (kinds.empty() ? "" : ",") + transcode(attrs.getValue(i));
+      }
+    }
+  }
+
+  //
+  // Parses document of DTD dtd returning kinds of its items; if pooled is
+  // false reader parses without going through the pool
+  //
+  std::string
+  parse(El::XML::GrammarPool& pool,
+        xercesc::SAX2XMLReader& reader,
+        Handler& handler,
+        char dtd,
+        bool pooled = true)
+    throw(Application::Exception, El::Exception)
+  {
+    std::ostringstream doc;
+    doc << "<?xml version=\"1.0\"?>\n<!DOCTYPE doc SYSTEM \"" << DTD_URL
+        << dtd << ".dtd\">\n<doc><item/><item kind=\"own\"/></doc>\n";
+
+    std::istringstream istr(doc.str());
+    El::XML::InputSource source(istr);
+
+    std::string error;
+    handler.kinds.clear();
+
+    try
+    {
+      if(pooled)
+      {
+        pool.parse(reader, source);
+      }
+      else
+      {
+        reader.parse(source);
+      }
+    }
+    catch(const xercesc::SAXException& e)
+    {
+      error = transcode(e.getMessage());
+    }
+    catch(const xercesc::XMLException& e)
+    {
+      error = transcode(e.getMessage());
+    }
+
+    if(!error.empty())
+    {
+      std::ostringstream ostr;
+      ostr << "parse: parsing document of " << dtd << " DTD failed. "
+        "Reason: " << error;
+
+      throw Application::Exception(ostr.str());
+    }
+
+    std::string expected = std::string(1, dtd) + ",own";
+
+    if(handler.kinds != expected)
+    {
+      std::ostringstream ostr;
+      ostr << "parse: unexpected item kinds '" << handler.kinds
+           << "' of document of " << dtd << " DTD";
+
+      throw Application::Exception(ostr.str());
+    }
+
+    return handler.kinds;
+  }
+
+  //
+  // Grammar pool and reader resolving DTDs from memory
+  //
+  struct Parser
+  {
+    El::XML::EntityCache_var entities;
+    El::XML::EntityResolver resolver;
+    El::XML::GrammarPool pool;
+    Handler handler;
+    std::auto_ptr<xercesc::SAX2XMLReader> reader;
+
+    Parser(size_t max_grammars) throw(El::Exception);
+
+    void parse(char dtd) throw(Application::Exception, El::Exception);
+  };
+
+  Parser::Parser(size_t max_grammars) throw(El::Exception)
+      : entities(new El::XML::EntityCache()),
+        resolver(El::XML::EntityResolver::NetStrategy(),
+                 El::XML::EntityResolver::FileStrategy(),
+                 entities.in()),
+        pool(max_grammars)
+  {
+    for(const char* dtd = DTDS; *dtd != '\0'; ++dtd)
+    {
+      std::ostringstream ostr;
+      ostr << "<!ELEMENT doc (item*)>\n<!ELEMENT item EMPTY>\n"
+        "<!ATTLIST item kind CDATA \"" << *dtd << "\">\n";
+
+      std::string body = ostr.str();
+      std::string url = std::string(DTD_URL) + *dtd + ".dtd";
+
+      El::XML::EntityCache::Content_var content =
+        entities->insert(url.c_str(), body);
+    }
+
+    reader.reset(pool.create_reader(&resolver));
+    reader->setContentHandler(&handler);
+  }
+
+  void
+  Parser::parse(char dtd) throw(Application::Exception, El::Exception)
+  {
+    ::parse(pool, *reader, handler, dtd);
+  }
+
+  //
+  // Parses documents of all DTDs with own reader of shared pool
+  //
+  struct Reader
+  {
+    Parser* parser;
+    std::string error;
+
+    Reader() throw() : parser(0) {}
+
+    static void* run(void* arg);
+  };
+
+  void*
+  Reader::run(void* arg)
+  {
+    Reader* self = static_cast<Reader*>(arg);
+
+    try
+    {
+      Handler handler;
+
+      std::auto_ptr<xercesc::SAX2XMLReader> reader(
+        self->parser->pool.create_reader(&self->parser->resolver));
+
+      reader->setContentHandler(&handler);
+
+      for(size_t i = 0; i < THREAD_PARSES; ++i)
+      {
+        parse(self->parser->pool,
+              *reader,
+              handler,
+              DTDS[i % (sizeof(DTDS) - 1)]);
+      }
+    }
+    catch(const El::Exception& e)
+    {
+      self->error = e.what();
+    }
+
+    return 0;
+  }
+
+  void
+  check_stat(const El::XML::GrammarPool::Stat& stat,
+             unsigned long long grammars,
+             unsigned long long evictions,
+             unsigned long long retired,
+             const char* context)
+    throw(Application::Exception, El::Exception)
+  {
+    if(stat.grammars != grammars || stat.evictions != evictions ||
+       stat.retired != retired)
+    {
+      std::ostringstream ostr;
+      ostr << context << ": unexpected grammar pool state; grammars "
+           << stat.grammars << " (expected " << grammars << "), evictions "
+           << stat.evictions << " (expected " << evictions << "), retired "
+           << stat.retired << " (expected " << retired << ")";
+
+      throw Application::Exception(ostr.str());
+    }
+  }
+
+  void
+  check_lookup(const El::XML::GrammarPool::Stat& before,
+               const El::XML::GrammarPool::Stat& after,
+               bool hit,
+               const char* context)
+    throw(Application::Exception, El::Exception)
+  {
+    if(hit ? (after.hits == before.hits || after.misses != before.misses) :
+       after.misses == before.misses)
+    {
+      std::ostringstream ostr;
+      ostr << context << ": grammar expected to be "
+           << (hit ? "reused" : "built") << "; hits " << before.hits
+           << " -> " << after.hits << ", misses " << before.misses << " -> "
+           << after.misses;
+
+      throw Application::Exception(ostr.str());
+    }
+  }
+
+  void
+  check_entities(const El::XML::EntityCache::Stat& stat,
+                 unsigned long long entries,
+                 unsigned long long bytes,
+                 unsigned long long evictions,
+                 unsigned long long expirations,
+                 unsigned long long rejections,
+                 const char* context)
+    throw(Application::Exception, El::Exception)
+  {
+    if(stat.entries != entries || stat.bytes != bytes ||
+       stat.evictions != evictions || stat.expirations != expirations ||
+       stat.rejections != rejections)
+    {
+      std::ostringstream ostr;
+      ostr << context << ": unexpected entity cache state; entries "
+           << stat.entries << "/" << entries << ", bytes " << stat.bytes
+           << "/" << bytes << ", evictions " << stat.evictions << "/"
+           << evictions << ", expirations " << stat.expirations << "/"
+           << expirations << ", rejections " << stat.rejections << "/"
+           << rejections << " (actual/expected)";
+
+      throw Application::Exception(ostr.str());
+    }
+  }
+
+  //
+  // Returns cached content of key or empty string if not found
+  //
+  std::string
+  find(El::XML::EntityCache& cache, const char* key) throw(El::Exception)
+  {
+    El::XML::EntityCache::Content_var content = cache.find(key);
+    return content.in() ? content->data() : "";
+  }
+
+  void
+  insert(El::XML::EntityCache& cache, const char* key, const char* data)
+    throw(El::Exception)
+  {
+    std::string body(data);
+    El::XML::EntityCache::Content_var content = cache.insert(key, body);
+  }
+}
+
+int
+main(int argc, char** argv)
+{
+  try
+  {
+    Application app;
+    return app.run(argc, argv);
+  }
+  catch(const Application::InvalidArg& e)
+  {
+    std::cerr << "Invalid argument: " << e
+              << "\nRun 'ElTestXML help' for usage details\n";
+  }
+  catch(const El::Exception& e)
+  {
+    std::cerr << "ElTestXML: El::Exception caught. "
+      "Description:" << std::endl << e << std::endl;
+  }
+  catch(...)
+  {
+    std::cerr << "ElTestXML: unknown exception caught\n";
+  }
+
+  return -1;
+}
+
+Application::Application() throw(Application::Exception, El::Exception)
+{
+}
+
+Application::~Application() throw()
+{
+}
+
+int
+Application::run(int& argc, char** argv)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  std::string command;
+
+  int i = 1;
+
+  if(argc > 1)
+  {
+    command = argv[i++];
+  }
+
+  ArgList arguments;
+
+  for(; i < argc; i++)
+  {
+    char* argument = argv[i];
+
+    Argument arg;
+    const char* eq = strstr(argument, "=");
+
+    if(eq == 0)
+    {
+      arg.name = argument;
+    }
+    else
+    {
+      arg.name.assign(argument, eq - argument);
+      arg.value = eq + 1;
+    }
+
+    arguments.push_back(arg);
+  }
+
+  if(command == "help")
+  {
+    return help(arguments);
+  }
+
+  return test(arguments);
+}
+
+int
+Application::help(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  std::cerr << USAGE;
+  return 0;
+}
+
+int
+Application::test(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  test_entity_cache();
+
+  // Keeps Xerces initialized while pools and readers are alive
+  El::XML::Use use;
+
+  test_grammar_reuse();
+  test_grammar_eviction();
+  test_grammar_retirement();
+  test_grammar_reader();
+
+  return 0;
+}
+
+void
+Application::test_entity_cache() throw(Exception, El::Exception)
+{
+  std::cerr << "* Testing entity cache ...\n";
+
+  {
+    // 2 entries, 10 bytes, 6 bytes per entry
+    El::XML::EntityCache cache(2, 10, 6, 3600);
+
+    insert(cache, "a", "aaaa");
+    insert(cache, "b", "bbbb");
+
+    check_entities(cache.stat(), 2, 8, 0, 0, 0,
+                   "Application::test_entity_cache: insert");
+
+    // Makes b least recently used
+    if(find(cache, "a") != "aaaa")
+    {
+      throw Exception("Application::test_entity_cache: a not found");
+    }
+
+    insert(cache, "c", "cc");
+
+    check_entities(cache.stat(), 2, 6, 1, 0, 0,
+                   "Application::test_entity_cache: entry count limit");
+
+    if(!find(cache, "b").empty() || find(cache, "c") != "cc")
+    {
+      throw Exception("Application::test_entity_cache: unexpected entry "
+                      "evicted on entry count limit");
+    }
+
+    std::string body("rejected");
+    El::XML::EntityCache::Content_var content = cache.insert("d", body);
+
+    if(std::string(content->data()) != "rejected" ||
+       !find(cache, "d").empty())
+    {
+      throw Exception("Application::test_entity_cache: entry bigger than "
+                      "limit is cached or lost");
+    }
+
+    check_entities(cache.stat(), 2, 6, 1, 0, 1,
+                   "Application::test_entity_cache: entry size limit");
+
+    cache.clear();
+
+    check_entities(cache.stat(), 0, 0, 1, 0, 1,
+                   "Application::test_entity_cache: clear");
+  }
+
+  {
+    // 10 bytes, any number of entries
+    El::XML::EntityCache cache(0, 10, 10, 3600);
+
+    insert(cache, "a", "aaaa");
+    insert(cache, "b", "bbbb");
+    insert(cache, "c", "cccc");
+
+    check_entities(cache.stat(), 2, 8, 1, 0, 0,
+                   "Application::test_entity_cache: byte limit");
+
+    if(!find(cache, "a").empty() || find(cache, "b") != "bbbb")
+    {
+      throw Exception("Application::test_entity_cache: unexpected entry "
+                      "evicted on byte limit");
+    }
+
+    // Replacing entry frees its bytes first
+    insert(cache, "c", "cccccc");
+
+    check_entities(cache.stat(), 2, 10, 1, 0, 0,
+                   "Application::test_entity_cache: replace");
+  }
+
+  {
+    El::XML::EntityCache cache(0, 0, 1024, 1);
+
+    insert(cache, "a", "aaaa");
+
+    if(find(cache, "a") != "aaaa")
+    {
+      throw Exception("Application::test_entity_cache: fresh entry not "
+                      "found");
+    }
+
+    sleep(2);
+
+    if(!find(cache, "a").empty())
+    {
+      throw Exception("Application::test_entity_cache: expired entry "
+                      "found");
+    }
+
+    check_entities(cache.stat(), 0, 0, 0, 1, 0,
+                   "Application::test_entity_cache: expiration");
+
+    El::XML::EntityCache::Stat stat = cache.stat();
+
+    if(stat.hits != 1 || stat.misses != 1)
+    {
+      std::ostringstream ostr;
+      ostr << "Application::test_entity_cache: unexpected hits "
+           << stat.hits << " and misses " << stat.misses;
+
+      throw Exception(ostr.str());
+    }
+  }
+}
+
+void
+Application::test_grammar_reuse() throw(Exception, El::Exception)
+{
+  std::cerr << "* Testing grammar reuse ...\n";
+
+  Parser parser(8);
+
+  parser.parse('a');
+
+  El::XML::GrammarPool::Stat stat = parser.pool.stat();
+
+  if(stat.misses == 0)
+  {
+    throw Exception("Application::test_grammar_reuse: first parse didn't "
+                    "look for grammar");
+  }
+
+  check_stat(stat, 1, 0, 0, "Application::test_grammar_reuse: first parse");
+
+  for(size_t i = 0; i < 2; ++i)
+  {
+    parser.parse('a');
+
+    El::XML::GrammarPool::Stat next = parser.pool.stat();
+
+    check_lookup(stat, next, true,
+                 "Application::test_grammar_reuse: next parse");
+
+    stat = next;
+  }
+
+  check_stat(stat, 1, 0, 0, "Application::test_grammar_reuse: next parse");
+
+  std::vector<Reader> readers(THREADS);
+  std::vector<pthread_t> threads(readers.size());
+
+  for(size_t i = 0; i < readers.size(); ++i)
+  {
+    readers[i].parser = &parser;
+
+    if(pthread_create(&threads[i], 0, Reader::run, &readers[i]))
+    {
+      throw Exception("Application::test_grammar_reuse: pthread_create "
+                      "failed");
+    }
+  }
+
+  for(size_t i = 0; i < threads.size(); ++i)
+  {
+    pthread_join(threads[i], 0);
+  }
+
+  for(size_t i = 0; i < readers.size(); ++i)
+  {
+    if(!readers[i].error.empty())
+    {
+      throw Exception(readers[i].error);
+    }
+  }
+
+  check_stat(parser.pool.stat(), sizeof(DTDS) - 1, 0, 0,
+             "Application::test_grammar_reuse: concurrent parses");
+}
+
+void
+Application::test_grammar_eviction() throw(Exception, El::Exception)
+{
+  std::cerr << "* Testing grammar eviction ...\n";
+
+  const char* context = "Application::test_grammar_eviction";
+
+  Parser parser(2);
+
+  parser.parse('a');
+  parser.parse('b');
+
+  check_stat(parser.pool.stat(), 2, 0, 0, context);
+
+  //
+  // Each step parses document of dtd which grammar is expected to be
+  // reused or built, leaving grammars and evictions in pool
+  //
+  struct Step
+  {
+    char dtd;
+    bool hit;
+    unsigned long long evictions;
+  };
+
+  const Step STEPS[] =
+  {
+    { 'a', true, 0 },  // a becomes most recently used
+    { 'c', false, 1 }, // evicts b
+    { 'a', true, 1 },
+    { 'b', false, 2 }, // evicts c
+    { 'a', true, 2 },
+    { 'c', false, 3 }  // evicts b
+  };
+
+  for(size_t i = 0; i < sizeof(STEPS) / sizeof(STEPS[0]); ++i)
+  {
+    const Step& step = STEPS[i];
+    El::XML::GrammarPool::Stat stat = parser.pool.stat();
+
+    parser.parse(step.dtd);
+
+    El::XML::GrammarPool::Stat next = parser.pool.stat();
+
+    check_lookup(stat, next, step.hit, context);
+    check_stat(next, 2, step.evictions, 0, context);
+  }
+}
+
+void
+Application::test_grammar_retirement() throw(Exception, El::Exception)
+{
+  std::cerr << "* Testing evicted grammar retirement ...\n";
+
+  const char* context = "Application::test_grammar_retirement";
+
+  Parser parser(1);
+
+  {
+    // As if other thread parses document of evicted grammar
+    El::XML::GrammarPool::ParseGuard guard(parser.pool);
+
+    parser.parse('a');
+    parser.parse('b');
+
+    check_stat(parser.pool.stat(), 1, 1, 1, context);
+
+    parser.parse('c');
+
+    check_stat(parser.pool.stat(), 1, 2, 2, context);
+  }
+
+  check_stat(parser.pool.stat(), 1, 2, 0, context);
+
+  El::XML::GrammarPool::Stat stat = parser.pool.stat();
+
+  parser.parse('a');
+
+  check_lookup(stat, parser.pool.stat(), false, context);
+  check_stat(parser.pool.stat(), 1, 3, 0, context);
+
+  //
+  // Under steady load some parse is always in progress; grammar is deleted
+  // as soon as parses which could get it finish
+  //
+  typedef std::auto_ptr<El::XML::GrammarPool::ParseGuard> ParseGuardPtr;
+
+  ParseGuardPtr first(new El::XML::GrammarPool::ParseGuard(parser.pool));
+
+  parser.parse('b');
+
+  check_stat(parser.pool.stat(), 1, 4, 1, context);
+
+  ParseGuardPtr second(new El::XML::GrammarPool::ParseGuard(parser.pool));
+
+  parser.parse('c');
+
+  check_stat(parser.pool.stat(), 1, 5, 2, context);
+
+  first.reset(0);
+
+  check_stat(parser.pool.stat(), 1, 5, 1, context);
+
+  ParseGuardPtr third(new El::XML::GrammarPool::ParseGuard(parser.pool));
+
+  second.reset(0);
+
+  check_stat(parser.pool.stat(), 1, 5, 0, context);
+}
+
+void
+Application::test_grammar_reader() throw(Exception, El::Exception)
+{
+  std::cerr << "* Testing pool reader parsing directly ...\n";
+
+  const char* context = "Application::test_grammar_reader";
+
+  Parser parser(1);
+  Handler handler;
+
+  std::auto_ptr<xercesc::SAX2XMLReader> reader(
+    parser.pool.create_reader(&parser.resolver));
+
+  reader->setContentHandler(&handler);
+
+  parse(parser.pool, *reader, handler, 'a', false);
+  parse(parser.pool, *reader, handler, 'a', false);
+
+  check_stat(parser.pool.stat(), 1, 0, 0, context);
+
+  // Evicts and deletes grammar reader got from pool before
+  parser.parse('b');
+
+  check_stat(parser.pool.stat(), 1, 1, 0, context);
+
+  //
+  // Reader should drop deleted grammar and look for the one in pool
+  // rather than reuse it
+  //
+  El::XML::GrammarPool::Stat stat = parser.pool.stat();
+
+  parse(parser.pool, *reader, handler, 'a', false);
+
+  check_lookup(stat, parser.pool.stat(), false, context);
+  check_stat(parser.pool.stat(), 1, 2, 0, context);
+}
@@ -25,6 +25,7 @@
 #include <El/Moment.hpp>
 #include <El/Compress/ZLib.hpp>
 #include <El/Compress/GZip.hpp>
+#include <El/Service/ThreadPool.hpp>
 
 #include "Application.hpp"
 
@@ -33,9 +34,34 @@ namespace
   const char USAGE[] = "\nUsage:\nElTestZLib <command> <args>\n"
   "Synopsis 1: ElTestZLib help\n"
   "Synopsis 2: ElTestZLib run [file=<filename>]\n"
-  "Synopsis 3: ElTestZLib gzip file=<filename>\n";
+  "Synopsis 3: ElTestZLib gzip file=<filename>\n"
+  "Synopsis 4: ElTestZLib bench [file=<filename>] [size=<bytes>] "
+  "[threads=<number>] [block=<bytes>]\n";
 
   const size_t BUFF_SIZE = 300000000;
+
+  const size_t PARALLEL_THREADS = 4;
+  const size_t BENCH_DATA_SIZE = 64 * 1024 * 1024;
+
+  class PoolCallback : public El::Service::Callback
+  {
+  public:
+    virtual bool notify(El::Service::Event* event) throw(El::Exception);
+  };
+  
+  bool
+  PoolCallback::notify(El::Service::Event* event) throw(El::Exception)
+  {
+    El::Service::Error* error = dynamic_cast<El::Service::Error*>(event);
+
+    if(error)
+    {
+      std::cerr << "PoolCallback::notify: " << error->description
+                << std::endl;
+    }
+
+    return true;
+  }
 }
 
 int
@@ -125,6 +151,10 @@ Application::run(int& argc, char** argv)
 
     return gzip(arguments[0].value.c_str());
   }
+  else if(command == "bench")
+  {
+    return bench(arguments);
+  }
 
   test(arguments);
 
@@ -201,6 +231,15 @@ Application::test(const ArgList& arguments)
 
   if(source_name.empty())
   {
+    // Deflater pool shared by streams
+    PoolCallback pool_callback;
+    
+    El::Service::ThreadPool_var pool =
+      new El::Service::ThreadPool(&pool_callback,
+                                  "TestZLibDeflater",
+                                  PARALLEL_THREADS);
+    pool->start();
+    
     size_t buff_size = 15;
     
     for(size_t i = 1; buff_size < 100000000;
@@ -231,8 +270,45 @@ Application::test(const ArgList& arguments)
                         buff_size,
                         data.get(),
                         data_size);
+
+        if(level == 0 || level == 1 || level == 6 || level == 9)
+        {
+          compressed_data.reset(
+            compress_data(data.get(),
+                          data_size,
+                          buff_size,
+                          level,
+                          compressed_data_size,
+                          PARALLEL_THREADS,
+                          El::Compress::ZLib::OutStreamBuf::DICTIONARY_SIZE));
+
+          uncompress_data(compressed_data.get(),
+                          compressed_data_size,
+                          buff_size,
+                          data.get(),
+                          data_size);
+
+          compressed_data.reset(
+            compress_data(data.get(),
+                          data_size,
+                          buff_size,
+                          level,
+                          compressed_data_size,
+                          PARALLEL_THREADS,
+                          El::Compress::ZLib::OutStreamBuf::DICTIONARY_SIZE,
+                          pool.in()));
+
+          uncompress_data(compressed_data.get(),
+                          compressed_data_size,
+                          buff_size,
+                          data.get(),
+                          data_size);
+        }
       }
     }
+
+    pool->stop();
+    pool->wait();
   }
   else
   {
@@ -247,6 +323,153 @@ Application::test(const ArgList& arguments)
   return 0;
 }
 
+int
+Application::bench(const ArgList& arguments)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  std::string source_name;
+  size_t data_size = BENCH_DATA_SIZE;
+  size_t threads = PARALLEL_THREADS;
+  size_t block_size = El::Compress::ZLib::OutStreamBuf::DEFAULT_BLOCK_SIZE;
+  
+  for(ArgList::const_iterator it = arguments.begin(); it != arguments.end();
+      it++)
+  {
+    if(it->name == "file")
+    {
+      source_name = it->value;
+    }
+    else if(it->name == "size")
+    {
+      data_size = atol(it->value.c_str());
+    }
+    else if(it->name == "threads")
+    {
+      threads = atol(it->value.c_str());
+    }
+    else if(it->name == "block")
+    {
+      block_size = atol(it->value.c_str());
+    }
+    else
+    {
+      std::ostringstream ostr;
+      ostr << "Application::bench: unexpected argument " << it->name;
+      throw InvalidArg(ostr.str());
+    }
+  }
+
+  std::auto_ptr<unsigned char> data;
+
+  if(source_name.empty())
+  {
+    data.reset(random_data(data_size));
+  }
+  else
+  {
+    std::fstream infile(source_name.c_str(), std::ios::in);
+
+    if(!infile.is_open())
+    {
+      std::ostringstream ostr;
+      ostr << "Application::bench: failed to open file " << source_name;
+    
+      throw InvalidArg(ostr.str());
+    }
+
+    std::string content;
+    char buff[1024 * 10];
+
+    while(infile.read(buff, sizeof(buff)) || infile.gcount())
+    {
+      content.append(buff, infile.gcount());
+    }
+
+    data_size = content.size();
+    data.reset(new unsigned char[data_size]);
+    memcpy(data.get(), content.c_str(), data_size);
+  }
+
+  std::cout << "benchmarking " << data_size << " bytes, threads="
+            << threads << ", block_size=" << block_size << std::endl;
+
+  for(unsigned long level = 0; level <= 9; level++)
+  {
+    size_t sizes[2];
+    ACE_Time_Value times[2];
+    
+    std::auto_ptr<unsigned char> single(
+      bench_data(data.get(), data_size, level, 1, block_size, sizes[0],
+                 times[0]));
+    
+    std::auto_ptr<unsigned char> parallel(
+      bench_data(data.get(), data_size, level, threads, block_size,
+                 sizes[1], times[1]));
+
+    std::cout << "level " << level;
+    
+    for(size_t i = 0; i < 2; i++)
+    {
+      double sec = times[i].sec() + (double)times[i].usec() / 1000000;
+      
+      std::cout << (i ? ", parallel " : ": single ")
+                << (sec > 0 ? (double)data_size / sec / 1024 / 1024 : 0)
+                << " MB/s (" << sizes[i] * 100 / (data_size ? data_size : 1)
+                << "%)";
+    }
+
+    std::cout << std::endl;
+    
+    uncompress_data(parallel.get(),
+                    sizes[1],
+                    1024 * 64,
+                    data.get(),
+                    data_size);
+  }
+
+  return 0;
+}
+
+unsigned char*
+Application::bench_data(unsigned char* data,
+                        size_t data_size,
+                        unsigned long level,
+                        size_t threads,
+                        size_t block_size,
+                        size_t& compressed_data_size,
+                        ACE_Time_Value& wall_time)
+  throw(InvalidArg, Exception, El::Exception)
+{
+  DataWriter writer;
+  ACE_Time_Value start = ACE_OS::gettimeofday();
+
+  {
+    El::Compress::ZLib::OutStream zlib_out(&writer,
+                                           level,
+                                           1024 * 64,
+                                           1024 * 64,
+                                           false,
+                                           false,
+                                           threads,
+                                           block_size);
+    
+    zlib_out.write((char*)data, data_size);
+    zlib_out.finalize();
+
+    if(!zlib_out.last_error_desc().empty())
+    {
+      std::ostringstream ostr;
+      ostr << "Application::bench_data: data compression failed. Error:\n"
+           << zlib_out.last_error_desc();
+
+      throw Exception(ostr.str());
+    }
+  }
+
+  wall_time = ACE_OS::gettimeofday() - start;
+  return writer.release(compressed_data_size);
+}
+
 void
 Application::uncompress_data(unsigned char* compressed_data,
                              size_t compressed_data_size, 
@@ -353,7 +576,10 @@ Application::compress_data(unsigned char* data,
                            size_t data_size,
                            size_t buff_size,
                            unsigned long level,
-                           size_t& compressed_data_size)
+                           size_t& compressed_data_size,
+                           size_t threads,
+                           size_t block_size,
+                           El::Service::ThreadPool* pool)
   throw(InvalidArg, Exception, El::Exception)
 {
   size_t fraction1 = (unsigned long long)rand() * 10 /
@@ -381,7 +607,19 @@ Application::compress_data(unsigned char* data,
   std::cout << "compressing data_size=" << data_size
             << ", buff_size=" << buff_size << ", chunk_size="
             << chunk_size << ", write_chunk_size=" << write_chunk_size
-            << ", level=" << level << " ...";
+            << ", level=" << level;
+
+  if(threads > 1)
+  {
+    std::cout << ", threads=" << threads << ", block_size=" << block_size;
+
+    if(pool)
+    {
+      std::cout << ", shared pool";
+    }
+  }
+
+  std::cout << " ...";
 
   std::cout.flush();
 
@@ -394,7 +632,12 @@ Application::compress_data(unsigned char* data,
       El::Compress::ZLib::OutStream zlib_out(&writer,
                                              level,
                                              buff_size,
-                                             buff_size);
+                                             buff_size,
+                                             false,
+                                             false,
+                                             threads,
+                                             block_size,
+                                             pool);
 
       size_t bytes_left = data_size;
       size_t portion = 0;
@@ -54,6 +54,9 @@ private:
   int test(const ArgList& arguments)
     throw(InvalidArg, Exception, El::Exception);
 
+  int bench(const ArgList& arguments)
+    throw(InvalidArg, Exception, El::Exception);
+
   void compress_file(const char* source_name,
                      const char* dest_name,
                      unsigned long level,
@@ -72,7 +75,21 @@ private:
                                size_t data_size,
                                size_t buff_size,
                                unsigned long level,
-                               size_t& compressed_data_size)
+                               size_t& compressed_data_size,
+                               size_t threads = 1,
+                               size_t block_size =
+                                 El::Compress::ZLib::OutStreamBuf::
+                                 DEFAULT_BLOCK_SIZE,
+                               El::Service::ThreadPool* pool = 0)
+    throw(InvalidArg, Exception, El::Exception);
+
+  unsigned char* bench_data(unsigned char* data,
+                            size_t data_size,
+                            unsigned long level,
+                            size_t threads,
+                            size_t block_size,
+                            size_t& compressed_data_size,
+                            ACE_Time_Value& wall_time)
     throw(InvalidArg, Exception, El::Exception);
   
   void uncompress_data(unsigned char* compressed_data,